@@ -17,6 +17,8 @@
 
 #include <sstream>
 
+#include <shared_core/FileLogDestination.hpp>
+
 #include <core/FileUtils.hpp>
 #include <core/Settings.hpp>
 #include <core/StringUtils.hpp>
@@ -201,6 +203,17 @@ FilePath permissionFile()
    return core::system::xdg::userDataDir().completeChildPath(kCrashPermissionFile);
 }
 
+#ifdef __linux__
+bool flushLogsOnCrash(int, siginfo_t*, ucontext_t*)
+{
+   // write out any log messages that are still queued so the lead-up to the crash isn't lost
+   log::FileLogDestination::flushOnCrash();
+
+   // let crashpad handle the crash
+   return false;
+}
+#endif
+
 } // anonymous namespace
 
 Error initialize(ProgramMode programMode)
@@ -342,6 +355,8 @@ Error initialize(ProgramMode programMode)
                                                         uploadUrl,
                                                         annotations,
                                                         args);
+   if (success)
+      crashpad::CrashpadClient::SetFirstChanceExceptionHandler(flushLogsOnCrash);
 #else
    bool success = s_crashpadClient->StartHandler(handlerPath,
                                                  databasePath,
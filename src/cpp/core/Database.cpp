@@ -17,6 +17,8 @@
 
 #include <boost/algorithm/string.hpp>
 #include <boost/format.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/weak_ptr.hpp>
 
 #include <core/FileSerializer.hpp>
 #include <core/http/Util.hpp>
@@ -144,6 +146,20 @@ Error getDatabaseError(const soci::soci_error& sociError, const ErrorLocation& i
 
 // Database errors =================================================================================================
 
+namespace {
+
+// the most prepared statements each connection keeps for reuse
+const std::size_t kStatementCacheSize = 64;
+
+bool isSchemaChange(const std::string& sqlStatement)
+{
+   return boost::algorithm::istarts_with(sqlStatement, "create") ||
+          boost::algorithm::istarts_with(sqlStatement, "alter") ||
+          boost::algorithm::istarts_with(sqlStatement, "drop");
+}
+
+} // anonymous namespace
+
 class ConnectVisitor : public boost::static_visitor<Error>
 {
 public:
@@ -473,6 +489,170 @@ Query::Query(const std::string& sqlStatement,
    }
 }
 
+namespace {
+
+// a select which wasn't read to the end leaves its sqlite statement active,
+// which keeps the connection's read transaction (and its lock) open until
+// the statement is reset. (postgresql reads results in full, so there's
+// nothing to do for it)
+void resetStatement(soci::statement& statement)
+{
+   soci::sqlite3_statement_backend* pBackend =
+         dynamic_cast<soci::sqlite3_statement_backend*>(statement.get_backend());
+   if (pBackend)
+      pBackend->reset();
+}
+
+} // anonymous namespace
+
+struct CachedStatement : boost::noncopyable
+{
+   CachedStatement(const boost::shared_ptr<StatementCache>& pCache,
+                   const std::string& sqlStatement,
+                   const soci::statement& statement) :
+      pCache(pCache),
+      sqlStatement(sqlStatement),
+      statement(statement),
+      reusable(true)
+   {
+   }
+
+   ~CachedStatement()
+   {
+      boost::shared_ptr<StatementCache> pStatementCache = pCache.lock();
+      if (!pStatementCache || !reusable)
+         return;
+
+      try
+      {
+         // forget the inputs and outputs of the query that used it, along
+         // with any rows it didn't read
+         statement.bind_clean_up();
+         resetStatement(statement);
+         pStatementCache->release(sqlStatement, statement);
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+   }
+
+   boost::weak_ptr<StatementCache> pCache;
+   std::string sqlStatement;
+   soci::statement statement;
+
+   // cleared when executing the statement fails, leaving it in an unknown state
+   bool reusable;
+};
+
+Query::Query(const boost::shared_ptr<CachedStatement>& pCachedStatement) :
+   statement_(pCachedStatement->statement),
+   pCachedStatement_(pCachedStatement)
+{
+}
+
+StatementCache::StatementCache(std::size_t capacity) :
+   capacity_(capacity),
+   hits_(0),
+   misses_(0)
+{
+}
+
+Query StatementCache::query(const std::string& sqlStatement, soci::session& session)
+{
+   boost::optional<soci::statement> statement;
+   LOCK_MUTEX(mutex_)
+   {
+      auto it = index_.find(sqlStatement);
+      if (it != index_.end())
+      {
+         // the statement is on loan until the query is done with it
+         statement = it->second->second;
+         statements_.erase(it->second);
+         index_.erase(it);
+         hits_++;
+      }
+      else
+      {
+         misses_++;
+      }
+   }
+   END_LOCK_MUTEX
+
+   if (!statement)
+   {
+      Query query(sqlStatement, session);
+      if (query.prepareError_)
+         return query;
+
+      statement = query.statement_;
+   }
+
+   return Query(boost::make_shared<CachedStatement>(shared_from_this(),
+                                                    sqlStatement,
+                                                    statement.get()));
+}
+
+void StatementCache::release(const std::string& sqlStatement, const soci::statement& statement)
+{
+   LOCK_MUTEX(mutex_)
+   {
+      // another query with the same sql may have returned its statement first
+      if (index_.count(sqlStatement))
+         return;
+
+      statements_.push_front(std::make_pair(sqlStatement, statement));
+      index_[sqlStatement] = statements_.begin();
+
+      if (statements_.size() > capacity_)
+      {
+         index_.erase(statements_.back().first);
+         statements_.pop_back();
+      }
+   }
+   END_LOCK_MUTEX
+}
+
+void StatementCache::clear()
+{
+   LOCK_MUTEX(mutex_)
+   {
+      index_.clear();
+      statements_.clear();
+   }
+   END_LOCK_MUTEX
+}
+
+std::size_t StatementCache::size() const
+{
+   LOCK_MUTEX(mutex_)
+   {
+      return statements_.size();
+   }
+   END_LOCK_MUTEX
+
+   return 0;
+}
+
+std::size_t StatementCache::hits() const
+{
+   LOCK_MUTEX(mutex_)
+   {
+      return hits_;
+   }
+   END_LOCK_MUTEX
+
+   return 0;
+}
+
+std::size_t StatementCache::misses() const
+{
+   LOCK_MUTEX(mutex_)
+   {
+      return misses_;
+   }
+   END_LOCK_MUTEX
+
+   return 0;
+}
+
 RowsetIterator Rowset::begin()
 {
    if (query_)
@@ -493,13 +673,14 @@ size_t Rowset::columnCount() const
 
 Connection::Connection(const soci::backend_factory& factory,
                        const std::string& connectionStr) :
-   session_(factory, connectionStr)
+   session_(factory, connectionStr),
+   pStatementCache_(boost::make_shared<StatementCache>(kStatementCacheSize))
 {
 }
 
 Query Connection::query(const std::string& sqlStatement)
 {
-   return Query(sqlStatement, session_);
+   return pStatementCache_->query(sqlStatement, session_);
 }
 
 Error Connection::execute(Query& query,
@@ -522,6 +703,8 @@ Error Connection::execute(Query& query,
    }
    catch (soci::soci_error& error)
    {
+      if (query.pCachedStatement_)
+         query.pCachedStatement_->reusable = false;
       return DatabaseError(error);
    }
 }
@@ -544,6 +727,8 @@ Error Connection::execute(Query& query,
    }
    catch (soci::soci_error& error)
    {
+      if (query.pCachedStatement_)
+         query.pCachedStatement_->reusable = false;
       return DatabaseError(error);
    }
 }
@@ -562,8 +747,15 @@ Error Connection::executeStr(const std::string& queryStr)
       for (std::string& query : queries)
       {
          query = string_utils::trimWhitespace(query);
-         if (!query.empty())
-            session_ << query;
+         if (query.empty())
+            continue;
+
+         // statements prepared against the old schema may no longer be valid
+         // (postgresql refuses to run them if their result columns change)
+         if (isSchemaChange(query))
+            pStatementCache_->clear();
+
+         session_ << query;
       }
 
       return Success();
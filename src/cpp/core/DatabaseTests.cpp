@@ -233,6 +233,71 @@ TEST_CASE("Database", "[.database]")
       }
    }
 
+   test_that("Prepared statements are reused")
+   {
+      boost::shared_ptr<IConnection> connection;
+      REQUIRE_FALSE(connect(sqliteConnectionOptions(), &connection));
+      const StatementCache& cache = boost::static_pointer_cast<Connection>(connection)->statementCache();
+
+      for (int id = 50; id < 60; id++)
+      {
+         std::string rowText;
+         Query query = connection->query("select text from Test where id = :id")
+            .withInput(id)
+            .withOutput(rowText);
+         REQUIRE_FALSE(connection->execute(query));
+         REQUIRE(rowText == "Test text " + safe_convert::numberToString(id));
+      }
+      REQUIRE(cache.misses() == 1);
+      REQUIRE(cache.hits() == 9);
+      REQUIRE(cache.size() == 1);
+
+      // a statement in use by one query is not shared with another
+      {
+         int firstCount = 0, secondCount = 0;
+         Query first = connection->query("select count(*) from Test")
+            .withOutput(firstCount);
+         Query second = connection->query("select count(*) from Test")
+            .withOutput(secondCount);
+         REQUIRE_FALSE(connection->execute(first));
+         REQUIRE_FALSE(connection->execute(second));
+         REQUIRE(firstCount > 0);
+         REQUIRE(firstCount == secondCount);
+         REQUIRE(cache.misses() == 3);
+      }
+      REQUIRE(cache.size() == 2);
+
+      // statements that fail to prepare are not kept
+      Query badQuery = connection->query("select text from NoSuchTable");
+      REQUIRE(connection->execute(badQuery));
+      REQUIRE(cache.size() == 2);
+   }
+
+   test_that("Released statements don't block writers")
+   {
+      boost::shared_ptr<IConnection> reader, writer;
+      REQUIRE_FALSE(connect(sqliteConnectionOptions(), &reader));
+      REQUIRE_FALSE(connect(sqliteConnectionOptions(), &writer));
+
+      // selects which stop reading after the first row
+      {
+         int id = 0;
+         Query query = reader->query("select id from Test")
+            .withOutput(id);
+         REQUIRE_FALSE(reader->execute(query));
+      }
+      {
+         Rowset rows;
+         Query query = reader->query("select id from Test");
+         REQUIRE_FALSE(reader->execute(query, rows));
+         REQUIRE(rows.begin() != rows.end());
+      }
+      REQUIRE(boost::static_pointer_cast<Connection>(reader)->statementCache().size() == 1);
+
+      Query insert = writer->query("insert into Test values (6000, '6000')");
+      REQUIRE_FALSE(writer->execute(insert));
+   }
+
    test_that("Can use connection pool")
    {
       boost::shared_ptr<ConnectionPool> connectionPool;
@@ -575,5 +640,49 @@ TEST_CASE("Database", "[.database]")
    }
 }
 
+benchmark_context("Database statement throughput")
+{
+   FilePath dbPath("/tmp/rstudio-benchmark-db");
+   dbPath.removeIfExists();
+
+   boost::shared_ptr<IConnection> connection;
+   REQUIRE_FALSE(connect(SqliteConnectionOptions { dbPath.getAbsolutePath() }, &connection));
+   REQUIRE_FALSE(connection->executeStr("create table Sessions(id int, last_used varchar(255))"));
+   REQUIRE_FALSE(connection->executeStr("insert into Sessions values (1, '')"));
+
+   int id = 1;
+   std::string lastUsed = "2022-04-30T00:00:00.000Z";
+
+   benchmark_that("1000 updates using cached statements")
+   {
+      Transaction transaction(connection);
+      for (int i = 0; i < 1000; i++)
+      {
+         Query query = connection->query("update Sessions set last_used = :value where id = :id")
+            .withInput(lastUsed)
+            .withInput(id);
+         connection->execute(query);
+      }
+      transaction.commit();
+      return id;
+   };
+
+   benchmark_that("1000 updates preparing each statement")
+   {
+      Transaction transaction(connection);
+      for (int i = 0; i < 1000; i++)
+      {
+         Query query = Query("update Sessions set last_used = :value where id = :id", connection->session())
+            .withInput(lastUsed)
+            .withInput(id);
+         connection->execute(query);
+      }
+      transaction.commit();
+      return id;
+   };
+
+   dbPath.removeIfExists();
+}
+
 } // namespace unit_tests
 } // namespace rstudio
@@ -0,0 +1,1166 @@
+/*
+ * FileSearch.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/FileSearch.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+
+#include <boost/bind/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/regex.hpp>
+
+#include <core/BoostThread.hpp>
+#include <core/Thread.hpp>
+
+#include <shared_core/Error.hpp>
+
+#ifndef _WIN32
+# include <dirent.h>
+# include <fcntl.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+namespace rstudio {
+namespace core {
+namespace file_search {
+
+namespace {
+
+// files containing a NUL within this many leading bytes are treated as
+// binary and skipped (as 'grep --binary-files=without-match')
+const std::size_t kBinaryCheckBytes = 8000;
+
+const std::size_t kMaxThreads = 8;
+
+char asciiToLower(char c)
+{
+   return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+char asciiToUpper(char c)
+{
+   return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+// count newlines eight bytes at a time
+std::size_t countNewlines(const char* begin, const char* end)
+{
+   const uint64_t kOnes = 0x0101010101010101ULL;
+   const uint64_t kLow7 = 0x7f7f7f7f7f7f7f7fULL;
+   const uint64_t kHigh = 0x8080808080808080ULL;
+
+   std::size_t count = 0;
+   const char* pos = begin;
+   for (; end - pos >= 8; pos += 8)
+   {
+      uint64_t word;
+      std::memcpy(&word, pos, sizeof(word));
+
+      // bytes equal to '\n' become zero; then set the high bit of each byte
+      // which is non-zero and sum those bits
+      uint64_t x = word ^ (kOnes * '\n');
+      uint64_t nonZero = (((x & kLow7) + kLow7) | x) & kHigh;
+      count += 8 - static_cast<std::size_t>(((nonZero >> 7) * kOnes) >> 56);
+   }
+
+   return count + std::count(pos, end, '\n');
+}
+
+// rough rarity of a character in source code and text, used to pick the
+// character of a literal which produces the fewest false hits when scanning
+int rarity(char c)
+{
+   unsigned char uc = static_cast<unsigned char>(c);
+   if (uc >= 0x80)
+      return 6;
+   if (c == ' ' || c == '\t')
+      return 0;
+   if (std::strchr("etaoinsrlcd", c))
+      return 1;
+   if (std::islower(uc))
+      return std::strchr("qjzxkvwy", c) ? 4 : 2;
+   if (std::strchr("(),.=_-\"'", c))
+      return 3;
+   return 5;
+}
+
+bool hasNonAscii(const std::string& str)
+{
+   for (char c : str)
+      if (static_cast<unsigned char>(c) >= 0x80)
+         return true;
+   return false;
+}
+
+bool globMatchImpl(const char* p, const char* pEnd,
+                   const char* s, const char* sEnd,
+                   bool pathname)
+{
+   while (p != pEnd)
+   {
+      char c = *p;
+      if (c == '*')
+      {
+         if (p + 1 != pEnd && p[1] == '*')
+         {
+            // '**' matches across directories; '**/' also matches no directory
+            p += 2;
+            if (p != pEnd && *p == '/' && globMatchImpl(p + 1, pEnd, s, sEnd, pathname))
+               return true;
+            for (const char* t = s; t <= sEnd; t++)
+               if (globMatchImpl(p, pEnd, t, sEnd, pathname))
+                  return true;
+            return false;
+         }
+
+         p++;
+         for (const char* t = s; ; t++)
+         {
+            if (globMatchImpl(p, pEnd, t, sEnd, pathname))
+               return true;
+            if (t == sEnd || (pathname && *t == '/'))
+               return false;
+         }
+      }
+
+      if (s == sEnd)
+         return false;
+
+      if (c == '?')
+      {
+         if (pathname && *s == '/')
+            return false;
+      }
+      else if (c == '[')
+      {
+         const char* q = p + 1;
+         bool negate = q != pEnd && (*q == '!' || *q == '^');
+         if (negate)
+            q++;
+
+         bool matched = false;
+         const char* classBegin = q;
+         while (q != pEnd && (*q != ']' || q == classBegin))
+         {
+            char lo = *q;
+            if (lo == '\\' && q + 1 != pEnd)
+               lo = *++q;
+            char hi = lo;
+            if (q + 2 < pEnd && q[1] == '-' && q[2] != ']')
+            {
+               hi = q[2];
+               q += 2;
+            }
+            if (*s >= lo && *s <= hi)
+               matched = true;
+            q++;
+         }
+
+         if (q == pEnd)
+         {
+            // unterminated class; treat '[' literally
+            if (*s != '[')
+               return false;
+         }
+         else
+         {
+            if (matched == negate || (pathname && *s == '/'))
+               return false;
+            p = q;
+         }
+      }
+      else
+      {
+         if (c == '\\' && p + 1 != pEnd)
+            c = *++p;
+         if (c != *s)
+            return false;
+      }
+
+      p++;
+      s++;
+   }
+
+   return s == sEnd;
+}
+
+// a glob from an include/exclude option or an ignore file
+struct PathPattern
+{
+   explicit PathPattern(const std::string& glob)
+      : glob(glob), negate(false), directoryOnly(false), anchored(false)
+   {
+   }
+
+   bool matches(const std::string& relativePath, bool isDirectory) const
+   {
+      if (directoryOnly && !isDirectory)
+         return false;
+
+      if (anchored)
+         return globMatch(glob, relativePath, true);
+
+      std::size_t slash = relativePath.find_last_of('/');
+      return globMatch(glob,
+                       slash == std::string::npos ? relativePath : relativePath.substr(slash + 1),
+                       true);
+   }
+
+   std::string glob;
+   bool negate;
+   bool directoryOnly;
+   bool anchored;
+};
+
+std::vector<PathPattern> optionPatterns(const std::vector<std::string>& globs)
+{
+   std::vector<PathPattern> patterns;
+   for (const std::string& glob : globs)
+   {
+      if (glob.empty())
+         continue;
+
+      PathPattern pattern(glob);
+      pattern.anchored = glob.find('/') != std::string::npos;
+      if (pattern.anchored && pattern.glob[0] == '/')
+         pattern.glob = pattern.glob.substr(1);
+      patterns.push_back(pattern);
+   }
+   return patterns;
+}
+
+bool matchesAny(const std::vector<PathPattern>& patterns,
+                const std::string& relativePath,
+                bool isDirectory)
+{
+   for (const PathPattern& pattern : patterns)
+      if (pattern.matches(relativePath, isDirectory))
+         return true;
+   return false;
+}
+
+// the patterns from one ignore file, chained to those of enclosing directories
+struct IgnoreRules
+{
+   boost::shared_ptr<const IgnoreRules> pParent;
+
+   // directory the patterns are relative to, with a trailing '/'
+   std::string base;
+
+   std::vector<PathPattern> patterns;
+};
+
+typedef boost::shared_ptr<const IgnoreRules> IgnoreRulesPtr;
+
+std::vector<PathPattern> parseIgnoreFile(const std::string& contents)
+{
+   std::vector<PathPattern> patterns;
+
+   std::size_t pos = 0;
+   while (pos < contents.size())
+   {
+      std::size_t eol = contents.find('\n', pos);
+      if (eol == std::string::npos)
+         eol = contents.size();
+      std::string line = contents.substr(pos, eol - pos);
+      pos = eol + 1;
+
+      // trailing whitespace is ignored unless escaped
+      while (!line.empty() &&
+             (line.back() == '\r' || line.back() == ' ' || line.back() == '\t') &&
+             !(line.size() > 1 && line[line.size() - 2] == '\\'))
+      {
+         line.pop_back();
+      }
+
+      if (line.empty() || line[0] == '#')
+         continue;
+
+      PathPattern pattern(line);
+      if (pattern.glob[0] == '!')
+      {
+         pattern.negate = true;
+         pattern.glob = pattern.glob.substr(1);
+      }
+      else if (pattern.glob[0] == '\\')
+      {
+         pattern.glob = pattern.glob.substr(1);
+      }
+
+      if (!pattern.glob.empty() && pattern.glob.back() == '/')
+      {
+         pattern.directoryOnly = true;
+         pattern.glob.pop_back();
+      }
+
+      // a slash anywhere but the end anchors the pattern to the directory
+      // containing the ignore file
+      pattern.anchored = pattern.glob.find('/') != std::string::npos;
+      if (!pattern.glob.empty() && pattern.glob[0] == '/')
+         pattern.glob = pattern.glob.substr(1);
+
+      if (!pattern.glob.empty())
+         patterns.push_back(pattern);
+   }
+
+   return patterns;
+}
+
+bool readTextFile(const std::string& path, std::string* pContents)
+{
+   std::ifstream ifs(path.c_str(), std::ios::in | std::ios::binary);
+   if (!ifs)
+      return false;
+
+   pContents->assign(std::istreambuf_iterator<char>(ifs),
+                     std::istreambuf_iterator<char>());
+   return true;
+}
+
+IgnoreRulesPtr loadIgnoreFile(const IgnoreRulesPtr& pParent,
+                              const std::string& base,
+                              const std::string& path)
+{
+   std::string contents;
+   if (!readTextFile(path, &contents))
+      return pParent;
+
+   boost::shared_ptr<IgnoreRules> pRules(new IgnoreRules());
+   pRules->pParent = pParent;
+   pRules->base = base;
+   pRules->patterns = parseIgnoreFile(contents);
+   if (pRules->patterns.empty())
+      return pParent;
+
+   return pRules;
+}
+
+bool isIgnored(const IgnoreRulesPtr& pRules, const std::string& path, bool isDirectory)
+{
+   // the last matching pattern wins, and patterns in deeper directories take
+   // precedence over those of their parents
+   for (const IgnoreRules* pLevel = pRules.get(); pLevel; pLevel = pLevel->pParent.get())
+   {
+      if (path.compare(0, pLevel->base.size(), pLevel->base) != 0)
+         continue;
+
+      std::string relativePath = path.substr(pLevel->base.size());
+      for (auto it = pLevel->patterns.rbegin(); it != pLevel->patterns.rend(); ++it)
+      {
+         if (it->matches(relativePath, isDirectory))
+            return !it->negate;
+      }
+   }
+
+   return false;
+}
+
+std::string withTrailingSlash(const std::string& path)
+{
+   if (!path.empty() && path.back() == '/')
+      return path;
+   return path + "/";
+}
+
+// ignore rules from the enclosing git repository (if any) which apply to
+// the given search root
+IgnoreRulesPtr ancestorIgnoreRules(const FilePath& root)
+{
+   std::vector<FilePath> ancestors;
+   FilePath repo;
+   for (FilePath dir = root; !dir.isEmpty(); dir = dir.getParent())
+   {
+      if (dir.completeChildPath(".git").exists())
+      {
+         repo = dir;
+         break;
+      }
+
+      ancestors.push_back(dir);
+      if (dir.getParent() == dir)
+         break;
+   }
+
+   if (repo.isEmpty())
+      return IgnoreRulesPtr();
+
+   std::string repoBase = withTrailingSlash(repo.getAbsolutePath());
+   IgnoreRulesPtr pRules = loadIgnoreFile(
+            IgnoreRulesPtr(),
+            repoBase,
+            repo.completeChildPath(".git/info/exclude").getAbsolutePath());
+
+   // .gitignore files from the repository root down to (but not including)
+   // the search root, which is handled as it's searched
+   if (repo != root)
+   {
+      pRules = loadIgnoreFile(pRules, repoBase, repoBase + ".gitignore");
+      for (auto it = ancestors.rbegin(); it != ancestors.rend(); ++it)
+      {
+         if (*it == root)
+            continue;
+         std::string base = withTrailingSlash(it->getAbsolutePath());
+         pRules = loadIgnoreFile(pRules, base, base + ".gitignore");
+      }
+   }
+
+   return pRules;
+}
+
+class Matcher
+{
+public:
+   Matcher()
+      : asRegex_(false), ignoreCase_(false), rareIndex_(0), rareLower_(0), rareUpper_(0)
+   {
+   }
+
+   Error initialize(const SearchOptions& options)
+   {
+      asRegex_ = options.asRegex;
+      ignoreCase_ = options.ignoreCase;
+
+      std::string pattern = options.pattern;
+      if (!asRegex_ && ignoreCase_ && hasNonAscii(pattern))
+      {
+         // case folding non-ASCII text is left to the regex engine
+         asRegex_ = true;
+         pattern = boost::regex_replace(pattern,
+                                        boost::regex("[.\\[\\]{}()\\\\*+?|^$]"),
+                                        "\\\\$&");
+      }
+
+      if (asRegex_)
+      {
+         try
+         {
+            boost::regex::flag_type flags = boost::regex::extended;
+            if (ignoreCase_)
+               flags |= boost::regex::icase;
+            regex_.assign(pattern, flags);
+         }
+         catch (const std::exception& e)
+         {
+            return systemError(boost::system::errc::invalid_argument,
+                               e.what(),
+                               ERROR_LOCATION);
+         }
+
+         literal_ = requiredLiteral(pattern);
+      }
+      else
+      {
+         literal_ = pattern;
+      }
+
+      if (ignoreCase_)
+      {
+         if (hasNonAscii(literal_))
+            literal_.clear();
+         std::transform(literal_.begin(), literal_.end(), literal_.begin(), asciiToLower);
+      }
+
+      // the character findLiteral scans for
+      rareIndex_ = 0;
+      for (std::size_t i = 1; i < literal_.size(); i++)
+         if (rarity(literal_[i]) > rarity(literal_[rareIndex_]))
+            rareIndex_ = i;
+      if (!literal_.empty())
+      {
+         rareLower_ = literal_[rareIndex_];
+         rareUpper_ = ignoreCase_ ? asciiToUpper(rareLower_) : rareLower_;
+      }
+
+      return Success();
+   }
+
+   void search(const char* begin, const char* end, std::vector<LineMatch>* pMatches) const
+   {
+      // nothing matches an empty literal pattern
+      if (!asRegex_ && literal_.empty())
+         return;
+
+      int lineNumber = 1;
+      const char* counted = begin;
+      const char* pos = begin;
+      while (pos < end)
+      {
+         // jump to the next line which contains the literal (every line is
+         // a candidate when a regex has no required literal)
+         const char* candidate = literal_.empty() ? pos : findLiteral(pos, end);
+         if (candidate == nullptr)
+            break;
+
+         const char* lineBegin = candidate;
+         while (lineBegin > pos && lineBegin[-1] != '\n')
+            lineBegin--;
+
+         const char* lineEnd = static_cast<const char*>(
+                  std::memchr(candidate, '\n', end - candidate));
+         if (lineEnd == nullptr)
+            lineEnd = end;
+
+         const char* contentEnd = lineEnd;
+         if (contentEnd > lineBegin && contentEnd[-1] == '\r')
+            contentEnd--;
+
+         LineMatch match;
+         matchLine(lineBegin, contentEnd, &match.ranges);
+         if (!match.ranges.empty())
+         {
+            lineNumber += static_cast<int>(countNewlines(counted, lineBegin));
+            counted = lineBegin;
+
+            match.line = lineNumber;
+            match.contents.assign(lineBegin, contentEnd);
+            pMatches->push_back(std::move(match));
+         }
+
+         pos = lineEnd + 1;
+      }
+   }
+
+private:
+   bool equalsLiteral(const char* pos) const
+   {
+      if (!ignoreCase_)
+         return std::memcmp(pos, literal_.data(), literal_.size()) == 0;
+
+      for (std::size_t i = 0; i < literal_.size(); i++)
+         if (asciiToLower(pos[i]) != literal_[i])
+            return false;
+      return true;
+   }
+
+   const char* findLiteral(const char* pos, const char* end) const
+   {
+      std::size_t size = literal_.size();
+      if (static_cast<std::size_t>(end - pos) < size)
+         return nullptr;
+
+      // scan for the literal's rarest character with memchr (once for each
+      // case when ignoring case) and verify the literal around each hit
+      const char* last = end - size;
+      const char* nextLower = pos + rareIndex_;
+      const char* nextUpper = rareLower_ == rareUpper_ ? nullptr : nextLower;
+      const char* scanEnd = last + rareIndex_ + 1;
+      while (true)
+      {
+         if (nextLower && nextLower < scanEnd && *nextLower != rareLower_)
+            nextLower = static_cast<const char*>(
+                     std::memchr(nextLower, rareLower_, scanEnd - nextLower));
+         if (nextUpper && nextUpper < scanEnd && *nextUpper != rareUpper_)
+            nextUpper = static_cast<const char*>(
+                     std::memchr(nextUpper, rareUpper_, scanEnd - nextUpper));
+         if (nextLower && nextLower >= scanEnd)
+            nextLower = nullptr;
+         if (nextUpper && nextUpper >= scanEnd)
+            nextUpper = nullptr;
+
+         const char* hit = nextLower;
+         if (hit == nullptr || (nextUpper && nextUpper < hit))
+            hit = nextUpper;
+         if (hit == nullptr)
+            return nullptr;
+
+         if (equalsLiteral(hit - rareIndex_))
+            return hit - rareIndex_;
+
+         if (hit == nextLower)
+            nextLower++;
+         else
+            nextUpper++;
+      }
+   }
+
+   void matchLine(const char* begin,
+                  const char* end,
+                  std::vector<std::pair<std::size_t, std::size_t> >* pRanges) const
+   {
+      if (!asRegex_)
+      {
+         const char* pos = begin;
+         while (const char* hit = findLiteral(pos, end))
+         {
+            pRanges->push_back(std::make_pair(hit - begin, hit - begin + literal_.size()));
+            pos = hit + literal_.size();
+         }
+         return;
+      }
+
+      boost::match_flag_type flags = boost::match_default;
+      boost::cmatch match;
+      const char* pos = begin;
+      while (pos <= end && boost::regex_search(pos, end, match, regex_, flags))
+      {
+         const char* matchBegin = match[0].first;
+         const char* matchEnd = match[0].second;
+         if (matchEnd > matchBegin)
+            pRanges->push_back(std::make_pair(matchBegin - begin, matchEnd - begin));
+
+         // step past empty matches so we always make progress
+         pos = matchEnd == matchBegin ? matchEnd + 1 : matchEnd;
+         flags |= boost::match_prev_avail | boost::match_not_bob;
+      }
+   }
+
+   bool asRegex_;
+   bool ignoreCase_;
+   boost::regex regex_;
+
+   // literal which must appear in matching lines (lower case when ignoring case)
+   std::string literal_;
+   std::size_t rareIndex_;
+   char rareLower_;
+   char rareUpper_;
+};
+
+// the contents of a file, read into memory (files are read rather than mapped
+// since a mapped file truncated while it is searched raises SIGBUS)
+class FileContents : boost::noncopyable
+{
+public:
+   // returns false if the file can't be read or isn't a regular file
+   bool open(const std::string& path)
+   {
+#ifndef _WIN32
+      int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd == -1)
+         return false;
+
+      bool success = false;
+      struct stat info;
+      if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode))
+      {
+         // a file which shrinks while being read yields its remaining
+         // contents; one which grows is read up to its size at open
+         std::size_t size = static_cast<std::size_t>(info.st_size);
+         buffer_.resize(size);
+         ssize_t bytesRead = 0;
+         std::size_t offset = 0;
+         while (offset < size &&
+                (bytesRead = ::pread(fd, &buffer_[offset], size - offset,
+                                     static_cast<off_t>(offset))) != 0)
+         {
+            if (bytesRead == -1)
+            {
+               if (errno == EINTR)
+                  continue;
+               break;
+            }
+            offset += static_cast<std::size_t>(bytesRead);
+         }
+         buffer_.resize(offset);
+         success = bytesRead != -1;
+      }
+
+      ::close(fd);
+      return success;
+#else
+      return readTextFile(path, &buffer_);
+#endif
+   }
+
+   const char* data() const { return buffer_.data(); }
+   std::size_t size() const { return buffer_.size(); }
+
+   bool isBinary() const
+   {
+      return std::memchr(buffer_.data(), '\0', std::min(buffer_.size(), kBinaryCheckBytes)) != nullptr;
+   }
+
+private:
+   std::string buffer_;
+};
+
+struct DirectoryEntry
+{
+   std::string name;
+   bool isDirectory;
+};
+
+// list the directories and regular files within a directory; symlinks
+// aren't followed (as 'grep -r') and other kinds of files are skipped
+void listDirectory(const std::string& path, std::vector<DirectoryEntry>* pEntries)
+{
+#ifndef _WIN32
+   // read the directory directly so that the entry type reported by readdir
+   // saves a stat call for each entry
+   DIR* pDir = ::opendir(path.c_str());
+   if (pDir == nullptr)
+      return;
+
+   while (struct dirent* pEntry = ::readdir(pDir))
+   {
+      const char* name = pEntry->d_name;
+      if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+         continue;
+
+      unsigned char type = pEntry->d_type;
+      if (type == DT_UNKNOWN)
+      {
+         struct stat info;
+         if (::lstat((path + "/" + name).c_str(), &info) != 0)
+            continue;
+         if (S_ISDIR(info.st_mode))
+            type = DT_DIR;
+         else if (S_ISREG(info.st_mode))
+            type = DT_REG;
+      }
+
+      if (type == DT_DIR || type == DT_REG)
+         pEntries->push_back(DirectoryEntry { name, type == DT_DIR });
+   }
+
+   ::closedir(pDir);
+#else
+   boost::system::error_code ec;
+   boost::filesystem::directory_iterator it(path, ec), end;
+   for (; !ec && it != end; it.increment(ec))
+   {
+      boost::system::error_code statusEc;
+      boost::filesystem::file_status status = it->symlink_status(statusEc);
+      if (statusEc || boost::filesystem::is_symlink(status))
+         continue;
+
+      bool isDirectory = boost::filesystem::is_directory(status);
+      if (isDirectory || boost::filesystem::is_regular_file(status))
+         pEntries->push_back(DirectoryEntry { it->path().filename().string(), isDirectory });
+   }
+#endif
+}
+
+struct SearchTask
+{
+   std::string path;
+   std::string relativePath;
+   bool isDirectory;
+   IgnoreRulesPtr pIgnoreRules;
+};
+
+// each worker owns a queue of tasks; it takes new work from the back of its
+// own queue (depth first, as directories are listed) and when that runs dry
+// steals from the front of the others' queues
+struct WorkerQueue
+{
+   boost::mutex mutex;
+   std::deque<SearchTask> tasks;
+};
+
+} // anonymous namespace
+
+std::string requiredLiteral(const std::string& pattern)
+{
+   std::string best;
+   std::string current;
+   auto flush = [&]()
+   {
+      if (current.size() > best.size())
+         best = current;
+      current.clear();
+   };
+
+   int depth = 0;
+   for (std::size_t i = 0; i < pattern.size(); i++)
+   {
+      char c = pattern[i];
+      bool literal = false;
+
+      if (c == '\\')
+      {
+         if (++i == pattern.size())
+            break;
+
+         // escaped punctuation is literal; escaped alphanumerics are
+         // character classes, anchors or back references
+         c = pattern[i];
+         literal = !std::isalnum(static_cast<unsigned char>(c)) && c != '<' && c != '>';
+      }
+      else if (c == '[')
+      {
+         // skip bracket expression (']' may appear first as a literal)
+         std::size_t j = i + 1;
+         if (j < pattern.size() && pattern[j] == '^')
+            j++;
+         if (j < pattern.size() && pattern[j] == ']')
+            j++;
+         while (j < pattern.size() && pattern[j] != ']')
+         {
+            if (pattern[j] == '[' && j + 1 < pattern.size() &&
+                (pattern[j + 1] == ':' || pattern[j + 1] == '.' || pattern[j + 1] == '='))
+            {
+               std::size_t close = pattern.find(std::string(1, pattern[j + 1]) + "]", j + 2);
+               j = close == std::string::npos ? pattern.size() : close + 1;
+            }
+            j++;
+         }
+         i = j;
+      }
+      else if (c == '(')
+      {
+         depth++;
+      }
+      else if (c == ')')
+      {
+         depth--;
+      }
+      else if (c == '|')
+      {
+         // any top-level alternation means no single literal is required
+         if (depth == 0)
+            return std::string();
+      }
+      else
+      {
+         literal = std::strchr(".^$*+?{}", c) == nullptr;
+      }
+
+      if (!literal || depth != 0)
+      {
+         flush();
+         continue;
+      }
+
+      // a quantifier which allows zero repetitions makes the character optional
+      char next = i + 1 < pattern.size() ? pattern[i + 1] : '\0';
+      if (next == '*' || next == '?' || next == '{')
+      {
+         flush();
+      }
+      else if (next == '+')
+      {
+         current += c;
+         flush();
+      }
+      else
+      {
+         current += c;
+      }
+   }
+
+   flush();
+   return best;
+}
+
+bool globMatch(const std::string& pattern, const std::string& text, bool pathname)
+{
+   return globMatchImpl(pattern.data(), pattern.data() + pattern.size(),
+                        text.data(), text.data() + text.size(),
+                        pathname);
+}
+
+Error searchBuffer(const std::string& buffer,
+                   const SearchOptions& options,
+                   std::vector<LineMatch>* pMatches)
+{
+   Matcher matcher;
+   Error error = matcher.initialize(options);
+   if (error)
+      return error;
+
+   matcher.search(buffer.data(), buffer.data() + buffer.size(), pMatches);
+   return Success();
+}
+
+struct FileSearch::Impl
+{
+   Impl() : pendingTasks(0), queuedTasks(0), activeWorkers(0), stopped(false)
+   {
+   }
+
+   void push(std::size_t worker, const SearchTask& task)
+   {
+      pendingTasks++;
+      WorkerQueue& queue = *queues[worker];
+      LOCK_MUTEX(queue.mutex)
+      {
+         queue.tasks.push_back(task);
+      }
+      END_LOCK_MUTEX
+
+      queuedTasks++;
+      notifyWorkers(false);
+   }
+
+   // wakes idle workers; taking the mutex orders this with their check for work
+   void notifyWorkers(bool all)
+   {
+      LOCK_MUTEX(idleMutex)
+      {
+         if (all)
+            workAvailable.notify_all();
+         else
+            workAvailable.notify_one();
+      }
+      END_LOCK_MUTEX
+   }
+
+   // waits until there may be work to take, or there is no work left anywhere
+   void waitForWork()
+   {
+      boost::unique_lock<boost::mutex> lock(idleMutex);
+      while (!stopped && pendingTasks != 0 && queuedTasks <= 0)
+         workAvailable.wait(lock);
+   }
+
+   bool pop(std::size_t worker, SearchTask* pTask)
+   {
+      for (std::size_t i = 0; i < queues.size(); i++)
+      {
+         bool own = i == 0;
+         WorkerQueue& queue = *queues[(worker + i) % queues.size()];
+         LOCK_MUTEX(queue.mutex)
+         {
+            if (!queue.tasks.empty())
+            {
+               if (own)
+               {
+                  *pTask = std::move(queue.tasks.back());
+                  queue.tasks.pop_back();
+               }
+               else
+               {
+                  *pTask = std::move(queue.tasks.front());
+                  queue.tasks.pop_front();
+               }
+               queuedTasks--;
+               return true;
+            }
+         }
+         END_LOCK_MUTEX
+      }
+      return false;
+   }
+
+   void run(std::size_t worker)
+   {
+      try
+      {
+         while (!stopped)
+         {
+            SearchTask task;
+            if (pop(worker, &task))
+            {
+               if (task.isDirectory)
+                  searchDirectory(worker, task);
+               else
+                  searchFile(task);
+
+               // decremented only after any child tasks were queued, so zero
+               // means there is no more work anywhere
+               if (--pendingTasks == 0)
+                  notifyWorkers(true);
+            }
+            else if (pendingTasks == 0)
+            {
+               break;
+            }
+            else
+            {
+               waitForWork();
+            }
+         }
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+
+      activeWorkers--;
+   }
+
+   bool shouldSkip(const std::string& path,
+                   const std::string& relativePath,
+                   bool isDirectory,
+                   const IgnoreRulesPtr& pIgnoreRules)
+   {
+      if (options.skipPath && options.skipPath(path, isDirectory))
+         return true;
+
+      if (pIgnoreRules && isIgnored(pIgnoreRules, path, isDirectory))
+         return true;
+
+      if (isDirectory)
+         return false;
+
+      if (!includePatterns.empty() && !matchesAny(includePatterns, relativePath, false))
+         return true;
+
+      return matchesAny(excludePatterns, relativePath, false);
+   }
+
+   void searchDirectory(std::size_t worker, const SearchTask& task)
+   {
+      IgnoreRulesPtr pIgnoreRules = task.pIgnoreRules;
+      std::string base = withTrailingSlash(task.path);
+      if (options.excludeGitIgnore)
+         pIgnoreRules = loadIgnoreFile(pIgnoreRules, base, base + ".gitignore");
+
+      std::vector<DirectoryEntry> entries;
+      listDirectory(task.path, &entries);
+      for (const DirectoryEntry& entry : entries)
+      {
+         if (stopped)
+            break;
+
+         if (entry.name == ".git")
+            continue;
+
+         SearchTask child;
+         child.path = base + entry.name;
+         child.relativePath = task.relativePath.empty() ?
+                  entry.name :
+                  task.relativePath + "/" + entry.name;
+         child.isDirectory = entry.isDirectory;
+         child.pIgnoreRules = pIgnoreRules;
+
+         if (!shouldSkip(child.path, child.relativePath, entry.isDirectory, pIgnoreRules))
+            push(worker, child);
+      }
+   }
+
+   void searchFile(const SearchTask& task)
+   {
+      FileContents contents;
+      if (!contents.open(task.path) || contents.size() == 0 || contents.isBinary())
+         return;
+
+      FileMatches fileMatches;
+      matcher.search(contents.data(), contents.data() + contents.size(), &fileMatches.lines);
+      if (fileMatches.lines.empty())
+         return;
+
+      fileMatches.file = FilePath(task.path);
+      LOCK_MUTEX(resultsMutex)
+      {
+         results.push_back(std::move(fileMatches));
+      }
+      END_LOCK_MUTEX
+   }
+
+   SearchOptions options;
+   Matcher matcher;
+   std::vector<PathPattern> includePatterns;
+   std::vector<PathPattern> excludePatterns;
+
+   std::vector<boost::shared_ptr<WorkerQueue> > queues;
+   boost::thread_group threads;
+   std::atomic<long> pendingTasks;
+   std::atomic<long> queuedTasks;
+   std::atomic<long> activeWorkers;
+   std::atomic<bool> stopped;
+
+   boost::mutex idleMutex;
+   boost::condition_variable workAvailable;
+
+   boost::mutex resultsMutex;
+   std::vector<FileMatches> results;
+};
+
+FileSearch::FileSearch()
+   : pImpl_(new Impl())
+{
+}
+
+FileSearch::~FileSearch()
+{
+   try
+   {
+      stop();
+   }
+   CATCH_UNEXPECTED_EXCEPTION
+}
+
+Error FileSearch::start(const std::vector<FilePath>& roots, const SearchOptions& options)
+{
+   Impl& impl = *pImpl_;
+   impl.options = options;
+   impl.includePatterns = optionPatterns(options.includePatterns);
+   impl.excludePatterns = optionPatterns(options.excludePatterns);
+
+   Error error = impl.matcher.initialize(options);
+   if (error)
+      return error;
+
+   std::size_t threadCount = options.maxThreads;
+   if (threadCount == 0)
+      threadCount = std::min<std::size_t>(
+               std::max(boost::thread::hardware_concurrency(), 1U),
+               kMaxThreads);
+
+   for (std::size_t i = 0; i < threadCount; i++)
+      impl.queues.push_back(boost::make_shared<WorkerQueue>());
+
+   // seed the queues with the search roots
+   for (std::size_t i = 0; i < roots.size(); i++)
+   {
+      SearchTask task;
+      task.path = roots[i].getAbsolutePath();
+      task.isDirectory = true;
+      if (options.excludeGitIgnore)
+         task.pIgnoreRules = ancestorIgnoreRules(roots[i]);
+      impl.push(i % threadCount, task);
+   }
+
+   try
+   {
+      impl.activeWorkers = static_cast<long>(threadCount);
+      for (std::size_t i = 0; i < threadCount; i++)
+         impl.threads.create_thread(boost::bind(&Impl::run, pImpl_.get(), i));
+   }
+   catch (const boost::thread_resource_error& e)
+   {
+      stop();
+      return Error(boost::thread_error::ec_from_exception(e), ERROR_LOCATION);
+   }
+
+   return Success();
+}
+
+void FileSearch::takeResults(std::vector<FileMatches>* pResults)
+{
+   LOCK_MUTEX(pImpl_->resultsMutex)
+   {
+      if (pResults->empty())
+         pResults->swap(pImpl_->results);
+      else
+         std::move(pImpl_->results.begin(), pImpl_->results.end(), std::back_inserter(*pResults));
+      pImpl_->results.clear();
+   }
+   END_LOCK_MUTEX
+}
+
+bool FileSearch::isComplete() const
+{
+   return pImpl_->activeWorkers == 0;
+}
+
+void FileSearch::stop()
+{
+   pImpl_->stopped = true;
+   pImpl_->notifyWorkers(true);
+   pImpl_->threads.join_all();
+   pImpl_->activeWorkers = 0;
+}
+
+} // namespace file_search
+} // namespace core
+} // namespace rstudio
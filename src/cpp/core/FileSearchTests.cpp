@@ -0,0 +1,259 @@
+/*
+ * FileSearchTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <tests/TestThat.hpp>
+
+#include <set>
+
+#include <boost/lexical_cast.hpp>
+
+#include <core/BoostThread.hpp>
+#include <core/FileSearch.hpp>
+#include <core/FileSerializer.hpp>
+
+#ifndef _WIN32
+# include <unistd.h>
+#endif
+
+namespace rstudio {
+namespace core {
+namespace file_search {
+namespace tests {
+
+namespace {
+
+typedef std::pair<std::size_t, std::size_t> Range;
+
+std::vector<LineMatch> search(const std::string& buffer,
+                              const std::string& pattern,
+                              bool asRegex = false,
+                              bool ignoreCase = false)
+{
+   SearchOptions options;
+   options.pattern = pattern;
+   options.asRegex = asRegex;
+   options.ignoreCase = ignoreCase;
+
+   std::vector<LineMatch> matches;
+   REQUIRE_FALSE(searchBuffer(buffer, options, &matches));
+   return matches;
+}
+
+// run a search to completion, returning the matching files relative to root
+std::set<std::string> searchFiles(const FilePath& root, const SearchOptions& options)
+{
+   FileSearch search;
+   REQUIRE_FALSE(search.start(std::vector<FilePath>(1, root), options));
+
+   std::vector<FileMatches> results;
+   while (!search.isComplete())
+      boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+   search.takeResults(&results);
+
+   std::set<std::string> files;
+   for (const FileMatches& result : results)
+      files.insert(result.file.getRelativePath(root));
+   return files;
+}
+
+void writeFile(const FilePath& root, const std::string& path, const std::string& contents)
+{
+   FilePath filePath = root.completeChildPath(path);
+   REQUIRE_FALSE(filePath.getParent().ensureDirectory());
+   REQUIRE_FALSE(writeStringToFile(filePath, contents));
+}
+
+} // anonymous namespace
+
+test_context("File search")
+{
+   test_that("Literal matches report line numbers and byte ranges")
+   {
+      std::vector<LineMatch> matches = search("one\ntwo foo\nthree\nfoo foo\r\n", "foo");
+      REQUIRE(matches.size() == 2);
+
+      expect_true(matches[0].line == 2);
+      expect_true(matches[0].contents == "two foo");
+      expect_true(matches[0].ranges == std::vector<Range>({ Range(4, 7) }));
+
+      expect_true(matches[1].line == 4);
+      expect_true(matches[1].contents == "foo foo");
+      expect_true(matches[1].ranges == std::vector<Range>({ Range(0, 3), Range(4, 7) }));
+   }
+
+   test_that("Case can be ignored")
+   {
+      std::vector<LineMatch> matches = search("FOO\nfoo\nfOo\nbar\n", "Foo", false, true);
+      expect_true(matches.size() == 3);
+      expect_true(search("FOO\nfoo\n", "Foo").empty());
+   }
+
+   test_that("Regular expressions are matched within lines")
+   {
+      std::vector<LineMatch> matches = search("x <- 1\ny<-22\nz = 3\n", "[a-z] ?<- ?[0-9]+", true);
+      REQUIRE(matches.size() == 2);
+      expect_true(matches[0].ranges == std::vector<Range>({ Range(0, 6) }));
+      expect_true(matches[1].line == 2);
+      expect_true(matches[1].ranges == std::vector<Range>({ Range(0, 5) }));
+
+      // anchors apply to each line
+      expect_true(search("foo\n bar\nbar\n", "^bar", true).size() == 1);
+
+      // whole word searches, as generated for the find in files pane
+      matches = search("foobar\nfoo bar\n", "(\\b|^)foo(\\b|$)", true);
+      REQUIRE(matches.size() == 1);
+      expect_true(matches[0].line == 2);
+   }
+
+   test_that("Invalid regular expressions are reported")
+   {
+      SearchOptions options;
+      options.pattern = "(unclosed";
+      options.asRegex = true;
+
+      std::vector<LineMatch> matches;
+      expect_true(searchBuffer("text", options, &matches));
+   }
+
+   test_that("Globs match like .gitignore patterns")
+   {
+      expect_true(globMatch("*.R", "foo.R"));
+      expect_false(globMatch("*.R", "dir/foo.R"));
+      expect_true(globMatch("**/foo.R", "a/b/foo.R"));
+      expect_true(globMatch("**/foo.R", "foo.R"));
+      expect_true(globMatch("a/**/b", "a/x/y/b"));
+      expect_true(globMatch("file[0-9].txt", "file3.txt"));
+      expect_false(globMatch("file[!0-9].txt", "file3.txt"));
+      expect_true(globMatch("?.md", "a.md"));
+   }
+
+   test_that("Directory trees are searched honoring patterns and ignore files")
+   {
+      FilePath root;
+      REQUIRE_FALSE(FilePath::tempFilePath(root));
+      REQUIRE_FALSE(root.ensureDirectory());
+      REQUIRE_FALSE(root.completeChildPath(".git").ensureDirectory());
+
+      writeFile(root, ".gitignore", "build/\n*.log\n!keep.log\n");
+      writeFile(root, "R/a.R", "needle <- 1\n");
+      writeFile(root, "R/b.R", "haystack\n");
+      writeFile(root, "R/deep/c.R", "a needle\n");
+      writeFile(root, "R/deep/.gitignore", "c.R\n");
+      writeFile(root, "build/d.R", "needle\n");
+      writeFile(root, "e.log", "needle\n");
+      writeFile(root, "keep.log", "needle\n");
+      writeFile(root, "f.bin", std::string("needle\0", 7));
+
+      SearchOptions options;
+      options.pattern = "needle";
+
+      std::set<std::string> all = searchFiles(root, options);
+      expect_true(all == std::set<std::string>({
+         "R/a.R", "R/deep/c.R", "build/d.R", "e.log", "keep.log" }));
+
+      options.excludeGitIgnore = true;
+      expect_true(searchFiles(root, options) ==
+                  std::set<std::string>({ "R/a.R", "keep.log" }));
+
+      options.excludeGitIgnore = false;
+      options.includePatterns = { "*.R" };
+      options.excludePatterns = { "R/deep/*" };
+      expect_true(searchFiles(root, options) ==
+                  std::set<std::string>({ "R/a.R", "build/d.R" }));
+
+      options.includePatterns.clear();
+      options.excludePatterns.clear();
+      options.skipPath = [](const std::string& path, bool isDirectory)
+      {
+         return isDirectory && path.find("/build") != std::string::npos;
+      };
+      expect_true(searchFiles(root, options).count("build/d.R") == 0);
+
+      root.remove();
+   }
+
+#ifndef _WIN32
+   test_that("Files truncated while being searched are handled")
+   {
+      FilePath root;
+      REQUIRE_FALSE(FilePath::tempFilePath(root));
+      REQUIRE_FALSE(root.ensureDirectory());
+
+      std::string contents(256 * 1024, 'x');
+      contents += "\nneedle\n";
+      for (int i = 0; i < 50; i++)
+         writeFile(root, "file" + boost::lexical_cast<std::string>(i) + ".R", contents);
+
+      SearchOptions options;
+      options.pattern = "needle";
+      expect_true(searchFiles(root, options).size() == 50);
+
+      // truncating files part way through must not crash the search
+      boost::thread truncator([&]()
+      {
+         for (int i = 0; i < 50; i++)
+         {
+            std::string path = root.completeChildPath(
+                     "file" + boost::lexical_cast<std::string>(i) + ".R").getAbsolutePath();
+            ::truncate(path.c_str(), 1024);
+         }
+      });
+      std::set<std::string> files = searchFiles(root, options);
+      truncator.join();
+      expect_true(files.size() <= 50);
+
+      expect_true(searchFiles(root, options).empty());
+
+      root.remove();
+   }
+#endif
+}
+
+benchmark_context("File search throughput")
+{
+   FilePath root;
+   REQUIRE_FALSE(FilePath::tempFilePath(root));
+   REQUIRE_FALSE(root.ensureDirectory());
+
+   std::string contents;
+   for (int i = 0; i < 2000; i++)
+      contents += "x <- some_function(argument_" + boost::lexical_cast<std::string>(i) + ")\n";
+   for (int i = 0; i < 500; i++)
+      writeFile(root, "dir" + boost::lexical_cast<std::string>(i % 20) + "/file" +
+                boost::lexical_cast<std::string>(i) + ".R", contents);
+
+   SearchOptions options;
+   options.pattern = "argument_1999";
+
+   benchmark_that("Literal search of 500 files")
+   {
+      return searchFiles(root, options).size();
+   };
+
+   options.pattern = "argument_19+9\\)";
+   options.asRegex = true;
+
+   benchmark_that("Regex search of 500 files")
+   {
+      return searchFiles(root, options).size();
+   };
+
+   root.remove();
+}
+
+} // namespace tests
+} // namespace file_search
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,275 @@
+/*
+ * FuzzyMatcher.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/FuzzyMatcher.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include <core/BoostThread.hpp>
+
+namespace rstudio {
+namespace core {
+
+namespace {
+
+// candidates are handed out to threads in batches of this size
+const std::size_t kBatchSize = 4096;
+
+// inputs smaller than this are scored on the calling thread alone
+const std::size_t kMinParallelSize = 4 * kBatchSize;
+
+const std::size_t kMaxThreads = 8;
+
+typedef std::pair<int, int> IndexScore;
+
+// orders (index, score) pairs best first
+inline bool isBetter(const IndexScore& lhs, const IndexScore& rhs)
+{
+   return lhs.second < rhs.second ||
+          (lhs.second == rhs.second && lhs.first < rhs.first);
+}
+
+// bounded max-heap of the best k matches seen
+class BestMatches
+{
+public:
+   // k must be positive
+   explicit BestMatches(std::size_t k)
+      : k_(k)
+   {
+      heap_.reserve(k);
+   }
+
+   // score a candidate must beat to be kept
+   int limit() const
+   {
+      return heap_.size() < k_ ? INT_MAX : heap_.front().second;
+   }
+
+   void add(int index, int score)
+   {
+      IndexScore match(index, score);
+      if (heap_.size() < k_)
+      {
+         heap_.push_back(match);
+         std::push_heap(heap_.begin(), heap_.end(), isBetter);
+      }
+      else if (isBetter(match, heap_.front()))
+      {
+         std::pop_heap(heap_.begin(), heap_.end(), isBetter);
+         heap_.back() = match;
+         std::push_heap(heap_.begin(), heap_.end(), isBetter);
+      }
+   }
+
+   const std::vector<IndexScore>& matches() const { return heap_; }
+
+private:
+   std::size_t k_;
+   std::vector<IndexScore> heap_;
+};
+
+bool isUninterestingFile(const char* filename, std::size_t size)
+{
+   static const char* const kGeneratedFiles[] = {
+      "RcppExports.R",
+      "RcppExports.cpp",
+      "cpp11.R",
+      "cpp11.cpp",
+      "arrowExports.R",
+      "arrowExports.cpp"
+   };
+
+   for (const char* generated : kGeneratedFiles)
+   {
+      if (std::strlen(generated) == size && std::memcmp(generated, filename, size) == 0)
+         return true;
+   }
+
+   // .Rd files (in any case)
+   return size >= 3 &&
+          filename[size - 3] == '.' &&
+          (filename[size - 2] | 0x20) == 'r' &&
+          (filename[size - 1] | 0x20) == 'd';
+}
+
+void scoreBatches(const std::vector<std::string>& candidates,
+                  const FuzzyMatcher& matcher,
+                  std::atomic<std::size_t>* pNextBatch,
+                  std::atomic<bool>* pCancelled,
+                  const boost::function<bool()>& isCancelled,
+                  BestMatches* pBest)
+{
+   while (!*pCancelled)
+   {
+      if (isCancelled && isCancelled())
+      {
+         *pCancelled = true;
+         break;
+      }
+
+      std::size_t begin = (*pNextBatch)++ * kBatchSize;
+      if (begin >= candidates.size())
+         break;
+
+      std::size_t end = std::min(begin + kBatchSize, candidates.size());
+      for (std::size_t i = begin; i < end; i++)
+      {
+         // batches are taken in order, so a candidate that only ties the
+         // worst match kept would lose on index
+         int limit = pBest->limit();
+         int score = matcher.score(candidates[i], limit);
+         if (score < limit)
+            pBest->add(static_cast<int>(i), score);
+      }
+   }
+}
+
+} // anonymous namespace
+
+FuzzyMatcher::FuzzyMatcher(const std::string& query, bool isFile)
+   : query_(query), isFile_(isFile)
+{
+}
+
+int FuzzyMatcher::score(const char* candidate, std::size_t size, int limit) const
+{
+   // No penalty for perfect matches
+   if (size == query_.size() && std::memcmp(candidate, query_.data(), size) == 0)
+      return 0;
+
+   int querySize = static_cast<int>(query_.size());
+   int totalPenalty = 0;
+   int matched = 0;
+   int unmatched = 0;
+   std::size_t searchFrom = 0;
+
+   for (char ch : query_)
+   {
+      const void* found = searchFrom < size ?
+               std::memchr(candidate + searchFrom, ch, size - searchFrom) :
+               nullptr;
+
+      if (found == nullptr)
+      {
+         // each unmatched character costs querySize; matches after the
+         // first can't reduce the total, so give up once we can't win
+         unmatched++;
+         if (totalPenalty + unmatched * querySize + isFile_ - 1 >= limit)
+            return INT_MAX;
+         continue;
+      }
+
+      std::size_t matchPos = static_cast<const char*>(found) - candidate;
+      int penalty = static_cast<int>(matchPos);
+
+      // Less penalty if character follows special delim
+      if (matchPos >= 1)
+      {
+         char prevChar = candidate[matchPos - 1];
+         if (prevChar == '_' || prevChar == '-' || (!isFile_ && prevChar == '.'))
+         {
+            penalty = matched + 1;
+         }
+      }
+
+      // Less penalty for perfect match (ie, reward case-sensitive match)
+      penalty -= candidate[matchPos] == query_[matched];
+
+      totalPenalty += penalty;
+      matched++;
+      searchFrom = matchPos + 1;
+   }
+
+   // Penalize files
+   if (isFile_)
+   {
+      ++totalPenalty;
+
+      // More penalty for 'uninteresting' files
+      if (isUninterestingFile(candidate, size))
+         totalPenalty += 6;
+   }
+
+   // Penalize unmatched characters
+   totalPenalty += unmatched * querySize;
+
+   return totalPenalty;
+}
+
+bool isUninterestingFile(const std::string& filename)
+{
+   return isUninterestingFile(filename.data(), filename.size());
+}
+
+bool findBestMatches(const std::vector<std::string>& candidates,
+                     const std::string& query,
+                     bool isFile,
+                     std::size_t k,
+                     std::vector<std::pair<int, int> >* pMatches,
+                     const boost::function<bool()>& isCancelled)
+{
+   pMatches->clear();
+   if (k == 0)
+      return true;
+
+   FuzzyMatcher matcher(query, isFile);
+   std::atomic<std::size_t> nextBatch(0);
+   std::atomic<bool> cancelled(false);
+
+   std::size_t threadCount = 1;
+   if (candidates.size() >= kMinParallelSize)
+   {
+      std::size_t batches = (candidates.size() + kBatchSize - 1) / kBatchSize;
+      threadCount = std::min(std::min<std::size_t>(boost::thread::hardware_concurrency(), kMaxThreads),
+                             batches);
+      threadCount = std::max<std::size_t>(threadCount, 1);
+   }
+
+   // each thread keeps its own best matches; the calling thread takes part
+   // too (and is the only one to check for cancellation)
+   std::vector<BestMatches> best(threadCount, BestMatches(k));
+   boost::thread_group threads;
+   for (std::size_t i = 1; i < threadCount; i++)
+   {
+      threads.create_thread(boost::bind(scoreBatches,
+                                        boost::cref(candidates),
+                                        boost::cref(matcher),
+                                        &nextBatch,
+                                        &cancelled,
+                                        boost::function<bool()>(),
+                                        &best[i]));
+   }
+
+   scoreBatches(candidates, matcher, &nextBatch, &cancelled, isCancelled, &best[0]);
+   threads.join_all();
+
+   if (cancelled)
+      return false;
+
+   for (const BestMatches& matches : best)
+      pMatches->insert(pMatches->end(), matches.matches().begin(), matches.matches().end());
+
+   std::sort(pMatches->begin(), pMatches->end(), isBetter);
+   if (pMatches->size() > k)
+      pMatches->resize(k);
+
+   return true;
+}
+
+} // namespace core
+} // namespace rstudio
@@ -0,0 +1,139 @@
+/*
+ * FuzzyMatcherTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <tests/TestThat.hpp>
+
+#include <algorithm>
+
+#include <boost/lexical_cast.hpp>
+
+#include <core/FuzzyMatcher.hpp>
+
+namespace rstudio {
+namespace core {
+namespace tests {
+
+namespace {
+
+std::vector<std::string> corpus(std::size_t size)
+{
+   static const char* const kDirs[] = { "R", "src", "tests/testthat", "inst/include", "man" };
+   static const char* const kStems[] = { "read_csv", "parse-args", "utils", "plot.data", "RcppExports" };
+   static const char* const kExts[] = { ".R", ".cpp", ".h", ".Rd", ".md" };
+
+   std::vector<std::string> paths;
+   paths.reserve(size);
+   for (std::size_t i = 0; i < size; i++)
+   {
+      paths.push_back(std::string(kDirs[i % 5]) + "/" + kStems[(i / 5) % 5] +
+                      boost::lexical_cast<std::string>(i) + kExts[(i / 25) % 5]);
+   }
+   return paths;
+}
+
+} // anonymous namespace
+
+test_context("Fuzzy matcher")
+{
+   test_that("Candidates are scored as before")
+   {
+      FuzzyMatcher symbols("rc", false);
+      expect_true(symbols.score("rc") == 0);
+      expect_true(symbols.score("read_csv") == -1 + 1);
+      expect_true(symbols.score("read.csv") == -1 + 1);
+      expect_true(symbols.score("readcsv") == -1 + 3);
+      expect_true(symbols.score("rC") == -1 + 2);
+      expect_true(symbols.score("xyz") == 2 * 2);
+
+      // '.' is only a delimiter for symbols
+      FuzzyMatcher files("rc", true);
+      expect_true(files.score("read.csv") == -1 + 4 + 1);
+      expect_true(files.score("read_csv") == -1 + 1 + 1);
+
+      // generated files and docs rank lower
+      expect_true(files.score("RcppExports.cpp") > files.score("rcpp.cpp"));
+      expect_true(isUninterestingFile("cpp11.R"));
+      expect_true(isUninterestingFile("foo.Rd"));
+      expect_true(isUninterestingFile("foo.rd"));
+      expect_false(isUninterestingFile("foo.Rd.R"));
+      expect_false(isUninterestingFile("foo.R"));
+   }
+
+   test_that("Scoring stops once the limit can't be beaten")
+   {
+      FuzzyMatcher matcher("abcd", false);
+      int score = matcher.score("xaxbxc");
+      expect_true(matcher.score("xaxbxc", score + 1) == score);
+      expect_true(matcher.score("xaxbxc", score) >= score);
+      expect_true(matcher.score("zzzz", 1) == INT_MAX);
+   }
+
+   test_that("The best matches are found in order")
+   {
+      std::vector<std::string> candidates = corpus(50000);
+      FuzzyMatcher matcher("utils12", true);
+
+      std::vector<std::pair<int, int> > expected;
+      for (std::size_t i = 0; i < candidates.size(); i++)
+         expected.push_back(std::make_pair(static_cast<int>(i), matcher.score(candidates[i])));
+      std::stable_sort(expected.begin(), expected.end(),
+                       [](const std::pair<int, int>& lhs, const std::pair<int, int>& rhs)
+      {
+         return lhs.second < rhs.second;
+      });
+      expected.resize(20);
+
+      std::vector<std::pair<int, int> > matches;
+      expect_true(findBestMatches(candidates, "utils12", true, 20, &matches));
+      expect_true(matches == expected);
+
+      expect_true(findBestMatches(candidates, "utils12", true, 0, &matches));
+      expect_true(matches.empty());
+   }
+
+   test_that("Searches can be cancelled")
+   {
+      std::vector<std::string> candidates = corpus(50000);
+      std::vector<std::pair<int, int> > matches;
+      expect_false(findBestMatches(candidates, "utils", true, 20, &matches,
+                                   []() { return true; }));
+      expect_true(matches.empty());
+   }
+}
+
+benchmark_context("Fuzzy matcher throughput")
+{
+   std::vector<std::string> candidates = corpus(500000);
+
+   benchmark_that("Top 20 of 500000 paths")
+   {
+      std::vector<std::pair<int, int> > matches;
+      findBestMatches(candidates, "readcsv", true, 20, &matches);
+      return matches.size();
+   };
+
+   benchmark_that("Score 500000 paths")
+   {
+      FuzzyMatcher matcher("readcsv", true);
+      int total = 0;
+      for (const std::string& candidate : candidates)
+         total += matcher.score(candidate) != 0;
+      return total;
+   };
+}
+
+} // namespace tests
+} // namespace core
+} // namespace rstudio
@@ -15,6 +15,12 @@
 
 #include <limits>
 #include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
 
 #include <core/GitGraph.hpp>
 
@@ -157,6 +163,182 @@ Line GitGraph::addCommit(const std::string& commit,
    return result;
 }
 
+CommitGraph::CommitGraph()
+   : idLength_(0),
+     parentOffsets_(1, 0)
+{
+}
+
+void CommitGraph::assign(const std::vector<std::string>& revList)
+{
+   build(revList, false);
+}
+
+void CommitGraph::prepend(const std::vector<std::string>& revList)
+{
+   build(revList, true);
+}
+
+std::string CommitGraph::commit(std::size_t index) const
+{
+   return ids_.substr(index * idLength_, idLength_);
+}
+
+std::vector<std::string> CommitGraph::parents(std::size_t index) const
+{
+   std::vector<std::string> parents;
+   for (uint32_t i = parentOffsets_[index]; i < parentOffsets_[index + 1]; i++)
+      parents.push_back(commit(parents_[i]));
+   return parents;
+}
+
+std::string CommitGraph::line(std::size_t index)
+{
+   if (!pLayout_)
+      pLayout_.reset(new GitGraph());
+
+   while (lines_.size() <= index && lines_.size() < size())
+   {
+      std::size_t next = lines_.size();
+      lines_.push_back(pLayout_->addCommit(commit(next), parents(next)).string());
+   }
+
+   return index < lines_.size() ? lines_[index] : std::string();
+}
+
+void CommitGraph::write(std::ostream& os) const
+{
+   for (std::size_t i = 0; i < size(); i++)
+   {
+      os << commit(i);
+      for (uint32_t j = parentOffsets_[i]; j < parentOffsets_[i + 1]; j++)
+         os << ' ' << parents_[j];
+      os << '\n';
+   }
+}
+
+bool CommitGraph::read(std::istream& is)
+{
+   idLength_ = 0;
+   ids_.clear();
+   parentOffsets_.assign(1, 0);
+   parents_.clear();
+   resetLayout();
+
+   std::string line;
+   while (std::getline(is, line))
+   {
+      std::istringstream fields(line);
+      std::string id;
+      fields >> id;
+      if (idLength_ == 0)
+         idLength_ = id.size();
+      if (id.empty() || id.size() != idLength_)
+         break;
+      ids_.append(id);
+
+      // parents always follow their children
+      bool valid = true;
+      uint32_t parent;
+      while (valid && fields >> parent)
+      {
+         valid = parent > size();
+         parents_.push_back(parent);
+      }
+      if (!valid || !fields.eof())
+         break;
+
+      parentOffsets_.push_back(static_cast<uint32_t>(parents_.size()));
+   }
+
+   // verify that every line was read, and that every parent is a commit
+   bool valid = is.eof() &&
+      std::all_of(parents_.begin(), parents_.end(),
+                  [&](uint32_t parent) { return parent < size(); });
+   if (!valid)
+   {
+      idLength_ = 0;
+      ids_.clear();
+      parentOffsets_.assign(1, 0);
+      parents_.clear();
+   }
+   return valid;
+}
+
+void CommitGraph::build(const std::vector<std::string>& revList, bool prepend)
+{
+   // parse the commits and their parents
+   std::string ids;
+   std::vector<std::vector<std::string> > parentIds;
+   std::size_t idLength = prepend ? idLength_ : 0;
+   for (const std::string& line : revList)
+   {
+      std::vector<std::string> fields;
+      boost::algorithm::split(fields, line, boost::algorithm::is_any_of(" "),
+                              boost::algorithm::token_compress_on);
+      fields.erase(std::remove(fields.begin(), fields.end(), std::string()),
+                   fields.end());
+      if (fields.empty())
+         continue;
+
+      if (idLength == 0)
+         idLength = fields.front().size();
+      if (fields.front().size() != idLength)
+         continue;
+
+      ids.append(fields.front());
+      parentIds.push_back(std::vector<std::string>(fields.begin() + 1, fields.end()));
+   }
+
+   std::size_t added = parentIds.size();
+   std::size_t existing = prepend ? size() : 0;
+
+   std::vector<uint32_t> parentOffsets(1, 0);
+   std::vector<uint32_t> parents;
+   parentOffsets.reserve(added + existing + 1);
+
+   // index the commits (new and existing) to resolve the new commits'
+   // parents; parents which aren't in the history (e.g. beyond the
+   // boundary of a shallow clone) are dropped
+   if (prepend)
+      ids.append(ids_);
+   std::unordered_map<std::string, uint32_t> indexes;
+   indexes.reserve(added + existing);
+   for (std::size_t i = 0; i < added + existing; i++)
+      indexes[ids.substr(i * idLength, idLength)] = static_cast<uint32_t>(i);
+
+   for (const std::vector<std::string>& commitParents : parentIds)
+   {
+      for (const std::string& parent : commitParents)
+      {
+         std::unordered_map<std::string, uint32_t>::const_iterator it = indexes.find(parent);
+         if (it != indexes.end())
+            parents.push_back(it->second);
+      }
+      parentOffsets.push_back(static_cast<uint32_t>(parents.size()));
+   }
+
+   // the existing commits move down by the number added
+   for (std::size_t i = 0; i < existing; i++)
+   {
+      for (uint32_t j = parentOffsets_[i]; j < parentOffsets_[i + 1]; j++)
+         parents.push_back(static_cast<uint32_t>(parents_[j] + added));
+      parentOffsets.push_back(static_cast<uint32_t>(parents.size()));
+   }
+
+   idLength_ = idLength;
+   ids_.swap(ids);
+   parentOffsets_.swap(parentOffsets);
+   parents_.swap(parents);
+   resetLayout();
+}
+
+void CommitGraph::resetLayout()
+{
+   pLayout_.reset();
+   lines_.clear();
+}
+
 } // namespace gitgraph
 } // namespace core
 } // namespace rstudio
@@ -0,0 +1,184 @@
+/*
+ * GitGraphTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/GitGraph.hpp>
+
+#include <sstream>
+
+#include <boost/format.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace gitgraph {
+namespace tests {
+
+namespace {
+
+std::string commitId(std::size_t index)
+{
+   return boost::str(boost::format("%040x") % (index + 1));
+}
+
+// 'git rev-list --parents' output for a history of the given number of
+// commits, newest first: each commit's parent is the next commit, and every
+// seventh commit also merges a branch from three commits back
+std::vector<std::string> revList(std::size_t count, std::size_t first = 0)
+{
+   std::vector<std::string> lines;
+   for (std::size_t i = first; i < first + count; i++)
+   {
+      std::string line = commitId(i);
+      if (i + 1 < first + count)
+         line += " " + commitId(i + 1);
+      if (i % 7 == 0 && i + 3 < first + count)
+         line += " " + commitId(i + 3);
+      lines.push_back(line);
+   }
+   return lines;
+}
+
+std::vector<std::string> layOut(const std::vector<std::string>& revList)
+{
+   GitGraph graph;
+   std::vector<std::string> lines;
+   for (const std::string& revListLine : revList)
+   {
+      std::istringstream fields(revListLine);
+      std::string commit, parent;
+      fields >> commit;
+      std::vector<std::string> parents;
+      while (fields >> parent)
+         parents.push_back(parent);
+      lines.push_back(graph.addCommit(commit, parents).string());
+   }
+   return lines;
+}
+
+std::vector<std::string> lines(CommitGraph* pGraph)
+{
+   std::vector<std::string> lines;
+   for (std::size_t i = 0; i < pGraph->size(); i++)
+      lines.push_back(pGraph->line(i));
+   return lines;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Commit graph")
+{
+   std::vector<std::string> history = revList(100);
+
+   SECTION("Holds the commits and lays out their graph")
+   {
+      CommitGraph graph;
+      graph.assign(history);
+      REQUIRE(graph.size() == 100);
+      REQUIRE(graph.commit(0) == commitId(0));
+      REQUIRE(graph.parents(0) == std::vector<std::string>({ commitId(1), commitId(3) }));
+      REQUIRE(graph.parents(99).empty());
+
+      // lines can be requested in any order
+      std::vector<std::string> expected = layOut(history);
+      REQUIRE(graph.line(50) == expected[50]);
+      REQUIRE(graph.line(10) == expected[10]);
+      REQUIRE(lines(&graph) == expected);
+      REQUIRE(graph.line(100).empty());
+   }
+
+   SECTION("Adds new commits above the existing commits")
+   {
+      // 20 new commits on top of the existing history
+      std::vector<std::string> added = revList(20);
+      added.back() += " " + commitId(20);
+
+      CommitGraph graph;
+      graph.assign(revList(80, 20));
+      graph.line(79);
+      graph.prepend(added);
+
+      CommitGraph expected;
+      expected.assign(history);
+      REQUIRE(graph.size() == expected.size());
+      for (std::size_t i = 0; i < expected.size(); i++)
+      {
+         REQUIRE(graph.commit(i) == expected.commit(i));
+         REQUIRE(graph.parents(i) == expected.parents(i));
+      }
+      REQUIRE(lines(&graph) == lines(&expected));
+   }
+
+   SECTION("Reads the commits it writes")
+   {
+      CommitGraph graph;
+      graph.assign(history);
+      std::ostringstream os;
+      graph.write(os);
+
+      CommitGraph read;
+      std::istringstream is(os.str());
+      REQUIRE(read.read(is));
+      REQUIRE(read.size() == 100);
+      REQUIRE(read.parents(7) == graph.parents(7));
+      REQUIRE(lines(&read) == lines(&graph));
+
+      // parents must follow their children
+      std::istringstream malformed(commitId(0) + " 0\n");
+      REQUIRE_FALSE(read.read(malformed));
+      REQUIRE(read.empty());
+
+      std::istringstream missing(commitId(0) + " 1\n");
+      REQUIRE_FALSE(read.read(missing));
+   }
+}
+
+benchmark_context("Commit graph paging")
+{
+   std::vector<std::string> history = revList(200000);
+
+   benchmark_that("Lay out a page of 100 lines at 150,000 from scratch")
+   {
+      GitGraph graph;
+      std::vector<std::string> page = layOut(
+               std::vector<std::string>(history.begin(), history.begin() + 150100));
+      return page.back();
+   };
+
+   CommitGraph graph;
+   graph.assign(history);
+   graph.line(history.size() - 1);
+   benchmark_that("Serve a page of 100 lines at 150,000 from a commit graph")
+   {
+      std::vector<std::string> page;
+      for (std::size_t i = 150000; i < 150100; i++)
+         page.push_back(graph.line(i));
+      return page.back();
+   };
+
+   benchmark_that("Read the graph of 200,000 commits")
+   {
+      std::ostringstream os;
+      graph.write(os);
+      std::istringstream is(os.str());
+      CommitGraph read;
+      return read.read(is);
+   };
+}
+
+} // namespace tests
+} // namespace gitgraph
+} // namespace core
+} // namespace rstudio
@@ -42,6 +42,7 @@ namespace log {
 #define kMaxRotations      "max-rotations"
 #define kDeleteDays        "delete-days"
 #define kWarnSyslog        "warn-syslog"
+#define kAsyncWrites       "async-writes"
 #define kLogConfFile       "logging.conf"
 
 #define kLogLevelEnvVar    "RS_LOG_LEVEL"
@@ -200,7 +201,8 @@ struct LoggerOptionsVisitor : boost::static_visitor<>
          kRotateDays, defaultOptions.getRotationDays(),
          kMaxRotations, defaultOptions.getMaxRotations(),
          kDeleteDays, defaultOptions.getDeletionDays(),
-         kWarnSyslog, defaultOptions.warnSyslog());
+         kWarnSyslog, defaultOptions.warnSyslog(),
+         kAsyncWrites, defaultOptions.asyncWrites());
    }
 
    void operator()(const StdErrLogOptions& options)
@@ -225,7 +227,8 @@ struct LoggerOptionsVisitor : boost::static_visitor<>
          kRotateDays, options.getRotationDays(),
          kMaxRotations, options.getMaxRotations(),
          kDeleteDays, options.getDeletionDays(),
-         kWarnSyslog, options.warnSyslog());
+         kWarnSyslog, options.warnSyslog(),
+         kAsyncWrites, options.asyncWrites());
    }
 
    ConfigProfile& profile_;
@@ -463,7 +466,7 @@ LoggerOptions LogOptions::loggerOptions(const std::string& loggerName) const
          std::vector<ConfigProfile::Level> levels = getLevels(loggerName);
 
          std::string logDir, fileMode, messageFormatStr;
-         bool rotate, includePid, warnSyslog;
+         bool rotate, includePid, warnSyslog, asyncWrites;
          double maxSizeMb;
          int rotateDays, maxRotations, deleteDays;
 
@@ -475,6 +478,7 @@ LoggerOptions LogOptions::loggerOptions(const std::string& loggerName) const
          profile_.getParam(kMaxRotations, &maxRotations, levels);
          profile_.getParam(kDeleteDays, &deleteDays, levels);
          profile_.getParam(kWarnSyslog, &warnSyslog, levels);
+         profile_.getParam(kAsyncWrites, &asyncWrites, levels);
 
          profile_.getParam(kLogDir, &logDir, levels);
          FilePath loggingDir(logDir);
@@ -495,7 +499,7 @@ LoggerOptions LogOptions::loggerOptions(const std::string& loggerName) const
          if (!logDirOverride.empty())
             loggingDir = FilePath(logDirOverride);
 
-         return FileLogOptions(loggingDir, fileMode, maxSizeMb, rotateDays, maxRotations, deleteDays, rotate, includePid, warnSyslog, forceLogDir);
+         return FileLogOptions(loggingDir, fileMode, maxSizeMb, rotateDays, maxRotations, deleteDays, rotate, includePid, warnSyslog, forceLogDir, asyncWrites);
       }
 
       case LoggerType::kStdErr:
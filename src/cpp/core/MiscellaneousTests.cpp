@@ -265,6 +265,32 @@ test_context("LruCache")
 
       expect_true(cache.size() == 0);
    }
+
+   test_that("Weighted caches are bounded by total weight")
+   {
+      LruCache<int, std::string> cache(100, [](const std::string& value) { return value.size(); });
+
+      cache.insert(1, std::string(40, 'a'));
+      cache.insert(2, std::string(40, 'b'));
+      expect_true(cache.weight() == 80);
+
+      // evicts the oldest entry to make room
+      cache.insert(3, std::string(40, 'c'));
+      expect_true(cache.size() == 2);
+      expect_true(cache.weight() == 80);
+
+      std::string val;
+      expect_false(cache.get(1, &val));
+
+      // growing an existing entry evicts others, but never the entry itself
+      cache.insert(3, std::string(90, 'c'));
+      expect_true(cache.size() == 1);
+      expect_true(cache.get(3, &val));
+      expect_true(cache.weight() == 90);
+
+      cache.remove(3);
+      expect_true(cache.weight() == 0);
+   }
 }
 
 test_context("Options")
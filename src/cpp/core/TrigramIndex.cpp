@@ -0,0 +1,411 @@
+/*
+ * TrigramIndex.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/TrigramIndex.hpp>
+
+#include <algorithm>
+
+#include <core/FileSerializer.hpp>
+
+#include <shared_core/Error.hpp>
+#include <shared_core/FilePath.hpp>
+
+namespace rstudio {
+namespace core {
+
+namespace {
+
+// identifies the file format; bump the version when it changes
+const char kIndexFileMagic[] = "RSTRIGRAM2";
+
+inline unsigned char foldCase(unsigned char c)
+{
+   return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+// the distinct trigrams within the lines of contents
+std::vector<std::uint32_t> trigrams(const std::string& contents)
+{
+   std::vector<std::uint32_t> result;
+   result.reserve(std::min<std::size_t>(contents.size(), 64 * 1024));
+
+   std::uint32_t trigram = 0;
+   std::size_t run = 0;
+   for (char ch : contents)
+   {
+      unsigned char c = foldCase(static_cast<unsigned char>(ch));
+      if (c == '\n' || c == '\r')
+      {
+         run = 0;
+         continue;
+      }
+
+      trigram = ((trigram << 8) | c) & 0xFFFFFF;
+      if (++run >= 3)
+         result.push_back(trigram);
+   }
+
+   std::sort(result.begin(), result.end());
+   result.erase(std::unique(result.begin(), result.end()), result.end());
+   return result;
+}
+
+void writeVarint(std::uint64_t value, std::string* pOutput)
+{
+   while (value >= 0x80)
+   {
+      pOutput->push_back(static_cast<char>((value & 0x7F) | 0x80));
+      value >>= 7;
+   }
+   pOutput->push_back(static_cast<char>(value));
+}
+
+void writeString(const std::string& value, std::string* pOutput)
+{
+   writeVarint(value.size(), pOutput);
+   pOutput->append(value);
+}
+
+class Reader
+{
+public:
+   explicit Reader(const std::string& input)
+      : pos_(input.data()), end_(input.data() + input.size()), failed_(false)
+   {
+   }
+
+   bool readLiteral(const char* literal, std::size_t size)
+   {
+      if (static_cast<std::size_t>(end_ - pos_) < size ||
+          !std::equal(literal, literal + size, pos_))
+      {
+         failed_ = true;
+         return false;
+      }
+      pos_ += size;
+      return true;
+   }
+
+   std::uint64_t readVarint()
+   {
+      std::uint64_t value = 0;
+      for (int shift = 0; shift < 64; shift += 7)
+      {
+         if (pos_ == end_)
+            break;
+
+         unsigned char byte = static_cast<unsigned char>(*pos_++);
+         value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+         if ((byte & 0x80) == 0)
+            return value;
+      }
+
+      failed_ = true;
+      return 0;
+   }
+
+   std::string readString()
+   {
+      std::uint64_t size = readVarint();
+      if (failed_ || size > static_cast<std::uint64_t>(end_ - pos_))
+      {
+         failed_ = true;
+         return std::string();
+      }
+
+      std::string value(pos_, static_cast<std::size_t>(size));
+      pos_ += size;
+      return value;
+   }
+
+   bool failed() const { return failed_; }
+   bool atEnd() const { return pos_ == end_; }
+
+private:
+   const char* pos_;
+   const char* end_;
+   bool failed_;
+};
+
+} // anonymous namespace
+
+TrigramIndex::TrigramIndex()
+   : removedDocuments_(0), dirty_(false)
+{
+}
+
+void TrigramIndex::update(const std::string& name,
+                          std::int64_t modified,
+                          const std::string& contents,
+                          const std::string& payload)
+{
+   auto it = ids_.find(name);
+   if (it != ids_.end())
+      removeDocument(it->second);
+
+   // ids only increase, so appending keeps the posting lists sorted
+   std::uint32_t id = static_cast<std::uint32_t>(documents_.size());
+   documents_.push_back(Document { name, modified, payload, false });
+   ids_[name] = id;
+
+   for (std::uint32_t trigram : trigrams(contents))
+      postings_[trigram].push_back(id);
+
+   dirty_ = true;
+   compact();
+}
+
+void TrigramIndex::remove(const std::string& name)
+{
+   auto it = ids_.find(name);
+   if (it == ids_.end())
+      return;
+
+   removeDocument(it->second);
+   ids_.erase(it);
+   dirty_ = true;
+   compact();
+}
+
+void TrigramIndex::clear()
+{
+   documents_.clear();
+   ids_.clear();
+   postings_.clear();
+   removedDocuments_ = 0;
+   dirty_ = false;
+}
+
+std::size_t TrigramIndex::size() const
+{
+   return ids_.size();
+}
+
+bool TrigramIndex::isCurrent(const std::string& name, std::int64_t modified) const
+{
+   auto it = ids_.find(name);
+   return it != ids_.end() && documents_[it->second].modified == modified;
+}
+
+bool TrigramIndex::getPayload(const std::string& name, std::string* pPayload) const
+{
+   auto it = ids_.find(name);
+   if (it == ids_.end())
+      return false;
+
+   *pPayload = documents_[it->second].payload;
+   return true;
+}
+
+void TrigramIndex::listDocuments(
+      std::vector<std::pair<std::string, std::int64_t> >* pDocuments) const
+{
+   for (const auto& entry : ids_)
+      pDocuments->push_back(std::make_pair(entry.first, documents_[entry.second].modified));
+}
+
+bool TrigramIndex::findCandidates(const std::string& literal,
+                                  std::set<std::string>* pNames) const
+{
+   if (literal.size() < 3 || literal.find_first_of("\r\n") != std::string::npos)
+      return false;
+
+   // intersect the posting lists, shortest first
+   std::vector<const std::vector<std::uint32_t>*> lists;
+   for (std::uint32_t trigram : trigrams(literal))
+   {
+      auto it = postings_.find(trigram);
+      if (it == postings_.end())
+         return true;
+      lists.push_back(&it->second);
+   }
+
+   std::sort(lists.begin(), lists.end(),
+             [](const std::vector<std::uint32_t>* lhs, const std::vector<std::uint32_t>* rhs)
+   {
+      return lhs->size() < rhs->size();
+   });
+
+   std::vector<std::uint32_t> ids = *lists.front();
+   std::vector<std::uint32_t> intersection;
+   for (std::size_t i = 1; i < lists.size() && !ids.empty(); i++)
+   {
+      intersection.clear();
+      std::set_intersection(ids.begin(), ids.end(),
+                            lists[i]->begin(), lists[i]->end(),
+                            std::back_inserter(intersection));
+      ids.swap(intersection);
+   }
+
+   for (std::uint32_t id : ids)
+   {
+      if (!documents_[id].removed)
+         pNames->insert(documents_[id].name);
+   }
+   return true;
+}
+
+Error TrigramIndex::readFromFile(const FilePath& filePath)
+{
+   clear();
+
+   std::string input;
+   Error error = readStringFromFile(filePath, &input);
+   if (error)
+      return error;
+
+   Reader reader(input);
+   reader.readLiteral(kIndexFileMagic, sizeof(kIndexFileMagic) - 1);
+
+   std::uint64_t documentCount = reader.readVarint();
+   for (std::uint64_t i = 0; i < documentCount && !reader.failed(); i++)
+   {
+      Document document;
+      document.name = reader.readString();
+      document.modified = static_cast<std::int64_t>(reader.readVarint());
+      document.payload = reader.readString();
+      document.removed = false;
+
+      ids_[document.name] = static_cast<std::uint32_t>(documents_.size());
+      documents_.push_back(document);
+   }
+
+   std::uint64_t trigramCount = reader.readVarint();
+   for (std::uint64_t i = 0; i < trigramCount && !reader.failed(); i++)
+   {
+      std::uint32_t trigram = static_cast<std::uint32_t>(reader.readVarint());
+      std::uint64_t count = reader.readVarint();
+      if (count > documents_.size())
+         break;
+
+      // ids are delta encoded
+      std::vector<std::uint32_t>& ids = postings_[trigram];
+      ids.reserve(static_cast<std::size_t>(count));
+      std::uint64_t id = 0;
+      for (std::uint64_t j = 0; j < count; j++)
+      {
+         id += reader.readVarint();
+         if (id >= documents_.size())
+            break;
+         ids.push_back(static_cast<std::uint32_t>(id));
+      }
+   }
+
+   if (reader.failed() || !reader.atEnd() || ids_.size() != documents_.size())
+   {
+      clear();
+      return systemError(boost::system::errc::illegal_byte_sequence,
+                         "Invalid trigram index",
+                         ERROR_LOCATION);
+   }
+
+   return Success();
+}
+
+Error TrigramIndex::writeToFile(const FilePath& filePath)
+{
+   // drop removed documents so the ids written are dense
+   compact(true);
+
+   std::string output(kIndexFileMagic, sizeof(kIndexFileMagic) - 1);
+
+   writeVarint(documents_.size(), &output);
+   for (const Document& document : documents_)
+   {
+      writeString(document.name, &output);
+      writeVarint(static_cast<std::uint64_t>(document.modified), &output);
+      writeString(document.payload, &output);
+   }
+
+   writeVarint(postings_.size(), &output);
+   for (const auto& entry : postings_)
+   {
+      writeVarint(entry.first, &output);
+      writeVarint(entry.second.size(), &output);
+
+      std::uint32_t previous = 0;
+      for (std::uint32_t id : entry.second)
+      {
+         writeVarint(id - previous, &output);
+         previous = id;
+      }
+   }
+
+   // write to a temporary file and move it into place so that a partially
+   // written index is never read
+   FilePath tempPath(filePath.getAbsolutePath() + ".tmp");
+   Error error = writeStringToFile(tempPath, output);
+   if (error)
+      return error;
+
+   error = tempPath.move(filePath, FilePath::MoveDirect, true);
+   if (error)
+      return error;
+
+   dirty_ = false;
+   return Success();
+}
+
+void TrigramIndex::removeDocument(std::uint32_t id)
+{
+   documents_[id].removed = true;
+   documents_[id].payload.clear();
+   removedDocuments_++;
+}
+
+void TrigramIndex::compact(bool force)
+{
+   // only worth rebuilding the posting lists once a good share of the
+   // documents have been removed
+   if (removedDocuments_ == 0 || (!force && removedDocuments_ * 4 < documents_.size()))
+      return;
+
+   std::vector<std::uint32_t> newIds(documents_.size());
+   std::vector<Document> documents;
+   documents.reserve(ids_.size());
+   for (std::size_t i = 0; i < documents_.size(); i++)
+   {
+      if (documents_[i].removed)
+         continue;
+
+      newIds[i] = static_cast<std::uint32_t>(documents.size());
+      documents.push_back(std::move(documents_[i]));
+   }
+
+   for (auto it = postings_.begin(); it != postings_.end(); )
+   {
+      std::vector<std::uint32_t>& ids = it->second;
+      std::size_t count = 0;
+      for (std::uint32_t id : ids)
+      {
+         if (!documents_[id].removed)
+            ids[count++] = newIds[id];
+      }
+      ids.resize(count);
+
+      if (ids.empty())
+         it = postings_.erase(it);
+      else
+         ++it;
+   }
+
+   documents_.swap(documents);
+   for (std::size_t i = 0; i < documents_.size(); i++)
+      ids_[documents_[i].name] = static_cast<std::uint32_t>(i);
+   removedDocuments_ = 0;
+}
+
+} // namespace core
+} // namespace rstudio
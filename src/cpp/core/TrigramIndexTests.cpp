@@ -0,0 +1,129 @@
+/*
+ * TrigramIndexTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <tests/TestThat.hpp>
+
+#include <boost/lexical_cast.hpp>
+
+#include <core/FileSerializer.hpp>
+#include <core/TrigramIndex.hpp>
+
+namespace rstudio {
+namespace core {
+namespace tests {
+
+namespace {
+
+std::set<std::string> candidates(const TrigramIndex& index, const std::string& literal)
+{
+   std::set<std::string> names;
+   REQUIRE(index.findCandidates(literal, &names));
+   return names;
+}
+
+} // anonymous namespace
+
+test_context("Trigram index")
+{
+   test_that("Candidates contain every document with the literal")
+   {
+      TrigramIndex index;
+      index.update("a.R", 1, "foo <- function(x)\n{\n   x + 1\n}\n");
+      index.update("b.R", 2, "bar <- FUNCTION\n");
+      index.update("c.R", 3, "fun\nction\n");
+
+      expect_true(candidates(index, "function") == std::set<std::string>({ "a.R", "b.R" }));
+      expect_true(candidates(index, "Function(") == std::set<std::string>({ "a.R" }));
+      expect_true(candidates(index, "missing").empty());
+
+      // trigrams don't span lines
+      expect_true(candidates(index, "cti").size() == 3);
+      expect_true(candidates(index, "nct").size() == 2);
+
+      // short literals can't be narrowed
+      std::set<std::string> names;
+      expect_false(index.findCandidates("fu", &names));
+   }
+
+   test_that("Documents can be replaced and removed")
+   {
+      TrigramIndex index;
+      index.update("a.R", 1, "alpha");
+      index.update("b.R", 1, "alpha beta");
+      expect_true(index.isCurrent("a.R", 1));
+
+      index.update("a.R", 2, "gamma");
+      expect_false(index.isCurrent("a.R", 1));
+      expect_true(index.isCurrent("a.R", 2));
+      expect_true(candidates(index, "alpha") == std::set<std::string>({ "b.R" }));
+      expect_true(candidates(index, "gamma") == std::set<std::string>({ "a.R" }));
+
+      index.remove("b.R");
+      expect_true(index.size() == 1);
+      expect_true(candidates(index, "alpha").empty());
+
+      // replacing documents repeatedly compacts the index
+      for (int i = 0; i < 100; i++)
+         index.update("a.R", i, "delta " + boost::lexical_cast<std::string>(i));
+      expect_true(candidates(index, "delta") == std::set<std::string>({ "a.R" }));
+      expect_true(candidates(index, "gamma").empty());
+   }
+
+   test_that("Indexes round trip through files")
+   {
+      FilePath indexPath;
+      REQUIRE_FALSE(FilePath::tempFilePath(indexPath));
+
+      TrigramIndex index;
+      index.update("a.R", 10, "alpha beta", "payload a");
+      index.update("b.R", 20, "beta gamma", std::string("payload\0b", 9));
+      index.update("c.R", 30, "gamma delta");
+      index.remove("c.R");
+
+      // modification times are kept to the nanosecond
+      const std::int64_t kModified = INT64_C(1700000000123456789);
+      index.update("d.R", kModified, "epsilon");
+      expect_true(index.isDirty());
+      REQUIRE_FALSE(index.writeToFile(indexPath));
+      expect_false(index.isDirty());
+
+      TrigramIndex restored;
+      REQUIRE_FALSE(restored.readFromFile(indexPath));
+      expect_true(restored.size() == 3);
+      expect_true(restored.isCurrent("b.R", 20));
+      expect_true(restored.isCurrent("d.R", kModified));
+      expect_false(restored.isCurrent("d.R", kModified + 1));
+      expect_false(restored.isCurrent("c.R", 30));
+      expect_true(candidates(restored, "beta") == std::set<std::string>({ "a.R", "b.R" }));
+      expect_true(candidates(restored, "gamma") == std::set<std::string>({ "b.R" }));
+
+      std::string payload;
+      expect_true(restored.getPayload("b.R", &payload));
+      expect_true(payload == std::string("payload\0b", 9));
+
+      // truncated indexes are rejected
+      std::string contents;
+      REQUIRE_FALSE(readStringFromFile(indexPath, &contents));
+      REQUIRE_FALSE(writeStringToFile(indexPath, contents.substr(0, contents.size() - 1)));
+      expect_true(restored.readFromFile(indexPath));
+      expect_true(restored.size() == 0);
+
+      indexPath.remove();
+   }
+}
+
+} // namespace tests
+} // namespace core
+} // namespace rstudio
@@ -25,6 +25,7 @@
 #include <core/http/CSRFToken.hpp>
 #include <core/http/Request.hpp>
 #include <core/http/Response.hpp>
+#include <core/http/StaticFileCache.hpp>
 
 #include "config.h"
 
@@ -188,6 +189,10 @@ http::UriHandlerFunction fileHandlerFunction(
                                 gwtPrefix, useEmulatedStack, serverHomepagePath,
                                 frameOptions };
 
+   // the application's assets are served to every client, so are worth
+   // holding in memory along with their compressed variants
+   http::staticFileCache().addRoot(FilePath(wwwLocalPath));
+
    return boost::bind(handleFileRequest,
                       options,
                       _1,
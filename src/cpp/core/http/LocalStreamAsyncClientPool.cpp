@@ -0,0 +1,231 @@
+/*
+ * LocalStreamAsyncClientPool.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/http/LocalStreamAsyncClientPool.hpp>
+
+#include <core/Thread.hpp>
+
+using namespace boost::placeholders;
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+namespace {
+
+boost::posix_time::ptime now()
+{
+   return boost::posix_time::microsec_clock::universal_time();
+}
+
+void closeClients(const std::vector<boost::shared_ptr<LocalStreamAsyncClient> >& clients)
+{
+   for (const boost::shared_ptr<LocalStreamAsyncClient>& client : clients)
+      client->close();
+}
+
+} // anonymous namespace
+
+LocalStreamAsyncClientPool::LocalStreamAsyncClientPool(
+      std::size_t maxIdlePerStream,
+      const boost::posix_time::time_duration& idleTimeout)
+   : maxIdlePerStream_(maxIdlePerStream),
+     idleTimeout_(idleTimeout),
+     lastExpiryCheck_(now()),
+     expiryCheckScheduled_(false)
+{
+}
+
+LocalStreamAsyncClientPool::~LocalStreamAsyncClientPool()
+{
+   LOCK_MUTEX(mutex_)
+   {
+      if (pExpiryTimer_)
+      {
+         boost::system::error_code ec;
+         pExpiryTimer_->cancel(ec);
+      }
+   }
+   END_LOCK_MUTEX
+}
+
+boost::shared_ptr<LocalStreamAsyncClient> LocalStreamAsyncClientPool::client(
+      boost::asio::io_service& ioService,
+      const FilePath& localStreamPath,
+      const boost::optional<UidType>& validateUid)
+{
+   boost::shared_ptr<LocalStreamAsyncClient> pClient;
+   Clients stale;
+
+   LOCK_MUTEX(mutex_)
+   {
+      if (!pExpiryTimer_)
+         pExpiryTimer_.reset(new boost::asio::deadline_timer(ioService));
+
+      removeExpiredConnections(now(), &stale);
+
+      auto it = idleConnections_.find(localStreamPath.getAbsolutePath());
+      if (it != idleConnections_.end())
+      {
+         // take the most recently used connection first; it's the least
+         // likely to have been closed by the server
+         std::deque<IdleConnection>& connections = it->second;
+         while (!connections.empty())
+         {
+            boost::shared_ptr<LocalStreamAsyncClient> pIdle = connections.back().client;
+            connections.pop_back();
+
+            if (pIdle->validateUid() == validateUid && pIdle->isConnectionAlive())
+            {
+               pClient = pIdle;
+               break;
+            }
+
+            stale.push_back(pIdle);
+         }
+
+         if (connections.empty())
+            idleConnections_.erase(it);
+      }
+   }
+   END_LOCK_MUTEX
+
+   closeClients(stale);
+
+   if (pClient)
+   {
+      pClient->resetForNextRequest();
+      return pClient;
+   }
+
+   pClient.reset(new LocalStreamAsyncClient(ioService, localStreamPath, false, validateUid));
+   pClient->setIdleConnectionHandler(
+            boost::bind(&LocalStreamAsyncClientPool::onConnectionIdle, this, _1));
+   return pClient;
+}
+
+std::size_t LocalStreamAsyncClientPool::idleConnectionCount() const
+{
+   std::size_t count = 0;
+
+   LOCK_MUTEX(mutex_)
+   {
+      for (const auto& entry : idleConnections_)
+         count += entry.second.size();
+   }
+   END_LOCK_MUTEX
+
+   return count;
+}
+
+void LocalStreamAsyncClientPool::onConnectionIdle(
+      const boost::shared_ptr<LocalStreamAsyncClient>& client)
+{
+   Clients evicted;
+
+   LOCK_MUTEX(mutex_)
+   {
+      boost::posix_time::ptime time = now();
+      removeExpiredConnections(time, &evicted);
+
+      std::deque<IdleConnection>& connections =
+            idleConnections_[client->localStreamPath().getAbsolutePath()];
+      connections.push_back(IdleConnection { client, time });
+
+      // keep only the most recently used connections
+      while (connections.size() > maxIdlePerStream_)
+      {
+         evicted.push_back(connections.front().client);
+         connections.pop_front();
+      }
+
+      scheduleExpiryCheck();
+   }
+   END_LOCK_MUTEX
+
+   closeClients(evicted);
+}
+
+void LocalStreamAsyncClientPool::removeExpiredConnections(
+      const boost::posix_time::ptime& now,
+      Clients* pExpired)
+{
+   // only worth walking all of the streams every so often
+   if (now - lastExpiryCheck_ < idleTimeout_ / 4)
+      return;
+   lastExpiryCheck_ = now;
+
+   for (auto it = idleConnections_.begin(); it != idleConnections_.end(); )
+   {
+      std::deque<IdleConnection>& connections = it->second;
+      while (!connections.empty() && now - connections.front().idleSince >= idleTimeout_)
+      {
+         pExpired->push_back(connections.front().client);
+         connections.pop_front();
+      }
+
+      if (connections.empty())
+         it = idleConnections_.erase(it);
+      else
+         ++it;
+   }
+}
+
+void LocalStreamAsyncClientPool::scheduleExpiryCheck()
+{
+   // NOTE: private helper so no lock required (mutex is not recursive)
+
+   if (expiryCheckScheduled_ || !pExpiryTimer_)
+      return;
+
+   boost::system::error_code ec;
+   pExpiryTimer_->expires_from_now(idleTimeout_ / 4, ec);
+   if (ec)
+   {
+      LOG_ERROR(Error(ec, ERROR_LOCATION));
+      return;
+   }
+
+   pExpiryTimer_->async_wait(
+            boost::bind(&LocalStreamAsyncClientPool::onExpiryCheck, this, _1));
+   expiryCheckScheduled_ = true;
+}
+
+void LocalStreamAsyncClientPool::onExpiryCheck(const boost::system::error_code& ec)
+{
+   // cancelled when the pool is destroyed
+   if (ec == boost::asio::error::operation_aborted)
+      return;
+
+   Clients expired;
+
+   LOCK_MUTEX(mutex_)
+   {
+      expiryCheckScheduled_ = false;
+      removeExpiredConnections(now(), &expired);
+
+      // keep checking until there are no idle connections left (the next
+      // connection to become idle schedules the check again)
+      if (!idleConnections_.empty())
+         scheduleExpiryCheck();
+   }
+   END_LOCK_MUTEX
+
+   closeClients(expired);
+}
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
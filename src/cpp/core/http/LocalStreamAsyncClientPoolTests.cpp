@@ -0,0 +1,306 @@
+/*
+ * LocalStreamAsyncClientPoolTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef _WIN32
+
+#include <tests/TestThat.hpp>
+
+#include <atomic>
+#include <future>
+
+#include <boost/asio/buffers_iterator.hpp>
+#include <boost/make_shared.hpp>
+
+#include <core/BoostThread.hpp>
+#include <core/http/LocalStreamAsyncClientPool.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+namespace tests {
+
+namespace {
+
+using boost::asio::local::stream_protocol;
+
+// answers every request with "ok", keeping connections open when asked to
+// (unless closeIdle is set, in which case it closes them anyway after the
+// response, the way an exiting session would). once it has answered
+// answerLimit requests it closes connections on receiving a request
+// instead, the way a session that exits while handling one would
+class TestServer
+{
+public:
+   explicit TestServer(const FilePath& streamPath,
+                       bool closeIdle = false,
+                       int answerLimit = -1)
+      : acceptor_(ioService_, stream_protocol::endpoint(streamPath.getAbsolutePath())),
+        closeIdle_(closeIdle),
+        answerLimit_(answerLimit),
+        connections_(0),
+        requests_(0)
+   {
+      accept();
+      thread_ = boost::thread([this]() { ioService_.run(); });
+   }
+
+   ~TestServer()
+   {
+      ioService_.stop();
+      thread_.join();
+   }
+
+   int connections() const { return connections_; }
+   int requests() const { return requests_; }
+
+private:
+   void accept()
+   {
+      auto pSocket = boost::make_shared<stream_protocol::socket>(ioService_);
+      acceptor_.async_accept(*pSocket, [=](const boost::system::error_code& ec)
+      {
+         if (ec)
+            return;
+
+         connections_++;
+         serve(pSocket, boost::make_shared<boost::asio::streambuf>());
+         accept();
+      });
+   }
+
+   void serve(boost::shared_ptr<stream_protocol::socket> pSocket,
+              boost::shared_ptr<boost::asio::streambuf> pBuffer)
+   {
+      boost::asio::async_read_until(*pSocket, *pBuffer, "\r\n\r\n",
+                                    [=](const boost::system::error_code& ec, std::size_t size)
+      {
+         if (ec)
+            return;
+
+         std::string headers(boost::asio::buffers_begin(pBuffer->data()),
+                             boost::asio::buffers_begin(pBuffer->data()) + size);
+         pBuffer->consume(size);
+
+         int request = requests_++;
+         if (answerLimit_ >= 0 && request >= answerLimit_)
+         {
+            pSocket->close();
+            return;
+         }
+
+         bool keepAlive = headers.find("Connection: keep-alive") != std::string::npos;
+         auto pResponse = boost::make_shared<std::string>(
+                  std::string("HTTP/1.1 200 OK\r\nContent-Length: 2\r\n") +
+                  (keepAlive ? "" : "Connection: close\r\n") +
+                  "\r\nok");
+
+         boost::asio::async_write(*pSocket, boost::asio::buffer(*pResponse),
+                                  [=](const boost::system::error_code& ec, std::size_t)
+         {
+            if (ec || !keepAlive || closeIdle_)
+            {
+               pSocket->close();
+               return;
+            }
+
+            serve(pSocket, pBuffer);
+         });
+      });
+   }
+
+   boost::asio::io_service ioService_;
+   stream_protocol::acceptor acceptor_;
+   boost::thread thread_;
+   bool closeIdle_;
+   int answerLimit_;
+   std::atomic<int> connections_;
+   std::atomic<int> requests_;
+};
+
+class ClientThread
+{
+public:
+   ClientThread()
+      : work_(ioService_),
+        thread_([this]() { ioService_.run(); })
+   {
+   }
+
+   ~ClientThread()
+   {
+      ioService_.stop();
+      thread_.join();
+   }
+
+   boost::asio::io_service& ioService() { return ioService_; }
+
+private:
+   boost::asio::io_service ioService_;
+   boost::asio::io_service::work work_;
+   boost::thread thread_;
+};
+
+std::string get(boost::shared_ptr<LocalStreamAsyncClient> pClient)
+{
+   pClient->request().setMethod("GET");
+   pClient->request().setUri("/rpc/test");
+
+   auto pResult = boost::make_shared<std::promise<std::string> >();
+   pClient->execute(
+      [=](const Response& response) { pResult->set_value(response.body()); },
+      [=](const Error&) { pResult->set_value("error"); });
+
+   return pResult->get_future().get();
+}
+
+// the connection is returned to the pool just after the response handler
+// has run
+bool waitForIdleConnections(const LocalStreamAsyncClientPool& pool, std::size_t count)
+{
+   for (int i = 0; i < 1000 && pool.idleConnectionCount() != count; i++)
+      boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+   return pool.idleConnectionCount() == count;
+}
+
+FilePath testStreamPath()
+{
+   FilePath streamPath;
+   REQUIRE_FALSE(FilePath::tempFilePath(streamPath));
+   return streamPath;
+}
+
+} // anonymous namespace
+
+test_context("Local stream client pool")
+{
+   test_that("Connections are reused")
+   {
+      FilePath streamPath = testStreamPath();
+      TestServer server(streamPath);
+      ClientThread clients;
+      LocalStreamAsyncClientPool pool;
+
+      for (int i = 0; i < 5; i++)
+      {
+         expect_true(get(pool.client(clients.ioService(), streamPath)) == "ok");
+         expect_true(waitForIdleConnections(pool, 1));
+      }
+      expect_true(server.connections() == 1);
+
+      streamPath.removeIfExists();
+   }
+
+   test_that("Connections closed by the server are replaced")
+   {
+      FilePath streamPath = testStreamPath();
+      TestServer server(streamPath, true);
+      ClientThread clients;
+      LocalStreamAsyncClientPool pool;
+
+      expect_true(get(pool.client(clients.ioService(), streamPath)) == "ok");
+      expect_true(waitForIdleConnections(pool, 1));
+      expect_true(get(pool.client(clients.ioService(), streamPath)) == "ok");
+      expect_true(server.connections() == 2);
+
+      streamPath.removeIfExists();
+   }
+
+   test_that("Requests aren't resent once written")
+   {
+      FilePath streamPath = testStreamPath();
+      TestServer server(streamPath, false, 1);
+      ClientThread clients;
+      LocalStreamAsyncClientPool pool;
+
+      // the server may have acted on a request it received, even if the
+      // connection then closed without a response
+      expect_true(get(pool.client(clients.ioService(), streamPath)) == "ok");
+      expect_true(waitForIdleConnections(pool, 1));
+      expect_true(get(pool.client(clients.ioService(), streamPath)) == "error");
+      expect_true(server.requests() == 2);
+      expect_true(server.connections() == 1);
+
+      streamPath.removeIfExists();
+   }
+
+   test_that("Idle connections are bounded")
+   {
+      FilePath streamPath = testStreamPath();
+      TestServer server(streamPath);
+      ClientThread clients;
+      LocalStreamAsyncClientPool pool(1);
+
+      // two requests at once need two connections, but only one is kept
+      boost::shared_ptr<LocalStreamAsyncClient> pFirst = pool.client(clients.ioService(), streamPath);
+      boost::shared_ptr<LocalStreamAsyncClient> pSecond = pool.client(clients.ioService(), streamPath);
+      expect_true(get(pFirst) == "ok");
+      expect_true(get(pSecond) == "ok");
+      expect_true(waitForIdleConnections(pool, 1));
+      expect_true(server.connections() == 2);
+
+      streamPath.removeIfExists();
+   }
+
+   test_that("Expired connections are closed without further requests")
+   {
+      FilePath streamPath = testStreamPath();
+      TestServer server(streamPath);
+      ClientThread clients;
+      LocalStreamAsyncClientPool pool(4, boost::posix_time::milliseconds(100));
+
+      expect_true(get(pool.client(clients.ioService(), streamPath)) == "ok");
+      expect_true(waitForIdleConnections(pool, 1));
+      expect_true(waitForIdleConnections(pool, 0));
+
+      streamPath.removeIfExists();
+   }
+}
+
+benchmark_context("Local stream client pool throughput")
+{
+   FilePath streamPath = testStreamPath();
+   TestServer server(streamPath);
+   ClientThread clients;
+   LocalStreamAsyncClientPool pool;
+
+   benchmark_that("100 requests on new connections")
+   {
+      int ok = 0;
+      for (int i = 0; i < 100; i++)
+      {
+         boost::shared_ptr<LocalStreamAsyncClient> pClient(
+                  new LocalStreamAsyncClient(clients.ioService(), streamPath));
+         ok += get(pClient) == "ok";
+      }
+      return ok;
+   };
+
+   benchmark_that("100 requests on pooled connections")
+   {
+      int ok = 0;
+      for (int i = 0; i < 100; i++)
+         ok += get(pool.client(clients.ioService(), streamPath)) == "ok";
+      return ok;
+   };
+
+   streamPath.removeIfExists();
+}
+
+} // namespace tests
+} // namespace http
+} // namespace core
+} // namespace rstudio
+
+#endif // _WIN32
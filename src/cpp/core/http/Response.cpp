@@ -29,9 +29,11 @@
 #include <core/http/URL.hpp>
 #include <core/http/Util.hpp>
 #include <core/http/Cookie.hpp>
+#include <core/http/StaticFileCache.hpp>
 #include <shared_core/Hash.hpp>
 #include <core/RegexUtils.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/system/System.hpp>
 
 #ifndef _WIN32
 #include "zlib.h"
@@ -58,8 +60,6 @@ std::shared_ptr<StreamBuffer> makePaddingBuffer(size_t numPadding)
 
 class FileStreamResponse : public StreamResponse
 {
-   friend class ZlibCompressionStreamResponse;
-
 public:
    FileStreamResponse(const FilePath& file,
                       std::streamsize bufferSize,
@@ -132,10 +132,10 @@ enum class CompressionType
 class ZlibCompressionStreamResponse : public StreamResponse
 {
 public:
-   ZlibCompressionStreamResponse(const boost::shared_ptr<FileStreamResponse>& fileStream,
+   ZlibCompressionStreamResponse(const boost::shared_ptr<StreamResponse>& sourceStream,
                                  std::streamsize bufferSize,
                                  CompressionType compressionType) :
-      fileStream_(fileStream),
+      sourceStream_(sourceStream),
       bufferSize_(bufferSize),
       compressionType_(compressionType),
       finished_(false)
@@ -154,7 +154,7 @@ public:
 
    Error initialize()
    {
-      Error error = fileStream_->initialize();
+      Error error = sourceStream_->initialize();
       if (error)
          return error;
 
@@ -192,13 +192,13 @@ public:
 
       do
       {
-         // check to see if the last file buffer was fully consumed by zlib
+         // check to see if the last source buffer was fully consumed by zlib
          // if not, we need to keep using it
-         std::shared_ptr<StreamBuffer> fileBuffer;
-         if (fileBuffer_)
+         std::shared_ptr<StreamBuffer> sourceBuffer;
+         if (sourceBuffer_)
          {
-            fileBuffer = fileBuffer_;
-            fileBuffer_.reset();
+            sourceBuffer = sourceBuffer_;
+            sourceBuffer_.reset();
 
             // no change to avail_in or next_in as this is persisted by zlib
             // when reusing the input buffer
@@ -206,29 +206,28 @@ public:
          else
          {
             // the buffer was fully consumed last time, so get the next
-            // bytes from the file
-            fileBuffer = fileStream_->nextBuffer();
+            // bytes from the source
+            sourceBuffer = sourceStream_->nextBuffer();
 
-            if (!fileBuffer)
+            if (!sourceBuffer)
             {
-               // no more file bytes - signal to zlib that we are done processing
+               // no more source bytes - signal to zlib that we are done processing
                zStream_->avail_in = 0;
                flush = Z_FINISH;
             }
             else
             {
                // tell zlib about the new input buffer
-               zStream_->avail_in = fileBuffer->size;
-               zStream_->next_in = reinterpret_cast<unsigned char*>(fileBuffer->data);
+               zStream_->avail_in = sourceBuffer->size;
+               zStream_->next_in = reinterpret_cast<unsigned char*>(sourceBuffer->data);
             }
          }
 
-         // compress the file bytes
+         // compress the source bytes
          res = deflate(zStream_.get(), flush);
          if (res == Z_STREAM_ERROR)
          {
-            LOG_ERROR_MESSAGE("Could not compress file " + fileStream_->file_.getAbsolutePath() +
-                              " - zlib stream error");
+            LOG_ERROR_MESSAGE("Could not compress response - zlib stream error");
             delete [] buffer;
 
             return std::shared_ptr<StreamBuffer>();
@@ -240,7 +239,7 @@ public:
          {
             // the input data has not been fully processed
             // process it on the next call to this method
-            fileBuffer_ = fileBuffer;
+            sourceBuffer_ = sourceBuffer;
          }
 
          // if no data written, zlib isn't ready to give us data
@@ -254,16 +253,311 @@ public:
    }
 
 private:
-   boost::shared_ptr<FileStreamResponse> fileStream_;
+   boost::shared_ptr<StreamResponse> sourceStream_;
    std::streamsize bufferSize_;
    CompressionType compressionType_;
 
    boost::shared_ptr<struct z_stream_s> zStream_;
-   std::shared_ptr<StreamBuffer> fileBuffer_;
+   std::shared_ptr<StreamBuffer> sourceBuffer_;
    bool finished_;
 };
 #endif
 
+// an inclusive byte range, as specified in a Range header
+struct ByteRange
+{
+   uint64_t begin;
+   uint64_t end;
+
+   uint64_t length() const { return end - begin + 1; }
+};
+
+// the most ranges served from a single request; requests for more are
+// answered with the whole content (as are those which, together, ask for
+// more than the whole content) so that a single header can't make the
+// server send the same bytes over and over
+const std::size_t kMaxByteRanges = 16;
+
+// a byte range along with the multipart header which precedes it (empty
+// when only a single range was requested)
+struct ByteRangePart
+{
+   ByteRange range;
+   std::string header;
+};
+
+// parses a Range header (e.g. "bytes=0-499", "bytes=500-", "bytes=-500" or
+// a comma separated list of these) against content of the given length;
+// returns false if the header isn't a well-formed byte range request (such
+// headers are ignored, per RFC 7233 section 3.1); ranges which can't be
+// satisfied are omitted, so pRanges may be left empty even when true is
+// returned (parsing stops once more than kMaxByteRanges ranges have been read)
+bool parseByteRanges(const std::string& header,
+                     uint64_t total,
+                     std::vector<ByteRange>* pRanges)
+{
+   const std::string kBytesPrefix("bytes=");
+   if (!boost::algorithm::starts_with(header, kBytesPrefix))
+      return false;
+
+   std::vector<std::string> specs;
+   boost::algorithm::split(specs,
+                           header.substr(kBytesPrefix.size()),
+                           boost::algorithm::is_any_of(","));
+
+   boost::regex re("(\\d*)\\-(\\d*)");
+   for (std::string spec : specs)
+   {
+      boost::algorithm::trim(spec);
+
+      boost::smatch match;
+      if (!regex_utils::match(spec, match, re))
+         return false;
+
+      boost::optional<uint64_t> begin = safe_convert::stringTo<uint64_t>(match[1]);
+      boost::optional<uint64_t> end = safe_convert::stringTo<uint64_t>(match[2]);
+
+      ByteRange range;
+      if (!begin)
+      {
+         // suffix range (the last 'end' bytes of the content)
+         if (!end)
+            return false;
+         if (*end == 0 || total == 0)
+            continue;
+
+         range.begin = (*end >= total) ? 0 : total - *end;
+         range.end = total - 1;
+      }
+      else
+      {
+         if (end && *end < *begin)
+            return false;
+
+         // ranges starting past the end of the content can't be satisfied
+         if (*begin >= total)
+            continue;
+
+         range.begin = *begin;
+         range.end = (!end || *end >= total) ? total - 1 : *end;
+      }
+
+      pRanges->push_back(range);
+      if (pRanges->size() > kMaxByteRanges)
+         break;
+   }
+
+   return true;
+}
+
+// sorts the ranges and merges those which overlap or are adjacent
+void coalesceByteRanges(std::vector<ByteRange>* pRanges)
+{
+   std::sort(pRanges->begin(),
+             pRanges->end(),
+             [](const ByteRange& lhs, const ByteRange& rhs)
+   {
+      return lhs.begin < rhs.begin;
+   });
+
+   std::vector<ByteRange> ranges;
+   for (const ByteRange& range : *pRanges)
+   {
+      if (!ranges.empty() && range.begin <= ranges.back().end + 1)
+         ranges.back().end = std::max(ranges.back().end, range.end);
+      else
+         ranges.push_back(range);
+   }
+
+   pRanges->swap(ranges);
+}
+
+std::string contentRange(const ByteRange& range, uint64_t total)
+{
+   boost::format fmt("bytes %1%-%2%/%3%");
+   return boost::str(fmt % range.begin % range.end % total);
+}
+
+// sets the headers of a range response and computes the parts to be sent;
+// returns false if the requested ranges can't be satisfied (in which case
+// the response has been set to RangeNotSatisfiable); malformed Range headers
+// and requests for too many ranges are answered with a single part holding
+// the whole content
+bool prepareRangeResponse(const Request& request,
+                          const std::string& mimeType,
+                          uint64_t total,
+                          Response* pResponse,
+                          std::vector<ByteRangePart>* pParts,
+                          std::string* pTrailer)
+{
+   std::vector<ByteRange> ranges;
+   bool validRanges = parseByteRanges(request.headerValue("Range"), total, &ranges);
+   if (validRanges && ranges.empty())
+   {
+      pResponse->setStatusCode(status::RangeNotSatisfiable);
+      boost::format fmt("bytes */%1%");
+      pResponse->setHeader("Content-Range", boost::str(fmt % total));
+      return false;
+   }
+
+   // responses to range requests are never encoded, as the ranges refer to
+   // the unencoded content
+   pResponse->setHeader("Accept-Ranges", "bytes");
+   pResponse->removeHeader("Content-Encoding");
+
+   uint64_t requested = 0;
+   for (const ByteRange& range : ranges)
+      requested += range.length();
+
+   if (!validRanges || ranges.size() > kMaxByteRanges || requested > total)
+   {
+      pResponse->setStatusCode(status::Ok);
+      pResponse->setContentType(mimeType);
+
+      if (total > 0)
+      {
+         ByteRangePart part;
+         part.range.begin = 0;
+         part.range.end = total - 1;
+         pParts->push_back(part);
+      }
+      return true;
+   }
+
+   coalesceByteRanges(&ranges);
+   pResponse->setStatusCode(status::PartialContent);
+
+   if (ranges.size() == 1)
+   {
+      pResponse->setContentType(mimeType);
+      pResponse->setHeader("Content-Range", contentRange(ranges.front(), total));
+
+      ByteRangePart part;
+      part.range = ranges.front();
+      pParts->push_back(part);
+      return true;
+   }
+
+   // multiple ranges are sent as a multipart/byteranges body
+   std::string boundary = "rstudio-" + core::system::generateShortenedUuid();
+   pResponse->setContentType("multipart/byteranges; boundary=" + boundary);
+
+   for (const ByteRange& range : ranges)
+   {
+      ByteRangePart part;
+      part.range = range;
+      part.header = "\r\n--" + boundary + "\r\n" +
+                    "Content-Type: " + mimeType + "\r\n" +
+                    "Content-Range: " + contentRange(range, total) + "\r\n" +
+                    "\r\n";
+      pParts->push_back(part);
+   }
+
+   *pTrailer = "\r\n--" + boundary + "--\r\n";
+   return true;
+}
+
+std::shared_ptr<StreamBuffer> makeStringBuffer(const std::string& str)
+{
+   char* buffer = new char[str.size()];
+   std::copy(str.begin(), str.end(), buffer);
+   return std::make_shared<StreamBuffer>(buffer, str.size());
+}
+
+// streams the given byte ranges of a file (along with their multipart
+// framing), seeking to each range so that only the requested bytes are read
+class FileRangeStreamResponse : public StreamResponse
+{
+public:
+   FileRangeStreamResponse(const FilePath& file,
+                           const std::vector<ByteRangePart>& parts,
+                           const std::string& trailer,
+                           std::streamsize bufferSize) :
+      file_(file),
+      parts_(parts),
+      trailer_(trailer),
+      bufferSize_(bufferSize),
+      partIndex_(0),
+      partOffset_(0),
+      headerWritten_(false)
+   {
+   }
+
+   virtual ~FileRangeStreamResponse()
+   {
+   }
+
+   Error initialize()
+   {
+      return file_.openForRead(fileStream_);
+   }
+
+   std::shared_ptr<StreamBuffer> nextBuffer()
+   {
+      while (partIndex_ < parts_.size())
+      {
+         const ByteRangePart& part = parts_[partIndex_];
+
+         // start of a part: position the file at the range and send
+         // the part's header (if any)
+         if (!headerWritten_)
+         {
+            headerWritten_ = true;
+            fileStream_->clear();
+            fileStream_->seekg(part.range.begin);
+
+            if (!part.header.empty())
+               return makeStringBuffer(part.header);
+         }
+
+         uint64_t remaining = part.range.length() - partOffset_;
+         if (remaining == 0)
+         {
+            ++partIndex_;
+            partOffset_ = 0;
+            headerWritten_ = false;
+            continue;
+         }
+
+         std::streamsize size = static_cast<std::streamsize>(
+                  std::min<uint64_t>(remaining, bufferSize_));
+         char* buffer = new char[size];
+         fileStream_->read(buffer, size);
+         uint64_t read = fileStream_->gcount();
+         if (read == 0)
+         {
+            // the file was truncated after the response headers were computed
+            delete [] buffer;
+            LOG_ERROR_MESSAGE("Could not read range of file " + file_.getAbsolutePath());
+            return std::shared_ptr<StreamBuffer>();
+         }
+
+         partOffset_ += read;
+         return std::make_shared<StreamBuffer>(buffer, read);
+      }
+
+      if (!trailer_.empty())
+      {
+         std::shared_ptr<StreamBuffer> buffer = makeStringBuffer(trailer_);
+         trailer_.clear();
+         return buffer;
+      }
+
+      return std::shared_ptr<StreamBuffer>();
+   }
+
+private:
+   FilePath file_;
+   std::shared_ptr<std::istream> fileStream_;
+   std::vector<ByteRangePart> parts_;
+   std::string trailer_;
+   std::streamsize bufferSize_;
+
+   std::size_t partIndex_;
+   uint64_t partOffset_;
+   bool headerWritten_;
+};
+
 } // anonymous namespace
 
 Response::Response() 
@@ -445,12 +739,62 @@ Error Response::setBody(const std::string& content)
 Error Response::setCacheableBody(const FilePath& filePath,
                                  const Request& request)
 {
-   std::string content;
-   Error error = core::readStringFromFile(filePath, &content);
+   // read from the static file cache, which has already computed the eTag
+   boost::shared_ptr<const StaticFile> pFile;
+   Error error = staticFileCache().read(filePath, contentEncoding(), &pFile);
+   if (error)
+      return error;
+
+   // file too large to be cached; read it directly
+   if (!pFile)
+   {
+      std::string content;
+      error = core::readStringFromFile(filePath, &content);
+      if (error)
+         return error;
+
+      return setCacheableBody(content, request);
+   }
+
+   setHeader("ETag", pFile->eTag);
+   if (pFile->eTag == request.headerValue("If-None-Match"))
+   {
+      removeHeader("Content-Type"); // upstream code may have set this
+      setStatusCode(status::NotModified);
+      return Success();
+   }
+
+   setCachedBody(*pFile);
+   return Success();
+}
+
+Error Response::setCachedBody(const FilePath& filePath)
+{
+   boost::shared_ptr<const StaticFile> pFile;
+   Error error = staticFileCache().read(filePath, contentEncoding(), &pFile);
    if (error)
       return error;
 
-   return setCacheableBody(content, request);
+   if (!pFile)
+      return setBody(filePath);
+
+   setCachedBody(*pFile);
+   return Success();
+}
+
+void Response::setCachedBody(const StaticFile& file)
+{
+   // fall back to the raw contents if we don't support the encoding
+   // (note that we never compress on win32)
+   boost::shared_ptr<const std::string> pContents = file.contents(contentEncoding());
+   if (!pContents)
+   {
+      removeHeader("Content-Encoding");
+      pContents = file.pContents;
+   }
+
+   body_ = *pContents;
+   setContentLength(gsl::narrow_cast<int>(body_.length()));
 }
 
 void Response::setDynamicHtml(const std::string& html,
@@ -469,75 +813,83 @@ void Response::setDynamicHtml(const std::string& html,
 }
 
 void Response::setRangeableFile(const FilePath& filePath,
-                                const Request& request)
+                                const Request& request,
+                                std::streamsize buffSize)
 {
-   // read the file in from disk
-   std::string contents;
-   Error error = core::readStringFromFile(filePath, &contents);
-   if (error)
+   // no range requested; serve the whole file
+   if (request.headerValue("Range").empty())
+   {
+      setHeader("Accept-Ranges", "bytes");
+      setStreamFile(filePath, request, buffSize);
+      return;
+   }
+
+   if (!filePath.exists())
    {
-      setError(error);
+      setNotFoundError(request);
       return;
    }
 
-   setRangeableFile(contents, filePath.getMimeContentType(), request);
+   std::vector<ByteRangePart> parts;
+   std::string trailer;
+   if (!prepareRangeResponse(request,
+                             filePath.getMimeContentType(),
+                             filePath.getSize(),
+                             this,
+                             &parts,
+                             &trailer))
+   {
+      return;
+   }
+
+   // streaming will be performed via chunked encoding
+   setHeader(kTransferEncoding, kChunkedTransferEncoding);
+
+   streamResponse_.reset(
+            new FileRangeStreamResponse(filePath, parts, trailer, buffSize));
+
+   Error error = streamResponse_->initialize();
+   if (error)
+   {
+      streamResponse_.reset();
+      setError(status::InternalServerError, error.getMessage());
+   }
 }
 
 void Response::setRangeableFile(const std::string& contents,
                                 const std::string& mimeType,
                                 const Request& request)
 {
-   // set content type
-   setContentType(mimeType);
-
-   // parse the range field
-   std::string range = request.headerValue("Range");
-   boost::regex re("bytes=(\\d*)\\-(\\d*)");
-   boost::smatch match;
-   if (regex_utils::match(range, match, re))
+   // no range requested; serve all of the contents
+   if (request.headerValue("Range").empty())
    {
-      // specify partial content
-      setStatusCode(http::status::PartialContent);
-
-      // determine the byte range
-      const size_t kNone = -1;
-      size_t begin = safe_convert::stringTo<size_t>(match[1], kNone);
-      size_t end = safe_convert::stringTo<size_t>(match[2], kNone);
-      size_t total = contents.length();
-
-      if (end == kNone)
-      {
-         end = total-1;
-      }
-      if (begin == kNone)
-      {
-         begin = total - end;
-         end = total-1;
-      }
-
-      // set the byte range
-      addHeader("Accept-Ranges", "bytes");
-      boost::format fmt("bytes %1%-%2%/%3%");
-      std::string range = boost::str(fmt % begin % end % contents.length());
-      addHeader("Content-Range", range);
+      setContentType(mimeType);
+      setHeader("Accept-Ranges", "bytes");
+      setBody(contents);
+      return;
+   }
 
-      // always attempt gzip
-      if (request.acceptsEncoding(http::kGzipEncoding))
-         setContentEncoding(http::kGzipEncoding);
+   std::vector<ByteRangePart> parts;
+   std::string trailer;
+   if (!prepareRangeResponse(request, mimeType, contents.length(), this, &parts, &trailer))
+      return;
 
-      // set body
-      if (begin == 0 && end == (contents.length()-1))
-         setBody(contents);
-      else
-         setBody(contents.substr(begin, end-begin+1));
+   // set body
+   if (parts.size() == 1 && parts.front().range.length() == contents.length())
+   {
+      setBody(contents);
+      return;
    }
-   else
+
+   std::string body;
+   for (const ByteRangePart& part : parts)
    {
-      setStatusCode(http::status::RangeNotSatisfiable);
-      boost::format fmt("bytes */%1%");
-      std::string range = boost::str(fmt % contents.length());
-      addHeader("Content-Range", range);
+      body.append(part.header);
+      body.append(contents, part.range.begin, part.range.length());
    }
+   body.append(trailer);
+
+   setBody(body);
 }
    
 void Response::setBodyUnencoded(const std::string& body)
@@ -824,11 +1176,22 @@ void Response::setStreamFile(const FilePath& filePath,
    }
 #endif
 
+   // files small enough to be held in the static file cache are sent
+   // in one piece so their compressed contents can be reused
+   bool padding = usePadding(request, filePath);
+   if (!padding && staticFileCache().isCacheable(filePath))
+   {
+      Error error = setCachedBody(filePath);
+      if (error)
+         setError(status::InternalServerError, error.getMessage());
+      return;
+   }
+
    // streaming will be performed via chunked encoding
    setHeader(kTransferEncoding, kChunkedTransferEncoding);
 
    boost::shared_ptr<FileStreamResponse> fileStream(
-            new FileStreamResponse(filePath, buffSize, usePadding(request, filePath)));
+            new FileStreamResponse(filePath, buffSize, padding));
 
 #ifndef _WIN32
    if (compressionType)
@@ -849,6 +1212,43 @@ void Response::setStreamFile(const FilePath& filePath,
       setError(status::InternalServerError, error.getMessage());
 }
 
+void Response::setStreamBody(const boost::shared_ptr<StreamResponse>& pStream,
+                             std::streamsize buffSize)
+{
+   // streaming will be performed via chunked encoding
+   setHeader(kTransferEncoding, kChunkedTransferEncoding);
+
+#ifndef _WIN32
+   // compress according to the content encoding set by the caller
+   std::string encoding = contentEncoding();
+   if (encoding == kGzipEncoding)
+   {
+      streamResponse_.reset(
+               new ZlibCompressionStreamResponse(pStream, buffSize, CompressionType::Gzip));
+   }
+   else if (encoding == kDeflateEncoding)
+   {
+      streamResponse_.reset(
+               new ZlibCompressionStreamResponse(pStream, buffSize, CompressionType::Deflate));
+   }
+   else
+   {
+      removeHeader("Content-Encoding");
+      streamResponse_ = pStream;
+   }
+#else
+   removeHeader("Content-Encoding");
+   streamResponse_ = pStream;
+#endif
+
+   Error error = streamResponse_->initialize();
+   if (error)
+   {
+      streamResponse_.reset();
+      setError(status::InternalServerError, error.getMessage());
+   }
+}
+
 } // namespacc http
 } // namespace core
 } // namespace rstudio
@@ -0,0 +1,280 @@
+/*
+ * ResponseTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <tests/TestThat.hpp>
+
+#include <fstream>
+
+#include <boost/lexical_cast.hpp>
+
+#include <core/FileSerializer.hpp>
+#include <core/http/Request.hpp>
+#include <core/http/Response.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+namespace tests {
+
+namespace {
+
+FilePath writeTempFile(const std::string& contents)
+{
+   FilePath filePath;
+   REQUIRE_FALSE(FilePath::tempFilePath(".bin", filePath));
+   REQUIRE_FALSE(writeStringToFile(filePath, contents));
+   return filePath;
+}
+
+// creates a (sparse) file of the given size without writing its contents
+FilePath createLargeFile(uintmax_t size)
+{
+   FilePath filePath;
+   REQUIRE_FALSE(FilePath::tempFilePath(".bin", filePath));
+
+   std::ofstream ofs(filePath.getAbsolutePath().c_str(), std::ios::binary);
+   ofs.seekp(size - 1);
+   ofs.put('\0');
+   return filePath;
+}
+
+// drains a stream response, returning its body and the largest buffer seen
+std::string streamBody(const Response& response, std::size_t* pMaxBuffer = nullptr)
+{
+   std::string body;
+   boost::shared_ptr<StreamResponse> pStream = response.getStreamResponse();
+   if (!pStream)
+      return response.body();
+
+   while (std::shared_ptr<StreamBuffer> pBuffer = pStream->nextBuffer())
+   {
+      body.append(pBuffer->data, pBuffer->size);
+      if (pMaxBuffer)
+         *pMaxBuffer = std::max(*pMaxBuffer, pBuffer->size);
+   }
+
+   return body;
+}
+
+boost::shared_ptr<Request> rangeRequest(const std::string& range)
+{
+   boost::shared_ptr<Request> pRequest(new Request());
+   pRequest->setHeader("Accept-Encoding", "gzip, deflate");
+   pRequest->setHeader("Range", range);
+   return pRequest;
+}
+
+} // anonymous namespace
+
+test_context("Range responses")
+{
+   std::string contents;
+   for (int i = 0; i < 1000; i++)
+      contents += boost::lexical_cast<std::string>(i % 10);
+
+   FilePath filePath = writeTempFile(contents);
+
+   test_that("Single ranges stream only the requested window")
+   {
+      Response response;
+      response.setRangeableFile(filePath, *rangeRequest("bytes=100-199"), 16);
+      expect_true(response.statusCode() == status::PartialContent);
+      expect_true(response.headerValue("Content-Range") == "bytes 100-199/1000");
+      expect_true(response.contentEncoding().empty());
+
+      std::size_t maxBuffer = 0;
+      expect_true(streamBody(response, &maxBuffer) == contents.substr(100, 100));
+      expect_true(maxBuffer <= 16);
+   }
+
+   test_that("Open ended and suffix ranges are supported")
+   {
+      Response openEnded;
+      openEnded.setRangeableFile(filePath, *rangeRequest("bytes=990-"));
+      expect_true(openEnded.headerValue("Content-Range") == "bytes 990-999/1000");
+      expect_true(streamBody(openEnded) == contents.substr(990));
+
+      Response suffix;
+      suffix.setRangeableFile(filePath, *rangeRequest("bytes=-5"));
+      expect_true(suffix.headerValue("Content-Range") == "bytes 995-999/1000");
+      expect_true(streamBody(suffix) == contents.substr(995));
+
+      Response clamped;
+      clamped.setRangeableFile(filePath, *rangeRequest("bytes=900-5000"));
+      expect_true(clamped.headerValue("Content-Range") == "bytes 900-999/1000");
+   }
+
+   test_that("Multiple ranges are sent as multipart/byteranges")
+   {
+      Response response;
+      response.setRangeableFile(filePath, *rangeRequest("bytes=0-9, 500-509"));
+      expect_true(response.statusCode() == status::PartialContent);
+
+      std::string prefix = "multipart/byteranges; boundary=";
+      REQUIRE(response.contentType().find(prefix) == 0);
+
+      auto expectedBody = [&](const std::string& boundary)
+      {
+         std::string mimeType = filePath.getMimeContentType();
+         return "\r\n--" + boundary + "\r\n"
+                "Content-Type: " + mimeType + "\r\n"
+                "Content-Range: bytes 0-9/1000\r\n\r\n" +
+                contents.substr(0, 10) +
+                "\r\n--" + boundary + "\r\n"
+                "Content-Type: " + mimeType + "\r\n"
+                "Content-Range: bytes 500-509/1000\r\n\r\n" +
+                contents.substr(500, 10) +
+                "\r\n--" + boundary + "--\r\n";
+      };
+
+      std::string boundary = response.contentType().substr(prefix.size());
+      expect_true(streamBody(response) == expectedBody(boundary));
+
+      // in-memory contents produce the same body
+      Response inMemory;
+      inMemory.setRangeableFile(contents,
+                                filePath.getMimeContentType(),
+                                *rangeRequest("bytes=0-9, 500-509"));
+      boundary = inMemory.contentType().substr(prefix.size());
+      expect_true(inMemory.body() == expectedBody(boundary));
+   }
+
+   test_that("Overlapping and adjacent ranges are merged")
+   {
+      Response response;
+      response.setRangeableFile(filePath, *rangeRequest("bytes=500-509, 0-9, 5-19, 20-29"));
+      expect_true(response.statusCode() == status::PartialContent);
+
+      std::string prefix = "multipart/byteranges; boundary=";
+      REQUIRE(response.contentType().find(prefix) == 0);
+      std::string boundary = response.contentType().substr(prefix.size());
+
+      std::string mimeType = filePath.getMimeContentType();
+      expect_true(streamBody(response) ==
+                  "\r\n--" + boundary + "\r\n"
+                  "Content-Type: " + mimeType + "\r\n"
+                  "Content-Range: bytes 0-29/1000\r\n\r\n" +
+                  contents.substr(0, 30) +
+                  "\r\n--" + boundary + "\r\n"
+                  "Content-Type: " + mimeType + "\r\n"
+                  "Content-Range: bytes 500-509/1000\r\n\r\n" +
+                  contents.substr(500, 10) +
+                  "\r\n--" + boundary + "--\r\n");
+
+      Response single;
+      single.setRangeableFile(contents, "text/plain", *rangeRequest("bytes=10-19, 15-24"));
+      expect_true(single.statusCode() == status::PartialContent);
+      expect_true(single.headerValue("Content-Range") == "bytes 10-24/1000");
+      expect_true(single.body() == contents.substr(10, 15));
+   }
+
+   test_that("Too many ranges receive the whole file")
+   {
+      std::string repeated = "bytes=0-";
+      for (int i = 0; i < 200; i++)
+         repeated += ",0-";
+
+      Response response;
+      response.setRangeableFile(filePath, *rangeRequest(repeated));
+      expect_true(response.statusCode() == status::Ok);
+      expect_true(response.headerValue("Content-Range").empty());
+      expect_true(streamBody(response) == contents);
+
+      // many small ranges, each distinct
+      std::string many = "bytes=0-0";
+      for (int i = 1; i <= 16; i++)
+         many += "," + boost::lexical_cast<std::string>(i * 10) + "-" +
+                 boost::lexical_cast<std::string>(i * 10);
+
+      Response inMemory;
+      inMemory.setRangeableFile(contents, "text/plain", *rangeRequest(many));
+      expect_true(inMemory.statusCode() == status::Ok);
+      expect_true(inMemory.body() == contents);
+
+      // overlapping ranges which together ask for more than the file
+      Response overlapping;
+      overlapping.setRangeableFile(contents, "text/plain", *rangeRequest("bytes=0-599, 400-999"));
+      expect_true(overlapping.statusCode() == status::Ok);
+      expect_true(overlapping.body() == contents);
+   }
+
+   test_that("Unsatisfiable ranges are rejected")
+   {
+      Response pastEnd;
+      pastEnd.setRangeableFile(filePath, *rangeRequest("bytes=1000-"));
+      expect_true(pastEnd.statusCode() == status::RangeNotSatisfiable);
+      expect_true(pastEnd.headerValue("Content-Range") == "bytes */1000");
+
+      Response suffix;
+      suffix.setRangeableFile(contents, "text/plain", *rangeRequest("bytes=-0"));
+      expect_true(suffix.statusCode() == status::RangeNotSatisfiable);
+   }
+
+   test_that("Invalid ranges are ignored")
+   {
+      Response otherUnit;
+      otherUnit.setRangeableFile(filePath, *rangeRequest("lines=1-2"));
+      expect_true(otherUnit.statusCode() == status::Ok);
+      expect_true(otherUnit.headerValue("Content-Range").empty());
+      expect_true(streamBody(otherUnit) == contents);
+
+      Response reversed;
+      reversed.setRangeableFile(contents, "text/plain", *rangeRequest("bytes=10-5"));
+      expect_true(reversed.statusCode() == status::Ok);
+      expect_true(reversed.body() == contents);
+
+      Response garbled;
+      garbled.setRangeableFile(contents, "text/plain", *rangeRequest("bytes=0-9,x"));
+      expect_true(garbled.statusCode() == status::Ok);
+      expect_true(garbled.body() == contents);
+   }
+
+   test_that("Requests without a range receive the whole file")
+   {
+      Response response;
+      response.setRangeableFile(contents, "text/plain", Request());
+      expect_true(response.statusCode() == status::Ok);
+      expect_true(response.headerValue("Accept-Ranges") == "bytes");
+      expect_true(response.body() == contents);
+   }
+
+   filePath.remove();
+}
+
+benchmark_context("Range response streaming")
+{
+   // the cost of serving a range should not depend on the size of the file
+   const uintmax_t kMegabyte = 1024 * 1024;
+   for (uintmax_t size : { 1 * kMegabyte, 64 * kMegabyte, 512 * kMegabyte })
+   {
+      FilePath filePath = createLargeFile(size);
+      boost::shared_ptr<Request> pRequest = rangeRequest("bytes=4096-69631");
+
+      benchmark_that("64KB range of " +
+                     boost::lexical_cast<std::string>(size / kMegabyte) + "MB file")
+      {
+         Response response;
+         response.setRangeableFile(filePath, *pRequest);
+         return streamBody(response).size();
+      };
+
+      filePath.remove();
+   }
+}
+
+} // namespace tests
+} // namespace http
+} // namespace core
+} // namespace rstudio
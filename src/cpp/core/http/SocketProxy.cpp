@@ -27,6 +27,11 @@
 
 #include <iostream>
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include <boost/asio/placeholders.hpp>
 #include <boost/bind/bind.hpp>
 
@@ -42,6 +47,250 @@ namespace rstudio {
 namespace core {
 namespace http {
 
+namespace {
+
+// the most bytes moved by one splice call
+const std::size_t kSpliceChunkSize = 64 * 1024;
+
+// the most chunks forwarded in one direction before giving other work on
+// the thread a turn
+const int kMaxSpliceRounds = 16;
+
+// adds the cpu time used by the current thread during its lifetime to a total
+class ThreadCpuTimer : boost::noncopyable
+{
+public:
+   explicit ThreadCpuTimer(std::atomic<int64_t>* pTotalNanos)
+      : pTotalNanos_(pTotalNanos)
+#ifdef BOOST_CHRONO_HAS_THREAD_CLOCK
+      , start_(boost::chrono::thread_clock::now())
+#endif
+   {
+   }
+
+   ~ThreadCpuTimer()
+   {
+#ifdef BOOST_CHRONO_HAS_THREAD_CLOCK
+      *pTotalNanos_ += boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+               boost::chrono::thread_clock::now() - start_).count();
+#endif
+   }
+
+private:
+   std::atomic<int64_t>* pTotalNanos_;
+#ifdef BOOST_CHRONO_HAS_THREAD_CLOCK
+   boost::chrono::thread_clock::time_point start_;
+#endif
+};
+
+#ifdef __linux__
+// did a non-blocking call fail only because it would have blocked?
+bool wouldBlock(int errorNumber)
+{
+   // (silly ifdef here is to silence compiler warnings)
+#if EAGAIN == EWOULDBLOCK
+   return errorNumber == EAGAIN;
+#else
+   return errorNumber == EAGAIN || errorNumber == EWOULDBLOCK;
+#endif
+}
+#endif
+
+} // anonymous namespace
+
+SocketProxy::~SocketProxy()
+{
+#ifdef __linux__
+   for (Direction* pDirection : { &clientToServer_, &serverToClient_ })
+   {
+      for (int fd : pDirection->pipe)
+      {
+         if (fd != -1)
+            ::close(fd);
+      }
+   }
+#endif
+}
+
+SocketProxy::Stats SocketProxy::stats() const
+{
+   Stats stats;
+   stats.clientToServerBytes = clientToServer_.bytes;
+   stats.serverToClientBytes = serverToClient_.bytes;
+   stats.elapsedTime = boost::chrono::steady_clock::now() - startTime_;
+   stats.cpuTime = boost::chrono::nanoseconds(cpuNanos_.load());
+   return stats;
+}
+
+void SocketProxy::start()
+{
+   if (startSplicing())
+   {
+      splicing_ = true;
+      boost::system::error_code noError;
+      pump(&clientToServer_, noError);
+      pump(&serverToClient_, noError);
+   }
+   else
+   {
+      readClient();
+      readServer();
+   }
+}
+
+#ifdef __linux__
+
+bool SocketProxy::startSplicing()
+{
+   int clientFd = ptrClient_->nativeHandle();
+   int serverFd = ptrServer_->nativeHandle();
+   if (clientFd == -1 || serverFd == -1)
+      return false;
+
+   for (Direction* pDirection : { &clientToServer_, &serverToClient_ })
+   {
+      if (::pipe2(pDirection->pipe, O_NONBLOCK | O_CLOEXEC) == -1)
+      {
+         LOG_ERROR(systemError(errno, ERROR_LOCATION));
+         return false;
+      }
+   }
+
+   // splice only honors SPLICE_F_NONBLOCK for the pipe end, so the sockets
+   // themselves must not block either
+   for (int fd : { clientFd, serverFd })
+   {
+      int flags = ::fcntl(fd, F_GETFL);
+      if (flags == -1 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+      {
+         LOG_ERROR(systemError(errno, ERROR_LOCATION));
+         return false;
+      }
+   }
+
+   return true;
+}
+
+// moves bytes from one socket to the other through the direction's pipe
+// until the source has nothing left to read or the destination can't take
+// any more, then waits for that to change
+void SocketProxy::pump(Direction* pDirection, const boost::system::error_code& e)
+{
+   if (e)
+   {
+      handleError(e, ERROR_LOCATION);
+      return;
+   }
+
+   ThreadCpuTimer timer(&cpuNanos_);
+   Error error;
+   bool finished = false;
+   bool waiting = false;
+
+   LOCK_MUTEX(pDirection->mutex)
+   {
+      if (closed_)
+         return;
+
+      int fromFd = pDirection->ptrFrom->nativeHandle();
+      int toFd = pDirection->ptrTo->nativeHandle();
+      Socket::Handler next = boost::bind(&SocketProxy::pump,
+                                         SocketProxy::shared_from_this(),
+                                         pDirection,
+                                         _1);
+
+      for (int i = 0; i < kMaxSpliceRounds; i++)
+      {
+         if (pDirection->pending == 0)
+         {
+            ssize_t count = ::splice(fromFd, nullptr, pDirection->pipe[1], nullptr,
+                                     kSpliceChunkSize, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (count == 0)
+            {
+               finished = true;
+               break;
+            }
+            else if (count < 0)
+            {
+               if (errno == EINTR)
+                  continue;
+
+               if (wouldBlock(errno))
+               {
+                  pDirection->ptrFrom->asyncWaitReadable(next);
+                  waiting = true;
+               }
+               else
+                  error = systemError(errno, ERROR_LOCATION);
+               break;
+            }
+
+            if (pDirection->checked && checkFunction_ && !checkFunction_())
+            {
+               finished = true;
+               break;
+            }
+
+            pDirection->pending = count;
+         }
+
+         ssize_t count = ::splice(pDirection->pipe[0], nullptr, toFd, nullptr,
+                                  pDirection->pending, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+         if (count < 0)
+         {
+            if (errno == EINTR)
+               continue;
+
+            if (wouldBlock(errno))
+            {
+               pDirection->ptrTo->asyncWaitWritable(next);
+               waiting = true;
+            }
+            else
+               error = systemError(errno, ERROR_LOCATION);
+            break;
+         }
+
+         pDirection->pending -= count;
+         pDirection->bytes += count;
+      }
+
+      // still busy: give other connections on this thread a turn
+      if (!finished && !error && !waiting)
+      {
+         if (pDirection->pending == 0)
+            pDirection->ptrFrom->asyncWaitReadable(next);
+         else
+            pDirection->ptrTo->asyncWaitWritable(next);
+      }
+   }
+   END_LOCK_MUTEX
+
+   if (error)
+   {
+      if (!http::isConnectionTerminatedError(error))
+         LOG_ERROR(error);
+      finished = true;
+   }
+
+   // close without holding the direction's lock; close takes both
+   if (finished)
+      close();
+}
+
+#else
+
+bool SocketProxy::startSplicing()
+{
+   return false;
+}
+
+void SocketProxy::pump(Direction* pDirection, const boost::system::error_code& e)
+{
+}
+
+#endif
+
 void SocketProxy::readClient()
 {
    ptrClient_->asyncReadSome(
@@ -67,6 +316,8 @@ void SocketProxy::readServer()
 void SocketProxy::handleClientRead(const boost::system::error_code& e,
                                    std::size_t bytesTransferred)
 {
+   ThreadCpuTimer timer(&cpuNanos_);
+
    // client and server reads can happen simultaneously on two threads; a race
    // condition during close can lead to the socket not getting properly
    // shut down. use a simple mutex to prevent the threads from simultaneously
@@ -102,6 +353,8 @@ void SocketProxy::handleClientRead(const boost::system::error_code& e,
 void SocketProxy::handleServerRead(const boost::system::error_code& e,
                                    std::size_t bytesTransferred)
 {
+   ThreadCpuTimer timer(&cpuNanos_);
+
    RECURSIVE_LOCK_MUTEX(socketMutex_)
    {
       if (!e)
@@ -129,6 +382,7 @@ void SocketProxy::handleClientWrite(const boost::system::error_code& e,
 {
    if (!e)
    {
+      serverToClient_.bytes += bytesTransferred;
       readServer();
    }
    else
@@ -142,6 +396,7 @@ void SocketProxy::handleServerWrite(const boost::system::error_code& e,
 {
    if (!e)
    {
+      clientToServer_.bytes += bytesTransferred;
       readClient();
    }
    else
@@ -167,6 +422,12 @@ void SocketProxy::handleError(const boost::system::error_code& e,
 
 void SocketProxy::close()
 {
+   // when splicing, wait for any pump in progress to finish with the sockets
+   boost::unique_lock<boost::mutex> clientToServerLock(clientToServer_.mutex, boost::defer_lock);
+   boost::unique_lock<boost::mutex> serverToClientLock(serverToClient_.mutex, boost::defer_lock);
+   if (splicing_)
+      boost::lock(clientToServerLock, serverToClientLock);
+
    RECURSIVE_LOCK_MUTEX(socketMutex_)
    {
       if (closed_)
@@ -177,6 +438,26 @@ void SocketProxy::close()
    }
    END_LOCK_MUTEX
 
+   if (splicing_)
+   {
+      clientToServerLock.unlock();
+      serverToClientLock.unlock();
+   }
+
+   // only gather the stats when they'll be logged
+   if (log::isLogLevel(log::LogLevel::DEBUG))
+   {
+      Stats stats = this->stats();
+      LOG_DEBUG_MESSAGE(
+         std::string("Proxied connection closed (") + (splicing_ ? "spliced" : "buffered") + "): " +
+         std::to_string(stats.clientToServerBytes) + " bytes to server, " +
+         std::to_string(stats.serverToClientBytes) + " bytes to client in " +
+         std::to_string(boost::chrono::duration_cast<boost::chrono::milliseconds>(stats.elapsedTime).count()) +
+         "ms using " +
+         std::to_string(boost::chrono::duration_cast<boost::chrono::microseconds>(stats.cpuTime).count()) +
+         "us of cpu");
+   }
+
    if (closeFunction_)
    {
       closeFunction_();
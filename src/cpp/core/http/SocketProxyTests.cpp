@@ -0,0 +1,226 @@
+/*
+ * SocketProxyTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef _WIN32
+
+#include <tests/TestThat.hpp>
+
+#include <atomic>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/make_shared.hpp>
+
+#include <core/BoostThread.hpp>
+#include <core/http/SocketProxy.hpp>
+
+using namespace boost::placeholders;
+
+namespace rstudio {
+namespace core {
+namespace http {
+namespace tests {
+
+namespace {
+
+using boost::asio::local::stream_protocol;
+
+// one end of a socket pair; a plain socket can be spliced unless it hides its
+// native handle (as an ssl socket would)
+class StreamSocket : public Socket
+{
+public:
+   StreamSocket(boost::asio::io_service& ioService, bool spliceable)
+      : socket_(ioService), spliceable_(spliceable)
+   {
+   }
+
+   stream_protocol::socket& socket() { return socket_; }
+
+   virtual void asyncReadSome(boost::asio::mutable_buffers_1 buffer, Handler handler)
+   {
+      socket_.async_read_some(buffer, handler);
+   }
+
+   virtual void asyncWrite(const boost::asio::const_buffers_1& buffer, Handler handler)
+   {
+      boost::asio::async_write(socket_, buffer, handler);
+   }
+
+   virtual void asyncWrite(const std::vector<boost::asio::const_buffer>& buffers,
+                           Handler handler)
+   {
+      boost::asio::async_write(socket_, buffers, handler);
+   }
+
+   virtual void close()
+   {
+      boost::system::error_code ec;
+      socket_.close(ec);
+   }
+
+   virtual int nativeHandle()
+   {
+      return spliceable_ ? socket_.native_handle() : -1;
+   }
+
+   virtual void asyncWaitReadable(Handler handler)
+   {
+      socket_.async_wait(stream_protocol::socket::wait_read, boost::bind(handler, _1, 0));
+   }
+
+   virtual void asyncWaitWritable(Handler handler)
+   {
+      socket_.async_wait(stream_protocol::socket::wait_write, boost::bind(handler, _1, 0));
+   }
+
+private:
+   stream_protocol::socket socket_;
+   bool spliceable_;
+};
+
+// a client and a server connected through a proxy running on its own thread
+class ProxiedConnection
+{
+public:
+   explicit ProxiedConnection(bool spliceable)
+      : client_(ioService_),
+        server_(ioService_),
+        closed_(false)
+   {
+      auto pClientEnd = boost::make_shared<StreamSocket>(ioService_, spliceable);
+      auto pServerEnd = boost::make_shared<StreamSocket>(ioService_, spliceable);
+      boost::asio::local::connect_pair(client_, pClientEnd->socket());
+      boost::asio::local::connect_pair(server_, pServerEnd->socket());
+
+      pProxy_ = SocketProxy::create(pClientEnd, pServerEnd, 0, [this]() { closed_ = true; });
+      thread_ = boost::thread([this]() { ioService_.run(); });
+   }
+
+   ~ProxiedConnection()
+   {
+      client_.close();
+      server_.close();
+      thread_.join();
+   }
+
+   stream_protocol::socket& client() { return client_; }
+   stream_protocol::socket& server() { return server_; }
+   const SocketProxy& proxy() const { return *pProxy_; }
+
+   bool waitForClose()
+   {
+      for (int i = 0; i < 1000 && !closed_; i++)
+         boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+      return closed_;
+   }
+
+private:
+   boost::asio::io_service ioService_;
+   stream_protocol::socket client_;
+   stream_protocol::socket server_;
+   boost::shared_ptr<SocketProxy> pProxy_;
+   boost::thread thread_;
+   std::atomic<bool> closed_;
+};
+
+// sends bytes one way through the proxy while reading them at the other end
+bool forward(stream_protocol::socket& from, stream_protocol::socket& to, std::size_t size)
+{
+   std::string sent(size, '\0');
+   for (std::size_t i = 0; i < size; i++)
+      sent[i] = static_cast<char>(i * 31);
+
+   boost::thread writer([&]() { boost::asio::write(from, boost::asio::buffer(sent)); });
+
+   std::string received(size, '\0');
+   boost::system::error_code ec;
+   boost::asio::read(to, boost::asio::buffer(&received[0], size), ec);
+   writer.join();
+
+   return !ec && received == sent;
+}
+
+} // anonymous namespace
+
+test_context("Socket proxy")
+{
+   test_that("Plain sockets are spliced")
+   {
+      ProxiedConnection spliced(true);
+      ProxiedConnection buffered(false);
+#ifdef __linux__
+      expect_true(spliced.proxy().isSplicing());
+#endif
+      expect_false(buffered.proxy().isSplicing());
+   }
+
+   test_that("Bytes are forwarded in both directions")
+   {
+      for (bool spliceable : { true, false })
+      {
+         ProxiedConnection connection(spliceable);
+         expect_true(forward(connection.client(), connection.server(), 1024 * 1024));
+         expect_true(forward(connection.server(), connection.client(), 100));
+         expect_true(forward(connection.client(), connection.server(), 1));
+
+         SocketProxy::Stats stats = connection.proxy().stats();
+         expect_true(stats.clientToServerBytes == 1024 * 1024 + 1);
+         expect_true(stats.serverToClientBytes == 100);
+      }
+   }
+
+   test_that("Closing either end closes the proxy")
+   {
+      for (bool spliceable : { true, false })
+      {
+         ProxiedConnection clientCloses(spliceable);
+         clientCloses.client().close();
+         expect_true(clientCloses.waitForClose());
+
+         ProxiedConnection serverCloses(spliceable);
+         expect_true(forward(serverCloses.server(), serverCloses.client(), 10));
+         serverCloses.server().close();
+         expect_true(serverCloses.waitForClose());
+      }
+   }
+}
+
+benchmark_context("Socket proxy throughput")
+{
+   ProxiedConnection spliced(true);
+   ProxiedConnection buffered(false);
+
+   benchmark_that("64MB through a spliced proxy")
+   {
+      return forward(spliced.client(), spliced.server(), 64 * 1024 * 1024);
+   };
+
+   benchmark_that("64MB through a buffered proxy")
+   {
+      return forward(buffered.client(), buffered.server(), 64 * 1024 * 1024);
+   };
+}
+
+} // namespace tests
+} // namespace http
+} // namespace core
+} // namespace rstudio
+
+#endif // _WIN32
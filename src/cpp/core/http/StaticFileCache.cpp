@@ -0,0 +1,323 @@
+/*
+ * StaticFileCache.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/http/StaticFileCache.hpp>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#include <boost/bind/bind.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+
+#ifndef _WIN32
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#endif
+
+#include <shared_core/Hash.hpp>
+
+#include <core/FileSerializer.hpp>
+#include <core/Thread.hpp>
+#include <core/http/Message.hpp>
+
+using namespace boost::placeholders;
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+namespace {
+
+// bound the memory used by the process-wide cache; files larger than
+// kMaxCachedFileBytes are always served from disk
+const std::size_t kMaxCacheBytes = 64 * 1024 * 1024;
+const std::size_t kMaxCachedFileBytes = 8 * 1024 * 1024;
+
+std::size_t staticFileWeight(const boost::shared_ptr<const StaticFile>& pFile)
+{
+   return pFile->memoryUsage();
+}
+
+// reads the stamp of a regular file; returns false if there's no such file
+bool readStamp(const FilePath& filePath, StaticFileStamp* pStamp)
+{
+#ifndef _WIN32
+   struct stat info;
+   if (::stat(filePath.getAbsolutePath().c_str(), &info) != 0 ||
+       !S_ISREG(info.st_mode))
+   {
+      return false;
+   }
+
+# ifdef __APPLE__
+   const struct timespec& modified = info.st_mtimespec;
+   const struct timespec& changed = info.st_ctimespec;
+# else
+   const struct timespec& modified = info.st_mtim;
+   const struct timespec& changed = info.st_ctim;
+# endif
+   pStamp->modificationTime = static_cast<std::int64_t>(modified.tv_sec) * 1000000000 + modified.tv_nsec;
+   pStamp->changeTime = static_cast<std::int64_t>(changed.tv_sec) * 1000000000 + changed.tv_nsec;
+   pStamp->inode = info.st_ino;
+   pStamp->size = info.st_size;
+#else
+   if (!filePath.exists() || filePath.isDirectory())
+      return false;
+
+   pStamp->modificationTime = static_cast<std::int64_t>(filePath.getLastWriteTime()) * 1000000000;
+   pStamp->changeTime = 0;
+   pStamp->inode = 0;
+   pStamp->size = filePath.getSize();
+#endif
+   return true;
+}
+
+#ifndef _WIN32
+Error compress(const std::string& input,
+               const std::string& encoding,
+               std::string* pOutput)
+{
+   using namespace boost::iostreams;
+
+   try
+   {
+      // this runs while the first request for the file waits, so use the
+      // default level (assets can ship a .gz built at the best level instead)
+      filtering_ostream compressStream;
+      if (encoding == kGzipEncoding)
+         compressStream.push(gzip_compressor(gzip_params(gzip::default_compression)));
+      else
+         compressStream.push(zlib_compressor(zlib_params(zlib::default_compression)));
+      compressStream.push(boost::iostreams::back_inserter(*pOutput));
+
+      compressStream.write(input.data(), input.size());
+
+      // pop the sink to flush the compressor
+      compressStream.reset();
+   }
+   catch(const std::exception& e)
+   {
+      Error error = systemError(boost::system::errc::io_error, ERROR_LOCATION);
+      error.addProperty("what", e.what());
+      return error;
+   }
+
+   return Success();
+}
+#endif
+
+} // anonymous namespace
+
+boost::shared_ptr<const std::string> StaticFile::contents(const std::string& encoding) const
+{
+   if (encoding.empty())
+      return pContents;
+   else if (encoding == kGzipEncoding)
+      return pGzipContents;
+   else if (encoding == kDeflateEncoding)
+      return pDeflateContents;
+   else
+      return boost::shared_ptr<const std::string>();
+}
+
+std::size_t StaticFile::memoryUsage() const
+{
+   std::size_t usage = sizeof(StaticFile) + eTag.size();
+   if (pContents)
+      usage += pContents->size();
+   if (pGzipContents)
+      usage += pGzipContents->size();
+   if (pDeflateContents)
+      usage += pDeflateContents->size();
+   return usage;
+}
+
+StaticFileCache::StaticFileCache(std::size_t maxBytes, std::size_t maxFileBytes)
+   : maxFileBytes_(maxFileBytes),
+     files_(maxBytes, boost::bind(staticFileWeight, _1)),
+     hits_(0),
+     misses_(0),
+     compressions_(0),
+     precompressedReads_(0)
+{
+}
+
+void StaticFileCache::addRoot(const FilePath& dir)
+{
+   LOCK_MUTEX(rootsMutex_)
+   {
+      roots_.push_back(dir);
+   }
+   END_LOCK_MUTEX
+}
+
+Error StaticFileCache::read(const FilePath& filePath,
+                            const std::string& encoding,
+                            boost::shared_ptr<const StaticFile>* pFile)
+{
+   pFile->reset();
+
+   // large files are never cached
+   StaticFileStamp stamp;
+   if (!readStamp(filePath, &stamp) ||
+       stamp.size > maxFileBytes_ ||
+       !isWithinRoots(filePath))
+   {
+      return Success();
+   }
+
+   // entries are validated against the file's current stamp, so changes on
+   // disk are picked up on the next read
+   std::string key = filePath.getAbsolutePath();
+   boost::shared_ptr<const StaticFile> pCached;
+   if (files_.get(key, &pCached) && pCached->stamp == stamp)
+   {
+      ++hits_;
+   }
+   else
+   {
+      ++misses_;
+
+      boost::shared_ptr<StaticFile> pRead;
+      Error error = readFile(filePath, stamp, &pRead);
+      if (error)
+         return error;
+
+      pCached = pRead;
+      files_.insert(key, pCached);
+   }
+
+#ifndef _WIN32
+   // produce the requested encoding if we haven't already; entries are
+   // immutable (other threads may be serving them) so we make a shallow copy
+   bool compressed = encoding == kGzipEncoding || encoding == kDeflateEncoding;
+   if (compressed && !pCached->contents(encoding))
+   {
+      boost::shared_ptr<StaticFile> pEncoded(new StaticFile(*pCached));
+      Error error = addEncoding(filePath, encoding, pEncoded.get());
+      if (error)
+         return error;
+
+      pCached = pEncoded;
+      files_.insert(key, pCached);
+   }
+#endif
+
+   *pFile = pCached;
+   return Success();
+}
+
+bool StaticFileCache::isCacheable(const FilePath& filePath)
+{
+   StaticFileStamp stamp;
+   return readStamp(filePath, &stamp) &&
+          stamp.size <= maxFileBytes_ &&
+          isWithinRoots(filePath);
+}
+
+bool StaticFileCache::isWithinRoots(const FilePath& filePath)
+{
+   LOCK_MUTEX(rootsMutex_)
+   {
+      for (const FilePath& root : roots_)
+      {
+         if (filePath.isWithin(root))
+            return true;
+      }
+   }
+   END_LOCK_MUTEX
+
+   return false;
+}
+
+StaticFileCache::Stats StaticFileCache::stats()
+{
+   Stats stats;
+   stats.hits = hits_;
+   stats.misses = misses_;
+   stats.compressions = compressions_;
+   stats.precompressedReads = precompressedReads_;
+   stats.entries = files_.size();
+   stats.bytes = files_.weight();
+   return stats;
+}
+
+Error StaticFileCache::readFile(const FilePath& filePath,
+                                const StaticFileStamp& stamp,
+                                boost::shared_ptr<StaticFile>* pFile)
+{
+   boost::shared_ptr<std::string> pContents(new std::string());
+   pContents->reserve(stamp.size);
+   Error error = core::readStringFromFile(filePath, pContents.get());
+   if (error)
+      return error;
+
+   pFile->reset(new StaticFile());
+   (*pFile)->stamp = stamp;
+   (*pFile)->eTag = core::hash::crc32Hash(*pContents);
+   (*pFile)->pContents = pContents;
+   return Success();
+}
+
+#ifndef _WIN32
+Error StaticFileCache::addEncoding(const FilePath& filePath,
+                                   const std::string& encoding,
+                                   StaticFile* pFile)
+{
+   boost::shared_ptr<std::string> pEncoded(new std::string());
+
+   // prefer a gzip variant produced at build time when it is at least as
+   // new as the file itself
+   FilePath gzipPath(filePath.getAbsolutePath() + ".gz");
+   StaticFileStamp gzipStamp;
+   if (encoding == kGzipEncoding &&
+       readStamp(gzipPath, &gzipStamp) &&
+       gzipStamp.modificationTime >= pFile->stamp.modificationTime)
+   {
+      Error error = core::readStringFromFile(gzipPath, pEncoded.get());
+      if (error)
+         return error;
+
+      ++precompressedReads_;
+   }
+   else
+   {
+      Error error = compress(*pFile->pContents, encoding, pEncoded.get());
+      if (error)
+         return error;
+
+      ++compressions_;
+   }
+
+   if (encoding == kGzipEncoding)
+      pFile->pGzipContents = pEncoded;
+   else
+      pFile->pDeflateContents = pEncoded;
+
+   return Success();
+}
+#endif
+
+StaticFileCache& staticFileCache()
+{
+   static StaticFileCache instance(kMaxCacheBytes, kMaxCachedFileBytes);
+   return instance;
+}
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
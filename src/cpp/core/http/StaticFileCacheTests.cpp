@@ -0,0 +1,243 @@
+/*
+ * StaticFileCacheTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <tests/TestThat.hpp>
+
+#include <sstream>
+
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <core/FileSerializer.hpp>
+#include <core/http/Request.hpp>
+#include <core/http/Response.hpp>
+#include <core/http/StaticFileCache.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+namespace tests {
+
+namespace {
+
+std::string gunzip(const std::string& compressed)
+{
+   std::istringstream input(compressed);
+   std::ostringstream output;
+   boost::iostreams::filtering_istream decompressStream;
+   decompressStream.push(boost::iostreams::gzip_decompressor());
+   decompressStream.push(input);
+   boost::iostreams::copy(decompressStream, output);
+   return output.str();
+}
+
+FilePath writeTempFile(const std::string& contents)
+{
+   FilePath filePath;
+   REQUIRE_FALSE(FilePath::tempFilePath(".js", filePath));
+   REQUIRE_FALSE(writeStringToFile(filePath, contents));
+   return filePath;
+}
+
+FilePath tempDir()
+{
+   FilePath filePath;
+   REQUIRE_FALSE(FilePath::tempFilePath(".js", filePath));
+   return filePath.getParent();
+}
+
+} // anonymous namespace
+
+test_context("StaticFileCache")
+{
+   std::string contents;
+   for (int i = 0; i < 1000; i++)
+      contents += "function f() { return 42; }\n";
+
+   test_that("Repeated reads are served from the cache")
+   {
+      StaticFileCache cache(1024 * 1024, 512 * 1024);
+      cache.addRoot(tempDir());
+      FilePath filePath = writeTempFile(contents);
+
+      boost::shared_ptr<const StaticFile> pFile;
+      REQUIRE_FALSE(cache.read(filePath, std::string(), &pFile));
+      REQUIRE(pFile);
+      expect_true(*pFile->pContents == contents);
+      expect_true(!pFile->eTag.empty());
+
+      boost::shared_ptr<const StaticFile> pCached;
+      REQUIRE_FALSE(cache.read(filePath, std::string(), &pCached));
+      expect_true(pCached == pFile);
+
+      StaticFileCache::Stats stats = cache.stats();
+      expect_true(stats.hits == 1);
+      expect_true(stats.misses == 1);
+      expect_true(stats.entries == 1);
+
+      filePath.remove();
+   }
+
+   test_that("Compressed variants are produced once")
+   {
+      StaticFileCache cache(1024 * 1024, 512 * 1024);
+      cache.addRoot(tempDir());
+      FilePath filePath = writeTempFile(contents);
+
+      boost::shared_ptr<const StaticFile> pFile;
+      REQUIRE_FALSE(cache.read(filePath, kGzipEncoding, &pFile));
+      REQUIRE(pFile->pGzipContents);
+      expect_true(pFile->pGzipContents->size() < contents.size());
+      expect_true(gunzip(*pFile->pGzipContents) == contents);
+
+      REQUIRE_FALSE(cache.read(filePath, kGzipEncoding, &pFile));
+      REQUIRE_FALSE(cache.read(filePath, std::string(), &pFile));
+      expect_true(pFile->pGzipContents);
+
+      REQUIRE_FALSE(cache.read(filePath, kDeflateEncoding, &pFile));
+      expect_true(pFile->pDeflateContents);
+
+      StaticFileCache::Stats stats = cache.stats();
+      expect_true(stats.compressions == 2);
+      expect_true(stats.misses == 1);
+      expect_true(stats.bytes >= contents.size() + pFile->pGzipContents->size());
+
+      filePath.remove();
+   }
+
+   test_that("Modified files are re-read")
+   {
+      StaticFileCache cache(1024 * 1024, 512 * 1024);
+      cache.addRoot(tempDir());
+      FilePath filePath = writeTempFile(contents);
+
+      boost::shared_ptr<const StaticFile> pFile;
+      REQUIRE_FALSE(cache.read(filePath, std::string(), &pFile));
+      std::string eTag = pFile->eTag;
+
+      REQUIRE_FALSE(writeStringToFile(filePath, contents + "f();\n"));
+      REQUIRE_FALSE(cache.read(filePath, std::string(), &pFile));
+      expect_true(*pFile->pContents == contents + "f();\n");
+      expect_true(pFile->eTag != eTag);
+      expect_true(cache.stats().misses == 2);
+
+      // a rewrite of the same size, within the same second (after a pause
+      // for the file system's clock to tick)
+      boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+      std::string rewritten = contents + "g();\n";
+      REQUIRE_FALSE(writeStringToFile(filePath, rewritten));
+      REQUIRE_FALSE(cache.read(filePath, std::string(), &pFile));
+      expect_true(*pFile->pContents == rewritten);
+      expect_true(cache.stats().misses == 3);
+
+      filePath.remove();
+   }
+
+   test_that("Files outside the cache's roots are not cached")
+   {
+      StaticFileCache cache(1024 * 1024, 512 * 1024);
+      FilePath filePath = writeTempFile(contents);
+
+      boost::shared_ptr<const StaticFile> pFile;
+      REQUIRE_FALSE(cache.read(filePath, std::string(), &pFile));
+      expect_true(!pFile);
+      expect_false(cache.isCacheable(filePath));
+      expect_true(cache.stats().entries == 0);
+
+      filePath.remove();
+   }
+
+   test_that("Sibling gzip files are used when present")
+   {
+      StaticFileCache cache(1024 * 1024, 512 * 1024);
+      cache.addRoot(tempDir());
+      FilePath filePath = writeTempFile(contents);
+      FilePath gzipPath(filePath.getAbsolutePath() + ".gz");
+      REQUIRE_FALSE(writeStringToFile(gzipPath, "precompressed"));
+
+      boost::shared_ptr<const StaticFile> pFile;
+      REQUIRE_FALSE(cache.read(filePath, kGzipEncoding, &pFile));
+      expect_true(*pFile->pGzipContents == "precompressed");
+      expect_true(cache.stats().precompressedReads == 1);
+      expect_true(cache.stats().compressions == 0);
+
+      gzipPath.remove();
+      filePath.remove();
+   }
+
+   test_that("Large files are not cached and the cache stays bounded")
+   {
+      StaticFileCache cache(3 * contents.size(), 2 * contents.size());
+      cache.addRoot(tempDir());
+      FilePath largePath = writeTempFile(contents + contents + contents);
+
+      boost::shared_ptr<const StaticFile> pFile;
+      REQUIRE_FALSE(cache.read(largePath, std::string(), &pFile));
+      expect_true(!pFile);
+      expect_false(cache.isCacheable(largePath));
+
+      std::vector<FilePath> paths;
+      for (int i = 0; i < 5; i++)
+      {
+         paths.push_back(writeTempFile(contents));
+         REQUIRE_FALSE(cache.read(paths.back(), std::string(), &pFile));
+         expect_true(pFile);
+      }
+
+      expect_true(cache.stats().entries < 3);
+      expect_true(cache.stats().bytes <= 3 * contents.size());
+
+      for (const FilePath& path : paths)
+         path.remove();
+      largePath.remove();
+   }
+
+   test_that("Cacheable file responses honor etags and encodings")
+   {
+      FilePath filePath = writeTempFile(contents);
+      staticFileCache().addRoot(filePath.getParent());
+
+      Request request;
+      request.setHeader("Accept-Encoding", "gzip, deflate");
+
+      Response response;
+      response.setContentEncoding(kGzipEncoding);
+      REQUIRE_FALSE(response.setCacheableBody(filePath, request));
+      expect_true(response.statusCode() == status::Ok);
+      expect_true(gunzip(response.body()) == contents);
+
+      std::string eTag = response.headerValue("ETag");
+      expect_true(!eTag.empty());
+
+      request.setHeader("If-None-Match", eTag);
+      Response notModified;
+      REQUIRE_FALSE(notModified.setCacheableBody(filePath, request));
+      expect_true(notModified.statusCode() == status::NotModified);
+
+      Response fileResponse;
+      fileResponse.setFile(filePath, request);
+      expect_true(fileResponse.contentEncoding() == kGzipEncoding);
+      expect_true(gunzip(fileResponse.body()) == contents);
+
+      filePath.remove();
+   }
+}
+
+} // namespace tests
+} // namespace http
+} // namespace core
+} // namespace rstudio
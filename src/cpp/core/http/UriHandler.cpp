@@ -107,6 +107,11 @@ bool UriHandler::matches(const std::string& uri) const
    return boost::algorithm::starts_with(uri, prefix_);
 }
 
+const std::string& UriHandler::prefix() const
+{
+   return prefix_;
+}
+
 UriAsyncHandlerFunctionVariant UriHandler::function() const
 {
    return function_;
@@ -131,18 +136,16 @@ void UriHandler::operator()(const Request& request,
    
 void UriHandlers::add(const UriHandler& handler) 
 {
+   prefixTree_.insert(handler.prefix(), uriHandlers_.size());
    uriHandlers_.push_back(handler);
 }
 
 boost::optional<UriAsyncHandlerFunctionVariant> UriHandlers::handlerFor(const std::string& uri) const
 {
-   std::vector<UriHandler>::const_iterator handler = std::find_if(
-                              uriHandlers_.begin(), 
-                              uriHandlers_.end(), 
-                              boost::bind(&UriHandler::matches, _1, uri));
-   if ( handler != uriHandlers_.end() )
+   boost::optional<std::size_t> index = prefixTree_.lookup(uri);
+   if (index)
    {
-      return handler->function();
+      return uriHandlers_[index.get()].function();
    }
    else
    {
@@ -0,0 +1,167 @@
+/*
+ * UriPrefixTree.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <core/http/UriPrefixTree.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+const std::size_t UriPrefixTree::kNoIndex = std::numeric_limits<std::size_t>::max();
+
+UriPrefixTree::UriPrefixTree()
+   : size_(0)
+{
+   // root node (empty label)
+   nodes_.push_back(Node());
+}
+
+void UriPrefixTree::insert(const std::string& prefix, std::size_t index)
+{
+   std::size_t node = 0;
+   std::size_t pos = 0;
+
+   // note that we refer to nodes by index rather than by reference
+   // throughout since adding nodes can reallocate the node vector
+   while (pos < prefix.size())
+   {
+      std::size_t child = findChild(nodes_[node], prefix[pos]);
+
+      // no edge starting with this character: add a leaf for the remainder
+      if (child == kNoIndex)
+      {
+         Node leaf;
+         leaf.label = prefix.substr(pos);
+         leaf.index = index;
+         leaf.best = std::min(index, nodes_[node].best);
+         nodes_.push_back(leaf);
+         addChild(node, nodes_.size() - 1);
+         ++size_;
+         return;
+      }
+
+      // determine how much of the child's label we share
+      const std::string& label = nodes_[child].label;
+      std::size_t common = 0;
+      while (common < label.size() &&
+             pos + common < prefix.size() &&
+             label[common] == prefix[pos + common])
+      {
+         ++common;
+      }
+
+      // partial match: split the edge so that the shared part becomes
+      // its own (non-terminal) node
+      if (common < label.size())
+      {
+         Node split;
+         split.label = label.substr(0, common);
+         split.best = nodes_[node].best;
+         split.children.push_back(child);
+         nodes_[child].label.erase(0, common);
+         nodes_.push_back(split);
+
+         // the split node starts with the same character as the node it
+         // replaces so the parent's ordering of children is preserved
+         std::size_t splitIndex = nodes_.size() - 1;
+         std::replace(nodes_[node].children.begin(),
+                      nodes_[node].children.end(),
+                      child,
+                      splitIndex);
+         child = splitIndex;
+      }
+
+      node = child;
+      pos += common;
+   }
+
+   // the prefix ends exactly at this node; if the same prefix was already
+   // registered then the earlier registration continues to win
+   if (nodes_[node].index != kNoIndex)
+      return;
+
+   nodes_[node].index = index;
+   ++size_;
+   propagateBest(node, std::min(index, nodes_[node].best));
+}
+
+boost::optional<std::size_t> UriPrefixTree::lookup(const std::string& uri) const
+{
+   std::size_t node = 0;
+   std::size_t pos = 0;
+   std::size_t best = nodes_[0].best;
+
+   while (pos < uri.size())
+   {
+      std::size_t child = findChild(nodes_[node], uri[pos]);
+      if (child == kNoIndex)
+         break;
+
+      // prefixes only end on node boundaries so a partial edge match
+      // can't produce any additional matches
+      const std::string& label = nodes_[child].label;
+      if (uri.compare(pos, label.size(), label) != 0)
+         break;
+
+      node = child;
+      pos += label.size();
+      best = nodes_[node].best;
+   }
+
+   if (best == kNoIndex)
+      return boost::none;
+   else
+      return best;
+}
+
+std::size_t UriPrefixTree::findChild(const Node& node, char ch) const
+{
+   for (std::size_t child : node.children)
+   {
+      char first = nodes_[child].label[0];
+      if (first == ch)
+         return child;
+      else if (first > ch)
+         break;
+   }
+
+   return kNoIndex;
+}
+
+void UriPrefixTree::addChild(std::size_t parent, std::size_t child)
+{
+   char ch = nodes_[child].label[0];
+   std::vector<std::size_t>& children = nodes_[parent].children;
+
+   std::vector<std::size_t>::iterator it = children.begin();
+   while (it != children.end() && nodes_[*it].label[0] < ch)
+      ++it;
+
+   children.insert(it, child);
+}
+
+void UriPrefixTree::propagateBest(std::size_t node, std::size_t best)
+{
+   nodes_[node].best = best;
+   for (std::size_t child : nodes_[node].children)
+      propagateBest(child, std::min(nodes_[child].index, best));
+}
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
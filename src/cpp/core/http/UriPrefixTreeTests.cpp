@@ -0,0 +1,181 @@
+/*
+ * UriPrefixTreeTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <tests/TestThat.hpp>
+
+#include <core/http/AsyncUriHandler.hpp>
+#include <core/http/UriPrefixTree.hpp>
+
+#include <boost/lexical_cast.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+namespace tests {
+
+namespace {
+
+// linear scan over the registration list; the reference behavior
+// which the prefix tree must reproduce
+boost::optional<std::size_t> linearLookup(const std::vector<std::string>& prefixes,
+                                          const std::string& uri)
+{
+   for (std::size_t i = 0; i < prefixes.size(); ++i)
+      if (boost::algorithm::starts_with(uri, prefixes[i]))
+         return i;
+
+   return boost::none;
+}
+
+std::vector<std::string> rpcPrefixes(std::size_t count)
+{
+   std::vector<std::string> prefixes;
+   prefixes.push_back("/events");
+   prefixes.push_back("/file_show");
+   prefixes.push_back("/grid_resource");
+   for (std::size_t i = 0; prefixes.size() < count; ++i)
+      prefixes.push_back("/rpc/method_" + boost::lexical_cast<std::string>(i));
+   prefixes.push_back("/");
+   return prefixes;
+}
+
+} // anonymous namespace
+
+test_context("UriPrefixTree")
+{
+   test_that("Lookup finds registered prefixes")
+   {
+      UriPrefixTree tree;
+      tree.insert("/rpc/console_input", 0);
+      tree.insert("/rpc/consoleCommand", 1);
+      tree.insert("/file_show", 2);
+
+      expect_true(tree.lookup("/rpc/console_input") == std::size_t(0));
+      expect_true(tree.lookup("/rpc/consoleCommand?x=1") == std::size_t(1));
+      expect_true(tree.lookup("/file_show/path/to/file") == std::size_t(2));
+      expect_true(!tree.lookup("/rpc/console"));
+      expect_true(!tree.lookup("/rpc/"));
+      expect_true(!tree.lookup(""));
+      expect_true(tree.size() == 3);
+   }
+
+   test_that("The first registered matching prefix wins")
+   {
+      UriPrefixTree tree;
+      tree.insert("/rpc/foo", 0);
+      tree.insert("/rpc", 1);
+      tree.insert("/rpc/foo/bar", 2);
+      tree.insert("/rpc", 3);
+
+      expect_true(tree.lookup("/rpc/foo/bar") == std::size_t(0));
+      expect_true(tree.lookup("/rpc/fo") == std::size_t(1));
+      expect_true(tree.lookup("/rpcx") == std::size_t(1));
+      expect_true(tree.size() == 3);
+   }
+
+   test_that("Shorter prefixes registered first shadow longer ones")
+   {
+      UriPrefixTree tree;
+      tree.insert("/rpc/foo/bar", 0);
+      tree.insert("/rpc/foo/baz", 1);
+      tree.insert("/rpc/foo", 2);
+      tree.insert("/", 3);
+
+      expect_true(tree.lookup("/rpc/foo/baz") == std::size_t(1));
+      expect_true(tree.lookup("/rpc/foo/bat") == std::size_t(2));
+      expect_true(tree.lookup("/other") == std::size_t(3));
+
+      UriPrefixTree shadowed;
+      shadowed.insert("/", 0);
+      shadowed.insert("/rpc/foo", 1);
+      expect_true(shadowed.lookup("/rpc/foo") == std::size_t(0));
+   }
+
+   test_that("Empty prefix matches everything")
+   {
+      UriPrefixTree tree;
+      tree.insert("/a", 0);
+      tree.insert("", 1);
+
+      expect_true(tree.lookup("/a") == std::size_t(0));
+      expect_true(tree.lookup("/b") == std::size_t(1));
+      expect_true(tree.lookup("") == std::size_t(1));
+   }
+
+   test_that("Lookup agrees with a linear scan")
+   {
+      std::vector<std::string> prefixes = rpcPrefixes(200);
+      prefixes.insert(prefixes.begin() + 10, "/rpc/method_1");
+      prefixes.insert(prefixes.begin() + 20, "/rpc/method_12");
+
+      UriPrefixTree tree;
+      for (std::size_t i = 0; i < prefixes.size(); ++i)
+         tree.insert(prefixes[i], i);
+
+      std::vector<std::string> uris = prefixes;
+      uris.push_back("/rpc/method_123");
+      uris.push_back("/rpc/method_");
+      uris.push_back("/rpc/unknown");
+      uris.push_back("/events/get_events");
+      uris.push_back("");
+      uris.push_back("events");
+
+      for (const std::string& uri : uris)
+         expect_true(tree.lookup(uri) == linearLookup(prefixes, uri));
+   }
+
+   test_that("AsyncUriHandlers dispatches through the prefix tree")
+   {
+      AsyncUriHandlers handlers;
+      handlers.add(AsyncUriHandler("/rpc/foo", AsyncUriHandlerFunction(), true));
+      handlers.add(AsyncUriHandler("/rpc", AsyncUriHandlerFunction(), false));
+
+      expect_true(handlers.handlerFor("/rpc/foo").prefix() == "/rpc/foo");
+      expect_true(handlers.handlerFor("/rpc/foo").isProxyHandler());
+      expect_true(handlers.handlerFor("/rpc/bar").prefix() == "/rpc");
+      expect_true(!handlers.handlerFor("/other").function());
+   }
+}
+
+benchmark_context("UriPrefixTree lookup")
+{
+   // no registered rpc matches so a linear scan falls through to "/"
+   const char* uri = "/rpc/unknown";
+
+   for (std::size_t count : { 10, 100, 1000 })
+   {
+      std::vector<std::string> prefixes = rpcPrefixes(count);
+      UriPrefixTree tree;
+      for (std::size_t i = 0; i < prefixes.size(); ++i)
+         tree.insert(prefixes[i], i);
+
+      std::string suffix = " (" + boost::lexical_cast<std::string>(count) + " handlers)";
+
+      benchmark_that("Linear scan" + suffix)
+      {
+         return linearLookup(prefixes, uri);
+      };
+
+      benchmark_that("Prefix tree" + suffix)
+      {
+         return tree.lookup(uri);
+      };
+   }
+}
+
+} // namespace tests
+} // namespace http
+} // namespace core
+} // namespace rstudio
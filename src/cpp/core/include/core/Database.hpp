@@ -19,7 +19,11 @@
 #include <core/Thread.hpp>
 #include <shared_core/FilePath.hpp>
 
+#include <list>
+#include <map>
+
 #include <boost/assign.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/optional.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/variant.hpp>
@@ -71,8 +75,12 @@ using OutputParameter = soci::details::into_type_ptr;
 
 class Connection;
 class ConnectionPool;
+class StatementCache;
 class Transaction;
 
+// a prepared statement on loan to a query from a statement cache
+struct CachedStatement;
+
 class Query
 {
 public:
@@ -115,9 +123,52 @@ public:
 private:
    friend class Connection;
    friend class Rowset;
+   friend class StatementCache;
+
+   Query(const boost::shared_ptr<CachedStatement>& pCachedStatement);
 
    soci::statement statement_;
    boost::optional<soci::soci_error> prepareError_;
+
+   // set when the statement came from a statement cache, which gets it back
+   // once the last copy of the query is gone
+   boost::shared_ptr<CachedStatement> pCachedStatement_;
+};
+
+// prepared statements kept by a connection for reuse, keyed by their sql text.
+// the least recently used statement is dropped once the cache is full
+class StatementCache : public boost::enable_shared_from_this<StatementCache>,
+                       boost::noncopyable
+{
+public:
+   explicit StatementCache(std::size_t capacity);
+
+   // a query for the sql, reusing a statement prepared for it earlier if
+   // one is free
+   Query query(const std::string& sqlStatement, soci::session& session);
+
+   // drops all cached statements (e.g. after the schema changes)
+   void clear();
+
+   std::size_t size() const;
+   std::size_t hits() const;
+   std::size_t misses() const;
+
+private:
+   friend struct CachedStatement;
+
+   typedef std::list<std::pair<std::string, soci::statement> > StatementList;
+
+   void release(const std::string& sqlStatement, const soci::statement& statement);
+
+   std::size_t capacity_;
+   std::size_t hits_;
+   std::size_t misses_;
+
+   // most recently used first
+   StatementList statements_;
+   std::map<std::string, StatementList::iterator> index_;
+   mutable boost::mutex mutex_;
 };
 
 using Row = soci::row;
@@ -186,6 +237,8 @@ public:
 
    soci::session& session() override { return session_; }
 
+   const StatementCache& statementCache() const { return *pStatementCache_; }
+
 private:
    friend class ConnectVisitor;
    friend class Transaction;
@@ -195,6 +248,7 @@ private:
               const std::string& connectionStr);
 
    soci::session session_;
+   boost::shared_ptr<StatementCache> pStatementCache_;
 };
 
 class PooledConnection : public IConnection
@@ -216,6 +270,8 @@ public:
 
    soci::session& session() override { return connection_->session(); }
 
+   const StatementCache& statementCache() const { return connection_->statementCache(); }
+
 private:
    friend class ConnectionPool;
 
@@ -0,0 +1,135 @@
+/*
+ * FileSearch.hpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_FILE_SEARCH_HPP
+#define CORE_FILE_SEARCH_HPP
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <shared_core/FilePath.hpp>
+
+namespace rstudio {
+namespace core {
+
+class Error;
+
+namespace file_search {
+
+// In-process replacement for 'grep -r': walks one or more directory trees
+// on a pool of worker threads and reports matching lines along with the
+// byte offsets of each match. Results are collected as each file is
+// searched so callers can stream them while the search is still running.
+
+struct SearchOptions
+{
+   SearchOptions()
+      : asRegex(false),
+        ignoreCase(false),
+        excludeGitIgnore(false),
+        maxThreads(0)
+   {
+   }
+
+   // the pattern to search for, in the encoding of the files searched
+   std::string pattern;
+
+   // treat pattern as a POSIX extended regular expression (as 'grep -E')
+   bool asRegex;
+
+   bool ignoreCase;
+
+   // glob patterns for files to include (all files if empty) and exclude;
+   // patterns containing a '/' are matched against the path relative to
+   // the search root, others against the file name
+   std::vector<std::string> includePatterns;
+   std::vector<std::string> excludePatterns;
+
+   // skip files and directories matched by .gitignore (and .git/info/exclude)
+   bool excludeGitIgnore;
+
+   // return true to skip a file or (along with its contents) a directory;
+   // invoked on worker threads
+   boost::function<bool(const std::string& path, bool isDirectory)> skipPath;
+
+   // number of worker threads; 0 to choose based on the hardware
+   std::size_t maxThreads;
+};
+
+struct LineMatch
+{
+   // 1-based line number
+   int line;
+
+   // contents of the line, without its line terminator
+   std::string contents;
+
+   // [begin, end) byte offsets of each match within contents
+   std::vector<std::pair<std::size_t, std::size_t> > ranges;
+};
+
+struct FileMatches
+{
+   FilePath file;
+   std::vector<LineMatch> lines;
+};
+
+// match a glob (supporting '*', '?', '[...]' and '**') against text; when
+// pathname is true wildcards other than '**' don't match '/'
+bool globMatch(const std::string& pattern, const std::string& text, bool pathname = true);
+
+// returns a literal string that must appear in every match of an extended
+// regular expression (or an empty string when there's no such literal)
+std::string requiredLiteral(const std::string& pattern);
+
+// find all matches of options.pattern within a single buffer
+Error searchBuffer(const std::string& buffer,
+                   const SearchOptions& options,
+                   std::vector<LineMatch>* pMatches);
+
+class FileSearch : boost::noncopyable
+{
+public:
+   FileSearch();
+   ~FileSearch();
+
+   // begin searching the given directories in the background; fails if the
+   // pattern can't be compiled
+   Error start(const std::vector<FilePath>& roots, const SearchOptions& options);
+
+   // move results found since the last call into pResults
+   void takeResults(std::vector<FileMatches>* pResults);
+
+   // have all files been searched? (results may still be waiting to be taken)
+   bool isComplete() const;
+
+   // cancel the search and wait for the workers to exit
+   void stop();
+
+private:
+   struct Impl;
+   boost::shared_ptr<Impl> pImpl_;
+};
+
+} // namespace file_search
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_FILE_SEARCH_HPP
@@ -0,0 +1,74 @@
+/*
+ * FuzzyMatcher.hpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_FUZZY_MATCHER_HPP
+#define CORE_FUZZY_MATCHER_HPP
+
+#include <climits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/function.hpp>
+
+namespace rstudio {
+namespace core {
+
+// Scores candidates (symbol or file names) against a code search query;
+// lower scores are better. Query characters are matched in order, with a
+// penalty for each match based on how far into the candidate it is (smaller
+// after '_', '-' or, for symbols, '.'), a bonus for case-exact matches and a
+// large penalty for each query character left unmatched.
+//
+// NOTE: When modifying the scoring, you should ensure that corresponding
+// changes are made to the client side scoreMatch function as well
+// (See: CodeSearchOracle.java)
+class FuzzyMatcher
+{
+public:
+   FuzzyMatcher(const std::string& query, bool isFile);
+
+   // score a candidate; returns INT_MAX as soon as the score is known to be
+   // no better than limit
+   int score(const std::string& candidate, int limit = INT_MAX) const
+   {
+      return score(candidate.data(), candidate.size(), limit);
+   }
+
+   int score(const char* candidate, std::size_t size, int limit) const;
+
+private:
+   std::string query_;
+   bool isFile_;
+};
+
+// files that are rarely the target of a search (generated code and docs)
+bool isUninterestingFile(const std::string& filename);
+
+// find the (up to) k best scoring candidates as (index, score) pairs, ordered
+// by score and then index. large inputs are scored in parallel batches;
+// isCancelled (called only on the calling thread, between batches) can
+// abandon the search, in which case false is returned.
+bool findBestMatches(const std::vector<std::string>& candidates,
+                     const std::string& query,
+                     bool isFile,
+                     std::size_t k,
+                     std::vector<std::pair<int, int> >* pMatches,
+                     const boost::function<bool()>& isCancelled = boost::function<bool()>());
+
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_FUZZY_MATCHER_HPP
@@ -15,6 +15,10 @@
 #ifndef CORE_GITGRAPH_HPP
 #define CORE_GITGRAPH_HPP
 
+#include <stdint.h>
+
+#include <iosfwd>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -80,6 +84,55 @@ private:
    Line pendingLine_;
 };
 
+// The commits of a history in display order (children before parents),
+// along with their graph. Commits are held compactly (ids in a single
+// buffer, parents as indexes) so that the history of a large repository
+// can be kept in memory, and the graph is laid out only as far as the
+// lines requested so far, so paging through a history lays out each line
+// once rather than laying out every line above each page.
+class CommitGraph : boost::noncopyable
+{
+public:
+   CommitGraph();
+
+   // replaces the commits with the output of 'git rev-list --parents' (one
+   // line per commit, holding the commit followed by its parents)
+   void assign(const std::vector<std::string>& revList);
+
+   // adds commits (the output of 'git rev-list --parents', none of which
+   // may be ancestors of the existing commits) above the existing commits;
+   // the graph is laid out again
+   void prepend(const std::vector<std::string>& revList);
+
+   bool empty() const { return size() == 0; }
+   std::size_t size() const { return parentOffsets_.size() - 1; }
+
+   std::string commit(std::size_t index) const;
+   std::vector<std::string> parents(std::size_t index) const;
+
+   // the graph line for a commit (see Line::string)
+   std::string line(std::size_t index);
+
+   // writes the commits (but not the graph), one line per commit holding
+   // its id followed by the indexes of its parents
+   void write(std::ostream& os) const;
+
+   // reads commits written by write (returning false if they're malformed)
+   bool read(std::istream& is);
+
+private:
+   void build(const std::vector<std::string>& revList, bool prepend);
+   void resetLayout();
+
+   std::size_t idLength_;
+   std::string ids_;
+   std::vector<uint32_t> parentOffsets_;
+   std::vector<uint32_t> parents_;
+
+   std::unique_ptr<GitGraph> pLayout_;
+   std::vector<std::string> lines_;
+};
+
 } // namespace gitgraph
 } // namespace core
 } // namespace rstudio
@@ -0,0 +1,101 @@
+/*
+ * TrigramIndex.hpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_TRIGRAM_INDEX_HPP
+#define CORE_TRIGRAM_INDEX_HPP
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+namespace rstudio {
+namespace core {
+
+class Error;
+class FilePath;
+
+// Inverted index from the trigrams (runs of three bytes within a line, with
+// ASCII letters folded to lower case) of a set of documents to the documents
+// that contain them. Used to narrow down the documents that could contain a
+// literal string without reading them. Each document also carries an opaque
+// payload which is persisted along with the index, and a modification time
+// (for files, in nanoseconds so that edits within a second are told apart).
+//
+// Removed and replaced documents are tombstoned and dropped from the posting
+// lists in bulk once they make up a large part of the index.
+class TrigramIndex : boost::noncopyable
+{
+public:
+   TrigramIndex();
+
+   // add or replace a document
+   void update(const std::string& name,
+               std::int64_t modified,
+               const std::string& contents,
+               const std::string& payload = std::string());
+
+   void remove(const std::string& name);
+
+   void clear();
+
+   // number of documents in the index
+   std::size_t size() const;
+
+   // has the document been indexed as of the given modification time?
+   bool isCurrent(const std::string& name, std::int64_t modified) const;
+
+   // payload of an indexed document
+   bool getPayload(const std::string& name, std::string* pPayload) const;
+
+   // names and modification times of all indexed documents
+   void listDocuments(std::vector<std::pair<std::string, std::int64_t> >* pDocuments) const;
+
+   // find the documents which may contain literal (compared ignoring ASCII
+   // case); returns false when the literal is too short to narrow the search
+   bool findCandidates(const std::string& literal, std::set<std::string>* pNames) const;
+
+   // has the index changed since it was last read or written?
+   bool isDirty() const { return dirty_; }
+
+   Error readFromFile(const FilePath& filePath);
+   Error writeToFile(const FilePath& filePath);
+
+private:
+   struct Document
+   {
+      std::string name;
+      std::int64_t modified;
+      std::string payload;
+      bool removed;
+   };
+
+   void removeDocument(std::uint32_t id);
+   void compact(bool force = false);
+
+   std::vector<Document> documents_;
+   std::unordered_map<std::string, std::uint32_t> ids_;
+   std::unordered_map<std::uint32_t, std::vector<std::uint32_t> > postings_;
+   std::size_t removedDocuments_;
+   bool dirty_;
+};
+
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_TRIGRAM_INDEX_HPP
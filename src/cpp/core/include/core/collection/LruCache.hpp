@@ -19,6 +19,8 @@
 #include <map>
 #include <deque>
 
+#include <boost/function.hpp>
+
 #include <shared_core/Error.hpp>
 #include <core/Thread.hpp>
 
@@ -30,7 +32,15 @@ template <typename KeyType, typename ValueType>
 class LruCache
 {
 public:
-   LruCache(unsigned int maxSize) : maxSize_(maxSize) {}
+   typedef boost::function<std::size_t(const ValueType&)> WeightFunction;
+
+   LruCache(unsigned int maxSize) : maxWeight_(maxSize), weight_(0) {}
+
+   // creates a cache bounded by the total weight of its values (e.g. their
+   // size in bytes) rather than by the number of values
+   LruCache(std::size_t maxWeight, const WeightFunction& weightFunction)
+      : maxWeight_(maxWeight), weightFunction_(weightFunction), weight_(0) {}
+
    virtual ~LruCache() {}
 
    void insert(const KeyType& key,
@@ -38,6 +48,8 @@ public:
    {
       LOCK_MUTEX(mutex_)
       {
+         std::size_t weight = weightFunction_ ? weightFunction_(value) : 1;
+
          if (map_.count(key) > 0)
          {
             // entry for this key already exists - we are updating the value instead of inserting it
@@ -45,28 +57,27 @@ public:
             // so that this entry's LRU "time" is effectively updated
             auto pNode = map_[key];
             pNode->value = value;
+            weight_ = weight_ - pNode->weight + weight;
+            pNode->weight = weight;
             removeNode(pNode);
             addNode(pNode);
+
+            // the updated value may be heavier than the one it replaced
+            while (weight_ > maxWeight_ && backNode_ != pNode)
+               removeBackNode();
          }
          else
          {
-            if (map_.size() >= maxSize_)
-            {
-               // the cache has reached maximum size
-               // remove the oldest item from the cache which is at the back of the node chain
-               auto pNode = backNode_;
-               removeNode(pNode);
-
-               // erase the node from the map
-               // when this block goes out of scope, there are no more references
-               // to the expired node pointer, so it is freed
-               map_.erase(pNode->key);
-            }
+            // if the cache has reached maximum size, remove the oldest items
+            // from the cache (which are at the back of the node chain)
+            while (backNode_ && weight_ + weight > maxWeight_)
+               removeBackNode();
 
             // create a new node and store it
-            auto pNode = boost::shared_ptr<Node>(new Node(key, value));
+            auto pNode = boost::shared_ptr<Node>(new Node(key, value, weight));
             addNode(pNode);
             map_[key] = pNode;
+            weight_ += weight;
          }
       }
       END_LOCK_MUTEX
@@ -105,6 +116,7 @@ public:
 
          auto pNode = iter->second;
          removeNode(pNode);
+         weight_ -= pNode->weight;
          map_.erase(key);
       }
       END_LOCK_MUTEX
@@ -121,18 +133,42 @@ public:
       return 0;
    }
 
+   // total weight of all values (equal to size() for unweighted caches)
+   std::size_t weight()
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         return weight_;
+      }
+      END_LOCK_MUTEX
+
+      return 0;
+   }
+
 private:
    struct Node
    {
-      Node(const KeyType& key, const ValueType& value) :
-         key(key), value(value) {}
+      Node(const KeyType& key, const ValueType& value, std::size_t weight) :
+         key(key), value(value), weight(weight) {}
 
       boost::shared_ptr<Node> pLeft;
       boost::shared_ptr<Node> pRight;
       KeyType key;
       ValueType value;
+      std::size_t weight;
    };
 
+   void removeBackNode()
+   {
+      // erase the node from the map
+      // when the caller's scope ends, there are no more references
+      // to the expired node pointer, so it is freed
+      auto pNode = backNode_;
+      removeNode(pNode);
+      weight_ -= pNode->weight;
+      map_.erase(pNode->key);
+   }
+
    void removeNode(const boost::shared_ptr<Node>& pNode)
    {
       if (pNode->pLeft)
@@ -159,7 +195,9 @@ private:
          backNode_ = frontNode_;
    }
 
-   unsigned int maxSize_;
+   std::size_t maxWeight_;
+   WeightFunction weightFunction_;
+   std::size_t weight_;
 
    typedef std::map<KeyType, boost::shared_ptr<Node>> CollectionType;
    CollectionType map_;
@@ -99,7 +99,10 @@ public:
         connectionRetryContext_(ioService),
         logToStderr_(logToStderr),
         closed_(false),
-        requestWritten_(false)
+        requestWritten_(false),
+        keepAlive_(false),
+        connectionReusable_(false),
+        reusedConnection_(false)
    {
    }
 
@@ -233,6 +236,36 @@ public:
       });
    }
 
+   // ask the server to keep the connection open after the response. the
+   // connection is only kept if the response is delimited by its
+   // Content-Length (see onConnectionIdle)
+   void setKeepAlive(bool keepAlive)
+   {
+      keepAlive_ = keepAlive;
+   }
+
+   // prepare a client whose connection was kept alive to execute another
+   // request (populate the request after calling this)
+   void resetForNextRequest()
+   {
+      request_.reset();
+      response_.reset();
+      chunkedEncoding_ = false;
+      responseBuffer_.consume(responseBuffer_.size());
+      chunkParser_.reset();
+      chunkState_.reset();
+      connectionRetryContext_.stopTryingTime = boost::posix_time::not_a_date_time;
+      connectionReusable_ = false;
+      reusedConnection_ = true;
+
+      LOCK_MUTEX(socketMutex_)
+      {
+         requestWritten_ = false;
+         connectHandler_ = ConnectHandler();
+      }
+      END_LOCK_MUTEX
+   }
+
    virtual void setConnectHandler(const ConnectHandler& connectHandler)
    {
       // if we are already connected, don't bother saving the connect handler
@@ -257,6 +290,30 @@ protected:
 
    virtual SocketService& socket() = 0;
 
+   // is the request being sent on a connection kept alive from an earlier
+   // request?
+   bool isReusedConnection() const
+   {
+      return reusedConnection_;
+   }
+
+   bool isClosed()
+   {
+      LOCK_MUTEX(socketMutex_)
+      {
+         return closed_;
+      }
+      END_LOCK_MUTEX
+
+      return true;
+   }
+
+   // called once the response has been delivered on a connection which
+   // was kept alive and can carry another request
+   virtual void onConnectionIdle()
+   {
+   }
+
    void handleConnectionError(const Error& connectionError)
    {
       // retry if necessary, otherwise just forward the error to
@@ -276,12 +333,14 @@ protected:
    // they finish connecting)
    void writeRequest()
    {
-      // specify closing of the connection after the request unless this is
-      // an attempt to upgrade to websockets
+      // specify closing of the connection after the request (unless the
+      // connection is to be kept alive) or this is an attempt to upgrade
+      // to websockets
       Header overrideHeader;
       if (!util::isWSUpgradeRequest(request_))
       {
-         overrideHeader = Header::connectionClose();
+         overrideHeader = keepAlive_ ? Header::connectionKeepAlive() :
+                                       Header::connectionClose();
       }
 
       // write
@@ -428,6 +487,28 @@ private:
       }
    }
 
+   // a kept alive connection may have been closed by the server while it
+   // was idle (e.g. because the session restarted). if that's why the
+   // request couldn't be written then send it again on a new connection.
+   // (once the request has been written the server may have acted on it,
+   // so a failure to read the response is never retried)
+   bool retryOnNewConnection(const boost::system::error_code& ec)
+   {
+      bool closedByServer = ec == boost::asio::error::eof ||
+                            ec == boost::asio::error::connection_reset ||
+                            ec == boost::asio::error::broken_pipe;
+      if (!reusedConnection_ || !closedByServer)
+         return false;
+
+      reusedConnection_ = false;
+      Error error = closeSocket(socket().lowest_layer());
+      if (error && !core::http::isConnectionTerminatedError(error))
+         logError(error);
+
+      connectAndWriteRequest();
+      return true;
+   }
+
    void handleConnectionRetryTimer(const boost::system::error_code& ec)
    {
       try
@@ -473,7 +554,7 @@ private:
                           AsyncClient<SocketService>::shared_from_this(),
                           boost::asio::placeholders::error));
          }
-         else
+         else if (!retryOnNewConnection(ec))
          {
             handleErrorCode(ec, ERROR_LOCATION);
          }
@@ -529,6 +610,15 @@ private:
          return;
       }
 
+      // on a kept alive connection the server won't close the connection
+      // to mark the end of the response, so stop at Content-Length
+      if (connectionReusable_ && response_.body().size() >= response_.contentLength())
+      {
+         connectionReusable_ = response_.body().size() == response_.contentLength();
+         closeAndRespond();
+         return;
+      }
+
       boost::asio::async_read(
          socket(),
          responseBuffer_,
@@ -545,7 +635,7 @@ private:
 
    virtual bool keepConnectionAlive()
    {
-      return false;
+      return connectionReusable_;
    }
 
    void handleReadHeaders(const boost::system::error_code& ec)
@@ -557,6 +647,15 @@ private:
             // parse headers
             ResponseParser::parseHeaders(&responseBuffer_, &response_);
 
+            // the connection can only carry another request if the server
+            // agreed to keep it open and we can tell where the body ends
+            connectionReusable_ =
+                  keepAlive_ &&
+                  request_.method() != "HEAD" &&
+                  !response_.headerValue("Content-Length").empty() &&
+                  response_.headerValue(kTransferEncoding).empty() &&
+                  !boost::algorithm::iequals(response_.headerValue("Connection"), "close");
+
             // if this is chunked encoding, start processing chunks
             if (response_.headerValue(kTransferEncoding) == kChunkedTransferEncoding &&
                 response_.contentLength() == 0)
@@ -736,7 +835,8 @@ private:
 
    void closeAndRespond()
    {
-      if (!keepConnectionAlive())
+      bool keepAlive = keepConnectionAlive();
+      if (!keepAlive)
          close();
 
       if (responseHandler_ && (!chunkedEncoding_ || !chunkHandler_))
@@ -747,6 +847,11 @@ private:
       // free handlers in case they keep a strong reference to us
       // this will allow us to properly clean up in that case
       disableHandlers();
+
+      // only hand the connection on once we're done with the handlers
+      // (it may be used for another request right away)
+      if (keepAlive && !isClosed())
+         onConnectionIdle();
    }
 
    void logError(const Error& error) const
@@ -812,6 +917,10 @@ private:
 
    bool requestWritten_;
    ConnectHandler connectHandler_;
+
+   bool keepAlive_;
+   bool connectionReusable_;
+   bool reusedConnection_;
 };
    
 
@@ -294,6 +294,26 @@ public:
       socketOperations_->asyncWrite(buffer, handler);
    }
 
+#ifndef _WIN32
+   // ssl connections can't be forwarded at the socket level
+   virtual int nativeHandle()
+   {
+      return sslStream_ ? -1 : socket_->native_handle();
+   }
+
+   virtual void asyncWaitReadable(Socket::Handler handler)
+   {
+      socket_->async_wait(SocketType::wait_read,
+                          boost::bind(handler, boost::asio::placeholders::error, 0));
+   }
+
+   virtual void asyncWaitWritable(Socket::Handler handler)
+   {
+      socket_->async_wait(SocketType::wait_write,
+                          boost::bind(handler, boost::asio::placeholders::error, 0));
+   }
+#endif
+
    virtual void close()
    {
       // ensure the socket is only closed once - boost considers
@@ -332,6 +352,18 @@ public:
       requestParser_.setFormHandler(formHandler);
    }
 
+   // the uri handler resolved when the request headers were parsed; cached
+   // here so that it need not be looked up again once the body is complete
+   void setUriHandler(const AsyncUriHandler& handler)
+   {
+      uriHandler_ = handler;
+   }
+
+   const boost::optional<AsyncUriHandler>& uriHandler() const
+   {
+      return uriHandler_;
+   }
+
    virtual void continueParsing()
    {
       // continue parsing by reinvoking the read handler
@@ -605,6 +637,7 @@ private:
    Request originalRequest_;
    http::Request request_;
    http::Response response_;
+   boost::optional<AsyncUriHandler> uriHandler_;
 
    boost::recursive_mutex mutex_;
    bool closed_ = false;
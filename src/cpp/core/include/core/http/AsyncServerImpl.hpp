@@ -445,8 +445,11 @@ private:
          if (notFoundHandler_)
             pAsyncConnection->response().setNotFoundHandler(notFoundHandler_);
 
+         // resolve the handler once and cache it on the connection so it
+         // can be reused when the request body has been fully parsed
          std::string uri = pRequest->uri();
          AsyncUriHandler handler = uriHandlers_.handlerFor(uri);
+         pConnection->setUriHandler(handler);
          boost::optional<AsyncUriHandlerFunctionVariant> handlerFunc = handler.function();
 
          if (!handler.isProxyHandler())
@@ -546,9 +549,12 @@ private:
          boost::shared_ptr<AsyncConnection> pAsyncConnection =
              boost::static_pointer_cast<AsyncConnection>(pConnection);
 
-         // call the appropriate handler to generate a response
-         std::string uri = pRequest->uri();
-         AsyncUriHandler handler = uriHandlers_.handlerFor(uri);
+         // call the appropriate handler to generate a response (use the
+         // handler resolved when the headers were parsed if we have one)
+         const boost::optional<AsyncUriHandler>& cachedHandler = pConnection->uriHandler();
+         AsyncUriHandler handler = cachedHandler ?
+                  cachedHandler.get() :
+                  uriHandlers_.handlerFor(pRequest->uri());
          boost::optional<AsyncUriHandlerFunctionVariant> handlerFunc = handler.function();
 
          // if no handler was assigned but we have a default, use it instead
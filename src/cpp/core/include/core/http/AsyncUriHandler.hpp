@@ -28,6 +28,7 @@
 
 #include <core/http/UriHandler.hpp>
 #include <core/http/AsyncConnection.hpp>
+#include <core/http/UriPrefixTree.hpp>
 
 using namespace boost::placeholders;
 
@@ -97,6 +98,11 @@ public:
       return boost::algorithm::starts_with(uri, prefix_);
    }
 
+   const std::string& prefix() const
+   {
+      return prefix_;
+   }
+
    boost::optional<AsyncUriHandlerFunctionVariant> function() const
    {
       return function_;
@@ -150,19 +156,16 @@ class AsyncUriHandlers
 public:
    void add(AsyncUriHandler handler)
    {
+      prefixTree_.insert(handler.prefix(), uriHandlers_.size());
       uriHandlers_.push_back(handler);
    }
 
    AsyncUriHandler handlerFor(const std::string& uri) const
    {
-      std::vector<AsyncUriHandler>::const_iterator handler =
-            std::find_if(
-              uriHandlers_.begin(),
-              uriHandlers_.end(),
-              boost::bind(&AsyncUriHandler::matches, _1, uri));
-      if ( handler != uriHandlers_.end() )
+      boost::optional<std::size_t> index = prefixTree_.lookup(uri);
+      if (index)
       {
-         return *handler;
+         return uriHandlers_[index.get()];
       }
       else
       {
@@ -172,6 +175,7 @@ public:
 
 private:
    std::vector<AsyncUriHandler> uriHandlers_;
+   UriPrefixTree prefixTree_;
 };
 
 } // namespace http
@@ -16,6 +16,7 @@
 #ifndef CORE_HTTP_LOCAL_STREAM_ASYNC_CLIENT_HPP
 #define CORE_HTTP_LOCAL_STREAM_ASYNC_CLIENT_HPP
 
+#include <sys/socket.h>
 #include <sys/stat.h>
 
 #include <boost/function.hpp>
@@ -35,6 +36,11 @@ namespace rstudio {
 namespace core {
 namespace http {  
 
+class LocalStreamAsyncClient;
+
+// invoked when a kept alive connection is ready for another request
+typedef boost::function<void(const boost::shared_ptr<LocalStreamAsyncClient>&)> IdleConnectionHandler;
+
 class LocalStreamAsyncClient
    : public AsyncClient<boost::asio::local::stream_protocol::socket>
 {
@@ -54,6 +60,63 @@ public:
       setConnectionRetryProfile(retryProfile);
    }
 
+   const core::FilePath& localStreamPath() const
+   {
+      return localStreamPath_;
+   }
+
+   const boost::optional<UidType>& validateUid() const
+   {
+      return validateUid_;
+   }
+
+   // keep the connection open once the response is read, and pass the
+   // client to the handler so it can be used for another request
+   void setIdleConnectionHandler(const IdleConnectionHandler& handler)
+   {
+      idleConnectionHandler_ = handler;
+      setKeepAlive(true);
+   }
+
+   // is an idle kept alive connection still usable? (the session may have
+   // closed it or gone away)
+   bool isConnectionAlive()
+   {
+      if (isClosed() || !socket_.is_open())
+         return false;
+
+      // an idle connection has nothing to read: a readable socket means
+      // the server has closed its end (or sent something unexpected)
+      char ch;
+      ssize_t result = ::recv(socket_.native_handle(), &ch, 1, MSG_PEEK | MSG_DONTWAIT);
+      if (result >= 0)
+         return false;
+
+      // (silly ifdef here is to silence compiler warnings)
+#if EAGAIN == EWOULDBLOCK
+      return errno == EAGAIN;
+#else
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+   }
+
+   virtual int nativeHandle()
+   {
+      return socket_.native_handle();
+   }
+
+   virtual void asyncWaitReadable(Handler handler)
+   {
+      socket_.async_wait(boost::asio::local::stream_protocol::socket::wait_read,
+                         boost::bind(handler, boost::asio::placeholders::error, 0));
+   }
+
+   virtual void asyncWaitWritable(Handler handler)
+   {
+      socket_.async_wait(boost::asio::local::stream_protocol::socket::wait_write,
+                         boost::bind(handler, boost::asio::placeholders::error, 0));
+   }
+
 protected:
 
    virtual boost::asio::local::stream_protocol::socket& socket()
@@ -61,10 +124,23 @@ protected:
       return socket_;
    }
 
+   virtual void onConnectionIdle()
+   {
+      if (idleConnectionHandler_)
+         idleConnectionHandler_(sharedFromThis());
+   }
+
 private:
 
    virtual void connectAndWriteRequest()
    {
+      // a kept alive connection is already established
+      if (isReusedConnection())
+      {
+         writeRequest();
+         return;
+      }
+
       // validate if requested
       if (validateUid_.is_initialized() && localStreamPath_.exists())
       {
@@ -148,6 +224,7 @@ private:
    boost::asio::local::stream_protocol::socket socket_;
    core::FilePath localStreamPath_;
    boost::optional<UidType> validateUid_;
+   IdleConnectionHandler idleConnectionHandler_;
 };
    
    
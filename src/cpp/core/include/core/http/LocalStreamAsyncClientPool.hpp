@@ -0,0 +1,95 @@
+/*
+ * LocalStreamAsyncClientPool.hpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_HTTP_LOCAL_STREAM_ASYNC_CLIENT_POOL_HPP
+#define CORE_HTTP_LOCAL_STREAM_ASYNC_CLIENT_POOL_HPP
+
+#include <deque>
+#include <map>
+#include <string>
+
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <core/http/LocalStreamAsyncClient.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+// Keeps the connections of local stream clients open between requests (as
+// HTTP/1.1 persistent connections) so that requests to the same stream can
+// be sent without connecting each time. Idle connections are pooled per
+// stream path, bounded in number and closed once they've been idle for too
+// long (checked periodically while there are idle connections, so that
+// connections to a stream that's no longer used don't stay open). The pool
+// is thread safe, must outlive the clients it hands out and should be used
+// with a single io_service.
+class LocalStreamAsyncClientPool : boost::noncopyable
+{
+public:
+   explicit LocalStreamAsyncClientPool(
+         std::size_t maxIdlePerStream = 4,
+         const boost::posix_time::time_duration& idleTimeout = boost::posix_time::seconds(60));
+
+   ~LocalStreamAsyncClientPool();
+
+   // get a client for a request to the stream: one with a live idle
+   // connection if there is one and a new client otherwise. either way the
+   // connection comes back to the pool once the response has been read (if
+   // the server kept it open)
+   boost::shared_ptr<LocalStreamAsyncClient> client(
+         boost::asio::io_service& ioService,
+         const FilePath& localStreamPath,
+         const boost::optional<UidType>& validateUid = boost::none);
+
+   std::size_t idleConnectionCount() const;
+
+private:
+   struct IdleConnection
+   {
+      boost::shared_ptr<LocalStreamAsyncClient> client;
+      boost::posix_time::ptime idleSince;
+   };
+
+   typedef std::vector<boost::shared_ptr<LocalStreamAsyncClient> > Clients;
+
+   void onConnectionIdle(const boost::shared_ptr<LocalStreamAsyncClient>& client);
+
+   void removeExpiredConnections(const boost::posix_time::ptime& now, Clients* pExpired);
+
+   void scheduleExpiryCheck();
+   void onExpiryCheck(const boost::system::error_code& ec);
+
+   std::size_t maxIdlePerStream_;
+   boost::posix_time::time_duration idleTimeout_;
+
+   mutable boost::mutex mutex_;
+   std::map<std::string, std::deque<IdleConnection> > idleConnections_;
+   boost::posix_time::ptime lastExpiryCheck_;
+
+   // created on the io_service of the first client handed out
+   boost::scoped_ptr<boost::asio::deadline_timer> pExpiryTimer_;
+   bool expiryCheckScheduled_;
+};
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_HTTP_LOCAL_STREAM_ASYNC_CLIENT_POOL_HPP
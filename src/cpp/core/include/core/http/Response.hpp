@@ -52,6 +52,7 @@ namespace http {
 typedef boost::function<void(const Request&, Response*)> NotFoundHandler;
 
 class Cookie;
+struct StaticFile;
    
 namespace status {
 enum Code {
@@ -266,6 +267,11 @@ public:
                       const Request& request,
                       std::streamsize buffSize = 65536);
 
+   // sends the output of the given stream using chunked encoding, compressed
+   // according to the current content encoding (gzip or deflate)
+   void setStreamBody(const boost::shared_ptr<StreamResponse>& pStream,
+                      std::streamsize buffSize = 65536);
+
    Error setBody(const FilePath& filePath, std::streamsize buffSize = 512)
    {
       NullOutputFilter nullFilter;
@@ -326,7 +332,15 @@ public:
       if (request.acceptsEncoding(kGzipEncoding))
          setContentEncoding(kGzipEncoding);
 
-      Error error = setBody(filePath, filter, 128, usePadding(request, filePath));
+      // unfiltered files are served from the static file cache (which
+      // retains the compressed contents across requests)
+      Error error;
+      bool padding = usePadding(request, filePath);
+      if (boost::is_same<Filter, NullOutputFilter>::value && !padding)
+         error = setCachedBody(filePath);
+      else
+         error = setBody(filePath, filter, 128, padding);
+
       if (error)
          setError(status::InternalServerError, error.getMessage());
    }
@@ -421,7 +435,12 @@ public:
          setFile(filePath, request, filter);
       }
    }
-   void setRangeableFile(const FilePath& filePath, const Request& request);
+   // serves the byte range(s) requested in the Range header (as a
+   // multipart/byteranges response when more than one range is requested);
+   // only the requested windows of the file are read, and they are streamed
+   void setRangeableFile(const FilePath& filePath,
+                         const Request& request,
+                         std::streamsize buffSize = 65536);
 
    void setRangeableFile(const std::string& contents,
                          const std::string& mimeType,
@@ -468,6 +487,11 @@ private:
    void removeCachingHeaders();
    void setCacheForeverHeaders(bool publicAccessiblity);
    std::string eTagForContent(const std::string& content);
+
+   // sets the body from the static file cache using the current content
+   // encoding (files which can't be cached are read from disk)
+   Error setCachedBody(const FilePath& filePath);
+   void setCachedBody(const StaticFile& file);
   
 private:
 
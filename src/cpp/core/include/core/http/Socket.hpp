@@ -22,6 +22,7 @@
 #include <boost/function.hpp>
 
 #include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
 
 namespace rstudio {
 namespace core {
@@ -46,6 +47,25 @@ public:
                      Handler Handler) = 0;
 
    virtual void close() = 0;
+
+   // the native handle of a socket whose bytes can be moved to and from it
+   // unchanged (i.e. it isn't encrypted), or -1. lets bytes be forwarded
+   // between sockets without passing through user space
+   virtual int nativeHandle()
+   {
+      return -1;
+   }
+
+   // wait for a socket with a native handle to become readable or writable
+   virtual void asyncWaitReadable(Handler handler)
+   {
+      handler(boost::asio::error::operation_not_supported, 0);
+   }
+
+   virtual void asyncWaitWritable(Handler handler)
+   {
+      handler(boost::asio::error::operation_not_supported, 0);
+   }
 };
 
 } // namespace http
@@ -16,9 +16,11 @@
 #ifndef CORE_HTTP_SOCKET_PROXY_HPP
 #define CORE_HTTP_SOCKET_PROXY_HPP
 
+#include <atomic>
 #include <string>
 
 #include <boost/array.hpp>
+#include <boost/chrono.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
 
@@ -30,10 +32,26 @@ namespace rstudio {
 namespace core {
 namespace http {
 
+// forwards bytes between two sockets in both directions until either end
+// closes. on linux, when both ends are plain sockets, bytes are moved between
+// them with splice(2) and never copied into user space
 class SocketProxy : public boost::enable_shared_from_this<SocketProxy>
 {
 public:
-   static void create(boost::shared_ptr<core::http::Socket> ptrClient,
+   struct Stats
+   {
+      Stats() : clientToServerBytes(0), serverToClientBytes(0) {}
+
+      uint64_t clientToServerBytes;
+      uint64_t serverToClientBytes;
+      boost::chrono::steady_clock::duration elapsedTime;
+
+      // time spent by the threads forwarding the bytes
+      boost::chrono::nanoseconds cpuTime;
+   };
+
+   static boost::shared_ptr<SocketProxy> create(
+                      boost::shared_ptr<core::http::Socket> ptrClient,
                       boost::shared_ptr<core::http::Socket> ptrServer,
                       boost::function<bool()> checkFunction = 0,
                       boost::function<void()> closeFunction = 0)
@@ -42,20 +60,60 @@ public:
                                                             ptrServer,
                                                             checkFunction,
                                                             closeFunction));
-      pProxy->readClient();
-      pProxy->readServer();
+      pProxy->start();
+      return pProxy;
    }
 
+   ~SocketProxy();
+
+   bool isSplicing() const { return splicing_; }
+
+   Stats stats() const;
+
 private:
    SocketProxy(boost::shared_ptr<core::http::Socket> ptrClient,
                boost::shared_ptr<core::http::Socket> ptrServer,
                boost::function<bool()> checkFunction,
                boost::function<void()> closeFunction)
       : ptrClient_(ptrClient), ptrServer_(ptrServer),
-        checkFunction_(checkFunction), closeFunction_(closeFunction), closed_(false)
+        checkFunction_(checkFunction), closeFunction_(closeFunction), closed_(false),
+        splicing_(false), startTime_(boost::chrono::steady_clock::now()),
+        clientToServer_(ptrClient, ptrServer, true),
+        serverToClient_(ptrServer, ptrClient, false)
    {
    }
 
+   // the bytes flowing in one direction when splicing. each direction has
+   // its own pipe and lock so the two never wait on each other
+   struct Direction
+   {
+      Direction(boost::shared_ptr<core::http::Socket> ptrFrom,
+                boost::shared_ptr<core::http::Socket> ptrTo,
+                bool checked)
+         : ptrFrom(ptrFrom), ptrTo(ptrTo), checked(checked), pending(0), bytes(0)
+      {
+         pipe[0] = pipe[1] = -1;
+      }
+
+      boost::shared_ptr<core::http::Socket> ptrFrom;
+      boost::shared_ptr<core::http::Socket> ptrTo;
+
+      // should the check function be consulted before forwarding?
+      bool checked;
+
+      int pipe[2];
+
+      // bytes spliced into the pipe but not yet out of it
+      std::size_t pending;
+
+      std::atomic<uint64_t> bytes;
+      boost::mutex mutex;
+   };
+
+   void start();
+   bool startSplicing();
+   void pump(Direction* pDirection, const boost::system::error_code& e);
+
    void readClient();
    void readServer();
 
@@ -81,6 +139,12 @@ private:
    boost::function<bool()> checkFunction_;
    boost::function<void()> closeFunction_;
    bool closed_ = false;
+
+   bool splicing_;
+   boost::chrono::steady_clock::time_point startTime_;
+   std::atomic<int64_t> cpuNanos_{0};
+   Direction clientToServer_;
+   Direction serverToClient_;
 };
 
 } // namespace http
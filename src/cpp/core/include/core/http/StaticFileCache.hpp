@@ -0,0 +1,153 @@
+/*
+ * StaticFileCache.hpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_HTTP_STATIC_FILE_CACHE_HPP
+#define CORE_HTTP_STATIC_FILE_CACHE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+
+#include <shared_core/Error.hpp>
+#include <shared_core/FilePath.hpp>
+
+#include <core/collection/LruCache.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+// identifies a version of a file on disk: its modification and status
+// change times are kept to the nanosecond (and the inode noted) so that a
+// rewrite within the same second that leaves the size unchanged is noticed
+struct StaticFileStamp
+{
+   std::int64_t modificationTime;
+   std::int64_t changeTime;
+   uintmax_t inode;
+   uintmax_t size;
+
+   bool operator==(const StaticFileStamp& other) const
+   {
+      return modificationTime == other.modificationTime &&
+             changeTime == other.changeTime &&
+             inode == other.inode &&
+             size == other.size;
+   }
+
+   bool operator!=(const StaticFileStamp& other) const
+   {
+      return !(*this == other);
+   }
+};
+
+// an immutable snapshot of a file's contents, as served to clients
+struct StaticFile
+{
+   StaticFileStamp stamp;
+
+   // etag (crc32 of the uncompressed contents)
+   std::string eTag;
+
+   // raw file contents
+   boost::shared_ptr<const std::string> pContents;
+
+   // compressed variants; these are produced on demand (or read from a
+   // sibling .gz file for gzip) so may be null
+   boost::shared_ptr<const std::string> pGzipContents;
+   boost::shared_ptr<const std::string> pDeflateContents;
+
+   // returns the contents in the given content encoding, or null if the
+   // variant for that encoding has not been produced
+   boost::shared_ptr<const std::string> contents(const std::string& encoding) const;
+
+   std::size_t memoryUsage() const;
+};
+
+// Size-bounded, in-process cache of static files (keyed by path and
+// validated against the file's stamp on every read) which also holds the
+// file's etag and its compressed variants, so that serving the same file
+// repeatedly does not re-read, re-hash or re-compress it. Only files within
+// the roots added to the cache (e.g. the web application's assets) are
+// cached; others are served from disk as before.
+class StaticFileCache : boost::noncopyable
+{
+public:
+   struct Stats
+   {
+      uint64_t hits;
+      uint64_t misses;
+      uint64_t compressions;
+      uint64_t precompressedReads;
+      std::size_t entries;
+      std::size_t bytes;
+   };
+
+   StaticFileCache(std::size_t maxBytes, std::size_t maxFileBytes);
+
+   // allows the files beneath dir to be cached
+   void addRoot(const FilePath& dir);
+
+   // reads the file (from the cache if it is current) along with its variant
+   // in the given content encoding (empty for no encoding); pFile is set to
+   // null when the file can't be cached (it is too large, or isn't within
+   // one of the cache's roots)
+   Error read(const FilePath& filePath,
+              const std::string& encoding,
+              boost::shared_ptr<const StaticFile>* pFile);
+
+   bool isCacheable(const FilePath& filePath);
+
+   Stats stats();
+
+private:
+   bool isWithinRoots(const FilePath& filePath);
+
+   Error readFile(const FilePath& filePath,
+                  const StaticFileStamp& stamp,
+                  boost::shared_ptr<StaticFile>* pFile);
+
+#ifndef _WIN32
+   Error addEncoding(const FilePath& filePath,
+                     const std::string& encoding,
+                     StaticFile* pFile);
+#endif
+
+   std::size_t maxFileBytes_;
+
+   boost::mutex rootsMutex_;
+   std::vector<FilePath> roots_;
+
+   collection::LruCache<std::string, boost::shared_ptr<const StaticFile> > files_;
+
+   std::atomic<uint64_t> hits_;
+   std::atomic<uint64_t> misses_;
+   std::atomic<uint64_t> compressions_;
+   std::atomic<uint64_t> precompressedReads_;
+};
+
+// process-wide cache used by Response when serving files
+StaticFileCache& staticFileCache();
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_HTTP_STATIC_FILE_CACHE_HPP
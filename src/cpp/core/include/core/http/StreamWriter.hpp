@@ -16,7 +16,10 @@
 #ifndef CORE_HTTP_STREAM_WRITER_HPP
 #define CORE_HTTP_STREAM_WRITER_HPP
 
+#include <sstream>
+
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/asio/write.hpp>
 
 #include <shared_core/Error.hpp>
 #include <core/http/Response.hpp>
@@ -191,6 +194,31 @@ private:
    boost::shared_ptr<http::Response> response_;
 };
 
+// writes a streamed response synchronously on the calling thread; each buffer
+// of the stream is produced and written before the next one is requested
+// (throws boost::system::system_error if a write fails)
+template <typename SocketType>
+void writeStreamResponse(SocketType& socket,
+                         const http::Response& response,
+                         const http::Header& overrideHeader = http::Header())
+{
+   boost::asio::write(socket, response.headerBuffers(overrideHeader));
+
+   boost::shared_ptr<core::http::StreamResponse> stream = response.getStreamResponse();
+   while (std::shared_ptr<core::http::StreamBuffer> buffer = stream->nextBuffer())
+   {
+      std::stringstream sstr;
+      sstr << std::hex << buffer->size << "\r\n";
+      std::string chunkHeader = sstr.str();
+
+      boost::asio::write(socket, boost::asio::buffer(chunkHeader));
+      boost::asio::write(socket, boost::asio::buffer(buffer->data, buffer->size));
+      boost::asio::write(socket, boost::asio::buffer("\r\n", 2));
+   }
+
+   boost::asio::write(socket, boost::asio::buffer("0\r\n\r\n", 5));
+}
+
 } // namespace http
 } // namespace core
 } // namespace rstudio
@@ -50,6 +50,25 @@ public:
    {
    }
 
+#ifndef _WIN32
+   virtual int nativeHandle()
+   {
+      return socket_.native_handle();
+   }
+
+   virtual void asyncWaitReadable(Handler handler)
+   {
+      socket_.async_wait(boost::asio::ip::tcp::socket::wait_read,
+                         boost::bind(handler, boost::asio::placeholders::error, 0));
+   }
+
+   virtual void asyncWaitWritable(Handler handler)
+   {
+      socket_.async_wait(boost::asio::ip::tcp::socket::wait_write,
+                         boost::bind(handler, boost::asio::placeholders::error, 0));
+   }
+#endif
+
 protected:
 
    virtual boost::asio::ip::tcp::socket& socket()
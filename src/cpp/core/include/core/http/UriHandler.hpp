@@ -24,6 +24,7 @@
 
 #include <core/http/AsyncConnection.hpp>
 #include <core/http/Response.hpp>
+#include <core/http/UriPrefixTree.hpp>
 
 namespace rstudio {
 namespace core {
@@ -62,6 +63,8 @@ public:
    // COPYING: via compiler
    
    bool matches(const std::string& uri) const;
+
+   const std::string& prefix() const;
    
    UriAsyncHandlerFunctionVariant function() const;
   
@@ -92,6 +95,7 @@ public:
    
 private:
    std::vector<UriHandler> uriHandlers_;
+   UriPrefixTree prefixTree_;
 };
 
 inline void notFoundHandler(const Request& request, Response* pResponse)
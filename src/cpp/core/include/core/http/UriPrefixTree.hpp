@@ -0,0 +1,79 @@
+/*
+ * UriPrefixTree.hpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_HTTP_URI_PREFIX_TREE_HPP
+#define CORE_HTTP_URI_PREFIX_TREE_HPP
+
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+namespace rstudio {
+namespace core {
+namespace http {
+
+// Dispatch table mapping uri prefixes to the index at which they were
+// registered. Lookup walks the uri once (O(uri length), independent of the
+// number of registered prefixes) and preserves the semantics of a linear
+// scan over the registration list: of all the prefixes matching a uri, the
+// one that was registered first wins.
+class UriPrefixTree
+{
+public:
+   UriPrefixTree();
+
+   // COPYING: via compiler
+
+   void insert(const std::string& prefix, std::size_t index);
+
+   boost::optional<std::size_t> lookup(const std::string& uri) const;
+
+   bool empty() const { return size_ == 0; }
+   std::size_t size() const { return size_; }
+
+private:
+   static const std::size_t kNoIndex;
+
+   struct Node
+   {
+      Node() : index(kNoIndex), best(kNoIndex) {}
+
+      // children, sorted by their first character (edges are compressed,
+      // so each child carries the full label leading to it)
+      std::vector<std::size_t> children;
+      std::string label;
+
+      // registration index of the prefix ending exactly at this node
+      std::size_t index;
+
+      // lowest registration index of any prefix ending at this node or
+      // at one of its ancestors
+      std::size_t best;
+   };
+
+   std::size_t findChild(const Node& node, char ch) const;
+   void addChild(std::size_t parent, std::size_t child);
+   void propagateBest(std::size_t node, std::size_t best);
+
+   std::vector<Node> nodes_;
+   std::size_t size_;
+};
+
+} // namespace http
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_HTTP_URI_PREFIX_TREE_HPP
@@ -105,6 +105,7 @@ namespace rstudio {
 namespace core {
 namespace http {
    class Response;
+   class StreamResponse;
 }
 }
 }
@@ -347,6 +348,10 @@ core::Error getOptionalParam(const Object& json,
 }
 
 // json rpc response
+
+// writes the next part of a streamed json rpc result each time it is called,
+// returning true while there is more of the result to write
+typedef boost::function<bool(Writer*)> JsonRpcResultWriter;
          
 class JsonRpcResponse
 {
@@ -401,6 +406,9 @@ public:
 
    void setField(const std::string& name, const Value& value)
    { 
+      if (name == json::kRpcResult)
+         resultWriter_.clear();
+
       response_[name] = value;
    }
    
@@ -424,8 +432,19 @@ public:
    // low level hook to set the full response
    void setResponse(const Object& response)
    {
+      resultWriter_.clear();
       response_ = response;
    }
+
+   // streams the result rather than building it as a json value; the writer
+   // is called repeatedly as the response is sent, so only a chunk of the
+   // result is held in memory at a time (note that a streamed result can
+   // only be written once; getRawResponse writes it into a json value)
+   void setResultWriter(const JsonRpcResultWriter& resultWriter);
+   bool hasResultWriter() const { return static_cast<bool>(resultWriter_); }
+
+   // creates a stream which produces the response (with its streamed result)
+   boost::shared_ptr<http::StreamResponse> createStreamResponse() const;
    
    // specify a function to run after the response
    void setAfterResponse(const boost::function<void()>& afterResponse);
@@ -450,6 +469,7 @@ public:
    
 private:
    Object response_;
+   JsonRpcResultWriter resultWriter_;
    boost::function<void()> afterResponse_;
    bool suppressDetectChanges_;
 };
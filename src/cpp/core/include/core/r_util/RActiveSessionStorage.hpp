@@ -18,6 +18,8 @@
 
 #include <set>
 
+#include <boost/function.hpp>
+
 #include <core/json/JsonRpc.hpp>
 
 #include <shared_core/FilePath.hpp>
@@ -43,6 +45,11 @@ protected:
    IActiveSessionStorage() = default;
 };
 
+// stores the properties of a session in a log in its scratch path, which each
+// write appends to. logs are read once per process and then only again when
+// they change; writes of the properties updated most often are held back
+// briefly so that a burst of them is written together. sessions that
+// predate the log keep one file per property until they are first written
 class FileActiveSessionStorage : public IActiveSessionStorage
 {
 public:
@@ -56,6 +63,13 @@ public:
    Error destroy() override;
    Error isValid(bool* pValue) override;
 
+   // writes the properties being held back now
+   static void flushDeferredWrites();
+
+   // whether the session has stored properties, in its log or (for sessions
+   // that predate it) in its properties directory
+   static bool hasProperties(const FilePath& scratchPath);
+
 private:
    // Scratch Path Example : ~/.local/share/rstudio/sessions/active/session-6d0bdd18
    // This contains the properties directory, as well as susspended session data, session-persistence-state etc
@@ -63,13 +77,24 @@ private:
 
    // Properties Path Example : ~/.local/share/rstudio/sessions/active/session-6d0bdd18/properites
    FilePath scratchPath_;
-   const std::string propertiesDirName_ = "properites";
+   static const std::string propertiesDirName_;
+
+   FilePath getPropertiesLog() const;
 
-   FilePath getPropertyDir() const;
-   FilePath getPropertyFile(const std::string& name) const;
+   // reads the properties of a session from before the log, which kept each
+   // in its own file in the properties directory
+   boost::function<Error(std::map<std::string, std::string>*)> legacyReader() const;
+   static Error readLegacyProperties(const FilePath& propertyDir,
+                                     std::map<std::string, std::string>* pValues);
+
+   // keeps the properties directory up to date along with the log, for
+   // older versions of rserver and rsession which only read the directory
+   boost::function<Error(const std::map<std::string, std::string>&)> legacyWriter() const;
+   static Error writeLegacyProperties(const FilePath& propertyDir,
+                                      const std::map<std::string, std::string>& properties);
    
    static const std::map<std::string, std::string> fileNames;
-   
+
    static const std::string& getPropertyFileName(const std::string& propertyName)
    {
       if (fileNames.find(propertyName) != fileNames.end())
@@ -311,6 +311,15 @@ public:
                                      const PackageInformation& info)
    {
       packageInformation()[package] = info;
+      ++generation();
+   }
+   
+   // incremented whenever the package state shared by all indexes (the
+   // package information and the inferred and imported packages) changes,
+   // so that results computed from it can tell when they're out of date
+   static std::size_t packageStateGeneration()
+   {
+      return generation();
    }
 
    static bool hasInformation(const std::string& package)
@@ -381,12 +390,14 @@ public:
    void addInferredPackage(const std::string& packageName)
    {
       inferredPkgNames_.push_back(packageName);
-      allInferredPkgNames().insert(packageName);
+      if (allInferredPkgNames().insert(packageName).second)
+         ++generation();
    }
    
    static void addGloballyInferredPackage(const std::string& pkgName)
    {
-      allInferredPkgNames().insert(pkgName);
+      if (allInferredPkgNames().insert(pkgName).second)
+         ++generation();
    }
    
    static void setImportedPackages(const std::set<std::string>& pkgNames)
@@ -394,6 +405,7 @@ public:
       importedPackages().clear();
       importedPackages().insert(pkgNames.begin(), pkgNames.end());
       allInferredPkgNames().insert(pkgNames.begin(), pkgNames.end());
+      ++generation();
    }
    
    static const std::set<std::string>& getImportedPackages()
@@ -410,6 +422,7 @@ public:
       {
          allInferredPkgNames().insert(pkg);
       }
+      ++generation();
    }
    
    static ImportFromMap& getImportFromDirectives()
@@ -468,6 +481,12 @@ private:
       return instance;
    }
    
+   static std::size_t& generation()
+   {
+      static std::size_t instance = 0;
+      return instance;
+   }
+   
 };
 
 } // namespace r_util
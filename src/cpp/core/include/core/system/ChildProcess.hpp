@@ -16,6 +16,8 @@
 #ifndef CORE_SYSTEM_CHILD_PROCESS_HPP
 #define CORE_SYSTEM_CHILD_PROCESS_HPP
 
+#include <cstdint>
+
 #include <core/system/Process.hpp>
 
 #include <shared_core/Error.hpp>
@@ -226,6 +228,19 @@ public:
    virtual core::FilePath getCwd() const;
    virtual bool hasRecentOutput() const;
 
+#ifdef __linux__
+   // watch for output and exit with the given epoll instance; events carry
+   // the given id (see eventId) and should be passed to onEvent as they
+   // occur. once watched, poll only reads output and checks for exit when
+   // an event has said there's something to do.
+   Error watchEvents(int epollFd, std::uint64_t id);
+   void unwatchEvents();
+   void onEvent(std::uint64_t data);
+
+   // the id of the process an event is for
+   static std::uint64_t eventId(std::uint64_t data);
+#endif
+
 private:
 
    void reportError(const Error& error)
@@ -39,7 +39,7 @@ namespace system {
 struct FileScannerOptions
 {
    FileScannerOptions()
-      : recursive(false), yield(false)
+      : recursive(false), yield(false), threads(1)
    {
    }
 
@@ -47,6 +47,12 @@ struct FileScannerOptions
    bool yield;
    boost::function<bool(const FileInfo&)> filter;
    boost::function<Error(const FileInfo&)> onBeforeScanDir;
+
+   // the number of threads to scan a recursive listing with (0 to choose
+   // based on the hardware; POSIX only). when more than one thread is used
+   // the filter and onBeforeScanDir callbacks are invoked from the scanning
+   // threads, one call at a time, and not necessarily in tree order
+   std::size_t threads;
 };
 
 Error scanFiles(const tree<FileInfo>::iterator_base& fromNode,
@@ -17,6 +17,7 @@
 #ifndef CORE_SYSTEM_PROCESS_HPP
 #define CORE_SYSTEM_PROCESS_HPP
 
+#include <cstdint>
 #include <vector>
 
 #include <boost/enable_shared_from_this.hpp>
@@ -363,6 +364,26 @@ ProcessCallbacks createProcessCallbacks(
                const boost::function<void(const Error&)>& onError=
                                   boost::function<void(const core::Error&)>());
 
+// Output read from a child of a ProcessSupervisor
+struct ProcessIoStats
+{
+   ProcessIoStats() : pid(-1), stdoutBytes(0), stderrBytes(0) {}
+
+   PidType pid;
+   std::uint64_t stdoutBytes;
+   std::uint64_t stderrBytes;
+
+   // time since the child started
+   boost::posix_time::time_duration elapsed;
+
+   // output read per second, over the child's lifetime
+   double bytesPerSecond() const
+   {
+      double seconds = elapsed.total_microseconds() / 1000000.0;
+      return seconds > 0 ? (stdoutBytes + stderrBytes) / seconds : 0;
+   }
+};
+
 // Process supervisor
 class ProcessSupervisor : boost::noncopyable
 {
@@ -429,13 +450,20 @@ public:
    bool hasActiveChildren();
 
    // Poll for child (output and exit) events. returns true if there
-   // are still children being supervised after the poll
+   // are still children being supervised after the poll. On Linux, only
+   // children which have produced output or exited since the last poll are
+   // read (though all are polled, so their onContinue callbacks still run).
    bool poll();
 
+   // Output read from each running child so far
+   std::vector<ProcessIoStats> ioStats();
+
    // Terminate all running children
    void terminateAll();
 
-   // Wait for all children to exit. Returns false if the operation timed out
+   // Wait for all children to exit, polling them at the given interval (and,
+   // on Linux, as soon as any has output or exits). Returns false if the
+   // operation timed out
    bool wait(
       const boost::posix_time::time_duration& pollingInterval =
          boost::posix_time::milliseconds(100),
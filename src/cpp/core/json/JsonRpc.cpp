@@ -183,6 +183,72 @@ void setErrorProperties(Object& jsonError,
    jsonError["properties"] = properties;
 }
 
+// streams a json rpc response whose result is produced by a result writer;
+// the writer is called until about a chunk of output is buffered, so only
+// that much of the response is held in memory at a time
+class JsonRpcStreamResponse : public http::StreamResponse
+{
+public:
+   JsonRpcStreamResponse(const Object& response,
+                         const JsonRpcResultWriter& resultWriter,
+                         std::size_t chunkSize = 65536) :
+      response_(response),
+      resultWriter_(resultWriter),
+      chunkSize_(chunkSize),
+      started_(false),
+      finished_(false)
+   {
+   }
+
+   Error initialize()
+   {
+      return Success();
+   }
+
+   std::shared_ptr<http::StreamBuffer> nextBuffer()
+   {
+      if (!started_)
+      {
+         started_ = true;
+         writer_.beginObject();
+         writer_.key(kRpcResult);
+      }
+
+      while (!finished_ && writer_.getBufferedSize() < chunkSize_)
+      {
+         if (!resultWriter_(&writer_))
+         {
+            // the result is complete; write the remaining fields
+            for (const Object::Member& member : response_)
+            {
+               writer_.key(member.getName());
+               writer_.value(member.getValue());
+            }
+
+            writer_.endObject();
+            finished_ = true;
+         }
+      }
+
+      std::string output = writer_.takeBuffer();
+      if (output.empty())
+         return std::shared_ptr<http::StreamBuffer>();
+
+      char* buffer = new char[output.size()];
+      std::copy(output.begin(), output.end(), buffer);
+      return std::make_shared<http::StreamBuffer>(buffer, output.size());
+   }
+
+private:
+   Object response_;
+   JsonRpcResultWriter resultWriter_;
+   std::size_t chunkSize_;
+
+   Writer writer_;
+   bool started_;
+   bool finished_;
+};
+
 }   
 
 void JsonRpcResponse::setAfterResponse(
@@ -205,12 +271,56 @@ void JsonRpcResponse::runAfterResponse()
    
 Object JsonRpcResponse::getRawResponse()
 {
+   // a streamed result must be materialized for callers which need the
+   // response as a json value (e.g. async completions sent as client events)
+   if (resultWriter_)
+   {
+      Writer writer;
+      while (resultWriter_(&writer))
+      {
+      }
+
+      Value result;
+      Error error = result.parse(writer.takeBuffer());
+      if (error)
+      {
+         LOG_ERROR(error);
+         result = Value();
+      }
+
+      resultWriter_.clear();
+      response_[json::kRpcResult] = result;
+   }
+
    return response_;
 }
    
 void JsonRpcResponse::write(std::ostream& os) const
 {
-   response_.write(os);
+   if (!resultWriter_)
+   {
+      response_.write(os);
+      return;
+   }
+
+   JsonRpcStreamResponse stream(response_, resultWriter_);
+   while (std::shared_ptr<http::StreamBuffer> pBuffer = stream.nextBuffer())
+      os.write(pBuffer->data, pBuffer->size);
+}
+
+boost::shared_ptr<http::StreamResponse> JsonRpcResponse::createStreamResponse() const
+{
+   return boost::shared_ptr<http::StreamResponse>(
+            new JsonRpcStreamResponse(response_, resultWriter_));
+}
+
+void JsonRpcResponse::setResultWriter(const JsonRpcResultWriter& resultWriter)
+{
+   response_.erase(json::kRpcResult);
+   response_.erase(json::kRpcError);
+   response_.erase(json::kRpcAsyncHandle);
+
+   resultWriter_ = resultWriter;
 }
    
 void JsonRpcResponse::setError(const Error& error,
@@ -218,6 +328,7 @@ void JsonRpcResponse::setError(const Error& error,
                                bool includeErrorProperties)
 {
    // remove result
+   resultWriter_.clear();
    response_.erase(json::kRpcResult);
    response_.erase(json::kRpcAsyncHandle);
    
@@ -288,6 +399,7 @@ void JsonRpcResponse::setError(const boost::system::error_code& ec,
                                const Value& clientInfo)
 {
    // remove result
+   resultWriter_.clear();
    response_.erase(json::kRpcResult);
    response_.erase(json::kRpcAsyncHandle);
 
@@ -324,6 +436,7 @@ void JsonRpcResponse::setRedirectError(const Error& error,
    
 void JsonRpcResponse::setAsyncHandle(const std::string& handle)
 {
+   resultWriter_.clear();
    response_.erase(json::kRpcResult);
    response_.erase(json::kRpcError);
 
@@ -343,6 +456,13 @@ void setJsonRpcResponse(const JsonRpcResponse& jsonRpcResponse,
    if (pResponse->contentType().empty())
        pResponse->setContentType(json::kJsonContentType);
    
+   // streamed results are sent in chunks as they are written
+   if (jsonRpcResponse.hasResultWriter())
+   {
+      pResponse->setStreamBody(jsonRpcResponse.createStreamResponse());
+      return;
+   }
+
    // set body 
    std::stringstream responseStream;
    jsonRpcResponse.write(responseStream);
@@ -16,6 +16,7 @@
 
 #include <tests/TestThat.hpp>
 
+#include <core/http/Response.hpp>
 #include <core/json/JsonRpc.hpp>
 
 namespace rstudio {
@@ -350,6 +351,74 @@ TEST_CASE("JsonRpc")
       json::JsonRpcResponse jsonRpcResponse;
       jsonRpcResponse.setResult(root);
    }
+
+   SECTION("Streamed results match results built as values")
+   {
+      const int kElements = 20000;
+
+      json::Array array;
+      for (int i = 0; i < kElements; ++i)
+         array.push_back(createObject());
+
+      json::JsonRpcResponse expected;
+      expected.setResult(array);
+      expected.setField("extra", "field");
+
+      // write one element per call
+      int index = 0;
+      auto resultWriter = [&](json::Writer* pWriter)
+      {
+         if (index == 0)
+            pWriter->beginArray();
+
+         if (index == kElements)
+         {
+            pWriter->endArray();
+            return false;
+         }
+
+         pWriter->value(createObject());
+         ++index;
+         return true;
+      };
+
+      json::JsonRpcResponse streamed;
+      streamed.setResultWriter(resultWriter);
+      streamed.setField("extra", "field");
+      REQUIRE(streamed.hasResultWriter());
+
+      // the response is produced in chunks rather than all at once
+      http::Response response;
+      json::setJsonRpcResponse(streamed, &response);
+      REQUIRE(response.isStreamResponse());
+
+      std::string body;
+      std::size_t buffers = 0;
+      boost::shared_ptr<http::StreamResponse> pStream = response.getStreamResponse();
+      while (std::shared_ptr<http::StreamBuffer> pBuffer = pStream->nextBuffer())
+      {
+         body.append(pBuffer->data, pBuffer->size);
+         ++buffers;
+      }
+
+      std::ostringstream expectedBody;
+      expected.write(expectedBody);
+
+      json::Value actual, reference;
+      REQUIRE_FALSE(actual.parse(body));
+      REQUIRE_FALSE(reference.parse(expectedBody.str()));
+      CHECK(actual == reference);
+      CHECK(buffers > 1);
+   }
+
+   SECTION("Setting a result replaces a result writer")
+   {
+      json::JsonRpcResponse response;
+      response.setResultWriter([](json::Writer* pWriter) { pWriter->nullValue(); return false; });
+      response.setResult(42);
+      CHECK_FALSE(response.hasResultWriter());
+      CHECK(response.result().getInt() == 42);
+   }
 }
 
 } // namespace tests
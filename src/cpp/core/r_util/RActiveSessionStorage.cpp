@@ -13,10 +13,22 @@
  *
  */
 
+#include <algorithm>
+#include <cstdint>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/file.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
 #include <boost/current_function.hpp>
+#include <boost/function.hpp>
 
 #include <core/Log.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/Thread.hpp>
 #include <core/r_util/RActiveSessions.hpp>
 #include <core/r_util/RActiveSessionStorage.hpp>
 #include <core/system/Xdg.hpp>
@@ -26,6 +38,31 @@ namespace core {
 namespace r_util {
 
 namespace {
+
+typedef std::map<std::string, std::string> Properties;
+typedef boost::function<Error(Properties*)> LegacyReader;
+typedef boost::function<Error(const Properties&)> LegacyWriter;
+
+// a session's properties directory, which held its properties before the log
+struct LegacyProperties
+{
+   LegacyReader read;
+   LegacyWriter write;
+};
+
+// the log holding a session's properties: a line per write, each a json
+// object of the properties it changed
+const char* const kPropertiesLogName = "properties-log";
+
+// the most writes a log holds before it's rewritten as a single line
+const std::size_t kMaxLogEntries = 64;
+
+// the most logs whose properties are kept in memory
+const std::size_t kMaxCachedLogs = 1024;
+
+// how long writes of the properties that change all the time are held back
+const boost::posix_time::time_duration kDeferredWriteDelay = boost::posix_time::seconds(1);
+
 Error createError(const std::string& errorName, const std::string& preamble, 
    const std::vector<FilePath>& files, const ErrorLocation& errorLocation)
 {
@@ -41,6 +78,406 @@ Error createError(const std::string& errorName, const std::string& preamble,
    errorMessage += " ]";
    return Error(errorName, 1, errorMessage, errorLocation);
 }
+
+bool isDeferrable(const Properties::value_type& property)
+{
+   return property.first == ActiveSession::kLastUsed ||
+          property.first == ActiveSession::kExecuting;
+}
+
+// the modification time of the log in nanoseconds, so that a rewrite within
+// the same second that leaves the size unchanged isn't missed
+std::int64_t modificationTime(const FilePath& log)
+{
+#ifndef _WIN32
+   struct stat info;
+   if (::stat(log.getAbsolutePath().c_str(), &info) != 0)
+      return 0;
+# ifdef __APPLE__
+   return static_cast<std::int64_t>(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+# else
+   return static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+# endif
+#else
+   return static_cast<std::int64_t>(log.getLastWriteTime()) * 1000000000;
+#endif
+}
+
+// an exclusive lock on a log, held while it's written so the appends and
+// rewrites of different processes (e.g. the server and the session) can't
+// interleave or drop one another
+class LogLock : boost::noncopyable
+{
+public:
+   explicit LogLock(const FilePath& log) : fd_(-1)
+   {
+#ifndef _WIN32
+      // a separate file, as rewrites replace the log itself; it's opened
+      // read only so processes running as other users can lock it too
+      std::string lockPath = log.getAbsolutePath() + ".lock";
+      fd_ = ::open(lockPath.c_str(), O_RDONLY | O_CREAT | O_CLOEXEC, 0644);
+      if (fd_ == -1)
+      {
+         error_ = systemError(errno, ERROR_LOCATION);
+         error_.addProperty("path", lockPath);
+         return;
+      }
+
+      int result;
+      do
+      {
+         result = ::flock(fd_, LOCK_EX);
+      } while (result == -1 && errno == EINTR);
+
+      if (result == -1)
+      {
+         error_ = systemError(errno, ERROR_LOCATION);
+         error_.addProperty("path", lockPath);
+         ::close(fd_);
+         fd_ = -1;
+      }
+#endif
+   }
+
+   ~LogLock()
+   {
+#ifndef _WIN32
+      // closing releases the lock
+      if (fd_ != -1)
+         ::close(fd_);
+#endif
+   }
+
+   const Error& error() const { return error_; }
+
+private:
+   int fd_;
+   Error error_;
+};
+
+std::string logEntry(const Properties& properties)
+{
+   json::Object entry;
+   for (const auto& property : properties)
+      entry[property.first] = property.second;
+   return entry.write() + "\n";
+}
+
+// the properties of the sessions this process has used, as they were when
+// their logs were last read, along with any writes being held back
+class PropertyStore : boost::noncopyable
+{
+public:
+   static PropertyStore& instance()
+   {
+      static PropertyStore store;
+      return store;
+   }
+
+   ~PropertyStore()
+   {
+      try
+      {
+         LOCK_MUTEX(mutex_)
+         {
+            stopping_ = true;
+         }
+         END_LOCK_MUTEX
+         condition_.notify_all();
+         if (thread_.joinable())
+            thread_.join();
+
+         flush(true);
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+   }
+
+   Error read(const FilePath& log, const LegacyProperties& legacy, Properties* pValues)
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         Entry& entry = findEntry(log, legacy);
+         Error error = load(log, &entry);
+
+         *pValues = entry.values;
+         for (const auto& property : entry.deferred)
+            (*pValues)[property.first] = property.second;
+
+         return error;
+      }
+      END_LOCK_MUTEX
+
+      return Success();
+   }
+
+   Error write(const FilePath& log, const LegacyProperties& legacy, const Properties& properties)
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         Entry& entry = findEntry(log, legacy);
+         if (std::all_of(properties.begin(), properties.end(), isDeferrable))
+         {
+            if (entry.deferred.empty())
+               entry.deferredSince = boost::posix_time::microsec_clock::universal_time();
+            for (const auto& property : properties)
+               entry.deferred[property.first] = property.second;
+
+            if (!thread_.joinable())
+               thread_ = boost::thread(&PropertyStore::run, this);
+            condition_.notify_all();
+            return Success();
+         }
+
+         // write any held back properties along with these
+         Properties changes;
+         changes.swap(entry.deferred);
+         for (const auto& property : properties)
+            changes[property.first] = property.second;
+
+         return append(log, &entry, changes);
+      }
+      END_LOCK_MUTEX
+
+      return Success();
+   }
+
+   void discard(const FilePath& log)
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         entries_.erase(log.getAbsolutePath());
+      }
+      END_LOCK_MUTEX
+   }
+
+   // writes the held back properties whose delay has passed (or all of them)
+   void flush(bool all)
+   {
+      LOCK_MUTEX(mutex_)
+      {
+         boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+         for (auto& logEntry : entries_)
+         {
+            Entry& entry = logEntry.second;
+            if (entry.deferred.empty() || (!all && now - entry.deferredSince < kDeferredWriteDelay))
+               continue;
+
+            Properties changes;
+            changes.swap(entry.deferred);
+            Error error = append(FilePath(logEntry.first), &entry, changes);
+            if (error)
+               LOG_ERROR(error);
+         }
+      }
+      END_LOCK_MUTEX
+   }
+
+private:
+   PropertyStore() : stopping_(false) {}
+
+   struct Entry
+   {
+      Entry() : lastWriteTime(0), size(0), logEntries(0) {}
+
+      LegacyProperties legacy;
+
+      // the log when it was last read (its modification time in
+      // nanoseconds); a log that doesn't exist has size 0
+      std::int64_t lastWriteTime;
+      uintmax_t size;
+      std::size_t logEntries;
+      Properties values;
+
+      Properties deferred;
+      boost::posix_time::ptime deferredSince;
+   };
+
+   Entry& findEntry(const FilePath& log, const LegacyProperties& legacy)
+   {
+      std::string path = log.getAbsolutePath();
+      if (entries_.size() >= kMaxCachedLogs && !entries_.count(path))
+      {
+         // forget everything that can be read again
+         for (auto it = entries_.begin(); it != entries_.end(); )
+         {
+            if (it->second.deferred.empty())
+               it = entries_.erase(it);
+            else
+               ++it;
+         }
+      }
+
+      Entry& entry = entries_[path];
+      entry.legacy = legacy;
+      return entry;
+   }
+
+   // brings the entry up to date with the log, if it has changed since it
+   // was last read
+   Error load(const FilePath& log, Entry* pEntry)
+   {
+      if (!log.exists())
+      {
+         // the session predates the log, or has never been written
+         pEntry->lastWriteTime = 0;
+         pEntry->size = 0;
+         pEntry->logEntries = 0;
+         pEntry->values.clear();
+         return pEntry->legacy.read(&pEntry->values);
+      }
+
+      std::int64_t lastWriteTime = modificationTime(log);
+      uintmax_t size = log.getSize();
+      if (lastWriteTime == pEntry->lastWriteTime && size == pEntry->size)
+         return Success();
+
+      std::string contents;
+      Error error = readStringFromFile(log, &contents);
+      if (error)
+         return error;
+
+      pEntry->values.clear();
+      pEntry->logEntries = 0;
+      std::size_t pos = 0;
+      while (pos < contents.size())
+      {
+         // a line without a newline is a write still in progress
+         std::size_t end = contents.find('\n', pos);
+         if (end == std::string::npos)
+            break;
+
+         json::Value entry;
+         if (!entry.parse(contents.substr(pos, end - pos)) && entry.isObject())
+         {
+            for (const json::Object::Member& member : entry.getObject())
+            {
+               if (member.getValue().isString())
+                  pEntry->values[member.getName()] = member.getValue().getString();
+            }
+            pEntry->logEntries++;
+         }
+         pos = end + 1;
+      }
+
+      pEntry->lastWriteTime = lastWriteTime;
+      pEntry->size = size;
+      return Success();
+   }
+
+   Error append(const FilePath& log, Entry* pEntry, const Properties& changes)
+   {
+      // nothing to do if the session has been removed
+      if (!log.getParent().exists())
+         return Success();
+
+      // writing without the lock risks losing a concurrent write, but is
+      // better than not writing at all
+      LogLock lock(log);
+      if (lock.error())
+         LOG_ERROR(lock.error());
+
+      // pick up the writes of other processes first
+      Error error = load(log, pEntry);
+      if (error)
+         return error;
+
+      for (const auto& property : changes)
+         pEntry->values[property.first] = property.second;
+
+      std::string line;
+      uintmax_t expectedSize;
+      if (pEntry->size == 0 || pEntry->logEntries >= kMaxLogEntries)
+      {
+         // start the log (bringing over the properties of a session that
+         // predates it), or rewrite it with every property on one line
+         line = logEntry(pEntry->values);
+         expectedSize = line.size();
+
+         FilePath tempLog;
+         error = FilePath::uniqueFilePath(log.getParent().getAbsolutePath(), ".tmp", tempLog);
+         if (!error)
+            error = writeStringToFile(tempLog, line);
+         if (!error)
+            error = tempLog.move(log, FilePath::MoveDirect, true);
+         if (error)
+            tempLog.removeIfExists();
+         pEntry->logEntries = 1;
+      }
+      else
+      {
+         line = logEntry(changes);
+         expectedSize = pEntry->size + line.size();
+         error = writeStringToFile(log, line, string_utils::LineEndingPassthrough, false);
+         pEntry->logEntries++;
+      }
+
+      if (!error)
+      {
+         Error legacyError = pEntry->legacy.write(changes);
+         if (legacyError)
+            LOG_ERROR(legacyError);
+      }
+
+      // our own write needn't be read back, but anything another process
+      // wrote at the same time must be
+      if (!error && log.getSize() == expectedSize)
+      {
+         pEntry->lastWriteTime = modificationTime(log);
+         pEntry->size = expectedSize;
+      }
+      else
+      {
+         pEntry->lastWriteTime = 0;
+         pEntry->size = 0;
+      }
+
+      return error;
+   }
+
+   bool hasDeferredWrites() const
+   {
+      for (const auto& logEntry : entries_)
+      {
+         if (!logEntry.second.deferred.empty())
+            return true;
+      }
+      return false;
+   }
+
+   void run()
+   {
+      try
+      {
+         boost::unique_lock<boost::mutex> lock(mutex_);
+         while (!stopping_)
+         {
+            if (!hasDeferredWrites())
+            {
+               condition_.wait(lock);
+               continue;
+            }
+
+            condition_.timed_wait(lock, kDeferredWriteDelay);
+            if (stopping_)
+               break;
+
+            lock.unlock();
+            flush(false);
+            lock.lock();
+         }
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+   }
+
+   // keyed by the path of the log
+   std::map<std::string, Entry> entries_;
+
+   bool stopping_;
+   boost::mutex mutex_;
+   boost::condition_variable condition_;
+   boost::thread thread_;
+};
+
 } // anonymous namespace
 
 FileActiveSessionStorage::FileActiveSessionStorage(const FilePath& scratchPath) :
@@ -51,6 +488,8 @@ FileActiveSessionStorage::FileActiveSessionStorage(const FilePath& scratchPath)
       LOG_ERROR(error);
 }
 
+const std::string FileActiveSessionStorage::propertiesDirName_ = "properites";
+
 const std::map<std::string, std::string> FileActiveSessionStorage::fileNames =
 {
    { "last_used" , "last-used" },
@@ -81,55 +520,30 @@ Error FileActiveSessionStorage::readProperty(const std::string& name, std::strin
 
 Error FileActiveSessionStorage::readProperties(const std::set<std::string>& names, std::map<std::string, std::string>* pValues)
 {
-   std::vector<FilePath> failedFiles;
    pValues->clear();
+
+   std::map<std::string, std::string> values;
+   Error error = PropertyStore::instance().read(getPropertiesLog(), LegacyProperties{ legacyReader(), legacyWriter() }, &values);
+
    for (const std::string& name : names)
    {
-      FilePath readPath = getPropertyFile(name);
       std::string value = "";
-
-      if (readPath.exists())
+      std::map<std::string, std::string>::const_iterator iter = values.find(name);
+      if (iter != values.end())
       {
-         Error error = core::readStringFromFile(readPath, &value);
-         if (error)
-            failedFiles.push_back(readPath);
+         value = iter->second;
          boost::algorithm::trim(value);
       }
       pValues->insert(std::pair<std::string, std::string>{name, value});
    }
 
-   if(failedFiles.empty())
-      return Success();
-   else
-      return createError("UnableToReadFiles", "Failed to read from the following files ", 
-         failedFiles, ERROR_LOCATION);
+   return error;
 }
 
 Error FileActiveSessionStorage::readProperties(std::map<std::string, std::string>* pValues)
 {
-
-   FilePath propertyDir = getPropertyDir();
-   std::vector<FilePath> files{};
-   std::vector<FilePath> failedFiles{};
    pValues->clear();
-   propertyDir.getChildren(files);
-
-   for(FilePath file : files) {
-      std::string value = "";
-      Error error = core::readStringFromFile(file, &value);
-
-      if(error)
-         failedFiles.push_back(file);
-
-      std::string propertyName = getFileNameProperty(file.getFilename());
-      pValues->insert(std::pair<std::string, std::string>{propertyName, value});
-   }
-
-   if(!failedFiles.empty())
-      return createError("UnableToReadFiles", "Failed to read from the following files ",
-         failedFiles, ERROR_LOCATION);
-      
-   return Success();
+   return PropertyStore::instance().read(getPropertiesLog(), LegacyProperties{ legacyReader(), legacyWriter() }, pValues);
 }
 
 Error FileActiveSessionStorage::writeProperty(const std::string& name, const std::string& value)
@@ -140,24 +554,15 @@ Error FileActiveSessionStorage::writeProperty(const std::string& name, const std
 
 Error FileActiveSessionStorage::writeProperties(const std::map<std::string, std::string>& properties)
 {
-   std::vector<FilePath> failedFiles{};
-   for (auto&& prop : properties)
-   {
-      FilePath writePath = getPropertyFile(prop.first);
-      Error error = core::writeStringToFile(writePath, prop.second);
-      if (error)
-         failedFiles.push_back(writePath);
-   }
-   
-   if (failedFiles.empty())
+   if (properties.empty())
       return Success();
-   else
-      return createError("UnableToWriteFiles", "Failed to write to the following files ", 
-         failedFiles, ERROR_LOCATION);
+
+   return PropertyStore::instance().write(getPropertiesLog(), LegacyProperties{ legacyReader(), legacyWriter() }, properties);
 }
 
 Error FileActiveSessionStorage::destroy()
 {
+   PropertyStore::instance().discard(getPropertiesLog());
    return scratchPath_.removeIfExists();
 }
 
@@ -167,18 +572,89 @@ Error FileActiveSessionStorage::isValid(bool* pValue)
    return Success();
 }
 
-FilePath FileActiveSessionStorage::getPropertyDir() const
+void FileActiveSessionStorage::flushDeferredWrites()
 {
-   FilePath propertiesDir = scratchPath_.completeChildPath(propertiesDirName_);
-   propertiesDir.ensureDirectory();
-   return propertiesDir;
+   PropertyStore::instance().flush(true);
+}
+
+bool FileActiveSessionStorage::hasProperties(const FilePath& scratchPath)
+{
+   return scratchPath.completeChildPath(kPropertiesLogName).exists() ||
+          scratchPath.completeChildPath(propertiesDirName_).exists();
+}
+
+FilePath FileActiveSessionStorage::getPropertiesLog() const
+{
+   return scratchPath_.completeChildPath(kPropertiesLogName);
+}
+
+boost::function<Error(std::map<std::string, std::string>*)> FileActiveSessionStorage::legacyReader() const
+{
+   FilePath propertyDir = scratchPath_.completeChildPath(propertiesDirName_);
+   return [=](std::map<std::string, std::string>* pValues)
+   {
+      return readLegacyProperties(propertyDir, pValues);
+   };
+}
+
+boost::function<Error(const std::map<std::string, std::string>&)> FileActiveSessionStorage::legacyWriter() const
+{
+   FilePath propertyDir = scratchPath_.completeChildPath(propertiesDirName_);
+   return [=](const std::map<std::string, std::string>& properties)
+   {
+      return writeLegacyProperties(propertyDir, properties);
+   };
+}
+
+Error FileActiveSessionStorage::writeLegacyProperties(const FilePath& propertyDir,
+                                                      const std::map<std::string, std::string>& properties)
+{
+   Error error = propertyDir.ensureDirectory();
+   if (error)
+      return error;
+
+   std::vector<FilePath> failedFiles{};
+   for (const auto& property : properties)
+   {
+      FilePath writePath = propertyDir.completeChildPath(getPropertyFileName(property.first));
+      error = core::writeStringToFile(writePath, property.second);
+      if (error)
+         failedFiles.push_back(writePath);
+   }
+
+   if (!failedFiles.empty())
+      return createError("UnableToWriteFiles", "Failed to write to the following files ",
+         failedFiles, ERROR_LOCATION);
+
+   return Success();
 }
 
-FilePath FileActiveSessionStorage::getPropertyFile(const std::string& name) const
+Error FileActiveSessionStorage::readLegacyProperties(const FilePath& propertyDir,
+                                                     std::map<std::string, std::string>* pValues)
 {
-   FilePath propertiesDir = getPropertyDir();
-   const std::string& fileName = getPropertyFileName(name);
-   return propertiesDir.completeChildPath(fileName);
+   std::vector<FilePath> files{};
+   std::vector<FilePath> failedFiles{};
+   if (!propertyDir.exists())
+      return Success();
+
+   propertyDir.getChildren(files);
+
+   for(FilePath file : files) {
+      std::string value = "";
+      Error error = core::readStringFromFile(file, &value);
+
+      if(error)
+         failedFiles.push_back(file);
+
+      std::string propertyName = getFileNameProperty(file.getFilename());
+      pValues->insert(std::pair<std::string, std::string>{propertyName, value});
+   }
+
+   if(!failedFiles.empty())
+      return createError("UnableToReadFiles", "Failed to read from the following files ",
+         failedFiles, ERROR_LOCATION);
+      
+   return Success();
 }
 
 
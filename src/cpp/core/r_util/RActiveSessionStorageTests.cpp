@@ -0,0 +1,284 @@
+/*
+ * RActiveSessionStorageTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <tests/TestThat.hpp>
+
+#include <boost/algorithm/string.hpp>
+
+#include <core/BoostThread.hpp>
+#include <core/FileSerializer.hpp>
+#include <core/r_util/RActiveSessionStorage.hpp>
+
+namespace rstudio {
+namespace core {
+namespace r_util {
+namespace tests {
+
+namespace {
+
+FilePath scratchPath()
+{
+   FilePath scratchPath;
+   REQUIRE_FALSE(FilePath::tempFilePath(scratchPath));
+   return scratchPath;
+}
+
+std::string readLog(const FilePath& scratchPath)
+{
+   std::string contents;
+   readStringFromFile(scratchPath.completeChildPath("properties-log"), &contents);
+   return contents;
+}
+
+std::size_t lineCount(const std::string& contents)
+{
+   return std::count(contents.begin(), contents.end(), '\n');
+}
+
+// a session as it was written before properties were logged
+void writeLegacySession(const FilePath& scratchPath)
+{
+   FilePath propertyDir = scratchPath.completeChildPath("properites");
+   REQUIRE_FALSE(propertyDir.ensureDirectory());
+   REQUIRE_FALSE(writeStringToFile(propertyDir.completeChildPath("last-used"), "1650000000000"));
+   REQUIRE_FALSE(writeStringToFile(propertyDir.completeChildPath("working-dir"), "~/project"));
+   REQUIRE_FALSE(writeStringToFile(propertyDir.completeChildPath("label"), "legacy"));
+}
+
+} // anonymous namespace
+
+test_context("File active session storage")
+{
+   test_that("Properties can be written and read back")
+   {
+      FilePath path = scratchPath();
+      FileActiveSessionStorage storage(path);
+
+      REQUIRE_FALSE(storage.writeProperties({ { "label", "analysis" }, { "r_version", "4.2.1" } }));
+      REQUIRE_FALSE(storage.writeProperty("label", "report\nwith a newline"));
+
+      std::string value;
+      REQUIRE_FALSE(storage.readProperty("r_version", &value));
+      expect_true(value == "4.2.1");
+
+      std::map<std::string, std::string> values;
+      REQUIRE_FALSE(storage.readProperties(&values));
+      expect_true(values.size() == 2);
+      expect_true(values["label"] == "report\nwith a newline");
+
+      // missing properties read as empty
+      REQUIRE_FALSE(storage.readProperties({ "r_version", "project" }, &values));
+      expect_true(values.size() == 2);
+      expect_true(values["project"].empty());
+
+      // another storage for the same session sees the same properties
+      FileActiveSessionStorage other(path);
+      REQUIRE_FALSE(other.readProperty("label", &value));
+      expect_true(value == "report\nwith a newline");
+
+      expect_true(lineCount(readLog(path)) == 2);
+
+      // the properties directory is kept up to date for older versions
+      std::string legacyValue;
+      REQUIRE_FALSE(readStringFromFile(path.completeChildPath("properites/label"), &legacyValue));
+      expect_true(legacyValue == "report\nwith a newline");
+
+      REQUIRE_FALSE(storage.destroy());
+   }
+
+   test_that("Sessions from before the log are read and migrated")
+   {
+      FilePath path = scratchPath();
+      writeLegacySession(path);
+      FileActiveSessionStorage storage(path);
+
+      std::string value;
+      REQUIRE_FALSE(storage.readProperty("working_directory", &value));
+      expect_true(value == "~/project");
+
+      REQUIRE_FALSE(storage.writeProperty("label", "migrated"));
+      std::string legacyValue;
+      REQUIRE_FALSE(readStringFromFile(path.completeChildPath("properites/label"), &legacyValue));
+      expect_true(legacyValue == "migrated");
+
+      // once logged, the properties no longer depend on the directory
+      REQUIRE_FALSE(path.completeChildPath("properites").remove());
+
+      std::map<std::string, std::string> values;
+      REQUIRE_FALSE(storage.readProperties(&values));
+      expect_true(values["last_used"] == "1650000000000");
+      expect_true(values["working_directory"] == "~/project");
+      expect_true(values["label"] == "migrated");
+
+      REQUIRE_FALSE(storage.destroy());
+   }
+
+   test_that("Writes by other processes are seen")
+   {
+      FilePath path = scratchPath();
+      FileActiveSessionStorage storage(path);
+      REQUIRE_FALSE(storage.writeProperty("label", "mine"));
+
+      std::string value;
+      REQUIRE_FALSE(storage.readProperty("label", &value));
+      expect_true(value == "mine");
+
+      // a complete write, then one still in progress
+      FilePath log = path.completeChildPath("properties-log");
+      REQUIRE_FALSE(writeStringToFile(log, "{\"label\":\"theirs\"}\n{\"label\":\"par",
+                                      string_utils::LineEndingPassthrough, false));
+
+      REQUIRE_FALSE(storage.readProperty("label", &value));
+      expect_true(value == "theirs");
+
+      REQUIRE_FALSE(storage.destroy());
+   }
+
+   test_that("Rewrites that keep the size of the log are seen")
+   {
+      FilePath path = scratchPath();
+      FileActiveSessionStorage storage(path);
+      REQUIRE_FALSE(storage.writeProperty("label", "mine"));
+
+      std::string value;
+      REQUIRE_FALSE(storage.readProperty("label", &value));
+      expect_true(value == "mine");
+
+      // well within the same second, but past the granularity of file times
+      boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+      FilePath log = path.completeChildPath("properties-log");
+      REQUIRE_FALSE(writeStringToFile(log, "{\"label\":\"ours\"}\n"));
+
+      REQUIRE_FALSE(storage.readProperty("label", &value));
+      expect_true(value == "ours");
+
+      REQUIRE_FALSE(storage.destroy());
+   }
+
+   test_that("Sessions with properties are recognized")
+   {
+      FilePath legacyPath = scratchPath();
+      writeLegacySession(legacyPath);
+      expect_true(FileActiveSessionStorage::hasProperties(legacyPath));
+
+      FilePath path = scratchPath();
+      FileActiveSessionStorage storage(path);
+      expect_false(FileActiveSessionStorage::hasProperties(path));
+      REQUIRE_FALSE(storage.writeProperty("label", "logged"));
+      expect_true(FileActiveSessionStorage::hasProperties(path));
+
+      REQUIRE_FALSE(FileActiveSessionStorage(legacyPath).destroy());
+      REQUIRE_FALSE(storage.destroy());
+   }
+
+   test_that("Frequent writes are held back")
+   {
+      FilePath path = scratchPath();
+      FileActiveSessionStorage storage(path);
+      REQUIRE_FALSE(storage.writeProperty("label", "busy"));
+
+      REQUIRE_FALSE(storage.writeProperty("executing", "1"));
+      REQUIRE_FALSE(storage.writeProperty("executing", "0"));
+      REQUIRE_FALSE(storage.writeProperty("last_used", "1650000000001"));
+      expect_true(readLog(path).find("executing") == std::string::npos);
+
+      // but are seen in this process
+      std::string value;
+      REQUIRE_FALSE(storage.readProperty("last_used", &value));
+      expect_true(value == "1650000000001");
+
+      FileActiveSessionStorage::flushDeferredWrites();
+      std::string log = readLog(path);
+      expect_true(lineCount(log) == 2);
+      expect_true(log.find("\"executing\":\"0\"") != std::string::npos);
+
+      // other writes take any held back ones with them
+      REQUIRE_FALSE(storage.writeProperty("last_used", "1650000000002"));
+      REQUIRE_FALSE(storage.writeProperty("label", "idle"));
+      expect_true(readLog(path).find("1650000000002") != std::string::npos);
+
+      REQUIRE_FALSE(storage.destroy());
+   }
+
+   test_that("Logs are compacted")
+   {
+      FilePath path = scratchPath();
+      FileActiveSessionStorage storage(path);
+      REQUIRE_FALSE(storage.writeProperty("project", "~/project"));
+      for (int i = 0; i < 200; i++)
+         REQUIRE_FALSE(storage.writeProperty("label", std::to_string(i)));
+
+      expect_true(lineCount(readLog(path)) <= 64);
+
+      FileActiveSessionStorage other(path);
+      std::map<std::string, std::string> values;
+      REQUIRE_FALSE(other.readProperties(&values));
+      expect_true(values["label"] == "199");
+      expect_true(values["project"] == "~/project");
+
+      REQUIRE_FALSE(storage.destroy());
+      expect_false(path.exists());
+   }
+}
+
+benchmark_context("File active session storage listing")
+{
+   std::vector<FilePath> legacySessions, loggedSessions;
+   for (int i = 0; i < 50; i++)
+   {
+      legacySessions.push_back(scratchPath());
+      writeLegacySession(legacySessions.back());
+
+      loggedSessions.push_back(scratchPath());
+      FileActiveSessionStorage storage(loggedSessions.back());
+      std::map<std::string, std::string> values;
+      REQUIRE_FALSE(FileActiveSessionStorage(legacySessions.back()).readProperties(&values));
+      REQUIRE_FALSE(storage.writeProperties(values));
+   }
+
+   benchmark_that("Read 50 sessions stored one file per property")
+   {
+      std::size_t count = 0;
+      for (const FilePath& path : legacySessions)
+      {
+         std::map<std::string, std::string> values;
+         FileActiveSessionStorage(path).readProperties(&values);
+         count += values.size();
+      }
+      return count;
+   };
+
+   benchmark_that("Read 50 sessions stored in logs")
+   {
+      std::size_t count = 0;
+      for (const FilePath& path : loggedSessions)
+      {
+         std::map<std::string, std::string> values;
+         FileActiveSessionStorage(path).readProperties(&values);
+         count += values.size();
+      }
+      return count;
+   };
+
+   for (const FilePath& path : legacySessions)
+      path.removeIfExists();
+   for (const FilePath& path : loggedSessions)
+      FileActiveSessionStorage(path).destroy();
+}
+
+} // namespace tests
+} // namespace r_util
+} // namespace core
+} // namespace rstudio
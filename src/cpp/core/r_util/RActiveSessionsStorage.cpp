@@ -305,7 +305,6 @@ void RpcActiveSessionsStorage::migrateSessions() const
 {
 #ifndef _WIN32
    static const std::string migratedFileName = ".migrated";
-   static const std::string properites = "properites";
 
    FilePath rootMigratedFile = storagePath_.completeChildPath(migratedFileName);
    if (!rootMigratedFile.exists())
@@ -324,7 +323,7 @@ void RpcActiveSessionsStorage::migrateSessions() const
          FilePath migratedFile = child.completeChildPath(migratedFileName);
          if (!migratedFile.exists())
          {
-            if (child.completeChildPath(properites).exists())
+            if (FileActiveSessionStorage::hasProperties(child))
             {
                std::string sessionId;
                Error error = sessionIdFromFolder(child, &sessionId);
@@ -27,7 +27,9 @@
 #elif defined(__linux__)
 #include <pty.h>
 #include <asm/ioctls.h>
+#include <sys/epoll.h>
 #include <sys/prctl.h>
+#include <sys/syscall.h>
 #endif
 
 #include <sys/wait.h>
@@ -74,6 +76,18 @@ const boost::posix_time::milliseconds kCheckSubprocDelay =
 const boost::posix_time::milliseconds kCheckCwdDelay =
                                          boost::posix_time::milliseconds(2000);
 
+// kinds of events reported for asynchronous children (in the low bits of
+// the event data, below the child's id)
+enum
+{
+   kStdoutEvent,
+   kStderrEvent,
+   kExitEvent,
+   kEventKinds
+};
+
+const int kEventKindBits = 2;
+
 int resolveExitStatus(int status)
 {
    if (WIFEXITED(status))
@@ -935,14 +949,70 @@ struct AsyncChildProcess::AsyncImpl
       : calledOnStarted_(false),
         finishedStdout_(false),
         finishedStderr_(false),
-        exited_(false)
+        exited_(false),
+        epollFd_(-1),
+        pidFd_(-1)
+   {
+      for (int i = 0; i < kEventKinds; i++)
+      {
+         watchedFds_[i] = -1;
+         ready_[i] = true;
+      }
+   }
+
+   ~AsyncImpl()
    {
+      unwatchAll();
    }
+
    bool calledOnStarted_;
    bool finishedStdout_;
    bool finishedStderr_;
    bool exited_;
    boost::scoped_ptr<ChildProcessSubprocPoll> pSubprocPoll_;
+
+   // the epoll instance (if any) watching for output and exit, the pidfd
+   // registered to watch for exit, and the descriptor registered for each
+   // kind of event. a descriptor which isn't registered is checked every
+   // time the process is polled; one which is, only when it's been reported
+   // ready since the last check
+   int epollFd_;
+   int pidFd_;
+   int watchedFds_[kEventKinds];
+   bool ready_[kEventKinds];
+
+   bool isReady(int kind)
+   {
+      if (watchedFds_[kind] == -1)
+         return true;
+
+      bool ready = ready_[kind];
+      ready_[kind] = false;
+      return ready;
+   }
+
+   void unwatch(int kind)
+   {
+#ifdef __linux__
+      if (watchedFds_[kind] != -1)
+      {
+         ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, watchedFds_[kind], nullptr);
+         watchedFds_[kind] = -1;
+      }
+#endif
+   }
+
+   void unwatchAll()
+   {
+      for (int i = 0; i < kEventKinds; i++)
+         unwatch(i);
+
+      if (pidFd_ != -1)
+      {
+         ::close(pidFd_);
+         pidFd_ = -1;
+      }
+   }
 };
 
 AsyncChildProcess::AsyncChildProcess(const std::string& exe,
@@ -988,6 +1058,7 @@ Error AsyncChildProcess::terminate()
       {
          pAsyncImpl_->finishedStderr_ = true;
          pAsyncImpl_->finishedStdout_ = true;
+         pAsyncImpl_->unwatch(kStdoutEvent);
       }
 #ifndef __APPLE__
    }
@@ -1077,13 +1148,16 @@ void AsyncChildProcess::poll()
    bool hasRecentOutput = false;
 
    // check stdout and fire event if we got output
-   if (!pAsyncImpl_->finishedStdout_)
+   if (!pAsyncImpl_->finishedStdout_ && pAsyncImpl_->isReady(kStdoutEvent))
    {
       bool eof;
       std::string out;
       Error error = readPipe(pImpl_->fdStdout, &out, &eof);
       if (error)
       {
+         // check this pipe on every poll from now on, rather than being
+         // woken continually by an error we've already reported
+         pAsyncImpl_->unwatch(kStdoutEvent);
          reportError(error);
       }
       else
@@ -1095,12 +1169,15 @@ void AsyncChildProcess::poll()
          }
 
          if (eof)
+         {
            pAsyncImpl_->finishedStdout_ = true;
+           pAsyncImpl_->unwatch(kStdoutEvent);
+         }
       }
    }
 
    // check stderr and fire event if we got output
-   if (!pAsyncImpl_->finishedStderr_)
+   if (!pAsyncImpl_->finishedStderr_ && pAsyncImpl_->isReady(kStderrEvent))
    {
       bool eof;
       std::string err;
@@ -1108,6 +1185,7 @@ void AsyncChildProcess::poll()
 
       if (error)
       {
+         pAsyncImpl_->unwatch(kStderrEvent);
          reportError(error);
       }
       else
@@ -1119,24 +1197,33 @@ void AsyncChildProcess::poll()
          }
 
          if (eof)
+         {
            pAsyncImpl_->finishedStderr_ = true;
+           pAsyncImpl_->unwatch(kStderrEvent);
+         }
       }
    }
 
-   // Check for exited. Note that this method specifies WNOHANG
+   // Check for exited (when watching a pidfd, only once it's reported the
+   // exit). Note that this method specifies WNOHANG
    // so we don't block forever waiting for a process the exit. We may
    // not be able to reap the child due to an error (typically ECHILD,
    // which occurs if the child was reaped by a global handler) in which
    // case we'll allow the exit sequence to proceed and simply pass -1 as
    // the exit status.
    int status;
-   PidType result = posix::posixCall<PidType>(
-            boost::bind(::waitpid, pImpl_->pid, &status, WNOHANG));
+   PidType result = 0;
+   if (pAsyncImpl_->isReady(kExitEvent))
+   {
+      result = posix::posixCall<PidType>(
+               boost::bind(::waitpid, pImpl_->pid, &status, WNOHANG));
+   }
 
    // either a normal exit or an error while waiting
    if (result != 0)
    {
-      // close all of our pipes
+      // stop watching and close all of our pipes
+      pAsyncImpl_->unwatchAll();
       pImpl_->closeAll(ERROR_LOCATION);
 
       // fire exit event
@@ -1184,6 +1271,64 @@ bool AsyncChildProcess::exited()
    return pAsyncImpl_->exited_;
 }
 
+#ifdef __linux__
+
+Error AsyncChildProcess::watchEvents(int epollFd, std::uint64_t id)
+{
+   AsyncImpl& impl = *pAsyncImpl_;
+   impl.epollFd_ = epollFd;
+
+   auto watch = [&](int fd, int kind) -> Error
+   {
+      struct epoll_event event = {};
+      event.events = EPOLLIN;
+      event.data.u64 = (id << kEventKindBits) | kind;
+      if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1)
+         return systemError(errno, ERROR_LOCATION);
+
+      impl.watchedFds_[kind] = fd;
+      return Success();
+   };
+
+   Error error = watch(pImpl_->fdStdout, kStdoutEvent);
+   if (!error && !options().pseudoterminal)
+      error = watch(pImpl_->fdStderr, kStderrEvent);
+
+   // watch for exit with a pidfd where the kernel supports them (5.3 and
+   // later); otherwise we check for exit every time we're polled
+#ifdef SYS_pidfd_open
+   if (!error)
+   {
+      impl.pidFd_ = static_cast<int>(::syscall(SYS_pidfd_open, pImpl_->pid, 0));
+      if (impl.pidFd_ != -1)
+         error = watch(impl.pidFd_, kExitEvent);
+   }
+#endif
+
+   if (error)
+      impl.unwatchAll();
+   return error;
+}
+
+void AsyncChildProcess::unwatchEvents()
+{
+   pAsyncImpl_->unwatchAll();
+}
+
+void AsyncChildProcess::onEvent(std::uint64_t data)
+{
+   std::uint64_t kind = data & ((1 << kEventKindBits) - 1);
+   if (kind < kEventKinds)
+      pAsyncImpl_->ready_[kind] = true;
+}
+
+std::uint64_t AsyncChildProcess::eventId(std::uint64_t data)
+{
+   return data >> kEventKindBits;
+}
+
+#endif
+
 struct AsioAsyncChildProcess::Impl : public boost::enable_shared_from_this<AsioAsyncChildProcess::Impl>
 {
    Impl(AsioAsyncChildProcess* parent,
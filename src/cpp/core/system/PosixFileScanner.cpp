@@ -16,12 +16,28 @@
 #include <core/system/FileScanner.hpp>
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+# include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <memory>
+
+#include <boost/bind/bind.hpp>
+#include <boost/noncopyable.hpp>
 
 #include <shared_core/Error.hpp>
 #include <core/Log.hpp>
 #include <shared_core/FilePath.hpp>
 #include <core/BoostThread.hpp>
+#include <core/Thread.hpp>
 
 #include "config.h"
 
@@ -31,66 +47,480 @@ namespace system {
 
 namespace {
 
-#if defined(__APPLE__) && !defined(HAVE_SCANDIR_POSIX)
-int entryFilter(struct dirent *entry)
-#else
-int entryFilter(const struct dirent *entry)
+// listing directories is bound by the file system rather than the CPU, so
+// more threads than this rarely help
+const std::size_t kMaxScanThreads = 8;
+
+#ifdef __linux__
+// a record returned by getdents64 (glibc only declares it from 2.30)
+struct LinuxDirent64
+{
+   ino64_t d_ino;
+   off64_t d_off;
+   unsigned short d_reclen;
+   unsigned char d_type;
+   char d_name[];
+};
 #endif
+
+#ifdef HAVE_STATX
+// set when the kernel doesn't support statx (older than 4.11)
+std::atomic<bool> s_statxUnavailable(false);
+#endif
+
+struct DirectoryEntry
+{
+   std::string name;
+   unsigned char type;
+};
+
+bool directoryEntryLessThan(const DirectoryEntry& a, const DirectoryEntry& b)
+{
+   return a.name < b.name;
+}
+
+void addEntry(const char* name,
+              unsigned char type,
+              std::vector<DirectoryEntry>* pEntries)
 {
-   if (::strcmp(entry->d_name, ".") == 0 || ::strcmp(entry->d_name, "..") == 0)
-      return 0;
+   if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+      return;
+
+   pEntries->push_back(DirectoryEntry { name, type });
+}
+
+std::string childPath(const std::string& dirPath, const std::string& name)
+{
+   std::string path;
+   path.reserve(dirPath.size() + name.size() + 1);
+   path.append(dirPath);
+   if (path.empty() || path[path.size() - 1] != '/')
+      path.push_back('/');
+   path.append(name);
+   return path;
+}
+
+FileInfo makeFileInfo(const std::string& path,
+                      mode_t mode,
+                      uintmax_t size,
+                      std::time_t lastWriteTime)
+{
+   if (S_ISDIR(mode))
+      return FileInfo(path, true, S_ISLNK(mode));
    else
-      return 1;
+      return FileInfo(path, false, size, lastWriteTime, S_ISLNK(mode));
 }
 
-// note: because R may change LC_COLLATE, we cannot
-// use strcoll (otherwise we run into race issues where
-// the file monitor attempts to access LC_COLLATE just as
-// R is replacing it). to avoid this, we use strcmp and
-// don't sort according to locale.
-#if !defined(HAVE_SCANDIR_POSIX)
-int alphasort(const void* voidlhs, const void* voidrhs)
+// reads the attributes of an entry (relative to its directory, so the path
+// isn't resolved again for each entry); returns an errno value on failure
+int statEntry(int dirFd,
+              const std::string& path,
+              const std::string& name,
+              FileInfo* pFileInfo)
 {
-   const dirent** lhs = (const dirent**)voidlhs;
-   const dirent** rhs = (const dirent**)voidrhs;
+#ifdef HAVE_STATX
+   if (!s_statxUnavailable)
+   {
+      // only the fields we report
+      struct statx stx;
+      if (::statx(dirFd,
+                  name.c_str(),
+                  AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT,
+                  STATX_TYPE | STATX_SIZE | STATX_MTIME,
+                  &stx) == 0)
+      {
+         *pFileInfo = makeFileInfo(path, stx.stx_mode, stx.stx_size, stx.stx_mtime.tv_sec);
+         return 0;
+      }
+
+      if (errno != ENOSYS)
+         return errno;
+
+      s_statxUnavailable = true;
+   }
+#endif
+
+   struct stat st;
+   if (::fstatat(dirFd, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) == -1)
+      return errno;
+
+#ifdef __APPLE__
+   *pFileInfo = makeFileInfo(path, st.st_mode, st.st_size, st.st_mtimespec.tv_sec);
 #else
-int alphasort(const dirent** lhs, const dirent** rhs)
+   *pFileInfo = makeFileInfo(path, st.st_mode, st.st_size, st.st_mtime);
+#endif
+   return 0;
+}
+
+Error readEntries(int dirFd,
+                  const std::string& dirPath,
+                  std::vector<DirectoryEntry>* pEntries)
 {
+#ifdef __linux__
+   // read the raw entries, whose types save a stat call for each directory
+   alignas(LinuxDirent64) char buffer[32768];
+   while (true)
+   {
+      long bytes = ::syscall(SYS_getdents64, dirFd, buffer, sizeof(buffer));
+      if (bytes == -1 && errno == EINTR)
+         continue;
+
+      if (bytes == -1)
+      {
+         Error error = systemError(errno, ERROR_LOCATION);
+         error.addProperty("path", dirPath);
+         return error;
+      }
+
+      if (bytes == 0)
+         break;
+
+      for (long offset = 0; offset < bytes; )
+      {
+         LinuxDirent64* pEntry = reinterpret_cast<LinuxDirent64*>(buffer + offset);
+         addEntry(pEntry->d_name, pEntry->d_type, pEntries);
+         offset += pEntry->d_reclen;
+      }
+   }
+#else
+   // readdir takes ownership of (and closes) the descriptor it's given
+   int readFd = ::dup(dirFd);
+   DIR* pDir = readFd == -1 ? nullptr : ::fdopendir(readFd);
+   if (pDir == nullptr)
+   {
+      Error error = systemError(errno, ERROR_LOCATION);
+      error.addProperty("path", dirPath);
+      if (readFd != -1)
+         ::close(readFd);
+      return error;
+   }
+
+   while (struct dirent* pEntry = ::readdir(pDir))
+      addEntry(pEntry->d_name, pEntry->d_type, pEntries);
+
+   ::closedir(pDir);
 #endif
-   return strcmp((*lhs)->d_name, (*rhs)->d_name);
+
+   return Success();
 }
 
-// wrapper for scandir api
-Error scanDir(const std::string& dirPath, std::vector<std::string>* pNames)
+// reads the contents of a directory, sorted by name
+Error listDirectory(const std::string& dirPath, std::vector<FileInfo>* pFiles)
 {
-   // read directory contents into namelist
-   struct dirent **namelist;
-   int entries = ::scandir(dirPath.c_str(),
-                           &namelist,
-                           entryFilter,
-                           alphasort);
-   if (entries == -1)
+   int dirFd = ::open(dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+   if (dirFd == -1)
    {
       Error error = systemError(errno, ERROR_LOCATION);
       error.addProperty("path", dirPath);
       return error;
    }
 
-   // extract the namelist then free it
-   for(int i=0; i<entries; i++)
+   // note: because R may change LC_COLLATE, we cannot use strcoll
+   // (otherwise we run into race issues where the file monitor attempts
+   // to access LC_COLLATE just as R is replacing it). to avoid this, we
+   // compare bytes and don't sort according to locale.
+   std::vector<DirectoryEntry> entries;
+   Error error = readEntries(dirFd, dirPath, &entries);
+   if (error)
    {
-      // get the name (then free it)
-      std::string name(namelist[i]->d_name);
-      ::free(namelist[i]);
+      ::close(dirFd);
+      return error;
+   }
+   std::sort(entries.begin(), entries.end(), directoryEntryLessThan);
+
+   // get the attributes of the entries (directories only need a stat when
+   // the file system doesn't report their type)
+   pFiles->reserve(entries.size());
+   for (const DirectoryEntry& entry : entries)
+   {
+      std::string path = childPath(dirPath, entry.name);
+      if (entry.type == DT_DIR)
+      {
+         pFiles->push_back(FileInfo(path, true, false));
+         continue;
+      }
 
-      // add to the vector
-      pNames->push_back(name);
+      FileInfo fileInfo;
+      int errorNumber = statEntry(dirFd, path, entry.name, &fileInfo);
+      if (errorNumber != 0)
+      {
+         if (errorNumber != ENOENT && errorNumber != EACCES)
+         {
+            Error error = systemError(errorNumber, ERROR_LOCATION);
+            error.addProperty("path", path);
+            LOG_ERROR(error);
+         }
+         continue;
+      }
+
+      pFiles->push_back(fileInfo);
    }
-   ::free(namelist);
 
+   ::close(dirFd);
    return Success();
 }
 
+bool shouldRecurse(const FileScannerOptions& options, const FileInfo& fileInfo)
+{
+   return options.recursive &&
+          fileInfo.isDirectory() &&
+          !fileInfo.isSymlink();
+}
+
+// a directory listed by a parallel scan; subdirs holds the listing of each
+// directory in files that was scanned (and null for other entries)
+struct ScannedDirectory
+{
+   std::vector<FileInfo> files;
+   std::vector<std::unique_ptr<ScannedDirectory> > subdirs;
+};
+
+struct ScanTask
+{
+   FileInfo directory;
+   ScannedDirectory* pResult;
+};
+
+// each worker owns a queue of directories; it takes new work from the back
+// of its own queue (depth first, as directories are listed) and when that
+// runs dry steals from the front of the others' queues
+struct WorkerQueue
+{
+   boost::mutex mutex;
+   std::deque<ScanTask> tasks;
+};
+
+class ParallelScan : boost::noncopyable
+{
+public:
+   ParallelScan(const FileScannerOptions& options, std::size_t threadCount)
+      : options_(options),
+        pendingTasks_(0),
+        stopped_(false),
+        interrupted_(false)
+   {
+      for (std::size_t i = 0; i < threadCount; i++)
+         queues_.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+   }
+
+   // scans the root on the calling thread, which then works alongside the
+   // other threads until everything beneath it has been listed
+   Error scan(const FileInfo& root, ScannedDirectory* pRoot)
+   {
+      // the workers use this object (and the caller's tree) until they've
+      // been joined, so the calling thread mustn't be interrupted out of the
+      // scan; instead it polls for interrupts, which leaves the request
+      // pending for the caller's next interruption point
+      boost::this_thread::disable_interruption disableInterruption;
+
+      Error error = scanDirectory(0, root, pRoot);
+      if (error)
+         return error;
+
+      boost::thread_group threads;
+      try
+      {
+         for (std::size_t i = 1; i < queues_.size(); i++)
+            threads.create_thread(boost::bind(&ParallelScan::run, this, i));
+      }
+      catch (const boost::thread_resource_error& e)
+      {
+         // carry on with the threads we have (the calling thread can
+         // finish the scan by itself)
+         LOG_ERROR(Error(boost::thread_error::ec_from_exception(e), ERROR_LOCATION));
+      }
+
+      run(0);
+      stopped_ = true;
+      threads.join_all();
+
+      // mark as expected to suppress logging
+      if (interrupted_)
+      {
+         Error error = core::systemError(boost::system::errc::interrupted, ERROR_LOCATION);
+         error.setExpected();
+         return error;
+      }
+
+      return Success();
+   }
+
+private:
+   Error scanDirectory(std::size_t worker,
+                       const FileInfo& directory,
+                       ScannedDirectory* pResult)
+   {
+      // the callbacks aren't required to be thread safe, so they're
+      // invoked one call at a time
+      if (options_.onBeforeScanDir)
+      {
+         Error error;
+         LOCK_MUTEX(callbackMutex_)
+         {
+            error = options_.onBeforeScanDir(directory);
+         }
+         END_LOCK_MUTEX
+         if (error)
+            return error;
+      }
+
+      std::vector<FileInfo> files;
+      Error error = listDirectory(directory.absolutePath(), &files);
+      if (error)
+         return error;
+
+      if (options_.filter)
+      {
+         LOCK_MUTEX(callbackMutex_)
+         {
+            for (FileInfo& fileInfo : files)
+            {
+               if (options_.filter(fileInfo))
+                  pResult->files.push_back(std::move(fileInfo));
+            }
+         }
+         END_LOCK_MUTEX
+      }
+      else
+      {
+         pResult->files = std::move(files);
+      }
+
+      // queue the subdirectories
+      pResult->subdirs.resize(pResult->files.size());
+      for (std::size_t i = 0; i < pResult->files.size(); i++)
+      {
+         if (shouldRecurse(options_, pResult->files[i]))
+         {
+            pResult->subdirs[i].reset(new ScannedDirectory());
+            push(worker, ScanTask { pResult->files[i], pResult->subdirs[i].get() });
+         }
+      }
+
+      return Success();
+   }
+
+   void push(std::size_t worker, const ScanTask& task)
+   {
+      pendingTasks_++;
+      WorkerQueue& queue = *queues_[worker];
+      LOCK_MUTEX(queue.mutex)
+      {
+         queue.tasks.push_back(task);
+      }
+      END_LOCK_MUTEX
+   }
+
+   bool pop(std::size_t worker, ScanTask* pTask)
+   {
+      for (std::size_t i = 0; i < queues_.size(); i++)
+      {
+         bool own = i == 0;
+         WorkerQueue& queue = *queues_[(worker + i) % queues_.size()];
+         LOCK_MUTEX(queue.mutex)
+         {
+            if (!queue.tasks.empty())
+            {
+               if (own)
+               {
+                  *pTask = std::move(queue.tasks.back());
+                  queue.tasks.pop_back();
+               }
+               else
+               {
+                  *pTask = std::move(queue.tasks.front());
+                  queue.tasks.pop_front();
+               }
+               return true;
+            }
+         }
+         END_LOCK_MUTEX
+      }
+      return false;
+   }
+
+   void run(std::size_t worker)
+   {
+      try
+      {
+         while (!stopped_)
+         {
+            // the calling thread checks for interrupts on behalf of the scan
+            if (worker == 0 && boost::this_thread::interruption_requested())
+            {
+               interrupted_ = true;
+               stopped_ = true;
+               break;
+            }
+
+            ScanTask task;
+            if (pop(worker, &task))
+            {
+               // as with a sequential scan, we continue if a subdirectory
+               // can't be scanned because we don't want one "bad" directory
+               // to cause us to abort the entire scan
+               Error error = scanDirectory(worker, task.directory, task.pResult);
+               if (error && !isPathNotFoundError(error))
+                  LOG_ERROR(error);
+
+               // decremented only after any subdirectories were queued, so
+               // zero means there is no more work anywhere
+               pendingTasks_--;
+            }
+            else if (pendingTasks_ == 0)
+            {
+               break;
+            }
+            else
+            {
+               boost::this_thread::sleep_for(boost::chrono::microseconds(200));
+            }
+         }
+      }
+      catch (const boost::thread_interrupted&)
+      {
+         interrupted_ = true;
+         stopped_ = true;
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+   }
+
+   const FileScannerOptions& options_;
+   std::vector<std::unique_ptr<WorkerQueue> > queues_;
+   boost::mutex callbackMutex_;
+   std::atomic<long> pendingTasks_;
+   std::atomic<bool> stopped_;
+   std::atomic<bool> interrupted_;
+};
+
+void appendScanned(const tree<FileInfo>::iterator_base& parent,
+                   ScannedDirectory* pDirectory,
+                   tree<FileInfo>* pTree)
+{
+   for (std::size_t i = 0; i < pDirectory->files.size(); i++)
+   {
+      tree<FileInfo>::iterator_base child = pTree->append_child(parent,
+                                                                pDirectory->files[i]);
+      if (pDirectory->subdirs[i])
+      {
+         appendScanned(child, pDirectory->subdirs[i].get(), pTree);
+         pDirectory->subdirs[i].reset();
+      }
+   }
+}
+
+std::size_t scanThreads(const FileScannerOptions& options)
+{
+   if (!options.recursive)
+      return 1;
+
+   if (options.threads != 0)
+      return options.threads;
+
+   return std::min<std::size_t>(std::max(boost::thread::hardware_concurrency(), 1U),
+                                kMaxScanThreads);
+}
+
 } // anonymous namespace
 
 Error scanFiles(const tree<FileInfo>::iterator_base& fromNode,
@@ -100,8 +530,19 @@ Error scanFiles(const tree<FileInfo>::iterator_base& fromNode,
    // clear all existing
    pTree->erase_children(fromNode);
 
-   // create FilePath for root
-   FilePath rootPath(fromNode->absolutePath());
+   // scan large trees in parallel when requested
+   std::size_t threads = scanThreads(options);
+   if (threads > 1)
+   {
+      ScannedDirectory root;
+      ParallelScan scan(options, threads);
+      Error error = scan.scan(*fromNode, &root);
+      if (error)
+         return error;
+
+      appendScanned(fromNode, &root, pTree);
+      return Success();
+   }
 
    // yield if requested (only applies to recursive scans)
    if (options.recursive && options.yield)
@@ -116,13 +557,13 @@ Error scanFiles(const tree<FileInfo>::iterator_base& fromNode,
    }
 
    // read directory contents
-   std::vector<std::string> names;
-   Error error = scanDir(fromNode->absolutePath(), &names);
+   std::vector<FileInfo> files;
+   Error error = listDirectory(fromNode->absolutePath(), &files);
    if (error)
       return error;
 
-   // iterate over the names
-   for (const std::string& name : names)
+   // iterate over the files
+   for (const FileInfo& fileInfo : files)
    {
       // check for interrupt (mark as expected to suppress logging)
       if (boost::this_thread::interruption_requested())
@@ -132,43 +573,6 @@ Error scanFiles(const tree<FileInfo>::iterator_base& fromNode,
          return error;
       }
 
-      // compute the path
-      std::string path = rootPath.completeChildPath(name).getAbsolutePath();
-
-      // get the attributes
-      struct stat st;
-      int res = ::lstat(path.c_str(), &st);
-      if (res == -1)
-      {
-         if (errno != ENOENT && errno != EACCES)
-         {
-            Error error = systemError(errno, ERROR_LOCATION);
-            error.addProperty("path", path);
-            LOG_ERROR(error);
-         }
-         continue;
-      }
-
-      // create the FileInfo
-      FileInfo fileInfo;
-      bool isSymlink = S_ISLNK(st.st_mode);
-      if (S_ISDIR(st.st_mode))
-      {
-         fileInfo = FileInfo(path, true, isSymlink);
-      }
-      else
-      {
-         fileInfo = FileInfo(path,
-                             false,
-                             st.st_size,
-#ifdef __APPLE__
-                             st.st_mtimespec.tv_sec,
-#else
-                             st.st_mtime,
-#endif
-                             isSymlink);
-      }
-
       // apply the filter (if any)
       if (!options.filter || options.filter(fileInfo))
       {
@@ -178,15 +582,16 @@ Error scanFiles(const tree<FileInfo>::iterator_base& fromNode,
             tree<FileInfo>::iterator_base child = pTree->append_child(fromNode,
                                                                       fileInfo);
             // recurse if requested and this isn't a link
-            if (options.recursive && !fileInfo.isSymlink())
+            if (shouldRecurse(options, fileInfo))
             {
                // try to scan the files in the subdirectory -- if we fail
                // we continue because we don't want one "bad" directory
                // to cause us to abort the entire scan. yes the tree
                // will be incomplete however it will be even more incomplete
-               // if we fail entirely
+               // if we fail entirely. (directories are listed without a
+               // stat, so one may have been removed since it was listed)
                Error error = scanFiles(child, options, pTree);
-               if (error)
+               if (error && !isPathNotFoundError(error))
                   LOG_ERROR(error);
             }
          }
@@ -204,4 +609,3 @@ Error scanFiles(const tree<FileInfo>::iterator_base& fromNode,
 } // namespace system
 } // namespace core
 } // namespace rstudio
-
@@ -0,0 +1,320 @@
+/*
+ * PosixFileScannerTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef _WIN32
+
+#include <core/system/FileScanner.hpp>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <set>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <core/BoostThread.hpp>
+#include <core/FileSerializer.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace system {
+namespace tests {
+
+namespace {
+
+// scans as scanFiles did before it read raw directory entries: scandir
+// sorted by name, then an lstat of every entry
+void scanWithLstat(const tree<FileInfo>::iterator_base& fromNode,
+                   const FileScannerOptions& options,
+                   tree<FileInfo>* pTree)
+{
+   struct dirent** namelist;
+   int entries = ::scandir(fromNode->absolutePath().c_str(), &namelist, nullptr, nullptr);
+   if (entries == -1)
+      return;
+
+   std::vector<std::string> names;
+   for (int i = 0; i < entries; i++)
+   {
+      std::string name = namelist[i]->d_name;
+      if (name != "." && name != "..")
+         names.push_back(name);
+      ::free(namelist[i]);
+   }
+   ::free(namelist);
+   std::sort(names.begin(), names.end());
+
+   for (const std::string& name : names)
+   {
+      std::string path = fromNode->absolutePath() + "/" + name;
+      struct stat st;
+      if (::lstat(path.c_str(), &st) == -1)
+         continue;
+
+      FileInfo fileInfo = S_ISDIR(st.st_mode)
+         ? FileInfo(path, true, false)
+         : FileInfo(path, false, st.st_size, st.st_mtime, S_ISLNK(st.st_mode));
+      if (options.filter && !options.filter(fileInfo))
+         continue;
+
+      tree<FileInfo>::iterator_base child = pTree->append_child(fromNode, fileInfo);
+      if (options.recursive && fileInfo.isDirectory())
+         scanWithLstat(child, options, pTree);
+   }
+}
+
+std::vector<std::string> describe(const tree<FileInfo>& fileTree)
+{
+   std::vector<std::string> result;
+   for (tree<FileInfo>::iterator it = fileTree.begin(); it != fileTree.end(); ++it)
+   {
+      std::string description = std::string(fileTree.depth(it), ' ') +
+                                it->absolutePath();
+      if (it->isDirectory())
+         description += " dir";
+      else
+         description += " " + boost::lexical_cast<std::string>(it->size()) +
+                        " " + boost::lexical_cast<std::string>(it->lastWriteTime());
+      if (it->isSymlink())
+         description += " link";
+      result.push_back(description);
+   }
+   return result;
+}
+
+void writeFile(const FilePath& path, std::size_t size)
+{
+   REQUIRE_FALSE(writeStringToFile(path, std::string(size, 'x')));
+}
+
+// a tree of directories, each holding files of various sizes
+void createTree(const FilePath& root, int dirs, int files, int depth)
+{
+   REQUIRE_FALSE(root.ensureDirectory());
+   for (int file = 0; file < files; file++)
+      writeFile(root.completeChildPath("file" + boost::lexical_cast<std::string>(file) + ".R"), file);
+
+   if (depth == 0)
+      return;
+
+   for (int dir = 0; dir < dirs; dir++)
+      createTree(root.completeChildPath("dir" + boost::lexical_cast<std::string>(dir)),
+                 dirs, files, depth - 1);
+}
+
+tree<FileInfo> scan(const FilePath& root, const FileScannerOptions& options)
+{
+   tree<FileInfo> fileTree;
+   REQUIRE_FALSE(scanFiles(FileInfo(root), options, &fileTree));
+   return fileTree;
+}
+
+FilePath createTestTree()
+{
+   FilePath root;
+   REQUIRE_FALSE(FilePath::tempFilePath(root));
+   createTree(root, 3, 4, 2);
+
+   // entries which don't sort the same by locale and by byte
+   writeFile(root.completeChildPath("B.R"), 10);
+   writeFile(root.completeChildPath("a.R"), 11);
+   writeFile(root.completeChildPath(".hidden"), 12);
+   REQUIRE_FALSE(root.completeChildPath("empty").ensureDirectory());
+
+   // links aren't followed
+   REQUIRE(::symlink(root.completeChildPath("dir0").getAbsolutePath().c_str(),
+                     root.completeChildPath("linkToDir").getAbsolutePath().c_str()) == 0);
+   REQUIRE(::symlink("file0.R",
+                     root.completeChildPath("dir1/linkToFile").getAbsolutePath().c_str()) == 0);
+   return root;
+}
+
+} // anonymous namespace
+
+TEST_CASE("File scanner")
+{
+   FilePath root = createTestTree();
+
+   FileScannerOptions sequential;
+   sequential.recursive = true;
+   FileScannerOptions parallel = sequential;
+   parallel.threads = 4;
+
+   tree<FileInfo> expected;
+   scanWithLstat(expected.set_head(FileInfo(root)), sequential, &expected);
+
+   SECTION("Lists the same files as scandir and lstat")
+   {
+      std::vector<std::string> description = describe(expected);
+      REQUIRE(description.size() == 1 + 4 + 3 * (1 + 4 + 3 * (1 + 4)) + 6);
+      REQUIRE(describe(scan(root, sequential)) == description);
+      REQUIRE(describe(scan(root, parallel)) == description);
+   }
+
+   SECTION("Lists a single directory")
+   {
+      FileScannerOptions options;
+      tree<FileInfo> fileTree = scan(root, options);
+      REQUIRE(fileTree.size() == 1 + 12);
+      REQUIRE(fileTree.begin().number_of_children() == 12);
+
+      // threads only apply to recursive listings
+      options.threads = 4;
+      REQUIRE(describe(scan(root, options)) == describe(fileTree));
+   }
+
+   SECTION("Applies the filter and invokes the hook for each scanned directory")
+   {
+      for (FileScannerOptions options : { sequential, parallel })
+      {
+         std::multiset<std::string> scannedDirs;
+         options.filter = [](const FileInfo& fileInfo)
+         {
+            return !boost::algorithm::ends_with(fileInfo.absolutePath(), "/dir1") &&
+                   !boost::algorithm::ends_with(fileInfo.absolutePath(), ".hidden");
+         };
+         options.onBeforeScanDir = [&](const FileInfo& fileInfo)
+         {
+            scannedDirs.insert(fileInfo.absolutePath());
+            return Success();
+         };
+
+         tree<FileInfo> filtered;
+         scanWithLstat(filtered.set_head(FileInfo(root)), options, &filtered);
+
+         tree<FileInfo> fileTree = scan(root, options);
+         REQUIRE(describe(fileTree) == describe(filtered));
+
+         // the root, empty, and dir0 and dir2 along with their
+         // subdirectories other than dir1
+         REQUIRE(scannedDirs.size() == 1 + 2 * (1 + 2) + 1);
+         for (tree<FileInfo>::iterator it = fileTree.begin(); it != fileTree.end(); ++it)
+         {
+            if (it->isDirectory() && !it->isSymlink())
+               REQUIRE(scannedDirs.count(it->absolutePath()) == 1);
+         }
+      }
+   }
+
+   SECTION("Returns errors for the root and skips directories which fail")
+   {
+      for (FileScannerOptions options : { sequential, parallel })
+      {
+         std::string dir0 = root.completeChildPath("dir0").getAbsolutePath();
+         options.onBeforeScanDir = [&](const FileInfo& fileInfo) -> Error
+         {
+            if (fileInfo.absolutePath() == dir0)
+               return systemError(boost::system::errc::permission_denied, ERROR_LOCATION);
+            return Success();
+         };
+
+         tree<FileInfo> fileTree = scan(root, options);
+         REQUIRE(fileTree.size() == expected.size() - (4 + 3 * (1 + 4)));
+
+         tree<FileInfo> rootTree;
+         options.onBeforeScanDir = [](const FileInfo&)
+         {
+            return systemError(boost::system::errc::permission_denied, ERROR_LOCATION);
+         };
+         REQUIRE(scanFiles(FileInfo(root), options, &rootTree));
+
+         tree<FileInfo> missingTree;
+         options.onBeforeScanDir = boost::function<Error(const FileInfo&)>();
+         REQUIRE(scanFiles(FileInfo(root.completeChildPath("missing")), options, &missingTree));
+      }
+   }
+
+   SECTION("Stops a parallel scan when its thread is interrupted")
+   {
+      FileScannerOptions options = parallel;
+      std::atomic<bool> started(false);
+      options.onBeforeScanDir = [&](const FileInfo&)
+      {
+         started = true;
+         ::usleep(10000);
+         return Success();
+      };
+
+      Error error;
+      std::size_t scanned = 0;
+      bool interruptPending = false;
+      boost::thread scanThread([&]()
+      {
+         tree<FileInfo> fileTree;
+         error = scanFiles(FileInfo(root), options, &fileTree);
+         scanned = fileTree.size();
+         interruptPending = boost::this_thread::interruption_requested();
+      });
+
+      while (!started)
+         ::usleep(1000);
+      scanThread.interrupt();
+      scanThread.join();
+
+      REQUIRE(error);
+      REQUIRE(error.getCode() == boost::system::errc::interrupted);
+      REQUIRE(error.isExpected());
+      REQUIRE(scanned == 1);
+
+      // the request is left for the thread's next interruption point
+      REQUIRE(interruptPending);
+   }
+
+   REQUIRE_FALSE(root.remove());
+}
+
+benchmark_context("File scanner throughput")
+{
+   // 5 levels of 5 directories, each holding 8 files (31,240 files)
+   FilePath root;
+   REQUIRE_FALSE(FilePath::tempFilePath(root));
+   createTree(root, 5, 8, 5);
+
+   FileScannerOptions options;
+   options.recursive = true;
+
+   benchmark_that("Scan with scandir and lstat")
+   {
+      tree<FileInfo> fileTree;
+      scanWithLstat(fileTree.set_head(FileInfo(root)), options, &fileTree);
+      return fileTree.size();
+   };
+
+   benchmark_that("Scan on one thread")
+   {
+      return scan(root, options).size();
+   };
+
+   options.threads = 4;
+   benchmark_that("Scan on four threads")
+   {
+      return scan(root, options).size();
+   };
+
+   REQUIRE_FALSE(root.remove());
+}
+
+} // namespace tests
+} // namespace system
+} // namespace core
+} // namespace rstudio
+
+#endif // _WIN32
@@ -17,6 +17,11 @@
 
 #include <iostream>
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
 #include <boost/algorithm/cxx11/any_of.hpp>
 #include <boost/bind/bind.hpp>
 
@@ -81,46 +86,182 @@ Error runCommand(const std::string& command,
 }
 
 
-struct ProcessSupervisor::Impl
+namespace {
+
+// output read from a supervised child
+struct OutputCounts
 {
-   Impl() : isPolling(false) {}
-   bool isPolling;
-   std::vector<boost::shared_ptr<AsyncChildProcess> > children;
+   OutputCounts()
+      : stdoutBytes(0),
+        stderrBytes(0),
+        started(boost::posix_time::microsec_clock::universal_time())
+   {
+   }
+
+   std::uint64_t stdoutBytes;
+   std::uint64_t stderrBytes;
+   boost::posix_time::ptime started;
 };
 
-ProcessSupervisor::ProcessSupervisor()
-   : pImpl_(new Impl())
+struct SupervisedChild
 {
-}
+   boost::shared_ptr<AsyncChildProcess> pProcess;
+   boost::shared_ptr<OutputCounts> pCounts;
+   std::uint64_t id;
+};
 
-ProcessSupervisor::~ProcessSupervisor()
+void countOutput(const boost::function<void(ProcessOperations&, const std::string&)>& onOutput,
+                 boost::shared_ptr<OutputCounts> pCounts,
+                 bool isStderr,
+                 ProcessOperations& operations,
+                 const std::string& output)
 {
+   if (isStderr)
+      pCounts->stderrBytes += output.size();
+   else
+      pCounts->stdoutBytes += output.size();
+
+   onOutput(operations, output);
 }
 
-namespace {
+} // anonymous namespace
 
-Error runChild(boost::shared_ptr<AsyncChildProcess> pChild,
-               std::vector<boost::shared_ptr<AsyncChildProcess> >* pChildren,
-               boost::recursive_mutex* pMutex,
-               const ProcessCallbacks& callbacks)
+struct ProcessSupervisor::Impl
 {
-   // run the child
-   RECURSIVE_LOCK_MUTEX(*pMutex)
+   Impl() : isPolling(false), nextId(0), epollFd(-1)
    {
-      Error error = pChild->run(callbacks);
-      if (error)
-         return error;
+#ifdef __linux__
+      // children's output pipes and pidfds are watched with epoll, so we
+      // only read from children which have output or have exited
+      epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+      if (epollFd == -1)
+         LOG_ERROR(systemError(errno, ERROR_LOCATION));
+#endif
+   }
 
-      // add to the list of children
-      pChildren->push_back(pChild);
+   ~Impl()
+   {
+#ifdef __linux__
+      if (epollFd != -1)
+      {
+         for (const SupervisedChild& child : children)
+            child.pProcess->unwatchEvents();
+         ::close(epollFd);
+      }
+#endif
    }
-   END_LOCK_MUTEX
 
-   // success
-   return Success();
+   Error runChild(boost::shared_ptr<AsyncChildProcess> pChild,
+                  boost::recursive_mutex* pMutex,
+                  const ProcessCallbacks& callbacks)
+   {
+      // count the output read from the child
+      SupervisedChild child;
+      child.pProcess = pChild;
+      child.pCounts.reset(new OutputCounts());
+
+      ProcessCallbacks counted = callbacks;
+      if (callbacks.onStdout)
+      {
+         counted.onStdout = boost::bind(countOutput, callbacks.onStdout,
+                                        child.pCounts, false, _1, _2);
+      }
+      if (callbacks.onStderr)
+      {
+         counted.onStderr = boost::bind(countOutput, callbacks.onStderr,
+                                        child.pCounts, true, _1, _2);
+      }
+
+      // run the child
+      RECURSIVE_LOCK_MUTEX(*pMutex)
+      {
+         Error error = pChild->run(counted);
+         if (error)
+            return error;
+
+         child.id = nextId++;
+
+#ifdef __linux__
+         // watch for its output and exit (if we can't, it's just read every
+         // time it's polled)
+         if (epollFd != -1)
+         {
+            error = pChild->watchEvents(epollFd, child.id);
+            if (error)
+               LOG_ERROR(error);
+         }
+#endif
+
+         // add to the list of children
+         children.push_back(child);
+      }
+      END_LOCK_MUTEX
+
+      // success
+      return Success();
+   }
+
+   // waits up to the given time for children to have output or exit,
+   // noting which have; returns false if events can't be waited for
+   bool waitForEvents(int timeoutMs, boost::recursive_mutex* pMutex)
+   {
+#ifdef __linux__
+      if (epollFd == -1)
+         return false;
+
+      const int kMaxEvents = 64;
+      struct epoll_event events[kMaxEvents];
+      for (;;)
+      {
+         int count = ::epoll_wait(epollFd, events, kMaxEvents, timeoutMs);
+         if (count == -1)
+         {
+            if (errno != EINTR)
+               LOG_ERROR(systemError(errno, ERROR_LOCATION));
+            return true;
+         }
+
+         RECURSIVE_LOCK_MUTEX(*pMutex)
+         {
+            for (int i = 0; i < count; i++)
+            {
+               std::uint64_t id = AsyncChildProcess::eventId(events[i].data.u64);
+               for (const SupervisedChild& child : children)
+               {
+                  if (child.id == id)
+                  {
+                     child.pProcess->onEvent(events[i].data.u64);
+                     break;
+                  }
+               }
+            }
+         }
+         END_LOCK_MUTEX
+
+         // collect any further events without waiting
+         if (count < kMaxEvents)
+            return true;
+         timeoutMs = 0;
+      }
+#else
+      return false;
+#endif
+   }
+
+   bool isPolling;
+   std::vector<SupervisedChild> children;
+   std::uint64_t nextId;
+   int epollFd;
+};
+
+ProcessSupervisor::ProcessSupervisor()
+   : pImpl_(new Impl())
+{
 }
 
-} // anonymous namespace
+ProcessSupervisor::~ProcessSupervisor()
+{
+}
 
 Error ProcessSupervisor::runProgram(const std::string& executable,
                                     const std::vector<std::string>& args,
@@ -134,7 +275,7 @@ Error ProcessSupervisor::runProgram(const std::string& executable,
                                                        options));
 
    // run the child
-   return runChild(pChild, &(pImpl_->children), &mutex_, callbacks);
+   return pImpl_->runChild(pChild, &mutex_, callbacks);
 }
 
 Error ProcessSupervisor::runCommand(const std::string& command,
@@ -146,7 +287,7 @@ Error ProcessSupervisor::runCommand(const std::string& command,
                                  new AsyncChildProcess(command, options));
 
    // run the child
-   return runChild(pChild, &(pImpl_->children), &mutex_, callbacks);
+   return pImpl_->runChild(pChild, &mutex_, callbacks);
 }
 
 Error ProcessSupervisor::runTerminal(const ProcessOptions& options,
@@ -157,7 +298,7 @@ Error ProcessSupervisor::runTerminal(const ProcessOptions& options,
                                  new AsyncChildProcess(options));
 
    // run the child
-   return runChild(pChild, &(pImpl_->children), &mutex_, callbacks);
+   return pImpl_->runChild(pChild, &mutex_, callbacks);
 }
 
 namespace {
@@ -307,12 +448,17 @@ bool ProcessSupervisor::hasRunningChildren()
 
 namespace {
 
-bool hasActivity(const boost::shared_ptr<AsyncChildProcess>& childProc)
+bool hasActivity(const SupervisedChild& child)
 {
    return
-         childProc->hasNonIgnoredSubprocess() ||
-         childProc->hasIgnoredSubprocess() ||
-         childProc->hasRecentOutput();
+         child.pProcess->hasNonIgnoredSubprocess() ||
+         child.pProcess->hasIgnoredSubprocess() ||
+         child.pProcess->hasRecentOutput();
+}
+
+bool hasExited(const SupervisedChild& child)
+{
+   return child.pProcess->exited();
 }
 
 } // anonymous namespace
@@ -340,6 +486,9 @@ bool ProcessSupervisor::poll()
       pImpl_->isPolling = true;
       scope::SetOnExit<bool> setOnExit(&pImpl_->isPolling, false);
 
+      // note which children have output or have exited
+      pImpl_->waitForEvents(0, &mutex_);
+
       // call poll on all of our children via a copy of the std::vector that
       // holds all of the children. we do this because 'poll' can end up
       // executing R code (e.g. via onContinue) which can in term end up
@@ -347,10 +496,9 @@ bool ProcessSupervisor::poll()
       // runProgram or runCommand. This would then result in a push_back on
       // the children vector and if this required a realloc would invalidate
       // all of the iterators currently pointing into the container
-      std::vector<boost::shared_ptr<AsyncChildProcess> > children = pImpl_->children;
-      std::for_each(children.begin(),
-                    children.end(),
-                    boost::bind(&AsyncChildProcess::poll, _1));
+      std::vector<SupervisedChild> children = pImpl_->children;
+      for (const SupervisedChild& child : children)
+         child.pProcess->poll();
 
       // remove any children who have exited from our list. note that it's safe
       // in this case to use pImpl_->children directly because the call to
@@ -359,7 +507,7 @@ bool ProcessSupervisor::poll()
       pImpl_->children.erase(std::remove_if(
                                 pImpl_->children.begin(),
                                 pImpl_->children.end(),
-                                boost::bind(&AsyncChildProcess::exited, _1)),
+                                hasExited),
                              pImpl_->children.end());
 
       // return status
@@ -369,12 +517,34 @@ bool ProcessSupervisor::poll()
    return false;
 }
 
+std::vector<ProcessIoStats> ProcessSupervisor::ioStats()
+{
+   std::vector<ProcessIoStats> stats;
+   boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+
+   RECURSIVE_LOCK_MUTEX(mutex_)
+   {
+      for (const SupervisedChild& child : pImpl_->children)
+      {
+         ProcessIoStats childStats;
+         childStats.pid = child.pProcess->getPid();
+         childStats.stdoutBytes = child.pCounts->stdoutBytes;
+         childStats.stderrBytes = child.pCounts->stderrBytes;
+         childStats.elapsed = now - child.pCounts->started;
+         stats.push_back(childStats);
+      }
+   }
+   END_LOCK_MUTEX
+
+   return stats;
+}
+
 void ProcessSupervisor::terminateAll()
 {
    // call terminate on all of our children
-   for (boost::shared_ptr<AsyncChildProcess> pChild : pImpl_->children)
+   for (const SupervisedChild& child : pImpl_->children)
    {
-      Error error = pChild->terminate();
+      Error error = child.pProcess->terminate();
       if (error)
          LOG_ERROR(error);
    }
@@ -390,8 +560,13 @@ bool ProcessSupervisor::wait(
 
    while (poll())
    {
-      // wait the specified polling interval
-      boost::this_thread::sleep(pollingInterval);
+      // wait the specified polling interval, or until a child has output or
+      // exits if we can watch for that
+      if (!pImpl_->waitForEvents(static_cast<int>(pollingInterval.total_milliseconds()),
+                                 &mutex_))
+      {
+         boost::this_thread::sleep(pollingInterval);
+      }
 
       // check for timeout if appropriate
       if (!timeoutTime.is_not_a_date_time())
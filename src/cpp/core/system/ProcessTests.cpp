@@ -592,6 +592,94 @@ test_context("ProcessTests")
       // We also sometimes see exitCode of 1 for generic exits so we allow either one.
       REQUIRE((exitCode == 1 || exitCode == 143));
    }
+
+   test_that("ProcessSupervisor returns output from many children")
+   {
+      ProcessSupervisor supervisor;
+
+      const int kChildren = 20;
+      std::vector<std::string> outputs(kChildren);
+      std::vector<int> exitCodes(kChildren, -1);
+
+      for (int i = 0; i < kChildren; ++i)
+      {
+         ProcessCallbacks callbacks;
+         callbacks.onStdout = boost::bind(appendOutput, _2, &outputs[i]);
+         callbacks.onExit = boost::bind(checkExitCode, _1, &exitCodes[i]);
+
+         std::string command = "for i in 1 2 3; do echo " + safe_convert::numberToString(i) +
+                               "; sleep 0.05; done";
+         Error error = supervisor.runCommand(command, ProcessOptions(), callbacks);
+         REQUIRE(!error);
+      }
+
+      REQUIRE(supervisor.wait(boost::posix_time::milliseconds(10),
+                              boost::posix_time::seconds(10)));
+
+      for (int i = 0; i < kChildren; ++i)
+      {
+         std::string line = safe_convert::numberToString(i) + "\n";
+         CHECK(outputs[i] == line + line + line);
+         CHECK(exitCodes[i] == 0);
+      }
+
+      CHECK(supervisor.ioStats().empty());
+   }
+
+   test_that("ProcessSupervisor reports output read from each child")
+   {
+      ProcessSupervisor supervisor;
+
+      std::string output;
+      ProcessCallbacks callbacks;
+      callbacks.onStdout = boost::bind(appendOutput, _2, &output);
+
+      Error error = supervisor.runCommand("printf 'hello'; sleep 1", ProcessOptions(), callbacks);
+      REQUIRE(!error);
+
+      boost::posix_time::ptime timeout =
+            boost::posix_time::microsec_clock::universal_time() + boost::posix_time::seconds(5);
+      while (output.empty() && boost::posix_time::microsec_clock::universal_time() < timeout)
+      {
+         supervisor.poll();
+         boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+      }
+      REQUIRE(output == "hello");
+
+      std::vector<ProcessIoStats> stats = supervisor.ioStats();
+      REQUIRE(stats.size() == 1);
+      CHECK(stats[0].stdoutBytes == 5);
+      CHECK(stats[0].stderrBytes == 0);
+      CHECK(stats[0].pid > 0);
+
+      supervisor.terminateAll();
+      CHECK(supervisor.wait(boost::posix_time::milliseconds(10),
+                            boost::posix_time::seconds(10)));
+   }
+
+#ifdef __linux__
+   test_that("ProcessSupervisor wait returns as soon as children exit")
+   {
+      ProcessSupervisor supervisor;
+
+      int exitCode = -1;
+      ProcessCallbacks callbacks;
+      callbacks.onExit = boost::bind(checkExitCode, _1, &exitCode);
+
+      Error error = supervisor.runCommand("sleep 0.1", ProcessOptions(), callbacks);
+      REQUIRE(!error);
+
+      // with a long polling interval, only the child's exit can end the wait early
+      boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+      REQUIRE(supervisor.wait(boost::posix_time::seconds(5),
+                              boost::posix_time::seconds(20)));
+      boost::posix_time::time_duration elapsed =
+            boost::posix_time::microsec_clock::universal_time() - start;
+
+      CHECK(exitCode == 0);
+      CHECK(elapsed < boost::posix_time::seconds(2));
+   }
+#endif
 }
 
 } // end namespace tests
@@ -373,6 +373,207 @@ Error discoverAndProcessFileChanges(
    return Success();
 }
 
+Error processFileAdded(
+              FileTree::NodeId parent,
+              const FileChangeEvent& fileChange,
+              bool recursive,
+              const boost::function<bool(const FileInfo&)>& filter,
+              const boost::function<Error(const FileInfo&)>& onBeforeScanDir,
+              FileTree* pTree,
+              std::vector<FileChangeEvent>* pFileChanges)
+{
+   // if the file already exists then check it for changes (see above)
+   const FileInfo& fileInfo = fileChange.fileInfo();
+   FileTree::NodeId node = pTree->findChild(
+                           parent,
+                           FilePath(fileInfo.absolutePath()).getFilename());
+   if (node != FileTree::kNoNode)
+   {
+      if (fileInfo != pTree->fileInfo(node))
+      {
+         pTree->update(node, fileInfo);
+         pFileChanges->push_back(FileChangeEvent(FileChangeEvent::FileModified,
+                                                 fileInfo));
+      }
+      return Success();
+   }
+
+   if (recursive && shouldTraverse(fileInfo))
+   {
+      tree<FileInfo> subTree;
+      FileScannerOptions options;
+      options.recursive = true;
+      options.yield = true;
+      options.filter = filter;
+      options.onBeforeScanDir = onBeforeScanDir;
+      Error error = scanFiles(fileInfo, options, &subTree);
+      if (error)
+         return error;
+
+      // merge in the sub-tree and generate events
+      std::vector<FileInfo> added;
+      pTree->add(parent, subTree.begin(), &added);
+      for (const FileInfo& addedInfo : added)
+         addEvent(FileChangeEvent::FileAdded, addedInfo, pFileChanges);
+   }
+   else
+   {
+      pTree->add(parent, fileInfo);
+      pFileChanges->push_back(fileChange);
+   }
+
+   return Success();
+}
+
+void processFileModified(FileTree::NodeId parent,
+                         const FileChangeEvent& fileChange,
+                         FileTree* pTree,
+                         std::vector<FileChangeEvent>* pFileChanges)
+{
+   const FileInfo& fileInfo = fileChange.fileInfo();
+   FileTree::NodeId node = pTree->findChild(
+                           parent,
+                           FilePath(fileInfo.absolutePath()).getFilename());
+
+   if (node != FileTree::kNoNode &&
+       !sizeAndLastWriteTimeAreEqual(fileInfo, pTree->fileInfo(node)))
+   {
+      pTree->update(node, fileInfo);
+      pFileChanges->push_back(fileChange);
+   }
+}
+
+void processFileRemoved(FileTree::NodeId parent,
+                        const FileChangeEvent& fileChange,
+                        bool recursive,
+                        FileTree* pTree,
+                        std::vector<FileChangeEvent>* pFileChanges,
+                        std::vector<int>* pRemovedWatches)
+{
+   FileTree::NodeId node = pTree->findChild(
+            parent,
+            FilePath(fileChange.fileInfo().absolutePath()).getFilename());
+   if (node == FileTree::kNoNode)
+      return;
+
+   // generate events for everything removed when this is a folder (using
+   // the previous FileInfo for the payload, as above)
+   std::vector<FileInfo> removed;
+   if (recursive && shouldTraverse(pTree->fileInfo(node)))
+   {
+      pTree->remove(node, &removed, pRemovedWatches);
+   }
+   else
+   {
+      removed.push_back(pTree->fileInfo(node));
+      pTree->remove(node, nullptr, pRemovedWatches);
+   }
+
+   for (const FileInfo& removedInfo : removed)
+      addEvent(FileChangeEvent::FileRemoved, removedInfo, pFileChanges);
+}
+
+Error discoverAndProcessFileChanges(
+   FileTree::NodeId node,
+   bool recursive,
+   const boost::function<bool(const FileInfo&)>& filter,
+   const boost::function<Error(const FileInfo&)>& onBeforeScanDir,
+   FileTree* pTree,
+   const boost::function<void(const std::vector<FileChangeEvent>&)>&
+                                                            onFilesChanged,
+   std::vector<int>* pRemovedWatches)
+{
+   if (node == FileTree::kNoNode)
+      return Success();
+
+   // scan this directory into a new tree which we can compare to the old tree
+   FileInfo fileInfo = pTree->fileInfo(node);
+   tree<FileInfo> subdirTree;
+   FileScannerOptions options;
+   options.recursive = recursive;
+   options.yield = true;
+   options.filter = filter;
+   options.onBeforeScanDir = onBeforeScanDir;
+   Error error = scanFiles(fileInfo, options, &subdirTree);
+   if (error)
+      return error;
+
+   if (recursive)
+   {
+      // check for changes on full subtree
+      std::vector<FileInfo> existing = pTree->contents(node, true);
+      existing.push_back(fileInfo);
+      std::vector<FileChangeEvent> fileChanges;
+      collectFileChangeEvents(existing.begin(),
+                              existing.end(),
+                              subdirTree.begin(),
+                              subdirTree.end(),
+                              &fileChanges);
+
+      // fire events
+      onFilesChanged(fileChanges);
+
+      // wholesale replace subtree
+      pTree->replaceContents(node, subdirTree.begin(), pRemovedWatches);
+   }
+   else
+   {
+      // scan for changes on just the children
+      std::vector<FileInfo> existing = pTree->contents(node, false);
+      std::vector<FileChangeEvent> childrenFileChanges;
+      collectFileChangeEvents(existing.begin(),
+                              existing.end(),
+                              subdirTree.begin(subdirTree.begin()),
+                              subdirTree.end(subdirTree.begin()),
+                              &childrenFileChanges);
+
+      // build up actual file changes and mutate the tree as appropriate
+      std::vector<FileChangeEvent> fileChanges;
+      for (const FileChangeEvent& fileChange : childrenFileChanges)
+      {
+         switch(fileChange.type())
+         {
+         case FileChangeEvent::FileAdded:
+         {
+            Error error = processFileAdded(node,
+                                           fileChange,
+                                           recursive,
+                                           filter,
+                                           onBeforeScanDir,
+                                           pTree,
+                                           &fileChanges);
+            if (error)
+               LOG_ERROR(error);
+            break;
+         }
+         case FileChangeEvent::FileModified:
+         {
+            processFileModified(node, fileChange, pTree, &fileChanges);
+            break;
+         }
+         case FileChangeEvent::FileRemoved:
+         {
+            processFileRemoved(node,
+                               fileChange,
+                               recursive,
+                               pTree,
+                               &fileChanges,
+                               pRemovedWatches);
+            break;
+         }
+         case FileChangeEvent::None:
+         default:
+            break;
+         }
+      }
+
+      // fire events
+      onFilesChanged(fileChanges);
+   }
+
+   return Success();
+}
+
 std::list<void*> activeEventContexts()
 {
    std::list<void*> contexts;
@@ -29,6 +29,8 @@
 
 #include <core/system/FileMonitor.hpp>
 
+#include "FileTree.hpp"
+
 using namespace boost::placeholders;
 
 namespace rstudio {
@@ -100,6 +102,41 @@ inline Error discoverAndProcessFileChanges(
                                  onFilesChanged);
 }
 
+// variants of the above for monitors which keep a FileTree; the parent is
+// found by the caller (e.g. from the watch that reported the change) and
+// the file within it by name, so none of these search the tree. the
+// watches attached to removed directories are returned in pRemovedWatches
+Error processFileAdded(
+               FileTree::NodeId parent,
+               const FileChangeEvent& fileChange,
+               bool recursive,
+               const boost::function<bool(const FileInfo&)>& filter,
+               const boost::function<Error(const FileInfo&)>& onBeforeScanDir,
+               FileTree* pTree,
+               std::vector<FileChangeEvent>* pFileChanges);
+
+void processFileModified(FileTree::NodeId parent,
+                         const FileChangeEvent& fileChange,
+                         FileTree* pTree,
+                         std::vector<FileChangeEvent>* pFileChanges);
+
+void processFileRemoved(FileTree::NodeId parent,
+                        const FileChangeEvent& fileChange,
+                        bool recursive,
+                        FileTree* pTree,
+                        std::vector<FileChangeEvent>* pFileChanges,
+                        std::vector<int>* pRemovedWatches);
+
+Error discoverAndProcessFileChanges(
+   FileTree::NodeId node,
+   bool recursive,
+   const boost::function<bool(const FileInfo&)>& filter,
+   const boost::function<Error(const FileInfo&)>& onBeforeScanDir,
+   FileTree* pTree,
+   const boost::function<void(const std::vector<FileChangeEvent>&)>&
+                                                            onFilesChanged,
+   std::vector<int>* pRemovedWatches);
+
 template <typename Iterator>
 Iterator findFile(Iterator begin, Iterator end, const std::string& path)
 {
@@ -0,0 +1,455 @@
+/*
+ * FileTree.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "FileTree.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+namespace rstudio {
+namespace core {
+namespace system {
+namespace file_monitor {
+
+const FileTree::NodeId FileTree::kNoNode = std::numeric_limits<uint32_t>::max();
+const FileTree::NameId FileTree::kNoName = std::numeric_limits<uint32_t>::max();
+const int FileTree::kNoWatch;
+
+namespace {
+
+std::string fileName(const std::string& absolutePath)
+{
+   std::string::size_type pos = absolutePath.find_last_of('/');
+   if (pos == std::string::npos)
+      return absolutePath;
+   else
+      return absolutePath.substr(pos + 1);
+}
+
+} // anonymous namespace
+
+FileTree::FileTree()
+   : root_(kNoNode)
+{
+}
+
+void FileTree::assign(const tree<FileInfo>& fileTree)
+{
+   clear();
+
+   if (fileTree.empty())
+      return;
+
+   tree<FileInfo>::iterator rootIt = fileTree.begin();
+   root_ = allocateNode(kNoNode, internName(rootIt->absolutePath()), *rootIt);
+   for (tree<FileInfo>::sibling_iterator it = rootIt.begin();
+        it != rootIt.end();
+        ++it)
+   {
+      add(root_, it);
+   }
+}
+
+void FileTree::clear()
+{
+   root_ = kNoNode;
+   nodes_.clear();
+   freeNodes_.clear();
+   children_.clear();
+   watches_.clear();
+   names_.clear();
+   freeNames_.clear();
+   nameIds_.clear();
+}
+
+FileTree::NodeId FileTree::find(const std::string& absolutePath) const
+{
+   if (empty())
+      return kNoNode;
+
+   const std::string& rootPath = name(root_);
+   if (absolutePath == rootPath)
+      return root_;
+
+   // the remainder of the path must be relative to the root
+   std::string::size_type pos = rootPath.size();
+   if (!boost::algorithm::ends_with(rootPath, "/"))
+   {
+      if (absolutePath.size() <= pos || absolutePath[pos] != '/')
+         return kNoNode;
+      pos++;
+   }
+   if (!boost::algorithm::starts_with(absolutePath, rootPath))
+      return kNoNode;
+
+   NodeId node = root_;
+   while (node != kNoNode && pos < absolutePath.size())
+   {
+      std::string::size_type end = absolutePath.find('/', pos);
+      if (end == std::string::npos)
+         end = absolutePath.size();
+
+      node = findChild(node, absolutePath.substr(pos, end - pos));
+      pos = end + 1;
+   }
+
+   return node;
+}
+
+FileTree::NodeId FileTree::findChild(NodeId parent, const std::string& name) const
+{
+   NameId nameId = findName(name);
+   if (nameId == kNoName)
+      return kNoNode;
+
+   std::unordered_map<uint64_t, NodeId>::const_iterator it =
+                                       children_.find(childKey(parent, nameId));
+   return it != children_.end() ? it->second : kNoNode;
+}
+
+FileTree::NodeId FileTree::findWatch(int watch) const
+{
+   std::unordered_map<int, NodeId>::const_iterator it = watches_.find(watch);
+   return it != watches_.end() ? it->second : kNoNode;
+}
+
+const std::string& FileTree::name(NodeId node) const
+{
+   return *names_[nodes_[node].name].pName;
+}
+
+std::string FileTree::absolutePath(NodeId node) const
+{
+   // gather the names from the file up to the root
+   std::vector<const std::string*> names;
+   std::size_t length = 0;
+   for (NodeId id = node; id != kNoNode; id = nodes_[id].parent)
+   {
+      names.push_back(&name(id));
+      length += names.back()->size() + 1;
+   }
+
+   std::string path;
+   path.reserve(length);
+   for (std::vector<const std::string*>::reverse_iterator it = names.rbegin();
+        it != names.rend();
+        ++it)
+   {
+      if (!path.empty() && path[path.size() - 1] != '/')
+         path.push_back('/');
+      path.append(**it);
+   }
+   return path;
+}
+
+FileInfo FileTree::fileInfo(NodeId node) const
+{
+   const Node& fileNode = nodes_[node];
+   return FileInfo(absolutePath(node),
+                   fileNode.isDirectory,
+                   fileNode.size,
+                   fileNode.lastWriteTime,
+                   fileNode.isSymlink);
+}
+
+std::vector<FileInfo> FileTree::contents(NodeId node, bool recursive) const
+{
+   std::vector<NodeId> nodes;
+   collect(node, recursive, &nodes);
+
+   std::vector<FileInfo> files;
+   files.reserve(nodes.size());
+   for (NodeId id : nodes)
+      files.push_back(fileInfo(id));
+   return files;
+}
+
+void FileTree::setWatch(NodeId node, int watch)
+{
+   // detach the directory's current watch
+   int previous = nodes_[node].watch;
+   if (previous != kNoWatch)
+   {
+      watches_.erase(previous);
+      nodes_[node].watch = kNoWatch;
+   }
+
+   if (watch == kNoWatch)
+      return;
+
+   // detach the watch from any other directory
+   std::unordered_map<int, NodeId>::iterator it = watches_.find(watch);
+   if (it != watches_.end())
+   {
+      nodes_[it->second].watch = kNoWatch;
+      it->second = node;
+   }
+   else
+   {
+      watches_[watch] = node;
+   }
+
+   nodes_[node].watch = watch;
+}
+
+std::vector<int> FileTree::watches() const
+{
+   std::vector<int> watches;
+   watches.reserve(watches_.size());
+   for (const auto& watch : watches_)
+      watches.push_back(watch.first);
+   return watches;
+}
+
+void FileTree::clearWatches()
+{
+   for (const auto& watch : watches_)
+      nodes_[watch.second].watch = kNoWatch;
+   watches_.clear();
+}
+
+FileTree::NodeId FileTree::add(NodeId parent, const FileInfo& fileInfo)
+{
+   std::string name = fileName(fileInfo.absolutePath());
+
+   NodeId node = findChild(parent, name);
+   if (node != kNoNode)
+   {
+      update(node, fileInfo);
+      return node;
+   }
+
+   return allocateNode(parent, internName(name), fileInfo);
+}
+
+FileTree::NodeId FileTree::add(NodeId parent,
+                               const tree<FileInfo>::iterator_base& fromNode,
+                               std::vector<FileInfo>* pAdded)
+{
+   NodeId node = add(parent, *fromNode);
+   if (pAdded)
+      pAdded->push_back(*fromNode);
+
+   for (tree<FileInfo>::sibling_iterator it = fromNode.begin();
+        it != fromNode.end();
+        ++it)
+   {
+      add(node, it, pAdded);
+   }
+
+   return node;
+}
+
+void FileTree::replaceContents(NodeId node,
+                               const tree<FileInfo>::iterator_base& fromNode,
+                               std::vector<int>* pRemovedWatches)
+{
+   removeContents(node, pRemovedWatches);
+   update(node, *fromNode);
+
+   for (tree<FileInfo>::sibling_iterator it = fromNode.begin();
+        it != fromNode.end();
+        ++it)
+   {
+      add(node, it);
+   }
+}
+
+void FileTree::update(NodeId node, const FileInfo& fileInfo)
+{
+   Node& fileNode = nodes_[node];
+   fileNode.size = fileInfo.size();
+   fileNode.lastWriteTime = fileInfo.lastWriteTime();
+   fileNode.isDirectory = fileInfo.isDirectory();
+   fileNode.isSymlink = fileInfo.isSymlink();
+}
+
+void FileTree::remove(NodeId node,
+                      std::vector<FileInfo>* pRemoved,
+                      std::vector<int>* pRemovedWatches)
+{
+   std::vector<NodeId> nodes;
+   nodes.push_back(node);
+   collect(node, true, &nodes);
+
+   if (pRemoved)
+   {
+      for (NodeId id : nodes)
+         pRemoved->push_back(fileInfo(id));
+   }
+
+   if (node == root_)
+   {
+      if (pRemovedWatches)
+      {
+         std::vector<int> watches = this->watches();
+         pRemovedWatches->insert(pRemovedWatches->end(),
+                                 watches.begin(),
+                                 watches.end());
+      }
+      clear();
+      return;
+   }
+
+   unlinkNode(node);
+   for (NodeId id : nodes)
+   {
+      if (pRemovedWatches && nodes_[id].watch != kNoWatch)
+         pRemovedWatches->push_back(nodes_[id].watch);
+      freeNode(id);
+   }
+}
+
+FileTree::NameId FileTree::findName(const std::string& name) const
+{
+   std::unordered_map<std::string, NameId>::const_iterator it =
+                                                         nameIds_.find(name);
+   return it != nameIds_.end() ? it->second : kNoName;
+}
+
+FileTree::NameId FileTree::internName(const std::string& name)
+{
+   std::unordered_map<std::string, NameId>::iterator it = nameIds_.find(name);
+   if (it != nameIds_.end())
+   {
+      names_[it->second].refs++;
+      return it->second;
+   }
+
+   NameId nameId;
+   if (!freeNames_.empty())
+   {
+      nameId = freeNames_.back();
+      freeNames_.pop_back();
+   }
+   else
+   {
+      nameId = static_cast<NameId>(names_.size());
+      names_.push_back(Name());
+   }
+
+   it = nameIds_.insert(std::make_pair(name, nameId)).first;
+   names_[nameId].pName = &it->first;
+   names_[nameId].refs = 1;
+   return nameId;
+}
+
+void FileTree::releaseName(NameId name)
+{
+   if (--names_[name].refs > 0)
+      return;
+
+   nameIds_.erase(*names_[name].pName);
+   names_[name].pName = nullptr;
+   freeNames_.push_back(name);
+}
+
+FileTree::NodeId FileTree::allocateNode(NodeId parent,
+                                        NameId name,
+                                        const FileInfo& fileInfo)
+{
+   NodeId node;
+   if (!freeNodes_.empty())
+   {
+      node = freeNodes_.back();
+      freeNodes_.pop_back();
+   }
+   else
+   {
+      node = static_cast<NodeId>(nodes_.size());
+      nodes_.push_back(Node());
+   }
+
+   Node& fileNode = nodes_[node];
+   fileNode.parent = parent;
+   fileNode.firstChild = kNoNode;
+   fileNode.nextSibling = kNoNode;
+   fileNode.prevSibling = kNoNode;
+   fileNode.name = name;
+   fileNode.watch = kNoWatch;
+   update(node, fileInfo);
+
+   // link as the first child of the parent
+   if (parent != kNoNode)
+   {
+      NodeId next = nodes_[parent].firstChild;
+      fileNode.nextSibling = next;
+      if (next != kNoNode)
+         nodes_[next].prevSibling = node;
+      nodes_[parent].firstChild = node;
+
+      children_[childKey(parent, name)] = node;
+   }
+
+   return node;
+}
+
+void FileTree::unlinkNode(NodeId node)
+{
+   Node& fileNode = nodes_[node];
+   if (fileNode.prevSibling != kNoNode)
+      nodes_[fileNode.prevSibling].nextSibling = fileNode.nextSibling;
+   else if (fileNode.parent != kNoNode)
+      nodes_[fileNode.parent].firstChild = fileNode.nextSibling;
+
+   if (fileNode.nextSibling != kNoNode)
+      nodes_[fileNode.nextSibling].prevSibling = fileNode.prevSibling;
+
+   fileNode.prevSibling = kNoNode;
+   fileNode.nextSibling = kNoNode;
+}
+
+void FileTree::freeNode(NodeId node)
+{
+   Node& fileNode = nodes_[node];
+   if (fileNode.parent != kNoNode)
+      children_.erase(childKey(fileNode.parent, fileNode.name));
+   if (fileNode.watch != kNoWatch)
+      watches_.erase(fileNode.watch);
+
+   releaseName(fileNode.name);
+   fileNode.name = kNoName;
+   fileNode.parent = kNoNode;
+   fileNode.firstChild = kNoNode;
+   fileNode.watch = kNoWatch;
+   freeNodes_.push_back(node);
+}
+
+void FileTree::collect(NodeId node,
+                       bool recursive,
+                       std::vector<NodeId>* pNodes) const
+{
+   for (NodeId child = nodes_[node].firstChild;
+        child != kNoNode;
+        child = nodes_[child].nextSibling)
+   {
+      pNodes->push_back(child);
+      if (recursive)
+         collect(child, true, pNodes);
+   }
+}
+
+void FileTree::removeContents(NodeId node, std::vector<int>* pRemovedWatches)
+{
+   while (nodes_[node].firstChild != kNoNode)
+      remove(nodes_[node].firstChild, nullptr, pRemovedWatches);
+}
+
+} // namespace file_monitor
+} // namespace system
+} // namespace core
+} // namespace rstudio
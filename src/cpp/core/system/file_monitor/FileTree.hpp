@@ -0,0 +1,184 @@
+/*
+ * FileTree.hpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef CORE_SYSTEM_FILE_MONITOR_FILE_TREE_HPP
+#define CORE_SYSTEM_FILE_MONITOR_FILE_TREE_HPP
+
+#include <stdint.h>
+
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <core/FileInfo.hpp>
+#include <core/collection/Tree.hpp>
+
+namespace rstudio {
+namespace core {
+namespace system {
+namespace file_monitor {
+
+// A compact tree of the files beneath a monitored directory. Rather than a
+// FileInfo (with its full path) per file, each node holds an interned name
+// and a link to its parent, and paths are rebuilt only when a FileInfo is
+// needed. The children of a directory are found by name, and directories
+// by the watch (e.g. inotify watch descriptor) attached to them, in
+// constant time, so handling a file system event doesn't depend on the
+// number of files being monitored.
+class FileTree : boost::noncopyable
+{
+public:
+   typedef uint32_t NodeId;
+   static const NodeId kNoNode;
+
+   static const int kNoWatch = -1;
+
+   FileTree();
+
+   // replaces the contents of this tree with the given tree (as produced by
+   // scanFiles); watches are not preserved
+   void assign(const tree<FileInfo>& fileTree);
+
+   void clear();
+
+   bool empty() const { return root_ == kNoNode; }
+
+   // the number of files in the tree (including the root)
+   std::size_t size() const { return nodes_.size() - freeNodes_.size(); }
+
+   // the number of distinct file names in the tree
+   std::size_t nameCount() const { return nameIds_.size(); }
+
+   NodeId root() const { return root_; }
+
+   // finds the node with the given absolute path (by looking up each of its
+   // components), or returns kNoNode
+   NodeId find(const std::string& absolutePath) const;
+
+   // finds the child of a directory with the given name, or returns kNoNode
+   NodeId findChild(NodeId parent, const std::string& name) const;
+
+   // finds the directory the given watch is attached to, or returns kNoNode
+   NodeId findWatch(int watch) const;
+
+   NodeId parent(NodeId node) const { return nodes_[node].parent; }
+   const std::string& name(NodeId node) const;
+   std::string absolutePath(NodeId node) const;
+   bool isDirectory(NodeId node) const { return nodes_[node].isDirectory; }
+   FileInfo fileInfo(NodeId node) const;
+
+   // returns the files beneath a directory (excluding the directory itself),
+   // either all of them or just its children
+   std::vector<FileInfo> contents(NodeId node, bool recursive) const;
+
+   // attaches a watch to a directory (any watch previously attached to the
+   // directory, or any directory the watch was attached to, is detached)
+   void setWatch(NodeId node, int watch);
+   int watch(NodeId node) const { return nodes_[node].watch; }
+
+   // returns all of the attached watches
+   std::vector<int> watches() const;
+
+   // detaches all watches (the caller is responsible for removing them)
+   void clearWatches();
+
+   // adds a file to a directory, or updates it if it already exists; the
+   // name of the file is the last component of its path
+   NodeId add(NodeId parent, const FileInfo& fileInfo);
+
+   // adds a file to a directory along with everything beneath it in the
+   // given tree (as produced by scanFiles), returning the added files in
+   // pre-order
+   NodeId add(NodeId parent,
+              const tree<FileInfo>::iterator_base& fromNode,
+              std::vector<FileInfo>* pAdded = nullptr);
+
+   // replaces the contents of a directory with everything beneath the given
+   // node (as produced by scanFiles); the directory's watch is preserved
+   // but those beneath it are detached and returned in pRemovedWatches
+   void replaceContents(NodeId node,
+                        const tree<FileInfo>::iterator_base& fromNode,
+                        std::vector<int>* pRemovedWatches);
+
+   // updates the attributes of a file (its path is left unchanged)
+   void update(NodeId node, const FileInfo& fileInfo);
+
+   // removes a file along with everything beneath it, returning the removed
+   // files in pre-order and the watches that were attached to them
+   void remove(NodeId node,
+               std::vector<FileInfo>* pRemoved,
+               std::vector<int>* pRemovedWatches);
+
+private:
+   typedef uint32_t NameId;
+   static const NameId kNoName;
+
+   struct Node
+   {
+      NodeId parent;
+      NodeId firstChild;
+      NodeId nextSibling;
+      NodeId prevSibling;
+      NameId name;
+      int watch;
+      uintmax_t size;
+      std::time_t lastWriteTime;
+      bool isDirectory;
+      bool isSymlink;
+   };
+
+   struct Name
+   {
+      const std::string* pName;
+      uint32_t refs;
+   };
+
+   static uint64_t childKey(NodeId parent, NameId name)
+   {
+      return (static_cast<uint64_t>(parent) << 32) | name;
+   }
+
+   NameId findName(const std::string& name) const;
+   NameId internName(const std::string& name);
+   void releaseName(NameId name);
+
+   NodeId allocateNode(NodeId parent, NameId name, const FileInfo& fileInfo);
+   void unlinkNode(NodeId node);
+   void freeNode(NodeId node);
+
+   void collect(NodeId node, bool recursive, std::vector<NodeId>* pNodes) const;
+   void removeContents(NodeId node, std::vector<int>* pRemovedWatches);
+
+   NodeId root_;
+   std::vector<Node> nodes_;
+   std::vector<NodeId> freeNodes_;
+   std::unordered_map<uint64_t, NodeId> children_;
+   std::unordered_map<int, NodeId> watches_;
+
+   // interned names (pName points at the key in nameIds_, which is stable)
+   std::vector<Name> names_;
+   std::vector<NameId> freeNames_;
+   std::unordered_map<std::string, NameId> nameIds_;
+};
+
+} // namespace file_monitor
+} // namespace system
+} // namespace core
+} // namespace rstudio
+
+#endif // CORE_SYSTEM_FILE_MONITOR_FILE_TREE_HPP
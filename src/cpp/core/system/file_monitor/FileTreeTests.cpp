@@ -0,0 +1,417 @@
+/*
+ * FileTreeTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "FileTree.hpp"
+
+#include <algorithm>
+
+#include <boost/lexical_cast.hpp>
+
+#include <core/FileSerializer.hpp>
+#include <core/system/FileScanner.hpp>
+
+#include "FileMonitorImpl.hpp"
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace core {
+namespace system {
+namespace file_monitor {
+namespace tests {
+
+namespace {
+
+const char* const kRoot = "/project";
+const int kRootWatch = 1000000;
+
+std::string dirPath(int dir)
+{
+   return std::string(kRoot) + "/dir" + boost::lexical_cast<std::string>(dir);
+}
+
+std::string filePath(int dir, int file)
+{
+   return dirPath(dir) + "/file" + boost::lexical_cast<std::string>(file) + ".R";
+}
+
+// a project of directories, each holding the same file names
+void buildProject(int dirs, int files, tree<FileInfo>* pTree)
+{
+   tree<FileInfo>::iterator rootIt = pTree->set_head(FileInfo(kRoot, true));
+   for (int dir = 0; dir < dirs; dir++)
+   {
+      tree<FileInfo>::iterator dirIt =
+         pTree->append_child(rootIt, FileInfo(dirPath(dir), true, 4096, 1000));
+      for (int file = 0; file < files; file++)
+      {
+         pTree->append_child(dirIt,
+                             FileInfo(filePath(dir, file), false, file, 1000));
+      }
+   }
+}
+
+std::vector<std::string> paths(const std::vector<FileInfo>& files)
+{
+   std::vector<std::string> result;
+   for (const FileInfo& file : files)
+      result.push_back(file.absolutePath());
+   std::sort(result.begin(), result.end());
+   return result;
+}
+
+std::vector<std::string> paths(const std::vector<FileChangeEvent>& events)
+{
+   std::vector<std::string> result;
+   for (const FileChangeEvent& event : events)
+   {
+      result.push_back(boost::lexical_cast<std::string>(event.type()) + " " +
+                       event.fileInfo().absolutePath());
+   }
+   std::sort(result.begin(), result.end());
+   return result;
+}
+
+// the events written by a checkout that rewrites the given files: each is
+// unlinked, created again and then written
+std::vector<FileChangeEvent> checkoutEvents(int dirs, int files, int count)
+{
+   std::vector<FileChangeEvent> events;
+   for (int i = 0; i < count; i++)
+   {
+      int dir = (i * 7919) % dirs;
+      int file = (i * 104729) % files;
+      std::string path = filePath(dir, file);
+      events.push_back(FileChangeEvent(FileChangeEvent::FileRemoved,
+                                       FileInfo(path, false)));
+      events.push_back(FileChangeEvent(FileChangeEvent::FileAdded,
+                                       FileInfo(path, false, 0, 2000)));
+      events.push_back(FileChangeEvent(FileChangeEvent::FileModified,
+                                       FileInfo(path, false, file + 1, 2000)));
+   }
+   return events;
+}
+
+std::string parentPath(const FileChangeEvent& event)
+{
+   std::string path = event.fileInfo().absolutePath();
+   return path.substr(0, path.find_last_of('/'));
+}
+
+// applies events to a tree<FileInfo>, finding each parent by searching
+// the tree (as the monitor did)
+void replay(const std::vector<FileChangeEvent>& events,
+            tree<FileInfo>* pTree,
+            std::vector<FileChangeEvent>* pChanges)
+{
+   for (const FileChangeEvent& event : events)
+   {
+      tree<FileInfo>::iterator parentIt = impl::findFile(pTree->begin(),
+                                                         pTree->end(),
+                                                         parentPath(event));
+      if (parentIt == pTree->end())
+         continue;
+
+      switch (event.type())
+      {
+      case FileChangeEvent::FileAdded:
+         impl::processFileAdded(parentIt, event, true,
+                                boost::function<bool(const FileInfo&)>(),
+                                pTree, pChanges);
+         break;
+      case FileChangeEvent::FileModified:
+         impl::processFileModified(parentIt, event, pTree, pChanges);
+         break;
+      case FileChangeEvent::FileRemoved:
+         impl::processFileRemoved(parentIt, event, true, pTree, pChanges);
+         break;
+      default:
+         break;
+      }
+   }
+}
+
+// applies events to a FileTree, finding each parent by its watch (each
+// directory is watched by its index in the project, and the root by
+// kRootWatch)
+void replay(const std::vector<FileChangeEvent>& events,
+            FileTree* pTree,
+            std::vector<FileChangeEvent>* pChanges)
+{
+   std::vector<int> removedWatches;
+   for (const FileChangeEvent& event : events)
+   {
+      std::string parent = parentPath(event);
+      int wd = parent == kRoot
+         ? kRootWatch
+         : boost::lexical_cast<int>(parent.substr(parent.find_last_of('/') + 4));
+      FileTree::NodeId parentNode = pTree->findWatch(wd);
+      if (parentNode == FileTree::kNoNode)
+         continue;
+
+      switch (event.type())
+      {
+      case FileChangeEvent::FileAdded:
+         impl::processFileAdded(parentNode, event, true,
+                                boost::function<bool(const FileInfo&)>(),
+                                boost::function<Error(const FileInfo&)>(),
+                                pTree, pChanges);
+         break;
+      case FileChangeEvent::FileModified:
+         impl::processFileModified(parentNode, event, pTree, pChanges);
+         break;
+      case FileChangeEvent::FileRemoved:
+         impl::processFileRemoved(parentNode, event, true, pTree, pChanges,
+                                  &removedWatches);
+         break;
+      default:
+         break;
+      }
+   }
+}
+
+void watchDirectories(int dirs, FileTree* pTree)
+{
+   pTree->setWatch(pTree->root(), kRootWatch);
+   for (int dir = 0; dir < dirs; dir++)
+      pTree->setWatch(pTree->find(dirPath(dir)), dir);
+}
+
+} // anonymous namespace
+
+TEST_CASE("File monitor file tree")
+{
+   tree<FileInfo> project;
+   buildProject(10, 20, &project);
+
+   FileTree fileTree;
+   fileTree.assign(project);
+
+   SECTION("Holds every file once, with names shared between directories")
+   {
+      REQUIRE(fileTree.size() == 1 + 10 + 10 * 20);
+      REQUIRE(fileTree.nameCount() == 1 + 10 + 20);
+      REQUIRE(fileTree.absolutePath(fileTree.root()) == kRoot);
+
+      std::vector<FileInfo> expected(project.begin(), project.end());
+      std::vector<FileInfo> contents = fileTree.contents(fileTree.root(), true);
+      contents.push_back(fileTree.fileInfo(fileTree.root()));
+      REQUIRE(paths(contents) == paths(expected));
+   }
+
+   SECTION("Finds files by path and by name")
+   {
+      FileTree::NodeId node = fileTree.find(filePath(3, 7));
+      REQUIRE(node != FileTree::kNoNode);
+      REQUIRE(fileTree.fileInfo(node) == FileInfo(filePath(3, 7), false, 7, 1000));
+      REQUIRE(fileTree.parent(node) == fileTree.find(dirPath(3)));
+      REQUIRE(fileTree.findChild(fileTree.find(dirPath(3)), "file7.R") == node);
+
+      REQUIRE(fileTree.find(kRoot) == fileTree.root());
+      REQUIRE(fileTree.find(std::string(kRoot) + "/") == fileTree.root());
+      REQUIRE(fileTree.find("/projects/dir3") == FileTree::kNoNode);
+      REQUIRE(fileTree.find(dirPath(3) + "/missing.R") == FileTree::kNoNode);
+      REQUIRE(fileTree.find(filePath(3, 7) + "/below") == FileTree::kNoNode);
+      REQUIRE(fileTree.findChild(fileTree.root(), "file7.R") == FileTree::kNoNode);
+   }
+
+   SECTION("Attaches watches to directories")
+   {
+      watchDirectories(10, &fileTree);
+      REQUIRE(fileTree.findWatch(4) == fileTree.find(dirPath(4)));
+      REQUIRE(fileTree.findWatch(10) == FileTree::kNoNode);
+
+      // a watch can only be attached to one directory
+      fileTree.setWatch(fileTree.find(dirPath(5)), 4);
+      REQUIRE(fileTree.findWatch(4) == fileTree.find(dirPath(5)));
+      REQUIRE(fileTree.watch(fileTree.find(dirPath(4))) == FileTree::kNoWatch);
+      REQUIRE(fileTree.findWatch(5) == FileTree::kNoNode);
+      REQUIRE(fileTree.watches().size() == 10);
+
+      fileTree.clearWatches();
+      REQUIRE(fileTree.watches().empty());
+      REQUIRE(fileTree.findWatch(4) == FileTree::kNoNode);
+      REQUIRE(fileTree.watch(fileTree.find(dirPath(5))) == FileTree::kNoWatch);
+   }
+
+   SECTION("Removes directories with their contents and watches")
+   {
+      watchDirectories(10, &fileTree);
+
+      std::vector<FileInfo> removed;
+      std::vector<int> removedWatches;
+      fileTree.remove(fileTree.find(dirPath(2)), &removed, &removedWatches);
+
+      REQUIRE(removed.size() == 21);
+      REQUIRE(removed.front().absolutePath() == dirPath(2));
+      REQUIRE(removedWatches == std::vector<int>(1, 2));
+      REQUIRE(fileTree.size() == 1 + 9 + 9 * 20);
+      REQUIRE(fileTree.nameCount() == 1 + 9 + 20);
+      REQUIRE(fileTree.find(filePath(2, 0)) == FileTree::kNoNode);
+      REQUIRE(fileTree.findWatch(2) == FileTree::kNoNode);
+      REQUIRE(fileTree.find(filePath(3, 0)) != FileTree::kNoNode);
+
+      // nodes and names are reused when files are added again
+      FileTree::NodeId dir = fileTree.add(fileTree.root(),
+                                          FileInfo(dirPath(2), true));
+      fileTree.add(dir, FileInfo(filePath(2, 0), false));
+      REQUIRE(fileTree.size() == 1 + 10 + 9 * 20 + 1);
+      REQUIRE(fileTree.nameCount() == 1 + 10 + 20);
+      REQUIRE(fileTree.absolutePath(fileTree.find(filePath(2, 0))) == filePath(2, 0));
+   }
+
+   SECTION("Replaces the contents of a directory")
+   {
+      watchDirectories(10, &fileTree);
+
+      tree<FileInfo> scanned;
+      tree<FileInfo>::iterator dirIt = scanned.set_head(FileInfo(dirPath(6), true, 0, 3000));
+      scanned.append_child(dirIt, FileInfo(dirPath(6) + "/new.R", false));
+
+      std::vector<int> removedWatches;
+      fileTree.replaceContents(fileTree.find(dirPath(6)), dirIt, &removedWatches);
+      REQUIRE(removedWatches.empty());
+      REQUIRE(fileTree.findWatch(6) == fileTree.find(dirPath(6)));
+      REQUIRE(fileTree.fileInfo(fileTree.find(dirPath(6))).lastWriteTime() == 3000);
+      REQUIRE(paths(fileTree.contents(fileTree.find(dirPath(6)), true)) ==
+              std::vector<std::string>(1, dirPath(6) + "/new.R"));
+   }
+
+   SECTION("Generates the same events as a tree of FileInfo")
+   {
+      watchDirectories(10, &fileTree);
+
+      std::vector<FileChangeEvent> events = checkoutEvents(10, 20, 50);
+      events.push_back(FileChangeEvent(FileChangeEvent::FileRemoved,
+                                       FileInfo(dirPath(8), true)));
+      events.push_back(FileChangeEvent(FileChangeEvent::FileAdded,
+                                       FileInfo(dirPath(1) + "/added.R", false)));
+      events.push_back(FileChangeEvent(FileChangeEvent::FileAdded,
+                                       FileInfo(filePath(1, 1), false, 1, 1000)));
+      events.push_back(FileChangeEvent(FileChangeEvent::FileModified,
+                                       FileInfo(filePath(1, 2), false, 2, 1000)));
+
+      std::vector<FileChangeEvent> treeChanges;
+      replay(events, &project, &treeChanges);
+      std::vector<FileChangeEvent> fileTreeChanges;
+      replay(events, &fileTree, &fileTreeChanges);
+
+      REQUIRE(paths(fileTreeChanges) == paths(treeChanges));
+
+      std::vector<FileInfo> expected(project.begin(), project.end());
+      std::vector<FileInfo> contents = fileTree.contents(fileTree.root(), true);
+      contents.push_back(fileTree.fileInfo(fileTree.root()));
+      REQUIRE(paths(contents) == paths(expected));
+      REQUIRE(fileTree.fileInfo(fileTree.find(filePath(0, 0))) ==
+              FileInfo(filePath(0, 0), false, 1, 2000));
+   }
+}
+
+TEST_CASE("File monitor file tree rescans")
+{
+   FilePath root;
+   REQUIRE_FALSE(FilePath::tempFilePath(root));
+   REQUIRE_FALSE(root.ensureDirectory());
+   REQUIRE_FALSE(root.completeChildPath("a").ensureDirectory());
+   REQUIRE_FALSE(root.completeChildPath("b").ensureDirectory());
+   REQUIRE_FALSE(writeStringToFile(root.completeChildPath("a/one.R"), "1"));
+   REQUIRE_FALSE(writeStringToFile(root.completeChildPath("b/two.R"), "2"));
+
+   FileScannerOptions options;
+   options.recursive = true;
+   tree<FileInfo> scanned;
+   REQUIRE_FALSE(scanFiles(FileInfo(root), options, &scanned));
+
+   FileTree fileTree;
+   fileTree.assign(scanned);
+   fileTree.setWatch(fileTree.find(root.completeChildPath("b").getAbsolutePath()), 2);
+
+   // change the directory behind the tree's back
+   REQUIRE_FALSE(root.completeChildPath("b").remove());
+   REQUIRE_FALSE(writeStringToFile(root.completeChildPath("a/three.R"), "3"));
+
+   std::vector<FileChangeEvent> changes;
+   std::vector<int> removedWatches;
+   Error error = impl::discoverAndProcessFileChanges(
+      fileTree.root(),
+      true,
+      boost::function<bool(const FileInfo&)>(),
+      boost::function<Error(const FileInfo&)>(),
+      &fileTree,
+      [&](const std::vector<FileChangeEvent>& events)
+      {
+         changes.insert(changes.end(), events.begin(), events.end());
+      },
+      &removedWatches);
+   REQUIRE_FALSE(error);
+
+   std::vector<std::string> added, removed;
+   for (const FileChangeEvent& change : changes)
+   {
+      if (change.type() == FileChangeEvent::FileAdded)
+         added.push_back(change.fileInfo().absolutePath());
+      else if (change.type() == FileChangeEvent::FileRemoved)
+         removed.push_back(change.fileInfo().absolutePath());
+   }
+   std::sort(removed.begin(), removed.end());
+
+   REQUIRE(added == std::vector<std::string>(1, root.completeChildPath("a/three.R").getAbsolutePath()));
+   REQUIRE(removed.size() == 2);
+   REQUIRE(removed[0] == root.completeChildPath("b").getAbsolutePath());
+   REQUIRE(removedWatches == std::vector<int>(1, 2));
+
+   REQUIRE(fileTree.find(root.completeChildPath("b/two.R").getAbsolutePath()) == FileTree::kNoNode);
+   REQUIRE(fileTree.find(root.completeChildPath("a/three.R").getAbsolutePath()) != FileTree::kNoNode);
+   REQUIRE(fileTree.size() == 4);
+
+   REQUIRE_FALSE(root.remove());
+}
+
+benchmark_context("File monitor file tree replay")
+{
+   // a project of 20,000 files, and the events written by checking out a
+   // branch that touches 200 of them (each is unlinked, created and
+   // written, so replaying the burst leaves the tree as it was)
+   const int kDirs = 200;
+   const int kFiles = 100;
+   std::vector<FileChangeEvent> events = checkoutEvents(kDirs, kFiles, 200);
+
+   tree<FileInfo> project;
+   buildProject(kDirs, kFiles, &project);
+
+   FileTree fileTree;
+   fileTree.assign(project);
+   watchDirectories(kDirs, &fileTree);
+
+   benchmark_that("Replay checkout, searching a tree of FileInfo")
+   {
+      std::vector<FileChangeEvent> changes;
+      replay(events, &project, &changes);
+      return changes.size();
+   };
+
+   benchmark_that("Replay checkout, looking up a FileTree")
+   {
+      std::vector<FileChangeEvent> changes;
+      replay(events, &fileTree, &changes);
+      return changes.size();
+   };
+}
+
+} // namespace tests
+} // namespace file_monitor
+} // namespace system
+} // namespace core
+} // namespace rstudio
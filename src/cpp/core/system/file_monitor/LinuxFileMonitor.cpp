@@ -26,10 +26,6 @@
 #include <boost/utility.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/member.hpp>
-
 #include <core/Log.hpp>
 #include <shared_core/Error.hpp>
 #include <core/FileInfo.hpp>
@@ -50,116 +46,18 @@ namespace file_monitor {
 
 namespace {
 
+// a watch added while scanning, before its directory is in the file tree
 struct Watch
 {
-   Watch()
-      : wd(-1), path()
-   {
-   }
-
    Watch(int wd, const std::string& path)
       : wd(wd), path(path)
    {
    }
 
-   bool empty() const { return path.empty(); }
-
    int wd;
    std::string path;
-
-   bool operator < (const Watch& other) const
-   {
-      return this->wd < other.wd;
-   }
-};
-
-// boost::multi_index_container based class for managing a set of watches
-class Watches
-{
-public:
-
-   void insert(const Watch& watch)
-   {
-      watches_.insert(watch);
-   }
-
-   void erase(const Watch& watch)
-   {
-      watches_.get<wd>().erase(watch.wd);
-   }
-
-   Watch find(int wd) const
-   {
-      WatchesByDescriptor::const_iterator it = descriptorIndex().find(wd);
-      if (it != descriptorIndex().end())
-         return *it;
-      else
-         return Watch();
-   }
-
-   Watch find(const std::string& path) const
-   {
-      WatchesByPath::const_iterator it = pathIndex().find(path);
-      if (it != pathIndex().end())
-         return *it;
-      else
-         return Watch();
-   }
-
-   void forEach(const boost::function<void(const Watch&)> op) const
-   {
-      std::for_each(descriptorIndex().begin(), descriptorIndex().end(), op);
-   }
-
-   void clear()
-   {
-      watches_ = WatchesContainer();
-   }
-
-private:
-
-   struct wd {};
-   struct path {};
-
-   typedef boost::multi_index::multi_index_container<
-
-      Watch,
-
-      boost::multi_index::indexed_by<
-
-         boost::multi_index::hashed_unique<
-            boost::multi_index::tag<wd>,
-            boost::multi_index::member<Watch,
-                                       int,
-                                       &Watch::wd>
-         >,
-
-         boost::multi_index::hashed_unique<
-            boost::multi_index::tag<path>,
-            boost::multi_index::member<Watch,
-                                       std::string,
-                                       &Watch::path>
-         >
-      >
-   > WatchesContainer;
-
-   typedef WatchesContainer::index<wd>::type WatchesByDescriptor;
-   typedef WatchesContainer::index<path>::type WatchesByPath;
-
-   const WatchesByDescriptor& descriptorIndex() const
-   {
-      return watches_.get<wd>();
-   }
-
-   const WatchesByPath& pathIndex() const
-   {
-      return watches_.get<path>();
-   }
-
-   WatchesContainer watches_;
 };
 
-
 class FileEventContext : boost::noncopyable
 {
 public:
@@ -172,11 +70,11 @@ public:
    virtual ~FileEventContext() {}
    Handle handle;
    int fd;
-   Watches watches;
+   std::vector<Watch> addedWatches;
    FilePath rootPath;
    bool recursive;
    boost::function<bool(const FileInfo&)> filter;
-   tree<FileInfo> fileTree;
+   FileTree fileTree;
    Callbacks callbacks;
 };
 
@@ -194,12 +92,12 @@ Error addWatch(const FileInfo& fileInfo,
                const FilePath& rootPath,
                bool allowRootSymlink,
                int fd,
-               Watches* pWatches)
+               std::vector<Watch>* pAddedWatches)
 {
-   // NOTE: both inotify_add_watch and std::set::insert gracefully
+   // NOTE: both inotify_add_watch and FileTree::setWatch gracefully
    // handle duplicate additions, inotify_add_watch by modifying the
    // existing watch and returning the same watch descriptor, and
-   // set::set by simply doing nothing. therefore, we don't bother
+   // setWatch by simply re-attaching it. therefore, we don't bother
    // checking to see if the watch exists and don't generally worry
    // about adding duplicate watches
 
@@ -237,8 +135,9 @@ Error addWatch(const FileInfo& fileInfo,
       return error;
    }
 
-   // record it
-   pWatches->insert(Watch(wd, fileInfo.absolutePath()));
+   // record it (it's attached to the directory once the scan is merged
+   // into the file tree)
+   pAddedWatches->push_back(Watch(wd, fileInfo.absolutePath()));
 
    // return success
    return Success();
@@ -253,30 +152,51 @@ boost::function<Error(const FileInfo&)> addWatchFunction(
                         pContext->rootPath,
                         allowRootSymlink,
                         pContext->fd,
-                        &pContext->watches);
+                        &pContext->addedWatches);
 }
 
-void removeWatch(int fd, const Watch& watch)
+void removeWatch(int fd, int wd)
 {
    // remove the watch
-   int result = ::inotify_rm_watch(fd, watch.wd);
+   int result = ::inotify_rm_watch(fd, wd);
 
    // log error if it isn't EINVAL (which is expected if e.g. the
    // filesystem has been unmounted or the root directory has been deleted)
    if (result < 0 && errno != EINVAL)
    {
       Error error = systemError(errno, ERROR_LOCATION);
-      error.addProperty("path", watch.path);
+      error.addProperty("wd", wd);
       LOG_ERROR(error);
    }
 }
 
+void removeWatches(FileEventContext* pContext, const std::vector<int>& watches)
+{
+   for (int wd : watches)
+      removeWatch(pContext->fd, wd);
+}
+
+void attachAddedWatches(FileEventContext* pContext)
+{
+   for (const Watch& watch : pContext->addedWatches)
+   {
+      FileTree::NodeId node = pContext->fileTree.find(watch.path);
+      if (node != FileTree::kNoNode)
+         pContext->fileTree.setWatch(node, watch.wd);
+      else
+         removeWatch(pContext->fd, watch.wd);
+   }
+   pContext->addedWatches.clear();
+}
+
 void removeAllWatches(FileEventContext* pContext)
 {
-   pContext->watches.forEach(boost::bind(removeWatch,
-                                          pContext->fd,
-                                          _1));
-   pContext->watches.clear();
+   removeWatches(pContext, pContext->fileTree.watches());
+   pContext->fileTree.clearWatches();
+
+   for (const Watch& watch : pContext->addedWatches)
+      removeWatch(pContext->fd, watch.wd);
+   pContext->addedWatches.clear();
 }
 
 void closeContext(FileEventContext* pContext)
@@ -316,26 +236,15 @@ Error processEvent(FileEventContext* pContext,
    // child of the monitored directory (len == 0 occurs for root element)
    if ((eventType != FileChangeEvent::None) && (pEvent->len > 0))
    {
-      // find the FileInfo for this wd (ignore if we can't find one)
-      Watch watch = pContext->watches.find(pEvent->wd);
-      if (watch.empty())
-         return Success();
-
-      // get an iterator to the parent dir
-      tree<FileInfo>::iterator parentIt = impl::findFile(
-                                                   pContext->fileTree.begin(),
-                                                   pContext->fileTree.end(),
-                                                   watch.path);
-
-      // if we can't find a parent then return (this directory may have
-      // been excluded from scanning due to a filter)
-      if (parentIt == pContext->fileTree.end())
+      // find the directory for this wd (ignore if we can't find one, e.g.
+      // if it has been excluded from scanning due to a filter)
+      FileTree::NodeId parent = pContext->fileTree.findWatch(pEvent->wd);
+      if (parent == FileTree::kNoNode)
          return Success();
 
       // get file info
-      FilePath filePath = FilePath(parentIt->absolutePath()).completePath(
-         pEvent->name);
-
+      FilePath filePath = FilePath(pContext->fileTree.absolutePath(parent))
+                                                   .completePath(pEvent->name);
 
       // if the file exists then collect as many extended attributes
       // as necessary -- otherwise just record path and dir status
@@ -358,29 +267,18 @@ Error processEvent(FileEventContext* pContext,
       {
          case FileChangeEvent::FileRemoved:
          {
-            // generate events
+            // generate events (and remove the watches of any directories
+            // that were removed)
             FileChangeEvent event(FileChangeEvent::FileRemoved, fileInfo);
             std::vector<FileChangeEvent> removeEvents;
-            impl::processFileRemoved(parentIt,
+            std::vector<int> removedWatches;
+            impl::processFileRemoved(parent,
                                      event,
                                      pContext->recursive,
                                      &pContext->fileTree,
-                                     &removeEvents);
-
-            // for each directory remove event remove any watches we have for it
-            for (const FileChangeEvent& event : removeEvents)
-            {
-               if (event.fileInfo().isDirectory())
-               {
-                  Watch watch = pContext->watches.find(
-                                             event.fileInfo().absolutePath());
-                  if (!watch.empty())
-                  {
-                     removeWatch(pContext->fd, watch);
-                     pContext->watches.erase(watch);
-                  }
-               }
-            }
+                                     &removeEvents,
+                                     &removedWatches);
+            removeWatches(pContext, removedWatches);
 
             // copy to the target events
             std::copy(removeEvents.begin(),
@@ -392,13 +290,14 @@ Error processEvent(FileEventContext* pContext,
          case FileChangeEvent::FileAdded:
          {
             FileChangeEvent event(FileChangeEvent::FileAdded, fileInfo);
-            Error error = impl::processFileAdded(parentIt,
+            Error error = impl::processFileAdded(parent,
                                                  event,
                                                  pContext->recursive,
                                                  pContext->filter,
                                                  addWatchFunction(pContext),
                                                  &pContext->fileTree,
                                                  pFileChanges);
+            attachAddedWatches(pContext);
             // log the error if it wasn't no such file/dir (this can happen
             // in the normal course of business if a file is deleted between
             // the time the change is detected and we try to inspect it)
@@ -412,7 +311,7 @@ Error processEvent(FileEventContext* pContext,
          case FileChangeEvent::FileModified:
          {
             FileChangeEvent event(FileChangeEvent::FileModified, fileInfo);
-            impl::processFileModified(parentIt,
+            impl::processFileModified(parent,
                                       event,
                                       &pContext->fileTree,
                                       pFileChanges);
@@ -485,13 +384,16 @@ Handle registerMonitor(const core::FilePath& filePath,
       return registrationFailure(errno, pContext, callbacks, ERROR_LOCATION);
 #endif
 
-   // scan the files (use callback to setup watches)
+   // scan the files (use callback to setup watches), in parallel since
+   // this can be a large tree
    FileScannerOptions options;
    options.recursive = recursive;
    options.yield = true;
+   options.threads = 0;
    options.filter = filter;
    options.onBeforeScanDir = addWatchFunction(pContext, true);
-   Error error = scanFiles(FileInfo(filePath), options, &pContext->fileTree);
+   tree<FileInfo> fileTree;
+   Error error = scanFiles(FileInfo(filePath), options, &fileTree);
    if (error)
    {
        // close context
@@ -502,6 +404,11 @@ Handle registerMonitor(const core::FilePath& filePath,
        return Handle();
    }
 
+   // keep the listing as a compact tree, with the watches attached to
+   // their directories
+   pContext->fileTree.assign(fileTree);
+   attachAddedWatches(pContext);
+
    // now that we have finished the file listing we know we have a valid
    // file-monitor so set the callbacks
    pContext->callbacks = callbacks;
@@ -511,7 +418,7 @@ Handle registerMonitor(const core::FilePath& filePath,
    contextScope.release();
 
    // notify the caller that we have successfully registered
-   callbacks.onRegistered(pContext->handle, pContext->fileTree);
+   callbacks.onRegistered(pContext->handle, fileTree);
 
    // return the handle
    return pContext->handle;
@@ -612,13 +519,17 @@ void run(const boost::function<void()>& checkForInput)
                   removeAllWatches(pContext);
 
                   // generate events based on scanning
-                  Error error =impl::discoverAndProcessFileChanges(
-                        FileInfo(pContext->rootPath),
+                  std::vector<int> removedWatches;
+                  Error error = impl::discoverAndProcessFileChanges(
+                        pContext->fileTree.root(),
                         pContext->recursive,
                         pContext->filter,
                         addWatchFunction(pContext, true),
                         &pContext->fileTree,
-                        pContext->callbacks.onFilesChanged);
+                        pContext->callbacks.onFilesChanged,
+                        &removedWatches);
+                  removeWatches(pContext, removedWatches);
+                  attachAddedWatches(pContext);
                   if (error)
                      terminateWithMonitoringError(pContext, error);
 
@@ -426,6 +426,66 @@ void listEnvironment(SEXP env,
    }
 }
 
+void listBindings(SEXP env,
+                  bool includeAll,
+                  bool includeLastDotValue,
+                  std::vector<Binding>* pBindings)
+{
+   if (!ASSERT_MAIN_THREAD())
+      return;
+
+   pBindings->clear();
+
+   // get the names bound in the frame; these aren't sorted, as sorting (by
+   // collation order) costs more than anything else here in large
+   // environments
+   SEXP namesSEXP;
+   Protect rProtect(namesSEXP = R_lsInternal3(env, includeAll ? TRUE : FALSE, FALSE));
+
+   int n = Rf_length(namesSEXP);
+   pBindings->reserve(n + 1);
+   for (int i = 0; i < n; i++)
+   {
+      SEXP symbolSEXP = Rf_install(CHAR(STRING_ELT(namesSEXP, i)));
+      SEXP valueSEXP = findBinding(env, symbolSEXP);
+      if (valueSEXP != R_UnboundValue) // should never be unbound
+      {
+         pBindings->push_back(std::make_pair(symbolSEXP, valueSEXP));
+      }
+      else
+      {
+         LOG_WARNING_MESSAGE(
+                  "Unexpected R_UnboundValue returned from R_lsInternal3");
+      }
+   }
+
+   // add in .Last.value if it exists
+   if (!includeAll && includeLastDotValue)
+   {
+      SEXP symbolSEXP = Rf_install(".Last.value");
+      SEXP valueSEXP = findBinding(env, symbolSEXP);
+      if (valueSEXP != R_UnboundValue)
+         pBindings->push_back(std::make_pair(symbolSEXP, valueSEXP));
+   }
+}
+
+SEXP findBinding(SEXP env, SEXP symbolSEXP)
+{
+   // .Last.value is bound in the base environment, and isn't active
+   if (symbolSEXP == Rf_install(".Last.value"))
+      return Rf_findVar(symbolSEXP, env);
+
+   // R_BindingIsActive raises an error for unbound symbols; look the symbol up
+   // without getting its value, so active bindings aren't called (this also
+   // works with versions of R without R_existsVarInFrame)
+   if (Rf_findVarInFrame3(env, symbolSEXP, FALSE) == R_UnboundValue)
+      return R_UnboundValue;
+
+   if (R_BindingIsActive(symbolSEXP, env))
+      return R_NilValue;
+
+   return Rf_findVarInFrame(env, symbolSEXP);
+}
 
 void listNamedAttributes(SEXP obj, Protect *pProtect, std::vector<Variable>* pVariables)
 {
@@ -66,6 +66,21 @@ void listEnvironment(SEXP env,
                      bool includeLastDotValue,
                      Protect* pProtect,
                      std::vector<Variable>* pVariables);
+
+// bindings within an environment's frame, by symbol. unlike listEnvironment,
+// the bindings are listed in no particular order, and their values aren't
+// protected (they're reachable from the environment, but mustn't be held on to
+// across changes to it). the values of active bindings are R_NilValue, as
+// looking them up would fire them.
+typedef std::pair<SEXP,SEXP> Binding;
+void listBindings(SEXP env,
+                  bool includeAll,
+                  bool includeLastDotValue,
+                  std::vector<Binding>* pBindings);
+
+// returns the value bound to a symbol in an environment's frame as it would
+// be listed by listBindings (or R_UnboundValue when it isn't bound)
+SEXP findBinding(SEXP env, SEXP symbolSEXP);
       
 // object info
 SEXP findVar(const std::string& name,
@@ -22,6 +22,8 @@
 
 #include <numeric>
 
+#include <boost/make_shared.hpp>
+
 using namespace rstudio::core;
 using namespace rstudio::core::r_util;
 using namespace rstudio::server_core::database;
@@ -132,6 +134,34 @@ void populateMapWithRow(database::RowsetIterator iter, std::map<std::string, std
    }
 }
 
+// updates the properties of a session with one statement. the values are bound
+// rather than quoted into the sql so it stays the same for the same set of
+// properties and its prepared statement can be reused
+Error updateProperties(boost::shared_ptr<database::IConnection> connection,
+                       const std::string& sessionId,
+                       const std::map<std::string, std::string>& properties)
+{
+   std::string queryStr = "UPDATE " + kTableName + " SET ";
+   int index = 0;
+   for (const auto& property : properties)
+   {
+      if (index > 0)
+         queryStr.append(", ");
+      queryStr
+         .append(columnName(property.first))
+         .append(" = :value")
+         .append(std::to_string(index++));
+   }
+   queryStr.append(" WHERE " + kSessionIdColumnName + " = :id");
+
+   database::Query query = connection->query(queryStr);
+   for (const auto& property : properties)
+      query.withInput(property.second);
+   query.withInput(sessionId);
+
+   return connection->execute(query);
+}
+
 Error getSessionCount(boost::shared_ptr<database::IConnection> connection, std::string sessionId, int* pCount)
 {
    database::Query query = connection->query("SELECT COUNT(*) FROM " + kTableName + " WHERE " + kSessionIdColumnName + " = :id")
@@ -148,6 +178,223 @@ Error getSessionCount(boost::shared_ptr<database::IConnection> connection, std::
 
 } // anonymous namespace
 
+PropertyWriteCoalescer::PropertyWriteCoalescer(const boost::posix_time::time_duration& window,
+                                               const ConnectionSource& connectionSource) :
+   window_(window),
+   connectionSource_(connectionSource),
+   stopping_(false)
+{
+   thread_ = boost::thread(&PropertyWriteCoalescer::run, this);
+}
+
+PropertyWriteCoalescer::~PropertyWriteCoalescer()
+{
+   try
+   {
+      stop();
+   }
+   CATCH_UNEXPECTED_EXCEPTION
+}
+
+void PropertyWriteCoalescer::stop()
+{
+   LOCK_MUTEX(mutex_)
+   {
+      stopping_ = true;
+   }
+   END_LOCK_MUTEX
+   condition_.notify_all();
+   if (thread_.joinable())
+      thread_.join();
+
+   std::vector<std::string> sessionIds;
+   LOCK_MUTEX(mutex_)
+   {
+      for (const auto& pending : pending_)
+         sessionIds.push_back(pending.first);
+   }
+   END_LOCK_MUTEX
+
+   for (const std::string& sessionId : sessionIds)
+   {
+      Error error = flush(sessionId);
+      if (error)
+         LOG_ERROR(error);
+   }
+}
+
+Error PropertyWriteCoalescer::write(const std::string& sessionId,
+                                    const std::string& name,
+                                    const std::string& value)
+{
+   bool first = false;
+   bool stopping = false;
+   LOCK_MUTEX(mutex_)
+   {
+      first = pending_.empty();
+      stopping = stopping_;
+      pending_[sessionId][name] = value;
+   }
+   END_LOCK_MUTEX
+
+   // nothing will write it in the background once stopped
+   if (stopping)
+      return flush(sessionId);
+
+   if (first)
+      condition_.notify_all();
+
+   return Success();
+}
+
+boost::shared_ptr<boost::mutex> PropertyWriteCoalescer::flushMutex(const std::string& sessionId)
+{
+   boost::shared_ptr<boost::mutex> pMutex;
+   LOCK_MUTEX(mutex_)
+   {
+      pMutex = flushMutexes_[sessionId];
+      if (!pMutex)
+      {
+         pMutex = boost::make_shared<boost::mutex>();
+         flushMutexes_[sessionId] = pMutex;
+      }
+   }
+   END_LOCK_MUTEX
+
+   return pMutex;
+}
+
+Error PropertyWriteCoalescer::flush(const std::string& sessionId)
+{
+   Error error;
+   boost::shared_ptr<boost::mutex> pFlushMutex = flushMutex(sessionId);
+   LOCK_MUTEX(*pFlushMutex)
+   {
+      error = writePending(sessionId);
+   }
+   END_LOCK_MUTEX
+
+   // forget the session's flush mutex once nothing is left to write; any
+   // other flush of the session holds its own reference, taken under mutex_
+   LOCK_MUTEX(mutex_)
+   {
+      auto it = flushMutexes_.find(sessionId);
+      if (it != flushMutexes_.end() &&
+          it->second == pFlushMutex &&
+          pFlushMutex.use_count() == 2 &&
+          pending_.find(sessionId) == pending_.end())
+      {
+         flushMutexes_.erase(it);
+      }
+   }
+   END_LOCK_MUTEX
+
+   return error;
+}
+
+Error PropertyWriteCoalescer::writePending(const std::string& sessionId)
+{
+   std::map<std::string, std::string> properties;
+   LOCK_MUTEX(mutex_)
+   {
+      auto it = pending_.find(sessionId);
+      if (it != pending_.end())
+      {
+         properties.swap(it->second);
+         pending_.erase(it);
+      }
+   }
+   END_LOCK_MUTEX
+
+   if (properties.empty())
+      return Success();
+
+   boost::shared_ptr<database::IConnection> connection;
+   Error error = connectionSource_(&connection);
+   if (!error)
+      error = updateProperties(connection, sessionId, properties);
+
+   if (error)
+   {
+      // keep the properties for the next flush, behind any newer writes
+      LOCK_MUTEX(mutex_)
+      {
+         std::map<std::string, std::string>& pending = pending_[sessionId];
+         for (const auto& property : properties)
+            pending.insert(property);
+      }
+      END_LOCK_MUTEX
+
+      return Error("DatabaseException", errc::DBError, "Database error while updating session metadata [ session: " + sessionId + " properties: " + getKeyString(properties) + " ]", error, ERROR_LOCATION);
+   }
+
+   LOCK_MUTEX(mutex_)
+   {
+      failing_.erase(sessionId);
+   }
+   END_LOCK_MUTEX
+
+   return Success();
+}
+
+void PropertyWriteCoalescer::discard(const std::string& sessionId)
+{
+   LOCK_MUTEX(mutex_)
+   {
+      pending_.erase(sessionId);
+      failing_.erase(sessionId);
+      flushMutexes_.erase(sessionId);
+   }
+   END_LOCK_MUTEX
+}
+
+void PropertyWriteCoalescer::run()
+{
+   try
+   {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      while (!stopping_)
+      {
+         if (pending_.empty())
+         {
+            condition_.wait(lock);
+            continue;
+         }
+
+         // let the other writes made around the same time join in
+         condition_.timed_wait(lock, window_);
+         if (stopping_)
+            break;
+
+         std::vector<std::string> sessionIds;
+         for (const auto& pending : pending_)
+            sessionIds.push_back(pending.first);
+
+         lock.unlock();
+         for (const std::string& sessionId : sessionIds)
+         {
+            Error error = flush(sessionId);
+            if (!error)
+               continue;
+
+            // the writes are retried with the next flush; log the failure
+            // once rather than at every retry
+            bool first = false;
+            LOCK_MUTEX(mutex_)
+            {
+               first = failing_.insert(sessionId).second;
+            }
+            END_LOCK_MUTEX
+
+            if (first)
+               LOG_ERROR(error);
+         }
+         lock.lock();
+      }
+   }
+   CATCH_UNEXPECTED_EXCEPTION
+}
+
 Error getConn(boost::shared_ptr<database::IConnection>* connection) {
    bool success = server_core::database::getConnection(boost::posix_time::milliseconds(500), connection);
 
@@ -183,10 +430,27 @@ DBActiveSessionStorage::DBActiveSessionStorage(const std::string& sessionId, con
 {
 }
 
+void DBActiveSessionStorage::setWriteCoalescer(const boost::shared_ptr<PropertyWriteCoalescer>& pWriteCoalescer)
+{
+   pWriteCoalescer_ = pWriteCoalescer;
+}
+
+void DBActiveSessionStorage::flushPendingWrites()
+{
+   if (!pWriteCoalescer_)
+      return;
+
+   Error error = pWriteCoalescer_->flush(sessionId_);
+   if (error)
+      LOG_ERROR(error);
+}
+
 Error DBActiveSessionStorage::readProperty(const std::string& name, std::string* pValue)
 {
    static const std::string empty;
 
+   flushPendingWrites();
+
    *pValue = "";
    boost::shared_ptr<database::IConnection> connection;
    Error error = getConnectionOrOverride(&connection);
@@ -237,6 +501,7 @@ Error DBActiveSessionStorage::readProperty(const std::string& name, std::string*
 Error DBActiveSessionStorage::readProperties(const std::set<std::string>& names, std::map<std::string, std::string>* pValues)
 {
    pValues->clear();
+   flushPendingWrites();
    boost::shared_ptr<database::IConnection> connection;
    Error error = getConnectionOrOverride(&connection);
 
@@ -284,17 +549,16 @@ Error DBActiveSessionStorage::readProperties(std::map<std::string, std::string>*
 
 Error DBActiveSessionStorage::writeProperty(const std::string& name, const std::string& value)
 {
+   if (pWriteCoalescer_)
+      return pWriteCoalescer_->write(sessionId_, name, value);
+
    boost::shared_ptr<database::IConnection> connection;
    Error error = getConnectionOrOverride(&connection);
 
    if (error)
       return error;
 
-   database::Query query = connection->query("UPDATE " + kTableName + " SET " + columnName(name) + " = :value WHERE " + kSessionIdColumnName + " = :id")
-      .withInput(value)
-      .withInput(sessionId_);
-
-   error = connection->execute(query);
+   error = updateProperties(connection, sessionId_, { { name, value } });
 
    if (error)
       return Error("DatabaseException", errc::DBError, "Database error while updating session metadata [ session: " + sessionId_ + " property: " + name + " ]", error, ERROR_LOCATION);
@@ -305,6 +569,8 @@ Error DBActiveSessionStorage::writeProperty(const std::string& name, const std::
 Error DBActiveSessionStorage::writeProperties(const std::map<std::string, std::string>& properties)
 {
    LOG_DEBUG_MESSAGE("Writing session properties: " + sessionId_);
+   flushPendingWrites();
+
    boost::shared_ptr<database::IConnection> connection;
    Error error = getConnectionOrOverride(&connection);
 
@@ -377,6 +643,9 @@ Error DBActiveSessionStorage::destroy()
 {
    LOG_DEBUG_MESSAGE("Removing active session for: " + sessionId_ + " from database");
 
+   if (pWriteCoalescer_)
+      pWriteCoalescer_->discard(sessionId_);
+
    boost::shared_ptr<database::IConnection> connection;
    Error error = getConnectionOrOverride(&connection);
 
@@ -400,6 +669,7 @@ Error DBActiveSessionStorage::destroy()
 Error DBActiveSessionStorage::isValid(bool* pValue)
 {
    *pValue = false;
+   flushPendingWrites();
 
    boost::shared_ptr<database::IConnection> connection;
    Error error = getConnectionOrOverride(&connection);
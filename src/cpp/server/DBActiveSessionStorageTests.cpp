@@ -3,6 +3,9 @@
 #include <core/system/System.hpp>
 #include <core/FileSerializer.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/make_shared.hpp>
+
+#include <atomic>
 
 using namespace rstudio::core;
 using namespace rstudio::core::database;
@@ -276,6 +279,105 @@ TEST_CASE("Database Session Storage, Sqlite","[database][integration][session][s
    runTests(storage);
 }
 
+TEST_CASE("Database Session Storage, coalesced writes, Sqlite","[database][integration][session][sqlite]")
+{
+   system::User currUser;
+   Error error = system::User::getCurrentUser(currUser);
+   REQUIRE(!error);
+
+   SqliteConnectionOptions options = sqliteConnectionOptions();
+   boost::shared_ptr<IConnection> connection = initializeSQLiteDatabase(options, currUser);
+   DBActiveSessionStorage storage{sessionId, currUser, connection};
+   REQUIRE_FALSE(storage.writeProperties(initialProps));
+
+   // a long window, so only reads write the pending properties
+   auto pWriteCoalescer = boost::make_shared<PropertyWriteCoalescer>(
+            boost::posix_time::hours(1),
+            [=](boost::shared_ptr<IConnection>* pConnection)
+            {
+               *pConnection = connection;
+               return Success();
+            });
+   storage.setWriteCoalescer(pWriteCoalescer);
+
+   REQUIRE_FALSE(storage.writeProperty("activity_state", "running"));
+   REQUIRE_FALSE(storage.writeProperty("last_used", "2020-05-01T00:00:00.000Z"));
+   REQUIRE_FALSE(storage.writeProperty("activity_state", "idle"));
+
+   // nothing has been written yet
+   int unchanged = 0;
+   Query query = connection->query("SELECT COUNT(*) FROM active_session_metadata WHERE last_used = '2020-04-30T00:00:00.000Z'")
+      .withOutput(unchanged);
+   REQUIRE_FALSE(connection->execute(query));
+   REQUIRE(unchanged == 1);
+
+   std::map<std::string, std::string> readProps{};
+   REQUIRE_FALSE(storage.readProperties(&readProps));
+   REQUIRE(readProps.find("activity_state")->second == "idle");
+   REQUIRE(readProps.find("last_used")->second == "2020-05-01T00:00:00.000Z");
+
+   // stopping writes what's pending, and later writes are made immediately
+   REQUIRE_FALSE(storage.writeProperty("activity_state", "running"));
+   pWriteCoalescer->stop();
+   int stopped = 0;
+   Query stoppedQuery = connection->query("SELECT COUNT(*) FROM active_session_metadata WHERE activity_state = 'running'")
+      .withOutput(stopped);
+   REQUIRE_FALSE(connection->execute(stoppedQuery));
+   REQUIRE(stopped == 1);
+
+   REQUIRE_FALSE(storage.writeProperty("last_used", "2020-05-02T00:00:00.000Z"));
+   int written = 0;
+   Query writtenQuery = connection->query("SELECT COUNT(*) FROM active_session_metadata WHERE last_used = '2020-05-02T00:00:00.000Z'")
+      .withOutput(written);
+   REQUIRE_FALSE(connection->execute(writtenQuery));
+   REQUIRE(written == 1);
+
+   // writes are dropped with the session
+   REQUIRE_FALSE(storage.destroy());
+   bool valid = true;
+   REQUIRE_FALSE(storage.isValid(&valid));
+   REQUIRE_FALSE(valid);
+}
+
+TEST_CASE("Database Session Storage, failed coalesced writes, Sqlite","[database][integration][session][sqlite]")
+{
+   system::User currUser;
+   Error error = system::User::getCurrentUser(currUser);
+   REQUIRE(!error);
+
+   SqliteConnectionOptions options = sqliteConnectionOptions();
+   boost::shared_ptr<IConnection> connection = initializeSQLiteDatabase(options, currUser);
+   DBActiveSessionStorage storage{sessionId, currUser, connection};
+   REQUIRE_FALSE(storage.writeProperties(initialProps));
+
+   // no connection until the database comes back
+   auto pAvailable = boost::make_shared<std::atomic<bool> >(false);
+   auto pWriteCoalescer = boost::make_shared<PropertyWriteCoalescer>(
+            boost::posix_time::milliseconds(10),
+            [=](boost::shared_ptr<IConnection>* pConnection) -> Error
+            {
+               if (!*pAvailable)
+                  return Error("FailedToAcquireConnection", errc::ConnectionFailed, ERROR_LOCATION);
+               *pConnection = connection;
+               return Success();
+            });
+   storage.setWriteCoalescer(pWriteCoalescer);
+
+   REQUIRE_FALSE(storage.writeProperty("activity_state", "running"));
+   boost::this_thread::sleep(boost::posix_time::milliseconds(200));
+
+   // the failed background write is logged rather than reported by the
+   // next write, which is queued behind it
+   REQUIRE_FALSE(storage.writeProperty("label", "renamed"));
+
+   // and the properties are written when the database is back
+   *pAvailable = true;
+   std::map<std::string, std::string> readProps{};
+   REQUIRE_FALSE(storage.readProperties(&readProps));
+   REQUIRE(readProps.find("activity_state")->second == "running");
+   REQUIRE(readProps.find("label")->second == "renamed");
+}
+
 TEST_CASE("Database Session Storage, Postgres","[database][integration][session][.postgres]")
 {
    system::User currUser;
@@ -16,6 +16,7 @@
 #include <server/DBActiveSessionsStorage.hpp>
 
 #include <core/Database.hpp>
+#include <core/Thread.hpp>
 #include <server/DBActiveSessionStorage.hpp>
 #include <server_core/ServerDatabase.hpp>
 
@@ -27,6 +28,35 @@ namespace rstudio {
 namespace server {
 namespace storage {
 
+namespace {
+
+// session heartbeats write several properties at once (e.g. last used time
+// and running state); gather the writes made within this window into one update
+const boost::posix_time::time_duration kPropertyWriteWindow = boost::posix_time::milliseconds(100);
+
+// never destroyed, as the connection pool it writes with may be gone by then;
+// flushDeferredWrites stops it explicitly at shutdown instead
+boost::mutex s_writeCoalescerMutex;
+boost::shared_ptr<PropertyWriteCoalescer>* s_pWriteCoalescer = nullptr;
+
+boost::shared_ptr<PropertyWriteCoalescer> propertyWriteCoalescer()
+{
+   boost::shared_ptr<PropertyWriteCoalescer> pWriteCoalescer;
+   LOCK_MUTEX(s_writeCoalescerMutex)
+   {
+      if (!s_pWriteCoalescer)
+      {
+         s_pWriteCoalescer = new boost::shared_ptr<PropertyWriteCoalescer>(
+                  new PropertyWriteCoalescer(kPropertyWriteWindow, getConn));
+      }
+      pWriteCoalescer = *s_pWriteCoalescer;
+   }
+   END_LOCK_MUTEX
+
+   return pWriteCoalescer;
+}
+
+} // anonymous namespace
 
 DBActiveSessionsStorage::DBActiveSessionsStorage(const system::User& user) :
    user_(user)
@@ -104,7 +134,23 @@ size_t DBActiveSessionsStorage::getSessionCount() const
 
 std::shared_ptr<IActiveSessionStorage> DBActiveSessionsStorage::getSessionStorage(const std::string& id) const
 {
-   return std::make_shared<DBActiveSessionStorage>(id, user_);
+   auto pStorage = std::make_shared<DBActiveSessionStorage>(id, user_);
+   pStorage->setWriteCoalescer(propertyWriteCoalescer());
+   return pStorage;
+}
+
+void DBActiveSessionsStorage::flushDeferredWrites()
+{
+   boost::shared_ptr<PropertyWriteCoalescer> pWriteCoalescer;
+   LOCK_MUTEX(s_writeCoalescerMutex)
+   {
+      if (s_pWriteCoalescer)
+         pWriteCoalescer = *s_pWriteCoalescer;
+   }
+   END_LOCK_MUTEX
+
+   if (pWriteCoalescer)
+      pWriteCoalescer->stop();
 }
 
 Error DBActiveSessionsStorage::hasSessionId(const std::string& sessionId, bool* pHasSessionId) const
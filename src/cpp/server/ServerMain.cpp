@@ -38,6 +38,8 @@
 #include <core/gwt/GwtLogHandler.hpp>
 #include <core/gwt/GwtFileHandler.hpp>
 
+#include <core/r_util/RActiveSessionStorage.hpp>
+
 #include <server_core/SecureKeyFile.hpp>
 #include <server_core/ServerDatabase.hpp>
 #include <server_core/http/SecureCookie.hpp>
@@ -56,6 +58,7 @@
 #include <server/ServerScheduler.hpp>
 #include <server/ServerProcessSupervisor.hpp>
 #include <server/ServerPaths.hpp>
+#include <server/DBActiveSessionsStorage.hpp>
 
 #include <server/session/ServerSessionProxy.hpp>
 #include <server/session/ServerSessionManager.hpp>
@@ -423,6 +426,13 @@ Error waitForSignals()
          // call overlay shutdown
          overlay::shutdown();
 
+         // write any session properties still being held back
+         core::r_util::FileActiveSessionStorage::flushDeferredWrites();
+         storage::DBActiveSessionsStorage::flushDeferredWrites();
+
+         // write any queued log messages, as re-raising the signal skips exit handlers
+         core::log::shutdown();
+
          // clear the signal mask
          Error error = core::system::clearSignalMask();
          if (error)
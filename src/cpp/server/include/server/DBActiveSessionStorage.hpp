@@ -16,6 +16,13 @@
 #ifndef DB_ACTIVE_SESSION_STORAGE_HPP
 #define DB_ACTIVE_SESSION_STORAGE_HPP
 
+#include <map>
+#include <set>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <core/BoostThread.hpp>
 #include <core/Database.hpp>
 #include <core/r_util/RActiveSessionStorage.hpp>
 
@@ -26,6 +33,56 @@ namespace rstudio {
 namespace server {
 namespace storage {
 
+typedef boost::function<core::Error(boost::shared_ptr<core::database::IConnection>*)> ConnectionSource;
+
+// gathers the property writes made to sessions within a short window, so
+// that each session's properties are written with a single update rather
+// than one round trip per property
+class PropertyWriteCoalescer : boost::noncopyable
+{
+public:
+   PropertyWriteCoalescer(const boost::posix_time::time_duration& window,
+                          const ConnectionSource& connectionSource);
+
+   // writes anything still pending
+   ~PropertyWriteCoalescer();
+
+   // queues a write, replacing any pending write of the same property; the
+   // write itself happens in the background, where failures are logged and
+   // the properties are kept for the next attempt (once stopped, the write
+   // is made immediately and its error returned)
+   core::Error write(const std::string& sessionId, const std::string& name, const std::string& value);
+
+   // writes the session's pending properties now
+   core::Error flush(const std::string& sessionId);
+
+   // forgets the session's pending properties (e.g. when it is destroyed)
+   void discard(const std::string& sessionId);
+
+   // stops the background writer and writes everything still pending
+   void stop();
+
+private:
+   void run();
+   boost::shared_ptr<boost::mutex> flushMutex(const std::string& sessionId);
+   core::Error writePending(const std::string& sessionId);
+
+   boost::posix_time::time_duration window_;
+   ConnectionSource connectionSource_;
+
+   std::map<std::string, std::map<std::string, std::string> > pending_;
+   std::set<std::string> failing_;
+   bool stopping_;
+   boost::mutex mutex_;
+   boost::condition_variable condition_;
+
+   // per session, held from taking its pending writes until they are
+   // written, so writes reach the database in the order they were made
+   std::map<std::string, boost::shared_ptr<boost::mutex> > flushMutexes_;
+
+   boost::thread thread_;
+};
+
 class DBActiveSessionStorage : public core::r_util::IActiveSessionStorage 
 {
 public:
@@ -43,13 +100,19 @@ public:
    core::Error destroy() override;
    core::Error isValid(bool* pValue) override;
 
+   // defer single property writes to the coalescer; reads and other changes
+   // see them because they flush the session's pending writes first
+   void setWriteCoalescer(const boost::shared_ptr<PropertyWriteCoalescer>& pWriteCoalescer);
+
 private:
    std::string sessionId_;
    core::system::User user_;
 
    boost::shared_ptr<core::database::IConnection> overrideConnection_;
+   boost::shared_ptr<PropertyWriteCoalescer> pWriteCoalescer_;
 
    core::Error getConnectionOrOverride(boost::shared_ptr<core::database::IConnection>* connection);
+   void flushPendingWrites();
 };
 
 core::Error getConn(boost::shared_ptr<core::database::IConnection>* connection);
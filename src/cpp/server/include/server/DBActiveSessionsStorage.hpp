@@ -37,6 +37,11 @@ public:
    size_t getSessionCount() const override;
    std::shared_ptr<core::r_util::IActiveSessionStorage> getSessionStorage(const std::string& id) const override;
    core::Error hasSessionId(const std::string& sessionId, bool* pHasSessionId) const override;
+
+   // stops the background writing of session properties, writing those
+   // still being held back now (later writes are made immediately)
+   static void flushDeferredWrites();
+
 private:
    const core::system::User user_;
 };
@@ -45,6 +45,7 @@
 #include <core/http/Request.hpp>
 #include <core/http/Response.hpp>
 #include <core/http/LocalStreamAsyncClient.hpp>
+#include <core/http/LocalStreamAsyncClientPool.hpp>
 #include <core/http/Util.hpp>
 #include <core/http/URL.hpp>
 #include <core/http/ChunkProxy.hpp>
@@ -697,6 +698,13 @@ Error userIdForUsername(const std::string& username, UidType* pUID)
    return Success();
 }
 
+// connections to sessions are kept open between requests
+http::LocalStreamAsyncClientPool& sessionClientPool()
+{
+   static http::LocalStreamAsyncClientPool instance;
+   return instance;
+}
+
 void proxyRequest(
       int requestType,
       const r_util::SessionContext& context,
@@ -762,9 +770,18 @@ void proxyRequest(
    // create client
    // if the user is available on the system pass in the uid for validation to ensure
    // that we only connect to the socket if it was created by the user
-   boost::shared_ptr<http::IAsyncClient> pClient(new http::LocalStreamAsyncClient(
-                                                    ptrConnection->ioService(),
-                                                    streamPath, false, validateUid));
+   // ordinary requests go over a pooled connection; those which hand the
+   // client on (uploads, websockets) get a connection of their own
+   boost::shared_ptr<http::IAsyncClient> pClient;
+   if (!clientHandler && !http::util::isWSUpgradeRequest(*pRequest))
+   {
+      pClient = sessionClientPool().client(ptrConnection->ioService(), streamPath, validateUid);
+   }
+   else
+   {
+      pClient.reset(new http::LocalStreamAsyncClient(ptrConnection->ioService(),
+                                                     streamPath, false, validateUid));
+   }
 
    // setup retry context
    if (!connectionRetryProfile.empty())
@@ -15,6 +15,8 @@
 
 #include "SessionClientEventQueue.hpp"
 
+#include <algorithm>
+
 #include "modules/SessionConsole.hpp"
 
 #include <core/BoostThread.hpp>
@@ -32,7 +34,120 @@ namespace rstudio {
 namespace session {
  
 namespace {
+
 ClientEventQueue* s_pClientEventQueue = nullptr;
+
+// upper bound on the console output held for the client, both within a
+// single batch of output and across all output waiting in the queue
+const std::size_t kMaxConsoleOutputBytes = 1024 * 1024;
+
+std::string omittedLinesMarker(std::size_t lines)
+{
+   return "[ ... " + safe_convert::numberToString(lines) + " lines omitted ... ]\n";
+}
+
+std::size_t maxConsoleOutputLines()
+{
+   return static_cast<std::size_t>(r::session::consoleActions().capacity() + 1);
+}
+
+} // anonymous namespace
+
+ConsoleOutputBuffer::ConsoleOutputBuffer(std::size_t maxBytes, std::size_t maxLines)
+   : maxBytes_(maxBytes),
+     maxLines_(maxLines),
+     lines_(0),
+     headEnd_(std::string::npos),
+     omittedLines_(0)
+{
+}
+
+void ConsoleOutputBuffer::append(const std::string& text)
+{
+   text_.append(text);
+   lines_ += std::count(text.begin(), text.end(), '\n');
+
+   if (text_.size() > maxBytes_ || lines_ > maxLines_)
+      elide();
+}
+
+std::string ConsoleOutputBuffer::take()
+{
+   std::string text;
+   text.swap(text_);
+   if (omittedLines_ > 0)
+      text.insert(headEnd_, omittedLinesMarker(omittedLines_));
+
+   clear();
+   return text;
+}
+
+void ConsoleOutputBuffer::clear()
+{
+   text_.clear();
+   lines_ = 0;
+   headEnd_ = std::string::npos;
+   omittedLines_ = 0;
+}
+
+void ConsoleOutputBuffer::elide()
+{
+   // keep up to a quarter of the limits at the start of the output and up
+   // to half at the end, so that eliding again is only needed after a
+   // substantial amount of further output
+   std::size_t maxHeadBytes = maxBytes_ / 4;
+   std::size_t maxHeadLines = maxLines_ / 4;
+   std::size_t maxTailBytes = maxBytes_ / 2;
+   std::size_t maxTailLines = std::max<std::size_t>(maxLines_ / 2, 1);
+
+   // the head is fixed the first time we elide, and always ends with a
+   // complete line
+   if (headEnd_ == std::string::npos)
+   {
+      headEnd_ = 0;
+      std::size_t headLines = 0;
+      for (std::size_t i = 0; i < text_.size() && i < maxHeadBytes; i++)
+      {
+         if (text_[i] == '\n')
+         {
+            if (headLines == maxHeadLines)
+               break;
+            headLines++;
+            headEnd_ = i + 1;
+         }
+      }
+   }
+
+   // find the start of the tail, preferring to start it at the beginning of
+   // a line (unless the tail is a single very long line)
+   std::size_t minTailStart = std::max(
+            headEnd_,
+            text_.size() > maxTailBytes ? text_.size() - maxTailBytes : 0);
+   std::size_t tailStart = text_.size();
+   std::size_t tailLines = 0;
+   for (std::size_t i = text_.size(); i > minTailStart; i--)
+   {
+      if (text_[i - 1] == '\n')
+      {
+         if (tailLines == maxTailLines)
+            break;
+         tailStart = i;
+         tailLines++;
+      }
+   }
+   if (tailStart == text_.size())
+      tailStart = minTailStart;
+
+   if (tailStart <= headEnd_)
+      return;
+
+   // drop the middle
+   std::size_t omitted = std::count(text_.begin() + headEnd_,
+                                    text_.begin() + tailStart,
+                                    '\n');
+   text_.erase(headEnd_, tailStart - headEnd_);
+   lines_ -= omitted;
+   omittedLines_ += std::max<std::size_t>(omitted, 1);
 }
 
 void initializeClientEventQueue()
@@ -49,7 +164,11 @@ ClientEventQueue& clientEventQueue()
 ClientEventQueue::ClientEventQueue()
    :  pMutex_(new boost::mutex()),
       pWaitForEventCondition_(new boost::condition()),
-      lastEventAddTime_(boost::posix_time::not_a_date_time)
+      pendingConsoleOutput_(kMaxConsoleOutputBytes, maxConsoleOutputLines()),
+      pendingConsoleOutputType_(client_events::kConsoleWriteOutput),
+      lastEventAddTime_(boost::posix_time::not_a_date_time),
+      queuedConsoleBytes_(0),
+      droppedConsoleLines_(0)
 {
 }
 
@@ -65,6 +184,7 @@ bool ClientEventQueue::setActiveConsole(const std::string& console)
          
          // switch to the new one
          activeConsole_ = console;
+         droppedConsoleLines_ = 0;
          changed = true;
       }
    }
@@ -92,13 +212,12 @@ void ClientEventQueue::add(const ClientEvent& event)
       if (event.type() == client_events::kConsoleWriteOutput)
       {
          if (event.data().getType() == json::Type::STRING)
-            pendingConsoleOutput_ += event.data().getString();
+            addConsoleOutput(event.type(), event.data().getString());
       }
       else if (event.type() == client_events::kConsoleWriteError &&
                event.data().getType() == json::Type::STRING)
       {
-         flushPendingConsoleOutput();
-         enqueueClientOutputEvent(event.type(), event.data().getString());
+         addConsoleOutput(event.type(), event.data().getString());
       }
       else
       {
@@ -108,6 +227,7 @@ void ClientEventQueue::add(const ClientEvent& event)
          
          // add event to queue
          pendingEvents_.push_back(event);
+         droppedConsoleLines_ = 0;
       }
       
       lastEventAddTime_ = boost::posix_time::microsec_clock::universal_time();
@@ -122,7 +242,7 @@ bool ClientEventQueue::hasEvents()
 {
    LOCK_MUTEX(*pMutex_)
    {
-      return pendingEvents_.size() > 0 || pendingConsoleOutput_.length() > 0;
+      return pendingEvents_.size() > 0 || !pendingConsoleOutput_.empty();
    }
    END_LOCK_MUTEX
    
@@ -134,8 +254,9 @@ void ClientEventQueue::remove(std::vector<ClientEvent>* pEvents)
 {
    LOCK_MUTEX(*pMutex_)
    {
-      // flush any pending output
-      flushPendingConsoleOutput();
+      // flush any pending output (including output waiting for the client
+      // to catch up)
+      flushPendingConsoleOutput(true);
       
       // copy the events to the caller
       pEvents->insert(pEvents->begin(), 
@@ -144,6 +265,8 @@ void ClientEventQueue::remove(std::vector<ClientEvent>* pEvents)
    
       // clear pending events
       pendingEvents_.clear();
+      queuedConsoleBytes_ = 0;
+      droppedConsoleLines_ = 0;
    }
    END_LOCK_MUTEX
 }
@@ -154,6 +277,8 @@ void ClientEventQueue::clear()
    {
       pendingConsoleOutput_.clear();
       pendingEvents_.clear();
+      queuedConsoleBytes_ = 0;
+      droppedConsoleLines_ = 0;
    }
    END_LOCK_MUTEX
 }
@@ -193,24 +318,70 @@ bool ClientEventQueue::eventAddedSince(const boost::posix_time::ptime& time)
    // keep compiler happy
    return false;
 }
-   
 
-void ClientEventQueue::flushPendingConsoleOutput()
+void ClientEventQueue::addConsoleOutput(int event, const std::string& text)
+{
+   // NOTE: private helper so no lock required (mutex is not recursive)
+
+   // adjacent output of the same type is coalesced into a single event
+   if (event != pendingConsoleOutputType_)
+   {
+      flushPendingConsoleOutput();
+      pendingConsoleOutputType_ = event;
+   }
+
+   // If there's more console output than the client can even show, then
+   // the middle of it is elided. Too much output can overwhelm the client,
+   // causing it to become unresponsive.
+   pendingConsoleOutput_.setMaxLines(maxConsoleOutputLines());
+   pendingConsoleOutput_.append(text);
+}
+
+void ClientEventQueue::flushPendingConsoleOutput(bool force)
 {
    // NOTE: private helper so no lock required (mutex is not recursive) 
-   
-   if ( !pendingConsoleOutput_.empty() )
+
+   // if the client hasn't yet collected the output already queued then
+   // drop this output rather than let the queue grow, queueing just a
+   // marker in its place (consecutive drops share a single marker)
+   if (!force &&
+       queuedConsoleBytes_ + pendingConsoleOutput_.size() > kMaxConsoleOutputBytes)
    {
-      // If there's more console output than the client can even show, then
-      // truncate it to the amount that the client can show. Too much output
-      // can overwhelm the client, causing it to become unresponsive.
-      int limit = r::session::consoleActions().capacity() + 1;
-      string_utils::trimLeadingLines(limit, &pendingConsoleOutput_);
-
-      enqueueClientOutputEvent(client_events::kConsoleWriteOutput, 
-            pendingConsoleOutput_);
+      std::size_t lines = pendingConsoleOutput_.lines() +
+                          pendingConsoleOutput_.omittedLines();
+      if (!pendingConsoleOutput_.empty())
+         lines = std::max<std::size_t>(lines, 1);
       pendingConsoleOutput_.clear();
+      if (lines == 0)
+         return;
+
+      LOG_DEBUG_MESSAGE("Dropped " + safe_convert::numberToString(lines) +
+                        " lines of console output not yet collected by the client");
+
+      if (droppedConsoleLines_ > 0 &&
+          pendingEvents_.back().type() == pendingConsoleOutputType_)
+      {
+         pendingEvents_.pop_back();
+         lines += droppedConsoleLines_;
+      }
+      enqueueClientOutputEvent(pendingConsoleOutputType_, omittedLinesMarker(lines));
+      droppedConsoleLines_ = lines;
+      return;
    }
+
+   if (pendingConsoleOutput_.empty())
+      return;
+
+   if (pendingConsoleOutput_.omittedLines() > 0)
+   {
+      LOG_DEBUG_MESSAGE("Omitted " +
+                        safe_convert::numberToString(pendingConsoleOutput_.omittedLines()) +
+                        " lines from the middle of console output");
+   }
+
+   std::string text = pendingConsoleOutput_.take();
+   queuedConsoleBytes_ += text.size();
+   enqueueClientOutputEvent(pendingConsoleOutputType_, text);
 }
 
 void ClientEventQueue::enqueueClientOutputEvent(
@@ -220,6 +391,7 @@ void ClientEventQueue::enqueueClientOutputEvent(
    output[kConsoleText] = text;
    output[kConsoleId]   = activeConsole_;
    pendingEvents_.push_back(ClientEvent(event, output));
+   droppedConsoleLines_ = 0;
 }
 
 } // namespace session
@@ -30,6 +30,45 @@
 namespace rstudio {
 namespace session {
    
+// Accumulates console output of a single type between flushes. Once the
+// output exceeds the byte or line limit, the middle of it is dropped: the
+// first part (head) and the most recent output (tail) are kept, and a marker
+// reporting the number of omitted lines is inserted between them.
+class ConsoleOutputBuffer
+{
+public:
+   ConsoleOutputBuffer(std::size_t maxBytes, std::size_t maxLines);
+
+   void append(const std::string& text);
+
+   // take the buffered output (including any omitted lines marker) and reset
+   std::string take();
+
+   void clear();
+
+   bool empty() const { return text_.empty() && omittedLines_ == 0; }
+   std::size_t size() const { return text_.size(); }
+   std::size_t lines() const { return lines_; }
+
+   // number of lines dropped from the current contents
+   std::size_t omittedLines() const { return omittedLines_; }
+
+   void setMaxLines(std::size_t maxLines) { maxLines_ = maxLines; }
+
+private:
+   void elide();
+
+   std::size_t maxBytes_;
+   std::size_t maxLines_;
+
+   std::string text_;
+   std::size_t lines_;
+
+   // end of the head within text_ (where the marker goes) once eliding
+   std::size_t headEnd_;
+   std::size_t omittedLines_;
+};
+
 // initialization
 void initializeClientEventQueue();
 
@@ -69,7 +108,8 @@ public:
    bool setActiveConsole(const std::string& console);
       
 private:   
-   void flushPendingConsoleOutput();
+   void addConsoleOutput(int event, const std::string& text);
+   void flushPendingConsoleOutput(bool force = false);
 
    void enqueueClientOutputEvent(int event, const std::string& text);
  
@@ -83,10 +123,16 @@ private:
    boost::condition* pWaitForEventCondition_;
 
    // instance data
-   std::string pendingConsoleOutput_;
+   ConsoleOutputBuffer pendingConsoleOutput_;
+   int pendingConsoleOutputType_;
    std::string activeConsole_;
    std::vector<ClientEvent> pendingEvents_;
    boost::posix_time::ptime lastEventAddTime_;
+
+   // console output already in pendingEvents_, and the number of lines
+   // reported by the dropped output marker when it is the last pending event
+   std::size_t queuedConsoleBytes_;
+   std::size_t droppedConsoleLines_;
    
 
 };
@@ -0,0 +1,95 @@
+/*
+ * SessionClientEventQueueTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "SessionClientEventQueue.hpp"
+
+#include <tests/TestThat.hpp>
+
+#include <shared_core/SafeConvert.hpp>
+
+namespace rstudio {
+namespace session {
+namespace tests {
+
+namespace {
+
+std::string numberedLines(int from, int to)
+{
+   std::string lines;
+   for (int i = from; i <= to; i++)
+      lines += core::safe_convert::numberToString(i) + "\n";
+   return lines;
+}
+
+} // anonymous namespace
+
+test_context("Console output buffering")
+{
+   test_that("Output within the limits is passed through unchanged")
+   {
+      ConsoleOutputBuffer buffer(1024, 100);
+      buffer.append("hello ");
+      buffer.append("world\n");
+      expect_true(buffer.omittedLines() == 0);
+      expect_true(buffer.take() == "hello world\n");
+      expect_true(buffer.empty());
+   }
+
+   test_that("Excess lines are elided from the middle")
+   {
+      ConsoleOutputBuffer buffer(1024 * 1024, 100);
+      for (int i = 1; i <= 1000; i++)
+         buffer.append(numberedLines(i, i));
+
+      // head is kept from the first elision, tail holds the latest output
+      std::string text = buffer.take();
+      expect_true(text.find(numberedLines(1, 25)) == 0);
+      expect_true(text.find(numberedLines(951, 1000)) != std::string::npos);
+      expect_true(text.find("[ ... ") != std::string::npos);
+      expect_true(text.find("\n26\n") == std::string::npos);
+
+      // the marker accounts for every line that was dropped
+      std::size_t markerPos = text.find("[ ... ");
+      std::size_t omitted = core::safe_convert::stringTo<std::size_t>(
+               text.substr(markerPos + 6, text.find(' ', markerPos + 6) - markerPos - 6), 0);
+      std::size_t kept = std::count(text.begin(), text.end(), '\n') - 1;
+      expect_true(omitted + kept == 1000);
+   }
+
+   test_that("Output is bounded by bytes")
+   {
+      ConsoleOutputBuffer buffer(4096, 1000000);
+      std::string line(99, 'x');
+      line += "\n";
+      for (int i = 0; i < 10000; i++)
+      {
+         buffer.append(line);
+         expect_true(buffer.size() <= 4096);
+      }
+      expect_true(buffer.omittedLines() > 0);
+   }
+
+   test_that("A single long line is truncated")
+   {
+      ConsoleOutputBuffer buffer(1000, 100);
+      buffer.append(std::string(5000, 'x'));
+      expect_true(buffer.size() <= 1000);
+      expect_true(buffer.omittedLines() == 1);
+   }
+}
+
+} // namespace tests
+} // namespace session
+} // namespace rstudio
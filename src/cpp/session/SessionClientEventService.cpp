@@ -28,9 +28,12 @@
 
 #include <core/http/Request.hpp>
 
+#include <shared_core/SafeConvert.hpp>
+
 #include <session/SessionOptions.hpp>
 #include <session/SessionHttpConnectionListener.hpp>
 #include <session/SessionClientEventService.hpp>
+#include <session/SessionConsoleProcessSocket.hpp>
 
 #include "SessionClientEventQueue.hpp"
 
@@ -44,6 +47,11 @@ namespace {
 
 const int kLastChanceWaitSeconds = 4;
 
+// maximum number of events pushed to the client over the websocket channel
+// without being acknowledged; once reached we stop pushing (leaving events in
+// the queue, where they can be coalesced) until the client catches up
+const std::size_t kMaxUnacknowledgedEvents = 500;
+
 bool hasEventIdLessThanOrEqualTo(const json::Value& event, int targetId)
 {
    const json::Object& eventJSON = event.getObject();
@@ -53,14 +61,117 @@ bool hasEventIdLessThanOrEqualTo(const json::Value& event, int targetId)
          
 } // anonymous namespace
 
+ClientEventBuffer::ClientEventBuffer(std::size_t maxUnacknowledgedPushEvents) :
+   nextEventId_(0),
+   maxUnacknowledgedPushEvents_(maxUnacknowledgedPushEvents),
+   pushReady_(false)
+{
+}
+
+void ClientEventBuffer::add(const std::vector<ClientEvent>& events,
+                            json::Array* pAdded)
+{
+   for (const ClientEvent& clientEvent : events)
+   {
+      json::Object event;
+      clientEvent.asJsonObject(nextEventId_++, &event);
+      if (pAdded)
+         pAdded->push_back(event);
+      events_.push_back(std::move(event));
+   }
+}
+
+void ClientEventBuffer::acknowledge(int lastClientEventIdSeen)
+{
+   events_.erase(
+            std::remove_if(events_.begin(),
+                           events_.end(),
+                           boost::bind(hasEventIdLessThanOrEqualTo,
+                                       _1,
+                                       lastClientEventIdSeen)),
+            events_.end());
+
+   nextEventId_ = std::max(nextEventId_, lastClientEventIdSeen + 1);
+}
+
+void ClientEventBuffer::clear()
+{
+   events_.clear();
+}
+
+void ClientEventBuffer::openPushChannel(const std::string& clientId)
+{
+   pushClientId_ = clientId;
+   pushReady_ = false;
+}
+
+void ClientEventBuffer::closePushChannel(const std::string& clientId)
+{
+   if (pushClientId_ != clientId)
+      return;
+
+   pushClientId_.clear();
+   pushReady_ = false;
+}
+
+bool ClientEventBuffer::acknowledgePush(const std::string& clientId,
+                                        int lastClientEventIdSeen,
+                                        json::Array* pResendEvents)
+{
+   if (clientId.empty() || pushClientId_ != clientId)
+      return false;
+
+   if (lastClientEventIdSeen >= 0)
+      acknowledge(lastClientEventIdSeen);
+
+   // anything not yet acknowledged may have been lost along with a previous
+   // connection (or be sitting in an abandoned long-poll response), so send
+   // it again once the connection is ready; the client skips events it has
+   // already seen by id
+   if (!pushReady_)
+   {
+      pushReady_ = true;
+      *pResendEvents = events_;
+   }
+
+   return true;
+}
+
+bool ClientEventBuffer::canPush(const std::string& clientId) const
+{
+   return pushReady_ &&
+          !clientId.empty() &&
+          pushClientId_ == clientId &&
+          events_.getSize() < maxUnacknowledgedPushEvents_;
+}
+
+std::string ClientEventBuffer::pushClientId() const
+{
+   return pushReady_ ? pushClientId_ : std::string();
+}
+
 ClientEventService& clientEventService()
 {
    static ClientEventService instance;
    return instance;
 }
 
+ClientEventService::ClientEventService() :
+   clientEvents_(kMaxUnacknowledgedEvents)
+{
+}
+
 Error ClientEventService::start(const std::string& clientId)
 {
+   // start the websocket push channel if requested; long-polling remains
+   // available regardless so failure here isn't fatal
+   if (options().webSocketClientEvents())
+   {
+      Error error = startPushChannel();
+      if (error)
+         LOG_ERROR(error);
+   }
+
    // set our clientid
    setClientId(clientId, false);
    
@@ -77,6 +188,12 @@ Error ClientEventService::start(const std::string& clientId)
       using boost::bind;
       boost::thread serviceThread(bind(&ClientEventService::run, this));
       serviceThread_ = MOVE_THREAD(serviceThread);
+
+      if (pPushSocket_)
+      {
+         boost::thread pushThread(bind(&ClientEventService::runPushChannel, this));
+         pushThread_ = MOVE_THREAD(pushThread);
+      }
       
       return Success();
    }
@@ -103,6 +220,17 @@ void ClientEventService::stop()
 
          serviceThread_.detach();
       }
+
+      if (pushThread_.joinable())
+      {
+         pushThread_.interrupt();
+         if (!pushThread_.timed_join(boost::posix_time::seconds(1)))
+            LOG_WARNING_MESSAGE("ClientEventService push channel didn't stop on its own");
+         pushThread_.detach();
+      }
+
+      if (pPushSocket_)
+         pPushSocket_->stopServer();
    }
    catch(const boost::thread_interrupted&)
    {
@@ -114,8 +242,10 @@ void ClientEventService::stop()
    
 void ClientEventService::setClientId(const std::string& clientId, bool clearEvents)
 {
+   std::string previousClientId;
    LOCK_MUTEX(mutex_)
    {
+      previousClientId = clientId_.c_str(); // avoid ref count
       clientId_ = clientId.c_str(); // avoid ref count
       if (clearEvents)
          clientEvents_.clear();
@@ -124,6 +254,25 @@ void ClientEventService::setClientId(const std::string& clientId, bool clearEven
 
    if (clearEvents)
       clientEventQueue().clear();
+
+   // the push channel is keyed by client id, so follow the active client
+   if (pPushSocket_ && previousClientId != clientId)
+   {
+      if (!previousClientId.empty())
+         pPushSocket_->stopListening(previousClientId);
+
+      using namespace console_process;
+      ConsoleProcessSocketConnectionCallbacks callbacks;
+      callbacks.onConnectionOpened =
+            boost::bind(&ClientEventService::onPushChannelOpened, this, clientId);
+      callbacks.onConnectionClosed =
+            boost::bind(&ClientEventService::onPushChannelClosed, this, clientId);
+      callbacks.onReceivedInput =
+            boost::bind(&ClientEventService::onPushChannelInput, this, clientId, _1);
+      Error error = pPushSocket_->listen(clientId, callbacks);
+      if (error)
+         LOG_ERROR(error);
+   }
 }
    
 std::string ClientEventService::clientId()
@@ -138,26 +287,25 @@ std::string ClientEventService::clientId()
    return std::string();
 }
 
-void ClientEventService::erasePreviouslyDeliveredEvents(int lastClientEventIdSeen)
+int ClientEventService::pushChannelPort()
+{
+   return pPushSocket_ ? pPushSocket_->port() : 0;
+}
+
+void ClientEventService::acknowledgeClientEvents(int lastClientEventIdSeen)
 {
    LOCK_MUTEX(mutex_)
    {
-      clientEvents_.erase(
-               std::remove_if(clientEvents_.begin(),
-                              clientEvents_.end(),
-                              boost::bind(hasEventIdLessThanOrEqualTo,
-                                          _1,
-                                          lastClientEventIdSeen)),
-               clientEvents_.end());
+      clientEvents_.acknowledge(lastClientEventIdSeen);
    }
    END_LOCK_MUTEX
 }
 
-bool ClientEventService::havePendingClientEvents()
+bool ClientEventService::isPushingTo(const std::string& clientId)
 {
    LOCK_MUTEX(mutex_)
    {
-      return !clientEvents_.isEmpty();
+      return !clientId.empty() && clientEvents_.pushClientId() == clientId;
    }
    END_LOCK_MUTEX
 
@@ -165,13 +313,39 @@ bool ClientEventService::havePendingClientEvents()
    return false;
 }
 
-void ClientEventService::addClientEvent(const json::Object& eventObject)
+bool ClientEventService::waitForPolledEvent(
+                                 const std::string& clientId,
+                                 const boost::posix_time::time_duration& maxWait)
+{
+   // the client stops polling once its events are pushed, so give up
+   // waiting then (rather than holding on to events the push channel
+   // should deliver)
+   using namespace boost::posix_time;
+   boost::system_time stopTime = boost::get_system_time() + maxWait;
+   while (boost::get_system_time() < stopTime)
+   {
+      time_duration wait = std::min<time_duration>(
+               seconds(1), stopTime - boost::get_system_time());
+      if (clientEventQueue().waitForEvent(wait))
+         return true;
+
+      if (isPushingTo(clientId))
+         return false;
+   }
+
+   return false;
+}
+
+bool ClientEventService::havePendingClientEvents()
 {
    LOCK_MUTEX(mutex_)
    {
-      clientEvents_.push_back(eventObject);
+      return !clientEvents_.empty();
    }
    END_LOCK_MUTEX
+
+   // keep compiler happy
+   return false;
 }
 
 void ClientEventService::setClientEventResult(
@@ -179,11 +353,115 @@ void ClientEventService::setClientEventResult(
 {
    LOCK_MUTEX(mutex_)
    {
-      pResponse->setResult(clientEvents_);
+      pResponse->setResult(clientEvents_.events());
    }
    END_LOCK_MUTEX
 }
 
+void ClientEventService::dequeueClientEvents(json::Array* pNewEvents)
+{
+   // deque the events
+   std::vector<ClientEvent> events;
+   clientEventQueue().remove(&events);
+
+   // convert to json and add event id (ids are shared by the long-poll and
+   // push channels so assign them under the same lock as clientEvents_)
+   LOCK_MUTEX(mutex_)
+   {
+      clientEvents_.add(events, pNewEvents);
+   }
+   END_LOCK_MUTEX
+}
+
+Error ClientEventService::startPushChannel()
+{
+   pPushSocket_.reset(new console_process::ConsoleProcessSocket());
+   Error error = pPushSocket_->ensureServerRunning();
+   if (error)
+   {
+      pPushSocket_.reset();
+      return error;
+   }
+
+   // connections are accepted once setClientId listens for the client
+   return Success();
+}
+
+void ClientEventService::onPushChannelOpened(const std::string& clientId)
+{
+   // NOTE: websocket callbacks are invoked on the websocket thread; nothing
+   // is pushed until the client's first acknowledgement syncs event ids
+   LOCK_MUTEX(mutex_)
+   {
+      if (clientId == clientId_)
+         clientEvents_.openPushChannel(clientId);
+   }
+   END_LOCK_MUTEX
+}
+
+void ClientEventService::onPushChannelClosed(const std::string& clientId)
+{
+   LOCK_MUTEX(mutex_)
+   {
+      clientEvents_.closePushChannel(clientId);
+   }
+   END_LOCK_MUTEX
+}
+
+void ClientEventService::onPushChannelInput(const std::string& clientId,
+                                            const std::string& input)
+{
+   // the client acknowledges receipt by sending the last event id it has seen
+   // (-1 if it has seen none)
+   int lastClientEventIdSeen = safe_convert::stringTo<int>(input, -1);
+
+   bool acknowledged = false;
+   bool becameReady = false;
+   json::Array resendEvents;
+   LOCK_MUTEX(mutex_)
+   {
+      if (clientId == clientId_)
+      {
+         bool wasReady = !clientEvents_.pushClientId().empty();
+         acknowledged = clientEvents_.acknowledgePush(clientId,
+                                                      lastClientEventIdSeen,
+                                                      &resendEvents);
+         becameReady = acknowledged && !wasReady;
+      }
+   }
+   END_LOCK_MUTEX
+
+   if (!acknowledged)
+      return;
+
+   // the first push (even of no events) tells the client that the channel
+   // is ready, at which point it stops long-polling
+   if (becameReady || !resendEvents.isEmpty())
+      pushClientEvents(resendEvents);
+
+   // acknowledgement may have re-opened the window
+   pushCondition_.notify_all();
+}
+
+void ClientEventService::pushClientEvents(const json::Array& events)
+{
+   std::string pushClientId;
+   LOCK_MUTEX(mutex_)
+   {
+      pushClientId = clientEvents_.pushClientId();
+   }
+   END_LOCK_MUTEX
+
+   if (pushClientId.empty())
+      return;
+
+   // on failure the events remain unacknowledged, and are delivered again
+   // when the client reconnects or falls back to get_events
+   Error error = pPushSocket_->sendText(pushClientId, events.write());
+   if (error)
+      LOG_DEBUG_MESSAGE("Unable to push client events: " + error.getSummary());
+}
+
 
 void ClientEventService::run()
 {
@@ -205,9 +483,6 @@ void ClientEventService::run()
       // get alias to client event queue
       ClientEventQueue& clientEventQueue = session::clientEventQueue();
       
-      // initialize state
-      int nextEventId = 0;
-      
       // accept loop
       bool stopServer = false;
       while (!stopServer || clientEventQueue.hasEvents())
@@ -277,20 +552,21 @@ void ClientEventService::run()
          }
            
          // remove all events already seen by the client from our internal list
-         erasePreviouslyDeliveredEvents(lastClientEventIdSeen);
-
-         // sync next event id to client (required so that when we resume
+         // and sync next event id to client (required so that when we resume
          // from a suspend we provide client event ids in line with the 
          // client's expectations -- if we started with zero then the client
          // would never see any events!)
-         nextEventId = std::max(nextEventId, lastClientEventIdSeen + 1);
+         acknowledgeClientEvents(lastClientEventIdSeen);
 
-         // check for events (and wait a specified internal if there are none)
+         // check for events (and wait a specified internal if there are none);
+         // a poll from a client whose events are pushed (e.g. one sent just
+         // before the push channel became ready) is answered immediately
          try
          {
             // wait for the specified maximum time
-            if (havePendingClientEvents() || clientEventQueue.hasEvents() ||
-                clientEventQueue.waitForEvent(maxRequestSec))
+            if (!isPushingTo(request.clientId) &&
+                (havePendingClientEvents() || clientEventQueue.hasEvents() ||
+                 waitForPolledEvent(request.clientId, maxRequestSec)))
             {
                // ...got at least one event
                
@@ -321,17 +597,14 @@ void ClientEventService::run()
          // events on the next iteration of the accept loop
          if (request.clientId == clientId())
          {
-            // deque the events
-            std::vector<ClientEvent> events;
-            clientEventQueue.remove(&events);
-            
-            // convert to json and add event id
-            for (std::vector<ClientEvent>::const_iterator 
-                 it = events.begin(); it != events.end(); ++it)
+            // deque the events (leaving them for the push channel if it's
+            // ready, and pushing them if it became ready meanwhile)
+            if (!isPushingTo(request.clientId))
             {
-               json::Object event;
-               it->asJsonObject(nextEventId++, &event);
-               addClientEvent(event);
+               json::Array newEvents;
+               dequeueClientEvents(&newEvents);
+               if (!newEvents.isEmpty())
+                  pushClientEvents(newEvents);
             }
 
             // send them (pass false for kEventsPending b/c responses from the
@@ -351,6 +624,68 @@ void ClientEventService::run()
    }
    CATCH_UNEXPECTED_EXCEPTION
 }
+
+// Pushes events to a client connected over the websocket channel as soon as
+// they are enqueued (after the same short batching delay used for long-poll
+// responses). The client acknowledges the last event id it has processed;
+// pushing pauses while kMaxUnacknowledgedEvents are outstanding so a slow
+// client can't cause unbounded buffering in the websocket.
+void ClientEventService::runPushChannel()
+{
+   try
+   {
+      using namespace boost::posix_time;
+      time_duration batchDelay = milliseconds(20);
+      time_duration maxTotalBatchDelay = milliseconds(200);
+      if (options().programMode() == kSessionProgramModeDesktop)
+      {
+         batchDelay = milliseconds(2);
+         maxTotalBatchDelay = milliseconds(10);
+      }
+
+      ClientEventQueue& clientEventQueue = session::clientEventQueue();
+
+      while (true)
+      {
+         // wait for a connected client with room in its window
+         bool canPush = false;
+         {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            canPush = clientEvents_.canPush(clientId_);
+            if (!canPush)
+               pushCondition_.timed_wait(lock, seconds(1));
+         }
+
+         if (!canPush)
+            continue;
+
+         // wait for events
+         if (!clientEventQueue.hasEvents() &&
+             !clientEventQueue.waitForEvent(seconds(1)))
+         {
+            boost::this_thread::interruption_point();
+            continue;
+         }
+
+         // collect events that occur in rapid succession
+         boost::system_time maxBatchDelayTime =
+               boost::get_system_time() + maxTotalBatchDelay;
+         while (clientEventQueue.waitForEvent(batchDelay) &&
+                (boost::get_system_time() < maxBatchDelayTime))
+         {
+         }
+
+         json::Array events;
+         dequeueClientEvents(&events);
+         if (!events.isEmpty())
+            pushClientEvents(events);
+      }
+   }
+   catch(const boost::thread_interrupted&)
+   {
+   }
+   CATCH_UNEXPECTED_EXCEPTION
+}
       
 } // namespace session
 } // namespace rstudio
@@ -0,0 +1,166 @@
+/*
+ * SessionClientEventServiceTests.cpp
+ *
+ * Copyright (C) 2026 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <session/SessionClientEventService.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace session {
+namespace tests {
+
+using namespace rstudio::core;
+
+namespace {
+
+const std::string kClientId("client");
+
+std::vector<ClientEvent> consoleOutput(int count)
+{
+   std::vector<ClientEvent> events;
+   for (int i = 0; i < count; i++)
+      events.push_back(ClientEvent(client_events::kConsoleWriteOutput, "output\n"));
+   return events;
+}
+
+int eventId(const json::Array& events, std::size_t index)
+{
+   json::Object event = events[index].getObject();
+   return event["id"].getInt();
+}
+
+} // anonymous namespace
+
+test_context("Client event buffer")
+{
+   test_that("Events are buffered until acknowledged")
+   {
+      ClientEventBuffer buffer(500);
+      buffer.add(consoleOutput(3));
+      expect_true(buffer.events().getSize() == 3);
+      expect_true(eventId(buffer.events(), 0) == 0);
+      expect_true(eventId(buffer.events(), 2) == 2);
+
+      buffer.acknowledge(1);
+      expect_true(buffer.events().getSize() == 1);
+      expect_true(eventId(buffer.events(), 0) == 2);
+
+      buffer.acknowledge(2);
+      expect_true(buffer.empty());
+   }
+
+   test_that("Event ids continue from the client's")
+   {
+      // e.g. after resuming from suspend
+      ClientEventBuffer buffer(500);
+      buffer.acknowledge(41);
+      buffer.add(consoleOutput(1));
+      expect_true(eventId(buffer.events(), 0) == 42);
+   }
+
+   test_that("Events are pushed once the client acknowledges the connection")
+   {
+      ClientEventBuffer buffer(500);
+      buffer.openPushChannel(kClientId);
+      expect_false(buffer.canPush(kClientId));
+      expect_true(buffer.pushClientId().empty());
+
+      // the first acknowledgement syncs ids with the client
+      json::Array resend;
+      expect_true(buffer.acknowledgePush(kClientId, 9, &resend));
+      expect_true(resend.isEmpty());
+      expect_true(buffer.canPush(kClientId));
+      expect_true(buffer.pushClientId() == kClientId);
+
+      json::Array pushed;
+      buffer.add(consoleOutput(2), &pushed);
+      expect_true(pushed.getSize() == 2);
+      expect_true(eventId(pushed, 0) == 10);
+      expect_true(pushed == buffer.events());
+
+      // acknowledging pushed events drops them
+      expect_true(buffer.acknowledgePush(kClientId, 11, &resend));
+      expect_true(resend.isEmpty());
+      expect_true(buffer.empty());
+   }
+
+   test_that("Only the active client's connection is used")
+   {
+      ClientEventBuffer buffer(500);
+      buffer.openPushChannel(kClientId);
+
+      json::Array resend;
+      expect_false(buffer.acknowledgePush("other", 0, &resend));
+      expect_false(buffer.canPush("other"));
+      expect_false(buffer.canPush(kClientId));
+
+      buffer.closePushChannel("other");
+      expect_true(buffer.acknowledgePush(kClientId, -1, &resend));
+      expect_true(buffer.canPush(kClientId));
+
+      buffer.closePushChannel(kClientId);
+      expect_false(buffer.canPush(kClientId));
+      expect_true(buffer.pushClientId().empty());
+   }
+
+   test_that("Pushing pauses while too many events are unacknowledged")
+   {
+      ClientEventBuffer buffer(5);
+      buffer.openPushChannel(kClientId);
+
+      json::Array resend;
+      buffer.acknowledgePush(kClientId, -1, &resend);
+
+      buffer.add(consoleOutput(4));
+      expect_true(buffer.canPush(kClientId));
+      buffer.add(consoleOutput(1));
+      expect_false(buffer.canPush(kClientId));
+
+      // events still reach the buffer (and long-polling) while paused
+      buffer.add(consoleOutput(3));
+      expect_true(buffer.events().getSize() == 8);
+      expect_false(buffer.canPush(kClientId));
+
+      // acknowledgement re-opens the window
+      expect_true(buffer.acknowledgePush(kClientId, 5, &resend));
+      expect_true(resend.isEmpty());
+      expect_true(buffer.canPush(kClientId));
+   }
+
+   test_that("Unacknowledged events are resent on reconnect")
+   {
+      ClientEventBuffer buffer(500);
+      buffer.openPushChannel(kClientId);
+
+      json::Array resend;
+      buffer.acknowledgePush(kClientId, -1, &resend);
+      buffer.add(consoleOutput(3));
+      buffer.acknowledgePush(kClientId, 0, &resend);
+      expect_true(resend.isEmpty());
+
+      buffer.closePushChannel(kClientId);
+      buffer.openPushChannel(kClientId);
+      expect_false(buffer.canPush(kClientId));
+
+      expect_true(buffer.acknowledgePush(kClientId, 0, &resend));
+      expect_true(resend.getSize() == 2);
+      expect_true(eventId(resend, 0) == 1);
+      expect_true(eventId(resend, 1) == 2);
+   }
+}
+
+} // namespace tests
+} // namespace session
+} // namespace rstudio
@@ -61,6 +61,7 @@
 #include <core/http/Cookie.hpp>
 #include <core/http/CSRFToken.hpp>
 #include <core/system/Environment.hpp>
+#include <shared_core/SafeConvert.hpp>
 
 #include <session/SessionConsoleProcess.hpp>
 #include <session/SessionClientEventService.hpp>
@@ -490,6 +491,12 @@ void handleClientInit(const boost::function<void()>& initFunction,
    sessionInfo["websocket_ping_interval"] = options.webSocketPingInterval();
    sessionInfo["websocket_connect_timeout"] = options.webSocketConnectTimeout();
 
+   // the port of the websocket which pushes client events (empty when
+   // disabled); obscured in server mode below
+   int clientEventsPort = clientEventService().pushChannelPort();
+   sessionInfo["client_events_port"] = clientEventsPort > 0 ?
+         safe_convert::numberToString(clientEventsPort) : std::string();
+
    // publishing may be disabled globally or just for external services, and
    // via configuration options or environment variables
    bool allowPublish = options.allowPublish() &&
@@ -622,15 +629,7 @@ void handleClientInit(const boost::function<void()>& initFunction,
 
    module_context::events().onSessionInfo(&sessionInfo);
 
-   // create response  (we always set kEventsPending to false so that the client
-   // won't poll for events until it is ready)
-   json::JsonRpcResponse jsonRpcResponse;
-   jsonRpcResponse.setField(kEventsPending, "false");
-   jsonRpcResponse.setResult(sessionInfo);
-
-   // set response
    core::http::Response response;
-   core::json::setJsonRpcResponse(jsonRpcResponse, &response);
 
 #ifdef RSTUDIO_SERVER
    if (options.programMode() == kSessionProgramModeServer)
@@ -640,9 +639,27 @@ void handleClientInit(const boost::function<void()>& initFunction,
       {
          LOG_ERROR(error);
       }
+
+      // in server mode the client connects to the push channel via the /p
+      // proxy, which expects a form of the port obscured with the (new) port
+      // token, as for terminal websockets
+      if (clientEventsPort > 0)
+      {
+         sessionInfo["client_events_port"] =
+               server_core::transformPort(persistentState().portToken(), clientEventsPort);
+      }
    }
 #endif
 
+   // create response  (we always set kEventsPending to false so that the client
+   // won't poll for events until it is ready)
+   json::JsonRpcResponse jsonRpcResponse;
+   jsonRpcResponse.setField(kEventsPending, "false");
+   jsonRpcResponse.setResult(sessionInfo);
+
+   // set response
+   core::json::setJsonRpcResponse(jsonRpcResponse, &response);
+
    ptrConnection->sendResponse(response);
 
    // complete initialization of session
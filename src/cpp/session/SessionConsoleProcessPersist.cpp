@@ -15,10 +15,15 @@
 
 #include <session/SessionConsoleProcessPersist.hpp>
 
+#include <map>
+
+#include <boost/shared_ptr.hpp>
+
 #include <gsl/gsl>
 
 #include <core/FileSerializer.hpp>
 
+#include <session/SessionConsoleProcessScrollback.hpp>
 #include <session/SessionModuleContext.hpp>
 #include <session/SessionOptions.hpp>
 #include <session/projects/SessionProjects.hpp>
@@ -54,7 +59,9 @@ namespace console_persist {
 // 2019/07/30 - console06 -> console07
 //                Changed shell type from int to string to align with user
 //                preferences
-#define kConsoleDir "console07"
+// 2026/10/17 - console07 -> console08
+//                Saved buffers split into indexed segments (see Scrollback)
+#define kConsoleDir "console08"
 
 namespace {
 
@@ -63,6 +70,9 @@ FilePath s_consoleProcIndexPath;
 bool s_inited = false;
 const std::string s_envFileExt = ".env";
 
+// saved buffers, by handle, loaded as they're used
+std::map<std::string, boost::shared_ptr<Scrollback> > s_scrollbacks;
+
 void initialize()
 {
    if (s_inited) return;
@@ -102,17 +112,29 @@ const FilePath& getConsoleProcIndexPath()
    return s_consoleProcIndexPath;
 }
 
-Error getLogFilePath(const std::string& handle, FilePath* pFile)
+Scrollback& getScrollback(const std::string& handle)
 {
-   initialize();
-   Error error = getConsoleProcPath().ensureDirectory();
-   if (error)
+   boost::shared_ptr<Scrollback>& pScrollback = s_scrollbacks[handle];
+   if (!pScrollback)
    {
-      return error;
+      Error error = getConsoleProcPath().ensureDirectory();
+      if (error)
+         LOG_ERROR(error);
+
+      pScrollback.reset(new Scrollback(getConsoleProcPath(), handle));
    }
+   return *pScrollback;
+}
 
-   *pFile = getConsoleProcPath().completePath(handle);
-   return Success();
+Scrollback& getTrimmedScrollback(const std::string& handle, int maxLines)
+{
+   // Trim the buffer based on maxLines. Otherwise it can grow without
+   // bound until the terminal is closed or cleared.
+   Scrollback& scrollback = getScrollback(handle);
+   Error error = scrollback.trim(maxLines);
+   if (error)
+      LOG_ERROR(error);
+   return scrollback;
 }
 
 Error getEnvFilePath(const std::string& handle, FilePath* pFile)
@@ -164,119 +186,55 @@ void saveConsoleProcesses(const std::string& metadata)
 std::string getSavedBuffer(const std::string& handle, int maxLines)
 {
    std::string content;
-   FilePath log;
-
-   Error error = getLogFilePath(handle, &log);
+   Error error = getTrimmedScrollback(handle, maxLines).readAll(&content);
    if (error)
-   {
       LOG_ERROR(error);
-      return content;
-   }
+   return content;
+}
 
-   if (!log.exists())
-   {
-      return "";
-   }
+std::string getSavedBufferChunk(const std::string& handle,
+                                int chunk,
+                                std::size_t chunkSize,
+                                int maxLines,
+                                bool* pMoreAvailable)
+{
+   Scrollback& scrollback = (chunk == 0) ?
+            getTrimmedScrollback(handle, maxLines) :
+            getScrollback(handle);
+
+   std::uint64_t offset = static_cast<std::uint64_t>(chunk) * chunkSize;
 
-   error = core::readStringFromFile(log, &content);
+   std::string content;
+   Error error = scrollback.read(offset, chunkSize, &content);
    if (error)
-   {
       LOG_ERROR(error);
-      return content;
-   }
-
-   if (maxLines < 1)
-      return content;
 
-   // Trim the buffer based on maxLines. Otherwise it can grow without
-   // bound until the terminal is closed or cleared.
-   std::string trimmedOutput = content;
-   if (string_utils::trimLeadingLines(maxLines, &trimmedOutput))
-   {
-      error = core::writeStringToFile(log, trimmedOutput);
-      if (error)
-      {
-          LOG_ERROR(error);
-          return content;
-      }
-   }
-   return trimmedOutput;
+   *pMoreAvailable = offset + content.length() < scrollback.size();
+   return content;
 }
 
 int getSavedBufferLineCount(const std::string& handle, int maxLines)
 {
-   std::string buffer = getSavedBuffer(handle, maxLines);
-   return gsl::narrow_cast<int>(string_utils::countNewlines(buffer) + 1);
+   Scrollback& scrollback = getTrimmedScrollback(handle, maxLines);
+   return gsl::narrow_cast<int>(scrollback.newlineCount() + 1);
 }
 
 void appendToOutputBuffer(const std::string& handle, const std::string& buffer)
 {
-   FilePath log;
-   Error error = getLogFilePath(handle, &log);
+   Error error = getScrollback(handle).append(buffer);
    if (error)
-   {
-      LOG_ERROR(error);
-      return;
-   }
-
-   error = rstudio::core::appendToFile(log, buffer);
-   if (error)
-   {
       LOG_ERROR(error);
-   }
 }
 
 void deleteLogFile(const std::string &handle, bool lastLineOnly)
 {
-   FilePath log;
-   Error error = getLogFilePath(handle, &log);
+   Scrollback& scrollback = getScrollback(handle);
+   Error error = lastLineOnly ? scrollback.removeLastLine() : scrollback.remove();
    if (error)
-   {
       LOG_ERROR(error);
-      return;
-   }
-
-   if (!log.exists())
-      return;
 
    if (!lastLineOnly)
-   {
-      // blow away the file
-      error = log.removeIfExists();
-      if (error)
-      {
-         LOG_ERROR(error);
-         return;
-      }
-   }
-   else
-   {
-      // read the file, remove last line and rewrite buffer
-      std::string content;
-      error = core::readStringFromFile(log, &content);
-      if (error)
-      {
-         LOG_ERROR(error);
-         return;
-      }
-
-      size_t lastNewline = content.find_last_of('\n');
-
-      // no complete line in buffer, just blow it away
-      if (lastNewline == std::string::npos)
-      {
-         deleteLogFile(handle, false);
-         return;
-      }
-
-      // erase everything after the final newline
-      content.erase(++lastNewline);
-      error = core::writeStringToFile(log, content);
-      if (error)
-      {
-          LOG_ERROR(error);
-      }
-   }
+      s_scrollbacks.erase(handle);
 }
 
 void deleteOrphanedLogs(bool (*validHandle)(const std::string&))
@@ -307,6 +265,15 @@ void deleteOrphanedLogs(bool (*validHandle)(const std::string&))
             LOG_ERROR(error);
       }
    }
+
+   // forget the buffers we just deleted
+   for (auto it = s_scrollbacks.begin(); it != s_scrollbacks.end(); )
+   {
+      if (!validHandle(it->first))
+         it = s_scrollbacks.erase(it);
+      else
+         ++it;
+   }
 }
 
 void saveConsoleEnvironment(const std::string& handle, const core::system::Options& environment)
@@ -0,0 +1,425 @@
+/*
+ * SessionConsoleProcessScrollback.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <session/SessionConsoleProcessScrollback.hpp>
+
+#include <algorithm>
+#include <sstream>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <shared_core/Error.hpp>
+#include <shared_core/SafeConvert.hpp>
+
+#include <core/FileSerializer.hpp>
+#include <core/Log.hpp>
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace console_process {
+
+namespace {
+
+Error indexError(const FilePath& indexPath)
+{
+   Error error = systemError(boost::system::errc::protocol_error,
+                             "Invalid terminal buffer index",
+                             ERROR_LOCATION);
+   error.addProperty("path", indexPath);
+   return error;
+}
+
+} // anonymous namespace
+
+Scrollback::Scrollback(const FilePath& directory,
+                       const std::string& handle,
+                       std::size_t segmentSize)
+   : directory_(directory),
+     handle_(handle),
+     segmentSize_(segmentSize),
+     loaded_(false),
+     start_(0),
+     skippedNewlines_(0),
+     newlines_(0)
+{
+}
+
+std::uint64_t Scrollback::size()
+{
+   load();
+   return segments_.back().offset + segments_.back().bytes - start_;
+}
+
+std::uint64_t Scrollback::newlineCount()
+{
+   load();
+   return newlines_ - skippedNewlines_;
+}
+
+Error Scrollback::append(const std::string& output)
+{
+   load();
+
+   // fill the segment being appended to, and once it's full, seal it (noting
+   // it in the index) and continue in the next
+   bool sealed = false;
+   for (std::size_t pos = 0; pos < output.size(); )
+   {
+      Segment& active = segments_.back();
+      if (active.bytes >= segmentSize_)
+      {
+         Segment next = { active.sequence + 1, active.offset + active.bytes, 0, 0 };
+         segments_.push_back(next);
+         sealed = true;
+         continue;
+      }
+
+      std::size_t count = std::min<std::size_t>(output.size() - pos,
+                                                segmentSize_ - active.bytes);
+      Error error = appendToFile(segmentPath(active.sequence), output.substr(pos, count));
+      if (error)
+         return error;
+
+      std::uint64_t newlines = std::count(output.begin() + pos,
+                                          output.begin() + pos + count,
+                                          '\n');
+      active.bytes += count;
+      active.newlines += newlines;
+      newlines_ += newlines;
+      pos += count;
+   }
+
+   return sealed ? writeIndex() : Success();
+}
+
+Error Scrollback::read(std::uint64_t offset, std::size_t length, std::string* pOutput)
+{
+   load();
+   pOutput->clear();
+
+   std::uint64_t end = segments_.back().offset + segments_.back().bytes;
+   std::uint64_t position = start_ + offset;
+   if (position >= end)
+      return Success();
+   end = std::min(end, position + length);
+   pOutput->reserve(end - position);
+
+   // find the segment holding the first byte, then read from each segment
+   // in turn until we have the requested range
+   auto it = std::upper_bound(
+            segments_.begin(),
+            segments_.end(),
+            position,
+            [](std::uint64_t position, const Segment& segment)
+            {
+               return position < segment.offset;
+            });
+
+   for (--it; position < end; ++it)
+   {
+      std::shared_ptr<std::istream> pStream;
+      Error error = segmentPath(it->sequence).openForRead(pStream);
+      if (error)
+         return error;
+
+      std::size_t count = std::min(end, it->offset + it->bytes) - position;
+      std::size_t size = pOutput->size();
+      pOutput->resize(size + count);
+
+      pStream->seekg(position - it->offset);
+      pStream->read(&(*pOutput)[size], count);
+      if (static_cast<std::size_t>(pStream->gcount()) != count)
+      {
+         error = systemError(boost::system::errc::io_error, ERROR_LOCATION);
+         error.addProperty("path", segmentPath(it->sequence));
+         return error;
+      }
+
+      position += count;
+   }
+
+   return Success();
+}
+
+Error Scrollback::readAll(std::string* pOutput)
+{
+   return read(0, size(), pOutput);
+}
+
+Error Scrollback::trim(int maxLines)
+{
+   load();
+   if (maxLines < 1 ||
+       size() <= static_cast<std::uint64_t>(maxLines) * 2 ||
+       newlineCount() <= static_cast<std::uint64_t>(maxLines))
+   {
+      return Success();
+   }
+
+   // the buffer will start at the (maxLines + 1)th newline from the end;
+   // find the segment holding it (counting newlines through the segments)
+   std::uint64_t target = newlines_ - maxLines;
+   std::uint64_t preceding = 0;
+   auto it = segments_.begin();
+   while (preceding + it->newlines < target)
+      preceding += (it++)->newlines;
+
+   // then find the newline in that segment
+   std::string contents;
+   Error error = readSegment(*it, &contents);
+   if (error)
+      return error;
+
+   std::size_t pos = 0;
+   for (std::uint64_t i = preceding; ; pos++)
+   {
+      pos = contents.find('\n', pos);
+      if (pos == std::string::npos)
+         return indexError(indexPath());
+      if (++i == target)
+         break;
+   }
+
+   start_ = it->offset + pos;
+   skippedNewlines_ = target - 1 - preceding;
+
+   // drop the segments wholly before the new start
+   std::deque<Segment> removed(segments_.begin(), it);
+   segments_.erase(segments_.begin(), it);
+   for (const Segment& segment : removed)
+      newlines_ -= segment.newlines;
+
+   error = writeIndex();
+   if (error)
+      return error;
+
+   removeSegments(removed);
+   return Success();
+}
+
+Error Scrollback::removeLastLine()
+{
+   load();
+
+   // find the last segment with a newline in the buffer
+   auto it = segments_.end();
+   for (;;)
+   {
+      if (it == segments_.begin())
+         return remove();
+
+      --it;
+      std::uint64_t skipped = (it == segments_.begin()) ? skippedNewlines_ : 0;
+      if (it->newlines > skipped)
+         break;
+   }
+
+   std::string contents;
+   Error error = readSegment(*it, &contents);
+   if (error)
+      return error;
+
+   std::size_t pos = contents.find_last_of('\n');
+   if (pos == std::string::npos)
+      return indexError(indexPath());
+
+   // erase everything after the final newline; the truncated segment is
+   // appended to from now on
+   if (pos + 1 < contents.size())
+   {
+      contents.erase(pos + 1);
+      error = writeStringToFile(segmentPath(it->sequence), contents);
+      if (error)
+         return error;
+      it->bytes = contents.size();
+   }
+
+   std::deque<Segment> removed(it + 1, segments_.end());
+   if (removed.empty())
+      return Success();
+
+   segments_.erase(it + 1, segments_.end());
+   for (const Segment& segment : removed)
+      newlines_ -= segment.newlines;
+
+   error = writeIndex();
+   if (error)
+      return error;
+
+   removeSegments(removed);
+   return Success();
+}
+
+Error Scrollback::remove()
+{
+   load();
+   removeSegments(segments_);
+   Error error = indexPath().removeIfExists();
+   reset();
+   return error;
+}
+
+void Scrollback::load()
+{
+   if (loaded_)
+      return;
+   loaded_ = true;
+
+   Error error = loadIndex();
+   if (!error)
+      return;
+
+   // we've lost track of the segments; remove any we can find and start
+   // over, rather than appending to them
+   LOG_ERROR(error);
+
+   std::vector<FilePath> children;
+   error = directory_.getChildren(children);
+   if (error)
+      LOG_ERROR(error);
+
+   for (const FilePath& child : children)
+   {
+      if (child.getStem() == handle_ &&
+          child.getExtension() != ".env" &&
+          !child.isDirectory())
+      {
+         error = child.remove();
+         if (error)
+            LOG_ERROR(error);
+      }
+   }
+
+   reset();
+}
+
+// the index holds a header line, giving the sequence and offset of the
+// segment being appended to, the start of the buffer, and the newlines
+// skipped before the start; then a line for each sealed segment giving its
+// sequence, offset, size, and number of newlines
+Error Scrollback::loadIndex()
+{
+   reset();
+
+   if (indexPath().exists())
+   {
+      std::string contents;
+      Error error = readStringFromFile(indexPath(), &contents);
+      if (error)
+         return error;
+
+      segments_.clear();
+
+      Segment active = { 0, 0, 0, 0 };
+      std::istringstream input(contents);
+      input >> active.sequence >> active.offset >> start_ >> skippedNewlines_;
+      if (!input)
+         return indexError(indexPath());
+
+      Segment segment;
+      while (input >> segment.sequence >> segment.offset >> segment.bytes >> segment.newlines)
+      {
+         segments_.push_back(segment);
+         newlines_ += segment.newlines;
+      }
+      if (!input.eof())
+         return indexError(indexPath());
+
+      segments_.push_back(active);
+   }
+
+   // the segment being appended to isn't indexed, so count its contents
+   Segment& appending = segments_.back();
+   std::string contents;
+   Error error = readSegment(appending, &contents);
+   if (error)
+      return error;
+
+   appending.bytes = contents.size();
+   appending.newlines = std::count(contents.begin(), contents.end(), '\n');
+   newlines_ += appending.newlines;
+
+   if (start_ < segments_.front().offset ||
+       start_ > appending.offset + appending.bytes ||
+       skippedNewlines_ > segments_.front().newlines)
+   {
+      return indexError(indexPath());
+   }
+
+   return Success();
+}
+
+Error Scrollback::writeIndex()
+{
+   const Segment& active = segments_.back();
+
+   std::ostringstream output;
+   output << active.sequence << ' ' << active.offset << ' '
+          << start_ << ' ' << skippedNewlines_ << '\n';
+   for (auto it = segments_.begin(); it + 1 != segments_.end(); ++it)
+   {
+      output << it->sequence << ' ' << it->offset << ' '
+             << it->bytes << ' ' << it->newlines << '\n';
+   }
+
+   return writeStringToFile(indexPath(), output.str());
+}
+
+void Scrollback::reset()
+{
+   Segment empty = { 0, 0, 0, 0 };
+   segments_.assign(1, empty);
+   start_ = 0;
+   skippedNewlines_ = 0;
+   newlines_ = 0;
+}
+
+void Scrollback::removeSegments(const std::deque<Segment>& segments)
+{
+   for (const Segment& segment : segments)
+   {
+      Error error = segmentPath(segment.sequence).removeIfExists();
+      if (error)
+         LOG_ERROR(error);
+   }
+}
+
+FilePath Scrollback::indexPath() const
+{
+   return directory_.completePath(handle_ + ".index");
+}
+
+FilePath Scrollback::segmentPath(unsigned sequence) const
+{
+   return directory_.completePath(handle_ + "." + safe_convert::numberToString(sequence));
+}
+
+Error Scrollback::readSegment(const Segment& segment, std::string* pContents) const
+{
+   FilePath path = segmentPath(segment.sequence);
+   if (!path.exists())
+   {
+      pContents->clear();
+      return Success();
+   }
+
+   return readStringFromFile(path, pContents);
+}
+
+} // namespace console_process
+} // namespace session
+} // namespace rstudio
@@ -0,0 +1,221 @@
+/*
+ * SessionConsoleProcessScrollbackTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include <session/SessionConsoleProcessScrollback.hpp>
+
+#define RSTUDIO_NO_TESTTHAT_ALIASES
+#include <tests/TestThat.hpp>
+
+#include <sstream>
+
+#include <shared_core/Error.hpp>
+
+#include <core/FileSerializer.hpp>
+#include <core/StringUtils.hpp>
+
+namespace rstudio {
+namespace session {
+namespace console_process {
+namespace tests {
+
+using namespace rstudio::core;
+
+namespace {
+
+const std::string handle("unit-test01");
+
+// small segments, so that even short buffers span several
+const std::size_t segmentSize = 16;
+
+std::string lines(int first, int last)
+{
+   std::stringstream ss;
+   for (int i = first; i < last; i++)
+      ss << "line " << i << '\n';
+   return ss.str();
+}
+
+std::string readAll(Scrollback& scrollback)
+{
+   std::string contents;
+   REQUIRE_FALSE(scrollback.readAll(&contents));
+   return contents;
+}
+
+class TempDirectory
+{
+public:
+   TempDirectory()
+   {
+      REQUIRE_FALSE(FilePath::tempFilePath(path));
+      REQUIRE_FALSE(path.ensureDirectory());
+   }
+
+   ~TempDirectory()
+   {
+      path.removeIfExists();
+   }
+
+   FilePath path;
+};
+
+} // anonymous namespace
+
+TEST_CASE("Terminal scrollback")
+{
+   TempDirectory dir;
+   Scrollback scrollback(dir.path, handle, segmentSize);
+
+   SECTION("Empty buffers read as empty")
+   {
+      REQUIRE(readAll(scrollback).empty());
+      REQUIRE(scrollback.size() == 0);
+      REQUIRE(scrollback.newlineCount() == 0);
+   }
+
+   SECTION("Appended output is read back across segments")
+   {
+      std::string expected = lines(0, 20) + "partial";
+      REQUIRE_FALSE(scrollback.append(lines(0, 10)));
+      REQUIRE_FALSE(scrollback.append(lines(10, 20)));
+      REQUIRE_FALSE(scrollback.append("partial"));
+
+      REQUIRE(readAll(scrollback) == expected);
+      REQUIRE(scrollback.size() == expected.size());
+      REQUIRE(scrollback.newlineCount() == 20);
+
+      // a fresh instance reads the same buffer from the index
+      Scrollback reloaded(dir.path, handle, segmentSize);
+      REQUIRE(readAll(reloaded) == expected);
+      REQUIRE(reloaded.newlineCount() == 20);
+
+      // and can keep appending to it
+      REQUIRE_FALSE(reloaded.append(lines(20, 30)));
+      REQUIRE(readAll(reloaded) == expected + lines(20, 30));
+   }
+
+   SECTION("Any range of the buffer can be read")
+   {
+      std::string expected;
+      for (int i = 0; i < 100; i++)
+      {
+         std::string output = lines(i, i + 1);
+         REQUIRE_FALSE(scrollback.append(output));
+         expected += output;
+      }
+
+      for (std::size_t offset : { 0, 1, 15, 16, 17, 100, 500, 780 })
+      {
+         for (std::size_t length : { 1, 16, 40, 1000 })
+         {
+            std::string chunk;
+            REQUIRE_FALSE(scrollback.read(offset, length, &chunk));
+            REQUIRE(chunk == expected.substr(offset, length));
+         }
+      }
+
+      std::string chunk = "not empty";
+      REQUIRE_FALSE(scrollback.read(expected.size(), 10, &chunk));
+      REQUIRE(chunk.empty());
+   }
+
+   SECTION("Trimming keeps the same lines trimLeadingLines does")
+   {
+      for (int maxLines : { 1, 5, 50, 99, 100, 1000 })
+      {
+         TempDirectory trimDir;
+         Scrollback trimmed(trimDir.path, handle, segmentSize);
+
+         std::string expected = lines(0, 100) + "prompt> ";
+         REQUIRE_FALSE(trimmed.append(expected));
+         string_utils::trimLeadingLines(maxLines, &expected);
+
+         REQUIRE_FALSE(trimmed.trim(maxLines));
+         REQUIRE(readAll(trimmed) == expected);
+         REQUIRE(trimmed.newlineCount() == string_utils::countNewlines(expected));
+
+         // trimming again changes nothing
+         REQUIRE_FALSE(trimmed.trim(maxLines));
+         REQUIRE(readAll(trimmed) == expected);
+
+         Scrollback reloaded(trimDir.path, handle, segmentSize);
+         REQUIRE(readAll(reloaded) == expected);
+         REQUIRE(reloaded.newlineCount() == string_utils::countNewlines(expected));
+      }
+   }
+
+   SECTION("Trimming drops whole segments")
+   {
+      REQUIRE_FALSE(scrollback.append(lines(0, 100)));
+      REQUIRE(dir.path.completePath(handle + ".0").exists());
+
+      REQUIRE_FALSE(scrollback.trim(10));
+      REQUIRE_FALSE(dir.path.completePath(handle + ".0").exists());
+      REQUIRE(readAll(scrollback) == "\n" + lines(90, 100));
+
+      // output appended after trimming follows the trimmed buffer
+      REQUIRE_FALSE(scrollback.append(lines(100, 105)));
+      REQUIRE(readAll(scrollback) == "\n" + lines(90, 105));
+   }
+
+   SECTION("The last line can be removed")
+   {
+      REQUIRE_FALSE(scrollback.append(lines(0, 10) + "a partial line that spans segments"));
+      REQUIRE_FALSE(scrollback.removeLastLine());
+      REQUIRE(readAll(scrollback) == lines(0, 10));
+
+      // nothing to remove once the buffer ends with a newline
+      REQUIRE_FALSE(scrollback.removeLastLine());
+      REQUIRE(readAll(scrollback) == lines(0, 10));
+
+      REQUIRE_FALSE(scrollback.append("more"));
+      Scrollback reloaded(dir.path, handle, segmentSize);
+      REQUIRE(readAll(reloaded) == lines(0, 10) + "more");
+   }
+
+   SECTION("Removing the last line of a buffer without newlines removes it all")
+   {
+      REQUIRE_FALSE(scrollback.append("no newlines in this buffer"));
+      REQUIRE_FALSE(scrollback.removeLastLine());
+      REQUIRE(readAll(scrollback).empty());
+   }
+
+   SECTION("Removing the buffer deletes its files")
+   {
+      REQUIRE_FALSE(scrollback.append(lines(0, 10)));
+      REQUIRE_FALSE(scrollback.remove());
+      REQUIRE(readAll(scrollback).empty());
+
+      std::vector<FilePath> children;
+      REQUIRE_FALSE(dir.path.getChildren(children));
+      REQUIRE(children.empty());
+   }
+
+   SECTION("A corrupt index discards the buffer")
+   {
+      REQUIRE_FALSE(scrollback.append(lines(0, 10)));
+      REQUIRE_FALSE(writeStringToFile(dir.path.completePath(handle + ".index"), "garbage"));
+
+      Scrollback reloaded(dir.path, handle, segmentSize);
+      REQUIRE(readAll(reloaded).empty());
+      REQUIRE_FALSE(reloaded.append("fresh"));
+      REQUIRE(readAll(reloaded) == "fresh");
+   }
+}
+
+} // end namespace tests
+} // end namespace console_process
+} // end namespace session
+} // end namespace rstudio
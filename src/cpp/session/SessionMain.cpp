@@ -74,6 +74,7 @@
 
 #include <core/system/FileMonitor.hpp>
 #include <core/text/TemplateFilter.hpp>
+#include <core/r_util/RActiveSessionStorage.hpp>
 #include <core/r_util/RSessionContext.hpp>
 #include <core/r_util/REnvironment.hpp>
 #include <core/WaitUtils.hpp>
@@ -476,6 +477,7 @@ void exitEarly(int status)
    stopMonitorWorkerThread();
    FileLock::cleanUp();
    FilePath(s_fallbackLibraryPath).removeIfExists();
+   log::shutdown();
    ::exit(status);
 }
 
@@ -1296,6 +1298,9 @@ void rCleanup(bool terminatedNormally)
          module_context::events().onDestroyed();
       }
 
+      // write any session properties still being held back
+      r_util::FileActiveSessionStorage::flushDeferredWrites();
+
       // clean up locks
       FileLock::cleanUp();
 
@@ -2128,6 +2128,7 @@ void enqueFileChangedEvent(const core::system::FileChangeEvent &event)
    FilePath filePath = FilePath(event.fileInfo().absolutePath());
 
    using namespace session::modules::source_control;
+   onFilesChanged(std::vector<core::system::FileChangeEvent>(1, event));
    auto pCtx = fileDecorationContext(filePath, true);
    enqueFileChangedEvent(event, pCtx);
 }
@@ -2153,6 +2154,7 @@ void enqueFileChangedEvents(const core::FilePath& vcsStatusRoot,
    }
 
    using namespace session::modules::source_control;
+   onFilesChanged(events);
    auto pCtx = fileDecorationContext(commonParentPath, true);
 
    // fire client events as necessary
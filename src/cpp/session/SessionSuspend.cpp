@@ -29,6 +29,7 @@
 #include <session/SessionSuspendFilter.hpp>
 
 #include <shared_core/Error.hpp>
+#include <core/r_util/RActiveSessionStorage.hpp>
 #include <shared_core/json/Json.hpp>
 
 #include <r/RExec.hpp>
@@ -325,6 +326,9 @@ bool suspendSession(bool force, int status)
    // record time of suspension
    module_context::activeSession().setSuspensionTime();
 
+   // write any session properties still being held back
+   core::r_util::FileActiveSessionStorage::flushDeferredWrites();
+
    // perform the suspend (does not return if successful)
    return r::session::suspend(force, status, session::options().ephemeralEnvVars());
 }
@@ -19,6 +19,8 @@
 
 #include <boost/array.hpp>
 
+#include <boost/algorithm/string/predicate.hpp>
+
 #include <boost/utility.hpp>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/write.hpp>
@@ -58,14 +60,22 @@ public:
    typedef boost::function<void(boost::shared_ptr<HttpConnectionImpl<ProtocolType> >)> HeadersParsedHandler;
    typedef boost::function<void(
          boost::shared_ptr<HttpConnectionImpl<ProtocolType> >)> Handler;
+   typedef boost::function<void(
+         boost::shared_ptr<typename ProtocolType::socket>)> KeepAliveHandler;
 
 
 public:
+   // keepAliveHandler (optional) is given the socket after a response when
+   // the client asked for the connection to be kept open
    HttpConnectionImpl(boost::asio::io_service& ioService,
                       boost::shared_ptr<boost::asio::ssl::context> sslContext,
                       const HeadersParsedHandler& headersParsed,
-                      const Handler& handler)
-      : headersParsedHandler_(headersParsed), handler_(handler),
+                      const Handler& handler,
+                      const KeepAliveHandler& keepAliveHandler = KeepAliveHandler())
+      : ioService_(ioService),
+        headersParsedHandler_(headersParsed), handler_(handler),
+        keepAliveHandler_(keepAliveHandler),
+        socketReleased_(false),
         receivedTime_(std::chrono::steady_clock::now())
    {
       if (sslContext)
@@ -101,6 +111,7 @@ public:
 
    virtual void sendResponse(const core::http::Response &response)
    {
+      bool keepAlive = false;
       try
       {
          if (response.isStreamResponse())
@@ -145,14 +156,17 @@ public:
          }
          else
          {
+            keepAlive = canKeepAlive(response);
             boost::asio::write(socket(),
                                response.toBuffers(
-                                     core::http::Header::connectionClose()));
+                                     keepAlive ? core::http::Header::connectionKeepAlive() :
+                                                 core::http::Header::connectionClose()));
          }
       }
       catch(const boost::system::system_error& e)
       {
          // establish error
+         keepAlive = false;
          core::Error error = core::Error(e.code(), ERROR_LOCATION);
          error.addProperty("request-uri", request_.uri());
 
@@ -162,10 +176,13 @@ public:
       }
       CATCH_UNEXPECTED_EXCEPTION
 
-      // always close connection
+      // close the connection unless it's being kept open for another request
       try
       {
-         close();
+         if (keepAlive)
+            releaseSocket();
+         else
+            close();
       }
       CATCH_UNEXPECTED_EXCEPTION
    }
@@ -183,14 +200,61 @@ public:
       // set response
       core::json::setJsonRpcResponse(jsonRpcResponse, &response);
 
+      // streamed results are written here, on the thread which handled the
+      // rpc, so that result writers never run on the io thread
+      if (response.isStreamResponse())
+      {
+         sendStreamResponse(response);
+         return;
+      }
+
       // send the response
       sendResponse(response);
    }
 
+   void sendStreamResponse(const core::http::Response& response)
+   {
+      try
+      {
+         if (sslStream_)
+         {
+            core::http::writeStreamResponse(*sslStream_,
+                                            response,
+                                            core::http::Header::connectionClose());
+         }
+         else
+         {
+            core::http::writeStreamResponse(socket(),
+                                            response,
+                                            core::http::Header::connectionClose());
+         }
+      }
+      catch(const boost::system::system_error& e)
+      {
+         core::Error error = core::Error(e.code(), ERROR_LOCATION);
+         error.addProperty("request-uri", request_.uri());
+
+         // log the error if it wasn't connection terminated
+         if (!core::http::isConnectionTerminatedError(error))
+            LOG_ERROR(error);
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+
+      try
+      {
+         close();
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+   }
+
    // close (occurs automatically after writeResponse, here in case it
    // need to be closed in other circumstances
    virtual void close()
    {
+      // the socket belongs to the connection reading the next request
+      if (socketReleased_)
+         return;
+
       // always close connection
       core::Error error = core::http::closeSocket(*socket_);
       if (error)
@@ -221,6 +285,12 @@ public:
    // get the socket
    typename ProtocolType::socket& socket() { return *socket_; }
 
+   // take over the socket of a kept alive connection (before startReading)
+   void adoptSocket(boost::shared_ptr<typename ProtocolType::socket> ptrSocket)
+   {
+      socket_ = ptrSocket;
+   }
+
    virtual void setUploadHandler(const core::http::UriAsyncUploadHandlerFunction& uploadHandler)
    {
       auto me = HttpConnectionImpl<ProtocolType>::shared_from_this();
@@ -381,6 +451,22 @@ private:
       CATCH_UNEXPECTED_EXCEPTION
    }
 
+   // the client can send another request once it has the response. (it
+   // waits for the response first: a request following on immediately,
+   // in the same read, is not supported)
+   bool canKeepAlive(const core::http::Response& response)
+   {
+      return keepAliveHandler_ &&
+             boost::algorithm::iequals(request_.headerValue("Connection"), "keep-alive") &&
+             !response.headerValue("Content-Length").empty();
+   }
+
+   void releaseSocket()
+   {
+      socketReleased_ = true;
+      ioService_.post(boost::bind(keepAliveHandler_, socket_));
+   }
+
    void onStreamComplete()
    {
       close();
@@ -393,6 +479,8 @@ private:
    }
 
 private:
+   boost::asio::io_service& ioService_;
+
    // optional ssl stream
    // not used if the connection is not ssl enabled
    boost::shared_ptr<boost::asio::ssl::stream<typename ProtocolType::socket> > sslStream_;
@@ -405,6 +493,8 @@ private:
    std::string requestId_;
    HeadersParsedHandler headersParsedHandler_;
    Handler handler_;
+   KeepAliveHandler keepAliveHandler_;
+   bool socketReleased_;
    std::chrono::steady_clock::time_point receivedTime_;
 };
 
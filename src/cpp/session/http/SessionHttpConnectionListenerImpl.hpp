@@ -209,24 +209,45 @@ private:
 
    virtual core::Error cleanup() = 0;
 
+   // can clients keep their connection open to send further requests?
+   virtual bool keepAliveEnabled()
+   {
+      return false;
+   }
+
 private:
    boost::asio::io_service& ioService() { return acceptorService_.ioService(); }
 
+   boost::shared_ptr<HttpConnectionImpl<ProtocolType> > createConnection()
+   {
+      typename HttpConnectionImpl<ProtocolType>::KeepAliveHandler keepAliveHandler;
+      if (keepAliveEnabled())
+      {
+         keepAliveHandler = boost::bind(
+                  &HttpConnectionListenerImpl<ProtocolType>::onConnectionKeptAlive,
+                  this,
+                  _1);
+      }
+
+      return boost::shared_ptr<HttpConnectionImpl<ProtocolType> >(
+            new HttpConnectionImpl<ProtocolType>(
+               ioService(),
+               sslContext_,
+               boost::bind(
+                    &HttpConnectionListenerImpl<ProtocolType>::onHeadersParsed,
+                    this,
+                    _1),
+               boost::bind(
+                    &HttpConnectionListenerImpl<ProtocolType>::enqueConnection,
+                    this,
+                    _1),
+               keepAliveHandler));
+   }
+
    void acceptNextConnection()
    {
       // create the connection
-      ptrNextConnection_.reset( new HttpConnectionImpl<ProtocolType>(
-            ioService(),
-            sslContext_,
-            boost::bind(
-                 &HttpConnectionListenerImpl<ProtocolType>::onHeadersParsed,
-                 this,
-                 _1),
-            boost::bind(
-                 &HttpConnectionListenerImpl<ProtocolType>::enqueConnection,
-                 this,
-                 _1))
-      );
+      ptrNextConnection_ = createConnection();
 
       // wait for next connection
       acceptorService_.asyncAccept(
@@ -278,6 +299,19 @@ private:
       CATCH_UNEXPECTED_EXCEPTION
    }
 
+   // read the next request sent on a connection which was kept open (the
+   // client was validated when the connection was accepted)
+   void onConnectionKeptAlive(boost::shared_ptr<typename ProtocolType::socket> ptrSocket)
+   {
+      try
+      {
+         boost::shared_ptr<HttpConnectionImpl<ProtocolType> > ptrConnection = createConnection();
+         ptrConnection->adoptSocket(ptrSocket);
+         ptrConnection->startReading();
+      }
+      CATCH_UNEXPECTED_EXCEPTION
+   }
+
    void onHeadersParsed(boost::shared_ptr<HttpConnectionImpl<ProtocolType> > ptrConnection)
    {
       // convert to cannonical HttpConnection
@@ -114,6 +114,12 @@ private:
    }
 
 
+   // rserver keeps its connections to the session open between requests
+   virtual bool keepAliveEnabled()
+   {
+      return true;
+   }
+
    virtual Error cleanup()
    {
       Error error = cleanupPidFile();
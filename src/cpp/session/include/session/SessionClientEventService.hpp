@@ -17,13 +17,17 @@
 #define SESSION_CLIENT_EVENT_SERVICE_HPP
 
 #include <string>
+#include <vector>
 
+#include <boost/shared_ptr.hpp>
 #include <boost/utility.hpp>
 
 #include <core/BoostThread.hpp>
 
 #include <core/json/JsonRpc.hpp>
 
+#include <session/SessionClientEvent.hpp>
+
 namespace rstudio {
 namespace core {
    class Error;
@@ -34,6 +38,54 @@ namespace core {
 namespace rstudio {
 namespace session {
 
+namespace console_process {
+   class ConsoleProcessSocket;
+}
+
+// events delivered to the client but not yet acknowledged, along with the
+// state of the websocket push channel (not thread safe; ClientEventService
+// guards it with its mutex)
+class ClientEventBuffer
+{
+public:
+   explicit ClientEventBuffer(std::size_t maxUnacknowledgedPushEvents);
+
+   // assigns ids to new events and buffers them until they are acknowledged
+   void add(const std::vector<ClientEvent>& events,
+            core::json::Array* pAdded = nullptr);
+
+   // drops the events the client has seen, and keeps new ids ahead of them
+   // (so that after a resume from suspend ids continue from the client's)
+   void acknowledge(int lastClientEventIdSeen);
+
+   const core::json::Array& events() const { return events_; }
+   bool empty() const { return events_.isEmpty(); }
+   void clear();
+
+   // a push channel connection only becomes ready once the client has sent
+   // its first acknowledgement, which syncs event ids with the client; at
+   // that point every unacknowledged event is returned to be sent again
+   void openPushChannel(const std::string& clientId);
+   void closePushChannel(const std::string& clientId);
+   bool acknowledgePush(const std::string& clientId,
+                        int lastClientEventIdSeen,
+                        core::json::Array* pResendEvents);
+
+   // whether more events can be pushed to the client, which is not the case
+   // while too many pushed events are unacknowledged
+   bool canPush(const std::string& clientId) const;
+
+   // the client with a ready push channel (empty if there is none)
+   std::string pushClientId() const;
+
+private:
+   core::json::Array events_;
+   int nextEventId_;
+   std::size_t maxUnacknowledgedPushEvents_;
+   std::string pushClientId_;
+   bool pushReady_;
+};
+
 // singleton
 class ClientEventService;
 ClientEventService& clientEventService();
@@ -41,7 +93,7 @@ ClientEventService& clientEventService();
 class ClientEventService : boost::noncopyable
 {
 private:
-   ClientEventService() {}
+   ClientEventService();
    friend ClientEventService& clientEventService();
 
 public:
@@ -54,21 +106,41 @@ public:
 
    std::string clientId();
 
+   // network port of the websocket push channel; 0 means events are only
+   // available by long-polling get_events
+   int pushChannelPort();
+
 private:
    void run();
+   void runPushChannel();
 
-   void erasePreviouslyDeliveredEvents(int lastClientEventIdSeen);
+   void acknowledgeClientEvents(int lastClientEventIdSeen);
+   bool isPushingTo(const std::string& clientId);
+   bool waitForPolledEvent(const std::string& clientId,
+                           const boost::posix_time::time_duration& maxWait);
    bool havePendingClientEvents();
-   void addClientEvent(const core::json::Object& eventObject);
    void setClientEventResult(core::json::JsonRpcResponse* pResponse);
 
+   void dequeueClientEvents(core::json::Array* pNewEvents);
+
+   core::Error startPushChannel();
+   void onPushChannelOpened(const std::string& clientId);
+   void onPushChannelClosed(const std::string& clientId);
+   void onPushChannelInput(const std::string& clientId, const std::string& input);
+   void pushClientEvents(const core::json::Array& events);
+
   
 private:
    boost::mutex mutex_;
    boost::thread serviceThread_;
 
    std::string clientId_;
-   core::json::Array clientEvents_;
+   ClientEventBuffer clientEvents_;
+
+   // websocket push channel (see runPushChannel)
+   boost::shared_ptr<console_process::ConsoleProcessSocket> pPushSocket_;
+   boost::thread pushThread_;
+   boost::condition_variable pushCondition_;
 };
    
   
@@ -15,6 +15,7 @@
 #ifndef SESSION_CONSOLE_PROCESS_PERSIST_HPP
 #define SESSION_CONSOLE_PROCESS_PERSIST_HPP
 
+#include <cstddef>
 #include <string>
 
 #include <core/system/Types.hpp>
@@ -43,8 +44,17 @@ void saveConsoleProcesses(const std::string& metadata);
 // then returns the trimmed buffer.
 std::string getSavedBuffer(const std::string& handle, int maxLines);
 
+// Get a chunk of the saved buffer for the given ConsoleProcess; the buffer is
+// trimmed to maxLines (when > 0) before the first chunk is returned. Only the
+// requested chunk is read.
+std::string getSavedBufferChunk(const std::string& handle,
+                                int chunk,
+                                std::size_t chunkSize,
+                                int maxLines,
+                                bool* pMoreAvailable);
+
 // Return number of lines in the saved buffer for given ConsoleProcess;
-// buffer will be trimmed to max number of lines and rewritten.
+// buffer will be trimmed to max number of lines.
 int getSavedBufferLineCount(const std::string& handle, int maxLines);
 
 // Add to the saved buffer for the given ConsoleProcess
@@ -0,0 +1,111 @@
+/*
+ * SessionConsoleProcessScrollback.hpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+#ifndef SESSION_CONSOLE_PROCESS_SCROLLBACK_HPP
+#define SESSION_CONSOLE_PROCESS_SCROLLBACK_HPP
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+#include <boost/noncopyable.hpp>
+
+#include <shared_core/FilePath.hpp>
+
+namespace rstudio {
+namespace core {
+   class Error;
+}
+}
+
+namespace rstudio {
+namespace session {
+namespace console_process {
+
+// size at which a scrollback segment is sealed and a new one started
+const std::size_t kScrollbackSegmentSize = 64 * 1024;
+
+// The saved output (scrollback) of a terminal. Output is appended to a series
+// of segment files, <handle>.<n>, and a small index, <handle>.index, records
+// where each sealed segment starts and how many lines it holds. Trimming the
+// buffer moves its start forward and deletes the segments wholly before the
+// new start, and reading part of the buffer seeks straight to the segments
+// holding it, so neither requires reading or rewriting the whole buffer.
+class Scrollback : boost::noncopyable
+{
+public:
+   Scrollback(const core::FilePath& directory,
+              const std::string& handle,
+              std::size_t segmentSize = kScrollbackSegmentSize);
+
+   // size of the buffer in bytes, and the number of newlines in it
+   std::uint64_t size();
+   std::uint64_t newlineCount();
+
+   core::Error append(const std::string& output);
+
+   // reads up to length bytes of the buffer, starting at the given offset
+   core::Error read(std::uint64_t offset, std::size_t length, std::string* pOutput);
+   core::Error readAll(std::string* pOutput);
+
+   // trims the buffer to its last maxLines lines, keeping the newline which
+   // precedes them (as string_utils::trimLeadingLines does); nothing is
+   // trimmed unless the buffer is longer than maxLines * 2 bytes
+   core::Error trim(int maxLines);
+
+   // removes everything after the last newline in the buffer, or the whole
+   // buffer if it holds no newline
+   core::Error removeLastLine();
+
+   // deletes the buffer
+   core::Error remove();
+
+private:
+   struct Segment
+   {
+      unsigned sequence;
+      std::uint64_t offset;
+      std::uint64_t bytes;
+      std::uint64_t newlines;
+   };
+
+   void load();
+   core::Error loadIndex();
+   core::Error writeIndex();
+   void reset();
+   void removeSegments(const std::deque<Segment>& segments);
+   core::FilePath indexPath() const;
+   core::FilePath segmentPath(unsigned sequence) const;
+   core::Error readSegment(const Segment& segment, std::string* pContents) const;
+
+   core::FilePath directory_;
+   std::string handle_;
+   std::size_t segmentSize_;
+   bool loaded_;
+
+   // segments in order, the last of which is being appended to
+   std::deque<Segment> segments_;
+
+   // the absolute offset at which the buffer starts (in the first segment),
+   // and the number of newlines in the first segment before that
+   std::uint64_t start_;
+   std::uint64_t skippedNewlines_;
+   std::uint64_t newlines_;
+};
+
+} // namespace console_process
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_CONSOLE_PROCESS_SCROLLBACK_HPP
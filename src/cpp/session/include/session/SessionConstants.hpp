@@ -96,6 +96,7 @@
 #define kWebSocketConnectTimeout          "websocket-connect-timeout"
 #define kWebSocketLogLevel                "websocket-log-level"
 #define kWebSocketHandshakeTimeout        "websocket-handshake-timeout"
+#define kWebSocketClientEvents            "websocket-client-events"
 
 #define kPackageOutputInPackageFolder     "package-output-to-package-folder"
 
@@ -185,6 +185,9 @@ protected:
       (kWebSocketHandshakeTimeout,
       value<int>(&webSocketHandshakeTimeoutMs_)->default_value(5000),
       "Specifies the WebSocket protocol handshake timeout for session terminals in milliseconds.")
+      (kWebSocketClientEvents,
+      value<bool>(&webSocketClientEvents_)->default_value(false),
+      "Indicates whether or not to offer clients a WebSocket channel for pushing client events, in place of long-polling.")
       (kPackageOutputInPackageFolder,
       value<bool>(&packageOutputToPackageFolder_)->default_value(false),
       "Specifies whether or not package builds output to the package project folder.")
@@ -443,6 +446,7 @@ public:
    int webSocketConnectTimeout() const { return webSocketConnectTimeout_; }
    int webSocketLogLevel() const { return webSocketLogLevel_; }
    int webSocketHandshakeTimeoutMs() const { return webSocketHandshakeTimeoutMs_; }
+   bool webSocketClientEvents() const { return webSocketClientEvents_; }
    bool packageOutputInPackageFolder() const { return packageOutputToPackageFolder_; }
    std::string rootPath() const { return rootPath_; }
    bool useSecureCookies() const { return useSecureCookies_; }
@@ -546,6 +550,7 @@ protected:
    int webSocketConnectTimeout_;
    int webSocketLogLevel_;
    int webSocketHandshakeTimeoutMs_;
+   bool webSocketClientEvents_;
    bool packageOutputToPackageFolder_;
    std::string rootPath_;
    bool useSecureCookies_;
@@ -23,6 +23,10 @@
 #include <set>
 #include <gsl/gsl>
 
+#ifndef _WIN32
+# include <sys/stat.h>
+#endif
+
 #include <boost/shared_ptr.hpp>
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
@@ -37,7 +41,9 @@
 
 #include <core/Debug.hpp>
 #include <core/FileSerializer.hpp>
+#include <core/FuzzyMatcher.hpp>
 #include <core/Exec.hpp>
+#include <core/TrigramIndex.hpp>
 #include <core/collection/Tree.hpp>
 
 #include <core/r_util/RSourceIndex.hpp>
@@ -51,6 +57,7 @@
 
 #include <session/SessionModuleContext.hpp>
 #include <session/SessionAsyncRProcess.hpp>
+#include <session/SessionHttpConnectionListener.hpp>
 #include <session/SessionQuarto.hpp>
 #include <session/SessionRUtil.hpp>
 
@@ -454,11 +461,90 @@ private:
    
 };
 
+// persist the items found in an R source index alongside the project's
+// search index, so unchanged files needn't be parsed in the next session
+std::string sourceIndexPayload(const boost::shared_ptr<r_util::RSourceIndex>& pIndex)
+{
+   json::Array items;
+   for (const r_util::RSourceItem& item : pIndex->items())
+   {
+      json::Array signature;
+      for (const r_util::RS4MethodParam& param : item.signature())
+      {
+         json::Array paramJson;
+         paramJson.push_back(param.name());
+         paramJson.push_back(param.type());
+         signature.push_back(paramJson);
+      }
+
+      json::Array itemJson;
+      itemJson.push_back(item.type());
+      itemJson.push_back(item.name());
+      itemJson.push_back(signature);
+      itemJson.push_back(item.braceLevel());
+      itemJson.push_back(item.line());
+      itemJson.push_back(item.column());
+      itemJson.push_back(item.hidden());
+      items.push_back(itemJson);
+   }
+
+   json::Object payload;
+   payload["items"] = items;
+   payload["packages"] = json::toJsonArray(pIndex->getInferredPackages());
+   return payload.write();
+}
+
+boost::shared_ptr<r_util::RSourceIndex> sourceIndexFromPayload(const std::string& context,
+                                                               const std::string& payload)
+{
+   boost::shared_ptr<r_util::RSourceIndex> pIndex;
+
+   json::Value payloadJson;
+   if (payloadJson.parse(payload) || !payloadJson.isObject())
+      return pIndex;
+
+   json::Array items, packages;
+   Error error = json::readObject(payloadJson.getObject(),
+                                  "items", items,
+                                  "packages", packages);
+   if (error)
+      return pIndex;
+
+   pIndex.reset(new r_util::RSourceIndex(context, std::string()));
+   for (const json::Value& itemJson : items)
+   {
+      json::Array item = itemJson.getArray();
+      if (item.getSize() != 7)
+         return boost::shared_ptr<r_util::RSourceIndex>();
+
+      std::vector<r_util::RS4MethodParam> signature;
+      for (const json::Value& paramJson : item[2].getArray())
+      {
+         json::Array param = paramJson.getArray();
+         signature.push_back(r_util::RS4MethodParam(param[0].getString(),
+                                                    param[1].getString()));
+      }
+
+      pIndex->addSourceItem(r_util::RSourceItem(item[0].getInt(),
+                                                item[1].getString(),
+                                                signature,
+                                                item[3].getInt(),
+                                                item[4].getInt(),
+                                                item[5].getInt(),
+                                                item[6].getBool()));
+   }
+
+   for (const json::Value& package : packages)
+      pIndex->addInferredPackage(package.getString());
+
+   return pIndex;
+}
+
 class SourceFileIndex : boost::noncopyable
 {
 public:
    SourceFileIndex()
-      : pEntries_(new EntryTree()), indexing_(false)
+      : pEntries_(new EntryTree()), indexing_(false), persistPending_(false)
    {
    }
 
@@ -507,6 +593,34 @@ public:
       }
    }
 
+   // read the search index persisted by a previous session, if any
+   void loadPersistedIndex(const tree<FileInfo>& files)
+   {
+      indexPath_ = projects::projectContext().scratchPath().completeChildPath("search_index");
+      if (!indexPath_.exists())
+         return;
+
+      Error error = searchIndex_.readFromFile(indexPath_);
+      if (error)
+      {
+         LOG_ERROR(error);
+         return;
+      }
+
+      // forget files which were removed while the session wasn't running
+      std::set<std::string> paths;
+      for (auto it = files.begin_leaf(); it != files.end_leaf(); ++it)
+         paths.insert(it->absolutePath());
+
+      std::vector<std::pair<std::string, std::int64_t> > documents;
+      searchIndex_.listDocuments(&documents);
+      for (const auto& document : documents)
+      {
+         if (paths.count(document.first) == 0)
+            searchIndex_.remove(document.first);
+      }
+   }
+
    void enqueFileChange(const core::system::FileChangeEvent& event)
    {
       // add to the queue
@@ -799,11 +913,39 @@ public:
       }
    }
    
+   // find the indexed files which can't contain literal, along with their
+   // modification times when they were indexed; returns false if the index
+   // can't narrow down a search for literal
+   bool findFilesWithoutLiteral(const std::string& literal,
+                                std::map<std::string, std::int64_t>* pFiles)
+   {
+      // the index is only complete once the queue is drained
+      if (indexing_)
+         return false;
+
+      std::set<std::string> candidates;
+      if (!searchIndex_.findCandidates(literal, &candidates))
+         return false;
+
+      std::vector<std::pair<std::string, std::int64_t> > documents;
+      searchIndex_.listDocuments(&documents);
+      for (const auto& document : documents)
+      {
+         if (candidates.count(document.first) == 0)
+            pFiles->insert(document);
+      }
+      return true;
+   }
+
    void clear()
    {
+      persistIndex();
+
       indexing_ = false;
       indexingQueue_ = std::queue<core::system::FileChangeEvent>();
       pEntries_->clear();
+      searchIndex_.clear();
+      indexPath_ = FilePath();
    }
 
 private:
@@ -823,9 +965,16 @@ private:
          switch(event.type())
          {
             case FileChangeEvent::FileAdded:
+            {
+               updateIndexEntry(fileInfo, false);
+               break;
+            }
+
             case FileChangeEvent::FileModified:
             {
-               updateIndexEntry(fileInfo);
+               // always re-read modified files: their modification time can
+               // match the index's even though their contents changed
+               updateIndexEntry(fileInfo, true);
                break;
             }
 
@@ -845,7 +994,7 @@ private:
       return indexing_;
    }
 
-   void updateIndexEntry(const FileInfo& fileInfo)
+   void updateIndexEntry(const FileInfo& fileInfo, bool modified)
    {
       // index the source if necessary
       boost::shared_ptr<r_util::RSourceIndex> pIndex;
@@ -857,8 +1006,24 @@ private:
       if (isWithinIgnoredDirectory(filePath, module_context::ignoreContentDirs()))
          return;
 
+      // files which haven't changed since they were last indexed (possibly
+      // by a previous session) don't need to be read again; the modification
+      // time is taken before reading so a concurrent write is caught later
+      const std::string& path = fileInfo.absolutePath();
+      std::int64_t modificationTime = fileModificationTime(path);
+      bool current = !modified && searchIndex_.isCurrent(path, modificationTime);
+
       if (isIndexableSourceFile(fileInfo))
       {
+         std::string payload;
+         if (current && searchIndex_.getPayload(path, &payload))
+            pIndex = sourceIndexFromPayload(module_context::createAliasedPath(filePath), payload);
+      }
+
+      if (!pIndex && isIndexableSourceFile(fileInfo))
+      {
+         current = false;
+
          std::string code;
          Error error = module_context::readAndDecodeFile(
                                  filePath,
@@ -882,6 +1047,9 @@ private:
          pIndex.reset(new r_util::RSourceIndex(context, code));
       }
 
+      if (!current)
+         updateSearchIndex(fileInfo, modificationTime, pIndex);
+
       // attempt to add the entry
       Entry entry(fileInfo, pIndex);
       pEntries_->insertEntry(entry);
@@ -890,8 +1058,64 @@ private:
       r_packages::AsyncPackageInformationProcess::update();
    }
 
+   void updateSearchIndex(const FileInfo& fileInfo,
+                          std::int64_t modificationTime,
+                          const boost::shared_ptr<r_util::RSourceIndex>& pIndex)
+   {
+      const std::string& path = fileInfo.absolutePath();
+      if (!isSearchableFile(fileInfo))
+      {
+         searchIndex_.remove(path);
+         schedulePersistIndex();
+         return;
+      }
+
+      // index the contents as they are on disk (i.e. in the file's encoding)
+      // since that is what find in files searches
+      std::string contents;
+      Error error = readStringFromFile(FilePath(path), &contents);
+      if (error)
+      {
+         if (!core::isPathNotFoundError(error))
+            LOG_ERROR(error);
+         return;
+      }
+
+      searchIndex_.update(path,
+                          modificationTime,
+                          contents,
+                          pIndex ? sourceIndexPayload(pIndex) : std::string());
+      schedulePersistIndex();
+   }
+
+   void schedulePersistIndex()
+   {
+      if (persistPending_ || indexPath_.isEmpty())
+         return;
+
+      // batch up changes rather than rewriting the index for each one
+      persistPending_ = true;
+      module_context::scheduleDelayedWork(
+               boost::posix_time::seconds(30),
+               boost::bind(&SourceFileIndex::persistIndex, this));
+   }
+
+   void persistIndex()
+   {
+      persistPending_ = false;
+      if (indexPath_.isEmpty() || !searchIndex_.isDirty())
+         return;
+
+      Error error = searchIndex_.writeToFile(indexPath_);
+      if (error)
+         LOG_ERROR(error);
+   }
+
    void removeIndexEntry(const FileInfo& fileInfo)
    {
+      searchIndex_.remove(fileInfo.absolutePath());
+      schedulePersistIndex();
+
       // create a fake entry with a null source index to pass to find
       Entry entry(fileInfo, boost::shared_ptr<r_util::RSourceIndex>());
 
@@ -943,6 +1167,12 @@ private:
                filePath.hasTextMimeType());
    }
 
+   static bool isSearchableFile(const FileInfo& fileInfo)
+   {
+      // skip large files (as for R source files below)
+      return fileInfo.size() <= 2 * 1024 * 1024 && isSourceFile(fileInfo);
+   }
+
    static bool isIndexableSourceFile(const FileInfo& fileInfo)
    {
       FilePath filePath(fileInfo.absolutePath());
@@ -969,6 +1199,12 @@ private:
    // indexing queue
    bool indexing_;
    std::queue<core::system::FileChangeEvent> indexingQueue_;
+
+   // trigram index of file contents (and persisted R source items), kept in
+   // the project scratch directory across sessions
+   TrigramIndex searchIndex_;
+   FilePath indexPath_;
+   bool persistPending_;
 };
 
 } // anonymous namespace
@@ -1155,6 +1391,30 @@ boost::shared_ptr<r_util::RSourceIndex> getIndexedProjectFile(
    return projectIndex().get(filePath);
 }
 
+std::int64_t fileModificationTime(const std::string& path)
+{
+#ifndef _WIN32
+   struct stat info;
+   if (::stat(path.c_str(), &info) != 0)
+      return 0;
+
+# ifdef __APPLE__
+   const struct timespec& modified = info.st_mtimespec;
+# else
+   const struct timespec& modified = info.st_mtim;
+# endif
+   return static_cast<std::int64_t>(modified.tv_sec) * 1000000000 + modified.tv_nsec;
+#else
+   return static_cast<std::int64_t>(FilePath(path).getLastWriteTime()) * 1000000000;
+#endif
+}
+
+bool findFilesWithoutLiteral(const std::string& literal,
+                             std::map<std::string, std::int64_t>* pFiles)
+{
+   return projectIndex().findFilesWithoutLiteral(literal, pFiles);
+}
+
 void searchSource(const std::string& term,
                   std::size_t maxResults,
                   bool prefixOnly,
@@ -1299,86 +1559,6 @@ void searchFiles(const std::string& term,
    }
 }
 
-bool isUninterestingFile(const std::string& filename) 
-{
-   if (filename == "RcppExports.R" ||
-       filename == "RcppExports.cpp" ||
-       filename == "cpp11.R" ||
-       filename == "cpp11.cpp" ||
-       filename == "arrowExports.R" ||
-       filename == "arrowExports.cpp")
-      return true;
-
-   std::string extension = string_utils::getExtension(filename);
-   if (boost::algorithm::to_lower_copy(extension) == ".rd")
-      return true;
-   
-   return false;
-}
-
-// NOTE: When modifying this code, you should ensure that corresponding
-// changes are made to the client side scoreMatch function as well
-// (See: CodeSearchOracle.java)
-int scoreMatch(std::string const& suggestion,
-               std::string const& query,
-               bool isFile)
-{
-   // No penalty for perfect matches
-   if (suggestion == query)
-      return 0;
-   
-   std::vector<int> matches =
-         string_utils::subsequenceIndices(suggestion, query);
-   
-   int totalPenalty = 0;
-
-   // Loop over the matches and assign a score
-   for (int j = 0, n = gsl::narrow_cast<int>(matches.size()); j < n; j++)
-   {
-      int matchPos = matches[j];
-      int penalty = matchPos;
-
-      // Less penalty if character follows special delim
-      if (matchPos >= 1)
-      {
-         char prevChar = suggestion[matchPos - 1];
-         if (prevChar == '_' || prevChar == '-' || (!isFile && prevChar == '.'))
-         {
-            penalty = j + 1;
-         }
-      }
-
-      // Less penalty for perfect match (ie, reward case-sensitive match)
-      penalty -= suggestion[matchPos] == query[j];
-      
-      totalPenalty += penalty;
-   }
-   
-   // Penalize files
-   if (isFile)
-   {
-      ++totalPenalty;
-
-      // More penalty for 'uninteresting' files
-      if (isUninterestingFile(suggestion))
-         totalPenalty += 6;
-   }
-   
-   // Penalize unmatched characters
-   totalPenalty += gsl::narrow_cast<int>((query.size() - matches.size()) * query.size());
-
-   return totalPenalty;
-}
-
-struct ScorePairComparator
-{
-   inline bool operator()(const std::pair<int, int> lhs,
-                          const std::pair<int, int> rhs)
-   {
-      return lhs.second < rhs.second;
-   }
-};
-
 void filterScores(std::vector< std::pair<int, int> >* pScore1,
                   std::vector< std::pair<int, int> >* pScore2,
                   int maxAmount)
@@ -1746,6 +1926,16 @@ json::Array toJsonArray(
 
 
 
+// upper bound on the files and source items scored for a code search
+const std::size_t kMaxSearchCandidates = 50000;
+
+// has a newer search been queued behind the current one?
+bool isSearchSuperseded()
+{
+   return httpConnectionListener().mainConnectionQueue().peekNextConnectionUri() ==
+         "/rpc/search_code";
+}
+
 Error searchCode(const json::JsonRpcRequest& request,
                  json::JsonRpcResponse* pResponse)
 {
@@ -1768,17 +1958,16 @@ Error searchCode(const json::JsonRpcRequest& request,
    bool moreFilesAvailable = false;
    bool onlyTests = boost::algorithm::starts_with(term, "t ");
 
-   // TODO: Refactor searchSourceFiles, searchSource to no longer take maximum number
-   // of results (since we want to grab everything possible then filter before
-   // sending over the wire). Simiarly with the 'more*Available' bools
+   // grab (nearly) everything that matches and keep only the best scoring
+   // results before sending them over the wire
    if (!onlyTests)
-      searchFiles(term, 100, true, &names, &paths, &moreFilesAvailable);
+      searchFiles(term, kMaxSearchCandidates, true, &names, &paths, &moreFilesAvailable);
 
    // search source and convert to source items
    std::vector<SourceItem> srcItems;
    std::vector<r_util::RSourceItem> rSrcItems;
    bool moreSourceItemsAvailable = false;
-   searchSource(term, 100, false, &rSrcItems, &moreSourceItemsAvailable);
+   searchSource(term, kMaxSearchCandidates, false, &rSrcItems, &moreSourceItemsAvailable);
    std::transform(rSrcItems.begin(),
                   rSrcItems.end(),
                   std::back_inserter(srcItems),
@@ -1801,35 +1990,38 @@ Error searchCode(const json::JsonRpcRequest& request,
    // typedef necessary for range-based-for to work with pairs
    typedef std::pair<int, int> PairIntInt;
 
-   // score matches -- returned as a pair, mapping index to score
-   std::vector<PairIntInt> fileScores;
-   for (std::size_t i = 0; i < paths.size(); ++i)
+   // items are hidden() when coming from R and C++ files
+   // that contain the text "do not edit by hand"
+   std::vector<int> visibleItems;
+   std::vector<std::string> visibleItemNames;
+   for (std::size_t i = 0; i < srcItems.size(); ++i)
    {
-      fileScores.push_back(std::make_pair(gsl::narrow_cast<int>(i),
-                                          scoreMatch(names[i], term, true)));
-   }
+      if (srcItems[i].hidden())
+         continue;
 
-   // sort by score (lower is better)
-   std::sort(fileScores.begin(), fileScores.end(), ScorePairComparator());
+      visibleItems.push_back(gsl::narrow_cast<int>(i));
+      visibleItemNames.push_back(srcItems[i].name());
+   }
 
+   // score matches, keeping the best maxResults of each as pairs mapping
+   // index to score (sorted, lower is better). if the user has typed more
+   // in the meantime the search is abandoned and nothing is returned
+   std::vector<PairIntInt> fileScores;
    std::vector<PairIntInt> srcItemScores;
-   for (std::size_t i = 0; i < srcItems.size(); ++i)
+   if (!findBestMatches(names, term, true, maxResults, &fileScores, isSearchSuperseded) ||
+       !findBestMatches(visibleItemNames, term, false, maxResults, &srcItemScores, isSearchSuperseded))
    {
-      const SourceItem& item = srcItems[i];
-      // items are hidden() when coming from R and C++ files
-      // that contain the text "do not edit by hand" 
-      if (item.hidden())
-         continue;
-      
-      int score = scoreMatch(item.name(), term, false);
-      srcItemScores.push_back(std::make_pair(gsl::narrow_cast<int>(i), score));
+      fileScores.clear();
+      srcItemScores.clear();
    }
-   std::sort(srcItemScores.begin(), srcItemScores.end(), ScorePairComparator());
+
+   for (PairIntInt& pair : srcItemScores)
+      pair.first = visibleItems[pair.first];
 
    // filter so we keep only the top n results -- and proactively
    // update whether there are other entries we didn't report back
-   std::size_t srcItemScoresSizeBefore = srcItemScores.size();
-   std::size_t fileScoresSizeBefore = fileScores.size();
+   std::size_t srcItemScoresSizeBefore = visibleItems.size();
+   std::size_t fileScoresSizeBefore = names.size();
 
    filterScores(&fileScores, &srcItemScores, gsl::narrow_cast<int>(maxResults));
 
@@ -2508,6 +2700,7 @@ Error findFunctionInSearchPath(const json::JsonRpcRequest& request,
 
 void onFileMonitorEnabled(const tree<core::FileInfo>& files)
 {
+   projectIndex().loadPersistedIndex(files);
    projectIndex().enqueFiles(files.begin_leaf(), files.end_leaf());
 }
 
@@ -2537,8 +2730,9 @@ SEXP rs_scoreMatches(SEXP suggestionsSEXP,
    std::vector<int> scores;
    scores.reserve(n);
    
+   FuzzyMatcher matcher(query, false);
    for (int i = 0; i < n; i++)
-      scores.push_back(scoreMatch(suggestions[i], query, false));
+      scores.push_back(matcher.score(suggestions[i]));
    
    r::sexp::Protect protect;
    return r::sexp::create(scores, &protect);
@@ -16,6 +16,8 @@
 #ifndef SESSION_CODE_SEARCH_HPP
 #define SESSION_CODE_SEARCH_HPP
 
+#include <cstdint>
+
 #include <core/r_util/RSourceIndex.hpp>
 #include <session/SessionSourceDatabase.hpp>
 
@@ -102,6 +104,16 @@ RSourceIndexes& rSourceIndex();
 boost::shared_ptr<core::r_util::RSourceIndex> getIndexedProjectFile(
       const core::FilePath& filePath);
 
+// modification time of a file in nanoseconds (0 if it can't be determined);
+// the search index records files' modification times at this resolution
+std::int64_t fileModificationTime(const std::string& path);
+
+// files in the project's search index which can't contain literal (ignoring
+// ASCII case), with their modification times as of indexing; returns false
+// if the index can't narrow down a search for literal
+bool findFilesWithoutLiteral(const std::string& literal,
+                             std::map<std::string, std::int64_t>* pFiles);
+
 void searchSource(const std::string& term,
                   std::size_t maxResults,
                   bool prefixOnly,
@@ -640,6 +640,39 @@ void setFileLocalParseOptions(const std::wstring& rCode,
    applyOptions(options, pOptions);
 }
 
+// a document's block parser, along with the state outside the document its
+// blocks were parsed against (the packages known to the source index, and
+// those the document itself loads)
+struct DocumentParser
+{
+   boost::shared_ptr<BlockParser> pParser;
+   std::size_t packageStateGeneration;
+   std::vector<std::string> inferredPackages;
+};
+
+typedef std::map<std::string, DocumentParser> BlockParsers;
+
+// the block parsers for the documents being linted, so that linting a
+// document again after it's edited only parses the expressions that changed
+BlockParsers& blockParsers()
+{
+   static BlockParsers instance;
+   return instance;
+}
+
+std::vector<std::string> documentInferredPackages(const std::string& documentId,
+                                                  const FilePath& filePath)
+{
+   boost::shared_ptr<RSourceIndex> pIndex = code_search::rSourceIndex().get(documentId);
+   if (!pIndex)
+      pIndex = code_search::getIndexedProjectFile(filePath);
+   
+   if (!pIndex)
+      return std::vector<std::string>();
+   
+   return pIndex->getInferredPackages();
+}
+
 } // end anonymous namespace
 
 ParseResults parse(const std::wstring& rCode,
@@ -679,7 +712,34 @@ ParseResults parse(const std::wstring& rCode,
    if (noLint)
       return ParseResults();
    
-   results = rparser::parse(origin, rCode, options);
+   if (documentId.empty() || isFragment)
+   {
+      results = rparser::parse(origin, rCode, options);
+   }
+   else
+   {
+      // explicit requests parse the whole document, picking up changes in
+      // the session (e.g. to the functions defined) that blocks parsed
+      // before don't reflect; so does a change to the package information
+      // or the packages the document loads, which any block's lint may
+      // depend upon
+      std::size_t generation = RSourceIndex::packageStateGeneration();
+      std::vector<std::string> inferredPackages =
+            documentInferredPackages(documentId, origin);
+      
+      DocumentParser& parser = blockParsers()[documentId];
+      if (!parser.pParser ||
+          isExplicit ||
+          parser.packageStateGeneration != generation ||
+          parser.inferredPackages != inferredPackages)
+      {
+         parser.pParser.reset(new BlockParser());
+         parser.packageStateGeneration = generation;
+         parser.inferredPackages = inferredPackages;
+      }
+      
+      results = parser.pParser->parse(origin, rCode, options);
+   }
    
    ParseNode* pRoot = results.parseTree();
    if (!pRoot)
@@ -1020,6 +1080,7 @@ void onNAMESPACEchanged()
    
    RSourceIndex::setImportedPackages(importPkgNames);
    RSourceIndex::setImportFromDirectives(importFromSymbols);
+   blockParsers().clear();
    
    // Kick off an update of the cached async completions
    r_packages::AsyncPackageInformationProcess::update();
@@ -1038,6 +1099,23 @@ void onFilesChanged(const std::vector<core::system::FileChangeEvent>& events)
    }
 }
 
+void onSourceDocRemoved(const std::string& id, const std::string& path)
+{
+   blockParsers().erase(id);
+}
+
+void clearBlockParsers()
+{
+   blockParsers().clear();
+}
+
+void onConsoleInput(const std::string& input)
+{
+   // the code run may define (or remove) functions which the parse of
+   // calls to them relies on
+   clearBlockParsers();
+}
+
 void afterSessionInitHook(bool newSession)
 {
    if (projects::projectContext().hasProject() &&
@@ -1114,6 +1192,11 @@ core::Error initialize()
    using namespace module_context;
    
    events().afterSessionInitHook.connect(afterSessionInitHook);
+   events().onConsoleInput.connect(onConsoleInput);
+   events().onPackageLibraryMutated.connect(clearBlockParsers);
+   
+   source_database::events().onDocRemoved.connect(onSourceDocRemoved);
+   source_database::events().onRemoveAll.connect(clearBlockParsers);
    
    session::projects::FileMonitorCallbacks cb;
    cb.onFilesChanged = onFilesChanged;
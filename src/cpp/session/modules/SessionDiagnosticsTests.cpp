@@ -18,6 +18,7 @@
 #include "SessionDiagnostics.hpp"
 
 #include <iostream>
+#include <sstream>
 
 #include <core/collection/Tree.hpp>
 #include <shared_core/FilePath.hpp>
@@ -122,6 +123,56 @@ void lintRStudioRFiles()
    lintRFilesInSubdirectory(options().modulesRSourcePath());
 }
 
+std::string describeLint(const ParseResults& results)
+{
+   std::stringstream ss;
+   for (const LintItem& item : results.lint())
+   {
+      ss << item.startRow << ":" << item.startColumn << "-"
+         << item.endRow << ":" << item.endColumn << " "
+         << item.type << " " << item.message << std::endl;
+   }
+   
+   std::vector<ParseItem> unresolved;
+   results.parseTree()->findAllUnresolvedSymbols(&unresolved);
+   for (const ParseItem& item : unresolved)
+      ss << "unresolved " << item.symbol << " " << item.position.toString() << std::endl;
+   
+   ss << results.parseTree()->getChildren().size() << " functions" << std::endl;
+   return ss.str();
+}
+
+// parses the document with a block parser (after an edit), and checks that
+// the results are those of parsing the whole document
+void expectSameAsParse(BlockParser* pParser, const std::string& rCode)
+{
+   std::wstring code = string_utils::utf8ToWide(rCode);
+   std::string expected = describeLint(parse(FilePath(), code, s_parseOptions));
+   std::string actual = describeLint(pParser->parse(FilePath(), code, s_parseOptions));
+   CHECK(actual == expected);
+}
+
+// a document of top-level functions, each calling the one before
+std::string generateFunctions(int count)
+{
+   std::stringstream ss;
+   ss << "f0 <- function(x) x" << std::endl;
+   for (int i = 1; i < count; ++i)
+   {
+      ss << std::endl
+         << "# function " << i << std::endl
+         << "f" << i << " <- function(x, y = " << i << ")" << std::endl
+         << "{" << std::endl
+         << "   z <- f" << i - 1 << "(x) + y" << std::endl
+         << "   if (z > 0)" << std::endl
+         << "      z" << std::endl
+         << "   else" << std::endl
+         << "      -z" << std::endl
+         << "}" << std::endl;
+   }
+   return ss.str();
+}
+
 test_context("Diagnostics")
 {
    test_that("valid expressions generate no lint")
@@ -306,6 +357,155 @@ test_context("Diagnostics")
    }
 }
 
+test_context("Block parsing")
+{
+   test_that("parsing blocks gives the results of parsing the whole document")
+   {
+      BlockParser parser;
+      std::string code = generateFunctions(6);
+      expectSameAsParse(&parser, code);
+      
+      std::vector<std::string> edits = {
+         
+         // within a function, and adding a function
+         "   z <- f0(x) + y + w",
+         "f2 <- function(x) x",
+         
+         // defining a variable the functions after refer to
+         "w <- 1",
+         
+         // an unmatched (and then mismatched) bracket
+         "g <- function(x) {",
+         "g <- function(x) { x )",
+         
+         // statements which continue onto the rows after
+         "if (TRUE)",
+         "y <- 1 +",
+         "else",
+         "   ",
+         "",
+      };
+      
+      for (const std::string& edit : edits)
+      {
+         // insert the edit before a few rows, then replace the row with it
+         for (std::size_t row : { 0, 3, 8, 12, 24, 40 })
+         {
+            std::vector<std::string> lines;
+            boost::algorithm::split(lines, code, boost::algorithm::is_any_of("\n"));
+            
+            row = std::min(row, lines.size() - 1);
+            std::vector<std::string> inserted = lines;
+            inserted.insert(inserted.begin() + row, edit);
+            expectSameAsParse(&parser, boost::algorithm::join(inserted, "\n"));
+            
+            std::vector<std::string> replaced = lines;
+            replaced[row] = edit;
+            expectSameAsParse(&parser, boost::algorithm::join(replaced, "\n"));
+            
+            expectSameAsParse(&parser, code);
+         }
+      }
+   }
+   
+   test_that("a sequence of edits gives the results of parsing the whole document")
+   {
+      // each document is an edit of the one before, which changes where
+      // the top-level expressions end
+      std::vector<std::string> documents = {
+         
+         // a call whose arguments come to include the assignments after it
+         "f(a,\n  b)\nx <- 1\ny <- 2\n",
+         "f(a,\n  b\nx <- 1\ny <- 2\n",
+         "f(a,\n  b)\nx <- 1\ny <- 2\n",
+         
+         // an expression ending with a bracket, which the parser continues
+         // on the next line (as a call, with an assignment in its arguments)
+         "(x)\ny <- 1\nz <- 2\n",
+         "(x)\n(y <- 1)\nz <- 2\n",
+         "f <- function() {x}\n(y <- 1)\n[1]\n",
+         "f <- function() {x}\ny <- 1\n+ 1\n",
+         
+         // a symbol checked against the brace which starts the next line
+         "y <- 1 +\n  y\n\n{\n  b\n}\ny <- x\n",
+         "y <- 1 +\n  y\n\nz <- 1\ny <- x\n",
+         
+         // an error which stops the parse, and the rows after moving down
+         "if (x)\n  2\nh(x = 1,\n  y <- 1)\n",
+         "if x\n  2\nh(x = 1,\n  y <- 1)\n",
+         "if x\n\n  2\nh(x = 1,\n  y <- 1)\n",
+         "x; y\ny <- (x)\n@\n",
+         "x; y\n\ny <- (x)\n@\n",
+      };
+      
+      BlockParser parser;
+      for (const std::string& document : documents)
+         expectSameAsParse(&parser, document);
+   }
+   
+   test_that("only the edited blocks are parsed again")
+   {
+      BlockParser parser;
+      std::string code = generateFunctions(100);
+      expectSameAsParse(&parser, code);
+      expect_true(parser.blockCount() == 100);
+      expect_true(parser.parsedBlockCount() == 100);
+      
+      // editing the body of the last function
+      std::string edited = boost::algorithm::replace_first_copy(
+               code, "z <- f98(x) + y", "z <- f98(x) + y + 1");
+      expectSameAsParse(&parser, edited);
+      expect_true(parser.parsedBlockCount() == 1);
+      
+      // editing the body of a function parses the function which calls it
+      // (as calls are checked against the function's definition)
+      edited = boost::algorithm::replace_first_copy(
+               edited, "z <- f48(x) + y", "z <- f48(x) + y + 1");
+      expectSameAsParse(&parser, edited);
+      expect_true(parser.parsedBlockCount() == 2);
+      
+      // inserting a function (the rows after move down)
+      edited = boost::algorithm::replace_first_copy(
+               edited, "# function 60", "g <- function() NULL\n# function 60");
+      expectSameAsParse(&parser, edited);
+      expect_true(parser.blockCount() == 101);
+      expect_true(parser.parsedBlockCount() == 2);
+      
+      // redefining a function, after the inserted one
+      edited = boost::algorithm::replace_first_copy(
+               edited, "f70 <- function(x, y = 70)", "f70 <- function(x, y = 1)");
+      expectSameAsParse(&parser, edited);
+      expect_true(parser.parsedBlockCount() == 2);
+      
+      // nothing changed
+      expectSameAsParse(&parser, edited);
+      expect_true(parser.parsedBlockCount() == 0);
+   }
+}
+
+benchmark_context("Lint latency")
+{
+   // a document of 2,000 functions (about 18,000 lines), edited within
+   // the body of a function in the middle
+   std::wstring code = string_utils::utf8ToWide(generateFunctions(2000));
+   std::wstring edited = boost::algorithm::replace_first_copy(
+            code, std::wstring(L"z <- f999(x) + y"), std::wstring(L"z <- f999(x) + y + 1"));
+   
+   benchmark_that("Parse the whole document after an edit")
+   {
+      return parse(FilePath(), edited, s_parseOptions).lint().size();
+   };
+   
+   BlockParser parser;
+   parser.parse(FilePath(), code, s_parseOptions);
+   bool isEdited = false;
+   benchmark_that("Parse the edited block of the document")
+   {
+      isEdited = !isEdited;
+      return parser.parse(FilePath(), isEdited ? edited : code, s_parseOptions).lint().size();
+   };
+}
+
 } // namespace linter
 } // namespace modules
 } // namespace session
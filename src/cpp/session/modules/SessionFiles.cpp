@@ -128,8 +128,8 @@ void onResume(const Settings& settings)
                                             module_context::userHomePath());
 
       // start monitoriing
-      json::Array jsonFiles;
-      s_filesListingMonitor.start(resolvedPath, false, &jsonFiles);
+      FilesListing listing;
+      s_filesListingMonitor.start(resolvedPath, false, &listing);
    }
 
    quotas::checkQuotaStatus();
@@ -257,10 +257,8 @@ Error listFiles(const json::JsonRpcRequest& request, json::JsonRpcResponse* pRes
       return error;
    FilePath targetPath = module_context::resolveAliasedPath(path);
 
-   json::Object result;
-   
    // if this includes a request for monitoring
-   core::json::Array jsonFiles;
+   boost::shared_ptr<FilesListing> pListing(new FilesListing());
    if (monitor)
    {
       // always stop existing if we have one
@@ -269,26 +267,24 @@ Error listFiles(const json::JsonRpcRequest& request, json::JsonRpcResponse* pRes
       // install a monitor only if we aren't already covered by the project monitor
       if (!session::projects::projectContext().isMonitoringDirectory(targetPath))
       {
-         error = s_filesListingMonitor.start(targetPath, includeHidden, &jsonFiles);
+         error = s_filesListingMonitor.start(targetPath, includeHidden, pListing.get());
          if (error)
             return error;
       }
       else
       {
-         error = FilesListingMonitor::listFiles(targetPath, includeHidden, &jsonFiles);
+         error = FilesListingMonitor::listFiles(targetPath, includeHidden, pListing.get());
          if (error)
             return error;
       }
    }
    else
    {
-      error = FilesListingMonitor::listFiles(targetPath, includeHidden, &jsonFiles);
+      error = FilesListingMonitor::listFiles(targetPath, includeHidden, pListing.get());
       if (error)
          return error;
    }
 
-   result["files"] = jsonFiles;
-
    bool browseable = true;
 
 #ifndef _WIN32
@@ -298,9 +294,10 @@ Error listFiles(const json::JsonRpcRequest& request, json::JsonRpcResponse* pRes
       LOG_ERROR(error);
 #endif
 
-   result["is_parent_browseable"] = browseable;
-
-   pResponse->setResult(result);
+   // large directories produce large listings, so stream the result
+   pResponse->setResultWriter(filesListingResultWriter(
+         [=](json::Object* pFileObject) { return pListing->nextFile(pFileObject); },
+         browseable));
    return Success();
 }
 
@@ -1878,6 +1875,37 @@ bool isMonitoringDirectory(const FilePath& directory)
    return !monitoredPath.isEmpty() && (directory == monitoredPath);
 }
 
+json::JsonRpcResultWriter filesListingResultWriter(
+      const FilesListingSource& nextFile,
+      bool isParentBrowseable)
+{
+   // writes one file per call, so the listing is serialized in chunks
+   bool started = false;
+   return [=](json::Writer* pWriter) mutable
+   {
+      if (!started)
+      {
+         started = true;
+         pWriter->beginObject();
+         pWriter->key("files");
+         pWriter->beginArray();
+      }
+
+      json::Object fileObject;
+      if (nextFile(&fileObject))
+      {
+         pWriter->value(fileObject);
+         return true;
+      }
+
+      pWriter->endArray();
+      pWriter->key("is_parent_browseable");
+      pWriter->value(isParentBrowseable);
+      pWriter->endObject();
+      return false;
+   };
+}
+
 Error initialize()
 {
    // register suspend handler
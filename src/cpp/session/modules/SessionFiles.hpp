@@ -16,6 +16,10 @@
 #ifndef SESSION_SESSION_FILES_HPP
 #define SESSION_SESSION_FILES_HPP
 
+#include <boost/function.hpp>
+
+#include <core/json/JsonRpc.hpp>
+
 namespace rstudio {
 namespace core {
    class Error;
@@ -30,6 +34,16 @@ namespace files {
    
 bool isMonitoringDirectory(const core::FilePath& directory);
 
+// produces the json for the next file in a listing; returns false once
+// there are no more
+typedef boost::function<bool(core::json::Object*)> FilesListingSource;
+
+// streams a files listing as the result of a json rpc response (the json
+// for each file is only produced as it's written)
+core::json::JsonRpcResultWriter filesListingResultWriter(
+      const FilesListingSource& nextFile,
+      bool isParentBrowseable);
+
 core::Error initialize();
                        
 } // namespace files
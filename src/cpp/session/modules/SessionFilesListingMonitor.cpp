@@ -49,8 +49,35 @@ bool acceptAllFiles(const FileInfo&)
    return true;
 }
 
+FilesListing::FilesListing()
+   : index_(0),
+     includeHidden_(false)
+{
+}
+
+bool FilesListing::nextFile(json::Object* pFileObject)
+{
+   while (index_ < files_.size())
+   {
+      const FilePath& filePath = files_[index_++];
+
+      // files which may have been deleted after the listing or which
+      // are not end-user visible
+      if (filePath.exists() &&
+            (includeHidden_ || module_context::fileListingFilter(core::FileInfo(filePath),
+                prefs::userPrefs().hideObjectFiles())))
+      {
+         *pFileObject = module_context::createFileSystemItem(filePath);
+         pDecorationContext_->decorateFile(filePath, pFileObject);
+         return true;
+      }
+   }
+
+   return false;
+}
+
 Error FilesListingMonitor::start(const FilePath& filePath, bool includeHidden, 
-      json::Array* pJsonFiles)
+      FilesListing* pListing)
 {
    // always stop existing
    stop();
@@ -58,17 +85,16 @@ Error FilesListingMonitor::start(const FilePath& filePath, bool includeHidden,
    // save include hidden setting
    includeHidden_ = includeHidden;
 
-   // scan the directory (populates pJsonFiles out parameter)
-   std::vector<FilePath> files;
-   Error error = listFiles(filePath, &files, includeHidden, pJsonFiles);
+   // scan the directory (populates pListing out parameter)
+   Error error = listFiles(filePath, includeHidden, pListing);
    if (error)
       return error;
 
    // copy the file listing into a vector of FileInfo which we will order so that it can
    // be compared with the initial scan of the file monitor for changes
    std::vector<FileInfo> prevFiles;
-   std::transform(files.begin(),
-                  files.end(),
+   std::transform(pListing->files_.begin(),
+                  pListing->files_.end(),
                   std::back_inserter(prevFiles),
                   core::toFileInfo);
 
@@ -195,36 +221,24 @@ void FilesListingMonitor::onUnregistered(core::system::file_monitor::Handle hand
 }
 
 Error FilesListingMonitor::listFiles(const FilePath& rootPath,
-                                     std::vector<FilePath>* pFiles,
                                      bool includeHidden,
-                                     json::Array* pJsonFiles)
+                                     FilesListing* pListing)
 {
    // enumerate the files
-   pFiles->clear();
-   core::Error error = rootPath.getChildren(*pFiles);
+   pListing->files_.clear();
+   pListing->index_ = 0;
+   core::Error error = rootPath.getChildren(pListing->files_);
    if (error)
       return error;
 
-   using namespace source_control;
-   auto pCtx = source_control::fileDecorationContext(rootPath, false);
-
    // sort the files by name
-   std::sort(pFiles->begin(), pFiles->end(), FilePath::isEqualCaseInsensitive);
+   std::sort(pListing->files_.begin(),
+             pListing->files_.end(),
+             FilePath::isEqualCaseInsensitive);
 
-   // produce json listing
-   for (core::FilePath& filePath : *pFiles)
-   {
-      // files which may have been deleted after the listing or which
-      // are not end-user visible
-      if (filePath.exists() && 
-            (includeHidden || module_context::fileListingFilter(core::FileInfo(filePath),
-                prefs::userPrefs().hideObjectFiles())))
-      {
-         core::json::Object fileObject = module_context::createFileSystemItem(filePath);
-         pCtx->decorateFile(filePath, &fileObject);
-         pJsonFiles->push_back(fileObject);
-      }
-   }
+   // the json for each file is produced as it's read from the listing
+   pListing->includeHidden_ = includeHidden;
+   pListing->pDecorationContext_ = source_control::fileDecorationContext(rootPath, false);
 
    return Success();
 }
@@ -19,6 +19,7 @@
 #include <string>
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
 #include <boost/utility.hpp>
 
 #include <core/collection/Tree.hpp>
@@ -45,14 +46,38 @@ namespace modules {
       class StatusResult;
    }
 
+   namespace source_control {
+      class FileDecorationContext;
+   }
+
 namespace files {
 
+// the files in a directory, whose json is produced a file at a time (so
+// that a large listing needn't be held in memory as json)
+class FilesListing : boost::noncopyable
+{
+public:
+   FilesListing();
+
+   // produces the json for the next file listed (skipping any which have
+   // since been deleted); returns false once there are no more
+   bool nextFile(core::json::Object* pFileObject);
+
+private:
+   friend class FilesListingMonitor;
+
+   std::vector<core::FilePath> files_;
+   std::size_t index_;
+   bool includeHidden_;
+   boost::shared_ptr<source_control::FileDecorationContext> pDecorationContext_;
+};
+
 class FilesListingMonitor : boost::noncopyable
 {
 public:
    // kickoff monitoring
    core::Error start(const core::FilePath& filePath, 
-         bool includeHidden, core::json::Array* pJsonFiles);
+         bool includeHidden, FilesListing* pListing);
 
    void stop();
 
@@ -63,11 +88,7 @@ public:
    // don't specify monitoring (e.g. file dialog listing)
    static core::Error listFiles(const core::FilePath& rootPath,
                                 bool includeHidden,
-                                core::json::Array* pJsonFiles)
-   {
-      std::vector<core::FilePath> files;
-      return listFiles(rootPath, &files, includeHidden, pJsonFiles);
-   }
+                                FilesListing* pListing);
 
 private:
    // stateful handlers for registration and unregistration
@@ -78,12 +99,6 @@ private:
 
    void onUnregistered(core::system::file_monitor::Handle handle);
 
-   // helpers
-   static core::Error listFiles(const core::FilePath& rootPath,
-                                std::vector<core::FilePath>* pFiles,
-                                bool includeHidden, 
-                                core::json::Array* pJsonFiles);
-
 private:
    core::FilePath currentPath_;
    bool includeHidden_;
@@ -0,0 +1,162 @@
+/*
+ * SessionFilesTests.cpp
+ *
+ * Copyright (C) 2026 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "SessionFiles.hpp"
+
+#include <sstream>
+
+#include <boost/make_shared.hpp>
+
+#include <shared_core/json/Json.hpp>
+
+#include <core/http/Response.hpp>
+#include <core/json/JsonRpc.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace files {
+namespace tests {
+
+using namespace rstudio::core;
+
+namespace {
+
+boost::shared_ptr<json::Array> createListing(int count)
+{
+   boost::shared_ptr<json::Array> pFiles = boost::make_shared<json::Array>();
+   for (int i = 0; i < count; ++i)
+   {
+      json::Object file;
+      file["path"] = "~/project/file-" + std::to_string(i) + ".R";
+      file["length"] = i * 1024;
+      file["exists"] = true;
+      file["is_directory"] = false;
+      pFiles->push_back(file);
+   }
+   return pFiles;
+}
+
+// produces the files of a listing one at a time (as FilesListing does),
+// counting those produced
+FilesListingSource listingSource(const boost::shared_ptr<json::Array>& pFiles,
+                                 std::size_t* pProduced = nullptr)
+{
+   auto pIndex = boost::make_shared<std::size_t>(0);
+   return [=](json::Object* pFileObject)
+   {
+      if (*pIndex >= pFiles->getSize())
+         return false;
+
+      *pFileObject = (*pFiles)[(*pIndex)++].getObject();
+      if (pProduced)
+         *pProduced = *pIndex;
+      return true;
+   };
+}
+
+std::string bufferedBody(const boost::shared_ptr<json::Array>& pFiles)
+{
+   json::Object result;
+   result["files"] = *pFiles;
+   result["is_parent_browseable"] = true;
+
+   json::JsonRpcResponse response;
+   response.setResult(result);
+
+   std::ostringstream body;
+   response.write(body);
+   return body.str();
+}
+
+std::string streamedBody(const boost::shared_ptr<json::Array>& pFiles)
+{
+   json::JsonRpcResponse response;
+   response.setResultWriter(filesListingResultWriter(listingSource(pFiles), true));
+
+   http::Response httpResponse;
+   json::setJsonRpcResponse(response, &httpResponse);
+
+   std::string body;
+   boost::shared_ptr<http::StreamResponse> pStream = httpResponse.getStreamResponse();
+   while (std::shared_ptr<http::StreamBuffer> pBuffer = pStream->nextBuffer())
+      body.append(pBuffer->data, pBuffer->size);
+   return body;
+}
+
+} // anonymous namespace
+
+test_context("Files listing")
+{
+   test_that("Streamed listing equals the buffered listing")
+   {
+      for (int count : { 0, 1, 5000 })
+      {
+         boost::shared_ptr<json::Array> pFiles = createListing(count);
+
+         json::Value streamed, buffered;
+         REQUIRE_FALSE(streamed.parse(streamedBody(pFiles)));
+         REQUIRE_FALSE(buffered.parse(bufferedBody(pFiles)));
+         expect_true(streamed == buffered);
+      }
+   }
+
+   test_that("Files are produced as the listing is written")
+   {
+      boost::shared_ptr<json::Array> pFiles = createListing(5000);
+      std::size_t produced = 0;
+
+      json::JsonRpcResponse response;
+      response.setResultWriter(filesListingResultWriter(listingSource(pFiles, &produced), true));
+
+      http::Response httpResponse;
+      json::setJsonRpcResponse(response, &httpResponse);
+      expect_true(produced == 0);
+
+      // only enough files for the first chunk are produced
+      boost::shared_ptr<http::StreamResponse> pStream = httpResponse.getStreamResponse();
+      REQUIRE(pStream->nextBuffer());
+      expect_true(produced > 0);
+      expect_true(produced < pFiles->getSize());
+
+      while (pStream->nextBuffer())
+      {
+      }
+      expect_true(produced == pFiles->getSize());
+   }
+
+   test_that("Async responses include the streamed listing")
+   {
+      boost::shared_ptr<json::Array> pFiles = createListing(10);
+
+      json::JsonRpcResponse response;
+      response.setResultWriter(filesListingResultWriter(listingSource(pFiles), false));
+
+      json::Object raw = response.getRawResponse();
+      expect_false(response.hasResultWriter());
+
+      json::Object result = raw[json::kRpcResult].getObject();
+      expect_true(result["files"].getArray() == *pFiles);
+      expect_false(result["is_parent_browseable"].getBool());
+   }
+}
+
+} // namespace tests
+} // namespace files
+} // namespace modules
+} // namespace session
+} // namespace rstudio
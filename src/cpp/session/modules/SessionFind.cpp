@@ -14,19 +14,23 @@
  */
 
 #include "SessionFind.hpp"
+#include "SessionCodeSearch.hpp"
 
 #include <algorithm>
 #include <gsl/gsl>
 
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/make_shared.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/bind/bind.hpp>
 
 #include <core/Exec.hpp>
+#include <core/FileSearch.hpp>
 #include <core/StringUtils.hpp>
 #include <core/system/Environment.hpp>
 #include <core/system/Process.hpp>
+#include <core/system/System.hpp>
 #include <core/system/ShellUtils.hpp>
 
 #include <r/RUtil.hpp>
@@ -403,6 +407,20 @@ FindInFilesState& findResults()
    return instance;
 }
 
+bool shouldSkipFile(std::string file)
+{
+   return (file.find("/.Rproj.user/") != std::string::npos ||
+           file.find("/.quarto/") != std::string::npos ||
+           file.find("/.git/") != std::string::npos ||
+           file.find("/.svn/") != std::string::npos ||
+           file.find("/packrat/lib/") != std::string::npos ||
+           file.find("/packrat/src/") != std::string::npos ||
+           file.find("/renv/library/") != std::string::npos ||
+           file.find("/renv/python/") != std::string::npos ||
+           file.find("/renv/staging/") != std::string::npos ||
+           file.find("/.Rhistory") != std::string::npos);
+}
+
 class GrepOperation : public boost::enable_shared_from_this<GrepOperation>
 {
 public:
@@ -458,9 +476,32 @@ private:
       std::string decodedPreview;
       std::string decodedContents;
       std::string encodedContents;
+
+      // match offsets within encodedContents, when known up front (the
+      // native search reports them directly rather than via color codes)
+      bool hasEncodedMatches = false;
+      json::Array encodedMatchOn;
+      json::Array encodedMatchOff;
+   };
+
+   struct Results
+   {
+      json::Array files;
+      json::Array lineNums;
+      json::Array contents;
+      json::Array matchOns;
+      json::Array matchOffs;
+      json::Array replaceMatchOns;
+      json::Array replaceMatchOffs;
+      json::Array errors;
    };
 
    bool onContinue(const core::system::ProcessOperations& /*ops*/) const
+   {
+      return isActive();
+   }
+
+   bool isActive() const
    {
       return findResults().isRunning() && findResults().handle() == handle();
    }
@@ -807,7 +848,15 @@ private:
       size_t eMatchOn = 0;
       size_t eMatchOff = 0;
 
-      cleanLineAndGetMatches(&pLineInfo->encodedContents, &eMatchOnArray, &eMatchOffArray);
+      if (pLineInfo->hasEncodedMatches)
+      {
+         eMatchOnArray = pLineInfo->encodedMatchOn;
+         eMatchOffArray = pLineInfo->encodedMatchOff;
+      }
+      else
+      {
+         cleanLineAndGetMatches(&pLineInfo->encodedContents, &eMatchOnArray, &eMatchOffArray);
+      }
 
       while (findResults().isRunning() &&
              inputLineNum_ < lineNum && std::getline(*inputStream_, line))
@@ -936,18 +985,138 @@ private:
       return Success();
    }
 
-   bool shouldSkipFile(std::string file)
+   void addMatch(const std::string& file,
+                 const FilePath& fullPath,
+                 int lineNum,
+                 LineInfo* pLineInfo,
+                 const json::Array& matchOn,
+                 const json::Array& matchOff,
+                 Results* pResults)
+   {
+      std::set<std::string> errorMessage;
+      json::Array replaceMatchOn, replaceMatchOff;
+
+      if (findResults().replace() &&
+          !(findResults().preview() &&
+            findResults().replacePattern().empty()))
+      {
+         // check if we are looking at a new file
+         if (currentFile_.empty() || currentFile_ != fullPath.getAbsolutePath())
+         {
+            if (!currentFile_.empty())
+               completeFileReplace(&errorMessage);
+            Error error = initializeFileForReplace(fullPath);
+            if (error)
+               addReplaceErrorMessage(error.asString(), &errorMessage,
+                  &replaceMatchOn, &replaceMatchOff, &fileSuccess_);
+         }
+         else if (!fileSuccess_)
+         {
+            // the first time a file is processed it gets a more detailed initialization error
+            addReplaceErrorMessage("Cannot perform replace", &errorMessage,
+               &replaceMatchOn, &replaceMatchOff, &fileSuccess_);
+         }
+         if (!fileSuccess_ || pLineInfo->decodedPreview.length() > MAX_LINE_LENGTH)
+         {
+            // if we failed for any reason, update the progress
+            if (!findResults().preview())
+               findResults().replaceProgress()->
+                  addUnits(gsl::narrow_cast<int>(matchOn.getSize()));
+            if (fileSuccess_)
+            {
+               bool lineSuccess;
+               addReplaceErrorMessage("Line exceeds maximum character length for replace",
+                  &errorMessage, &replaceMatchOn, &replaceMatchOff, &lineSuccess);
+            }
+         }
+         else
+         {
+             processReplace(lineNum,
+                            matchOn, matchOff,
+                            pLineInfo,
+                            &replaceMatchOn, &replaceMatchOff,
+                            &errorMessage);
+            pLineInfo->decodedPreview = pLineInfo->decodedContents;
+            adjustForPreview(&pLineInfo->decodedPreview, &replaceMatchOn, &replaceMatchOff);
+         }
+      }
+
+      pResults->files.push_back(file);
+      pResults->lineNums.push_back(lineNum);
+      pResults->contents.push_back(pLineInfo->decodedPreview);
+      pResults->matchOns.push_back(matchOn);
+      pResults->matchOffs.push_back(matchOff);
+      pResults->replaceMatchOns.push_back(replaceMatchOn);
+      pResults->replaceMatchOffs.push_back(replaceMatchOff);
+      json::Array combinedErrors = json::toJsonArray(errorMessage);
+      pResults->errors.push_back(combinedErrors);
+   }
+
+   void publishResults(Results* pResults, int recordsToProcess)
+   {
+      // when doing a replace, we haven't completed the replace for the last file here
+      if (findResults().replace() && !currentFile_.empty() && !findResults().preview())
+      {
+         std::set<std::string> errorMessage;
+         completeFileReplace(&errorMessage);
+
+         // it is unlikely there will be any errors if we've made it this far,
+         // but if so we must add them to the last array in errors
+         // if there is an error, there will only be one
+         if (!errorMessage.empty())
+         {
+            json::Array lastErrors = pResults->errors.getBack().getArray();
+            pResults->errors.erase(--pResults->errors.end());
+            lastErrors.push_back(json::Value(*errorMessage.begin()));
+            pResults->errors.push_back(lastErrors);
+         }
+      }
+
+      if (pResults->files.getSize() > 0)
+      {
+         json::Object result;
+         result["handle"] = handle();
+         json::Object results;
+         results["file"] = pResults->files;
+         results["line"] = pResults->lineNums;
+         results["lineValue"] = pResults->contents;
+         results["matchOn"] = pResults->matchOns;
+         results["matchOff"] = pResults->matchOffs;
+         results["replaceMatchOn"] = pResults->replaceMatchOns;
+         results["replaceMatchOff"] = pResults->replaceMatchOffs;
+         results["errors"] = pResults->errors;
+         result["results"] = results;
+
+         findResults().addResult(handle(),
+                                 pResults->files,
+                                 pResults->lineNums,
+                                 pResults->contents,
+                                 pResults->matchOns,
+                                 pResults->matchOffs,
+                                 pResults->replaceMatchOns,
+                                 pResults->replaceMatchOffs);
+
+         if (!findResults().replace() || findResults().preview())
+            module_context::enqueClientEvent(
+                     ClientEvent(client_events::kFindResult, result));
+         else
+            module_context::enqueClientEvent(
+                    ClientEvent(client_events::kReplaceResult, result));
+      }
+
+      if (recordsToProcess <= 0)
+      {
+         if (!findResults().replace())
+            findResults().onFindEnd(handle());
+         else
+            findResults().onReplaceEnd(handle());
+      }
+   }
+
+   int recordsToProcess() const
    {
-      return (file.find("/.Rproj.user/") != std::string::npos ||
-              file.find("/.quarto/") != std::string::npos ||
-              file.find("/.git/") != std::string::npos ||
-              file.find("/.svn/") != std::string::npos ||
-              file.find("/packrat/lib/") != std::string::npos ||
-              file.find("/packrat/src/") != std::string::npos ||
-              file.find("/renv/library/") != std::string::npos ||
-              file.find("/renv/python/") != std::string::npos ||
-              file.find("/renv/staging/") != std::string::npos ||
-              file.find("/.Rhistory") != std::string::npos);
+      int recordsToProcess = MAX_COUNT + 1 - findResults().resultCount();
+      return std::max(recordsToProcess, 0);
    }
 
    void onStdout(const core::system::ProcessOperations& /*ops*/, const std::string& data)
@@ -955,18 +1124,8 @@ private:
       if (debugging())
          std::cerr << "stdout: " << data << std::endl;
 
-      json::Array files;
-      json::Array lineNums;
-      json::Array contents;
-      json::Array matchOns;
-      json::Array matchOffs;
-      json::Array replaceMatchOns;
-      json::Array replaceMatchOffs;
-      json::Array errors;
-
-      int recordsToProcess = MAX_COUNT + 1 - findResults().resultCount();
-      if (recordsToProcess < 0)
-         recordsToProcess = 0; 
+      Results results;
+      int recordsToProcess = this->recordsToProcess();
 
       // directories that should be ignored (e.g. virtual envs, website outpu
       std::vector<FilePath> ignoreDirs = module_context::ignoreContentDirs();
@@ -974,14 +1133,12 @@ private:
       stdOutBuf_.append(data);
       size_t nextLineStart = 0;
       size_t pos = -1;
-      std::set<std::string> errorMessage;
       while (recordsToProcess &&
              std::string::npos != (pos = stdOutBuf_.find('\n', pos + 1)))
       {
          std::string line = stdOutBuf_.substr(nextLineStart, pos - nextLineStart);
          nextLineStart = pos + 1;
 
-         errorMessage.clear();
          boost::smatch match;
          boost::regex pattern = getGrepOutputRegex(findResults().gitFlag());
          if (regex_utils::match(line, match, pattern) && match.size() > 1)
@@ -1030,7 +1187,6 @@ private:
             }
 
             json::Array matchOn, matchOff;
-            json::Array replaceMatchOn, replaceMatchOff;
             processContents(&lineInfo.decodedPreview, &lineInfo.decodedContents,
                &matchOn, &matchOff);
 
@@ -1039,127 +1195,156 @@ private:
             if (matchOn.getSize() == 0)
                continue;
 
-            if (findResults().replace() &&
-                !(findResults().preview() &&
-                  findResults().replacePattern().empty()))
-            {
-               // check if we are looking at a new file
-               if (currentFile_.empty() || currentFile_ != fullPath.getAbsolutePath())
-               {
-                  if (!currentFile_.empty())
-                     completeFileReplace(&errorMessage);
-                  Error error = initializeFileForReplace(fullPath);
-                  if (error)
-                     addReplaceErrorMessage(error.asString(), &errorMessage,
-                        &replaceMatchOn, &replaceMatchOff, &fileSuccess_);
-               }
-               else if (!fileSuccess_)
-               {
-                  // the first time a file is processed it gets a more detailed initialization error
-                  addReplaceErrorMessage("Cannot perform replace", &errorMessage,
-                     &replaceMatchOn, &replaceMatchOff, &fileSuccess_);
-               }
-               if (!fileSuccess_ || lineInfo.decodedPreview.length() > MAX_LINE_LENGTH)
-               {
-                  // if we failed for any reason, update the progress
-                  if (!findResults().preview())
-                     findResults().replaceProgress()->
-                        addUnits(gsl::narrow_cast<int>(matchOn.getSize()));
-                  if (fileSuccess_)
-                  {
-                     bool lineSuccess;
-                     addReplaceErrorMessage("Line exceeds maximum character length for replace",
-                        &errorMessage, &replaceMatchOn, &replaceMatchOff, &lineSuccess);
-                  }
-               }
-               else
-               {
-                   processReplace(lineNum,
-                                  matchOn, matchOff,
-                                  &lineInfo,
-                                  &replaceMatchOn, &replaceMatchOff,
-                                  &errorMessage);
-                  lineInfo.decodedPreview = lineInfo.decodedContents;
-                  adjustForPreview(&lineInfo.decodedPreview, &replaceMatchOn, &replaceMatchOff);
-               }
-            }
-
-            files.push_back(file);
-            lineNums.push_back(lineNum);
-            contents.push_back(lineInfo.decodedPreview);
-            matchOns.push_back(matchOn);
-            matchOffs.push_back(matchOff);
-            replaceMatchOns.push_back(replaceMatchOn);
-            replaceMatchOffs.push_back(replaceMatchOff);
-            json::Array combinedErrors = json::toJsonArray(errorMessage);
-            errors.push_back(combinedErrors);
+            addMatch(file, fullPath, lineNum, &lineInfo, matchOn, matchOff, &results);
             recordsToProcess--;
          }
       }
-      // when doing a replace, we haven't completed the replace for the last file here
-      if (findResults().replace() && !currentFile_.empty() && !findResults().preview())
-      {
-         std::set<std::string> errorMessage;
-         completeFileReplace(&errorMessage);
-
-         // it is unlikely there will be any errors if we've made it this far,
-         // but if so we must add them to the last array in errors
-         // if there is an error, there will only be one
-         if (!errorMessage.empty())
-         {
-            json::Array lastErrors = errors.getBack().getArray();
-            errors.erase(--errors.end());
-            lastErrors.push_back(json::Value(*errorMessage.begin()));
-            errors.push_back(lastErrors);
-         }
-      }
 
       if (nextLineStart)
       {
          stdOutBuf_.erase(0, nextLineStart);
       }
 
-      if (files.getSize() > 0)
+      publishResults(&results, recordsToProcess);
+   }
+
+   void appendDecoded(const std::string& encoded,
+                      std::size_t begin,
+                      std::size_t end,
+                      std::string* pDecodedLine,
+                      std::size_t* pUtf8CharactersProcessed)
+   {
+      std::string decoded = Replacer::decode(encoded.substr(begin, end - begin),
+                                             encoding_,
+                                             firstDecodeError_);
+      pDecodedLine->append(decoded);
+
+      std::size_t charSize;
+      Error error = string_utils::utf8Distance(decoded.begin(), decoded.end(), &charSize);
+      if (error)
+         charSize = decoded.size();
+      *pUtf8CharactersProcessed += charSize;
+   }
+
+   // the equivalent of processContents for a line found by the native search,
+   // whose match offsets are byte offsets into the (encoded) line
+   bool processNativeMatch(const file_search::LineMatch& match,
+                           LineInfo* pLineInfo,
+                           json::Array* pMatchOn,
+                           json::Array* pMatchOff)
+   {
+      // trim the line as we do grep output
+      std::string trimmed = boost::algorithm::trim_copy(match.contents);
+      std::size_t leading = trimmed.empty() ? 0 : match.contents.find(trimmed);
+      pLineInfo->leadingWhitespace = match.contents.substr(0, leading);
+      pLineInfo->trailingWhitespace = match.contents.substr(leading + trimmed.size());
+      pLineInfo->encodedContents = trimmed;
+      pLineInfo->hasEncodedMatches = true;
+
+      std::string decodedLine;
+      std::size_t nUtf8CharactersProcessed = 0;
+      std::size_t processed = 0;
+      for (const auto& range : match.ranges)
+      {
+         // clamp matches of leading or trailing whitespace to the trimmed line
+         std::size_t begin = std::min(std::max(range.first, leading) - leading, trimmed.size());
+         std::size_t end = std::min(std::max(range.second, leading) - leading, trimmed.size());
+         if (begin >= end || begin < processed)
+            continue;
+
+         appendDecoded(trimmed, processed, begin, &decodedLine, &nUtf8CharactersProcessed);
+         pMatchOn->push_back(gsl::narrow_cast<int>(nUtf8CharactersProcessed));
+         appendDecoded(trimmed, begin, end, &decodedLine, &nUtf8CharactersProcessed);
+         pMatchOff->push_back(gsl::narrow_cast<int>(nUtf8CharactersProcessed));
+
+         pLineInfo->encodedMatchOn.push_back(gsl::narrow_cast<int>(begin));
+         pLineInfo->encodedMatchOff.push_back(gsl::narrow_cast<int>(end));
+         processed = end;
+      }
+
+      if (pMatchOn->getSize() == 0)
+         return false;
+
+      appendDecoded(trimmed, processed, trimmed.size(), &decodedLine, &nUtf8CharactersProcessed);
+
+      pLineInfo->decodedContents = decodedLine;
+      if (!findResults().replace())
+         adjustForPreview(&decodedLine, pMatchOn, pMatchOff);
+      pLineInfo->decodedPreview = decodedLine;
+      return true;
+   }
+
+   void onSearchResults(const std::vector<file_search::FileMatches>& matches)
+   {
+      Results results;
+      int recordsToProcess = this->recordsToProcess();
+
+      for (const file_search::FileMatches& fileMatches : matches)
       {
-         json::Object result;
-         result["handle"] = handle();
-         json::Object results;
-         results["file"] = files;
-         results["line"] = lineNums;
-         results["lineValue"] = contents;
-         results["matchOn"] = matchOns;
-         results["matchOff"] = matchOffs;
-         results["replaceMatchOn"] = replaceMatchOns;
-         results["replaceMatchOff"] = replaceMatchOffs;
-         results["errors"] = errors;
-         result["results"] = results;
+         std::string file = module_context::createAliasedPath(fileMatches.file);
+         for (const file_search::LineMatch& lineMatch : fileMatches.lines)
+         {
+            if (!recordsToProcess)
+               break;
 
-         findResults().addResult(handle(),
-                                 files,
-                                 lineNums,
-                                 contents,
-                                 matchOns,
-                                 matchOffs,
-                                 replaceMatchOns,
-                                 replaceMatchOffs);
+            LineInfo lineInfo;
+            json::Array matchOn, matchOff;
+            if (!processNativeMatch(lineMatch, &lineInfo, &matchOn, &matchOff))
+               continue;
 
-         if (!findResults().replace() || findResults().preview())
-            module_context::enqueClientEvent(
-                     ClientEvent(client_events::kFindResult, result));
-         else
-            module_context::enqueClientEvent(
-                    ClientEvent(client_events::kReplaceResult, result));
+            addMatch(file, fileMatches.file, lineMatch.line, &lineInfo, matchOn, matchOff, &results);
+            recordsToProcess--;
+         }
       }
 
-      if (recordsToProcess <= 0)
+      publishResults(&results, recordsToProcess);
+   }
+
+   bool pollNativeSearch()
+   {
+      if (isActive())
       {
-         if (!findResults().replace())
-            findResults().onFindEnd(handle());
-         else
-            findResults().onReplaceEnd(handle());
+         // check for completion before taking results so none are missed
+         bool complete = pSearch_->isComplete();
+
+         std::vector<file_search::FileMatches> matches;
+         pSearch_->takeResults(&matches);
+         if (!matches.empty())
+            onSearchResults(matches);
+
+         if (!complete && isActive())
+            return true;
       }
+
+      pSearch_->stop();
+      onExit(0);
+      return false;
    }
 
+public:
+   Error startNativeSearch(const std::vector<FilePath>& roots,
+                           const file_search::SearchOptions& options)
+   {
+      pSearch_.reset(new file_search::FileSearch());
+
+      // block all signals for the creation of the search threads
+      core::system::SignalBlocker signalBlocker;
+      Error error = signalBlocker.blockAll();
+      if (error)
+         return error;
+
+      return pSearch_->start(roots, options);
+   }
+
+   void pollNativeSearchResults()
+   {
+      module_context::schedulePeriodicWork(
+               boost::posix_time::milliseconds(50),
+               boost::bind(&GrepOperation::pollNativeSearch, shared_from_this()),
+               false);
+   }
+
+private:
    void onStderr(const core::system::ProcessOperations& /*ops*/, const std::string& data)
    {
       if (debugging())
@@ -1195,6 +1380,7 @@ private:
 #endif
    int inputLineNum_;
    bool fileSuccess_;
+   boost::shared_ptr<file_search::FileSearch> pSearch_;
 };
 
 } // end anonymous namespace
@@ -1284,6 +1470,16 @@ public:
       return excludeArgs_;
    }
 
+   const std::vector<std::string>& includeGlobs() const
+   {
+      return includeGlobs_;
+   }
+
+   const std::vector<std::string>& excludeGlobs() const
+   {
+      return excludeGlobs_;
+   }
+
 private:
 
    bool asRegex_;
@@ -1298,11 +1494,13 @@ private:
 
    // derived from includeFilePatterns
    std::vector<std::string> includeArgs_;
+   std::vector<std::string> includeGlobs_;
    bool packageSourceFlag_;
    bool packageTestsFlag_;
 
    // derived from excludeFilePatterns
    std::vector<std::string> excludeArgs_;
+   std::vector<std::string> excludeGlobs_;
    
    void processExcludeFilePatterns()
    {
@@ -1313,6 +1511,8 @@ private:
          else
          {
             std::string excludeText = boost::algorithm::trim_copy(filePattern.getString());
+            if (!excludeText.empty())
+               excludeGlobs_.push_back(excludeText);
 
             if (gitFlag_)
             {
@@ -1343,6 +1543,7 @@ private:
                packageTestsFlag_ = true;
             else if (!includeText.empty())
            {
+              includeGlobs_.push_back(includeText);
               if (gitFlag_)
               {
                  includeArgs_.push_back(includeText);
@@ -1404,8 +1605,82 @@ void addDirectoriesToCommand(
    }
 }
 
-core::Error runGrepOperation(const GrepOptions& grepOptions, const ReplaceOptions& replaceOptions,
-   LocalProgress* pProgress, json::JsonRpcResponse* pResponse)
+std::vector<FilePath> nativeSearchRoots(const GrepOptions& grepOptions,
+                                        const FilePath& directoryPath)
+{
+   // the native equivalent of addDirectoriesToCommand
+   std::vector<FilePath> roots;
+   if (grepOptions.packageSourceFlag())
+   {
+      for (const char* dir : { "R", "src" })
+      {
+         FilePath path = directoryPath.completeChildPath(dir);
+         if (path.exists())
+            roots.push_back(path);
+      }
+   }
+   else if (grepOptions.packageTestsFlag())
+   {
+      FilePath testsPath = directoryPath.completeChildPath("tests");
+      if (testsPath.exists())
+         roots.push_back(testsPath);
+   }
+
+   if (roots.empty())
+      roots.push_back(directoryPath);
+   return roots;
+}
+
+file_search::SearchOptions nativeSearchOptions(const GrepOptions& grepOptions,
+                                               const std::string& encodedPattern)
+{
+   file_search::SearchOptions options;
+   options.pattern = encodedPattern;
+   options.asRegex = grepOptions.asRegex();
+   options.ignoreCase = grepOptions.ignoreCase();
+   if (!grepOptions.anyPackageFlag())
+      options.includePatterns = grepOptions.includeGlobs();
+   options.excludePatterns = grepOptions.excludeGlobs();
+   options.excludeGitIgnore = grepOptions.gitFlag() && grepOptions.excludeGitIgnore();
+
+   // use the project's search index to rule out files which can't contain
+   // the pattern (unless they've changed since they were indexed); the index
+   // only folds ASCII case
+   auto pUnmatchedFiles = boost::make_shared<std::map<std::string, std::int64_t> >();
+   std::string literal = options.asRegex ?
+            file_search::requiredLiteral(encodedPattern) :
+            encodedPattern;
+   bool asciiLiteral = std::none_of(literal.begin(), literal.end(), [](char c)
+   {
+      return static_cast<unsigned char>(c) >= 0x80;
+   });
+   if (!options.ignoreCase || asciiLiteral)
+      code_search::findFilesWithoutLiteral(literal, pUnmatchedFiles.get());
+
+   // the same paths that are filtered out of grep output; this runs on the
+   // search threads so the ignored directories are resolved up front
+   std::vector<FilePath> ignoreDirs = module_context::ignoreContentDirs();
+   options.skipPath = [ignoreDirs, pUnmatchedFiles](const std::string& path, bool isDirectory)
+   {
+      if (!isDirectory)
+      {
+         auto it = pUnmatchedFiles->find(path);
+         if (it != pUnmatchedFiles->end() && it->second == code_search::fileModificationTime(path))
+            return true;
+      }
+
+      return shouldSkipFile(isDirectory ? path + "/" : path) ||
+             module_context::isIgnoredContent(FilePath(path), ignoreDirs);
+   };
+
+   return options;
+}
+
+core::Error runExternalGrep(const GrepOptions& grepOptions,
+                            const std::string& encodedString,
+                            const std::string& encoding,
+                            const FilePath& dirPath,
+                            boost::shared_ptr<GrepOperation>* pGrepOp)
 {
    core::system::ProcessOptions options;
 
@@ -1428,25 +1703,10 @@ core::Error runGrepOperation(const GrepOptions& grepOptions, const ReplaceOption
    Error error = tempFile.openForWrite(pStream);
    if (error)
       return error;
-   std::string encoding = projects::projectContext().hasProject() ?
-                          projects::projectContext().defaultEncoding() :
-                          prefs::userPrefs().defaultEncoding();
-   std::string encodedString;
-   error = r::util::iconvstr(grepOptions.searchPattern(),
-                             "UTF-8",
-                             encoding,
-                             false,
-                             &encodedString);
-   if (error)
-   {
-      LOG_ERROR(error);
-      encodedString = grepOptions.searchPattern();
-   }
 
    *pStream << encodedString << std::endl;
    pStream.reset(); // release file handle
 
-   FilePath dirPath = module_context::resolveAliasedPath(grepOptions.directory());
    auto ptrGrepOp = GrepOperation::create(dirPath.getAbsolutePath(), encoding, tempFile);
    core::system::ProcessCallbacks callbacks = ptrGrepOp->createProcessCallbacks();
 
@@ -1541,9 +1801,6 @@ core::Error runGrepOperation(const GrepOptions& grepOptions, const ReplaceOption
       
    }
 
-   // Clear existing results
-   findResults().clear();
-
    // Use working directory
    options.workingDir = dirPath;
 
@@ -1555,6 +1812,57 @@ core::Error runGrepOperation(const GrepOptions& grepOptions, const ReplaceOption
    if (error)
       return error;
 
+   *pGrepOp = ptrGrepOp;
+   return Success();
+}
+
+core::Error runGrepOperation(const GrepOptions& grepOptions, const ReplaceOptions& replaceOptions,
+   LocalProgress* pProgress, json::JsonRpcResponse* pResponse)
+{
+   std::string encoding = projects::projectContext().hasProject() ?
+                          projects::projectContext().defaultEncoding() :
+                          prefs::userPrefs().defaultEncoding();
+   std::string encodedString;
+   Error error = r::util::iconvstr(grepOptions.searchPattern(),
+                                   "UTF-8",
+                                   encoding,
+                                   false,
+                                   &encodedString);
+   if (error)
+   {
+      LOG_ERROR(error);
+      encodedString = grepOptions.searchPattern();
+   }
+
+   FilePath dirPath = module_context::resolveAliasedPath(grepOptions.directory());
+
+   // Clear existing results
+   findResults().clear();
+
+   // search in process, falling back to grep for patterns the native search
+   // can't handle (or when explicitly requested)
+   boost::shared_ptr<GrepOperation> ptrGrepOp;
+   if (core::system::getenv("RSTUDIO_GREP_EXTERNAL").empty())
+   {
+      ptrGrepOp = GrepOperation::create(dirPath.getAbsolutePath(), encoding, FilePath());
+      error = ptrGrepOp->startNativeSearch(nativeSearchRoots(grepOptions, dirPath),
+                                           nativeSearchOptions(grepOptions, encodedString));
+      if (error)
+      {
+         if (debugging())
+            std::cerr << "native search failed: " << error.asString() << std::endl;
+         ptrGrepOp.reset();
+      }
+   }
+
+   bool nativeSearch = !!ptrGrepOp;
+   if (!nativeSearch)
+   {
+      error = runExternalGrep(grepOptions, encodedString, encoding, dirPath, &ptrGrepOp);
+      if (error)
+         return error;
+   }
+
    findResults().onFindBegin(ptrGrepOp->handle(),
                              grepOptions.searchPattern(),
                              grepOptions.directory(),
@@ -1568,6 +1876,10 @@ core::Error runGrepOperation(const GrepOptions& grepOptions, const ReplaceOption
                                    pProgress);
    pResponse->setResult(ptrGrepOp->handle());
 
+   // stream results as the search progresses
+   if (nativeSearch)
+      ptrGrepOp->pollNativeSearchResults();
+
    return Success();
 }
 
@@ -29,6 +29,10 @@
 # include <core/system/PosixNfs.hpp>
 #endif
 
+#include <ctime>
+#include <map>
+#include <set>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/algorithm/string/split.hpp>
@@ -39,6 +43,8 @@
 #include <boost/optional.hpp>
 #include <boost/regex.hpp>
 
+#include <shared_core/Hash.hpp>
+
 #include <core/Algorithm.hpp>
 #include <core/BoostLamda.hpp>
 #include <core/json/JsonRpc.hpp>
@@ -317,7 +323,8 @@ bool waitForIndexLock(const FilePath& workingDir)
 
 Error gitExec(const ShellArgs& args,
               const core::FilePath& workingDir,
-              core::system::ProcessResult* pResult)
+              core::system::ProcessResult* pResult,
+              const std::string& input = std::string())
 {
    // if we see an 'index.lock' file within the associated
    // git repository, try waiting a bit until it's removed
@@ -345,9 +352,9 @@ Error gitExec(const ShellArgs& args,
    // doesn't support UNC paths.
    // https://github.com/rstudio/rstudio/issues/4137
 #ifdef _WIN32
-   error = runProgram(gitBin(), args.args(), "", options, pResult);
+   error = runProgram(gitBin(), args.args(), input, options, pResult);
 #else
-   error = runCommand(git() << args.args(), "", options, pResult);
+   error = runCommand(git() << args.args(), input, options, pResult);
 #endif
 
 #ifdef __APPLE__
@@ -404,16 +411,27 @@ class Git : public boost::noncopyable
 private:
    FilePath root_;
 
+   // the commit graph of a revision's history, along with the commits the
+   // revision referred to when it was listed
+   struct History
+   {
+      std::vector<std::string> tips;
+      boost::shared_ptr<gitgraph::CommitGraph> pGraph;
+   };
+
+   std::map<std::string, History> histories_;
+
 protected:
    core::Error runGit(const ShellArgs& args,
                       std::string* pStdOut=nullptr,
                       std::string* pStdErr=nullptr,
-                      int* pExitCode=nullptr)
+                      int* pExitCode=nullptr,
+                      const std::string& input=std::string())
    {
       using namespace rstudio::core::system;
 
       ProcessResult result;
-      Error error = gitExec(args, root_, &result);
+      Error error = gitExec(args, root_, &result, input);
       if (error)
          return error;
 
@@ -521,15 +539,27 @@ public:
    core::Error status(const FilePath& dir,
                       StatusResult* pStatusResult)
    {
-      using namespace boost;
-
-      // objects to be populated from git's output
       std::vector<FileWithStatus> files;
-      
+      Error error = status(std::vector<FilePath>(1, dir), &files);
+      if (error)
+         return error;
+
+      *pStatusResult = StatusResult(files);
+
+      return Success();
+   }
+
+   // the status of the files at or beneath any of the given paths
+   core::Error status(const std::vector<FilePath>& paths,
+                      std::vector<FileWithStatus>* pFiles)
+   {
       // build shell arguments
       ShellArgs arguments = gitArgs();
       
-      arguments << "status" << "-z" << "--porcelain" << "--" << dir;
+      // the paths are file names, not patterns (which a name containing
+      // e.g. '*' or '[' would otherwise be read as)
+      arguments << "--literal-pathspecs"
+                << "status" << "-z" << "--porcelain" << "--" << paths;
       
       std::string output;
       Error error = runGit(arguments, &output);
@@ -552,9 +582,10 @@ public:
          std::string filePath = line.substr(3);
          file.status = status;
          
-         // if this was a git rename or copy, we need to capture the rename target from the next
+         // if this was a git rename or copy (in the index, and possibly
+         // since modified), we need to capture the rename target from the next
          // field. note that Git flips the order of filenames when running with '-z'
-         if (status == "R " || status == "C ")
+         if ((status[0] == 'R' || status[0] == 'C') && it + 1 != pieces.end())
             filePath = *(++it) + " -> " + filePath;
 
          // remove trailing slashes
@@ -565,11 +596,9 @@ public:
          // so no need to re-encode here
          file.path = root_.completeChildPath(filePath);
 
-         files.push_back(file);
+         pFiles->push_back(file);
       }
 
-      *pStatusResult = StatusResult(files);
-
       return Success();
    }
 
@@ -1184,12 +1213,214 @@ public:
       }
    }
 
+   // The full history of a revision is listed (with 'git rev-list') and its
+   // graph laid out once, rather than for each page shown, and is kept --
+   // in memory and in the scratch directory, so that it survives restarts
+   // -- along with the commits the revision referred to at the time. When
+   // these move, only the new commits are listed and added above the
+   // existing ones (provided the existing commits are still part of the
+   // history, e.g. after new commits or a pull, but not a reset or rebase).
+   core::Error commitGraph(const std::string& rev,
+                           boost::shared_ptr<gitgraph::CommitGraph>* ppGraph)
+   {
+      // the commits the revision refers to (none in an empty repository)
+      std::string output;
+      int exitCode;
+      Error error = runGit(gitArgs() << "rev-parse" << (rev.empty() ? "HEAD" : rev),
+                           &output, nullptr, &exitCode);
+      if (error)
+         return error;
+
+      std::vector<std::string> tips;
+      if (exitCode == EXIT_SUCCESS)
+      {
+         for (const std::string& line : split(output))
+         {
+            if (!line.empty())
+               tips.push_back(line);
+         }
+         std::sort(tips.begin(), tips.end());
+         tips.erase(std::unique(tips.begin(), tips.end()), tips.end());
+      }
+
+      History& history = histories_[rev];
+      if (!history.pGraph)
+         readHistory(rev, &history);
+
+      if (history.tips != tips)
+      {
+         error = updateHistory(tips, &history);
+         if (error)
+         {
+            // start over next time (rather than from a persisted history
+            // which may be what can't be updated)
+            histories_.erase(rev);
+            Error removeError = historyPath(rev).removeIfExists();
+            if (removeError)
+               LOG_ERROR(removeError);
+            return error;
+         }
+
+         writeHistory(rev, history);
+      }
+
+      *ppGraph = history.pGraph;
+      return Success();
+   }
+
+   core::Error updateHistory(const std::vector<std::string>& tips,
+                             History* pHistory)
+   {
+      if (tips.empty())
+      {
+         pHistory->pGraph->assign(std::vector<std::string>());
+         pHistory->tips = tips;
+         return Success();
+      }
+
+      // revisions for 'git rev-list --stdin' (which can't read '--not')
+      auto revisions = [](const std::vector<std::string>& include,
+                          const std::vector<std::string>& exclude)
+      {
+         std::string input;
+         for (const std::string& commit : include)
+            input += commit + "\n";
+         for (const std::string& commit : exclude)
+            input += "^" + commit + "\n";
+         return input;
+      };
+
+      // we can add to the existing commits if they're all still in the
+      // history (i.e. none are reachable only from the previous tips). the
+      // previous tips may no longer exist at all (e.g. after the repository
+      // was cloned again, or pruned after a rebase), in which case the
+      // check fails and the history is listed afresh
+      bool prepend = !pHistory->tips.empty() && !pHistory->pGraph->empty();
+      if (prepend)
+      {
+         std::string count;
+         Error error = runGitRevList(gitArgs() << "rev-list" << "--count" << "--stdin",
+                                     revisions(pHistory->tips, tips),
+                                     &count);
+         prepend = !error && boost::algorithm::trim_copy(count) == "0";
+      }
+
+      std::string output;
+      Error error = runGitRevList(
+               gitArgs() << "rev-list" << "--date-order" << "--parents" << "--stdin",
+               prepend ? revisions(tips, pHistory->tips) : revisions(tips, {}),
+               &output);
+      if (error)
+         return error;
+
+      if (prepend)
+         pHistory->pGraph->prepend(split(output));
+      else
+         pHistory->pGraph->assign(split(output));
+      pHistory->tips = tips;
+
+      return Success();
+   }
+
+   core::Error runGitRevList(const ShellArgs& args,
+                             const std::string& input,
+                             std::string* pOutput)
+   {
+      std::string errorOutput;
+      int exitCode;
+      Error error = runGit(args, pOutput, &errorOutput, &exitCode, input);
+      if (error)
+         return error;
+
+      if (exitCode != EXIT_SUCCESS)
+         return systemError(boost::system::errc::protocol_error, errorOutput, ERROR_LOCATION);
+
+      return Success();
+   }
+
+   FilePath historyPath(const std::string& rev)
+   {
+      return module_context::scopedScratchPath()
+            .completeChildPath("git_history")
+            .completeChildPath(core::hash::crc32HexHash(root_.getAbsolutePath() + "\n" + rev));
+   }
+
+   void readHistory(const std::string& rev, History* pHistory)
+   {
+      pHistory->pGraph = boost::make_shared<gitgraph::CommitGraph>();
+      pHistory->tips.clear();
+
+      FilePath historyFile = historyPath(rev);
+      if (!historyFile.exists())
+         return;
+
+      std::shared_ptr<std::istream> pStream;
+      Error error = historyFile.openForRead(pStream);
+      if (error)
+      {
+         LOG_ERROR(error);
+         return;
+      }
+
+      // the repository, the revision and its tips, then the commits
+      std::string root, revision, tips;
+      std::getline(*pStream, root);
+      std::getline(*pStream, revision);
+      std::getline(*pStream, tips);
+      if (root != root_.getAbsolutePath() || revision != rev)
+         return;
+
+      if (!pHistory->pGraph->read(*pStream))
+         return;
+
+      boost::algorithm::split(pHistory->tips, tips,
+                              boost::algorithm::is_any_of(" "),
+                              boost::algorithm::token_compress_on);
+      pHistory->tips.erase(
+               std::remove(pHistory->tips.begin(), pHistory->tips.end(), std::string()),
+               pHistory->tips.end());
+   }
+
+   void writeHistory(const std::string& rev, const History& history)
+   {
+      FilePath historyFile = historyPath(rev);
+      Error error = historyFile.getParent().ensureDirectory();
+      if (error)
+      {
+         LOG_ERROR(error);
+         return;
+      }
+
+      std::shared_ptr<std::ostream> pStream;
+      error = historyFile.openForWrite(pStream);
+      if (error)
+      {
+         LOG_ERROR(error);
+         return;
+      }
+
+      *pStream << root_.getAbsolutePath() << "\n"
+               << rev << "\n"
+               << boost::algorithm::join(history.tips, " ") << "\n";
+      history.pGraph->write(*pStream);
+   }
+
    core::Error logLength(const std::string &rev,
                          const FilePath& fileFilter,
                          const std::string &searchText,
                          int *pLength)
    {
-      if (searchText.empty())
+      if (searchText.empty() && fileFilter.isEmpty())
+      {
+         boost::shared_ptr<gitgraph::CommitGraph> pGraph;
+         Error error = commitGraph(rev, &pGraph);
+         if (error)
+            return error;
+
+         *pLength = gsl::narrow_cast<int>(pGraph->size());
+         return Success();
+      }
+      else if (searchText.empty())
       {
          ShellArgs args = gitArgs() << "log";
          args << "--pretty=oneline";
@@ -1225,90 +1456,91 @@ public:
                    const std::string& searchText,
                    std::vector<CommitInfo>* pOutput)
    {
+      // the full history (the only one with a graph) is paged through the
+      // cached commit graph
+      if (searchText.empty() && fileFilter.isEmpty())
+         return logPage(rev, skip, maxentries, pOutput);
+
       ShellArgs args = gitArgs() << "log" << "--encoding=UTF-8"
                        << "--pretty=raw" << "--decorate=full"
                        << "--date-order";
 
-      ShellArgs revListArgs = gitArgs() << "rev-list" << "--date-order" << "--parents";
-      int revListSkip = skip;
-
       if (!fileFilter.isEmpty())
-      {
          args << "--" << fileFilter;
-         revListArgs << "--" << fileFilter;
-      }
-
-      if (searchText.empty() && fileFilter.isEmpty())
-      {
-         // This is a way more efficient way to implement skip and maxentries
-         // if we know that all commits are included.
-         if (skip > 0)
-         {
-            args << "--skip=" + safe_convert::numberToString(skip);
-            skip = 0;
-         }
-         if (maxentries >= 0)
-         {
-            args << "--max-count=" + safe_convert::numberToString(maxentries);
-            maxentries = -1;
-
-            revListArgs << "--max-count=" + safe_convert::numberToString(
-                  (skip < 0 ? 0 : skip) + maxentries);
-         }
-      }
 
       if (!rev.empty())
-      {
          args << rev;
-         revListArgs << rev;
-      }
-      else
-      {
-         revListArgs << "HEAD";
-      }
-
-      if (maxentries < 0)
-         maxentries = std::numeric_limits<int>::max();
 
-      std::vector<std::string> outLines;
       std::string output;
       Error error = runGit(args, &output);
       if (error)
          return error;
-      outLines = split(output);
-      output.clear();
 
+      parseLog(split(output),
+               createSearchTextPredicate(searchText),
+               skip,
+               maxentries,
+               std::vector<std::string>(),
+               pOutput);
+
+      return Success();
+   }
+
+   core::Error logPage(const std::string& rev,
+                       int skip,
+                       int maxentries,
+                       std::vector<CommitInfo>* pOutput)
+   {
+      boost::shared_ptr<gitgraph::CommitGraph> pGraph;
+      Error error = commitGraph(rev, &pGraph);
+      if (error)
+         return error;
+
+      std::size_t begin = std::min(static_cast<std::size_t>(std::max(skip, 0)),
+                                   pGraph->size());
+      std::size_t end = pGraph->size();
+      if (maxentries >= 0)
+         end = std::min(end, begin + maxentries);
+      if (begin == end)
+         return Success();
+
+      // show just the commits on the page, in the graph's order
+      std::string commits;
       std::vector<std::string> graphLines;
-      if (searchText.empty() && fileFilter.isEmpty())
+      for (std::size_t i = begin; i < end; i++)
       {
-         std::vector<std::string> revOutLines;
-         std::string revOutput;
-         error = runGit(revListArgs, &revOutput);
-         if (error)
-            return error;
-         revOutLines = split(revOutput);
-         revOutput.clear();
-
-         gitgraph::GitGraph graph;
-         for (size_t i = 0; i < revOutLines.size(); i++)
-         {
-            typedef std::vector<std::string> find_vector_type;
-            find_vector_type parents;
-            boost::algorithm::split(parents, revOutLines[i],
-                                    boost::algorithm::is_any_of(" "));
-            if (parents.size() < 1)
-               break;
-
-            std::string commit = parents.front();
-            parents.erase(parents.begin());
-
-            gitgraph::Line line = graph.addCommit(commit, parents);
-            if (revListSkip <= 0 || gsl::narrow_cast<int>(i) >= revListSkip)
-               graphLines.push_back(line.string());
-         }
+         commits.append(pGraph->commit(i)).append("\n");
+         graphLines.push_back(pGraph->line(i));
       }
 
-      boost::function<bool(CommitInfo)> filter = createSearchTextPredicate(searchText);
+      ShellArgs args = gitArgs() << "log" << "--encoding=UTF-8"
+                       << "--pretty=raw" << "--decorate=full"
+                       << "--no-walk=unsorted" << "--stdin";
+
+      std::string output;
+      error = runGit(args, &output, nullptr, nullptr, commits);
+      if (error)
+         return error;
+
+      parseLog(split(output),
+               createSearchTextPredicate(std::string()),
+               0,
+               -1,
+               graphLines,
+               pOutput);
+
+      return Success();
+   }
+
+   void parseLog(const std::vector<std::string>& outLines,
+                 const boost::function<bool(CommitInfo)>& filter,
+                 int skip,
+                 int maxentries,
+                 const std::vector<std::string>& graphLines,
+                 std::vector<CommitInfo>* pOutput)
+   {
+      if (maxentries < 0)
+         maxentries = std::numeric_limits<int>::max();
 
       boost::regex kvregex("^(\\w+) (.*)$");
       boost::regex authTimeRegex("^(.*?) (\\d+) ([+\\-]?\\d+)$");
@@ -1420,8 +1652,6 @@ public:
          }
          graphLineIndex++;
       }
-
-      return Success();
    }
 
    virtual core::Error show(const std::string& revision,
@@ -1485,6 +1715,339 @@ public:
 
 Git s_git_;
 
+// The Files pane (to decorate listings and file change events) and the Git
+// pane both need the status of the working tree, and on large repositories
+// running 'git status' for each of them takes seconds. StatusCache keeps
+// the last status of the project's repository in memory and brings it up
+// to date only when it is next requested:
+//
+// - files reported changed by the project's file monitor are re-checked,
+//   all at once, by passing them to 'git status' as pathspecs;
+// - a change to the index, HEAD or the checked out branch (e.g. staging or
+//   committing from the terminal), or to a .gitignore, requires a full
+//   refresh;
+// - the file monitor doesn't report changes to hidden or ignored files, so
+//   a status older than kMaxAgeSeconds is refreshed in full.
+//
+// The cache is only used when the file monitor covers the whole working
+// tree (i.e. the repository is the project directory or is within it).
+class StatusCache : boost::noncopyable
+{
+public:
+   StatusCache()
+      : valid_(false),
+        hasRenames_(false),
+        refreshTime_(0)
+   {
+   }
+
+   bool isActive() const
+   {
+      return isGitEnabled() &&
+             projects::projectContext().isMonitoringDirectory(s_git_.root());
+   }
+
+   void invalidate()
+   {
+      valid_ = false;
+      dirtyPaths_.clear();
+   }
+
+   void invalidate(const std::vector<core::system::FileChangeEvent>& events)
+   {
+      if (!valid_)
+         return;
+
+      std::string rootPath = root_.getAbsolutePath() + "/";
+      std::string gitDirPath = gitDir_.getAbsolutePath() + "/";
+      for (const core::system::FileChangeEvent& event : events)
+      {
+         const std::string& path = event.fileInfo().absolutePath();
+         if (!boost::algorithm::starts_with(path, rootPath) ||
+             boost::algorithm::starts_with(path, gitDirPath))
+         {
+            continue;
+         }
+
+         if (boost::algorithm::ends_with(path, "/.gitignore") ||
+             dirtyPaths_.size() >= kMaxDirtyPaths)
+         {
+            invalidate();
+            return;
+         }
+
+         dirtyPaths_.insert(path);
+      }
+   }
+
+   Error status(boost::shared_ptr<const StatusResult>* ppStatusResult)
+   {
+      Error error = update();
+      if (error)
+      {
+         invalidate();
+         return error;
+      }
+
+      *ppStatusResult = pStatusResult_;
+      return Success();
+   }
+
+   // re-reads the status of the whole working tree (for an explicit refresh,
+   // which must also pick up what the file monitor doesn't report); a burst
+   // of refreshes shares the first one's full read
+   Error refresh(boost::shared_ptr<const StatusResult>* ppStatusResult)
+   {
+      std::time_t now = std::time(nullptr);
+      if (valid_ && root_ == s_git_.root() && now == refreshTime_)
+         return status(ppStatusResult);
+
+      Error error = refreshAll(now);
+      if (error)
+      {
+         invalidate();
+         return error;
+      }
+
+      *ppStatusResult = pStatusResult_;
+      return Success();
+   }
+
+private:
+   typedef std::vector<std::pair<std::time_t, uintmax_t> > Stamps;
+
+   static const std::size_t kMaxDirtyPaths = 256;
+   static const std::time_t kMaxAgeSeconds = 30;
+
+   Error update()
+   {
+      std::time_t now = std::time(nullptr);
+      if (!valid_ ||
+          root_ != s_git_.root() ||
+          now - refreshTime_ >= kMaxAgeSeconds ||
+          readStamps() != stamps_)
+      {
+         return refreshAll(now);
+      }
+
+      if (dirtyPaths_.empty())
+         return Success();
+
+      // a rename pairs two paths, only one of which may be re-checked
+      if (hasRenames_)
+         return refreshAll(now);
+
+      return refreshPaths();
+   }
+
+   Error refreshAll(std::time_t now)
+   {
+      invalidate();
+      root_ = s_git_.root();
+      gitDir_ = resolveGitDir(root_);
+
+      // read the stamps before running git so that changes made while it
+      // runs are noticed next time
+      Stamps stamps = readStamps();
+
+      std::vector<FileWithStatus> files;
+      Error error = s_git_.status(std::vector<FilePath>(1, root_), &files);
+      if (error)
+         return error;
+
+      files_.clear();
+      for (const FileWithStatus& file : files)
+         files_[file.path.getAbsolutePath()] = file;
+      updateResult();
+
+      // a file written within this second could be written again without
+      // its time changing, so don't rely on the stamps until they settle
+      stamps_.clear();
+      if (std::none_of(stamps.begin(), stamps.end(),
+                       [&](const Stamps::value_type& stamp) { return stamp.first >= now; }))
+      {
+         stamps_ = stamps;
+      }
+
+      refreshTime_ = now;
+
+      // without the git directory we can't tell when the index changes
+      valid_ = !gitDir_.isEmpty();
+
+      return Success();
+   }
+
+   Error refreshPaths()
+   {
+      // files within an untracked directory are reported as the directory
+      std::set<std::string> paths;
+      for (const std::string& path : dirtyPaths_)
+      {
+         std::string untrackedDir = outermostUntrackedDir(path);
+         paths.insert(untrackedDir.empty() ? path : untrackedDir);
+      }
+      dirtyPaths_.clear();
+
+      // paths beneath another path are covered by it
+      std::vector<FilePath> pathspecs;
+      for (const std::string& path : paths)
+      {
+         if (!hasAncestorIn(path, paths))
+            pathspecs.push_back(FilePath(path));
+      }
+
+      std::vector<FileWithStatus> files;
+      Error error = s_git_.status(pathspecs, &files);
+      if (error)
+         return error;
+
+      mergeStatus(root_, pathspecs, files, &files_);
+      updateResult();
+
+      return Success();
+   }
+
+   void updateResult()
+   {
+      std::vector<FileWithStatus> files;
+      files.reserve(files_.size());
+      hasRenames_ = false;
+      for (const auto& file : files_)
+      {
+         std::string status = file.second.status.status();
+         if (!status.empty() && (status[0] == 'R' || status[0] == 'C'))
+            hasRenames_ = true;
+         files.push_back(file.second);
+      }
+
+      pStatusResult_ = boost::make_shared<StatusResult>(files);
+   }
+
+   std::string outermostUntrackedDir(const std::string& path) const
+   {
+      std::string untrackedDir;
+      std::size_t rootLength = root_.getAbsolutePath().size();
+      for (std::string::size_type pos = path.rfind('/');
+           pos != std::string::npos && pos > rootLength;
+           pos = path.rfind('/', pos - 1))
+      {
+         std::string dir = path.substr(0, pos);
+         std::map<std::string, FileWithStatus>::const_iterator it = files_.find(dir);
+         if (it != files_.end() && it->second.status.status() == "??")
+            untrackedDir = dir;
+      }
+      return untrackedDir;
+   }
+
+   bool hasAncestorIn(const std::string& path,
+                      const std::set<std::string>& paths) const
+   {
+      std::size_t rootLength = root_.getAbsolutePath().size();
+      for (std::string::size_type pos = path.rfind('/');
+           pos != std::string::npos && pos > rootLength;
+           pos = path.rfind('/', pos - 1))
+      {
+         if (paths.count(path.substr(0, pos)))
+            return true;
+      }
+      return false;
+   }
+
+   static FilePath resolveGitDir(const FilePath& root)
+   {
+      FilePath dotGit = root.completeChildPath(".git");
+      if (dotGit.isDirectory())
+         return dotGit;
+
+      // worktrees and submodules have a .git file naming their git directory
+      std::string contents;
+      if (!dotGit.exists() || core::readStringFromFile(dotGit, &contents))
+         return FilePath();
+
+      boost::algorithm::trim(contents);
+      const std::string prefix("gitdir: ");
+      if (!boost::algorithm::starts_with(contents, prefix))
+         return FilePath();
+
+      return root.completePath(contents.substr(prefix.size()));
+   }
+
+   Stamps readStamps() const
+   {
+      std::vector<std::string> names = { "index", "HEAD", "packed-refs", "info/exclude" };
+
+      // the branch HEAD refers to (which moves without the index changing
+      // on e.g. 'git reset --soft')
+      std::string head;
+      if (!core::readStringFromFile(gitDir_.completeChildPath("HEAD"), &head) &&
+          boost::algorithm::starts_with(head, "ref: "))
+      {
+         names.push_back(boost::algorithm::trim_copy(head.substr(5)));
+      }
+
+      Stamps stamps;
+      for (const std::string& name : names)
+      {
+         FilePath path = gitDir_.completeChildPath(name);
+         if (path.exists())
+            stamps.push_back(std::make_pair(path.getLastWriteTime(), path.getSize()));
+         else
+            stamps.push_back(std::make_pair(std::time_t(0), uintmax_t(0)));
+      }
+      return stamps;
+   }
+
+   bool valid_;
+   FilePath root_;
+   FilePath gitDir_;
+   std::map<std::string, FileWithStatus> files_;
+   bool hasRenames_;
+   boost::shared_ptr<const StatusResult> pStatusResult_;
+   std::set<std::string> dirtyPaths_;
+   Stamps stamps_;
+   std::time_t refreshTime_;
+};
+
+StatusCache s_statusCache;
+
+// the status of the files beneath dir (served from the cache, and so along
+// with the rest of the working tree, when the cache is active)
+Error cachedStatus(const FilePath& dir,
+                   boost::shared_ptr<const StatusResult>* ppStatusResult)
+{
+   *ppStatusResult = boost::make_shared<StatusResult>();
+
+   if (!s_statusCache.isActive())
+   {
+      s_statusCache.invalidate();
+   }
+   else if (dir.isWithin(s_git_.root()))
+   {
+      return s_statusCache.status(ppStatusResult);
+   }
+
+   if (!isGitEnabled())
+      return Success();
+
+   boost::shared_ptr<StatusResult> pStatusResult = boost::make_shared<StatusResult>();
+   Error error = s_git_.status(dir, pStatusResult.get());
+   if (error)
+      return error;
+
+   *ppStatusResult = pStatusResult;
+   return Success();
+}
+
+void onMonitoringEnabled(const tree<core::FileInfo>&)
+{
+   s_statusCache.invalidate();
+}
+
+void onMonitoringDisabled()
+{
+   s_statusCache.invalidate();
+}
+
 FilePath resolveAliasedPath(const std::string& path)
 {
    if (boost::algorithm::starts_with(path, "~/"))
@@ -1556,7 +2119,7 @@ GitFileDecorationContext::GitFileDecorationContext(const FilePath& rootDir)
    : fullRefreshRequired_(false)
 {
    // get source control status (merely log errors doing this)
-   Error error = git::status(rootDir, &vcsStatus_);
+   Error error = cachedStatus(rootDir, &pVcsStatus_);
    if (error)
       LOG_ERROR(error);
 }
@@ -1570,7 +2133,7 @@ GitFileDecorationContext::~GitFileDecorationContext()
 void GitFileDecorationContext::decorateFile(const FilePath &filePath,
                                             json::Object *pFileObject)
 {
-   VCSStatus status = vcsStatus_.getStatus(filePath);
+   VCSStatus status = pVcsStatus_->getStatus(filePath);
 
    if (status.status().empty() && !fullRefreshRequired_)
    {
@@ -1585,7 +2148,7 @@ void GitFileDecorationContext::decorateFile(const FilePath &filePath,
             break;
 
          parent = parent.getParent();
-         if (vcsStatus_.getStatus(parent).status() == "??")
+         if (pVcsStatus_->getStatus(parent).status() == "??")
          {
             fullRefreshRequired_ = true;
             break;
@@ -1600,6 +2163,64 @@ void GitFileDecorationContext::decorateFile(const FilePath &filePath,
    (*pFileObject)["git_status"] = vcsObj;
 }
 
+void mergeStatus(const FilePath& root,
+                 const std::vector<FilePath>& paths,
+                 const std::vector<FileWithStatus>& files,
+                 std::map<std::string, FileWithStatus>* pStatus)
+{
+   auto isCovered = [&](const std::string& path)
+   {
+      for (const FilePath& entry : paths)
+      {
+         const std::string& prefix = entry.getAbsolutePath();
+         if (path == prefix || boost::algorithm::starts_with(path, prefix + "/"))
+            return true;
+      }
+      return false;
+   };
+
+   // the paths a status entry is about (both sides of a rename, which is
+   // reported as 'old -> new' relative to the root)
+   auto entryPaths = [&](const FileWithStatus& file)
+   {
+      std::vector<std::string> result;
+      std::string status = file.status.status();
+      std::string oldPath, newPath;
+      if (!status.empty() && (status[0] == 'R' || status[0] == 'C') &&
+          splitRename(file.path.getAbsolutePath(), &oldPath, &newPath))
+      {
+         result.push_back(oldPath);
+         result.push_back(root.completeChildPath(newPath).getAbsolutePath());
+      }
+      else
+      {
+         result.push_back(file.path.getAbsolutePath());
+      }
+      return result;
+   };
+
+   // drop the previous status of everything at or beneath the paths (files
+   // no longer reported, e.g. deleted untracked files, are now unmodified)
+   for (auto it = pStatus->begin(); it != pStatus->end(); )
+   {
+      std::vector<std::string> entry = entryPaths(it->second);
+      if (std::any_of(entry.begin(), entry.end(), isCovered))
+         it = pStatus->erase(it);
+      else
+         ++it;
+   }
+
+   // a rename replaces the entries of the files on either side of it
+   for (const FileWithStatus& file : files)
+   {
+      for (const std::string& path : entryPaths(file))
+         pStatus->erase(path);
+   }
+
+   for (const FileWithStatus& file : files)
+      (*pStatus)[file.path.getAbsolutePath()] = file;
+}
+
 core::Error status(const FilePath& dir, StatusResult* pStatusResult)
 {
    if (s_git_.root().isEmpty())
@@ -1608,6 +2229,11 @@ core::Error status(const FilePath& dir, StatusResult* pStatusResult)
    return s_git_.status(dir, pStatusResult);
 }
 
+void onFilesChanged(const std::vector<core::system::FileChangeEvent>& events)
+{
+   s_statusCache.invalidate(events);
+}
+
 Error fileStatus(const FilePath& filePath, VCSStatus* pStatus)
 {
    StatusResult statusResult;
@@ -1790,16 +2416,18 @@ Error vcsCheckoutRemote(const json::JsonRpcRequest& request,
 }
 
 
-Error vcsFullStatus(const json::JsonRpcRequest&,
-                    json::JsonRpcResponse* pResponse)
+Error fullStatus(bool refresh, json::Array* pResult)
 {
-   StatusResult statusResult;
-   Error error = s_git_.status(s_git_.root(), &statusResult);
+   // an explicit refresh brings all of the status up to date, rather than
+   // just the files the monitor saw change
+   boost::shared_ptr<const StatusResult> pStatusResult;
+   Error error = (refresh && s_statusCache.isActive()) ?
+            s_statusCache.refresh(&pStatusResult) :
+            cachedStatus(s_git_.root(), &pStatusResult);
    if (error)
       return error;
 
-   std::vector<FileWithStatus> files = statusResult.files();
-   json::Array result;
+   std::vector<FileWithStatus> files = pStatusResult->files();
    for (std::vector<FileWithStatus>::const_iterator it = files.begin();
         it != files.end();
         it++)
@@ -1810,9 +2438,20 @@ Error vcsFullStatus(const json::JsonRpcRequest&,
       error = statusToJson(path, status, &obj);
       if (error)
          return error;
-      result.push_back(obj);
+      pResult->push_back(obj);
    }
 
+   return Success();
+}
+
+Error vcsFullStatus(const json::JsonRpcRequest&,
+                    json::JsonRpcResponse* pResponse)
+{
+   json::Array result;
+   Error error = fullStatus(false, &result);
+   if (error)
+      return error;
+
    pResponse->setResult(result);
 
    return Success();
@@ -1821,13 +2460,23 @@ Error vcsFullStatus(const json::JsonRpcRequest&,
 Error vcsAllStatus(const json::JsonRpcRequest& request,
                    json::JsonRpcResponse* pResponse)
 {
+   // the Git pane asks for a refresh when the user refreshes it explicitly
+   bool refresh = false;
+   if (request.params.getSize() > 0)
+   {
+      Error error = json::readParams(request.params, &refresh);
+      if (error)
+         return error;
+   }
+
    json::Object result;
    json::JsonRpcResponse tmp;
 
-   Error error = vcsFullStatus(request, &tmp);
+   json::Array status;
+   Error error = fullStatus(refresh, &status);
    if (error)
       return error;
-   result["status"] = tmp.result();
+   result["status"] = status;
 
    error = vcsListBranches(request, &tmp);
    if (error)
@@ -3366,6 +4015,13 @@ core::Error initialize()
    // add settings changed handler
    prefs::userPrefs().onChanged.connect(onUserSettingsChanged);
 
+   // changes made while the file monitor isn't running go unnoticed, so
+   // start over with the status whenever it starts or stops
+   projects::FileMonitorCallbacks cb;
+   cb.onMonitoringEnabled = onMonitoringEnabled;
+   cb.onMonitoringDisabled = onMonitoringDisabled;
+   projects::projectContext().subscribeToFileMonitor("", cb);
+
    // install rpc methods
    using boost::bind;
    using namespace module_context;
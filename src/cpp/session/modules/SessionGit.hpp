@@ -17,11 +17,16 @@
 #define SESSION_GIT_HPP
 
 #include <map>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
 
 #include <shared_core/Error.hpp>
 #include <shared_core/FilePath.hpp>
 #include <shared_core/json/Json.hpp>
 
+#include <core/system/FileChangeEvent.hpp>
+
 #include "vcs/SessionVCSCore.hpp"
 
 namespace rstudio {
@@ -48,7 +53,7 @@ public:
                              core::json::Object *pFileObject);
 
 private:
-   source_control::StatusResult vcsStatus_;
+   boost::shared_ptr<const source_control::StatusResult> pVcsStatus_;
    bool fullRefreshRequired_;
 };
 
@@ -72,6 +77,17 @@ core::Error status(const core::FilePath& dir,
                    source_control::StatusResult* pStatusResult);
 core::Error fileStatus(const core::FilePath& filePath,
                        source_control::VCSStatus* pStatus);
+
+// replaces the status of the files at or beneath the given paths (in a
+// status keyed by absolute path) with the status git reported for them
+void mergeStatus(const core::FilePath& root,
+                 const std::vector<core::FilePath>& paths,
+                 const std::vector<source_control::FileWithStatus>& files,
+                 std::map<std::string, source_control::FileWithStatus>* pStatus);
+
+// marks files as changed in the cached status (to be re-checked when the
+// status is next needed)
+void onFilesChanged(const std::vector<core::system::FileChangeEvent>& events);
 core::Error statusToJson(const core::FilePath& path,
                          const source_control::VCSStatus& vcsStatus,
                          core::json::Object* pObject);
@@ -0,0 +1,161 @@
+/*
+ * SessionGitTests.cpp
+ *
+ * Copyright (C) 2026 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "SessionGit.hpp"
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace git {
+namespace tests {
+
+using namespace rstudio::core;
+using namespace source_control;
+
+namespace {
+
+typedef std::map<std::string, FileWithStatus> Status;
+
+const FilePath kRoot("/repo");
+
+FileWithStatus file(const std::string& status, const std::string& path)
+{
+   FileWithStatus result;
+   result.status = VCSStatus(status);
+   result.path = kRoot.completeChildPath(path);
+   return result;
+}
+
+Status statusOf(const std::vector<FileWithStatus>& files)
+{
+   Status result;
+   for (const FileWithStatus& file : files)
+      result[file.path.getAbsolutePath()] = file;
+   return result;
+}
+
+std::vector<FilePath> paths(const std::vector<std::string>& relativePaths)
+{
+   std::vector<FilePath> result;
+   for (const std::string& path : relativePaths)
+      result.push_back(kRoot.completeChildPath(path));
+   return result;
+}
+
+// the status entries as 'XY path' (in path order)
+std::vector<std::string> describe(const Status& status)
+{
+   std::vector<std::string> result;
+   for (const auto& entry : status)
+      result.push_back(entry.second.status.status() + " " + entry.first);
+   return result;
+}
+
+} // anonymous namespace
+
+test_context("Git status cache")
+{
+   test_that("Re-checked files take the status git reports for them")
+   {
+      Status status = statusOf({ file(" M", "a.R"), file(" M", "b.R") });
+      mergeStatus(kRoot, paths({ "a.R", "c.R" }),
+                  { file("M ", "a.R"), file("??", "c.R") },
+                  &status);
+
+      std::vector<std::string> expected = {
+         "M  /repo/a.R", " M /repo/b.R", "?? /repo/c.R"
+      };
+      expect_true(describe(status) == expected);
+   }
+
+   test_that("Files no longer reported are dropped")
+   {
+      // e.g. an untracked file that was deleted, or a modification reverted
+      Status status = statusOf({ file("??", "new.R"), file(" M", "a.R"), file(" M", "b.R") });
+      mergeStatus(kRoot, paths({ "new.R", "a.R" }), {}, &status);
+
+      std::vector<std::string> expected = { " M /repo/b.R" };
+      expect_true(describe(status) == expected);
+   }
+
+   test_that("Deleted tracked files are reported as deleted")
+   {
+      Status status = statusOf({ file(" M", "a.R") });
+      mergeStatus(kRoot, paths({ "a.R" }), { file(" D", "a.R") }, &status);
+
+      std::vector<std::string> expected = { " D /repo/a.R" };
+      expect_true(describe(status) == expected);
+   }
+
+   test_that("Re-checking a directory replaces everything beneath it")
+   {
+      Status status = statusOf({
+         file("??", "dir/a.R"), file(" M", "dir/sub/b.R"),
+         file(" M", "dir2/c.R"), file(" M", "dir.R")
+      });
+      mergeStatus(kRoot, paths({ "dir" }), { file("??", "dir") }, &status);
+
+      // 'dir2' and 'dir.R' share a prefix with 'dir' but aren't beneath it
+      std::vector<std::string> expected = {
+         "?? /repo/dir", " M /repo/dir.R", " M /repo/dir2/c.R"
+      };
+      expect_true(describe(status) == expected);
+   }
+
+   test_that("A rename replaces the entries of the files on either side")
+   {
+      Status status = statusOf({ file(" D", "old.R"), file("??", "new.R"), file(" M", "a.R") });
+      mergeStatus(kRoot, paths({ "new.R" }),
+                  { file("R ", "old.R -> new.R") },
+                  &status);
+
+      std::vector<std::string> expected = {
+         " M /repo/a.R", "R  /repo/old.R -> new.R"
+      };
+      expect_true(describe(status) == expected);
+   }
+
+   test_that("A rename is dropped when either of its files is re-checked")
+   {
+      Status status = statusOf({ file("R ", "old.R -> new.R"), file(" M", "a.R") });
+      mergeStatus(kRoot, paths({ "old.R" }), { file(" D", "old.R") }, &status);
+
+      std::vector<std::string> expected = { " M /repo/a.R", " D /repo/old.R" };
+      expect_true(describe(status) == expected);
+
+      status = statusOf({ file("R ", "old.R -> new.R") });
+      mergeStatus(kRoot, paths({ "new.R" }), { file("A ", "new.R") }, &status);
+
+      expected = { "A  /repo/new.R" };
+      expect_true(describe(status) == expected);
+   }
+
+   test_that("File names are matched literally")
+   {
+      Status status = statusOf({ file(" M", "a[1].R"), file(" M", "a1.R") });
+      mergeStatus(kRoot, paths({ "a[1].R" }), {}, &status);
+
+      std::vector<std::string> expected = { " M /repo/a1.R" };
+      expect_true(describe(status) == expected);
+   }
+}
+
+} // namespace tests
+} // namespace git
+} // namespace modules
+} // namespace session
+} // namespace rstudio
@@ -49,8 +49,12 @@
 
 #include <r/session/RSessionUtils.hpp>
 
+#include <algorithm>
+#include <unordered_map>
+
 #include <boost/bind/bind.hpp>
 #include <boost/container/flat_set.hpp>
+#include <boost/functional/hash.hpp>
 
 using namespace boost::placeholders;
 
@@ -1218,7 +1222,7 @@ std::wstring typeToWideString(char type)
       if (!__CURSOR__.__ACTION__())                                            \
       {                                                                        \
          DEBUG("(" << __LINE__ << ":" << #__ACTION__ << "): Failed");          \
-         __STATUS__.lint().unexpectedEndOfDocument(__CURSOR__);                \
+         __STATUS__.unexpectedEndOfDocument(__CURSOR__);                       \
          return;                                                               \
       }                                                                        \
    } while (0)
@@ -1282,6 +1286,7 @@ std::wstring typeToWideString(char type)
          DEBUG("(" << __LINE__ << "): Expected "                               \
                    << string_utils::wideToUtf8(__CONTENT__));                  \
          __STATUS__.lint().unexpectedToken(__CURSOR__, __CONTENT__);           \
+         __STATUS__.stopParsing();                                             \
          return;                                                               \
       }                                                                        \
    } while (0)
@@ -1295,7 +1300,11 @@ std::wstring typeToWideString(char type)
                    << string_utils::wideToUtf8(typeToWideString(__TYPE__)));   \
          __STATUS__.lint().unexpectedToken(                                    \
              __CURSOR__, L"'" + typeToWideString(__TYPE__) + L"'");            \
-         if (__RETURN__) return;                                               \
+         if (__RETURN__)                                                       \
+         {                                                                     \
+            __STATUS__.stopParsing();                                          \
+            return;                                                            \
+         }                                                                     \
       }                                                                        \
    } while (0)
 
@@ -1307,7 +1316,11 @@ std::wstring typeToWideString(char type)
          DEBUG("(" << __LINE__ << "): Unexpected "                             \
                    << string_utils::wideToUtf8(typeToWideString(__TYPE__)));   \
          __STATUS__.lint().unexpectedToken(__CURSOR__);                        \
-         if (__RETURN__) return;                                               \
+         if (__RETURN__)                                                       \
+         {                                                                     \
+            __STATUS__.stopParsing();                                          \
+            return;                                                            \
+         }                                                                     \
       }                                                                        \
    } while (0)
 
@@ -3283,6 +3296,504 @@ INVALID_TOKEN:
    return;
 }
 
+namespace {
+
+// the parse options which affect what parsing a block produces
+int parseSignature(const ParseOptions& parseOptions)
+{
+   return (parseOptions.lintRFunctions() << 0) |
+          (parseOptions.checkArgumentsToRFunctionCalls() << 1) |
+          (parseOptions.checkUnexpectedAssignmentInFunctionCall() << 2) |
+          (parseOptions.warnIfNoSuchVariableInScope() << 3) |
+          (parseOptions.recordStyleLint() << 4);
+}
+
+// whether an expression continues past a token which ends a line, e.g.
+//
+//    if (x)
+//    function(x)
+//
+bool expectsMoreAfter(const RToken& token)
+{
+   return isFunctionKeyword(token) ||
+          token.contentEquals(L"if") ||
+          token.contentEquals(L"for") ||
+          token.contentEquals(L"while") ||
+          token.contentEquals(L"repeat") ||
+          token.contentEquals(L"else");
+}
+
+// the characters the tokenizer reads as whitespace
+bool isWhitespaceCharacter(wchar_t ch)
+{
+   return ch == L' ' || ch == L'\t' || ch == L'\r' || ch == L'\n' ||
+          ch == L'\x00A0' || ch == L'\x3000';
+}
+
+// whether the code from a token on (the start of a line) starts a new
+// expression; the parser reads anything else after an expression which ends
+// with a closing bracket as continuing it (even at the top level), as in
+//
+//    (x)
+//    (y <- 1)
+//
+// and looks ahead to it when checking the expression before
+bool startsExpression(const RTokens& rTokens, std::size_t offset)
+{
+   for (std::size_t i = offset, n = rTokens.size(); i < n; ++i)
+   {
+      const RToken& token = rTokens.atUnsafe(i);
+      if (!token.isType(RToken::WHITESPACE))
+      {
+         return (token.isType(RToken::ID) && !token.contentEquals(L"else")) ||
+                token.isType(RToken::NUMBER) ||
+                token.isType(RToken::STRING);
+      }
+   }
+   return true;
+}
+
+// the hash of the top-level definitions of an identifier (or 0, if there
+// are none)
+std::size_t definitionsOf(const std::unordered_map<std::string, std::size_t>& definitions,
+                          const std::string& identifier)
+{
+   std::unordered_map<std::string, std::size_t>::const_iterator it =
+         definitions.find(identifier);
+   return it != definitions.end() ? it->second : 0;
+}
+
+} // anonymous namespace
+
+void BlockParser::appendTokens(const Block& block, RTokens* pTokens)
+{
+   for (std::size_t i = block.tokenBegin; i < block.tokenEnd; ++i)
+   {
+      const RToken& token = block.pTokens->atUnsafe(i);
+      pTokens->push_back(RToken(token.type(),
+                                token.begin(),
+                                token.end(),
+                                token.offset(),
+                                token.row() + block.rowShift,
+                                token.column()));
+   }
+}
+
+BlockParser::BlockParser()
+   : parseSignature_(0),
+     parsedBlockCount_(0)
+{
+}
+
+void BlockParser::clear()
+{
+   filePath_ = FilePath();
+   code_.clear();
+   blocks_.clear();
+   parsedBlockCount_ = 0;
+}
+
+ParseResults BlockParser::parse(const FilePath& filePath,
+                                const std::wstring& rCode,
+                                const ParseOptions& parseOptions)
+{
+   int signature = parseSignature(parseOptions);
+   if (filePath != filePath_ || signature != parseSignature_)
+   {
+      clear();
+      filePath_ = filePath;
+      parseSignature_ = signature;
+   }
+   
+   update(rCode);
+   
+   // a block the parser didn't finish is joined with the rest of the
+   // document (which can then be parsed as a whole), so parse again
+   ParseResults results;
+   parsedBlockCount_ = 0;
+   if (!parseBlocks(filePath, parseOptions, &results))
+      parseBlocks(filePath, parseOptions, &results);
+   
+   return results;
+}
+
+bool BlockParser::parseBlocks(const FilePath& filePath,
+                              const ParseOptions& parseOptions,
+                              ParseResults* pResults)
+{
+   // walk the blocks in order, parsing those without (valid) results on to
+   // the end of the tree made of those before them; blocks are parsed with
+   // the tokens of any blocks before them that define functions (which the
+   // parser reads when checking calls to them) and of the block just
+   // before, to look behind
+   boost::shared_ptr<ParseNode> pRoot = ParseNode::createRootNode();
+   LintItems lint(parseOptions);
+   RTokens rTokens(std::wstring(), RTokens::None);
+   std::size_t tokenizedBlocks = 0;
+   
+   // the top-level definitions of each identifier: a hash of the code of
+   // the blocks defining functions with its name, and of whether it is
+   // defined as a variable
+   std::unordered_map<std::string, std::size_t> definitions;
+   
+   for (std::size_t i = 0, n = blocks_.size(); i < n; ++i)
+   {
+      Block& block = blocks_[i];
+      
+      std::size_t identifierCount = block.identifiers.size();
+      if (block.pNode)
+      {
+         for (std::size_t j = 0; j < identifierCount; ++j)
+         {
+            if (definitionsOf(definitions, block.identifiers[j]) != block.definitions[j])
+            {
+               block.pNode.reset();
+               break;
+            }
+         }
+      }
+      
+      if (block.pNode)
+      {
+         pRoot->appendBlock(*block.pNode);
+      }
+      else
+      {
+         if (i > 0 && tokenizedBlocks < i)
+            appendTokens(blocks_[i - 1], &rTokens);
+         
+         std::size_t offset = rTokens.size();
+         appendTokens(block, &rTokens);
+         tokenizedBlocks = i + 1;
+         
+         ++parsedBlockCount_;
+         if (block.hasCode)
+         {
+            std::size_t firstChild = pRoot->getChildren().size();
+            
+            RTokenCursor cursor(rTokens, offset);
+            ParseStatus status(filePath, parseOptions, pRoot);
+            doParse(cursor, status);
+            
+            // the split expected the block to end an expression, but the
+            // parser can recover from errors in ways it doesn't foresee
+            if (!status.isComplete() && i + 1 < n)
+            {
+               join(i);
+               return false;
+            }
+            
+            if (status.node()->getParent() != nullptr)
+               status.lint().unexpectedEndOfDocument(cursor.currentToken());
+            status.addLintIfBracketStackNotEmpty();
+            
+            block.pNode = ParseNode::createRootNode();
+            pRoot->copyBlock(Position(block.startRow, 0), firstChild, block.pNode.get());
+            block.lint = status.lint();
+         }
+         else
+         {
+            block.pNode = ParseNode::createRootNode();
+            block.lint = LintItems(parseOptions);
+         }
+         
+         block.definitions.resize(identifierCount);
+         for (std::size_t j = 0; j < identifierCount; ++j)
+            block.definitions[j] = definitionsOf(definitions, block.identifiers[j]);
+      }
+      
+      lint.push_back(block.lint);
+      
+      for (const ParseNode::SymbolPositions::value_type& symbol :
+              block.pNode->getDefinedSymbols())
+      {
+         boost::hash_combine(definitions[symbol.first], 1);
+      }
+      
+      const ParseNode::Children& children = block.pNode->getChildren();
+      for (const boost::shared_ptr<ParseNode>& pChild : children)
+         boost::hash_combine(definitions[pChild->name()], block.codeHash);
+      
+      // later blocks may read the definitions of these functions
+      if (!children.empty() && tokenizedBlocks <= i)
+      {
+         appendTokens(block, &rTokens);
+         tokenizedBlocks = i + 1;
+      }
+   }
+   
+   *pResults = ParseResults(pRoot, lint, parseOptions.globals());
+   return true;
+}
+
+void BlockParser::update(const std::wstring& rCode)
+{
+   // find where each row starts
+   std::vector<std::size_t> rowOffsets(1, 0);
+   for (std::size_t i = 0, n = rCode.size(); i < n; ++i)
+      if (rCode[i] == L'\n')
+         rowOffsets.push_back(i + 1);
+   
+   if (blocks_.empty())
+   {
+      bool continuesPrevious;
+      split(rCode, rowOffsets, 0, rowOffsets.size(), &blocks_, &continuesPrevious);
+      code_ = rCode;
+      return;
+   }
+   
+   if (rCode == code_)
+      return;
+   
+   // find the rows which changed: those which aren't wholly within the
+   // code common to the start and end of both versions
+   std::size_t size = std::min(code_.size(), rCode.size());
+   std::size_t prefix = std::mismatch(
+            code_.begin(),
+            code_.begin() + size,
+            rCode.begin()).first - code_.begin();
+   
+   std::size_t suffix = 0;
+   while (suffix < size - prefix &&
+          code_[code_.size() - suffix - 1] == rCode[rCode.size() - suffix - 1])
+   {
+      ++suffix;
+   }
+   
+   std::size_t rowCount = std::count(code_.begin(), code_.end(), L'\n') + 1;
+   std::size_t prefixRows = std::count(code_.begin(), code_.begin() + prefix, L'\n');
+   std::size_t suffixRows = std::count(code_.end() - suffix, code_.end(), L'\n');
+   int delta = static_cast<int>(rowOffsets.size()) - static_cast<int>(rowCount);
+   
+   // find the blocks spanning those rows (at least one row changed, as
+   // the common code can't include the newline between them)
+   std::size_t first = 0;
+   while (blocks_[first].endRow <= prefixRows)
+      ++first;
+   
+   std::size_t last = first;
+   while (blocks_[last].endRow < rowCount - suffixRows)
+      ++last;
+   
+   // split those blocks again, extending them if the first no longer starts
+   // an expression (or a token) or the last no longer ends one
+   std::vector<Block> blocks;
+   while (true)
+   {
+      blocks.clear();
+      bool continuesPrevious = false;
+      bool complete = split(rCode,
+                            rowOffsets,
+                            blocks_[first].startRow,
+                            blocks_[last].endRow + delta,
+                            &blocks,
+                            &continuesPrevious);
+      
+      if (continuesPrevious && first > 0)
+         --first;
+      else if (!complete && last + 1 < blocks_.size())
+         ++last;
+      else
+         break;
+   }
+   
+   for (std::size_t i = last + 1, n = blocks_.size(); i < n; ++i)
+      shift(&blocks_[i], delta);
+   
+   blocks_.erase(blocks_.begin() + first, blocks_.begin() + last + 1);
+   blocks_.insert(blocks_.begin() + first, blocks.begin(), blocks.end());
+   code_ = rCode;
+}
+
+bool BlockParser::split(const std::wstring& rCode,
+                        const std::vector<std::size_t>& rowOffsets,
+                        std::size_t startRow,
+                        std::size_t endRow,
+                        std::vector<Block>* pBlocks,
+                        bool* pContinuesPrevious) const
+{
+   std::size_t beginOffset = rowOffsets[startRow];
+   std::size_t endOffset = endRow < rowOffsets.size() ? rowOffsets[endRow] : rCode.size();
+   
+   boost::shared_ptr<RTokens> pTokens(new RTokens(
+            rCode.substr(beginOffset, endOffset - beginOffset),
+            Position(startRow, 0),
+            RTokens::StripComments));
+   
+   // whitespace at the start would be part of the whitespace which ends
+   // the block before, and other code may continue its expression
+   *pContinuesPrevious =
+         (beginOffset < endOffset && isWhitespaceCharacter(rCode[beginOffset])) ||
+         !startsExpression(*pTokens, 0);
+   
+   // a block ends with the line that completes a top-level expression, when
+   // the next line starts another (and doesn't start with whitespace, which
+   // the tokenizer would join with the newline), so track the brackets which
+   // are open (with the bracket which closes each, and whether it opened the
+   // condition of a control flow statement or the arguments of a function,
+   // which the expression continues past) and whether the expression so far
+   // is complete; once the brackets don't match the rest of the code can
+   // only be parsed as a whole
+   std::vector<std::pair<RToken::TokenType, bool> > openBrackets;
+   bool balanced = true;
+   bool complete = false;
+   const RToken* pPrevious = nullptr;
+   
+   Block block;
+   block.startRow = startRow;
+   block.pTokens = pTokens;
+   block.tokenBegin = 0;
+   block.rowShift = 0;
+   block.hasCode = false;
+   
+   std::set<std::string> identifiers;
+   for (std::size_t i = 0, n = pTokens->size(); i < n; ++i)
+   {
+      const RToken& token = pTokens->atUnsafe(i);
+      switch (token.type())
+      {
+      case RToken::WHITESPACE:
+      {
+         if (!balanced || !openBrackets.empty() || !complete ||
+             *(token.end() - 1) != L'\n' || !startsExpression(*pTokens, i + 1))
+         {
+            continue;
+         }
+         
+         // the block takes the whitespace, and so the rows it ends
+         block.endRow = token.row() + std::count(token.begin(), token.end(), L'\n');
+         block.tokenEnd = i + 1;
+         block.codeHash = boost::hash_range(
+                  rCode.begin() + rowOffsets[block.startRow],
+                  rCode.begin() + rowOffsets[block.endRow]);
+         block.identifiers.assign(identifiers.begin(), identifiers.end());
+         pBlocks->push_back(block);
+         
+         block.startRow = block.endRow;
+         block.tokenBegin = block.tokenEnd;
+         block.hasCode = false;
+         identifiers.clear();
+         complete = false;
+         continue;
+      }
+         
+      case RToken::LPAREN:
+      case RToken::LBRACKET:
+      case RToken::LDBRACKET:
+      case RToken::LBRACE:
+         openBrackets.push_back(std::make_pair(
+                  typeComplement(token.type()),
+                  token.isType(RToken::LPAREN) &&
+                     pPrevious && expectsMoreAfter(*pPrevious)));
+         complete = false;
+         break;
+         
+      case RToken::RPAREN:
+      case RToken::RBRACKET:
+      case RToken::RDBRACKET:
+      case RToken::RBRACE:
+         if (openBrackets.empty() || openBrackets.back().first != token.type())
+         {
+            balanced = false;
+         }
+         else
+         {
+            complete = !openBrackets.back().second;
+            openBrackets.pop_back();
+         }
+         break;
+         
+      case RToken::ID:
+         identifiers.insert(token.contentAsUtf8());
+         identifiers.insert(getSymbolName(token));
+         complete = !expectsMoreAfter(token);
+         break;
+         
+      case RToken::NUMBER:
+      case RToken::STRING:
+      case RToken::SEMI:
+         complete = true;
+         break;
+         
+      default:
+         complete = false;
+         break;
+      }
+      
+      block.hasCode = true;
+      pPrevious = &token;
+   }
+   
+   // the rows after the last complete expression which hold no code go
+   // with it
+   bool endsExpression = !block.hasCode;
+   if (endsExpression && !pBlocks->empty())
+   {
+      Block& previous = pBlocks->back();
+      block.startRow = previous.startRow;
+      block.tokenBegin = previous.tokenBegin;
+      block.hasCode = previous.hasCode;
+      identifiers.insert(previous.identifiers.begin(), previous.identifiers.end());
+      pBlocks->pop_back();
+   }
+   
+   block.endRow = endRow;
+   block.tokenEnd = pTokens->size();
+   block.codeHash = boost::hash_range(
+            rCode.begin() + rowOffsets[block.startRow],
+            rCode.begin() + endOffset);
+   block.identifiers.assign(identifiers.begin(), identifiers.end());
+   pBlocks->push_back(block);
+   
+   return endsExpression;
+}
+
+void BlockParser::join(std::size_t first)
+{
+   Block& block = blocks_[first];
+   
+   std::size_t beginOffset = 0;
+   for (std::size_t row = 0; row < block.startRow; ++row)
+      beginOffset = code_.find(L'\n', beginOffset) + 1;
+   
+   std::set<std::string> identifiers;
+   for (std::size_t i = first, n = blocks_.size(); i < n; ++i)
+   {
+      block.hasCode = block.hasCode || blocks_[i].hasCode;
+      identifiers.insert(blocks_[i].identifiers.begin(), blocks_[i].identifiers.end());
+   }
+   
+   block.endRow = blocks_.back().endRow;
+   block.pTokens.reset(new RTokens(
+            code_.substr(beginOffset),
+            Position(block.startRow, 0),
+            RTokens::StripComments));
+   block.tokenBegin = 0;
+   block.tokenEnd = block.pTokens->size();
+   block.rowShift = 0;
+   block.codeHash = boost::hash_range(code_.begin() + beginOffset, code_.end());
+   block.identifiers.assign(identifiers.begin(), identifiers.end());
+   block.pNode.reset();
+   
+   blocks_.erase(blocks_.begin() + first + 1, blocks_.end());
+}
+
+void BlockParser::shift(Block* pBlock, int delta)
+{
+   if (delta == 0)
+      return;
+   
+   if (pBlock->pNode)
+   {
+      pBlock->pNode->shiftRows(delta);
+      pBlock->lint.shiftRows(static_cast<int>(pBlock->startRow), delta);
+   }
+   
+   pBlock->startRow += delta;
+   pBlock->endRow += delta;
+   pBlock->rowShift += delta;
+}
+
 } // namespace rparser
 } // namespace modules
 } // namespace session
@@ -504,12 +504,28 @@ public:
    void push_back(const LintItem& item)
    {
       lintItems_.push_back(item);
+      errorCount_ += item.type == LintTypeError;
    }
    
    void push_back(const LintItems& items)
    {
-      for (std::size_t i = 0, n = items.size(); i < n; ++i)
-         lintItems_.push_back(items.get()[i]);
+      lintItems_.insert(lintItems_.end(), items.begin(), items.end());
+      errorCount_ += items.errorCount();
+   }
+   
+   // moves the items from a row on down (or up) the document by the given
+   // number of rows (those before it are placed at the start of the
+   // document, having no position of their own)
+   void shiftRows(int fromRow, int delta)
+   {
+      for (LintItem& item : lintItems_)
+      {
+         if (item.startRow < fromRow)
+            continue;
+         
+         item.startRow += delta;
+         item.endRow += delta;
+      }
    }
    
    typedef std::vector<LintItem>::iterator iterator;
@@ -853,8 +869,9 @@ public:
    bool symbolHasDefinitionInRange(const std::string& symbol,
                                    const Position& position) const
    {
-      for (SymbolRanges::const_iterator it = symbolRanges().begin();
-           it != symbolRanges().end();
+      const SymbolRanges& symbolRanges = getRoot()->symbolRanges_;
+      for (SymbolRanges::const_iterator it = symbolRanges.begin();
+           it != symbolRanges.end();
            ++it)
       {
          if (it->first.contains(position) &&
@@ -981,11 +998,118 @@ public:
          const Position& end)
    {
       core::algorithm::insert(
-            symbolRanges()[Range(begin, end)],
+            getRoot()->symbolRanges_[Range(begin, end)],
             symbols.begin(),
             symbols.end());
    }
    
+   // Blocks ----
+   //
+   // A block node records what parsing a single top-level expression added
+   // to the root node: the symbols and ranges at or after the position of
+   // the expression, and the child nodes (see 'BlockParser').
+   
+   // copies what was added to this root node at or after 'position', with
+   // the children from index 'firstChild', into the (empty) block node
+   void copyBlock(const Position& position,
+                  std::size_t firstChild,
+                  ParseNode* pBlock) const
+   {
+      copySymbols(definedSymbols_, position, &pBlock->definedSymbols_);
+      copySymbols(referencedSymbols_, position, &pBlock->referencedSymbols_);
+      copySymbols(nseReferencedSymbols_, position, &pBlock->nseReferencedSymbols_);
+      
+      for (const SymbolRanges::value_type& range : symbolRanges_)
+         if (range.first.begin() >= position)
+            pBlock->symbolRanges_[range.first] = range.second;
+      
+      pBlock->children_.assign(children_.begin() + firstChild, children_.end());
+   }
+   
+   // adds what a block node records to this root node, adopting its children
+   void appendBlock(const ParseNode& block)
+   {
+      appendSymbols(block.definedSymbols_, &definedSymbols_);
+      appendSymbols(block.referencedSymbols_, &referencedSymbols_);
+      appendSymbols(block.nseReferencedSymbols_, &nseReferencedSymbols_);
+      
+      for (const SymbolRanges::value_type& range : block.symbolRanges_)
+         core::algorithm::insert(
+                  symbolRanges_[range.first],
+                  range.second.begin(),
+                  range.second.end());
+      
+      for (const boost::shared_ptr<ParseNode>& pChild : block.children_)
+      {
+         pChild->pParent_ = this;
+         children_.push_back(pChild);
+      }
+   }
+   
+   // moves this node and its children down (or up) the document by the
+   // given number of rows
+   void shiftRows(int delta)
+   {
+      position_.row += delta;
+      shiftSymbols(&definedSymbols_, delta);
+      shiftSymbols(&referencedSymbols_, delta);
+      shiftSymbols(&nseReferencedSymbols_, delta);
+      
+      if (!symbolRanges_.empty())
+      {
+         SymbolRanges symbolRanges;
+         for (const SymbolRanges::value_type& range : symbolRanges_)
+         {
+            Position begin = range.first.begin();
+            Position end = range.first.end();
+            begin.row += delta;
+            end.row += delta;
+            symbolRanges[Range(begin, end)] = range.second;
+         }
+         symbolRanges_.swap(symbolRanges);
+      }
+      
+      for (const boost::shared_ptr<ParseNode>& pChild : children_)
+         pChild->shiftRows(delta);
+   }
+   
+private:
+   
+   static void copySymbols(const SymbolPositions& symbols,
+                           const Position& position,
+                           SymbolPositions* pBlockSymbols)
+   {
+      for (const SymbolPositions::value_type& symbol : symbols)
+      {
+         // positions are recorded in document order, so those in the
+         // block are at the end
+         const Positions& positions = symbol.second;
+         Positions::const_iterator it = positions.end();
+         while (it != positions.begin() && *(it - 1) >= position)
+            --it;
+         
+         if (it != positions.end())
+            (*pBlockSymbols)[symbol.first].assign(it, positions.end());
+      }
+   }
+   
+   static void appendSymbols(const SymbolPositions& blockSymbols,
+                             SymbolPositions* pSymbols)
+   {
+      for (const SymbolPositions::value_type& symbol : blockSymbols)
+      {
+         Positions& positions = (*pSymbols)[symbol.first];
+         positions.insert(positions.end(), symbol.second.begin(), symbol.second.end());
+      }
+   }
+   
+   static void shiftSymbols(SymbolPositions* pSymbols, int delta)
+   {
+      for (SymbolPositions::value_type& symbol : *pSymbols)
+         for (Position& position : symbol.second)
+            position.row += delta;
+   }
+   
 public:
    
    const std::string& name() const { return name_; }
@@ -1021,12 +1145,10 @@ private:
    PackageSymbols internalSymbols_; // <pkg>::<foo>
    PackageSymbols exportedSymbols_; // <pgk>:::<bar>
    
+   // symbols made available within ranges of the document (kept on the
+   // root node, for the whole tree)
    typedef std::map<Range, std::set<std::string> > SymbolRanges;
-   static SymbolRanges& symbolRanges()
-   {
-      static SymbolRanges instance;
-      return instance;
-   }
+   SymbolRanges symbolRanges_;
 };
 
 class ParseStatus
@@ -1039,7 +1161,26 @@ public:
         pNode_(pRoot_.get()),
         lint_(parseOptions),
         parseOptions_(parseOptions),
-        filePath_(filePath)
+        filePath_(filePath),
+        reachedEndOfDocument_(false),
+        stoppedParsing_(false)
+   {
+      parseStateStack_.push(ParseStateTopLevel);
+      functionNames_.push(std::wstring(L""));
+   }
+   
+   // continues the parse of a document at the top level, adding to the
+   // parse tree of what came before
+   ParseStatus(const FilePath& filePath,
+               const ParseOptions& parseOptions,
+               boost::shared_ptr<ParseNode> pRoot)
+      : pRoot_(pRoot),
+        pNode_(pRoot_.get()),
+        lint_(parseOptions),
+        parseOptions_(parseOptions),
+        filePath_(filePath),
+        reachedEndOfDocument_(false),
+        stoppedParsing_(false)
    {
       parseStateStack_.push(ParseStateTopLevel);
       functionNames_.push(std::wstring(L""));
@@ -1047,6 +1188,29 @@ public:
    
    ParseNode* node() { return pNode_; }
    LintItems& lint() { return lint_; }
+   
+   void unexpectedEndOfDocument(const RToken& token)
+   {
+      lint_.unexpectedEndOfDocument(token);
+      reachedEndOfDocument_ = true;
+   }
+   
+   // the parser gives up on the rest of the document after some errors
+   void stopParsing()
+   {
+      stoppedParsing_ = true;
+   }
+   
+   // whether the parse finished at the top level of the document, with no
+   // scopes, brackets or statements left open
+   bool isComplete() const
+   {
+      return !reachedEndOfDocument_ &&
+             !stoppedParsing_ &&
+             pNode_->getParent() == nullptr &&
+             bracketStack_.empty() &&
+             parseStateStack_.size() == 1;
+   }
    boost::shared_ptr<ParseNode> root() { return pRoot_; }
    
    void addChildAndSetAsCurrentNode(boost::shared_ptr<ParseNode> pChild,
@@ -1444,6 +1608,12 @@ private:
    SymbolRanges symbolRanges_;
    
    FilePath filePath_;
+   
+   // whether the parser ran out of tokens in the middle of an expression
+   bool reachedEndOfDocument_;
+   
+   // whether the parser stopped at an error (before the end of the tokens)
+   bool stoppedParsing_;
 };
 
 class ParseResults {
@@ -1502,6 +1672,84 @@ ParseResults parse(const std::string& rCode,
 ParseResults parse(const std::wstring& rCode,
                    const ParseOptions& parseOptions = ParseOptions());
 
+// Parses a document one top-level expression (block) at a time, keeping the
+// tokens and parse results of each block so that, when the document is
+// parsed again after an edit, only the blocks covering the edited lines (and
+// any that refer to top-level definitions those blocks changed) are parsed
+// again. The results are merged into a single parse tree and lint, as
+// 'parse()' would produce for the whole document.
+//
+// Note that the parse tree returned shares its nodes with the cached blocks,
+// so it is only valid until the next call to 'parse()'.
+class BlockParser : boost::noncopyable
+{
+public:
+   
+   BlockParser();
+   
+   ParseResults parse(const core::FilePath& filePath,
+                      const std::wstring& rCode,
+                      const ParseOptions& parseOptions);
+   
+   void clear();
+   
+   // the number of blocks in the document, and how many of them were
+   // parsed by the last call to 'parse()'
+   std::size_t blockCount() const { return blocks_.size(); }
+   std::size_t parsedBlockCount() const { return parsedBlockCount_; }
+   
+private:
+   
+   struct Block
+   {
+      // the rows of the document the block spans
+      std::size_t startRow;
+      std::size_t endRow;
+      
+      // the tokens of the block (shared with the blocks tokenized along
+      // with it), and how far the block has moved since it was tokenized
+      boost::shared_ptr<RTokens> pTokens;
+      std::size_t tokenBegin;
+      std::size_t tokenEnd;
+      int rowShift;
+      bool hasCode;
+      
+      // a hash of the block's code, and the identifiers it contains
+      std::size_t codeHash;
+      std::vector<std::string> identifiers;
+      
+      // the parse results (a block node, or null if the block needs to be
+      // parsed), and the definitions of its identifiers that preceded it
+      boost::shared_ptr<ParseNode> pNode;
+      LintItems lint;
+      std::vector<std::size_t> definitions;
+   };
+   
+   bool parseBlocks(const core::FilePath& filePath,
+                    const ParseOptions& parseOptions,
+                    ParseResults* pResults);
+   
+   void update(const std::wstring& rCode);
+   
+   bool split(const std::wstring& rCode,
+              const std::vector<std::size_t>& rowOffsets,
+              std::size_t startRow,
+              std::size_t endRow,
+              std::vector<Block>* pBlocks,
+              bool* pContinuesPrevious) const;
+   
+   void join(std::size_t first);
+   
+   static void shift(Block* pBlock, int delta);
+   static void appendTokens(const Block& block, RTokens* pTokens);
+   
+   core::FilePath filePath_;
+   int parseSignature_;
+   std::wstring code_;
+   std::vector<Block> blocks_;
+   std::size_t parsedBlockCount_;
+};
+
 } // namespace rparser
 } // namespace modules
 } // namespace session
@@ -159,6 +159,11 @@ boost::shared_ptr<FileDecorationContext> fileDecorationContext(
    }
 }
 
+void onFilesChanged(const std::vector<core::system::FileChangeEvent>& events)
+{
+   git::onFilesChanged(events);
+}
+
 VCS activeVCS()
 {
    return git::isGitEnabled() ? VCSGit : VCSNone;
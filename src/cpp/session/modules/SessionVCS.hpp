@@ -42,6 +42,9 @@ boost::shared_ptr<FileDecorationContext> fileDecorationContext(
       const core::FilePath& rootDir,
       bool implicit);
 
+// notifies source control of changed files (call before decorating them)
+void onFilesChanged(const std::vector<core::system::FileChangeEvent>& events);
+
 VCS activeVCS();
 std::string activeVCSName();
 bool isGitInstalled();
@@ -14,6 +14,8 @@
  */
 
 #include "DataViewer.hpp"
+#include "DataViewerPage.hpp"
+#include "DataViewerTransform.hpp"
 
 #include <string>
 #include <vector>
@@ -52,19 +54,17 @@
 #define kGridResourceLocation "/" kGridResource "/"
 #define kNoBoundEnv "_rs_no_env"
 
-// separates filter type from contents (e.g. "numeric|12-25")
-#define kFilterSeparator "|"
-
 // the largest number of factor values we're willing to display (after this
 // point the column's text is searched as though it were a character column)
 #define MAX_FACTORS 64
 
-// special cell values
-#define SPECIAL_CELL_NA 0
-
 // default max value for columns to return unless client requests more
 #define MAX_COLUMNS 50
 
+// the most pages (and bytes of pages) kept for redrawing, across all viewers
+#define MAX_CACHED_PAGES 64
+#define MAX_CACHED_PAGE_BYTES (32 * 1024 * 1024)
+
 using namespace rstudio::core;
 using namespace boost::placeholders;
 
@@ -115,88 +115,27 @@ namespace {
  *    housewares between $10-$25, then only housewares between $10-25 and
  *    matching the text "eggs".
  *    
- *    In order to avoid re-ordering and re-filtering the entire dataset every
- *    time a new set of rows is requested, we keep a "working copy" of the
- *    object in a second environment, .rs.WorkingDataEnv, using the same cache
- *    keys.
+ *    Rather than keeping a transformed copy of the object, we keep a
+ *    FrameTransform for each cache key: the rows of the object to display,
+ *    along with the sort orders and per-column filter results used to compute
+ *    them (see DataViewerTransform.hpp). 
  *    
- *    When a request for data arrives, we check to see if the data requested is
- *    a subset of the data already in our working copy. If it is, we use the
- *    working copy as a starting position rather than the original or cached
- *    object.
+ *    When a request for data arrives, a filter that narrows the previous one
+ *    on the same column only re-examines the rows that previously matched,
+ *    a sort that has already been computed is reused, and only the rows on
+ *    the requested page are formatted.
  *
  *    This allows us to efficiently perform operations on very large datasets
- *    once they've been winnowed down to smaller objects using searches and
- *    filters.
+ *    without ever copying them.
+ *
+ * PAGES:
+ *    The pages of data most recently sent to viewers are also kept, as the
+ *    JSON that was sent, keyed by cache key, view (sort, filters, search),
+ *    and the rows and columns requested; scrolling back to a page therefore
+ *    doesn't format it again. A viewer's pages are discarded along with its
+ *    view when its object changes or the viewer closes.
  */    
 
-// indicates whether one filter string is a subset of another; e.g. if a column
-// is filtered for "abc" and then "abcd", the new state is a subset of the
-// previous state.
-bool isFilterSubset(const std::string& outer, const std::string& inner) 
-{
-   // shortcut for identical filters (the typical case)
-   if (inner == outer) 
-      return true;
-
-   // find filter separators; if we can't find them, presume no subset since we
-   // can't parse filters
-   size_t outerPipe = outer.find(kFilterSeparator);
-   if (outerPipe == std::string::npos) 
-      return false;
-   size_t innerPipe = inner.find(kFilterSeparator);
-   if (innerPipe == std::string::npos)
-      return false;
-
-   std::string outerType(outer.substr(0, outerPipe));
-   std::string innerType(inner.substr(0, innerPipe));
-   std::string outerValue(outer.substr(outerPipe + 1, 
-            outer.length() - outerPipe));
-   std::string innerValue(inner.substr(innerPipe + 1, 
-            inner.length() - innerPipe));
-   
-   // only identical types can be subsets
-   if (outerType != innerType) 
-      return false;
-
-   if (outerType == "numeric")
-   {
-      // matches a numeric filter (i.e. "2.71_3.14") -- in this case we need to
-      // check the components for range inclusion
-      boost::regex numFilter("(-?\\d+\\.?\\d*)_(-?\\d+\\.?\\d*)");
-      boost::smatch innerMatch, outerMatch;
-      if (regex_utils::search(innerValue, innerMatch, numFilter) &&
-          regex_utils::search(outerValue, outerMatch, numFilter))
-      {
-         // for numeric filters, the inner is a subset if its lower bound (1)
-         // is larger than the outer lower bound, and the upper bound (2) is
-         // smaller than the outer upper bound
-         return safe_convert::stringTo<double>(innerMatch[1], 0) >= 
-                safe_convert::stringTo<double>(outerMatch[1], 0) &&
-                safe_convert::stringTo<double>(innerMatch[2], 0) <= 
-                safe_convert::stringTo<double>(outerMatch[2], 0);
-      }
-
-      // if not identical and not a range, then not a subset
-      return false;
-   } 
-   else if (outerType == "factor" || outerType == "boolean")
-   {
-      // factors and boolean values have to be identical for subsetting, and we
-      // already checked above
-      return false;
-   }
-   else if (outerType == "character")
-   {
-      // characters are a subset if the outer string is within the inner one
-      // (i.e. a search for "walnuts" (inner) is within "walnut" (outer))
-      return inner.find(outer) != std::string::npos;
-   }
-   
-   // unknown filter type
-   return false;
-}
-
 typedef enum 
 {
   DIM_ROWS,
@@ -264,31 +203,6 @@ struct CachedFrame
    int ncol;
    std::vector<std::string> colNames;
 
-   // The current search string and filter set
-   std::string workingSearch;
-   std::vector<std::string> workingFilters;
-
-   bool isSupersetOf(const std::string& newSearch, 
-                     const std::vector<std::string> &newFilters)
-   {
-      if (!isFilterSubset(workingSearch, newSearch))
-         return false;
-
-      for (unsigned i = 0;
-           i < std::min(newFilters.size(), workingFilters.size());
-           i++)
-      {
-         if (!isFilterSubset(workingFilters[i], newFilters[i]))
-            return false;
-      }
-
-      return true;
-   };
-
-   // The current order column and direction
-   std::vector<int> workingOrderCols;
-   std::vector<std::string> workingOrderDirs;
-
    // NB: There's no protection on this SEXP and it may be a stale pointer!
    // Used only to test for changes.
    SEXP observedSEXP;
@@ -297,6 +211,12 @@ struct CachedFrame
 // The set of active frames. Used primarily to check each for changes.
 std::map<std::string, CachedFrame> s_cachedFrames;
 
+// The sorted/filtered views of active frames, by cache key.
+std::map<std::string, boost::shared_ptr<FrameTransform> > s_frameTransforms;
+
+// The pages most recently sent to viewers.
+PageCache s_pageCache(MAX_CACHED_PAGES, MAX_CACHED_PAGE_BYTES);
+
 std::string viewerCacheDir() 
 {
    return module_context::sessionScratchPath().completeChildPath(kViewerCacheDir)
@@ -487,17 +407,241 @@ json::Value getCols(SEXP dataSEXP)
    return result;
 }
 
+int integerOption(const std::string& name, int defaultValue)
+{
+   SEXP valueSEXP = r::options::getOption(name);
+   if (r::sexp::length(valueSEXP) == 0)
+      return defaultValue;
+
+   int value = Rf_asInteger(valueSEXP);
+   return value == NA_INTEGER ? defaultValue : value;
+}
+
+// is this a vector without a class or dimensions? (these are formatted by
+// format.default() or as.character(), which we can do natively)
+bool isPlainVector(SEXP columnSEXP)
+{
+   return !OBJECT(columnSEXP) &&
+      r::sexp::getAttrib(columnSEXP, R_DimSymbol) == R_NilValue;
+}
+
+// is this a factor with no subclasses other than "ordered"? (these are
+// formatted by format.factor(), i.e. as their labels)
+bool isPlainFactor(SEXP columnSEXP)
+{
+   if (TYPEOF(columnSEXP) != INTSXP || !OBJECT(columnSEXP))
+      return false;
+
+   SEXP classSEXP = r::sexp::getAttrib(columnSEXP, R_ClassSymbol);
+   if (TYPEOF(classSEXP) != STRSXP)
+      return false;
+
+   bool isFactor = false;
+   for (int i = 0, n = r::sexp::length(classSEXP); i < n; i++)
+   {
+      std::string className = CHAR(STRING_ELT(classSEXP, i));
+      if (className == "factor")
+         isFactor = true;
+      else if (className != "ordered")
+         return false;
+   }
+
+   return isFactor && 
+      TYPEOF(r::sexp::getAttrib(columnSEXP, R_LevelsSymbol)) == STRSXP;
+}
+
+// returns a data frame's row names as stored; unlike getAttrib(), this
+// doesn't expand compact row names (c(NA, -nrow)) into a vector of row numbers
+SEXP storedRowNames(SEXP dataSEXP)
+{
+   for (SEXP attribSEXP = ATTRIB(dataSEXP);
+        attribSEXP != R_NilValue;
+        attribSEXP = CDR(attribSEXP))
+   {
+      if (TAG(attribSEXP) == R_RowNamesSymbol)
+         return CAR(attribSEXP);
+   }
+
+   return R_NilValue;
+}
+
+// writes the elements of a character vector at the given positions
+void writeStrings(SEXP stringsSEXP, 
+                  const std::vector<int>& positions,
+                  PageWriter* pWriter)
+{
+   auto vmax = vmaxget();
+   int n = r::sexp::length(stringsSEXP);
+   for (int position : positions)
+   {
+      SEXP charSEXP = position < n ? STRING_ELT(stringsSEXP, position) : NA_STRING;
+      if (charSEXP == NA_STRING)
+         pWriter->writeMissing();
+      else
+         pWriter->writeString(Rf_translateCharUTF8(charSEXP));
+   }
+   vmaxset(vmax);
+}
+
+// writes numbers the way .rs.formatDataColumnNumeric() formats them
+void writeNumbers(SEXP columnSEXP,
+                  const std::vector<int>& rows,
+                  int digits,
+                  int scipen,
+                  PageWriter* pWriter)
+{
+   int n = r::sexp::length(columnSEXP);
+   std::vector<double> values;
+   values.reserve(rows.size());
+   for (int row : rows)
+   {
+      if (row >= n)
+         values.push_back(NA_REAL);
+      else if (TYPEOF(columnSEXP) == REALSXP)
+         values.push_back(REAL(columnSEXP)[row]);
+      else if (INTEGER(columnSEXP)[row] == NA_INTEGER)
+         values.push_back(NA_REAL);
+      else
+         values.push_back(INTEGER(columnSEXP)[row]);
+   }
+
+   // finite values are formatted together (as format() does)
+   std::vector<double> finiteValues;
+   for (double value : values)
+   {
+      if (R_FINITE(value))
+         finiteValues.push_back(value);
+   }
+   NumberFormat format = numberFormat(finiteValues, digits, scipen);
+
+   for (double value : values)
+   {
+      if (R_FINITE(value))
+         pWriter->writeString(formatNumber(value, format));
+      else if (ISNA(value))
+         pWriter->writeMissing();
+      else if (ISNAN(value))
+         pWriter->writeString("NaN");
+      else
+         pWriter->writeString(value > 0 ? "Inf" : "-Inf");
+   }
+}
+
+// writes a column's values at the given rows, formatted as
+// .rs.formatDataColumn() would format them; returns false for columns that
+// need R to format them (e.g. those with classes)
+bool writeColumn(SEXP columnSEXP,
+                 const std::vector<int>& rows,
+                 int digits,
+                 int scipen,
+                 PageWriter* pWriter)
+{
+   int n = r::sexp::length(columnSEXP);
+   if (isPlainFactor(columnSEXP))
+   {
+      SEXP levelsSEXP = r::sexp::getAttrib(columnSEXP, R_LevelsSymbol);
+      int nlevels = r::sexp::length(levelsSEXP);
+      std::vector<int> levels;
+      for (int row : rows)
+      {
+         int code = row < n ? INTEGER(columnSEXP)[row] : NA_INTEGER;
+         levels.push_back(code >= 1 && code <= nlevels ? code - 1 : nlevels);
+      }
+      writeStrings(levelsSEXP, levels, pWriter);
+      return true;
+   }
+
+   if (!isPlainVector(columnSEXP))
+      return false;
+
+   switch (TYPEOF(columnSEXP))
+   {
+      case STRSXP:
+         writeStrings(columnSEXP, rows, pWriter);
+         return true;
+
+      case LGLSXP:
+         for (int row : rows)
+         {
+            int value = row < n ? LOGICAL(columnSEXP)[row] : NA_LOGICAL;
+            if (value == NA_LOGICAL)
+               pWriter->writeMissing();
+            else
+               pWriter->writeString(value ? "TRUE" : "FALSE");
+         }
+         return true;
+
+      case INTSXP:
+      case REALSXP:
+         // larger values of 'digits' need more precision than we format with
+         if (digits > 15)
+            return false;
+         writeNumbers(columnSEXP, rows, digits, scipen, pWriter);
+         return true;
+
+      default:
+         return false;
+   }
+}
+
+// writes a data frame's row names at the given rows; returns false when R
+// needs to format them
+bool writeRowNames(SEXP dataSEXP, const std::vector<int>& rows, PageWriter* pWriter)
+{
+   if (!Rf_inherits(dataSEXP, "data.frame"))
+      return false;
+
+   SEXP rowNamesSEXP = storedRowNames(dataSEXP);
+   int n = r::sexp::length(rowNamesSEXP);
+   if (TYPEOF(rowNamesSEXP) == INTSXP)
+   {
+      // automatic row names are just the row numbers
+      const int* pRowNames = INTEGER(rowNamesSEXP);
+      bool automatic = n == 2 && pRowNames[0] == NA_INTEGER;
+      for (int row : rows)
+      {
+         if (automatic || row >= n || pRowNames[row] == NA_INTEGER)
+            pWriter->writeNumber(row + 1);
+         else
+            pWriter->writeString(std::to_string(pRowNames[row]));
+      }
+      return true;
+   }
+   else if (TYPEOF(rowNamesSEXP) == STRSXP)
+   {
+      auto vmax = vmaxget();
+      for (int row : rows)
+      {
+         SEXP nameSEXP = row < n ? STRING_ELT(rowNamesSEXP, row) : R_BlankString;
+         if (nameSEXP == NA_STRING)
+            pWriter->writeMissing();
+         else if (r::sexp::length(nameSEXP) == 0)
+            pWriter->writeNumber(row + 1);
+         else
+            pWriter->writeString(Rf_translateCharUTF8(nameSEXP));
+      }
+      vmaxset(vmax);
+      return true;
+   }
+
+   return false;
+}
+
 // given an object from which to return data, and a description of the data to
 // return via URL-encoded parameters supplied by the DataTables API, returns the
 // data requested by the parameters. 
 //
 // the shape of the API is described here:
 // http://datatables.net/manual/server-side
+//
+// rather than an array of rows, the data is returned as an array of columns
+// (the first of which holds the row names) along with a bitmap of the
+// missing values in each column; see PageWriter.
 // 
 // NB: may throw exceptions! these are expected to be handled by the handlers
 // in getGridData, where they will be marshaled to JSON and displayed on the
 // client.
-json::Value getData(SEXP dataSEXP, const http::Fields& fields)
+std::string getData(SEXP dataSEXP, const http::Fields& fields)
 {
    Error error;
    r::sexp::Protect protect;
@@ -570,92 +714,96 @@ json::Value getData(SEXP dataSEXP, const http::Fields& fields)
    }
 
    bool needsTransform = ordercols.size() > 0 || hasFilter || !search.empty();
-   bool hasTransform = false;
 
-   // check to see if we have an ordered/filtered view we can build from
-   auto cachedFrame = s_cachedFrames.find(cacheKey);
-   if (needsTransform)
+   // options affecting how numbers are formatted
+   int digits = integerOption("digits", 7);
+   int scipen = integerOption("scipen", 0);
+   int numFormattedColumns = ncol - columnOffset < maxColumns ? ncol - columnOffset : maxColumns;
+
+   // have we sent this page before? (e.g. when scrolling back)
+   std::string pageKey;
+   if (!cacheKey.empty())
    {
-      if (cachedFrame != s_cachedFrames.end())
-      {
-         // do we have a previously ordered/filtered view?
-         SEXP workingDataSEXP = R_NilValue;
-         r::exec::RFunction(".rs.findWorkingData", cacheKey)
-            .call(&workingDataSEXP, &protect);
-         
-         if (workingDataSEXP != R_NilValue)
-         {
-            if (cachedFrame->second.workingSearch == search &&
-                cachedFrame->second.workingFilters == filters && 
-                cachedFrame->second.workingOrderDirs == orderdirs &&
-                cachedFrame->second.workingOrderCols == ordercols)
-            {
-               // we have one with exactly the same parameters as requested;
-               // use it exactly as is
-               dataSEXP = workingDataSEXP;
-               needsTransform = false;
-               hasTransform = true;
-            }
-            else if (cachedFrame->second.isSupersetOf(search, filters))
-            {
-               // we have one that is a strict superset of the parameters
-               // requested; transform the filtered set instead of starting
-               // from scratch
-               dataSEXP = workingDataSEXP;
-            }
-         }
-      }
+      std::ostringstream key;
+      key << cacheKey << '\x1f' << static_cast<void*>(dataSEXP) << '\x1f'
+          << nrow << '\x1f' << ncol << '\x1f' << start << '\x1f' << length << '\x1f'
+          << columnOffset << '\x1f' << numFormattedColumns << '\x1f'
+          << digits << '\x1f' << scipen << '\x1f'
+          << prefs::userPrefs().dataViewerMaxCellSize() << '\x1f' << search;
+      for (const std::string& filter : filters)
+         key << '\x1f' << filter;
+      for (std::size_t i = 0; i < ordercols.size(); i++)
+         key << '\x1f' << ordercols[i] << orderdirs[i];
+      pageKey = key.str();
+
+      std::string page;
+      if (s_pageCache.find(pageKey, &page))
+         return pageResponse(draw, page);
    }
 
-   // apply transformations if needed.    
-   if (needsTransform) 
+   // find the rows to display (0-based, in the untransformed data)
+   const std::vector<int>* pRows = nullptr;
+   if (needsTransform)
    {
-      // can we use a working copy? 
-      r::exec::RFunction transform(".rs.applyTransform");
-      transform.addParam("x", dataSEXP);       // data to transform
-      transform.addParam("filtered", filters); // which columns are filtered
-      transform.addParam("search", search);    // global search (across cols)
-      transform.addParam("cols", ordercols);     // which column to order on
-      transform.addParam("dirs", orderdirs);     // order direction ("asc"/"desc")
-      transform.call(&dataSEXP, &protect);
-      if (error)
-         throw r::exec::RErrorException(error.getSummary());
+      boost::shared_ptr<FrameTransform>& pTransform = s_frameTransforms[cacheKey];
+      if (!pTransform || !pTransform->isFor(dataSEXP, nrow))
+         pTransform.reset(new FrameTransform(dataSEXP, nrow));
 
-      // check to see if we've accidentally transformed ourselves into nothing
-      // (this shouldn't generally happen without a specific error)
-      if (dataSEXP == R_NilValue)
-      {
-         throw r::exec::RErrorException("Failure to sort or filter data");
-      }
+      pRows = &pTransform->rows(filters, search, ordercols, orderdirs);
+      filteredNRow = gsl::narrow_cast<int>(pRows->size());
+   }
+   else
+   {
+      // the view is untransformed; no need to keep a transform for it
+      s_frameTransforms.erase(cacheKey);
+      filteredNRow = nrow;
+   }
 
-      // save the working data state (it's okay if this fails; it's a
-      // performance optimization)
-      r::exec::RFunction(".rs.assignWorkingData", cacheKey, dataSEXP).call();
-      if (cachedFrame != s_cachedFrames.end())
-      {
-         cachedFrame->second.workingSearch = search;
-         cachedFrame->second.workingFilters = filters;
-         cachedFrame->second.workingOrderDirs = orderdirs;
-         cachedFrame->second.workingOrderCols = ordercols;
-      }
+   // return the lesser of the rows available and rows requested
+   length = std::max(0, std::min(length, filteredNRow - start));
+
+   std::vector<int> pageRows(length);
+   std::vector<int> positions(length);
+   for (int row = 0; row < length; row++)
+   {
+      pageRows[row] = pRows ? (*pRows)[start + row] : start + row;
+      positions[row] = row;
    }
 
-   // apply new row count if we've transformed the data (or need to)
-   filteredNRow = needsTransform || hasTransform
-      ? safeDim(dataSEXP, DIM_ROWS)
-      : nrow;
+   // the (1-based) row numbers of the page, for formatting in R
+   SEXP rowsSEXP = Rf_allocVector(INTSXP, length);
+   protect.add(rowsSEXP);
+   for (int row = 0; row < length; row++)
+      INTEGER(rowsSEXP)[row] = pageRows[row] + 1;
 
-   // return the lesser of the rows available and rows requested
-   length = std::min(length, filteredNRow - start);
+   PageWriter writer(length, nrow, filteredNRow);
 
-   // DataTables uses 0-based indexing, but R uses 1-based indexing
-   start++;
+   // format the row names
+   writer.beginColumn();
+   if (!writeRowNames(dataSEXP, pageRows, &writer))
+   {
+      SEXP rownamesSEXP = R_NilValue;
+      r::exec::RFunction(".rs.formatRowNamesAt", dataSEXP, rowsSEXP)
+         .call(&rownamesSEXP, &protect);
 
-   // extract the portion of the column vector requested by the client
-   int numFormattedColumns = ncol - columnOffset < maxColumns ? ncol - columnOffset : maxColumns;
-   SEXP formattedDataSEXP = Rf_allocVector(VECSXP, numFormattedColumns);
-   protect.add(formattedDataSEXP);
+      int n = TYPEOF(rownamesSEXP) == STRSXP ? r::sexp::length(rownamesSEXP) : 0;
+      auto vmax = vmaxget();
+      for (int row = 0; row < length; row++)
+      {
+         SEXP nameSEXP = row < n ? STRING_ELT(rownamesSEXP, row) : R_BlankString;
+         if (nameSEXP == NA_STRING)
+            writer.writeMissing();
+         else if (r::sexp::length(nameSEXP) == 0)
+            writer.writeNumber(pageRows[row] + 1);
+         else
+            writer.writeString(Rf_translateCharUTF8(nameSEXP));
+      }
+      vmaxset(vmax);
+   }
+   writer.endColumn();
 
+   // format the portion of each column requested by the client; common types
+   // are formatted here, and anything else by R
    int initialIndex = 0 + columnOffset;
    for (int i = initialIndex; i < initialIndex + numFormattedColumns; i++)
    {
@@ -674,116 +822,49 @@ json::Value getData(SEXP dataSEXP, const http::Fields& fields)
          throw r::exec::RErrorException(
                   string_utils::sprintf("No data in column %i", i));
       }
-      
-      SEXP formattedColumnSEXP = R_NilValue;
-      r::exec::RFunction formatFx(".rs.formatDataColumn");
-      formatFx.addParam(columnSEXP);
-      formatFx.addParam(gsl::narrow_cast<int>(start));
-      formatFx.addParam(gsl::narrow_cast<int>(length));
-      error = formatFx.call(&formattedColumnSEXP, &protect);
-      if (error)
-         throw r::exec::RErrorException(error.getSummary());
-      
-      SET_VECTOR_ELT(formattedDataSEXP, i - initialIndex, formattedColumnSEXP);
-   }
 
-   // format the row names
-   SEXP rownamesSEXP = R_NilValue;
-   r::exec::RFunction(".rs.formatRowNames", dataSEXP, start, length)
-      .call(&rownamesSEXP, &protect);
-   
-   // create the result grid as JSON
-   
-   json::Array data;
-   for (int row = 0; row < length; row++)
-   {
-      // first, handle row names
-      json::Array rowData;
-      if (rownamesSEXP != nullptr && TYPEOF(rownamesSEXP) == STRSXP)
-      {
-         SEXP nameSEXP = STRING_ELT(rownamesSEXP, row);
-         if (nameSEXP == nullptr)
-         {
-            rowData.push_back(row + start);
-         }
-         else if (nameSEXP == NA_STRING)
-         {
-            rowData.push_back(SPECIAL_CELL_NA);
-         }
-         else if (r::sexp::length(nameSEXP) == 0)
-         {
-            rowData.push_back(row + start);
-         }
-         else
-         {
-            rowData.push_back(Rf_translateCharUTF8(nameSEXP));
-         }
-      }
-      else
+      // NOTE: it is possible for malformed data.frames to have columns with
+      // differing number of elements; this is rare in practice but needs
+      // to be handled to avoid crashes (rows past the end of a column are
+      // written as NAs, as R's default print method does)
+      // https://github.com/rstudio/rstudio/issues/9364
+      writer.beginColumn();
+      if (!writeColumn(columnSEXP, pageRows, digits, scipen, &writer))
       {
-         rowData.push_back(row + start);
-      }
+         SEXP formattedColumnSEXP = R_NilValue;
+         r::exec::RFunction formatFx(".rs.formatDataColumnRows");
+         formatFx.addParam(columnSEXP);
+         formatFx.addParam(rowsSEXP);
+         error = formatFx.call(&formattedColumnSEXP, &protect);
+         if (error)
+            throw r::exec::RErrorException(error.getSummary());
 
-      // now, handle remaining columns in formatted data
-      for (int col = 0, ncol = r::sexp::length(formattedDataSEXP); col < ncol; col++)
-      {
-         // NOTE: it is possible for malformed data.frames to have columns with
-         // differing number of elements; this is rare in practice but needs
-         // to be handled to avoid crashes
-         // https://github.com/rstudio/rstudio/issues/9364
-         SEXP columnSEXP = VECTOR_ELT(formattedDataSEXP, col);
-         if (row >= r::sexp::length(columnSEXP))
-         {
-            // because R's default print method pads with NAs in this case,
-            // we replicate that with our own padded NAs
-            rowData.push_back(SPECIAL_CELL_NA);
-            continue;
-         }
-         
          // validate that we have a character vector
-         if (columnSEXP == nullptr || TYPEOF(columnSEXP) != STRSXP)
+         if (TYPEOF(formattedColumnSEXP) == STRSXP)
          {
-            rowData.push_back("");
-            continue;
-         }
-         
-         // we have a valid character vector; access the string element
-         // and push back data as appropriate
-         SEXP stringSEXP = STRING_ELT(columnSEXP, row);
-         if (stringSEXP == nullptr)
-         {
-            rowData.push_back("");
-         }
-         else if (stringSEXP == NA_STRING)
-         {
-            rowData.push_back(SPECIAL_CELL_NA);
-         }
-         else if (r::sexp::length(stringSEXP) == 0)
-         {
-            rowData.push_back("");
+            writeStrings(formattedColumnSEXP, positions, &writer);
          }
          else
          {
-            rowData.push_back(Rf_translateCharUTF8(stringSEXP));
+            for (int row = 0; row < length; row++)
+               writer.writeString("");
          }
       }
-      
-      // all done, add row data
-      data.push_back(rowData);
+      writer.endColumn();
    }
 
-   json::Object result;
-   result["draw"] = draw;
-   result["recordsTotal"] = nrow;
-   result["recordsFiltered"] = filteredNRow;
-   result["data"] = data;
-   return std::move(result);
+   std::string page = writer.finish();
+   if (!pageKey.empty())
+      s_pageCache.insert(cacheKey, pageKey, page);
+
+   return pageResponse(draw, page);
 }
 
 Error getGridData(const http::Request& request,
                   http::Response* pResponse)
 {
    json::Value result;
+   std::string output;
    http::status::Code status = http::status::Ok;
 
    try
@@ -845,11 +926,16 @@ Error getGridData(const http::Request& request,
          }
          if (show == "cols")
          {
+            // the viewer is being (re)loaded, e.g. when refreshed, so give it
+            // freshly formatted pages
+            s_frameTransforms.erase(cacheKey);
+            s_pageCache.remove(cacheKey);
             result = getCols(dataSEXP);
          }
          else if (show == "data")
          {
-            result = getData(dataSEXP, fields);
+            // written directly as JSON (see getData)
+            output = getData(dataSEXP, fields);
          }
       }
    }
@@ -872,14 +958,17 @@ Error getGridData(const http::Request& request,
    // unprintable and (b) some characters are invalid *even if escaped* e.g.
    // \v, there's little to be gained here in trying to marshal them to the
    // viewer.
-   std::string output = result.write();
-   for (size_t i = 0; i < output.size(); i++)
+   if (output.empty())
    {
-      char c = output[i];
-      // These ranges for control character values come from empirical testing
-      if ((c >= 1 && c <= 7) || c == 11 || (c >= 14 && c <= 31))
+      output = result.write();
+      for (size_t i = 0; i < output.size(); i++)
       {
-         output[i] = ' ';
+         char c = output[i];
+         // These ranges for control character values come from empirical testing
+         if ((c >= 1 && c <= 7) || c == 11 || (c >= 14 && c <= 31))
+         {
+            output[i] = ' ';
+         }
       }
    }
 
@@ -904,6 +993,11 @@ Error removeRCachedData(const std::string& cacheKey)
 {
    if (core::thread::isMainThread())
    {
+      // release the sorted/filtered view (it holds a reference to the data)
+      // and any pages of it
+      s_frameTransforms.erase(cacheKey);
+      s_pageCache.remove(cacheKey);
+
       // remove cache env object and backing file
       return r::exec::RFunction(".rs.removeCachedData", cacheKey,
             viewerCacheDir()).call();
@@ -976,12 +1070,15 @@ void onDetectChanges(module_context::ChangeSource source)
         i != s_cachedFrames.end();
         i++) 
    {
+      // discard the sorted/filtered view of the object and the pages sent
+      // from it; even when the object is the same it may have been modified
+      // in place (e.g. with data.table's `:=`), which leaves its address as is
+      s_frameTransforms.erase(i->first);
+      s_pageCache.remove(i->first);
+
       SEXP sexp = findInNamedEnvir(i->second.envName, i->second.objName);
       if (sexp != i->second.observedSEXP) 
       {
-         // clear working data for the object
-         r::exec::RFunction(".rs.removeWorkingData", i->first).call();
-   
          if (Rf_inherits(sexp, "data.frame"))
          {
             // create a new frame object to capture the new state of the frame
@@ -0,0 +1,348 @@
+/*
+ * DataViewerIndex.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "DataViewerIndex.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#include <boost/regex.hpp>
+
+#include <core/BoostThread.hpp>
+#include <core/RegexUtils.hpp>
+#include <shared_core/SafeConvert.hpp>
+
+// separates filter type from contents (e.g. "numeric|12-25")
+#define kFilterSeparator "|"
+
+// the smallest number of rows for which sorting is split across threads
+#define kParallelSortRows (1 << 20)
+
+// the largest number of threads used for a sort
+#define kMaxSortThreads 8
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace data {
+namespace viewer {
+
+namespace {
+
+template <typename Less>
+std::vector<int> stableOrder(std::size_t n, Less less)
+{
+   std::vector<int> order(n);
+   std::iota(order.begin(), order.end(), 0);
+
+   std::size_t threads = std::min<std::size_t>(boost::thread::hardware_concurrency(), kMaxSortThreads);
+   if (n < kParallelSortRows || threads < 2)
+   {
+      std::stable_sort(order.begin(), order.end(), less);
+      return order;
+   }
+
+   // sort equal chunks of the rows in parallel ...
+   std::vector<std::size_t> bounds;
+   for (std::size_t i = 0; i <= threads; i++)
+      bounds.push_back(n * i / threads);
+
+   boost::thread_group sorters;
+   for (std::size_t i = 0; i < threads; i++)
+   {
+      auto begin = order.begin() + bounds[i];
+      auto end = order.begin() + bounds[i + 1];
+      sorters.create_thread([=]() { std::stable_sort(begin, end, less); });
+   }
+   sorters.join_all();
+
+   // ... then merge neighboring chunks (again in parallel) until only one
+   // remains; std::merge keeps equal rows of the left chunk first, so the
+   // result is stable
+   std::vector<int> merged(n);
+   while (bounds.size() > 2)
+   {
+      std::vector<std::size_t> mergedBounds;
+      mergedBounds.push_back(0);
+
+      boost::thread_group mergers;
+      std::size_t chunks = bounds.size() - 1;
+      for (std::size_t i = 0; i < chunks; i += 2)
+      {
+         auto begin = order.begin() + bounds[i];
+         auto middle = order.begin() + bounds[i + 1];
+         auto output = merged.begin() + bounds[i];
+         if (i + 1 < chunks)
+         {
+            auto end = order.begin() + bounds[i + 2];
+            mergers.create_thread([=]() { std::merge(begin, middle, middle, end, output, less); });
+            mergedBounds.push_back(bounds[i + 2]);
+         }
+         else
+         {
+            std::copy(begin, middle, output);
+            mergedBounds.push_back(bounds[i + 1]);
+         }
+      }
+      mergers.join_all();
+
+      order.swap(merged);
+      bounds = mergedBounds;
+   }
+
+   return order;
+}
+
+template <typename T, typename IsNA>
+std::vector<int> orderKeys(const std::vector<T>& keys, bool descending, IsNA isNA)
+{
+   const T* pKeys = keys.data();
+   if (descending)
+   {
+      return stableOrder(keys.size(), [=](int lhs, int rhs)
+      {
+         bool lhsNA = isNA(pKeys[lhs]), rhsNA = isNA(pKeys[rhs]);
+         if (lhsNA || rhsNA)
+            return !lhsNA && rhsNA;
+         return pKeys[lhs] > pKeys[rhs];
+      });
+   }
+   else
+   {
+      return stableOrder(keys.size(), [=](int lhs, int rhs)
+      {
+         bool lhsNA = isNA(pKeys[lhs]), rhsNA = isNA(pKeys[rhs]);
+         if (lhsNA || rhsNA)
+            return !lhsNA && rhsNA;
+         return pKeys[lhs] < pKeys[rhs];
+      });
+   }
+}
+
+// calls f on each row which is a candidate for matching a filter
+template <typename F>
+void forEachRow(int count, const RowSet* pWithin, F f)
+{
+   if (pWithin == nullptr)
+   {
+      for (int row = 0; row < count; row++)
+         f(row);
+      return;
+   }
+
+   for (std::size_t row = pWithin->find_first();
+        row != RowSet::npos && row < static_cast<std::size_t>(count);
+        row = pWithin->find_next(row))
+   {
+      f(static_cast<int>(row));
+   }
+}
+
+// case insensitive (for ASCII characters) version of strstr
+bool containsIgnoreCase(const char* haystack, const std::string& needle)
+{
+   if (needle.empty())
+      return true;
+
+   std::size_t needleLength = needle.size();
+   for (const char* p = haystack; *p; p++)
+   {
+      std::size_t i = 0;
+      while (i < needleLength && p[i] &&
+             std::tolower(static_cast<unsigned char>(p[i])) ==
+             std::tolower(static_cast<unsigned char>(needle[i])))
+      {
+         i++;
+      }
+
+      if (i == needleLength)
+         return true;
+   }
+
+   return false;
+}
+
+} // anonymous namespace
+
+bool isFilterSubset(const std::string& outer, const std::string& inner) 
+{
+   // shortcut for identical filters (the typical case)
+   if (inner == outer) 
+      return true;
+
+   // find filter separators; if we can't find them, presume no subset since we
+   // can't parse filters
+   size_t outerPipe = outer.find(kFilterSeparator);
+   if (outerPipe == std::string::npos) 
+      return false;
+   size_t innerPipe = inner.find(kFilterSeparator);
+   if (innerPipe == std::string::npos)
+      return false;
+
+   std::string outerType(outer.substr(0, outerPipe));
+   std::string innerType(inner.substr(0, innerPipe));
+   std::string outerValue(outer.substr(outerPipe + 1, 
+            outer.length() - outerPipe));
+   std::string innerValue(inner.substr(innerPipe + 1, 
+            inner.length() - innerPipe));
+   
+   // only identical types can be subsets
+   if (outerType != innerType) 
+      return false;
+
+   if (outerType == "numeric")
+   {
+      // matches a numeric filter (i.e. "2.71_3.14") -- in this case we need to
+      // check the components for range inclusion
+      boost::regex numFilter("(-?\\d+\\.?\\d*)_(-?\\d+\\.?\\d*)");
+      boost::smatch innerMatch, outerMatch;
+      if (regex_utils::search(innerValue, innerMatch, numFilter) &&
+          regex_utils::search(outerValue, outerMatch, numFilter))
+      {
+         // for numeric filters, the inner is a subset if its lower bound (1)
+         // is larger than the outer lower bound, and the upper bound (2) is
+         // smaller than the outer upper bound
+         return safe_convert::stringTo<double>(innerMatch[1], 0) >= 
+                safe_convert::stringTo<double>(outerMatch[1], 0) &&
+                safe_convert::stringTo<double>(innerMatch[2], 0) <= 
+                safe_convert::stringTo<double>(outerMatch[2], 0);
+      }
+
+      // if not identical and not a range, then not a subset
+      return false;
+   } 
+   else if (outerType == "factor" || outerType == "boolean")
+   {
+      // factors and boolean values have to be identical for subsetting, and we
+      // already checked above
+      return false;
+   }
+   else if (outerType == "character")
+   {
+      // characters are a subset if the outer string is within the inner one
+      // (i.e. a search for "walnuts" (inner) is within "walnut" (outer))
+      return inner.find(outer) != std::string::npos;
+   }
+   
+   // unknown filter type
+   return false;
+}
+
+std::vector<int> orderRows(const std::vector<int>& keys, bool descending)
+{
+   return orderKeys(keys, descending, [](int key) { return key == kNaInteger; });
+}
+
+std::vector<int> orderRows(const std::vector<double>& keys, bool descending)
+{
+   return orderKeys(keys, descending, [](double key) { return std::isnan(key); });
+}
+
+RowSet filterRange(const int* pValues, int count, int nrow,
+                   double min, double max, const RowSet* pWithin)
+{
+   RowSet matches(nrow);
+   forEachRow(std::min(count, nrow), pWithin, [&](int row)
+   {
+      int value = pValues[row];
+      if (value != kNaInteger && value >= min && value <= max)
+         matches.set(row);
+   });
+   return matches;
+}
+
+RowSet filterRange(const double* pValues, int count, int nrow,
+                   double min, double max, const RowSet* pWithin)
+{
+   RowSet matches(nrow);
+   forEachRow(std::min(count, nrow), pWithin, [&](int row)
+   {
+      double value = pValues[row];
+      if (std::isfinite(value) && value >= min && value <= max)
+         matches.set(row);
+   });
+   return matches;
+}
+
+RowSet filterContains(const std::vector<const char*>& values, int nrow,
+                      const std::string& needle, const RowSet* pWithin)
+{
+   RowSet matches(nrow);
+   int count = static_cast<int>(values.size());
+   forEachRow(std::min(count, nrow), pWithin, [&](int row)
+   {
+      const char* value = values[row];
+      if (value != nullptr && containsIgnoreCase(value, needle))
+         matches.set(row);
+   });
+   return matches;
+}
+
+RowSet filterCodes(const int* pCodes, int count, int nrow,
+                   const RowSet& levels, const RowSet* pWithin)
+{
+   RowSet matches(nrow);
+   int levelCount = static_cast<int>(levels.size());
+   forEachRow(std::min(count, nrow), pWithin, [&](int row)
+   {
+      int code = pCodes[row];
+      if (code >= 1 && code <= levelCount && levels.test(code - 1))
+         matches.set(row);
+   });
+   return matches;
+}
+
+std::vector<int> selectRows(int nrow,
+                            const std::vector<int>* pOrder,
+                            const RowSet* pRows)
+{
+   std::vector<int> rows;
+   if (pOrder != nullptr)
+   {
+      if (pRows == nullptr)
+         return *pOrder;
+
+      rows.reserve(pRows->count());
+      for (int row : *pOrder)
+      {
+         if (pRows->test(row))
+            rows.push_back(row);
+      }
+   }
+   else if (pRows != nullptr)
+   {
+      rows.reserve(pRows->count());
+      for (std::size_t row = pRows->find_first(); row != RowSet::npos; row = pRows->find_next(row))
+         rows.push_back(static_cast<int>(row));
+   }
+   else
+   {
+      rows.resize(nrow);
+      std::iota(rows.begin(), rows.end(), 0);
+   }
+
+   return rows;
+}
+
+} // namespace viewer
+} // namespace data
+} // namespace modules
+} // namespace session
+} // namespace rstudio
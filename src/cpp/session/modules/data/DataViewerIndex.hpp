@@ -0,0 +1,86 @@
+/*
+ * DataViewerIndex.hpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_DATA_VIEWER_INDEX_HPP
+#define SESSION_DATA_VIEWER_INDEX_HPP
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <boost/dynamic_bitset.hpp>
+
+// Sorting and filtering primitives for the data viewer. These work on plain
+// arrays of column values (copied or borrowed from R vectors by the caller)
+// and describe their results as row numbers of the untransformed data, so
+// that a sorted and filtered view never requires a copy of the data itself.
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace data {
+namespace viewer {
+
+// the value R uses for a missing integer (NA_INTEGER)
+constexpr int kNaInteger = std::numeric_limits<int>::min();
+
+// a set of rows (0-based) of the untransformed data
+typedef boost::dynamic_bitset<> RowSet;
+
+// indicates whether one filter string is a subset of another; e.g. if a column
+// is filtered for "abc" and then "abcd", the new state is a subset of the
+// previous state.
+bool isFilterSubset(const std::string& outer, const std::string& inner);
+
+// returns the rows of the given keys in the order R's order() would put them:
+// the sort is stable, and missing values (NA, or NaN for doubles) are always
+// placed last. large inputs are sorted in parallel.
+std::vector<int> orderRows(const std::vector<int>& keys, bool descending);
+std::vector<int> orderRows(const std::vector<double>& keys, bool descending);
+
+// the filters below return the rows whose values match. when pWithin is
+// supplied (the rows matching a broader filter on the same column) only
+// those rows are examined. missing values never match. rows beyond the end
+// of the values (for malformed frames) don't match either.
+
+// rows whose value is finite and in the range [min, max]
+RowSet filterRange(const int* pValues, int count, int nrow,
+                   double min, double max, const RowSet* pWithin = nullptr);
+RowSet filterRange(const double* pValues, int count, int nrow,
+                   double min, double max, const RowSet* pWithin = nullptr);
+
+// rows whose string contains the needle, ignoring (ASCII) case; strings are
+// UTF-8, with NA given as nullptr
+RowSet filterContains(const std::vector<const char*>& values, int nrow,
+                      const std::string& needle, const RowSet* pWithin = nullptr);
+
+// rows whose factor code (1-based) is one of the given levels (0-based)
+RowSet filterCodes(const int* pCodes, int count, int nrow,
+                   const RowSet& levels, const RowSet* pWithin = nullptr);
+
+// returns the rows to display: the rows in the given order (or in their
+// original order, when pOrder is null), restricted to the rows in pRows (or
+// all rows, when pRows is null)
+std::vector<int> selectRows(int nrow,
+                            const std::vector<int>* pOrder,
+                            const RowSet* pRows);
+
+} // namespace viewer
+} // namespace data
+} // namespace modules
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_DATA_VIEWER_INDEX_HPP
@@ -0,0 +1,140 @@
+/*
+ * DataViewerIndexTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "DataViewerIndex.hpp"
+
+#include <cmath>
+#include <random>
+
+#define RSTUDIO_NO_TESTTHAT_ALIASES
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace data {
+namespace viewer {
+namespace tests {
+
+namespace {
+
+const double kNaReal = std::nan("");
+
+RowSet rowSet(int nrow, const std::vector<int>& rows)
+{
+   RowSet set(nrow);
+   for (int row : rows)
+      set.set(row);
+   return set;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Data viewer index")
+{
+   SECTION("Orders are stable with missing values last")
+   {
+      std::vector<int> keys = { 3, kNaInteger, 1, 3, 2, kNaInteger, 1 };
+      REQUIRE(orderRows(keys, false) == std::vector<int>({ 2, 6, 4, 0, 3, 1, 5 }));
+      REQUIRE(orderRows(keys, true) == std::vector<int>({ 0, 3, 4, 2, 6, 1, 5 }));
+
+      std::vector<double> reals = { 2.5, kNaReal, -1, 2.5 };
+      REQUIRE(orderRows(reals, false) == std::vector<int>({ 2, 0, 3, 1 }));
+      REQUIRE(orderRows(reals, true) == std::vector<int>({ 0, 3, 2, 1 }));
+   }
+
+   SECTION("Large orders match a serial stable sort")
+   {
+      // enough rows to be sorted in parallel, with many ties
+      std::mt19937 generator(42);
+      std::uniform_int_distribution<int> distribution(0, 1000);
+      std::vector<int> keys(3 << 19);
+      for (int& key : keys)
+         key = distribution(generator) == 0 ? kNaInteger : distribution(generator);
+
+      for (bool descending : { false, true })
+      {
+         std::vector<int> expected(keys.size());
+         for (std::size_t i = 0; i < expected.size(); i++)
+            expected[i] = static_cast<int>(i);
+         std::stable_sort(expected.begin(), expected.end(), [&](int lhs, int rhs)
+         {
+            if (keys[lhs] == kNaInteger || keys[rhs] == kNaInteger)
+               return keys[lhs] != kNaInteger && keys[rhs] == kNaInteger;
+            return descending ? keys[lhs] > keys[rhs] : keys[lhs] < keys[rhs];
+         });
+
+         REQUIRE(orderRows(keys, descending) == expected);
+      }
+   }
+
+   SECTION("Range filters skip missing values")
+   {
+      std::vector<int> ints = { 1, 5, kNaInteger, 10, 7 };
+      REQUIRE(filterRange(ints.data(), 5, 5, 5, 10) == rowSet(5, { 1, 3, 4 }));
+
+      std::vector<double> reals = { 1.5, kNaReal, INFINITY, 2 };
+      REQUIRE(filterRange(reals.data(), 4, 4, 1, INFINITY) == rowSet(4, { 0, 3 }));
+   }
+
+   SECTION("Filters only examine rows within a previous result")
+   {
+      std::vector<int> ints = { 1, 2, 3, 4, 5 };
+      RowSet within = rowSet(5, { 0, 1, 4 });
+      REQUIRE(filterRange(ints.data(), 5, 5, 2, 5, &within) == rowSet(5, { 1, 4 }));
+   }
+
+   SECTION("Text filters ignore case")
+   {
+      std::vector<const char*> strings = { "Walnut", nullptr, "walnuts", "pecan" };
+      REQUIRE(filterContains(strings, 4, "WALNUT") == rowSet(4, { 0, 2 }));
+      REQUIRE(filterContains(strings, 4, "") == rowSet(4, { 0, 2, 3 }));
+
+      RowSet within = rowSet(4, { 2, 3 });
+      REQUIRE(filterContains(strings, 4, "nut", &within) == rowSet(4, { 2 }));
+   }
+
+   SECTION("Factor filters match codes")
+   {
+      std::vector<int> codes = { 1, 2, kNaInteger, 3, 2 };
+      REQUIRE(filterCodes(codes.data(), 5, 5, rowSet(3, { 1 })) == rowSet(5, { 1, 4 }));
+   }
+
+   SECTION("Selected rows follow the order")
+   {
+      std::vector<int> order = { 3, 0, 2, 1 };
+      RowSet rows = rowSet(4, { 0, 1, 3 });
+      REQUIRE(selectRows(4, &order, &rows) == std::vector<int>({ 3, 0, 1 }));
+      REQUIRE(selectRows(4, &order, nullptr) == order);
+      REQUIRE(selectRows(4, nullptr, &rows) == std::vector<int>({ 0, 1, 3 }));
+      REQUIRE(selectRows(2, nullptr, nullptr) == std::vector<int>({ 0, 1 }));
+   }
+
+   SECTION("Narrowed filters are subsets")
+   {
+      REQUIRE(isFilterSubset("character|walnut", "character|walnuts"));
+      REQUIRE_FALSE(isFilterSubset("character|walnuts", "character|walnut"));
+      REQUIRE(isFilterSubset("numeric|1_10", "numeric|2_5"));
+      REQUIRE_FALSE(isFilterSubset("numeric|1_10", "numeric|0_5"));
+      REQUIRE_FALSE(isFilterSubset("factor|1", "factor|2"));
+   }
+}
+
+} // namespace tests
+} // namespace viewer
+} // namespace data
+} // namespace modules
+} // namespace session
+} // namespace rstudio
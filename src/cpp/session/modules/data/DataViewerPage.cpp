@@ -0,0 +1,398 @@
+/*
+ * DataViewerPage.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "DataViewerPage.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+
+// the largest power of ten in the table below
+#define kMaxPower 22
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace data {
+namespace viewer {
+
+namespace {
+
+const long double kPowersOfTen[kMaxPower + 1] = {
+   1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L, 1e6L, 1e7L, 1e8L, 1e9L, 1e10L, 1e11L,
+   1e12L, 1e13L, 1e14L, 1e15L, 1e16L, 1e17L, 1e18L, 1e19L, 1e20L, 1e21L, 1e22L
+};
+
+// the decomposition R's format() uses for each value (see scientific() in
+// R's format.c): |value| rounded to 'digits' significant digits is
+// alpha * 10^power, where 1 <= alpha < 10 has 'significant' digits
+struct Decomposition
+{
+   bool negative;
+   int power;
+   int significant;
+   bool roundingWidens;
+};
+
+Decomposition decompose(double value, int digits)
+{
+   Decomposition result;
+   if (value == 0)
+   {
+      result.negative = false;
+      result.power = 0;
+      result.significant = 1;
+      result.roundingWidens = false;
+      return result;
+   }
+
+   result.negative = value < 0;
+   double magnitude = std::fabs(value);
+
+   // scale to an integer of 'digits' digits, using exact powers of ten
+   // where possible
+   int power = static_cast<int>(std::floor(std::log10(magnitude))) - digits + 1;
+   long double scaled = magnitude;
+   if (std::abs(power) < 10)
+   {
+      if (power > 0)
+         scaled /= kPowersOfTen[power];
+      else if (power < 0)
+         scaled *= kPowersOfTen[-power];
+   }
+   else if (power < -300)
+   {
+      scaled = (magnitude * 1e+303) / std::pow(10.0L, power + 303);
+   }
+   else
+   {
+      scaled /= std::pow(10.0L, static_cast<long double>(power));
+   }
+
+   if (scaled < kPowersOfTen[digits - 1])
+   {
+      scaled *= 10.0;
+      power--;
+   }
+
+   // drop the trailing zeros of the rounded digits
+   double alpha = static_cast<double>(std::nearbyint(scaled));
+   int significant = digits;
+   for (int i = 1; i <= digits; i++)
+   {
+      alpha /= 10.0;
+      if (alpha != std::floor(alpha))
+         break;
+      significant--;
+   }
+
+   if (significant == 0)
+   {
+      significant = 1;
+      power++;
+   }
+
+   result.power = power + digits - 1;
+   result.significant = significant;
+
+   // rounding may carry into a new leading digit (e.g. 99.99 with 3 digits
+   // is 1e+02), which fixed notation doesn't do
+   int right = std::max(0, std::min(digits - result.power, kMaxPower));
+   double fuzz = 0.5 / static_cast<double>(kPowersOfTen[right]);
+   result.roundingWidens = result.power > 0 && result.power <= kMaxPower &&
+      magnitude < kPowersOfTen[result.power] - fuzz;
+
+   return result;
+}
+
+std::string printNumber(const char* format, int decimals, double value)
+{
+   char buffer[128];
+   int n = std::snprintf(buffer, sizeof(buffer), format, decimals, value);
+   if (n < 0)
+      return std::string();
+   if (n < static_cast<int>(sizeof(buffer)))
+      return std::string(buffer, n);
+
+   // very large or small values in fixed notation (when scipen is high)
+   std::vector<char> large(n + 1);
+   std::snprintf(large.data(), large.size(), format, decimals, value);
+   return std::string(large.data(), n);
+}
+
+void appendJsonString(const char* value, std::string* pOutput)
+{
+   pOutput->push_back('"');
+   for (const char* p = value; *p; p++)
+   {
+      char ch = *p;
+      switch (ch)
+      {
+         case '"':
+            pOutput->append("\\\"");
+            break;
+         case '\\':
+            pOutput->append("\\\\");
+            break;
+         case '\b':
+            pOutput->append("\\b");
+            break;
+         case '\t':
+            pOutput->append("\\t");
+            break;
+         case '\n':
+            pOutput->append("\\n");
+            break;
+         case '\f':
+            pOutput->append("\\f");
+            break;
+         case '\r':
+            pOutput->append("\\r");
+            break;
+         default:
+            // other control characters won't parse in most Javascript JSON
+            // implementations, even when escaped; they're unprintable anyway
+            if (ch > 0 && ch < 0x20)
+               pOutput->push_back(' ');
+            else
+               pOutput->push_back(ch);
+      }
+   }
+   pOutput->push_back('"');
+}
+
+} // anonymous namespace
+
+NumberFormat numberFormat(const std::vector<double>& values, int digits, int scipen)
+{
+   NumberFormat format;
+   if (values.empty())
+      return format;
+
+   digits = std::max(1, std::min(digits, 15));
+
+   // find the widths needed for fixed notation (see formatReal() in R's
+   // format.c)
+   bool negative = false;
+   int maxLeft = INT_MIN, minLeft = INT_MAX, maxSignedLeft = INT_MIN;
+   int maxRight = INT_MIN, maxSignificant = INT_MIN;
+   for (double value : values)
+   {
+      Decomposition decomposition = decompose(value, digits);
+      int left = decomposition.power + 1;
+      if (decomposition.roundingWidens)
+         left--;
+      int signedLeft = decomposition.negative + (left <= 0 ? 1 : left);
+      int right = decomposition.significant - left;
+
+      negative = negative || decomposition.negative;
+      maxRight = std::max(maxRight, right);
+      maxLeft = std::max(maxLeft, left);
+      minLeft = std::min(minLeft, left);
+      maxSignedLeft = std::max(maxSignedLeft, signedLeft);
+      maxSignificant = std::max(maxSignificant, decomposition.significant);
+   }
+
+   if (maxLeft < 0)
+      maxSignedLeft = 1 + negative;
+   int right = std::max(maxRight, 0);
+   int fixedWidth = maxSignedLeft + right + (right != 0);
+
+   // ... and compare them to the width needed for scientific notation
+   int exponentWidth = (maxLeft > 100 || minLeft <= -99) ? 2 : 1;
+   int scientificDecimals = maxSignificant - 1;
+   int scientificWidth = negative + (scientificDecimals > 0) + scientificDecimals + 4 + exponentWidth;
+
+   if (fixedWidth <= scientificWidth + scipen)
+   {
+      format.scientific = false;
+      format.decimals = right;
+   }
+   else
+   {
+      format.scientific = true;
+      format.decimals = scientificDecimals;
+   }
+
+   return format;
+}
+
+std::string formatNumber(double value, const NumberFormat& format)
+{
+   if (format.scientific)
+      return printNumber(format.decimals > 0 ? "%#.*e" : "%.*e", format.decimals, value);
+   return printNumber("%.*f", format.decimals, value);
+}
+
+PageWriter::PageWriter(int rows, int recordsTotal, int recordsFiltered)
+   : rows_(rows),
+     row_(0),
+     missingBits_((rows + 31) / 32),
+     hasMissing_(false)
+{
+   page_.append("\"recordsTotal\":");
+   page_.append(std::to_string(recordsTotal));
+   page_.append(",\"recordsFiltered\":");
+   page_.append(std::to_string(recordsFiltered));
+   page_.append(",\"columns\":[");
+   missing_.append("[");
+}
+
+void PageWriter::beginColumn()
+{
+   if (page_.back() == ']')
+   {
+      page_.push_back(',');
+      missing_.push_back(',');
+   }
+
+   page_.push_back('[');
+   row_ = 0;
+   std::fill(missingBits_.begin(), missingBits_.end(), 0);
+   hasMissing_ = false;
+}
+
+void PageWriter::endColumn()
+{
+   // a column short of the page is padded with missing values (as R does
+   // when printing malformed data frames)
+   while (row_ < rows_)
+      writeMissing();
+
+   page_.push_back(']');
+
+   missing_.push_back('[');
+   if (hasMissing_)
+   {
+      for (std::size_t i = 0; i < missingBits_.size(); i++)
+      {
+         if (i > 0)
+            missing_.push_back(',');
+         missing_.append(std::to_string(missingBits_[i]));
+      }
+   }
+   missing_.push_back(']');
+}
+
+void PageWriter::writeString(const char* value)
+{
+   if (row_ > 0)
+      page_.push_back(',');
+   appendJsonString(value, &page_);
+   row_++;
+}
+
+void PageWriter::writeString(const std::string& value)
+{
+   writeString(value.c_str());
+}
+
+void PageWriter::writeNumber(int value)
+{
+   if (row_ > 0)
+      page_.push_back(',');
+   page_.append(std::to_string(value));
+   row_++;
+}
+
+void PageWriter::writeMissing()
+{
+   if (row_ > 0)
+      page_.push_back(',');
+   page_.append("null");
+   missingBits_[row_ / 32] |= 1u << (row_ % 32);
+   hasMissing_ = true;
+   row_++;
+}
+
+std::string PageWriter::finish()
+{
+   page_.append("],\"na\":");
+   page_.append(missing_);
+   page_.append("]}");
+   return std::move(page_);
+}
+
+std::string pageResponse(int draw, const std::string& page)
+{
+   std::string response;
+   response.reserve(page.size() + 24);
+   response.append("{\"draw\":");
+   response.append(std::to_string(draw));
+   response.push_back(',');
+   response.append(page);
+   return response;
+}
+
+PageCache::PageCache(std::size_t maxPages, std::size_t maxBytes)
+   : maxPages_(maxPages),
+     maxBytes_(maxBytes),
+     bytes_(0)
+{
+}
+
+bool PageCache::find(const std::string& key, std::string* pPage)
+{
+   auto it = index_.find(key);
+   if (it == index_.end())
+      return false;
+
+   pages_.splice(pages_.begin(), pages_, it->second);
+   *pPage = it->second->page;
+   return true;
+}
+
+void PageCache::insert(const std::string& cacheKey, const std::string& key, const std::string& page)
+{
+   auto existing = index_.find(key);
+   if (existing != index_.end())
+      erase(existing->second);
+
+   // don't let one enormous page flush everything else
+   if (page.size() > maxBytes_)
+      return;
+
+   while (!pages_.empty() && (pages_.size() >= maxPages_ || bytes_ + page.size() > maxBytes_))
+      erase(std::prev(pages_.end()));
+
+   pages_.push_front(Page { cacheKey, key, page });
+   index_[key] = pages_.begin();
+   bytes_ += page.size();
+}
+
+void PageCache::remove(const std::string& cacheKey)
+{
+   for (auto it = pages_.begin(); it != pages_.end(); )
+   {
+      auto next = std::next(it);
+      if (it->cacheKey == cacheKey)
+         erase(it);
+      it = next;
+   }
+}
+
+void PageCache::erase(std::list<Page>::iterator it)
+{
+   bytes_ -= it->page.size();
+   index_.erase(it->key);
+   pages_.erase(it);
+}
+
+} // namespace viewer
+} // namespace data
+} // namespace modules
+} // namespace session
+} // namespace rstudio
@@ -0,0 +1,130 @@
+/*
+ * DataViewerPage.hpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_DATA_VIEWER_PAGE_HPP
+#define SESSION_DATA_VIEWER_PAGE_HPP
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+// Page responses for the data viewer grid. A page is sent as one array of
+// cells per column (the first holding the row names), with the missing cells
+// of each column flagged in a bitmap, and is written straight to JSON text
+// so it can be cached and served again without being rebuilt.
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace data {
+namespace viewer {
+
+// how R's format() presents a set of finite numbers: with a common number of
+// decimal places, in either fixed or scientific notation
+struct NumberFormat
+{
+   NumberFormat() : decimals(0), scientific(false) {}
+
+   int decimals;
+   bool scientific;
+};
+
+// returns the format R would choose for the given finite values, for the
+// given values of the 'digits' (at most 15) and 'scipen' options
+NumberFormat numberFormat(const std::vector<double>& values, int digits, int scipen);
+
+// formats a finite value using the given format
+std::string formatNumber(double value, const NumberFormat& format);
+
+// writes the cells of a page one column at a time
+class PageWriter : boost::noncopyable
+{
+public:
+   PageWriter(int rows, int recordsTotal, int recordsFiltered);
+
+   void beginColumn();
+   void endColumn();
+
+   // the next cell in the column (strings are UTF-8)
+   void writeString(const char* value);
+   void writeString(const std::string& value);
+   void writeNumber(int value);
+   void writeMissing();
+
+   // returns the page; the writer can't be used afterwards
+   std::string finish();
+
+private:
+   int rows_;
+   int row_;
+   std::string page_;
+   std::string missing_;
+   std::vector<uint32_t> missingBits_;
+   bool hasMissing_;
+};
+
+// returns the response for a page, given the draw counter of the request
+// (which DataTables uses to discard responses to stale requests)
+std::string pageResponse(int draw, const std::string& page);
+
+// the most recently used pages of each viewer, so that scrolling back to a
+// page (or redrawing it) doesn't require formatting it again
+class PageCache : boost::noncopyable
+{
+public:
+   PageCache(std::size_t maxPages, std::size_t maxBytes);
+
+   // finds a page by its key, making it the most recently used
+   bool find(const std::string& key, std::string* pPage);
+
+   // adds a page for the viewer with the given cache key, discarding the
+   // least recently used pages as necessary
+   void insert(const std::string& cacheKey, const std::string& key, const std::string& page);
+
+   // discards all the pages for the viewer with the given cache key
+   void remove(const std::string& cacheKey);
+
+   std::size_t size() const { return pages_.size(); }
+
+private:
+   struct Page
+   {
+      std::string cacheKey;
+      std::string key;
+      std::string page;
+   };
+
+   void erase(std::list<Page>::iterator it);
+
+   std::size_t maxPages_;
+   std::size_t maxBytes_;
+   std::size_t bytes_;
+
+   // most recently used first
+   std::list<Page> pages_;
+   std::map<std::string, std::list<Page>::iterator> index_;
+};
+
+} // namespace viewer
+} // namespace data
+} // namespace modules
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_DATA_VIEWER_PAGE_HPP
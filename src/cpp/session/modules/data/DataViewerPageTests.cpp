@@ -0,0 +1,153 @@
+/*
+ * DataViewerPageTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "DataViewerPage.hpp"
+
+#define RSTUDIO_NO_TESTTHAT_ALIASES
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace data {
+namespace viewer {
+namespace tests {
+
+namespace {
+
+// formats values the way format() would with the given options
+std::vector<std::string> format(const std::vector<double>& values, int digits = 7, int scipen = 0)
+{
+   NumberFormat numbers = numberFormat(values, digits, scipen);
+
+   std::vector<std::string> formatted;
+   for (double value : values)
+      formatted.push_back(formatNumber(value, numbers));
+   return formatted;
+}
+
+typedef std::vector<std::string> Strings;
+
+} // anonymous namespace
+
+TEST_CASE("Data viewer pages")
+{
+   SECTION("Numbers are formatted as R formats them")
+   {
+      REQUIRE(format({ 1, 2.5 }) == Strings({ "1.0", "2.5" }));
+      REQUIRE(format({ 0.1 + 0.2 }) == Strings({ "0.3" }));
+      REQUIRE(format({ 1.0 / 3, 2.0 / 3 }) == Strings({ "0.3333333", "0.6666667" }));
+      REQUIRE(format({ 3.14159265 }) == Strings({ "3.141593" }));
+      REQUIRE(format({ 123456, 123456789 }) == Strings({ "123456", "123456789" }));
+      REQUIRE(format({ 99999.99 }) == Strings({ "99999.99" }));
+      REQUIRE(format({ 9.9999999 }) == Strings({ "10" }));
+      REQUIRE(format({ 0, -12 }) == Strings({ "0", "-12" }));
+   }
+
+   SECTION("Numbers use scientific notation when it's narrower")
+   {
+      REQUIRE(format({ 1e5 }) == Strings({ "1e+05" }));
+      REQUIRE(format({ 1e9 }) == Strings({ "1e+09" }));
+      REQUIRE(format({ 1e-20 }) == Strings({ "1e-20" }));
+      REQUIRE(format({ 1.5, -1e10 }) == Strings({ "1.5e+00", "-1.0e+10" }));
+   }
+
+   SECTION("Number formats respect the digits and scipen options")
+   {
+      REQUIRE(format({ 1e9 }, 7, 100) == Strings({ "1000000000" }));
+      REQUIRE(format({ 3.14159265 }, 3) == Strings({ "3.14" }));
+      REQUIRE(format({ 99.99 }, 3) == Strings({ "100" }));
+   }
+
+   SECTION("Pages are written as columns with missing value bitmaps")
+   {
+      PageWriter writer(3, 10, 5);
+      writer.beginColumn();
+      writer.writeNumber(1);
+      writer.writeNumber(2);
+      writer.writeNumber(3);
+      writer.endColumn();
+      writer.beginColumn();
+      writer.writeString("a\"b");
+      writer.writeMissing();
+      writer.endColumn();
+
+      REQUIRE(pageResponse(7, writer.finish()) ==
+              "{\"draw\":7,\"recordsTotal\":10,\"recordsFiltered\":5,"
+              "\"columns\":[[1,2,3],[\"a\\\"b\",null,null]],\"na\":[[],[6]]}");
+   }
+
+   SECTION("Control characters are escaped or replaced")
+   {
+      PageWriter writer(1, 1, 1);
+      writer.beginColumn();
+      writer.writeString("\t\x01\\");
+      writer.endColumn();
+
+      REQUIRE(writer.finish() ==
+              "\"recordsTotal\":1,\"recordsFiltered\":1,"
+              "\"columns\":[[\"\\t \\\\\"]],\"na\":[[]]}");
+   }
+
+   SECTION("Page cache discards least recently used pages")
+   {
+      PageCache cache(2, 1024);
+      std::string page;
+
+      cache.insert("viewer", "a", "page a");
+      cache.insert("viewer", "b", "page b");
+      REQUIRE(cache.find("a", &page));
+      REQUIRE(page == "page a");
+
+      cache.insert("viewer", "c", "page c");
+      REQUIRE(cache.find("a", &page));
+      REQUIRE_FALSE(cache.find("b", &page));
+      REQUIRE(cache.find("c", &page));
+   }
+
+   SECTION("Page cache is bounded in size")
+   {
+      PageCache cache(8, 10);
+      std::string page;
+
+      cache.insert("viewer", "a", "12345");
+      cache.insert("viewer", "b", "12345");
+      cache.insert("viewer", "c", "12345");
+      REQUIRE(cache.size() == 2);
+      REQUIRE_FALSE(cache.find("a", &page));
+
+      cache.insert("viewer", "d", "12345678901");
+      REQUIRE_FALSE(cache.find("d", &page));
+   }
+
+   SECTION("Page cache pages are removed by viewer")
+   {
+      PageCache cache(8, 1024);
+      std::string page;
+
+      cache.insert("one", "a", "page a");
+      cache.insert("two", "b", "page b");
+      cache.remove("one");
+      REQUIRE_FALSE(cache.find("a", &page));
+      REQUIRE(cache.find("b", &page));
+   }
+}
+
+} // namespace tests
+} // namespace viewer
+} // namespace data
+} // namespace modules
+} // namespace session
+} // namespace rstudio
@@ -0,0 +1,473 @@
+/*
+ * DataViewerTransform.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "DataViewerTransform.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+
+#include <shared_core/Error.hpp>
+#include <shared_core/SafeConvert.hpp>
+
+#define R_INTERNAL_FUNCTIONS
+#include <r/RInternal.hpp>
+#include <r/RExec.hpp>
+
+// separates filter type from contents (e.g. "numeric|12-25")
+#define kFilterSeparator "|"
+
+// the largest number of sort orders kept for a frame
+#define kMaxCachedOrders 4
+
+using namespace rstudio::core;
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace data {
+namespace viewer {
+
+namespace {
+
+bool isNumericType(SEXP columnSEXP)
+{
+   int type = TYPEOF(columnSEXP);
+   return type == INTSXP || type == REALSXP || type == LGLSXP;
+}
+
+bool isFactor(SEXP columnSEXP)
+{
+   return TYPEOF(columnSEXP) == INTSXP && r::sexp::inherits(columnSEXP, "factor");
+}
+
+// does R order this column by its underlying values? (true for plain
+// vectors, and for the common classes whose xtfrm() method just unclasses
+// them)
+bool isDirectlySortable(SEXP columnSEXP)
+{
+   if (!isNumericType(columnSEXP))
+      return false;
+
+   return !OBJECT(columnSEXP) ||
+      r::sexp::inherits(columnSEXP, "factor") ||
+      r::sexp::inherits(columnSEXP, "Date") ||
+      r::sexp::inherits(columnSEXP, "POSIXct") ||
+      r::sexp::inherits(columnSEXP, "difftime");
+}
+
+// can a text filter be matched natively? (the viewer matches text without
+// regard to case; we only fold the case of ASCII characters, so anything
+// else is left to R)
+bool isSimpleText(const std::string& text)
+{
+   for (char ch : text)
+   {
+      if (static_cast<unsigned char>(ch) >= 0x80 || ch == '\\')
+         return false;
+   }
+   return true;
+}
+
+double parseNumber(const std::string& value)
+{
+   return safe_convert::stringTo<double>(value, std::numeric_limits<double>::quiet_NaN());
+}
+
+// returns the rows for which a logical vector is TRUE
+RowSet rowsFromLogical(SEXP matchesSEXP, int nrow)
+{
+   RowSet rows(nrow);
+   if (TYPEOF(matchesSEXP) != LGLSXP)
+      return rows;
+
+   const int* pMatches = LOGICAL(matchesSEXP);
+   for (int i = 0, n = std::min(r::sexp::length(matchesSEXP), nrow); i < n; i++)
+   {
+      if (pMatches[i] == TRUE)
+         rows.set(i);
+   }
+   return rows;
+}
+
+RowSet rowsFromR(const std::string& function, SEXP columnSEXP, 
+                 const std::string& type, const std::string& value,
+                 int nrow)
+{
+   r::sexp::Protect protect;
+   SEXP matchesSEXP = R_NilValue;
+
+   r::exec::RFunction matchFx(function);
+   matchFx.addParam(columnSEXP);
+   if (!type.empty())
+      matchFx.addParam(type);
+   matchFx.addParam(value);
+   Error error = matchFx.call(&matchesSEXP, &protect);
+   if (error)
+      throw r::exec::RErrorException(error.getSummary());
+
+   return rowsFromLogical(matchesSEXP, nrow);
+}
+
+// matches text against a character vector, or the labels of a factor
+RowSet filterText(SEXP columnSEXP, const std::string& text, int nrow, const RowSet* pWithin)
+{
+   SEXP stringsSEXP = isFactor(columnSEXP) ?
+      r::sexp::getAttrib(columnSEXP, R_LevelsSymbol) : columnSEXP;
+
+   auto vmax = vmaxget();
+   std::vector<const char*> strings;
+   if (TYPEOF(stringsSEXP) == STRSXP)
+   {
+      int n = r::sexp::length(stringsSEXP);
+      strings.reserve(n);
+      for (int i = 0; i < n; i++)
+      {
+         SEXP charSEXP = STRING_ELT(stringsSEXP, i);
+         strings.push_back(charSEXP == NA_STRING ? nullptr : Rf_translateCharUTF8(charSEXP));
+      }
+   }
+
+   RowSet matches;
+   if (stringsSEXP == columnSEXP)
+   {
+      matches = filterContains(strings, nrow, text, pWithin);
+   }
+   else
+   {
+      int levels = static_cast<int>(strings.size());
+      RowSet levelMatches = filterContains(strings, levels, text);
+      matches = filterCodes(INTEGER(columnSEXP), r::sexp::length(columnSEXP), nrow,
+                            levelMatches, pWithin);
+   }
+
+   vmaxset(vmax);
+   return matches;
+}
+
+} // anonymous namespace
+
+FrameTransform::FrameTransform(SEXP dataSEXP, int nrow)
+   : data_(dataSEXP),
+     nrow_(nrow),
+     hasRows_(false)
+{
+   if (TYPEOF(dataSEXP) == VECSXP)
+   {
+      for (int i = 0, n = r::sexp::length(dataSEXP); i < n; i++)
+         columns_.push_back(VECTOR_ELT(dataSEXP, i));
+   }
+}
+
+bool FrameTransform::isFor(SEXP dataSEXP, int nrow) const
+{
+   if (nrow != nrow_ || TYPEOF(dataSEXP) != VECSXP)
+      return false;
+
+   if (r::sexp::length(dataSEXP) != static_cast<int>(columns_.size()))
+      return false;
+
+   for (std::size_t i = 0; i < columns_.size(); i++)
+   {
+      if (VECTOR_ELT(dataSEXP, i) != columns_[i])
+         return false;
+   }
+
+   return true;
+}
+
+const std::vector<int>& FrameTransform::rows(const std::vector<std::string>& filters,
+                                             const std::string& search,
+                                             const std::vector<int>& orderCols,
+                                             const std::vector<std::string>& orderDirs)
+{
+   // paging through the same view (the typical case)
+   if (hasRows_ &&
+       filters == rowsFilters_ &&
+       search == rowsSearch_ &&
+       orderCols == rowsOrderCols_ &&
+       orderDirs == rowsOrderDirs_)
+   {
+      return rows_;
+   }
+
+   int ncol = static_cast<int>(columns_.size());
+
+   // apply columnwise filters; a filter which narrows the previous filter on
+   // the same column only needs to examine the rows that matched before
+   bool filtered = false;
+   RowSet matches;
+   for (int i = 0, n = std::min(static_cast<int>(filters.size()), ncol); i < n; i++)
+   {
+      const std::string& filter = filters[i];
+      if (filter.empty())
+         continue;
+
+      auto cached = filters_.find(i);
+      if (cached == filters_.end() || cached->second.filter != filter)
+      {
+         const RowSet* pWithin = nullptr;
+         if (cached != filters_.end() && isFilterSubset(cached->second.filter, filter))
+            pWithin = &cached->second.rows;
+
+         RowSet rows = filterColumn(i, filter, pWithin);
+         CachedRows& entry = filters_[i];
+         entry.filter = filter;
+         entry.rows.swap(rows);
+         cached = filters_.find(i);
+      }
+
+      if (filtered)
+      {
+         matches &= cached->second.rows;
+      }
+      else
+      {
+         matches = cached->second.rows;
+         filtered = true;
+      }
+   }
+
+   // apply global search, which matches rows where any column matches
+   if (!search.empty())
+   {
+      if (search_.filter != search)
+      {
+         // a search containing the previous search can only match rows the
+         // previous search matched
+         const RowSet* pWithin = nullptr;
+         if (!search_.filter.empty() && search.find(search_.filter) != std::string::npos)
+            pWithin = &search_.rows;
+
+         RowSet rows = searchColumns(search, pWithin);
+         search_.filter = search;
+         search_.rows.swap(rows);
+      }
+
+      if (filtered)
+      {
+         matches &= search_.rows;
+      }
+      else
+      {
+         matches = search_.rows;
+         filtered = true;
+      }
+   }
+
+   // apply sort; the grid sorts on one column at a time (the last one
+   // requested). order columns are numbered as they are in the grid, where
+   // the first column holds the row names
+   const std::vector<int>* pOrder = nullptr;
+   if (!orderCols.empty())
+   {
+      int col = orderCols.back() - 1;
+      if (col >= 0 && col < ncol && r::sexp::length(columns_[col]) > 0)
+      {
+         bool descending = orderDirs.empty() || orderDirs.back() != "asc";
+         pOrder = &order(col, descending);
+      }
+   }
+
+   rows_ = selectRows(nrow_, pOrder, filtered ? &matches : nullptr);
+   rowsFilters_ = filters;
+   rowsSearch_ = search;
+   rowsOrderCols_ = orderCols;
+   rowsOrderDirs_ = orderDirs;
+   hasRows_ = true;
+   return rows_;
+}
+
+const std::vector<int>& FrameTransform::order(int col, bool descending)
+{
+   std::pair<int, bool> key = std::make_pair(col, descending);
+   auto it = orders_.find(key);
+   if (it != orders_.end())
+      return it->second;
+
+   r::sexp::Protect protect;
+   SEXP columnSEXP = columns_[col];
+
+   // anything R wouldn't order by its underlying values is ranked by xtfrm()
+   // first (this is how e.g. character vectors are put in collation order)
+   SEXP keysSEXP = columnSEXP;
+   if (!isDirectlySortable(columnSEXP))
+   {
+      Error error = r::exec::RFunction("xtfrm", columnSEXP).call(&keysSEXP, &protect);
+      if (error)
+         throw r::exec::RErrorException(error.getSummary());
+   }
+
+   // copy the keys so they can be sorted off the main thread; a column
+   // shorter than the frame is padded with NAs
+   int n = std::min(r::sexp::length(keysSEXP), nrow_);
+   std::vector<int> order;
+   switch (TYPEOF(keysSEXP))
+   {
+      case INTSXP:
+      case LGLSXP:
+      {
+         const int* pKeys = TYPEOF(keysSEXP) == INTSXP ? INTEGER(keysSEXP) : LOGICAL(keysSEXP);
+         std::vector<int> keys(nrow_, kNaInteger);
+         std::copy(pKeys, pKeys + n, keys.begin());
+         order = orderRows(keys, descending);
+         break;
+      }
+
+      case REALSXP:
+      {
+         const double* pKeys = REAL(keysSEXP);
+         std::vector<double> keys(nrow_, std::numeric_limits<double>::quiet_NaN());
+         std::copy(pKeys, pKeys + n, keys.begin());
+         order = orderRows(keys, descending);
+         break;
+      }
+
+      default:
+         throw r::exec::RErrorException(
+                  "Unable to sort column of type " + r::sexp::typeAsString(keysSEXP));
+   }
+
+   // make room for the new order
+   while (orderHistory_.size() >= kMaxCachedOrders)
+   {
+      orders_.erase(orderHistory_.front());
+      orderHistory_.pop_front();
+   }
+
+   orderHistory_.push_back(key);
+   std::vector<int>& cached = orders_[key];
+   cached.swap(order);
+   return cached;
+}
+
+RowSet FrameTransform::allRows() const
+{
+   RowSet rows(nrow_);
+   rows.set();
+   return rows;
+}
+
+RowSet FrameTransform::filterColumn(int col, const std::string& filter, const RowSet* pWithin)
+{
+   SEXP columnSEXP = columns_[col];
+
+   // split filter--string format is "type|value" (e.g. "numeric|12-25");
+   // filters without type information are ignored
+   std::size_t separator = filter.find(kFilterSeparator);
+   if (separator == std::string::npos)
+      return allRows();
+
+   std::string type = filter.substr(0, separator);
+   std::string value = filter.substr(separator + 1);
+   value = value.substr(0, value.find(kFilterSeparator));
+   if (value.empty() || r::sexp::length(columnSEXP) == 0)
+      return allRows();
+
+   int count = r::sexp::length(columnSEXP);
+
+   if (type == "factor")
+   {
+      // matches the factor's code (or the numeric value)
+      if (isNumericType(columnSEXP) && (!OBJECT(columnSEXP) || isFactor(columnSEXP)))
+      {
+         double code = parseNumber(value);
+         if (TYPEOF(columnSEXP) == REALSXP)
+            return filterRange(REAL(columnSEXP), count, nrow_, code, code, pWithin);
+         return filterRange(INTEGER(columnSEXP), count, nrow_, code, code, pWithin);
+      }
+   }
+   else if (type == "character")
+   {
+      // non-case-sensitive substring
+      if ((TYPEOF(columnSEXP) == STRSXP && !OBJECT(columnSEXP)) || isFactor(columnSEXP))
+      {
+         if (isSimpleText(value))
+            return filterText(columnSEXP, value, nrow_, pWithin);
+      }
+   }
+   else if (type == "numeric")
+   {
+      // range ("2_32") or equality ("15")
+      if (isDirectlySortable(columnSEXP) && !isFactor(columnSEXP))
+      {
+         std::vector<std::string> bounds;
+         boost::algorithm::split(bounds, value, boost::algorithm::is_any_of("_"));
+         if (bounds.size() > 1 && bounds.back().empty())
+            bounds.pop_back();
+
+         double min = parseNumber(bounds[0]);
+         double max = bounds.size() > 1 ? parseNumber(bounds[1]) : min;
+         if (TYPEOF(columnSEXP) == REALSXP)
+            return filterRange(REAL(columnSEXP), count, nrow_, min, max, pWithin);
+         return filterRange(INTEGER(columnSEXP), count, nrow_, min, max, pWithin);
+      }
+   }
+   else if (type == "boolean")
+   {
+      if (isNumericType(columnSEXP) && !OBJECT(columnSEXP))
+      {
+         double target = value == "TRUE" ? 1 : 0;
+         if (TYPEOF(columnSEXP) == REALSXP)
+            return filterRange(REAL(columnSEXP), count, nrow_, target, target, pWithin);
+         return filterRange(INTEGER(columnSEXP), count, nrow_, target, target, pWithin);
+      }
+   }
+   else
+   {
+      // unknown filter type
+      return allRows();
+   }
+
+   // let R match anything else
+   return rowsFromR(".rs.filterDataColumn", columnSEXP, type, value, nrow_);
+}
+
+RowSet FrameTransform::searchColumn(int col, const std::string& search, const RowSet* pWithin)
+{
+   SEXP columnSEXP = columns_[col];
+   if ((TYPEOF(columnSEXP) == STRSXP && !OBJECT(columnSEXP)) || isFactor(columnSEXP))
+   {
+      if (isSimpleText(search))
+         return filterText(columnSEXP, search, nrow_, pWithin);
+   }
+
+   return rowsFromR(".rs.searchDataColumn", columnSEXP, std::string(), search, nrow_);
+}
+
+RowSet FrameTransform::searchColumns(const std::string& search, const RowSet* pWithin)
+{
+   RowSet matches(nrow_);
+
+   // rows already matched by one column needn't be searched in the others
+   RowSet candidates = pWithin ? *pWithin : allRows();
+   for (int i = 0, n = static_cast<int>(columns_.size()); i < n && candidates.any(); i++)
+   {
+      RowSet found = searchColumn(i, search, &candidates);
+      found &= candidates;
+      matches |= found;
+      candidates -= found;
+   }
+
+   return matches;
+}
+
+} // namespace viewer
+} // namespace data
+} // namespace modules
+} // namespace session
+} // namespace rstudio
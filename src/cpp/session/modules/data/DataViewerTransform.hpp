@@ -0,0 +1,100 @@
+/*
+ * DataViewerTransform.hpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_DATA_VIEWER_TRANSFORM_HPP
+#define SESSION_DATA_VIEWER_TRANSFORM_HPP
+
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <r/RSexp.hpp>
+
+#include "DataViewerIndex.hpp"
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace data {
+namespace viewer {
+
+// The sorted, filtered and searched view of a data frame shown by a data
+// viewer, kept as the rows of the frame to display rather than as a
+// transformed copy of the frame. Sort orders and the rows matching each
+// filter are cached, so that re-sorting a filtered view, narrowing a filter,
+// and paging through the same view don't have to start from scratch.
+class FrameTransform : boost::noncopyable
+{
+public:
+   FrameTransform(SEXP dataSEXP, int nrow);
+
+   // is this the transform of the given data? (the frame is preserved while
+   // it's being transformed, so its columns can't be freed and replaced by
+   // others at the same addresses)
+   bool isFor(SEXP dataSEXP, int nrow) const;
+
+   // returns the rows (0-based, in the frame) to display for the given
+   // column filters, global search, and sort; NB: may throw
+   // r::exec::RErrorException
+   const std::vector<int>& rows(const std::vector<std::string>& filters,
+                                const std::string& search,
+                                const std::vector<int>& orderCols,
+                                const std::vector<std::string>& orderDirs);
+
+private:
+   struct CachedRows
+   {
+      std::string filter;
+      RowSet rows;
+   };
+
+   const std::vector<int>& order(int col, bool descending);
+   RowSet allRows() const;
+   RowSet filterColumn(int col, const std::string& filter, const RowSet* pWithin);
+   RowSet searchColumn(int col, const std::string& search, const RowSet* pWithin);
+   RowSet searchColumns(const std::string& search, const RowSet* pWithin);
+
+   r::sexp::PreservedSEXP data_;
+   std::vector<SEXP> columns_;
+   int nrow_;
+
+   // sort orders, by column and direction (most recently computed last)
+   std::map<std::pair<int, bool>, std::vector<int> > orders_;
+   std::deque<std::pair<int, bool> > orderHistory_;
+
+   // the most recent filter applied to each column, and the global search
+   std::map<int, CachedRows> filters_;
+   CachedRows search_;
+
+   // the most recent request and its result
+   bool hasRows_;
+   std::vector<std::string> rowsFilters_;
+   std::string rowsSearch_;
+   std::vector<int> rowsOrderCols_;
+   std::vector<std::string> rowsOrderDirs_;
+   std::vector<int> rows_;
+};
+
+} // namespace viewer
+} // namespace data
+} // namespace modules
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_DATA_VIEWER_TRANSFORM_HPP
@@ -22,6 +22,13 @@
 
 #include "EnvironmentUtils.hpp"
 
+// how long to spend describing changed objects after each check; any which
+// aren't described by then are described when the session is idle
+#define kDescribeBudgetMs 100
+
+// how long to spend describing objects at a time when the session is idle
+#define kDescribeIdleSliceMs 20
+
 using namespace rstudio::core;
 using namespace boost::placeholders;
 
@@ -31,55 +38,24 @@ namespace modules {
 namespace environment {
 namespace {
 
-bool compareVarName(const r::sexp::Variable& var1,
-                    const r::sexp::Variable& var2)
-{
-   return var1.first < var2.first;
-}
-
 void enqueRefreshEvent()
 {
    ClientEvent refreshEvent(client_events::kEnvironmentRefresh);
    module_context::enqueClientEvent(refreshEvent);
 }
 
-// if the given variable is an unevaluated promise, add it to the given
-// list of variables
-void addUnevaledPromise(std::vector<r::sexp::Variable>* pEnv,
-                        const r::sexp::Variable& var)
-{
-   if (isUnevaluatedPromise(var.second))
-   {
-      pEnv->push_back(var);
-   }
-}
-
-// If the given variable exists in the given list, remove it. Compares on name
-// only.
-void removeVarFromList(std::vector<r::sexp::Variable>* pEnv,
-                       const r::sexp::Variable& var)
-{
-   for (std::vector<r::sexp::Variable>::iterator iter = pEnv->begin();
-        iter != pEnv->end(); iter++)
-   {
-      if (iter->first == var.first)
-      {
-         pEnv->erase(iter);
-         break;
-      }
-   }
-}
-
 } // anonymous namespace
 
 EnvironmentMonitor::EnvironmentMonitor() :
+   describingWhenIdle_(false),
    initialized_(false),
    refreshOnInit_(false)
 {}
 
-void EnvironmentMonitor::enqueRemovedEvent(const r::sexp::Variable& variable)
+void EnvironmentMonitor::enqueRemovedEvent(SEXP symbolSEXP)
 {
-   ClientEvent removedEvent(client_events::kEnvironmentRemoved, variable.first);
+   ClientEvent removedEvent(client_events::kEnvironmentRemoved,
+                            r::sexp::asString(PRINTNAME(symbolSEXP)));
    module_context::enqueClientEvent(removedEvent);
 }
 
@@ -103,6 +79,8 @@ void EnvironmentMonitor::setMonitoredEnvironment(SEXP pEnvironment,
    environment_.set(pEnvironment);
 
    // init the environment by doing an initial check for changes
+   snapshot_.clear();
+   clearDescriptions();
    initialized_ = false;
    refreshOnInit_ = refresh;
    checkForChanges();
@@ -119,127 +97,158 @@ bool EnvironmentMonitor::hasEnvironment()
    return envir != nullptr && r::sexp::isPrimitiveEnvironment(envir);
 }
 
-void EnvironmentMonitor::listEnv(std::vector<r::sexp::Variable>* pEnv)
+void EnvironmentMonitor::listEnv(std::vector<r::sexp::Binding>* pBindings)
 {
    if (!hasEnvironment())
       return;
 
-   r::sexp::Protect rProtect;
-   r::sexp::listEnvironment(getMonitoredEnvironment(),
-                            false,
-                            prefs::userPrefs().showLastDotValue(),
-                            &rProtect,
-                            pEnv);
+   r::sexp::listBindings(getMonitoredEnvironment(),
+                         false,
+                         prefs::userPrefs().showLastDotValue(),
+                         pBindings);
 }
 
 void EnvironmentMonitor::checkForChanges()
 {
-   // information about the current environment
-   std::vector<r::sexp::Variable> currentEnv;
-   std::vector<r::sexp::Variable> currentPromises;
-
-   // list of assigns/removes (includes both value changes and promise
-   // evaluations)
-   std::vector<r::sexp::Variable> addedVars;
-   std::vector<r::sexp::Variable> removedVars;
-
-   // get the set of variables and promises in the current environment
+   // get the bindings in the current environment (this is the only work
+   // proportional to the size of the environment; the rest is proportional
+   // to the number of changes)
+   std::vector<r::sexp::Binding> currentEnv;
    listEnv(&currentEnv);
 
-   // R returns an environment list sorted in dictionary order. Since the
-   // set difference algorithms below use simple string comparisons to
-   // establish order, we need to re-sort the list into canonical order
-   // to avoid the algorithms detecting superfluous insertions.
-   std::sort(currentEnv.begin(), currentEnv.end(), compareVarName);
+   std::vector<EnvironmentSnapshot::Binding> bindings;
+   bindings.reserve(currentEnv.size());
+   for (const r::sexp::Binding& binding : currentEnv)
+   {
+      bindings.push_back(EnvironmentSnapshot::Binding(
+                            binding.first,
+                            binding.second,
+                            isUnevaluatedPromise(binding.second)));
+   }
 
-   std::for_each(currentEnv.begin(), currentEnv.end(),
-                 boost::bind(addUnevaledPromise, &currentPromises, _1));
+   // find adds & assigns (including promise evaluations) and removes
+   bool wasEmpty = snapshot_.empty();
+   EnvironmentSnapshot::Changes changes;
+   snapshot_.update(bindings, &changes);
 
-   bool refreshEnqueued = false;
    if (!initialized_)
    {
       if (refreshOnInit_ ||
           getMonitoredEnvironment() == R_GlobalEnv)
       {
+         clearDescriptions();
          enqueRefreshEvent();
-         refreshEnqueued = true;
       }
       initialized_ = true;
       refreshOnInit_ = false;
+      return;
    }
-   else
+
+   if (changes.assigned.empty() && changes.removed.empty())
+      return;
+
+   // optimize for empty currentEnv (user reset workspace) or empty
+   // previous environment (startup) by just sending a single refresh event
+   // only do this for the global environment--while debugging local
+   // environments, the environment object list is sent down as part of
+   // the context depth event.
+   if ((currentEnv.empty() || wasEmpty)
+       && getMonitoredEnvironment() == R_GlobalEnv)
+   {
+      clearDescriptions();
+      enqueRefreshEvent();
+      return;
+   }
+
+   // fire removed event for deletes (and stop describing them, if they were
+   // still waiting to be described)
+   for (const void* symbol : changes.removed)
    {
-      if (currentEnv != lastEnv_)
+      SEXP symbolSEXP = static_cast<SEXP>(const_cast<void*>(symbol));
+      describeQueued_.erase(symbolSEXP);
+      enqueRemovedEvent(symbolSEXP);
+   }
+
+   // fire assigned event for adds, assigns, and promise evaluations
+   for (const void* symbol : changes.assigned)
+      queueDescription(static_cast<SEXP>(const_cast<void*>(symbol)));
+   describeChanges();
+}
+
+void EnvironmentMonitor::queueDescription(SEXP symbolSEXP)
+{
+   if (describeQueued_.insert(symbolSEXP).second)
+      describeQueue_.push_back(symbolSEXP);
+}
+
+void EnvironmentMonitor::clearDescriptions()
+{
+   describeQueue_.clear();
+   describeQueued_.clear();
+}
+
+void EnvironmentMonitor::describeChanges()
+{
+   using namespace boost::posix_time;
+
+   // describe what we can now ...
+   ptime deadline = microsec_clock::universal_time() + milliseconds(kDescribeBudgetMs);
+   while (describeNext())
+   {
+      if (microsec_clock::universal_time() >= deadline)
+         break;
+   }
+
+   // ... and the rest when the session is idle
+   if (!describeQueue_.empty() && !describingWhenIdle_)
+   {
+      describingWhenIdle_ = true;
+      module_context::scheduleIncrementalWork(
+               milliseconds(kDescribeIdleSliceMs),
+               boost::bind(&EnvironmentMonitor::describeNextWhenIdle, this));
+   }
+}
+
+// describes the next queued object, emitting its assigned event; returns
+// true if more objects remain to be described
+bool EnvironmentMonitor::describeNext()
+{
+   while (!describeQueue_.empty())
+   {
+      SEXP symbolSEXP = describeQueue_.front();
+      describeQueue_.pop_front();
+
+      // skip objects removed while they were queued
+      if (describeQueued_.erase(symbolSEXP) == 0)
+         continue;
+
+      if (!hasEnvironment())
       {
-         // optimize for empty currentEnv (user reset workspace) or empty
-         // lastEnv_ (startup) by just sending a single refresh event
-         // only do this for the global environment--while debugging local
-         // environments, the environment object list is sent down as part of
-         // the context depth event.
-         if ((currentEnv.empty() || lastEnv_.empty())
-             && getMonitoredEnvironment() == R_GlobalEnv)
-         {
-            enqueRefreshEvent();
-            refreshEnqueued = true;
-         }
-         else
-         {
-            std::set_difference(lastEnv_.begin(), lastEnv_.end(),
-                                currentEnv.begin(), currentEnv.end(),
-                                std::back_inserter(removedVars),
-                                compareVarName);
-
-            // fire removed event for deletes
-            std::for_each(removedVars.begin(),
-                          removedVars.end(),
-                          boost::bind(&EnvironmentMonitor::enqueRemovedEvent,
-                                      this, _1));
-
-            // remove deleted objects from the list of uneval'ed promises
-            // so we'll stop monitoring them for evaluation
-            std::for_each(removedVars.begin(),
-                          removedVars.end(),
-                          boost::bind(removeVarFromList, &unevaledPromises_, _1));
-
-            // find adds & assigns (all variable name/value combinations in the
-            // current environment but NOT in the previous environment)
-            std::set_difference(currentEnv.begin(), currentEnv.end(),
-                                lastEnv_.begin(), lastEnv_.end(),
-                                std::back_inserter(addedVars));
-
-            // remove assigned objects from the list of uneval'ed promises
-            // (otherwise, we double-assign in the case where a promise SEXP
-            // is simultaneously forced/evaluated and assigned a new value)
-            std::for_each(addedVars.begin(),
-                          addedVars.end(),
-                          boost::bind(removeVarFromList, &unevaledPromises_, _1));
-
-         }
+         clearDescriptions();
+         break;
       }
-      // if a refresh is scheduled there's no need to emit add events one by one
-      if (!refreshEnqueued)
+
+      // describe the object's current value; if it's been removed since it
+      // was queued, the next check will report that
+      SEXP valueSEXP = r::sexp::findBinding(getMonitoredEnvironment(), symbolSEXP);
+      if (valueSEXP != R_UnboundValue)
       {
-         // have any promises been evaluated since we last checked?
-         if (currentPromises != unevaledPromises_)
-         {
-            // for each promise that is in the set of promises we are monitoring
-            // for evaluation but not in the set of currently tracked promises,
-            // we assume this to be an eval--process as an assign
-            std::set_difference(unevaledPromises_.begin(), unevaledPromises_.end(),
-                                currentPromises.begin(), currentPromises.end(),
-                                std::back_inserter(addedVars));
-         }
-
-         // fire assigned event for adds, assigns, and promise evaluations
-         std::for_each(addedVars.begin(),
-                       addedVars.end(),
-                       boost::bind(&EnvironmentMonitor::enqueAssignedEvent,
-                                    this, _1));
+         r::sexp::Protect protect(valueSEXP);
+         enqueAssignedEvent(std::make_pair(r::sexp::asString(PRINTNAME(symbolSEXP)),
+                                           valueSEXP));
       }
+      break;
    }
 
-   unevaledPromises_ = currentPromises;
-   lastEnv_ = currentEnv;
+   return !describeQueue_.empty();
+}
+
+bool EnvironmentMonitor::describeNextWhenIdle()
+{
+   bool more = describeNext();
+   if (!more)
+      describingWhenIdle_ = false;
+   return more;
 }
 
 } // namespace environment
@@ -13,9 +13,14 @@
  *
  */
 
+#include <deque>
+#include <unordered_set>
+
 #include <r/RSexp.hpp>
 #include <r/RInterface.hpp>
 
+#include "EnvironmentSnapshot.hpp"
+
 #ifndef SESSION_MODULES_ENVIRONMENT_MONITOR_HPP
 #define SESSION_MODULES_ENVIRONMENT_MONITOR_HPP
 
@@ -25,7 +30,10 @@ namespace modules {
 namespace environment {
 
 // EnvironmentMonitor listens for changes to objects in the given environment
-// context, and emits object add/remove events.
+// context, and emits object add/remove events. Describing objects for the
+// client can be slow (e.g. computing the sizes of large objects), so changed
+// objects are only described for a limited time after each check; the rest
+// are described (and their events emitted) when the session is idle.
 class EnvironmentMonitor : boost::noncopyable
 {
 public:
@@ -35,12 +43,19 @@ public:
    bool hasEnvironment();
    void checkForChanges();
 private:
-   void listEnv(std::vector<r::sexp::Variable>* pEnvironment);
-   void enqueRemovedEvent(const r::sexp::Variable& variable);
+   void listEnv(std::vector<r::sexp::Binding>* pBindings);
+   void enqueRemovedEvent(SEXP symbolSEXP);
    void enqueAssignedEvent(const r::sexp::Variable& variable);
+   void queueDescription(SEXP symbolSEXP);
+   void clearDescriptions();
+   void describeChanges();
+   bool describeNext();
+   bool describeNextWhenIdle();
 
-   std::vector<r::sexp::Variable> lastEnv_;
-   std::vector<r::sexp::Variable> unevaledPromises_;
+   EnvironmentSnapshot snapshot_;
+   std::deque<SEXP> describeQueue_;
+   std::unordered_set<SEXP> describeQueued_;
+   bool describingWhenIdle_;
    r::sexp::PreservedSEXP environment_;
    bool initialized_;
    bool refreshOnInit_;
@@ -0,0 +1,87 @@
+/*
+ * EnvironmentSnapshot.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "EnvironmentSnapshot.hpp"
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace environment {
+
+EnvironmentSnapshot::EnvironmentSnapshot()
+   : generation_(0)
+{
+}
+
+void EnvironmentSnapshot::update(const std::vector<Binding>& bindings,
+                                 Changes* pChanges)
+{
+   std::size_t previousSize = bindings_.size();
+   std::size_t seen = 0;
+
+   // entries not marked with this generation below are no longer bound
+   generation_++;
+
+   for (const Binding& binding : bindings)
+   {
+      Entry current = { binding.value, binding.unevaluatedPromise, generation_ };
+      auto result = bindings_.emplace(binding.symbol, current);
+      if (result.second)
+      {
+         pChanges->assigned.push_back(binding.symbol);
+         continue;
+      }
+
+      Entry& previous = result.first->second;
+      if (previous.generation == generation_)
+         continue;
+
+      seen++;
+      if (previous.value != binding.value ||
+          (previous.unevaluatedPromise && !binding.unevaluatedPromise))
+      {
+         pChanges->assigned.push_back(binding.symbol);
+      }
+      previous = current;
+   }
+
+   // only look for removals when some of the previous bindings weren't seen
+   // (which is rare, so this is usually skipped)
+   if (seen == previousSize)
+      return;
+
+   for (auto it = bindings_.begin(); it != bindings_.end(); )
+   {
+      if (it->second.generation != generation_)
+      {
+         pChanges->removed.push_back(it->first);
+         it = bindings_.erase(it);
+      }
+      else
+      {
+         it++;
+      }
+   }
+}
+
+void EnvironmentSnapshot::clear()
+{
+   bindings_.clear();
+}
+
+} // namespace environment
+} // namespace modules
+} // namespace session
+} // namespace rstudio
@@ -0,0 +1,85 @@
+/*
+ * EnvironmentSnapshot.hpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#ifndef SESSION_MODULES_ENVIRONMENT_SNAPSHOT_HPP
+#define SESSION_MODULES_ENVIRONMENT_SNAPSHOT_HPP
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace environment {
+
+// EnvironmentSnapshot records what each symbol in an environment was bound to
+// when the environment was last checked, so that the changes since can be
+// found without sorting or comparing entire listings. Symbols and values are
+// identified by address only (R symbols are unique, and an assignment always
+// binds a different object), so nothing is dereferenced here.
+class EnvironmentSnapshot
+{
+public:
+   struct Binding
+   {
+      Binding(const void* symbol, const void* value, bool unevaluatedPromise)
+         : symbol(symbol), value(value), unevaluatedPromise(unevaluatedPromise)
+      {
+      }
+
+      const void* symbol;
+      const void* value;
+      bool unevaluatedPromise;
+   };
+
+   struct Changes
+   {
+      // symbols which were added, bound to another object, or whose
+      // promise has since been evaluated
+      std::vector<const void*> assigned;
+
+      // symbols which are no longer bound
+      std::vector<const void*> removed;
+   };
+
+   EnvironmentSnapshot();
+
+   // replaces the snapshot with the given bindings, returning the changes
+   // since the previous snapshot
+   void update(const std::vector<Binding>& bindings, Changes* pChanges);
+
+   void clear();
+   bool empty() const { return bindings_.empty(); }
+   std::size_t size() const { return bindings_.size(); }
+
+private:
+   struct Entry
+   {
+      const void* value;
+      bool unevaluatedPromise;
+      unsigned generation;
+   };
+
+   std::unordered_map<const void*, Entry> bindings_;
+   unsigned generation_;
+};
+
+} // namespace environment
+} // namespace modules
+} // namespace session
+} // namespace rstudio
+
+#endif // SESSION_MODULES_ENVIRONMENT_SNAPSHOT_HPP
@@ -0,0 +1,223 @@
+/*
+ * EnvironmentSnapshotTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+
+#include "EnvironmentSnapshot.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+
+#include <boost/lexical_cast.hpp>
+
+#include <tests/TestThat.hpp>
+
+namespace rstudio {
+namespace session {
+namespace modules {
+namespace environment {
+namespace tests {
+
+namespace {
+
+typedef EnvironmentSnapshot::Binding Binding;
+typedef std::vector<const void*> Symbols;
+
+// stand-ins for R symbols and values; only their addresses are used
+char s_symbols[64];
+char s_values[64];
+
+const void* sym(int i) { return &s_symbols[i]; }
+const void* val(int i) { return &s_values[i]; }
+
+Symbols sorted(Symbols symbols)
+{
+   std::sort(symbols.begin(), symbols.end());
+   return symbols;
+}
+
+// a synthetic environment of the given size, with distinct symbols and values
+// listed in no particular order (as R lists hashed environments)
+std::vector<Binding> syntheticEnvironment(std::size_t size,
+                                          std::vector<char>* pSymbols,
+                                          std::vector<char>* pValues)
+{
+   pSymbols->resize(size);
+   pValues->resize(size * 2);
+
+   std::vector<Binding> bindings;
+   for (std::size_t i = 0; i < size; i++)
+      bindings.push_back(Binding(&(*pSymbols)[i], &(*pValues)[i], false));
+
+   std::shuffle(bindings.begin(), bindings.end(), std::mt19937(42));
+   return bindings;
+}
+
+// finds changes by sorting both listings and comparing them, as environments
+// were previously checked
+std::size_t sortedDiff(std::vector<Binding>* pPrevious, std::vector<Binding> current)
+{
+   auto bySymbol = [](const Binding& lhs, const Binding& rhs)
+   {
+      return lhs.symbol < rhs.symbol;
+   };
+   std::sort(current.begin(), current.end(), bySymbol);
+
+   std::size_t changes = 0;
+   auto previous = pPrevious->begin();
+   for (const Binding& binding : current)
+   {
+      while (previous != pPrevious->end() && previous->symbol < binding.symbol)
+      {
+         changes++;
+         previous++;
+      }
+      if (previous == pPrevious->end() || previous->symbol != binding.symbol)
+         changes++;
+      else if ((previous++)->value != binding.value)
+         changes++;
+   }
+   changes += pPrevious->end() - previous;
+
+   *pPrevious = current;
+   return changes;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Environment snapshots")
+{
+   EnvironmentSnapshot snapshot;
+   EnvironmentSnapshot::Changes changes;
+   snapshot.update({ Binding(sym(0), val(0), false),
+                     Binding(sym(1), val(1), false),
+                     Binding(sym(2), val(2), true) }, &changes);
+
+   SECTION("Initial bindings are all assigned")
+   {
+      REQUIRE(sorted(changes.assigned) == Symbols({ sym(0), sym(1), sym(2) }));
+      REQUIRE(changes.removed.empty());
+      REQUIRE(snapshot.size() == 3);
+   }
+
+   SECTION("Unchanged bindings are not reported")
+   {
+      EnvironmentSnapshot::Changes next;
+      snapshot.update({ Binding(sym(2), val(2), true),
+                        Binding(sym(0), val(0), false),
+                        Binding(sym(1), val(1), false) }, &next);
+      REQUIRE(next.assigned.empty());
+      REQUIRE(next.removed.empty());
+   }
+
+   SECTION("Added and reassigned bindings are reported")
+   {
+      EnvironmentSnapshot::Changes next;
+      snapshot.update({ Binding(sym(0), val(0), false),
+                        Binding(sym(1), val(10), false),
+                        Binding(sym(2), val(2), true),
+                        Binding(sym(3), val(3), false) }, &next);
+      REQUIRE(sorted(next.assigned) == Symbols({ sym(1), sym(3) }));
+      REQUIRE(next.removed.empty());
+   }
+
+   SECTION("Removed bindings are reported")
+   {
+      EnvironmentSnapshot::Changes next;
+      snapshot.update({ Binding(sym(1), val(1), false) }, &next);
+      REQUIRE(next.assigned.empty());
+      REQUIRE(sorted(next.removed) == Symbols({ sym(0), sym(2) }));
+      REQUIRE(snapshot.size() == 1);
+   }
+
+   SECTION("Removing and adding at once is reported")
+   {
+      EnvironmentSnapshot::Changes next;
+      snapshot.update({ Binding(sym(0), val(0), false),
+                        Binding(sym(1), val(1), false),
+                        Binding(sym(4), val(4), false) }, &next);
+      REQUIRE(next.assigned == Symbols({ sym(4) }));
+      REQUIRE(next.removed == Symbols({ sym(2) }));
+   }
+
+   SECTION("Evaluated promises are reported")
+   {
+      EnvironmentSnapshot::Changes next;
+      snapshot.update({ Binding(sym(0), val(0), false),
+                        Binding(sym(1), val(1), false),
+                        Binding(sym(2), val(2), false) }, &next);
+      REQUIRE(next.assigned == Symbols({ sym(2) }));
+
+      EnvironmentSnapshot::Changes after;
+      snapshot.update({ Binding(sym(0), val(0), false),
+                        Binding(sym(1), val(1), false),
+                        Binding(sym(2), val(2), false) }, &after);
+      REQUIRE(after.assigned.empty());
+   }
+
+   SECTION("Clearing starts over")
+   {
+      snapshot.clear();
+      REQUIRE(snapshot.empty());
+
+      EnvironmentSnapshot::Changes next;
+      snapshot.update({ Binding(sym(0), val(0), false) }, &next);
+      REQUIRE(next.assigned == Symbols({ sym(0) }));
+   }
+}
+
+benchmark_context("Environment change detection")
+{
+   for (std::size_t size : { 1000, 50000 })
+   {
+      std::vector<char> symbols, values;
+      std::vector<Binding> bindings = syntheticEnvironment(size, &symbols, &values);
+
+      EnvironmentSnapshot snapshot;
+      EnvironmentSnapshot::Changes initial;
+      snapshot.update(bindings, &initial);
+
+      std::vector<Binding> previous;
+      sortedDiff(&previous, bindings);
+
+      // alternately reassign a few objects and put them back, so that each
+      // check finds changes
+      std::vector<Binding> changed = bindings;
+      for (std::size_t i = 0; i < size; i += size / 5)
+         changed[i].value = &values[size + i];
+
+      std::string suffix = " (" + boost::lexical_cast<std::string>(size) + " objects)";
+      bool toggle = false;
+
+      benchmark_that("Sorted listing comparison" + suffix)
+      {
+         toggle = !toggle;
+         return sortedDiff(&previous, toggle ? changed : bindings);
+      };
+
+      benchmark_that("Snapshot update" + suffix)
+      {
+         toggle = !toggle;
+         EnvironmentSnapshot::Changes changes;
+         snapshot.update(toggle ? changed : bindings, &changes);
+         return changes.assigned.size();
+      };
+   }
+}
+
+} // namespace tests
+} // namespace environment
+} // namespace modules
+} // namespace session
+} // namespace rstudio
@@ -997,48 +997,8 @@ void handleRangeRequest(const FilePath& targetFile,
                         const http::Request& request,
                         http::Response* pResponse)
 {
-   // cache the last file
-   struct RangeFileCache
-   {
-      FileInfo file;
-      std::string contentType;
-      std::string contents;
-
-      void clear()
-      {
-         file = FileInfo();
-         contentType.clear();
-         contents.clear();
-      }
-   };
-   static RangeFileCache s_cache;
-
-   // see if we need to do a fresh read
-   if (targetFile.getAbsolutePath() != s_cache.file.absolutePath() ||
-       targetFile.getLastWriteTime() != s_cache.file.lastWriteTime())
-   {
-      // clear the cache
-      s_cache.clear();
-
-      // read the file in from disk
-      Error error = core::readStringFromFile(targetFile, &(s_cache.contents));
-      if (error)
-      {
-         pResponse->setError(error);
-         return;
-      }
-
-      // update the cache
-      s_cache.file = FileInfo(targetFile);
-      s_cache.contentType = targetFile.getMimeContentType();
-   }
-
-   // always serve from the cache
-   pResponse->setRangeableFile(s_cache.contents,
-                               s_cache.contentType,
-                               request);
-
-
+   // only the requested ranges are read from disk
+   pResponse->setRangeableFile(targetFile, request);
 }
 
 void handlePresentationViewInBrowserRequest(const http::Request& request,
@@ -279,6 +279,31 @@
     );
   };
 
+  // the server sends each page as an array of columns (the first holding the
+  // row names), with the missing values in each column flagged in a bitmap
+  // of 32-bit words; DataTables wants an array of rows, with 0 marking NA
+  var columnsToRows = function (json) {
+    var columns = json.columns || [];
+    var na = json.na || [];
+    var nrow = columns.length > 0 ? columns[0].length : 0;
+
+    var rows = new Array(nrow);
+    for (var row = 0; row < nrow; row++) {
+      rows[row] = new Array(columns.length);
+    }
+
+    for (var col = 0; col < columns.length; col++) {
+      var values = columns[col];
+      var missing = na[col] || [];
+      for (row = 0; row < nrow; row++) {
+        var isNA = missing.length > 0 && (missing[row >>> 5] >>> (row & 31)) & 1;
+        rows[row][col] = isNA ? 0 : values[row];
+      }
+    }
+
+    return rows;
+  };
+
   // render cell contents--if no search is active, just renders the data
   // literally; when search is active, highlights the portion of the text that
   // matches the search
@@ -1145,6 +1170,7 @@
           d.column_offset = columnOffset;
           d.max_columns = maxColumns;
         },
+        dataSrc: columnsToRows,
         error: function (jqXHR) {
           if (jqXHR.responseText[0] !== "{") showError(jqXHR.responseText);
           else {
@@ -24,14 +24,26 @@
 #include <shared_core/FileLogDestination.hpp>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/thread.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include <shared_core/DateTime.hpp>
 #include <shared_core/Error.hpp>
 #include <shared_core/Logger.hpp>
 #include <shared_core/SafeConvert.hpp>
+#include <shared_core/json/Json.hpp>
 
 #ifndef _WIN32
 #include <shared_core/system/PosixSystem.hpp>
@@ -55,7 +67,8 @@ FileLogOptions::FileLogOptions(FilePath in_directory) :
    m_doRotation(s_defaultDoRotation),
    m_includePid(s_defaultIncludePid),
    m_warnSyslog(s_defaultWarnSyslog),
-   m_forceDirectory(s_defaultForceDirectory)
+   m_forceDirectory(s_defaultForceDirectory),
+   m_asyncWrites(s_defaultAsyncWrites)
 {
 }
 
@@ -70,7 +83,8 @@ FileLogOptions::FileLogOptions(FilePath in_directory,
    m_doRotation(s_defaultDoRotation),
    m_includePid(s_defaultIncludePid),
    m_warnSyslog(in_warnSyslog),
-   m_forceDirectory(s_defaultForceDirectory)
+   m_forceDirectory(s_defaultForceDirectory),
+   m_asyncWrites(s_defaultAsyncWrites)
 {
 }
 
@@ -84,7 +98,8 @@ FileLogOptions::FileLogOptions(
    bool in_doRotation,
    bool in_includePid,
    bool in_warnSyslog,
-   bool in_forceDirectory) :
+   bool in_forceDirectory,
+   bool in_asyncWrites) :
       m_directory(std::move(in_directory)),
       m_fileMode(std::move(in_fileMode)),
       m_maxSizeMb(in_maxSizeMb),
@@ -94,8 +109,14 @@ FileLogOptions::FileLogOptions(
       m_doRotation(in_doRotation),
       m_includePid(in_includePid),
       m_warnSyslog(in_warnSyslog),
-      m_forceDirectory(in_forceDirectory)
+      m_forceDirectory(in_forceDirectory),
+      m_asyncWrites(in_asyncWrites)
+{
+}
+
+bool FileLogOptions::asyncWrites() const
 {
+   return m_asyncWrites;
 }
 
 int FileLogOptions::getDeletionDays() const
@@ -148,6 +169,11 @@ bool FileLogOptions::includePid() const
    return m_includePid;
 }
 
+void FileLogOptions::setAsyncWrites(bool in_asyncWrites)
+{
+   m_asyncWrites = in_asyncWrites;
+}
+
 void FileLogOptions::setDeletionDays(int in_deletionDays)
 {
    m_deletionDays = in_deletionDays;
@@ -193,6 +219,507 @@ void FileLogOptions::setWarnSyslog(bool in_warnSyslog)
    m_warnSyslog = in_warnSyslog;
 }
 
+// AsyncLogWriter ======================================================================================================
+namespace {
+
+// The maximum number of records each thread may have waiting to be written to an asynchronous file log destination.
+constexpr size_t s_asyncRingCapacity = 1024;
+
+// The maximum number of bytes which may be waiting to be written to an asynchronous file log destination.
+constexpr size_t s_asyncMaxQueuedBytes = 8 * 1048576;
+
+// The size at which the writer thread stops gathering records and writes what it has.
+constexpr size_t s_asyncMaxBatchBytes = 256 * 1024;
+
+// How long the writer thread waits for new records before checking again.
+constexpr int s_asyncIdleWaitMs = 200;
+
+/**
+ * @brief A lock which can also be tried from a signal handler, where waiting on a mutex is not safe. It is only held
+ *        briefly, so waiting threads spin.
+ */
+class SpinLock : boost::noncopyable
+{
+public:
+   SpinLock() :
+      m_locked(false)
+   {
+   }
+
+   bool try_lock()
+   {
+      return !m_locked.exchange(true, std::memory_order_acquire);
+   }
+
+   void lock()
+   {
+      while (!try_lock())
+         boost::this_thread::yield();
+   }
+
+   void unlock()
+   {
+      m_locked.store(false, std::memory_order_release);
+   }
+
+private:
+   std::atomic<bool> m_locked;
+};
+
+/**
+ * @brief A bounded queue of preformatted log records. Records are pushed only by the thread which owns the ring and
+ *        popped only by the thread which is draining the writer, so no locking is necessary.
+ */
+class RecordRing : boost::noncopyable
+{
+public:
+   explicit RecordRing(size_t in_capacity) :
+      Abandoned(false),
+      m_records(in_capacity + 1),
+      m_head(0),
+      m_tail(0)
+   {
+   }
+
+   bool push(const std::string& in_record)
+   {
+      size_t tail = m_tail.load(std::memory_order_relaxed);
+      size_t next = (tail + 1) % m_records.size();
+
+      // One slot is always left empty so that a full ring can be told apart from an empty one.
+      if (next == m_head.load(std::memory_order_acquire))
+         return false;
+
+      m_records[tail] = in_record;
+      m_tail.store(next, std::memory_order_release);
+      return true;
+   }
+
+   // The record's memory is only released if in_release is true, so that this may be used where freeing memory is
+   // not safe.
+   template <typename F>
+   bool pop(F&& in_consumer, bool in_release = true)
+   {
+      size_t head = m_head.load(std::memory_order_relaxed);
+      if (head == m_tail.load(std::memory_order_acquire))
+         return false;
+
+      in_consumer(m_records[head]);
+      if (in_release)
+         std::string().swap(m_records[head]);
+
+      m_head.store((head + 1) % m_records.size(), std::memory_order_release);
+      return true;
+   }
+
+   bool empty() const
+   {
+      return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+   }
+
+   // Set once the owning thread has exited, after which the ring may be discarded as soon as it is empty.
+   std::atomic<bool> Abandoned;
+
+private:
+   std::vector<std::string> m_records;
+   std::atomic<size_t> m_head;
+   std::atomic<size_t> m_tail;
+};
+
+/**
+ * @brief The rings which the current thread has created, keyed by the ID of the writer they belong to.
+ */
+struct ThreadRecordRings
+{
+   ~ThreadRecordRings()
+   {
+      for (auto& ring : Rings)
+         ring.second->Abandoned = true;
+   }
+
+   std::unordered_map<uint64_t, std::shared_ptr<RecordRing>> Rings;
+};
+
+thread_local ThreadRecordRings t_recordRings;
+
+std::atomic<uint64_t> s_nextWriterId(0);
+
+class AsyncLogWriter;
+
+// The writers which are currently running, so that they can be flushed if the process crashes. These are
+// intentionally leaked so that they are still usable while the process is exiting.
+boost::mutex& writersMutex()
+{
+   static boost::mutex* mutex = new boost::mutex();
+   return *mutex;
+}
+
+std::vector<AsyncLogWriter*>& writers()
+{
+   static std::vector<AsyncLogWriter*>* writers = new std::vector<AsyncLogWriter*>();
+   return *writers;
+}
+
+// The same writers, in fixed slots so that they can be found from a crash handler without locking. Writers beyond
+// the last slot are not flushed on a crash.
+constexpr size_t s_maxCrashWriters = 16;
+std::atomic<AsyncLogWriter*> s_crashWriters[s_maxCrashWriters];
+
+std::once_flag s_registerAtExitOnce;
+
+/**
+ * @brief Writes log records from a background thread.
+ *
+ * Each thread which logs gets its own ring, so logging threads never wait on each other or on the file. The
+ * background thread gathers the records of all rings into batches which are written at once. Records from one thread
+ * are always written in order, but records from different threads may be interleaved differently than they were
+ * logged.
+ */
+class AsyncLogWriter : boost::noncopyable
+{
+public:
+   typedef boost::function<void(const std::string&)> WriteBatchFunction;
+   typedef boost::function<void()> CloseFileFunction;
+   typedef boost::function<std::string(uint64_t)> DropNoticeFunction;
+
+   AsyncLogWriter(std::string in_logFilePath,
+                  WriteBatchFunction in_writeBatch,
+                  CloseFileFunction in_closeFile,
+                  DropNoticeFunction in_dropNotice) :
+      m_id(++s_nextWriterId),
+      m_logFilePath(std::move(in_logFilePath)),
+      m_writeBatch(std::move(in_writeBatch)),
+      m_closeFile(std::move(in_closeFile)),
+      m_dropNotice(std::move(in_dropNotice)),
+      m_draining(false),
+      m_queuedBytes(0),
+      m_dropped(0),
+      m_reportedDrops(0),
+      m_idle(false),
+      m_reopen(false),
+      m_stop(false),
+      m_stopped(false)
+#ifndef _WIN32
+      , m_pid(::getpid())
+#endif
+   {
+      m_thread = boost::thread(boost::bind(&AsyncLogWriter::run, this));
+
+      {
+         boost::lock_guard<boost::mutex> lock(writersMutex());
+         writers().push_back(this);
+      }
+
+      for (std::atomic<AsyncLogWriter*>& slot : s_crashWriters)
+      {
+         AsyncLogWriter* empty = nullptr;
+         if (slot.compare_exchange_strong(empty, this))
+            break;
+      }
+
+      // Write out whatever is queued when the process exits normally, since the logger itself is never destroyed.
+      std::call_once(s_registerAtExitOnce, []()
+      {
+         std::atexit(&FileLogDestination::stopAsyncWrites);
+      });
+   }
+
+   ~AsyncLogWriter()
+   {
+      try
+      {
+         {
+            boost::lock_guard<boost::mutex> lock(writersMutex());
+            writers().erase(std::remove(writers().begin(), writers().end(), this), writers().end());
+         }
+
+         for (std::atomic<AsyncLogWriter*>& slot : s_crashWriters)
+         {
+            AsyncLogWriter* self = this;
+            slot.compare_exchange_strong(self, nullptr);
+         }
+
+         // A forked child has a copy of this object, but not the thread or the parent's queued records.
+         if (!isRunningInThisProcess())
+         {
+            m_thread.detach();
+            return;
+         }
+
+         stop();
+      }
+      catch (...)
+      {
+         // Swallow exceptions because we'd trigger recursive logging otherwise.
+      }
+   }
+
+   // Stops the writer thread and writes out everything still queued. Messages logged afterwards are written
+   // synchronously by the destination.
+   void stop()
+   {
+      if (m_stopped.exchange(true))
+         return;
+
+      m_stop = true;
+      wakeWriter();
+      if (m_thread.joinable())
+         m_thread.join();
+
+      // Write out anything that was logged while the thread was stopping.
+      drain();
+      m_closeFile();
+   }
+
+   void enqueue(const std::string& in_message)
+   {
+      // The bytes are reserved before the record is pushed, so the writer can never take the record (and release its
+      // bytes) before they have been counted.
+      const size_t size = in_message.size();
+      if ((m_queuedBytes.fetch_add(size) + size > s_asyncMaxQueuedBytes) || !threadRing().push(in_message))
+      {
+         m_queuedBytes.fetch_sub(size);
+         ++m_dropped;
+         return;
+      }
+
+      // The writer thread only needs to be woken if it is waiting for records.
+      if (m_idle)
+         wakeWriter();
+   }
+
+   // Writes everything that has been queued so far from the calling thread. Returns true if anything was written.
+   bool drain()
+   {
+      boost::lock_guard<boost::mutex> lock(m_drainMutex);
+      return drainImpl();
+   }
+
+   // Makes the writer release its log file before the next write.
+   void reopen()
+   {
+      m_reopen = true;
+      wakeWriter();
+   }
+
+   // Called from a crash handler, so this must not block or allocate. Records are written as they are, without
+   // batching, and nothing is written if the writer is in the middle of draining.
+   void flushOnCrash()
+   {
+#ifndef _WIN32
+      if (m_draining.exchange(true))
+         return;
+
+      if (m_ringsLock.try_lock())
+      {
+         int fd = ::open(m_logFilePath.c_str(), O_WRONLY | O_APPEND | O_CREAT, S_IRUSR | S_IWUSR);
+         if (fd >= 0)
+         {
+            bool ok = true;
+            auto writeRecord = [&](const std::string& in_record)
+            {
+               if (ok)
+                  ok = ::write(fd, in_record.data(), in_record.size()) >= 0;
+            };
+
+            for (const std::shared_ptr<RecordRing>& ring : m_rings)
+            {
+               while (ok && ring->pop(writeRecord, false))
+               {
+               }
+            }
+
+            ::close(fd);
+         }
+
+         m_ringsLock.unlock();
+      }
+
+      m_draining = false;
+#endif
+   }
+
+   uint64_t droppedCount() const
+   {
+      return m_dropped;
+   }
+
+   // Whether messages should be queued for this writer rather than written directly.
+   bool isAcceptingRecords() const
+   {
+      return !m_stopped && isRunningInThisProcess();
+   }
+
+   bool isRunningInThisProcess() const
+   {
+#ifndef _WIN32
+      return m_pid == ::getpid();
+#else
+      return true;
+#endif
+   }
+
+private:
+   RecordRing& threadRing()
+   {
+      std::shared_ptr<RecordRing>& ring = t_recordRings.Rings[m_id];
+      if (!ring)
+      {
+         ring = std::make_shared<RecordRing>(s_asyncRingCapacity);
+
+         boost::lock_guard<SpinLock> lock(m_ringsLock);
+         m_rings.push_back(ring);
+      }
+
+      return *ring;
+   }
+
+   void wakeWriter()
+   {
+      // Taking the lock ensures the writer is either waiting or will see the new state before it waits.
+      boost::lock_guard<boost::mutex> lock(m_wakeMutex);
+      m_wakeup.notify_one();
+   }
+
+   // m_drainMutex must be held.
+   bool drainImpl()
+   {
+      // Only the crash handler can be draining as well, in which case the process is going away anyway.
+      if (m_draining.exchange(true))
+         return false;
+
+      try
+      {
+         bool wrote = drainRings();
+         m_draining = false;
+         return wrote;
+      }
+      catch (...)
+      {
+         m_draining = false;
+         throw;
+      }
+   }
+
+   // m_draining must be held.
+   bool drainRings()
+   {
+      std::vector<std::shared_ptr<RecordRing>> rings;
+      {
+         boost::lock_guard<SpinLock> lock(m_ringsLock);
+
+         // Forget the rings of exited threads once they have been emptied.
+         m_rings.erase(
+            std::remove_if(m_rings.begin(), m_rings.end(), [](const std::shared_ptr<RecordRing>& in_ring)
+            {
+               return in_ring->Abandoned && in_ring->empty();
+            }),
+            m_rings.end());
+         rings = m_rings;
+      }
+
+      std::string batch;
+      bool wrote = false;
+
+      uint64_t dropped = m_dropped;
+      if (dropped != m_reportedDrops)
+      {
+         batch = m_dropNotice(dropped - m_reportedDrops);
+         m_reportedDrops = dropped;
+      }
+
+      auto writeBatch = [&]()
+      {
+         if (batch.empty())
+            return;
+
+         m_writeBatch(batch);
+         batch.clear();
+         wrote = true;
+      };
+
+      auto appendRecord = [&](const std::string& in_record)
+      {
+         batch.append(in_record);
+         m_queuedBytes -= in_record.size();
+      };
+
+      for (const std::shared_ptr<RecordRing>& ring : rings)
+      {
+         while (ring->pop(appendRecord))
+         {
+            if (batch.size() >= s_asyncMaxBatchBytes)
+               writeBatch();
+         }
+      }
+
+      writeBatch();
+      return wrote;
+   }
+
+   void run()
+   {
+      try
+      {
+         while (!m_stop)
+         {
+            if (m_reopen.exchange(false))
+               m_closeFile();
+
+            if (drain())
+               continue;
+
+            // Nothing to write - release the log file so it isn't held open while idle, and wait for more records.
+            m_closeFile();
+
+            boost::unique_lock<boost::mutex> lock(m_wakeMutex);
+            m_idle = true;
+            if (m_queuedBytes == 0 && !m_stop && !m_reopen)
+               m_wakeup.timed_wait(lock, boost::posix_time::milliseconds(s_asyncIdleWaitMs));
+            m_idle = false;
+         }
+      }
+      catch (...)
+      {
+         // Swallow exceptions because we'd trigger recursive logging otherwise.
+      }
+   }
+
+   const uint64_t m_id;
+   const std::string m_logFilePath;
+   WriteBatchFunction m_writeBatch;
+   CloseFileFunction m_closeFile;
+   DropNoticeFunction m_dropNotice;
+
+   // The rings of every thread which has logged to this writer.
+   SpinLock m_ringsLock;
+   std::vector<std::shared_ptr<RecordRing>> m_rings;
+
+   // Held while records are being taken from the rings, since each ring may only have one reader at a time. The
+   // crash handler can't wait on the mutex, so m_draining is what actually keeps it from reading at the same time.
+   boost::mutex m_drainMutex;
+   std::atomic<bool> m_draining;
+
+   std::atomic<size_t> m_queuedBytes;
+   std::atomic<uint64_t> m_dropped;
+   uint64_t m_reportedDrops;
+
+   boost::mutex m_wakeMutex;
+   boost::condition_variable m_wakeup;
+   std::atomic<bool> m_idle;
+   std::atomic<bool> m_reopen;
+   std::atomic<bool> m_stop;
+   std::atomic<bool> m_stopped;
+
+#ifndef _WIN32
+   const pid_t m_pid;
+#endif
+
+   boost::thread m_thread;
+};
+
+} // anonymous namespace
+
 // FileLogDestination ==================================================================================================
 struct FileLogDestination::Impl
 {
@@ -259,6 +786,8 @@ struct FileLogDestination::Impl
 
    ~Impl()
    {
+      // The writer thread uses this object, so it must be stopped first.
+      Writer.reset();
       closeLogFile();
    }
 
@@ -509,16 +1038,18 @@ struct FileLogDestination::Impl
       return ((now - FirstLogLineTime.get()) >= rotateTime);
    }
 
+   uintmax_t getMaxSize()
+   {
+      return 1048576.0 * LogOptions.getMaxSizeMb();
+   }
+
    // Returns true if it is safe to log; false otherwise.
    bool rotateLogFile()
    {
-      // Calculate the maximum size in bytes.
-      const uintmax_t maxSize = 1048576.0 * LogOptions.getMaxSizeMb();
-
       // Only rotate if we're configured to rotate.
       if (LogOptions.doRotation())
       {
-         if (LogFile.getSize() >= maxSize || shouldTimeRotate())
+         if (LogFile.getSize() >= getMaxSize() || shouldTimeRotate())
          {
             if (!rotateLogFileImpl(LogFile))
                return false;
@@ -535,6 +1066,71 @@ struct FileLogDestination::Impl
       }
    }
 
+   // Writes a batch of records for the asynchronous writer. The log file is kept open between batches, and its size is
+   // tracked as it is written rather than checked before each write.
+   void writeBatch(const std::string& in_batch)
+   {
+      try
+      {
+         boost::lock_guard<boost::mutex> lock(Mutex);
+
+         if (!verifyLogFilePath())
+            return;
+
+         if (!LogOutputStream)
+         {
+            if (!openLogFile())
+            {
+               closeLogFile();
+               return;
+            }
+
+            TrackedSize = LogFile.getSize();
+         }
+
+         if (LogOptions.doRotation() && (TrackedSize >= getMaxSize() || shouldTimeRotate()))
+         {
+            closeLogFile();
+            if (!rotateLogFileImpl(LogFile) || !openLogFile())
+            {
+               closeLogFile();
+               return;
+            }
+
+            TrackedSize = LogFile.getSize();
+         }
+
+         (*LogOutputStream) << in_batch;
+         LogOutputStream->flush();
+
+         // As with synchronous writes, the stream may have been closed underneath us - retry once on a fresh stream.
+         if (!LogOutputStream->good())
+         {
+            if (!openLogFile())
+            {
+               closeLogFile();
+               return;
+            }
+
+            TrackedSize = LogFile.getSize();
+            (*LogOutputStream) << in_batch;
+            LogOutputStream->flush();
+         }
+
+         TrackedSize += in_batch.size();
+      }
+      catch (...)
+      {
+         // Swallow exceptions because we'd trigger recursive logging otherwise.
+      }
+   }
+
+   void releaseLogFile()
+   {
+      boost::lock_guard<boost::mutex> lock(Mutex);
+      closeLogFile();
+   }
+
    FileLogOptions LogOptions;
    FilePath LogFile;
    std::string LogName;
@@ -542,11 +1138,40 @@ struct FileLogDestination::Impl
    std::shared_ptr<std::ostream> LogOutputStream;
    boost::optional<boost::posix_time::ptime> FirstLogLineTime;
 
+   // The size of the log file as of the last asynchronous write.
+   uintmax_t TrackedSize = 0;
+
 #ifndef _WIN32
    std::shared_ptr<core::system::SyslogDestination> SyslogDest;
 #endif
+
+   std::unique_ptr<AsyncLogWriter> Writer;
 };
 
+namespace {
+
+std::string formatDropNotice(LogMessageFormatType in_formatType, const std::string& in_programId, uint64_t in_dropped)
+{
+   std::string time = core::date_time::format(boost::posix_time::microsec_clock::universal_time(),
+                                              core::date_time::kIso8601Format);
+   std::string message = safe_convert::numberToString(in_dropped) +
+      " log messages were dropped because they could not be written quickly enough";
+
+   if (in_formatType == LogMessageFormatType::JSON)
+   {
+      json::Object logObject;
+      logObject["time"] = time;
+      logObject["service"] = in_programId;
+      logObject["level"] = "WARNING";
+      logObject["message"] = message;
+      return logObject.write() + "\n";
+   }
+
+   return time + " [" + in_programId + "] WARNING " + message + "\n";
+}
+
+} // anonymous namespace
+
 FileLogDestination::FileLogDestination(
    const std::string& in_id,
    LogLevel in_logLevel,
@@ -567,14 +1192,68 @@ FileLogDestination::FileLogDestination(
                in_id, log::LogLevel::WARN, in_formatType, in_programId);
    }
 #endif
+
+   if (m_impl->LogOptions.asyncWrites())
+   {
+      Impl* impl = m_impl.get();
+      m_impl->Writer.reset(new AsyncLogWriter(
+         m_impl->LogFile.getAbsolutePath(),
+         [impl](const std::string& in_batch) { impl->writeBatch(in_batch); },
+         [impl]() { impl->releaseLogFile(); },
+         [in_formatType, in_programId](uint64_t in_dropped)
+         {
+            return formatDropNotice(in_formatType, in_programId, in_dropped);
+         }));
+   }
 }
 
 FileLogDestination::~FileLogDestination()
 {
+   // Stop the writer thread, writing out anything still queued.
+   m_impl->Writer.reset();
+
    if (m_impl->LogOutputStream.get())
       m_impl->LogOutputStream->flush();
 }
 
+uint64_t FileLogDestination::droppedMessageCount() const
+{
+   return m_impl->Writer ? m_impl->Writer->droppedCount() : 0;
+}
+
+void FileLogDestination::flush()
+{
+   if (m_impl->Writer && m_impl->Writer->isRunningInThisProcess())
+      m_impl->Writer->drain();
+}
+
+void FileLogDestination::stopAsyncWrites()
+{
+   try
+   {
+      boost::lock_guard<boost::mutex> lock(writersMutex());
+      for (AsyncLogWriter* writer : writers())
+      {
+         if (writer->isRunningInThisProcess())
+            writer->stop();
+      }
+   }
+   catch (...)
+   {
+      // Swallow exceptions because we'd trigger recursive logging otherwise.
+   }
+}
+
+void FileLogDestination::flushOnCrash()
+{
+   for (std::atomic<AsyncLogWriter*>& slot : s_crashWriters)
+   {
+      AsyncLogWriter* writer = slot.load();
+      if (writer && writer->isRunningInThisProcess())
+         writer->flushOnCrash();
+   }
+}
+
 std::string FileLogDestination::path()
 {
    return m_impl->LogFile.getAbsolutePath();
@@ -582,8 +1261,12 @@ std::string FileLogDestination::path()
 
 void FileLogDestination::refresh(const RefreshParams& in_refreshParams)
 {
-   // Close the log file to ensure that if we just forked old FDs are cleared out
-   m_impl->closeLogFile();
+   // Close the log file to ensure that if we just forked old FDs are cleared out. The writer thread owns the file in
+   // asynchronous mode, so it is asked to do so instead.
+   if (m_impl->Writer && m_impl->Writer->isAcceptingRecords())
+      m_impl->Writer->reopen();
+   else
+      m_impl->closeLogFile();
 
 #ifndef _WIN32
    if (in_refreshParams.newUser)
@@ -607,6 +1290,27 @@ void FileLogDestination::writeLog(LogLevel in_logLevel, const std::string& in_me
    if (in_logLevel > m_logLevel)
       return;
 
+   // In asynchronous mode the message is queued for the writer thread. A forked child doesn't have the writer thread,
+   // and neither does a process which is shutting down, so they fall back to writing synchronously.
+   if (m_impl->Writer && m_impl->Writer->isAcceptingRecords())
+   {
+      try
+      {
+#ifndef _WIN32
+         if (in_logLevel <= LogLevel::WARN && m_impl->SyslogDest)
+            m_impl->SyslogDest->writeLog(in_logLevel, in_message);
+#endif
+
+         m_impl->Writer->enqueue(in_message);
+      }
+      catch (...)
+      {
+         // Swallow exceptions because we'd trigger recursive logging otherwise.
+      }
+
+      return;
+   }
+
    // Lock the mutex before attempting to write.
    try
    {
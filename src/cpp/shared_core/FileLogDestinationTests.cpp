@@ -0,0 +1,267 @@
+/*
+ * FileLogDestinationTests.cpp
+ *
+ * Copyright (C) 2022 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant to the terms of a commercial license agreement
+ * with Posit, then this program is licensed to you under the following terms:
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include <tests/TestThat.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+#include <boost/thread.hpp>
+
+#include <shared_core/FileLogDestination.hpp>
+#include <shared_core/SafeConvert.hpp>
+
+namespace rstudio {
+namespace core {
+namespace log {
+namespace {
+
+FilePath createLogDir()
+{
+   FilePath logDir;
+   REQUIRE_FALSE(FilePath::tempFilePath(logDir));
+   REQUIRE_FALSE(logDir.ensureDirectory());
+   return logDir;
+}
+
+FileLogOptions asyncOptions(const FilePath& in_logDir)
+{
+   FileLogOptions options(in_logDir, false);
+   options.setAsyncWrites(true);
+   return options;
+}
+
+std::vector<std::string> readLines(const FilePath& in_file)
+{
+   std::vector<std::string> lines;
+   std::ifstream stream(in_file.getAbsolutePath());
+   std::string line;
+   while (std::getline(stream, line))
+      lines.push_back(line);
+   return lines;
+}
+
+std::string record(int in_thread, int in_index)
+{
+   return "thread " + safe_convert::numberToString(in_thread) + " message " +
+      safe_convert::numberToString(in_index) + "\n";
+}
+
+// true if every record of every thread appears exactly once, in order within its thread
+bool hasAllRecords(const std::vector<std::string>& in_lines, int in_threads, int in_records)
+{
+   std::map<int, int> next;
+   for (const std::string& line : in_lines)
+   {
+      int thread = -1, index = -1;
+      if (std::sscanf(line.c_str(), "thread %d message %d", &thread, &index) != 2)
+         continue;
+      if (next[thread] != index)
+         return false;
+      next[thread]++;
+   }
+
+   for (int i = 0; i < in_threads; i++)
+   {
+      if (next[i] != in_records)
+         return false;
+   }
+   return true;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Asynchronous file log destination")
+{
+   SECTION("Messages from many threads are written")
+   {
+      FilePath logDir = createLogDir();
+      FileLogDestination dest("async", LogLevel::DEBUG, LogMessageFormatType::PRETTY, "test", asyncOptions(logDir));
+
+      boost::thread_group threads;
+      for (int t = 0; t < 4; t++)
+      {
+         threads.create_thread([&dest, t]()
+         {
+            for (int i = 0; i < 500; i++)
+               dest.writeLog(LogLevel::INFO, record(t, i));
+         });
+      }
+      threads.join_all();
+      dest.flush();
+
+      REQUIRE(dest.droppedMessageCount() == 0);
+      REQUIRE(hasAllRecords(readLines(FilePath(dest.path())), 4, 500));
+
+      logDir.remove();
+   }
+
+   SECTION("Logs are rotated without checking the file size on each write")
+   {
+      FilePath logDir = createLogDir();
+      FileLogOptions options = asyncOptions(logDir);
+      options.setMaxSizeMb(0.01);
+      FileLogDestination dest("async", LogLevel::DEBUG, LogMessageFormatType::PRETTY, "test", options);
+
+      std::string message(1023, 'x');
+      message += "\n";
+      for (int i = 0; i < 32; i++)
+      {
+         dest.writeLog(LogLevel::INFO, message);
+         dest.flush();
+      }
+
+      REQUIRE(logDir.completeChildPath("test.1.log").exists());
+      REQUIRE(FilePath(dest.path()).getSize() <= 11 * 1024);
+
+      logDir.remove();
+   }
+
+   SECTION("Messages queued at exit are written")
+   {
+      FilePath logDir = createLogDir();
+      FilePath logFile;
+      {
+         FileLogDestination dest("async", LogLevel::DEBUG, LogMessageFormatType::PRETTY, "test", asyncOptions(logDir));
+         logFile = FilePath(dest.path());
+         for (int i = 0; i < 100; i++)
+            dest.writeLog(LogLevel::INFO, record(0, i));
+      }
+
+      REQUIRE(hasAllRecords(readLines(logFile), 1, 100));
+
+      logDir.remove();
+   }
+
+   SECTION("Messages queued at shutdown are written, and later ones synchronously")
+   {
+      FilePath logDir = createLogDir();
+      FileLogDestination dest("async", LogLevel::DEBUG, LogMessageFormatType::PRETTY, "test", asyncOptions(logDir));
+      for (int i = 0; i < 100; i++)
+         dest.writeLog(LogLevel::INFO, record(0, i));
+
+      shutdown();
+      REQUIRE(hasAllRecords(readLines(FilePath(dest.path())), 1, 100));
+
+      dest.writeLog(LogLevel::INFO, record(1, 0));
+      std::vector<std::string> lines = readLines(FilePath(dest.path()));
+      REQUIRE(lines.size() == 101);
+      REQUIRE(lines.back() + "\n" == record(1, 0));
+
+      logDir.remove();
+   }
+
+   SECTION("Crash flushing writes each queued message once")
+   {
+      FilePath logDir = createLogDir();
+      FileLogDestination dest("async", LogLevel::DEBUG, LogMessageFormatType::PRETTY, "test", asyncOptions(logDir));
+
+      for (int i = 0; i < 100; i++)
+         dest.writeLog(LogLevel::INFO, record(0, i));
+      FileLogDestination::flushOnCrash();
+      dest.flush();
+
+      REQUIRE(hasAllRecords(readLines(FilePath(dest.path())), 1, 100));
+
+      logDir.remove();
+   }
+
+   SECTION("Dropped messages are counted and reported")
+   {
+      FilePath logDir = createLogDir();
+      FileLogOptions options = asyncOptions(logDir);
+      options.setDoRotation(false);
+      FileLogDestination dest("async", LogLevel::DEBUG, LogMessageFormatType::PRETTY, "test", options);
+
+      // large enough to exceed the queue's memory bound faster than the writer can keep up
+      std::string message(1024 * 1024, 'x');
+      message += "\n";
+      for (int i = 0; i < 64; i++)
+         dest.writeLog(LogLevel::INFO, message);
+      dest.flush();
+      dest.writeLog(LogLevel::INFO, record(0, 0));
+      dest.flush();
+
+      std::vector<std::string> lines = readLines(FilePath(dest.path()));
+      uint64_t written = 0;
+      bool reported = false;
+      for (const std::string& line : lines)
+      {
+         if (line.size() == message.size() - 1)
+            written++;
+         else if (line.find("log messages were dropped") != std::string::npos)
+            reported = true;
+      }
+
+      REQUIRE(written + dest.droppedMessageCount() == 64);
+      REQUIRE(reported == (dest.droppedMessageCount() > 0));
+
+      logDir.remove();
+   }
+}
+
+benchmark_context("File log destination")
+{
+   FilePath logDir = createLogDir();
+   FileLogOptions syncOptions(logDir, false);
+   syncOptions.setDoRotation(false);
+   FileLogOptions options = asyncOptions(logDir);
+   options.setDoRotation(false);
+
+   FileLogDestination syncDest("sync", LogLevel::DEBUG, LogMessageFormatType::PRETTY, "sync", syncOptions);
+   FileLogDestination asyncDest("async", LogLevel::DEBUG, LogMessageFormatType::PRETTY, "async", options);
+
+   auto logFromThreads = [](FileLogDestination& dest)
+   {
+      boost::thread_group threads;
+      for (int t = 0; t < 4; t++)
+      {
+         threads.create_thread([&dest, t]()
+         {
+            for (int i = 0; i < 250; i++)
+               dest.writeLog(LogLevel::INFO, record(t, i));
+         });
+      }
+      threads.join_all();
+      return threads.size();
+   };
+
+   benchmark_that("1000 messages from 4 threads, synchronous")
+   {
+      return logFromThreads(syncDest);
+   };
+
+   benchmark_that("1000 messages from 4 threads, asynchronous")
+   {
+      size_t result = logFromThreads(asyncDest);
+      asyncDest.flush();
+      return result;
+   };
+
+   logDir.remove();
+}
+
+} // namespace log
+} // namespace core
+} // namespace rstudio
@@ -722,6 +722,11 @@ bool isLogLevel(LogLevel in_logLevel)
    return logger().MaxLogLevel >= in_logLevel;
 }
 
+void shutdown()
+{
+   FileLogDestination::stopAsyncWrites();
+}
+
 void refreshAllLogDestinations(const log::RefreshParams& in_refreshParams)
 {
    Logger& log = logger();
@@ -26,6 +26,7 @@
 
 #include "ILogDestination.hpp"
 
+#include <cstdint>
 #include <string>
 
 #include "PImpl.hpp"
@@ -74,6 +75,7 @@ public:
     * @param in_includePid        Whether to include the PID of the process in the log filename.
     * @param in_warnSyslog        Whether or not to also send warn/error logs to syslog for admin visibility.
     * @param in_forceLogDirectory Whether or not the log directory is forced, preventing user override.
+    * @param in_asyncWrites       Whether or not log messages should be queued and written by a background thread.
     */
    FileLogOptions(
       FilePath in_directory,
@@ -85,7 +87,15 @@ public:
       bool in_doRotation,
       bool in_includePid,
       bool in_warnSyslog,
-      bool in_forceLogDirectory);
+      bool in_forceLogDirectory,
+      bool in_asyncWrites = s_defaultAsyncWrites);
+
+   /**
+    * @brief Returns whether or not log messages are queued and written to the file by a background thread.
+    *
+    * @return True if log messages are written asynchronously; false otherwise.
+    */
+   bool asyncWrites() const;
 
    /**
     * @brief Gets the number of days a rotated log file should persist before being deleted.
@@ -157,6 +167,13 @@ public:
     */
    bool warnSyslog() const;
 
+   /**
+    * @brief Sets whether or not log messages are queued and written to the file by a background thread.
+    *
+    * @param in_asyncWrites    Whether or not log messages should be written asynchronously.
+    */
+   void setAsyncWrites(bool in_asyncWrites);
+
    /**
     * @brief Sets the number of days a rotated log file should persist before being deleted.
     *
@@ -242,6 +259,7 @@ private:
    static constexpr bool s_defaultIncludePid = false;
    static constexpr bool s_defaultWarnSyslog = true;
    static constexpr bool s_defaultForceDirectory = false;
+   static constexpr bool s_defaultAsyncWrites = false;
 
    // The directory where log files should be written.
    FilePath m_directory;
@@ -272,6 +290,9 @@ private:
 
    // Whether or not to force the directory to prevent user override.
    bool m_forceDirectory;
+
+   // Whether to queue log messages and write them from a background thread.
+   bool m_asyncWrites;
 };
 
 /**
@@ -308,6 +329,37 @@ public:
     */
    ~FileLogDestination() override;
 
+   /**
+    * @brief Returns the number of log messages which were discarded because too many messages were waiting to be
+    *        written asynchronously.
+    *
+    * @return The number of discarded log messages, which is always 0 if asynchronous writes are not enabled.
+    */
+   uint64_t droppedMessageCount() const;
+
+   /**
+    * @brief Writes all log messages which are waiting to be written asynchronously. Does nothing if asynchronous
+    *        writes are not enabled.
+    */
+   void flush();
+
+   /**
+    * @brief Stops the background thread of every asynchronous file log destination, after writing out the messages
+    *        which are waiting to be written. Messages logged afterwards are written synchronously.
+    *
+    * This is called when the process exits, and may be called earlier by processes which exit without running exit
+    * handlers.
+    */
+   static void stopAsyncWrites();
+
+   /**
+    * @brief Makes a best effort to write out the queued messages of every asynchronous file log destination.
+    *
+    * This is intended to be called from a crash handler, so it does not wait on any locks or allocate memory.
+    * Messages which are being written by the background thread at the time of the call may be lost.
+    */
+   static void flushOnCrash();
+
    /**
     * @brief Returns the log destination.
     */
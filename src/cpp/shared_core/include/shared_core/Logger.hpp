@@ -407,6 +407,13 @@ void logInfoMessage(const std::string& in_message,
  */
 void logPassthroughMessage(const std::string& in_source, const std::string& in_message);
 
+/**
+ * @brief Writes out the log messages which are waiting to be written by background threads and stops those threads.
+ *        Messages logged afterwards are written synchronously. This happens automatically when the process exits
+ *        normally, so it only needs to be called by processes which may exit otherwise (e.g. by re-raising a signal).
+ */
+void shutdown();
+
 /**
  * @brief Refreshes all log destinations. May be used after fork to prevent stale file handles.
  *
@@ -49,6 +49,7 @@ namespace json {
 
 class Array;
 class Object;
+class Writer;
 
 typedef std::vector<std::pair<std::string, std::string> > StringPairList;
 typedef std::map<std::string, std::vector<std::string> > StringListMap;
@@ -86,6 +87,8 @@ protected:
    typedef std::shared_ptr<Impl> ValueImplPtr;
 
    friend class Array;
+   friend class Object;
+   friend class Writer;
 
 public:
    /**
@@ -673,6 +676,15 @@ public:
    void writeFormatted(std::ostream& io_ostream) const;
 
 private:
+   /**
+    * @brief Checks whether the contents of this value may be moved into another value. This is only the case when
+    *        no other value refers to the same JSON document (e.g. the value was not returned by getArray(),
+    *        getObject() or Object::operator[]), since moving would otherwise modify those values as well.
+    *
+    * @return True if the contents of this value may be moved; false otherwise.
+    */
+   bool isMovable() const;
+
    /**
     * @brief Moves the provided value into this value.
     *
@@ -1040,6 +1052,15 @@ public:
     */
    void insert(const std::string& in_name, const Value& in_value);
 
+   /**
+    * @brief Inserts the specified member into this JSON object, moving rather than copying the contents of the value
+    *        when no other value refers to them. If an object with the same name already exists, it will be overridden.
+    *
+    * @param in_name        The name of the JSON value to insert.
+    * @param in_value       The value to insert.
+    */
+   void insert(const std::string& in_name, Value&& in_value);
+
    /**
     * @brief Inserts the specified member into this JSON object. If an object with the same name already exists, it will be
     *        overridden.
@@ -1130,6 +1151,15 @@ public:
     */
    void insert(const std::string& in_name, const Array& in_value);
 
+   /**
+    * @brief Inserts the specified member into this JSON object, moving rather than copying the contents of the value
+    *        when no other value refers to them. If an object with the same name already exists, it will be overridden.
+    *
+    * @param in_name        The name of the JSON value to insert.
+    * @param in_value       The value to insert.
+    */
+   void insert(const std::string& in_name, Array&& in_value);
+
    /**
     * @brief Inserts the specified member into this JSON object. If an object with the same name already exists, it will be
     *        overridden.
@@ -1139,6 +1169,15 @@ public:
     */
    void insert(const std::string& in_name, const Object& in_value);
 
+   /**
+    * @brief Inserts the specified member into this JSON object, moving rather than copying the contents of the value
+    *        when no other value refers to them. If an object with the same name already exists, it will be overridden.
+    *
+    * @param in_name        The name of the JSON value to insert.
+    * @param in_value       The value to insert.
+    */
+   void insert(const std::string& in_name, Object&& in_value);
+
    /**
     * @brief Inserts the specified member into this JSON object. If an object with the same name already exists, it will be
     *        overridden.
@@ -1494,6 +1533,14 @@ public:
     */
    void push_back(const Value& in_value);
 
+   /**
+    * @brief Pushes the value onto the end of the JSON array, moving rather than copying its contents when no other
+    *        value refers to them.
+    *
+    * @param in_value   The value to push onto the end of the JSON array.
+    */
+   void push_back(Value&& in_value);
+
    /**
     * @brief Pushes the value onto the end of the JSON array.
     *
@@ -1594,6 +1641,14 @@ public:
     */
    void push_back(const Array& in_value);
 
+   /**
+    * @brief Pushes the value onto the end of the JSON array, moving rather than copying its contents when no other
+    *        value refers to them.
+    *
+    * @param in_value   The value to push onto the end of the JSON array.
+    */
+   void push_back(Array&& in_value);
+
    /**
     * @brief Pushes the value onto the end of the JSON array.
     *
@@ -1604,6 +1659,14 @@ public:
     */
    void push_back(const Object& in_value);
 
+   /**
+    * @brief Pushes the value onto the end of the JSON array, moving rather than copying its contents when no other
+    *        value refers to them.
+    *
+    * @param in_value   The value to push onto the end of the JSON array.
+    */
+   void push_back(Object&& in_value);
+
    /**
     * @brief Converts this JSON array to a set of strings.
     *
@@ -1651,6 +1714,143 @@ private:
    friend class Value;
 };
 
+/**
+ * @brief Class which writes JSON incrementally (as a stream of events such as the start of an object, a key or a
+ *        scalar value) rather than from a fully constructed JSON Value. Output is buffered until it is taken by the
+ *        caller, so large documents may be written without holding all of their contents in memory.
+ *
+ * The caller is responsible for emitting a well formed sequence of events (e.g. a key before each member value of an
+ * object).
+ */
+class Writer
+{
+public:
+   /**
+    * @brief Constructor.
+    */
+   Writer();
+
+   /**
+    * @brief Begins writing a JSON object.
+    */
+   void beginObject();
+
+   /**
+    * @brief Ends the JSON object which is currently being written.
+    */
+   void endObject();
+
+   /**
+    * @brief Begins writing a JSON array.
+    */
+   void beginArray();
+
+   /**
+    * @brief Ends the JSON array which is currently being written.
+    */
+   void endArray();
+
+   /**
+    * @brief Writes the name of the next member of the JSON object which is currently being written.
+    *
+    * @param in_name    The name of the member.
+    */
+   void key(const std::string& in_name);
+
+   /**
+    * @brief Writes a JSON null value.
+    */
+   void nullValue();
+
+   /**
+    * @brief Writes a JSON value.
+    *
+    * @param in_value   The value to write.
+    */
+   void value(bool in_value);
+
+   /**
+    * @brief Writes a JSON value.
+    *
+    * @param in_value   The value to write.
+    */
+   void value(double in_value);
+
+   /**
+    * @brief Writes a JSON value.
+    *
+    * @param in_value   The value to write.
+    */
+   void value(int in_value);
+
+   /**
+    * @brief Writes a JSON value.
+    *
+    * @param in_value   The value to write.
+    */
+   void value(int64_t in_value);
+
+   /**
+    * @brief Writes a JSON value.
+    *
+    * @param in_value   The value to write.
+    */
+   void value(unsigned int in_value);
+
+   /**
+    * @brief Writes a JSON value.
+    *
+    * @param in_value   The value to write.
+    */
+   void value(uint64_t in_value);
+
+   /**
+    * @brief Writes a JSON value.
+    *
+    * @param in_value   The value to write.
+    */
+   void value(const char* in_value);
+
+   /**
+    * @brief Writes a JSON value.
+    *
+    * @param in_value   The value to write.
+    */
+   void value(const std::string& in_value);
+
+   /**
+    * @brief Writes a JSON value, including all of its children.
+    *
+    * @param in_value   The value to write.
+    */
+   void value(const Value& in_value);
+
+   /**
+    * @brief Gets the number of bytes which have been written but not yet taken.
+    *
+    * @return The number of buffered bytes.
+    */
+   size_t getBufferedSize() const;
+
+   /**
+    * @brief Checks whether a complete JSON value has been written (i.e. all objects and arrays have been ended).
+    *
+    * @return True if a complete JSON value has been written; false otherwise.
+    */
+   bool isComplete() const;
+
+   /**
+    * @brief Takes the buffered output, leaving the buffer empty.
+    *
+    * @return The output which has been written since the buffer was last taken.
+    */
+   std::string takeBuffer();
+
+private:
+   // The private implementation of Writer.
+   PRIVATE_IMPL(m_impl);
+};
+
 /**
  * @brief Checks whether the specified JSON value is of the type specified in the template parameter.
  *
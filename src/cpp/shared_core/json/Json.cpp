@@ -148,6 +148,29 @@ namespace {
 
 rapidjson::CrtAllocator s_allocator;
 
+// rapidjson grows objects and arrays by at least half again (and to at least 16 entries), whereas a copy allocates
+// only what's used; a value moved into a container gives up that spare capacity first so that it takes no more
+// memory than a copy would (its members and elements keep theirs, but those were compacted as they were moved in)
+void shrinkToFit(JsonValue& io_value)
+{
+   if (io_value.IsObject() && (io_value.MemberCapacity() > io_value.MemberCount()))
+   {
+      JsonValue compacted(rapidjson::kObjectType);
+      compacted.MemberReserve(io_value.MemberCount(), s_allocator);
+      for (JsonValue::MemberIterator itr = io_value.MemberBegin(); itr != io_value.MemberEnd(); ++itr)
+         compacted.AddMember(itr->name, itr->value, s_allocator);
+      io_value = compacted;
+   }
+   else if (io_value.IsArray() && (io_value.Capacity() > io_value.Size()))
+   {
+      JsonValue compacted(rapidjson::kArrayType);
+      compacted.Reserve(io_value.Size(), s_allocator);
+      for (JsonValue::ValueIterator itr = io_value.Begin(); itr != io_value.End(); ++itr)
+         compacted.PushBack(*itr, s_allocator);
+      io_value = compacted;
+   }
+}
+
 Object getSchemaDefaults(const Object& schema)
 {
    Object result;
@@ -826,6 +849,13 @@ void Value::move(Value&& in_other)
    static_cast<JsonValue&>(*m_impl->Document) = static_cast<JsonValue&>(*in_other.m_impl->Document);
 }
 
+bool Value::isMovable() const
+{
+   // values returned by getArray(), getObject() and Object::operator[] share either this implementation or (via an
+   // aliasing pointer) the document of their parent
+   return (m_impl.use_count() == 1) && (m_impl->Document.use_count() == 1);
+}
+
 // Object Member =======================================================================================================
 struct Object::Member::Impl
 {
@@ -1023,7 +1053,7 @@ Value Object::operator[](const char* in_name)
    JsonDocument& doc = *m_impl->Document;
    if (!doc.HasMember(in_name))
    {
-      doc.AddMember(JsonValue(in_name, s_allocator), JsonDocument(), s_allocator);
+      doc.AddMember(JsonValue(in_name, s_allocator), JsonValue(), s_allocator);
    }
 
    JsonDocument& docRef = static_cast<JsonDocument&>(doc.FindMember(in_name)->value);
@@ -1112,59 +1142,80 @@ void Object::insert(const std::string& in_name, const Value& in_value)
    (*this)[in_name] = in_value;
 }
 
+void Object::insert(const std::string& in_name, Value&& in_value)
+{
+   if (in_value.isMovable())
+   {
+      shrinkToFit(*in_value.m_impl->Document);
+      (*this)[in_name] = std::move(in_value);
+   }
+   else
+      (*this)[in_name] = static_cast<const Value&>(in_value);
+}
+
 void Object::insert(const std::string& in_name, bool in_value)
 {
-   insert(in_name, json::Value(in_value));
+   (*this)[in_name] = in_value;
 }
 
 void Object::insert(const std::string& in_name, double in_value)
 {
-   insert(in_name, json::Value(in_value));
+   (*this)[in_name] = in_value;
 }
 
 void Object::insert(const std::string& in_name, float in_value)
 {
-   insert(in_name, json::Value(in_value));
+   (*this)[in_name] = in_value;
 }
 
 void Object::insert(const std::string& in_name, int in_value)
 {
-   insert(in_name, json::Value(in_value));
+   (*this)[in_name] = in_value;
 }
 
 void Object::insert(const std::string& in_name, int64_t in_value)
 {
-   insert(in_name, json::Value(in_value));
+   (*this)[in_name] = in_value;
 }
 
 void Object::insert(const std::string& in_name, const char* in_value)
 {
-   insert(in_name, json::Value(in_value));
+   (*this)[in_name] = in_value;
 }
 
 void Object::insert(const std::string& in_name, const std::string& in_value)
 {
-   insert(in_name, json::Value(in_value));
+   (*this)[in_name] = in_value;
 }
 
 void Object::insert(const std::string& in_name, unsigned int in_value)
 {
-   insert(in_name, json::Value(in_value));
+   (*this)[in_name] = in_value;
 }
 
 void Object::insert(const std::string& in_name, uint64_t in_value)
 {
-   insert(in_name, json::Value(in_value));
+   (*this)[in_name] = in_value;
 }
 
 void Object::insert(const std::string& in_name, const Array& in_value)
 {
-   insert(in_name, json::Value(in_value));
+   insert(in_name, static_cast<const Value&>(in_value));
+}
+
+void Object::insert(const std::string& in_name, Array&& in_value)
+{
+   insert(in_name, static_cast<Value&&>(in_value));
 }
 
 void Object::insert(const std::string& in_name, const Object& in_value)
 {
-   insert(in_name, json::Value(in_value));
+   insert(in_name, static_cast<const Value&>(in_value));
+}
+
+void Object::insert(const std::string& in_name, Object&& in_value)
+{
+   insert(in_name, static_cast<Value&&>(in_value));
 }
 
 void Object::insert(const Member& in_member)
@@ -1446,64 +1497,84 @@ Error Array::parse(const std::string& in_jsonStr)
 
 void Array::push_back(const Value& in_value)
 {
-   JsonDocument doc;
-   doc.CopyFrom(*in_value.m_impl->Document, s_allocator);
-   m_impl->Document->PushBack(doc, s_allocator);
+   JsonValue value(*in_value.m_impl->Document, s_allocator);
+   m_impl->Document->PushBack(value, s_allocator);
+}
+
+void Array::push_back(Value&& in_value)
+{
+   if (in_value.isMovable())
+   {
+      shrinkToFit(*in_value.m_impl->Document);
+      m_impl->Document->PushBack(static_cast<JsonValue&>(*in_value.m_impl->Document), s_allocator);
+   }
+   else
+      push_back(static_cast<const Value&>(in_value));
 }
 
 void Array::push_back(bool in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value), s_allocator);
 }
 
 void Array::push_back(double in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value), s_allocator);
 }
 
 void Array::push_back(float in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value), s_allocator);
 }
 
 void Array::push_back(int in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value), s_allocator);
 }
 
 void Array::push_back(int64_t in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value), s_allocator);
 }
 
-void Array::push_back(const char* in_value)
+void Array::push_back(unsigned int in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value), s_allocator);
 }
 
-void Array::push_back(const std::string& in_value)
+void Array::push_back(uint64_t in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value), s_allocator);
 }
 
-void Array::push_back(unsigned int in_value)
+void Array::push_back(const char* in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value, s_allocator), s_allocator);
 }
 
-void Array::push_back(uint64_t in_value)
+void Array::push_back(const std::string& in_value)
 {
-   push_back(json::Value(in_value));
+   m_impl->Document->PushBack(JsonValue(in_value.c_str(), s_allocator), s_allocator);
 }
 
 void Array::push_back(const json::Array& in_value)
 {
-   push_back(json::Value(in_value));
+   push_back(static_cast<const Value&>(in_value));
+}
+
+void Array::push_back(json::Array&& in_value)
+{
+   push_back(static_cast<Value&&>(in_value));
 }
 
 void Array::push_back(const json::Object& in_value)
 {
-   push_back(json::Value(in_value));
+   push_back(static_cast<const Value&>(in_value));
+}
+
+void Array::push_back(json::Object&& in_value)
+{
+   push_back(static_cast<Value&&>(in_value));
 }
 
 bool Array::toSetString(std::set<std::string>& out_set) const
@@ -1591,6 +1662,120 @@ Array::Array(ValueImplPtr in_value)
    assert(m_impl->Document->IsArray());
 }
 
+// Writer ==============================================================================================================
+struct Writer::Impl
+{
+   Impl() :
+      JsonWriter(Buffer)
+   {
+   }
+
+   rapidjson::StringBuffer Buffer;
+   rapidjson::Writer<rapidjson::StringBuffer> JsonWriter;
+};
+
+PRIVATE_IMPL_DELETER_IMPL(Writer)
+
+Writer::Writer() :
+   m_impl(new Impl())
+{
+}
+
+void Writer::beginObject()
+{
+   m_impl->JsonWriter.StartObject();
+}
+
+void Writer::endObject()
+{
+   m_impl->JsonWriter.EndObject();
+}
+
+void Writer::beginArray()
+{
+   m_impl->JsonWriter.StartArray();
+}
+
+void Writer::endArray()
+{
+   m_impl->JsonWriter.EndArray();
+}
+
+void Writer::key(const std::string& in_name)
+{
+   m_impl->JsonWriter.Key(in_name.c_str(), static_cast<rapidjson::SizeType>(in_name.size()));
+}
+
+void Writer::nullValue()
+{
+   m_impl->JsonWriter.Null();
+}
+
+void Writer::value(bool in_value)
+{
+   m_impl->JsonWriter.Bool(in_value);
+}
+
+void Writer::value(double in_value)
+{
+   m_impl->JsonWriter.Double(in_value);
+}
+
+void Writer::value(int in_value)
+{
+   m_impl->JsonWriter.Int(in_value);
+}
+
+void Writer::value(int64_t in_value)
+{
+   m_impl->JsonWriter.Int64(in_value);
+}
+
+void Writer::value(unsigned int in_value)
+{
+   m_impl->JsonWriter.Uint(in_value);
+}
+
+void Writer::value(uint64_t in_value)
+{
+   m_impl->JsonWriter.Uint64(in_value);
+}
+
+void Writer::value(const char* in_value)
+{
+   m_impl->JsonWriter.String(in_value);
+}
+
+void Writer::value(const std::string& in_value)
+{
+   m_impl->JsonWriter.String(in_value.c_str(), static_cast<rapidjson::SizeType>(in_value.size()));
+}
+
+void Writer::value(const Value& in_value)
+{
+   in_value.m_impl->Document->Accept(m_impl->JsonWriter);
+}
+
+size_t Writer::getBufferedSize() const
+{
+   return m_impl->Buffer.GetSize();
+}
+
+bool Writer::isComplete() const
+{
+   return m_impl->JsonWriter.IsComplete();
+}
+
+std::string Writer::takeBuffer()
+{
+   std::string output(m_impl->Buffer.GetString(), m_impl->Buffer.GetSize());
+
+   // clearing the buffer retains its capacity, so a writer which is drained regularly only ever holds about one
+   // buffer's worth of output
+   m_impl->Buffer.Clear();
+   return output;
+}
+
 // Free functions ======================================================================================================
 std::string typeAsString(Type in_type)
 {
@@ -1081,6 +1081,121 @@ TEST_CASE("Json")
       CHECK((json::readObject(obj, "intArr", badIntSet) && badIntSet.empty()));
       CHECK((json::readObject(obj, "intArr", badOptIntSet) && !!(badOptIntSet == boost::none)));
    }
+
+   SECTION("Inserting temporaries moves their contents")
+   {
+      json::Array inner;
+      inner.push_back(1);
+      inner.push_back("two");
+
+      json::Object obj;
+      obj.insert("inner", std::move(inner));
+      CHECK(inner.isNull());
+      REQUIRE(obj["inner"].isArray());
+      CHECK(obj["inner"].getArray().getSize() == 2);
+
+      json::Array arr;
+      arr.push_back(std::move(obj));
+      CHECK(obj.isNull());
+      REQUIRE(arr.getSize() == 1);
+      CHECK(arr[0].getObject()["inner"].getArray()[1].getString() == "two");
+   }
+
+   SECTION("Inserting temporaries which refer to other values copies them")
+   {
+      json::Object source = createObject();
+      std::string expected = source.write();
+
+      // getArray(), getObject() and operator[] return values which share their document with the source
+      json::Object obj;
+      obj.insert("g", source["g"].getArray());
+      obj.insert("h", source["h"]);
+
+      json::Array arr;
+      arr.push_back(source.getObject());
+      arr.push_back(source["g"]);
+
+      CHECK(source.write() == expected);
+      CHECK(obj["g"].getArray().getSize() == 3);
+      CHECK(arr[0].write() == expected);
+      CHECK(arr[1].getArray()[2].getInt() == 300);
+   }
+
+   SECTION("Writer produces the same output as values")
+   {
+      json::Object object = createObject();
+
+      json::Writer writer;
+      writer.beginObject();
+      writer.key("value");
+      writer.value(object);
+      writer.key("scalars");
+      writer.beginArray();
+      writer.value(true);
+      writer.value(-5);
+      writer.value((uint64_t) 18446744073709550615U);
+      writer.value(246.9);
+      writer.value("a string");
+      writer.nullValue();
+      writer.endArray();
+      CHECK_FALSE(writer.isComplete());
+
+      // output may be taken at any point
+      std::string output = writer.takeBuffer();
+      CHECK(writer.getBufferedSize() == 0);
+
+      writer.endObject();
+      CHECK(writer.isComplete());
+      output += writer.takeBuffer();
+
+      json::Object expected;
+      expected["value"] = object;
+      json::Array scalars;
+      scalars.push_back(true);
+      scalars.push_back(-5);
+      scalars.push_back((uint64_t) 18446744073709550615U);
+      scalars.push_back(246.9);
+      scalars.push_back("a string");
+      scalars.push_back(json::Value());
+      expected["scalars"] = scalars;
+
+      CHECK(output == expected.write());
+   }
+}
+
+benchmark_context("Json array building")
+{
+   const int kElements = 100000;
+
+   auto createElement = [](int i)
+   {
+      json::Object element;
+      element["name"] = "element" + std::to_string(i);
+      element["index"] = i;
+      element["visible"] = (i % 2) == 0;
+      return element;
+   };
+
+   benchmark_that("Build and serialize array (copying elements)")
+   {
+      json::Array array;
+      for (int i = 0; i < kElements; ++i)
+      {
+         json::Object element = createElement(i);
+         array.push_back(element);
+      }
+
+      return array.write().size();
+   };
+
+   benchmark_that("Build and serialize array (moving elements)")
+   {
+      json::Array array;
+      for (int i = 0; i < kElements; ++i)
+         array.push_back(createElement(i));
+
+      return array.write().size();
+   };
 }
 
 } // end namespace tests
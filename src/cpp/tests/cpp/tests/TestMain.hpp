@@ -21,6 +21,7 @@
 #define TESTS_TESTMAIN_HPP
 
 #define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
 #include "vendor/catch.hpp"
 
 #endif
@@ -22,6 +22,7 @@
 #ifdef RSTUDIO_UNIT_TESTS_ENABLED
 
 # define CATCH_CONFIG_RUNNER
+# define CATCH_CONFIG_ENABLE_BENCHMARKING
 # include "vendor/catch.hpp"
 
 #endif
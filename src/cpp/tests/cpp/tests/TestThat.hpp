@@ -18,6 +18,7 @@
 
 #ifdef RSTUDIO_UNIT_TESTS_ENABLED
 
+# define CATCH_CONFIG_ENABLE_BENCHMARKING
 # include "vendor/catch.hpp"
 
 # ifndef RSTUDIO_NO_TESTTHAT_ALIASES
@@ -28,6 +29,11 @@
 #  define expect_false(x) CHECK_FALSE((x))
 #  define expect_equal(x,y) REQUIRE((x) == (y))
 
+// benchmarks are hidden by default; run them explicitly with e.g.
+// 'rstudio-core-tests [benchmark]'
+#  define benchmark_context(__X__, ...) TEST_CASE(__X__, "[.][benchmark]")
+#  define benchmark_that(__X__) BENCHMARK(__X__)
+
 # endif
 
 #else
@@ -38,6 +44,8 @@
 #  define test_that(__X__) if (false)
 #  define expect_true(__X__)
 #  define expect_false(__X__)
+#  define benchmark_context(__X__, ...) void RSTUDIO_UNIT_TESTS_DISABLED_##__LINE__()
+#  define benchmark_that(__X__) [&]()
 
 # endif
 
@@ -58,7 +58,10 @@ public interface GitServerOperations extends VCSServerOperations
    void gitUnstage(ArrayList<String> paths,
                    ServerRequestCallback<Void> requestCallback);
 
+   // refresh re-reads the status of the whole working tree, rather than
+   // serving it from the session's status cache
    void gitAllStatus(
+         boolean refresh,
          ServerRequestCallback<AllStatus> requestCallback);
 
    void gitFullStatus(
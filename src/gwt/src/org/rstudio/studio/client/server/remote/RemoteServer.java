@@ -2720,9 +2720,10 @@ public class RemoteServer implements Server
    }
 
    @Override
-   public void gitAllStatus(ServerRequestCallback<AllStatus> requestCallback)
+   public void gitAllStatus(boolean refresh,
+                            ServerRequestCallback<AllStatus> requestCallback)
    {
-      sendRequest(RPC_SCOPE, GIT_ALL_STATUS, requestCallback);
+      sendRequest(RPC_SCOPE, GIT_ALL_STATUS, refresh, requestCallback);
    }
 
    @Override
@@ -3127,6 +3128,17 @@ public class RemoteServer implements Server
       return eventBus_;
    }
 
+   String getClientId()
+   {
+      return clientId_;
+   }
+
+   String getClientEventsPort()
+   {
+      SessionInfo sessionInfo = session_.getSessionInfo();
+      return sessionInfo != null ? sessionInfo.getClientEventsPort() : "";
+   }
+
    RpcRequest getEvents(
                   int lastEventId,
                   ServerRequestCallback<JsArray<ClientEvent>> requestCallback,
@@ -0,0 +1,198 @@
+/*
+ * RemoteServerEventChannel.java
+ *
+ * Copyright (C) 2026 by Posit Software, PBC
+ *
+ * Unless you have received this program directly from Posit Software pursuant
+ * to the terms of a commercial license agreement with Posit Software, then
+ * this program is licensed to you under the terms of version 3 of the
+ * GNU Affero General Public License. This program is distributed WITHOUT
+ * ANY EXPRESS OR IMPLIED WARRANTY, INCLUDING THOSE OF NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FITNESS FOR A PARTICULAR PURPOSE. Please refer to the
+ * AGPL (http://www.gnu.org/licenses/agpl-3.0.txt) for more details.
+ *
+ */
+package org.rstudio.studio.client.server.remote;
+
+import com.google.gwt.core.client.GWT;
+import com.google.gwt.core.client.JsArray;
+import com.google.gwt.json.client.JSONArray;
+import com.google.gwt.json.client.JSONParser;
+import com.sksamuel.gwt.websockets.CloseEvent;
+import com.sksamuel.gwt.websockets.Websocket;
+import com.sksamuel.gwt.websockets.WebsocketListenerExt;
+
+import org.rstudio.core.client.Debug;
+import org.rstudio.studio.client.application.Desktop;
+import org.rstudio.studio.client.workbench.views.terminal.TerminalSocketPacket;
+
+/**
+ * Receives client events pushed by the session over a websocket (see
+ * ClientEventService in the session). Events arrive as a JSON array in
+ * the terminal socket packet format; the client acknowledges the id of
+ * the last event it has processed, which lets the session push more.
+ * Nothing is pushed until the first acknowledgement (sent on connect),
+ * which syncs event ids with the session; the session answers it with
+ * a first push (possibly empty), after which the channel is ready and
+ * long-polling is no longer needed.
+ */
+class RemoteServerEventChannel
+{
+   interface Listener
+   {
+      void onConnected();
+      void onReady();
+      void onEvents(JsArray<ClientEvent> events);
+      void onDisconnected();
+   }
+
+   RemoteServerEventChannel(Listener listener)
+   {
+      listener_ = listener;
+   }
+
+   public boolean isConnected()
+   {
+      return connected_;
+   }
+
+   public boolean isReady()
+   {
+      return ready_;
+   }
+
+   public void connect(String port, String clientId)
+   {
+      // give up on the channel after repeated failures (long-polling
+      // delivers events instead)
+      if (socket_ != null || failures_ >= kMaxFailures)
+         return;
+
+      if (port == null || port.isEmpty() || clientId == null || !Websocket.isSupported())
+         return;
+
+      String url = channelUrl(port, clientId);
+      if (url == null)
+         return;
+
+      // callbacks from a socket that has since been replaced are ignored
+      final Websocket socket = new Websocket(url);
+      socket_ = socket;
+      socket_.addListener(new WebsocketListenerExt()
+      {
+         @Override
+         public void onClose(CloseEvent event)
+         {
+            onDisconnected(socket);
+         }
+
+         @Override
+         public void onMessage(String msg)
+         {
+            if (socket_ != socket || TerminalSocketPacket.isKeepAlive(msg))
+               return;
+
+            JsArray<ClientEvent> events = parseEvents(TerminalSocketPacket.getMessage(msg));
+            if (events == null)
+               return;
+
+            if (!ready_)
+            {
+               ready_ = true;
+               listener_.onReady();
+            }
+            listener_.onEvents(events);
+         }
+
+         @Override
+         public void onOpen()
+         {
+            if (socket_ != socket)
+               return;
+
+            connected_ = true;
+            failures_ = 0;
+            listener_.onConnected();
+         }
+
+         @Override
+         public void onError()
+         {
+            if (socket_ != socket)
+               return;
+
+            failures_++;
+            onDisconnected(socket);
+         }
+      });
+      socket_.open();
+   }
+
+   public void acknowledge(int lastEventId)
+   {
+      if (connected_)
+         socket_.send(TerminalSocketPacket.textPacket(Integer.toString(lastEventId)));
+   }
+
+   public void close()
+   {
+      if (socket_ == null)
+         return;
+
+      Websocket socket = socket_;
+      onDisconnected(socket);
+      socket.close();
+   }
+
+   private void onDisconnected(Websocket socket)
+   {
+      if (socket_ == null || socket_ != socket)
+         return;
+
+      socket_ = null;
+      connected_ = false;
+      ready_ = false;
+      listener_.onDisconnected();
+   }
+
+   private static String channelUrl(String port, String clientId)
+   {
+      // for desktop talk directly to the websocket, otherwise go through
+      // the server via the /p proxy (as for terminal websockets)
+      String urlSuffix = port + "/events/" + clientId + "/";
+      if (Desktop.isDesktop())
+         return "ws://127.0.0.1:" + urlSuffix;
+
+      String url = GWT.getHostPageBaseURL();
+      if (url.startsWith("https:"))
+         return "wss:" + url.substring(6) + "p/" + urlSuffix;
+      else if (url.startsWith("http:"))
+         return "ws:" + url.substring(5) + "p/" + urlSuffix;
+      else
+         return null;
+   }
+
+   private static JsArray<ClientEvent> parseEvents(String json)
+   {
+      try
+      {
+         JSONArray events = JSONParser.parseStrict(json).isArray();
+         if (events == null)
+            return null;
+         return events.getJavaScriptObject().cast();
+      }
+      catch(Exception e)
+      {
+         Debug.logException(e);
+         return null;
+      }
+   }
+
+   private final Listener listener_;
+   private Websocket socket_;
+   private boolean connected_;
+   private boolean ready_;
+   private int failures_;
+
+   private static final int kMaxFailures = 3;
+}
@@ -61,6 +61,36 @@ class RemoteServerEventListener
       isListening_ = false;
       sessionWasQuit_ = false;
 
+      eventChannel_ = new RemoteServerEventChannel(new RemoteServerEventChannel.Listener()
+      {
+         @Override
+         public void onConnected()
+         {
+            eventChannel_.acknowledge(lastEventId_);
+         }
+
+         @Override
+         public void onReady()
+         {
+            // events are pushed from now on, so stop long-polling
+            cancelPolling();
+         }
+
+         @Override
+         public void onEvents(JsArray<ClientEvent> events)
+         {
+            onPushedEvents(events);
+         }
+
+         @Override
+         public void onDisconnected()
+         {
+            // fall back to long-polling
+            if (isListening_ && activeRequest_ == null)
+               listen();
+         }
+      });
+
       listenTimer_ = new Timer() {
          @Override
          public void run()
@@ -97,6 +127,7 @@ class RemoteServerEventListener
          public void onWindowClosing(ClosingEvent event)
          {
             stop();
+            eventChannel_.close();
          }
       });
    }
@@ -132,13 +163,23 @@ class RemoteServerEventListener
       
       // start listening
       listen();
+
+      // events are pushed over a websocket instead when the session offers
+      // one; long-polling is suspended while the channel is ready (events
+      // delivered by both around the switch are dispatched once, by id)
+      eventChannel_.connect(server_.getClientEventsPort(), server_.getClientId());
    }
      
    public void stop()
    {
-      listenTimer_.cancel();
       isListening_ = false;
       listenCount_ = 0;
+      cancelPolling();
+   }
+
+   private void cancelPolling()
+   {
+      listenTimer_.cancel();
       if (activeRequestCallback_ != null)
       {
          activeRequestCallback_.cancel();
@@ -245,8 +286,8 @@ class RemoteServerEventListener
    
    private void doListen()
    {  
-      // abort if we are no longer running
-      if (!isListening_)
+      // abort if we are no longer running (or events are being pushed)
+      if (!isListening_ || eventChannel_.isReady())
          return;
           
       // setup request callback (save reference for cancellation)
@@ -266,23 +307,8 @@ class RemoteServerEventListener
             try
             {
                // only process events if we are still listening
-               if (isListening_ && (events != null))
-               {
-                  for (int i=0; i<events.length(); i++)
-                  {
-                     // we can stop listening in the middle of dispatching
-                     // events (e.g. if we dispatch a Suicide event) so we 
-                     // need to check the listening_ flag before each event
-                     // is dispatched
-                     if (!isListening_)
-                        return;
-                     
-                     // dispatch event
-                     ClientEvent event = events.get(i);
-                     dispatchEvent(event);
-                     lastEventId_ = event.getId();
-                  }   
-               }
+               if (!processEvents(events))
+                  return;
             }
             // catch all here to make sure that in all cases we call
             // listen() again after processing
@@ -372,6 +398,54 @@ class RemoteServerEventListener
    }
    
    
+   // dispatches events not already seen; returns false if we stopped
+   // listening while dispatching
+   private boolean processEvents(JsArray<ClientEvent> events)
+   {
+      if (!isListening_ || events == null)
+         return true;
+
+      for (int i=0; i<events.length(); i++)
+      {
+         // we can stop listening in the middle of dispatching
+         // events (e.g. if we dispatch a Suicide event) so we
+         // need to check the listening_ flag before each event
+         // is dispatched
+         if (!isListening_)
+            return false;
+
+         // events can arrive both pushed and polled, so skip any
+         // we have already dispatched
+         ClientEvent event = events.get(i);
+         if (lastEventId_ >= 0 && event.getId() <= lastEventId_)
+            continue;
+
+         // dispatch event
+         dispatchEvent(event);
+         lastEventId_ = event.getId();
+      }
+
+      return true;
+   }
+
+   private void onPushedEvents(JsArray<ClientEvent> events)
+   {
+      // keep watchdog appraised of successful receipt of events
+      watchdog_.cancel();
+
+      try
+      {
+         processEvents(events);
+      }
+      catch(Throwable e)
+      {
+         GWT.log("ERROR: Processing pushed client events", e);
+      }
+
+      // acknowledge receipt so the session can push more
+      eventChannel_.acknowledge(lastEventId_);
+   }
+
    private void dispatchEvent(ClientEvent event)
    {
       // do some special handling before calling the standard dispatcher
@@ -480,6 +554,8 @@ class RemoteServerEventListener
    private ServerRequestCallback<JsArray<ClientEvent>> activeRequestCallback_;
 
    private final ClientEventDispatcher eventDispatcher_;
+
+   private final RemoteServerEventChannel eventChannel_;
    
    private final ClientEventHandler externalEventHandler_;
      
@@ -433,6 +433,12 @@ public class SessionInfo extends JavaScriptObject
       return this.websocket_connect_timeout;
    }-*/;
 
+   // port of the websocket which pushes client events, obscured in server
+   // mode (empty when disabled)
+   public final native String getClientEventsPort() /*-{
+      return this.client_events_port || "";
+   }-*/;
+
    public final native boolean getAllowExternalPublish() /*-{
       return this.allow_external_publish;
    }-*/;
@@ -78,7 +78,7 @@ public class GitPresenterCore
    @Handler
    void onVcsRefresh()
    {
-      gitState_.refresh();
+      gitState_.refreshAll();
    }
 
    @Handler
@@ -84,7 +84,22 @@ public class GitState extends VcsState
 
    public void refresh(final boolean showError, final Command onCompleted)
    {
-      server_.gitAllStatus(new ServerRequestCallback<AllStatus>()
+      refresh(false, showError, onCompleted);
+   }
+
+   // re-reads the status of the whole working tree, picking up changes the
+   // session doesn't monitor (e.g. to ignored files); for explicit refreshes
+   public void refreshAll()
+   {
+      if (session_.getSessionInfo().isVcsEnabled())
+         refresh(true, true, null);
+   }
+
+   private void refresh(final boolean all,
+                        final boolean showError,
+                        final Command onCompleted)
+   {
+      server_.gitAllStatus(all, new ServerRequestCallback<AllStatus>()
       {
          @Override
          public void onResponseReceived(AllStatus response)